@@ -0,0 +1,346 @@
+/* linux/arch/arm/mach-s5pv310/busfreq-coupling.c
+ *
+ * Copyright (c) 2010 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * S5PV310 - CPU/bus DVFS coupling
+ *
+ * The bus level is normally picked from the DMC PPMU counters when the
+ * cpufreq governor samples. A cpu that ramps up into a memory bound
+ * phase would then run with a slow bus until the next sample. This
+ * watches the cpufreq transitions instead: before the cpu speeds up, the
+ * bus is raised to the floor the selected coupling table gives for the
+ * new cpu frequency, and further when the cpu PPMU saw memory stalls.
+ * The "off" table does neither.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/cpufreq.h>
+#include <linux/device.h>
+#include <linux/jiffies.h>
+#include <linux/spinlock.h>
+#include <linux/sysfs.h>
+
+#include <mach/cpufreq.h>
+#include <mach/busfreq-coupling.h>
+
+#define COUPLING_MAX_LEVELS	BUS_LEVEL_END
+
+/* stall ratios (percent) of the cpu PPMU, as used by busfreq_target() */
+#define STALL_LOW_DEFAULT	5
+#define STALL_HIGH_DEFAULT	10
+
+struct coupling_entry {
+	unsigned int cpu_freq;		/* at or above this cpu frequency */
+	unsigned int bus_level;		/* the bus runs at least this level */
+};
+
+struct coupling_table {
+	const char *name;
+	bool stall_raise;		/* raise further on memory stalls */
+	struct coupling_entry entry[4];	/* fastest first, ends at 0 kHz */
+};
+
+static const struct coupling_table coupling_tables[] = {
+	{
+		.name = "off",
+		.entry = {
+			{ 0, BUS_L2 },
+		},
+	}, {
+		.name = "performance",
+		.stall_raise = true,
+		.entry = {
+			{ 800000, BUS_L0 },
+			{ 0, BUS_L1 },
+		},
+	}, {
+		.name = "balanced",
+		.stall_raise = true,
+		.entry = {
+			{ 1000000, BUS_L0 },
+			{ 500000, BUS_L1 },
+			{ 0, BUS_L2 },
+		},
+	}, {
+		.name = "powersave",
+		.stall_raise = true,
+		.entry = {
+			{ 1200000, BUS_L0 },
+			{ 800000, BUS_L1 },
+			{ 0, BUS_L2 },
+		},
+	},
+};
+
+static const struct busfreq_coupling_ops *coupling_ops;
+static const struct coupling_table *coupling = &coupling_tables[2];
+static unsigned int stall_low = STALL_LOW_DEFAULT;
+static unsigned int stall_high = STALL_HIGH_DEFAULT;
+
+static DEFINE_SPINLOCK(coupling_lock);
+static unsigned int cpu_freq;
+static unsigned int last_stall;
+
+static struct {
+	unsigned int level;
+	unsigned long since;
+	u64 residency_ms[COUPLING_MAX_LEVELS];
+	unsigned long entries[COUPLING_MAX_LEVELS];
+	unsigned long raises;
+	unsigned long stall_raises;
+} coupling_stats;
+
+static unsigned int coupling_table_floor(unsigned int freq)
+{
+	const struct coupling_entry *e = coupling->entry;
+	unsigned int level;
+
+	while (e->cpu_freq && freq < e->cpu_freq)
+		e++;
+
+	level = e->bus_level;
+	if (level >= coupling_ops->nr_levels)
+		level = coupling_ops->nr_levels - 1;
+
+	return level;
+}
+
+/* called with coupling_lock held */
+static unsigned int __coupling_floor(unsigned int freq, unsigned int stall,
+				     bool *stalled)
+{
+	unsigned int level = coupling_table_floor(freq);
+
+	*stalled = false;
+	if (!coupling->stall_raise)
+		return level;
+
+	if (stall > stall_high && level > BUS_L0) {
+		level = BUS_L0;
+		*stalled = true;
+	} else if (stall > stall_low && level > BUS_L1) {
+		level = BUS_L1;
+		*stalled = true;
+	}
+
+	return level;
+}
+
+/*
+ * Lowest bus level (highest index) busfreq_target() may pick for the
+ * current cpu frequency.
+ */
+unsigned int busfreq_coupling_floor(unsigned int level)
+{
+	unsigned long flags;
+	unsigned int floor;
+
+	if (!coupling_ops)
+		return level;
+
+	spin_lock_irqsave(&coupling_lock, flags);
+	floor = coupling_table_floor(cpu_freq);
+	spin_unlock_irqrestore(&coupling_lock, flags);
+
+	return min(level, floor);
+}
+
+/* memory stall ratio seen by the cpu PPMU over the last sample */
+void busfreq_coupling_stall(unsigned int stall)
+{
+	last_stall = stall;
+}
+
+/* the bus is now running at @level */
+void busfreq_coupling_account(unsigned int level)
+{
+	unsigned long flags;
+	unsigned long now = jiffies;
+
+	if (level >= COUPLING_MAX_LEVELS)
+		return;
+
+	spin_lock_irqsave(&coupling_lock, flags);
+	coupling_stats.residency_ms[coupling_stats.level] +=
+		jiffies_to_msecs(now - coupling_stats.since);
+	coupling_stats.since = now;
+	if (coupling_stats.level != level) {
+		coupling_stats.level = level;
+		coupling_stats.entries[level]++;
+	}
+	spin_unlock_irqrestore(&coupling_lock, flags);
+}
+
+static int busfreq_coupling_transition(struct notifier_block *nb,
+				       unsigned long val, void *data)
+{
+	struct cpufreq_freqs *freqs = data;
+	unsigned int level = 0;
+	unsigned long flags;
+	bool raise = false, stalled = false;
+
+	spin_lock_irqsave(&coupling_lock, flags);
+	switch (val) {
+	case CPUFREQ_PRECHANGE:
+		/* get the bandwidth in place before the cpu speeds up */
+		if (freqs->new <= freqs->old)
+			break;
+		level = __coupling_floor(freqs->new, last_stall, &stalled);
+		if (level < coupling_stats.level) {
+			raise = true;
+			coupling_stats.raises++;
+			if (stalled)
+				coupling_stats.stall_raises++;
+		}
+		break;
+	case CPUFREQ_POSTCHANGE:
+		cpu_freq = freqs->new;
+		break;
+	}
+	spin_unlock_irqrestore(&coupling_lock, flags);
+
+	if (raise)
+		coupling_ops->raise(level);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block busfreq_coupling_nb = {
+	.notifier_call = busfreq_coupling_transition,
+};
+
+static ssize_t show_table(struct device *dev, struct device_attribute *attr,
+			  char *buf)
+{
+	ssize_t len = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(coupling_tables); i++)
+		len += sprintf(buf + len,
+			       &coupling_tables[i] == coupling ? "[%s] " : "%s ",
+			       coupling_tables[i].name);
+	len += sprintf(buf + len, "\n");
+
+	return len;
+}
+
+static ssize_t store_table(struct device *dev, struct device_attribute *attr,
+			   const char *buf, size_t count)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(coupling_tables); i++) {
+		if (sysfs_streq(buf, coupling_tables[i].name)) {
+			coupling = &coupling_tables[i];
+			return count;
+		}
+	}
+
+	return -EINVAL;
+}
+static DEVICE_ATTR(table, 0644, show_table, store_table);
+
+#define show_store_one(name)						\
+static ssize_t show_##name(struct device *dev,				\
+			   struct device_attribute *attr, char *buf)	\
+{									\
+	return sprintf(buf, "%u\n", name);				\
+}									\
+static ssize_t store_##name(struct device *dev,				\
+			    struct device_attribute *attr,		\
+			    const char *buf, size_t count)		\
+{									\
+	unsigned int input;						\
+									\
+	if (sscanf(buf, "%u", &input) != 1 || input > 100)		\
+		return -EINVAL;						\
+	name = input;							\
+	return count;							\
+}									\
+static DEVICE_ATTR(name, 0644, show_##name, store_##name)
+
+show_store_one(stall_low);
+show_store_one(stall_high);
+
+static ssize_t show_residency(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	u64 residency[COUPLING_MAX_LEVELS];
+	unsigned long entries[COUPLING_MAX_LEVELS];
+	unsigned long flags;
+	ssize_t len = 0;
+	int i;
+
+	spin_lock_irqsave(&coupling_lock, flags);
+	memcpy(residency, coupling_stats.residency_ms, sizeof(residency));
+	memcpy(entries, coupling_stats.entries, sizeof(entries));
+	residency[coupling_stats.level] +=
+		jiffies_to_msecs(jiffies - coupling_stats.since);
+	spin_unlock_irqrestore(&coupling_lock, flags);
+
+	for (i = 0; i < coupling_ops->nr_levels; i++)
+		len += sprintf(buf + len, "%u %llu %lu\n",
+			       coupling_ops->mem_clk(i), residency[i],
+			       entries[i]);
+
+	return len;
+}
+static DEVICE_ATTR(residency, 0444, show_residency, NULL);
+
+static ssize_t show_stats(struct device *dev, struct device_attribute *attr,
+			  char *buf)
+{
+	return sprintf(buf, "raises %lu\nstall_raises %lu\nstall %u\n"
+		       "cpu_freq %u\n", coupling_stats.raises,
+		       coupling_stats.stall_raises, last_stall, cpu_freq);
+}
+static DEVICE_ATTR(stats, 0444, show_stats, NULL);
+
+static struct attribute *coupling_attributes[] = {
+	&dev_attr_table.attr,
+	&dev_attr_stall_low.attr,
+	&dev_attr_stall_high.attr,
+	&dev_attr_residency.attr,
+	&dev_attr_stats.attr,
+	NULL
+};
+
+static struct attribute_group coupling_attr_group = {
+	.name = "coupling",
+	.attrs = coupling_attributes,
+};
+
+int __init busfreq_coupling_init(struct device *dev,
+				 const struct busfreq_coupling_ops *ops)
+{
+	int ret;
+
+	if (ops->nr_levels == 0 || ops->nr_levels > COUPLING_MAX_LEVELS)
+		return -EINVAL;
+
+	coupling_stats.since = jiffies;
+	cpu_freq = cpufreq_quick_get(0);
+	coupling_ops = ops;
+
+	ret = sysfs_create_group(&dev->kobj, &coupling_attr_group);
+	if (ret)
+		goto err;
+
+	ret = cpufreq_register_notifier(&busfreq_coupling_nb,
+					CPUFREQ_TRANSITION_NOTIFIER);
+	if (ret) {
+		sysfs_remove_group(&dev->kobj, &coupling_attr_group);
+		goto err;
+	}
+
+	return 0;
+err:
+	coupling_ops = NULL;
+	return ret;
+}
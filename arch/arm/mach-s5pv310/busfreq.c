@@ -21,6 +21,7 @@
 #include <linux/device.h>
 #include <linux/module.h>
 #include <linux/cpu.h>
+#include <linux/cpufreq.h>
 #include <linux/ktime.h>
 #include <linux/tick.h>
 #include <linux/kernel_stat.h>
@@ -392,6 +393,7 @@ static void cpuload_nothing(struct work_struct *work)
 static void cpuload_timer(struct work_struct *work)
 {
 	unsigned int i, avg_load, max_load, load = 0;
+	bool idle = true;
 
 	for_each_online_cpu(i) {
 		struct cpu_time_info *tmp_info;
@@ -413,6 +415,9 @@ static void cpuload_timer(struct work_struct *work)
 		if(wall_time < idle_time)
 			idle_time = wall_time;
 
+		if (!cpufreq_window_idle(wall_time, idle_time))
+			idle = false;
+
 		tmp_info->load = 100 * (wall_time - idle_time) / wall_time;
 
 		if(tmp_info->load > load)
@@ -421,6 +426,12 @@ static void cpuload_timer(struct work_struct *work)
 	max_load=load;
 	avg_load = load / num_online_cpus();
 
+	/* idle cpus at the slow bus sampling rate have nothing to switch */
+	cpufreq_sample_account(CPUFREQ_SAMPLER_BUSFREQ, idle,
+			       idle && high_transition == 0);
+	if (idle && high_transition == 0)
+		goto rearm;
+
 	if (high_transition == 0) {
 		if (max_load > trans_load) {
 			cancel_delayed_work_sync(&busfreq_work);
@@ -437,6 +448,7 @@ static void cpuload_timer(struct work_struct *work)
 
 	queue_delayed_work_on(0, busfreq_wq, &busfreq_work, 0);
 
+rearm:
 	if (hybrid == 1)
 		queue_delayed_work_on(0, cpuload_wq, &cpuload_work, HZ/25);
 	else
@@ -468,7 +480,7 @@ static int __init s5pv310_busfreq_init(void)
 		printk(KERN_ERR "Creation of busfreq work failed\n");
 		return -EFAULT;
 	}
-	INIT_DELAYED_WORK(&busfreq_work, busfreq_timer);
+	INIT_DELAYED_WORK_DEFERRABLE(&busfreq_work, busfreq_timer);
 
 	sampling_rate = CHECK_DELAY;
 	up_threshold = UP_THRESHOLD_DEFAULT;
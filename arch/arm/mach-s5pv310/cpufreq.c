@@ -41,6 +41,8 @@
 #include <plat/s5pv310.h>
 
 #include <mach/cpufreq.h>
+#include <mach/dvfs-qos.h>
+#include <mach/busfreq-coupling.h>
 #include <mach/dmc.h>
 #include <mach/map.h>
 #include <mach/regs-clock.h>
@@ -61,7 +63,6 @@ static struct cpufreq_freqs freqs;
 static int s5pv310_dvs_locking;
 static bool s5pv310_cpufreq_init_done;
 static DEFINE_MUTEX(set_cpu_freq_change);
-static DEFINE_MUTEX(set_cpu_freq_lock);
 
 #undef HAVE_DAC
 
@@ -190,7 +191,6 @@ static unsigned int calc_bus_utilization(struct s5pv310_dmc_ppmu_hw *ppmu);
 static void busfreq_target(void);
 
 static DEFINE_MUTEX(set_bus_freq_change);
-static DEFINE_MUTEX(set_bus_freq_lock);
 
 enum busfreq_level_idx {
 	LV_0,
@@ -227,21 +227,28 @@ static struct busfreq_table s5pv310_busfreq_table[] = {
 /* This defines are for cpufreq lock */
 #define CPUFREQ_MIN_LEVEL	(CPUFREQ_LEVEL_END - 1)
 
-unsigned int g_cpufreq_lock_id;
-unsigned int g_cpufreq_lock_val[DVFS_LOCK_ID_END];
-unsigned int g_cpufreq_lock_level = CPUFREQ_MIN_LEVEL;
-
 #define CPUFREQ_LIMIT_LEVEL	L0
 
-unsigned int g_cpufreq_limit_id;
-unsigned int g_cpufreq_limit_val[DVFS_LOCK_ID_END];
-unsigned int g_cpufreq_limit_level = CPUFREQ_LIMIT_LEVEL;
-
 #define BUSFREQ_MIN_LEVEL	(LV_END - 1)
 
-unsigned int g_busfreq_lock_id;
-unsigned int g_busfreq_lock_val[DVFS_LOCK_ID_END];
-unsigned int g_busfreq_lock_level = BUSFREQ_MIN_LEVEL;
+/* Per lock ID constraints, aggregated by dvfs-qos */
+static const char *dvfs_lock_name[DVFS_LOCK_ID_END] = {
+	[DVFS_LOCK_ID_G2D]	= "g2d",
+	[DVFS_LOCK_ID_MFC]	= "mfc",
+	[DVFS_LOCK_ID_USB]	= "usb",
+	[DVFS_LOCK_ID_CAM]	= "cam",
+	[DVFS_LOCK_ID_APP]	= "app",
+	[DVFS_LOCK_ID_PM]	= "pm",
+	[DVFS_LOCK_ID_TSP]	= "tsp",
+	[DVFS_LOCK_ID_PEN]	= "pen",
+	[DVFS_LOCK_ID_TMU]	= "tmu",
+};
+
+static struct dvfs_qos_request cpufreq_lock_req[DVFS_LOCK_ID_END];
+static struct dvfs_qos_request cpufreq_limit_req[DVFS_LOCK_ID_END];
+#ifdef CONFIG_S5PV310_BUSFREQ
+static struct dvfs_qos_request busfreq_lock_req[DVFS_LOCK_ID_END];
+#endif
 
 #ifdef CONFIG_CPU_S5PV310_EVT1
 static unsigned int clkdiv_cpu0[CPUFREQ_LEVEL_END][7] = {
@@ -1212,11 +1219,11 @@ static int s5pv310_target(struct cpufreq_policy *policy,
 		goto cpufreq_out;
 	}
 
-	if ((index > g_cpufreq_lock_level) && check_gov)
-		index = g_cpufreq_lock_level;
+	if ((index > dvfs_qos_value(DVFS_QOS_CPU_FLOOR)) && check_gov)
+		index = dvfs_qos_value(DVFS_QOS_CPU_FLOOR);
 
-	if ((index < g_cpufreq_limit_level) && check_gov)
-		index = g_cpufreq_limit_level;
+	if ((index < dvfs_qos_value(DVFS_QOS_CPU_CEILING)) && check_gov)
+		index = dvfs_qos_value(DVFS_QOS_CPU_CEILING);
 
 	if (s5pv310_max_armclk == ARMCLOCK_1200MHZ) {
 #ifdef CONFIG_FREQ_STEP_UP_L2_L0
@@ -1460,17 +1467,44 @@ static int busload_observor(struct busfreq_table *freq_table,
 	if ((idx > LV_1) && (cpu_bus_load > 5))
 		idx = LV_1;
 
-	if (idx > g_busfreq_lock_level)
-		idx = g_busfreq_lock_level;
+	if (idx > dvfs_qos_value(DVFS_QOS_BUS_FLOOR))
+		idx = dvfs_qos_value(DVFS_QOS_BUS_FLOOR);
 
 	*index = idx;
 
 	return 0;
 }
 
+/* called with set_bus_freq_change held */
+static void busfreq_set_level(unsigned int index)
+{
+	unsigned int voltage;
+
+	if (p_idx == index)
+		return;
+
+	voltage = s5pv310_busfreq_table[index].volt;
+	if (p_idx > index) {
+#if defined(CONFIG_REGULATOR)
+		regulator_set_voltage(int_regulator, voltage, voltage);
+#endif
+	}
+
+	s5pv310_set_busfreq(index);
+
+	if (p_idx < index) {
+#if defined(CONFIG_REGULATOR)
+		regulator_set_voltage(int_regulator, voltage, voltage);
+#endif
+	}
+	smp_mb();
+	p_idx = index;
+	busfreq_coupling_account(index);
+}
+
 static void busfreq_target(void)
 {
-	unsigned int i, index = 0, ret, voltage;
+	unsigned int i, index = 0, ret;
 	unsigned int bus_load, cpu_bus_load;
 #ifdef SYSFS_DEBUG_BUSFREQ
 	unsigned long level_state_jiffies;
@@ -1487,18 +1521,11 @@ static void busfreq_target(void)
 	}
 
 	cpu_bus_load = get_cpu_ppmu_load();
+	busfreq_coupling_stall(cpu_bus_load);
 
 	if (cpu_bus_load > 10) {
-		if (p_idx != LV_0) {
-			voltage = s5pv310_busfreq_table[LV_0].volt;
-#if defined(CONFIG_REGULATOR)
-			regulator_set_voltage(int_regulator, voltage, voltage);
-#endif
-			s5pv310_set_busfreq(LV_0);
-		}
-	  p_idx = LV_0;
-
-	  goto out;
+		busfreq_set_level(LV_0);
+		goto out;
 	}
 
 	bus_load = get_ppc_load();
@@ -1509,6 +1536,9 @@ static void busfreq_target(void)
 	if (ret < 0)
 		printk(KERN_ERR "%s:fail to check load (%d)\n", __func__, ret);
 
+	/* do not drop below what the cpu frequency is coupled to */
+	index = busfreq_coupling_floor(index);
+
 #ifdef SYSFS_DEBUG_BUSFREQ
 	curjiffies = jiffies;
 	if (prejiffies != 0)
@@ -1533,24 +1563,7 @@ static void busfreq_target(void)
 	}
 #endif
 
-	if (p_idx != index) {
-		voltage = s5pv310_busfreq_table[index].volt;
-		if (p_idx > index) {
-#if defined(CONFIG_REGULATOR)
-			regulator_set_voltage(int_regulator, voltage, voltage);
-#endif
-		}
-
-		s5pv310_set_busfreq(index);
-
-		if (p_idx < index) {
-#if defined(CONFIG_REGULATOR)
-			regulator_set_voltage(int_regulator, voltage, voltage);
-#endif
-		}
-		smp_mb();
-		p_idx = index;
-	}
+	busfreq_set_level(index);
 out:
 	busfreq_ppmu_init();
 	cpu_ppmu_init();
@@ -1558,14 +1571,72 @@ fix_out:
 	mutex_unlock(&set_bus_freq_change);
 
 }
+
+/* cpu is about to speed up, give it the coupled bus level right away */
+static void busfreq_coupling_raise(unsigned int index)
+{
+	mutex_lock(&set_bus_freq_change);
+	if (!busfreq_fix && index < p_idx)
+		busfreq_set_level(index);
+	mutex_unlock(&set_bus_freq_change);
+}
+
+static unsigned int busfreq_coupling_mem_clk(unsigned int index)
+{
+	return s5pv310_busfreq_table[index].mem_clk;
+}
+
+static const struct busfreq_coupling_ops s5pv310_busfreq_coupling_ops = {
+	.nr_levels	= LV_END,
+	.mem_clk	= busfreq_coupling_mem_clk,
+	.raise		= busfreq_coupling_raise,
+};
 #endif
 
+/*
+ * Re-evaluate the current frequency against the aggregated constraints.
+ * s5pv310_target() clamps any request to the floor and ceiling, so asking
+ * for the current frequency is enough to apply them.
+ */
+static int s5pv310_cpufreq_apply_qos(void)
+{
+	struct cpufreq_policy *policy;
+	unsigned int cur_freq, floor_freq, ceiling_freq;
+	int ret = 0;
+
+	policy = cpufreq_cpu_get(0);
+	if (!policy)
+		return 0;
+
+	cur_freq = s5pv310_getspeed(0);
+	floor_freq = s5pv310_freq_table[dvfs_qos_value(DVFS_QOS_CPU_FLOOR)].frequency;
+	ceiling_freq = s5pv310_freq_table[dvfs_qos_value(DVFS_QOS_CPU_CEILING)].frequency;
+
+	if ((floor_freq != CPUFREQ_TABLE_END && cur_freq < floor_freq) ||
+	    (ceiling_freq != CPUFREQ_TABLE_END && cur_freq > ceiling_freq))
+		ret = cpufreq_driver_target(policy, cur_freq,
+					    MASK_ONLY_SET_CPUFREQ);
+
+	cpufreq_cpu_put(policy);
+
+	return ret;
+}
+
+static int s5pv310_cpufreq_qos_notifier_call(struct notifier_block *nb,
+					     unsigned long level, void *data)
+{
+	s5pv310_cpufreq_apply_qos();
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block s5pv310_cpufreq_qos_notifier = {
+	.notifier_call = s5pv310_cpufreq_qos_notifier_call,
+};
+
 int s5pv310_cpufreq_lock(unsigned int nId,
 			enum cpufreq_level_request cpufreq_level)
 {
-	int ret = 0, cpu = 0;
-	unsigned int cur_freq;
-
 	if (!s5pv310_cpufreq_init_done)
 		return 0;
 
@@ -1578,58 +1649,22 @@ int s5pv310_cpufreq_lock(unsigned int nId,
 		}
 	}
 
-	if (g_cpufreq_lock_id & (1 << nId)) {
-		printk(KERN_ERR
-		"[CPUFREQ]This device [%d] already locked cpufreq\n", nId);
-		return 0;
-	}
-	mutex_lock(&set_cpu_freq_lock);
-	g_cpufreq_lock_id |= (1 << nId);
-	g_cpufreq_lock_val[nId] = cpufreq_level;
-
-	/* If the requested cpufreq is higher than current min frequency */
-	if (cpufreq_level < g_cpufreq_lock_level)
-		g_cpufreq_lock_level = cpufreq_level;
-	mutex_unlock(&set_cpu_freq_lock);
+	dvfs_qos_update_request(&cpufreq_lock_req[nId], cpufreq_level);
 
 	/* If current frequency is lower than requested freq, need to update */
-	cur_freq = s5pv310_getspeed(cpu);
-	if (cur_freq < s5pv310_freq_table[cpufreq_level].frequency) {
-		ret = cpufreq_driver_target(cpufreq_cpu_get(cpu),
-				s5pv310_freq_table[cpufreq_level].frequency,
-				MASK_ONLY_SET_CPUFREQ);
-	}
-
-	return ret;
+	return s5pv310_cpufreq_apply_qos();
 }
 
 void s5pv310_cpufreq_lock_free(unsigned int nId)
 {
-	unsigned int i;
-
 	if (!s5pv310_cpufreq_init_done)
 		return;
 
-	mutex_lock(&set_cpu_freq_lock);
-
-	g_cpufreq_lock_id &= ~(1 << nId);
-	g_cpufreq_lock_val[nId] = CPUFREQ_MIN_LEVEL;
-	g_cpufreq_lock_level = CPUFREQ_MIN_LEVEL;
-	if (g_cpufreq_lock_id) {
-		for (i = 0; i < DVFS_LOCK_ID_END; i++) {
-			if (g_cpufreq_lock_val[i] < g_cpufreq_lock_level)
-				g_cpufreq_lock_level = g_cpufreq_lock_val[i];
-		}
-	}
-
-	mutex_unlock(&set_cpu_freq_lock);
+	dvfs_qos_remove_request(&cpufreq_lock_req[nId]);
 }
 
 int s5pv310_cpufreq_upper_limit(unsigned int nId, enum cpufreq_level_request cpufreq_level)
 {
-	int ret = 0, cpu = 0;
-	unsigned int cur_freq;
-
 	if (!s5pv310_cpufreq_init_done)
 		return 0;
 
@@ -1642,94 +1677,39 @@ int s5pv310_cpufreq_upper_limit(unsigned int nId, enum cpufreq_level_request cpu
 		}
 	}
 
-	if (g_cpufreq_limit_id & (1 << nId)) {
-		printk(KERN_ERR "[CPUFREQ]This device [%d] already limited cpufreq\n", nId);
-		return 0;
-	}
-
-	mutex_lock(&set_cpu_freq_lock);
-	g_cpufreq_limit_id |= (1 << nId);
-	g_cpufreq_limit_val[nId] = cpufreq_level;
-
-	/* If the requested limit level is lower than current value */
-	if (cpufreq_level > g_cpufreq_limit_level)
-		g_cpufreq_limit_level = cpufreq_level;
-
-	mutex_unlock(&set_cpu_freq_lock);
+	dvfs_qos_update_request(&cpufreq_limit_req[nId], cpufreq_level);
 
 	/* If cur frequency is higher than limit freq, it needs to update */
-	cur_freq = s5pv310_getspeed(cpu);
-	if (cur_freq > s5pv310_freq_table[cpufreq_level].frequency) {
-		ret = cpufreq_driver_target(cpufreq_cpu_get(cpu),
-				s5pv310_freq_table[cpufreq_level].frequency,
-				MASK_ONLY_SET_CPUFREQ);
-	}
-
-	return ret;
+	return s5pv310_cpufreq_apply_qos();
 }
 
 void s5pv310_cpufreq_upper_limit_free(unsigned int nId)
 {
-	unsigned int i;
-
 	if (!s5pv310_cpufreq_init_done)
 		return;
 
-	mutex_lock(&set_cpu_freq_lock);
-	g_cpufreq_limit_id &= ~(1 << nId);
-	g_cpufreq_limit_val[nId] = CPUFREQ_LIMIT_LEVEL;
-	g_cpufreq_limit_level = CPUFREQ_LIMIT_LEVEL;
-	if (g_cpufreq_limit_id) {
-		for (i = 0; i < DVFS_LOCK_ID_END; i++) {
-			if (g_cpufreq_limit_val[i] > g_cpufreq_limit_level)
-				g_cpufreq_limit_level = g_cpufreq_limit_val[i];
-		}
-	}
-	mutex_unlock(&set_cpu_freq_lock);
+	dvfs_qos_remove_request(&cpufreq_limit_req[nId]);
 }
 
 #ifdef CONFIG_S5PV310_BUSFREQ
 int s5pv310_busfreq_lock(unsigned int nId,
 			enum busfreq_level_request busfreq_level)
 {
-	if (g_busfreq_lock_id & (1 << nId)) {
-		printk(KERN_ERR
-		"[BUSFREQ] This device [%d] already locked busfreq\n", nId);
-		return 0;
-	}
-	mutex_lock(&set_bus_freq_lock);
-	g_busfreq_lock_id |= (1 << nId);
-	g_busfreq_lock_val[nId] = busfreq_level;
-
-	/* If the requested cpufreq is higher than current min frequency */
-	if (busfreq_level < g_busfreq_lock_level) {
-		g_busfreq_lock_level = busfreq_level;
-		mutex_unlock(&set_bus_freq_lock);
+	dvfs_qos_update_request(&busfreq_lock_req[nId], busfreq_level);
+
+	/*
+	 * Only a raised floor needs the bus retargeted, and only this call
+	 * raises it: a lowered one is picked up by the next busfreq sample.
+	 */
+	if (dvfs_qos_value(DVFS_QOS_BUS_FLOOR) < p_idx)
 		busfreq_target();
-	} else
-		mutex_unlock(&set_bus_freq_lock);
 
 	return 0;
 }
 
 void s5pv310_busfreq_lock_free(unsigned int nId)
 {
-	unsigned int i;
-
-	mutex_lock(&set_bus_freq_lock);
-
-	g_busfreq_lock_id &= ~(1 << nId);
-	g_busfreq_lock_val[nId] = BUSFREQ_MIN_LEVEL;
-	g_busfreq_lock_level = BUSFREQ_MIN_LEVEL;
-
-	if (g_busfreq_lock_id) {
-		for (i = 0; i < DVFS_LOCK_ID_END; i++) {
-			if (g_busfreq_lock_val[i] < g_busfreq_lock_level)
-				g_busfreq_lock_level = g_busfreq_lock_val[i];
-		}
-	}
-
-	mutex_unlock(&set_bus_freq_lock);
+	dvfs_qos_remove_request(&busfreq_lock_req[nId]);
 }
 #endif
 
@@ -1863,7 +1843,8 @@ static int s5pv310_cpufreq_cpu_init(struct cpufreq_policy *policy)
 }
 
 static struct cpufreq_driver s5pv310_driver = {
-	.flags = CPUFREQ_STICKY,
+	/* the bus level is re-evaluated in s5pv310_target() */
+	.flags = CPUFREQ_STICKY | CPUFREQ_TARGET_ALWAYS,
 	.verify = s5pv310_verify_policy,
 	.target = s5pv310_target,
 	.get = s5pv310_getspeed,
@@ -2541,11 +2522,22 @@ static int __init s5pv310_cpufreq_init(void)
 	cpu_ppmu_init();
 
 	for (i = 0; i < DVFS_LOCK_ID_END; i++)
-		g_busfreq_lock_val[i] = BUSFREQ_MIN_LEVEL;
-
+		dvfs_qos_init_request(&busfreq_lock_req[i],
+				      DVFS_QOS_BUS_FLOOR, dvfs_lock_name[i]);
+	dvfs_qos_set_default(DVFS_QOS_BUS_FLOOR, BUSFREQ_MIN_LEVEL);
 #endif
-	for (i = 0; i < DVFS_LOCK_ID_END; i++)
-		g_cpufreq_lock_val[i] = CPUFREQ_MIN_LEVEL;
+	for (i = 0; i < DVFS_LOCK_ID_END; i++) {
+		dvfs_qos_init_request(&cpufreq_lock_req[i],
+				      DVFS_QOS_CPU_FLOOR, dvfs_lock_name[i]);
+		dvfs_qos_init_request(&cpufreq_limit_req[i],
+				      DVFS_QOS_CPU_CEILING, dvfs_lock_name[i]);
+	}
+	dvfs_qos_set_default(DVFS_QOS_CPU_FLOOR, CPUFREQ_MIN_LEVEL);
+	dvfs_qos_set_default(DVFS_QOS_CPU_CEILING, CPUFREQ_LIMIT_LEVEL);
+	dvfs_qos_add_notifier(DVFS_QOS_CPU_FLOOR,
+			      &s5pv310_cpufreq_qos_notifier);
+	dvfs_qos_add_notifier(DVFS_QOS_CPU_CEILING,
+			      &s5pv310_cpufreq_qos_notifier);
 
 	register_pm_notifier(&s5pv310_cpufreq_notifier);
 	register_reboot_notifier(&s5pv310_cpufreq_reboot_notifier);
@@ -2659,6 +2651,7 @@ static ssize_t store_fix_busfreq_level(struct device *dev,
 				s5pv310_busfreq_table[fix_busfreq_level].volt);
 #endif
 		pre_fix_busfreq_level = fix_busfreq_level;
+		busfreq_coupling_account(fix_busfreq_level);
 
 		return count;
 	}
@@ -2781,6 +2774,14 @@ static int __init s5pv310_busfreq_device_init(void)
 		goto sysfs_err;
 	}
 
+#ifdef CONFIG_S5PV310_BUSFREQ
+	ret = busfreq_coupling_init(&s5pv310_busfreq_device.dev,
+				    &s5pv310_busfreq_coupling_ops);
+	if (ret)
+		printk(KERN_ERR "busfreq: no cpu coupling (%d)\n", ret);
+	ret = 0;
+#endif
+
 	printk(KERN_INFO "s5pv310_busfreq_device_init: %d\n", ret);
 
 	return ret;
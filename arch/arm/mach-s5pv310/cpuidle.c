@@ -16,6 +16,13 @@
 #include <linux/gpio.h>
 #include <linux/delay.h>
 #include <linux/dma-mapping.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/sched.h>
+#include <linux/tick.h>
+#include <linux/pm_qos_params.h>
+#include <linux/math64.h>
+#include <trace/events/power.h>
 
 #include <asm/proc-fns.h>
 #include <asm/cacheflush.h>
@@ -626,9 +633,13 @@ static struct cpuidle_state s5pv310_cpuidle_set[] = {
 		.desc			= "ARM clock gating(WFI)",
 	},
 	[1] = {
+		/*
+		 * The cheapest mode behind this state is AFTR; which mode
+		 * is entered is decided by s5pv310_enter_lowpower().
+		 */
 		.enter			= s5pv310_enter_lowpower,
-		.exit_latency		= 10,
-		.target_residency	= 40000,
+		.exit_latency		= 300,
+		.target_residency	= 5000,
 		.flags			= CPUIDLE_FLAG_TIME_VALID,
 		.name			= "LOW_POWER",
 		.desc			= "ARM power down",
@@ -784,6 +795,7 @@ static int s5pv310_enter_core0_aftr(struct cpuidle_device *dev,
 
 	local_irq_disable();
 	do_gettimeofday(&before);
+	trace_power_start(POWER_CSTATE, 2);
 
 #ifdef CONFIG_CPU_S5PV310_EVT1
 	s5pv310_set_wakeupmask();
@@ -939,6 +951,7 @@ static int s5pv310_enter_core0_lpa(struct cpuidle_device *dev,
 
 	local_irq_disable();
 	do_gettimeofday(&before);
+	trace_power_start(POWER_CSTATE, 3);
 
 	/*
 	 * Unmasking all wakeup source.
@@ -1049,6 +1062,7 @@ static int s5pv310_enter_idle(struct cpuidle_device *dev,
 #endif
 	local_irq_disable();
 	do_gettimeofday(&before);
+	trace_power_start(POWER_CSTATE, 1);
 
 	cpu = get_cpu();
 
@@ -1317,10 +1331,225 @@ static int s5pv310_check_operation(void)
 	return 0;
 }
 
+/*
+ * Idle residency predictor
+ *
+ * The cpuidle governor only chooses between IDLE and LOW_POWER. Which
+ * power down mode LOW_POWER ends up in depends on the peripherals, and
+ * AFTR and LPA cost a context save, a cache flush and a cold restart, so
+ * they only pay off when core0 really stays idle for a while.
+ *
+ * As in the menu governor, the idle period is predicted from the time to
+ * the next timer event, scaled by a correction factor per range of that
+ * time which learns how early the cpu is usually woken up by something
+ * else. When the last idle periods were regular, their average is used
+ * if it is shorter. Tasks waiting for I/O will be woken by an interrupt
+ * soon and care about latency, so they make the deep modes more
+ * expensive. The deepest mode whose target residency fits the prediction
+ * and whose latencies fit the constraints is entered.
+ */
+enum idle_mode {
+	IDLE_MODE_WFI,
+	IDLE_MODE_AFTR,
+	IDLE_MODE_LPA,
+	IDLE_MODE_NR,
+};
+
+struct idle_mode_info {
+	const char *name;
+	unsigned int entry_latency;	/* us */
+	unsigned int exit_latency;	/* us */
+	unsigned int target_residency;	/* us */
+};
+
+static const struct idle_mode_info idle_modes[IDLE_MODE_NR] = {
+	[IDLE_MODE_WFI] = {
+		.name			= "WFI",
+		.entry_latency		= 0,
+		.exit_latency		= 1,
+		.target_residency	= 0,
+	},
+	[IDLE_MODE_AFTR] = {
+		.name			= "AFTR",
+		.entry_latency		= 150,
+		.exit_latency		= 300,
+		.target_residency	= 5000,
+	},
+	[IDLE_MODE_LPA] = {
+		.name			= "LPA",
+		.entry_latency		= 300,
+		.exit_latency		= 600,
+		.target_residency	= 10000,
+	},
+};
+
+#define PREDICT_BUCKETS		6
+#define PREDICT_INTERVALS	8
+#define PREDICT_RESOLUTION	1024
+#define PREDICT_DECAY		8
+/*
+ * The last idle periods count as regular when their standard deviation
+ * is below 1/PREDICT_STDDEV_RATIO of their mean, or below
+ * PREDICT_STDDEV_MIN us for periods too short for the ratio to be met.
+ */
+#define PREDICT_STDDEV_RATIO	6
+#define PREDICT_STDDEV_MIN	20	/* us */
+
+struct idle_mode_stats {
+	unsigned long usage;
+	u64 time_us;
+	unsigned long too_deep;		/* woke up before the target residency */
+	unsigned long too_shallow;	/* stayed long enough for a deeper mode */
+};
+
+/* LOW_POWER is core0 only, so is all of this */
+static struct {
+	unsigned int correction_factor[PREDICT_BUCKETS];
+	unsigned int intervals[PREDICT_INTERVALS];
+	int interval_ptr;
+	unsigned int next_timer_us;
+	unsigned int predicted_us;
+	unsigned int bucket;
+	struct idle_mode_stats stats[IDLE_MODE_NR];
+	unsigned long demoted_latency;
+} idle_predictor;
+
+static inline int idle_predict_bucket(unsigned int duration)
+{
+	if (duration < 10)
+		return 0;
+	if (duration < 100)
+		return 1;
+	if (duration < 1000)
+		return 2;
+	if (duration < 10000)
+		return 3;
+	if (duration < 100000)
+		return 4;
+	return 5;
+}
+
+/* average of the last idle periods, when they were regular, else 0 */
+static unsigned int idle_predict_typical(void)
+{
+	u64 avg = 0, variance = 0;
+	int i;
+
+	for (i = 0; i < PREDICT_INTERVALS; i++)
+		avg += idle_predictor.intervals[i];
+	avg = div_u64(avg, PREDICT_INTERVALS);
+
+	for (i = 0; i < PREDICT_INTERVALS; i++) {
+		s64 diff = (s64)idle_predictor.intervals[i] - (s64)avg;
+
+		variance += diff * diff;
+	}
+	variance = div_u64(variance, PREDICT_INTERVALS);
+
+	/* compare squares, avg fits 32 bits */
+	if (variance <= PREDICT_STDDEV_MIN * PREDICT_STDDEV_MIN ||
+	    variance < div_u64(avg * avg,
+			       PREDICT_STDDEV_RATIO * PREDICT_STDDEV_RATIO))
+		return (unsigned int)avg;
+
+	return 0;
+}
+
+/* pick the deepest mode up to @deepest worth entering now */
+static enum idle_mode idle_predict_mode(enum idle_mode deepest)
+{
+	unsigned int *factor;
+	unsigned int typical, latency_req, mult;
+	enum idle_mode mode;
+
+	idle_predictor.next_timer_us =
+		ktime_to_us(tick_nohz_get_sleep_length());
+	idle_predictor.bucket =
+		idle_predict_bucket(idle_predictor.next_timer_us);
+
+	factor = &idle_predictor.correction_factor[idle_predictor.bucket];
+	if (*factor == 0)
+		*factor = PREDICT_RESOLUTION * PREDICT_DECAY;
+
+	idle_predictor.predicted_us = div_u64((u64)idle_predictor.next_timer_us *
+			*factor + PREDICT_RESOLUTION * PREDICT_DECAY / 2,
+			PREDICT_RESOLUTION * PREDICT_DECAY);
+
+	typical = idle_predict_typical();
+	if (typical && typical < idle_predictor.predicted_us)
+		idle_predictor.predicted_us = typical;
+
+	latency_req = pm_qos_request(PM_QOS_CPU_DMA_LATENCY);
+	mult = 1 + 10 * nr_iowait_cpu(smp_processor_id());
+
+	for (mode = deepest; mode > IDLE_MODE_WFI; mode--) {
+		const struct idle_mode_info *m = &idle_modes[mode];
+
+		if (m->target_residency > idle_predictor.predicted_us)
+			continue;
+		if (m->entry_latency + m->exit_latency > latency_req ||
+		    m->exit_latency * mult > idle_predictor.predicted_us) {
+			idle_predictor.demoted_latency++;
+			continue;
+		}
+		break;
+	}
+
+	return mode;
+}
+
+/* learn from the @idle_us core0 just spent in @mode */
+static void idle_predict_update(enum idle_mode mode, enum idle_mode deepest,
+				int idle_us)
+{
+	const struct idle_mode_info *m = &idle_modes[mode];
+	struct idle_mode_stats *stats = &idle_predictor.stats[mode];
+	unsigned int *factor;
+	unsigned int measured_us;
+	enum idle_mode deeper;
+
+	measured_us = idle_us > 0 ? idle_us : 0;
+
+	stats->usage++;
+	stats->time_us += measured_us;
+
+	if (mode != IDLE_MODE_WFI && measured_us < m->target_residency)
+		stats->too_deep++;
+	for (deeper = mode + 1; deeper <= deepest; deeper++) {
+		if (measured_us >= idle_modes[deeper].target_residency) {
+			stats->too_shallow++;
+			break;
+		}
+	}
+
+	/* the exit is part of the measurement, not of the idle period */
+	if (measured_us > m->exit_latency)
+		measured_us -= m->exit_latency;
+	if (measured_us > idle_predictor.next_timer_us)
+		measured_us = idle_predictor.next_timer_us;
+
+	factor = &idle_predictor.correction_factor[idle_predictor.bucket];
+	*factor -= *factor / PREDICT_DECAY;
+	if (idle_predictor.next_timer_us > 0)
+		*factor += div_u64((u64)PREDICT_RESOLUTION * measured_us,
+				   idle_predictor.next_timer_us);
+	else
+		*factor += PREDICT_RESOLUTION;
+	/* never let the factor reach 0, it would never recover */
+	if (*factor == 0)
+		*factor = 1;
+
+	idle_predictor.intervals[idle_predictor.interval_ptr++] = measured_us;
+	if (idle_predictor.interval_ptr >= PREDICT_INTERVALS)
+		idle_predictor.interval_ptr = 0;
+}
+
 static int s5pv310_enter_lowpower(struct cpuidle_device *dev,
 				  struct cpuidle_state *state)
 {
 	struct cpuidle_state *new_state = state;
+	enum idle_mode deepest, mode;
+	int idle_time;
 
 	/* This mode only can be entered when Core1 is offline */
 	if (cpu_online(1)) {
@@ -1333,15 +1562,71 @@ static int s5pv310_enter_lowpower(struct cpuidle_device *dev,
 		return s5pv310_enter_idle(dev, new_state);
 
 	if (s5pv310_check_operation())
-		return (enable_mask & ENABLE_AFTR)
-			? s5pv310_enter_core0_aftr(dev, new_state)
-			: s5pv310_enter_idle(dev, new_state);
+		deepest = (enable_mask & ENABLE_AFTR) ?
+			  IDLE_MODE_AFTR : IDLE_MODE_WFI;
+	else
+		deepest = (enable_mask & ENABLE_LPA) ?
+			  IDLE_MODE_LPA : IDLE_MODE_WFI;
+
+	mode = idle_predict_mode(deepest);
 
-	return (enable_mask & ENABLE_LPA)
-		? s5pv310_enter_core0_lpa(dev, new_state)
-		: s5pv310_enter_idle(dev, new_state);
+	switch (mode) {
+	case IDLE_MODE_LPA:
+		idle_time = s5pv310_enter_core0_lpa(dev, new_state);
+		break;
+	case IDLE_MODE_AFTR:
+		idle_time = s5pv310_enter_core0_aftr(dev, new_state);
+		break;
+	default:
+		dev->last_state = dev->safe_state;
+		idle_time = s5pv310_enter_idle(dev, dev->safe_state);
+		break;
+	}
+
+	idle_predict_update(mode, deepest, idle_time);
+
+	return idle_time;
+}
+
+static int idle_predictor_show(struct seq_file *s, void *unused)
+{
+	int i;
+
+	seq_printf(s, "mode  entry  exit  residency  usage  time_us"
+		   "  too_deep  too_shallow\n");
+	for (i = 0; i < IDLE_MODE_NR; i++) {
+		const struct idle_mode_info *m = &idle_modes[i];
+		struct idle_mode_stats *stats = &idle_predictor.stats[i];
+
+		seq_printf(s, "%-5s %5u %5u %10u %6lu %8llu %9lu %12lu\n",
+			   m->name, m->entry_latency, m->exit_latency,
+			   m->target_residency, stats->usage, stats->time_us,
+			   stats->too_deep, stats->too_shallow);
+	}
+
+	seq_printf(s, "demoted_latency %lu\n", idle_predictor.demoted_latency);
+	seq_printf(s, "next_timer_us %u\npredicted_us %u\n",
+		   idle_predictor.next_timer_us, idle_predictor.predicted_us);
+	seq_printf(s, "correction");
+	for (i = 0; i < PREDICT_BUCKETS; i++)
+		seq_printf(s, " %u", idle_predictor.correction_factor[i]);
+	seq_printf(s, "\n");
+
+	return 0;
 }
 
+static int idle_predictor_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, idle_predictor_show, inode->i_private);
+}
+
+static const struct file_operations idle_predictor_fops = {
+	.open		= idle_predictor_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int s5pv310_init_cpuidle(void)
 {
 	int i, max_cpuidle_state, cpu_id, ret;
@@ -1464,6 +1749,8 @@ static int s5pv310_init_cpuidle(void)
 #ifndef CONFIG_USE_EXT_GIC
 	ext_gic_init();
 #endif
+	debugfs_create_file("s5pv310_idle", S_IRUGO, NULL, NULL,
+			    &idle_predictor_fops);
 	return 0;
 
 err_alloc:
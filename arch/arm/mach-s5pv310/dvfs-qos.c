@@ -0,0 +1,297 @@
+/* linux/arch/arm/mach-s5pv310/dvfs-qos.c
+ *
+ * Copyright (c) 2010 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * S5PV310 - DVFS constraint aggregator
+ *
+ * Collects cpu/bus frequency floors and ceilings from drivers. Requests
+ * are kept on priority sorted lists so the effective constraint of a
+ * class is always the head or the tail of its list, and adding, updating
+ * or dropping a request never rescans the other holders.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/spinlock.h>
+#include <linux/plist.h>
+#include <linux/timer.h>
+#include <linux/jiffies.h>
+#include <linux/workqueue.h>
+#include <linux/notifier.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include <mach/dvfs-qos.h>
+
+enum dvfs_qos_type {
+	DVFS_QOS_MIN,	/* lowest requested level wins */
+	DVFS_QOS_MAX,	/* highest requested level wins */
+};
+
+struct dvfs_qos_object {
+	struct plist_head requests;
+	struct blocking_notifier_head notifiers;
+	struct work_struct notify_work;
+	enum dvfs_qos_type type;
+	int default_value;
+	int target_value;
+	const char *name;
+};
+
+static DEFINE_SPINLOCK(dvfs_qos_lock);
+
+static struct dvfs_qos_object dvfs_qos_array[DVFS_QOS_NUM_CLASSES] = {
+	[DVFS_QOS_CPU_FLOOR] = {
+		.type = DVFS_QOS_MIN,
+		.name = "cpu_floor",
+	},
+	[DVFS_QOS_CPU_CEILING] = {
+		.type = DVFS_QOS_MAX,
+		.name = "cpu_ceiling",
+	},
+	[DVFS_QOS_BUS_FLOOR] = {
+		.type = DVFS_QOS_MIN,
+		.name = "bus_floor",
+	},
+};
+
+/* called with dvfs_qos_lock held */
+static int dvfs_qos_aggregate(struct dvfs_qos_object *qos)
+{
+	struct plist_node *node;
+
+	if (plist_head_empty(&qos->requests))
+		return qos->default_value;
+
+	if (qos->type == DVFS_QOS_MIN)
+		node = plist_first(&qos->requests);
+	else
+		node = list_entry(qos->requests.node_list.prev,
+				  struct plist_node, plist.node_list);
+
+	return node->prio;
+}
+
+/* called with dvfs_qos_lock held */
+static void dvfs_qos_update_target(struct dvfs_qos_object *qos)
+{
+	int value = dvfs_qos_aggregate(qos);
+
+	if (value == qos->target_value)
+		return;
+
+	qos->target_value = value;
+	schedule_work(&qos->notify_work);
+}
+
+static void dvfs_qos_notify_work(struct work_struct *work)
+{
+	struct dvfs_qos_object *qos =
+		container_of(work, struct dvfs_qos_object, notify_work);
+
+	blocking_notifier_call_chain(&qos->notifiers,
+				     (unsigned long)ACCESS_ONCE(qos->target_value),
+				     NULL);
+}
+
+/* called with dvfs_qos_lock held */
+static void __dvfs_qos_remove(struct dvfs_qos_request *req)
+{
+	struct dvfs_qos_object *qos = &dvfs_qos_array[req->qos_class];
+
+	if (!req->active)
+		return;
+
+	plist_del(&req->node, &qos->requests);
+	req->active = false;
+	dvfs_qos_update_target(qos);
+}
+
+static void dvfs_qos_timeout(unsigned long data)
+{
+	struct dvfs_qos_request *req = (struct dvfs_qos_request *)data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&dvfs_qos_lock, flags);
+	/*
+	 * The request may have been updated without a timeout, or given a
+	 * new one, while this was waiting for the lock.
+	 */
+	if (req->timed && !timer_pending(&req->timer)) {
+		req->timed = false;
+		__dvfs_qos_remove(req);
+	}
+	spin_unlock_irqrestore(&dvfs_qos_lock, flags);
+}
+
+void dvfs_qos_init_request(struct dvfs_qos_request *req,
+			   enum dvfs_qos_class qos_class, const char *name)
+{
+	plist_node_init(&req->node, 0);
+	setup_timer(&req->timer, dvfs_qos_timeout, (unsigned long)req);
+	req->qos_class = qos_class;
+	req->name = name;
+	req->active = false;
+	req->timed = false;
+}
+
+/* called with dvfs_qos_lock held */
+static void __dvfs_qos_update(struct dvfs_qos_request *req, int level)
+{
+	struct dvfs_qos_object *qos = &dvfs_qos_array[req->qos_class];
+
+	if (req->active) {
+		if (req->node.prio == level)
+			return;
+		plist_del(&req->node, &qos->requests);
+	} else {
+		req->since = jiffies;
+	}
+
+	plist_node_init(&req->node, level);
+	plist_add(&req->node, &qos->requests);
+	req->active = true;
+	dvfs_qos_update_target(qos);
+}
+
+void dvfs_qos_update_request(struct dvfs_qos_request *req, int level)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dvfs_qos_lock, flags);
+	del_timer(&req->timer);
+	req->timed = false;
+	__dvfs_qos_update(req, level);
+	spin_unlock_irqrestore(&dvfs_qos_lock, flags);
+}
+
+void dvfs_qos_update_request_timeout(struct dvfs_qos_request *req,
+				     int level, unsigned int timeout_ms)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dvfs_qos_lock, flags);
+	__dvfs_qos_update(req, level);
+	req->timed = true;
+	mod_timer(&req->timer, jiffies + msecs_to_jiffies(timeout_ms));
+	spin_unlock_irqrestore(&dvfs_qos_lock, flags);
+}
+
+void dvfs_qos_remove_request(struct dvfs_qos_request *req)
+{
+	unsigned long flags;
+
+	/* the caller may free the request once this returns */
+	del_timer_sync(&req->timer);
+
+	spin_lock_irqsave(&dvfs_qos_lock, flags);
+	req->timed = false;
+	__dvfs_qos_remove(req);
+	spin_unlock_irqrestore(&dvfs_qos_lock, flags);
+}
+
+void dvfs_qos_set_default(enum dvfs_qos_class qos_class, int level)
+{
+	struct dvfs_qos_object *qos = &dvfs_qos_array[qos_class];
+	unsigned long flags;
+
+	spin_lock_irqsave(&dvfs_qos_lock, flags);
+	qos->default_value = level;
+	dvfs_qos_update_target(qos);
+	spin_unlock_irqrestore(&dvfs_qos_lock, flags);
+}
+
+int dvfs_qos_value(enum dvfs_qos_class qos_class)
+{
+	return ACCESS_ONCE(dvfs_qos_array[qos_class].target_value);
+}
+
+int dvfs_qos_add_notifier(enum dvfs_qos_class qos_class,
+			  struct notifier_block *nb)
+{
+	return blocking_notifier_chain_register(
+			&dvfs_qos_array[qos_class].notifiers, nb);
+}
+
+int dvfs_qos_remove_notifier(enum dvfs_qos_class qos_class,
+			     struct notifier_block *nb)
+{
+	return blocking_notifier_chain_unregister(
+			&dvfs_qos_array[qos_class].notifiers, nb);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int dvfs_qos_debug_show(struct seq_file *s, void *unused)
+{
+	struct dvfs_qos_request *req;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&dvfs_qos_lock, flags);
+	for (i = 0; i < DVFS_QOS_NUM_CLASSES; i++) {
+		struct dvfs_qos_object *qos = &dvfs_qos_array[i];
+
+		seq_printf(s, "%s: level %d (default %d)\n", qos->name,
+			   qos->target_value, qos->default_value);
+
+		plist_for_each_entry(req, &qos->requests, node) {
+			seq_printf(s, "  %-12s level %d held %u ms",
+				   req->name ? req->name : "?",
+				   req->node.prio,
+				   jiffies_to_msecs(jiffies - req->since));
+			if (timer_pending(&req->timer))
+				seq_printf(s, " expires in %u ms",
+					   jiffies_to_msecs(req->timer.expires -
+							    jiffies));
+			seq_printf(s, "\n");
+		}
+	}
+	spin_unlock_irqrestore(&dvfs_qos_lock, flags);
+
+	return 0;
+}
+
+static int dvfs_qos_debug_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dvfs_qos_debug_show, inode->i_private);
+}
+
+static const struct file_operations dvfs_qos_debug_fops = {
+	.open		= dvfs_qos_debug_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
+static int __init dvfs_qos_init(void)
+{
+	int i;
+
+	for (i = 0; i < DVFS_QOS_NUM_CLASSES; i++) {
+		struct dvfs_qos_object *qos = &dvfs_qos_array[i];
+
+		plist_head_init(&qos->requests, &dvfs_qos_lock);
+		BLOCKING_INIT_NOTIFIER_HEAD(&qos->notifiers);
+		INIT_WORK(&qos->notify_work, dvfs_qos_notify_work);
+		qos->target_value = qos->default_value;
+	}
+
+	return 0;
+}
+core_initcall(dvfs_qos_init);
+
+#ifdef CONFIG_DEBUG_FS
+static int __init dvfs_qos_debug_init(void)
+{
+	debugfs_create_file("dvfs_qos", S_IRUGO, NULL, NULL,
+			    &dvfs_qos_debug_fops);
+	return 0;
+}
+late_initcall(dvfs_qos_debug_init);
+#endif
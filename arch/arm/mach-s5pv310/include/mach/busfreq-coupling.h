@@ -0,0 +1,42 @@
+/* linux/arch/arm/mach-s5pv310/include/mach/busfreq-coupling.h
+ *
+ * Copyright (c) 2010 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * S5PV310 - CPU/bus DVFS coupling
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#ifndef __ASM_ARCH_BUSFREQ_COUPLING_H
+#define __ASM_ARCH_BUSFREQ_COUPLING_H __FILE__
+
+struct device;
+
+struct busfreq_coupling_ops {
+	/* bus levels, LV_0 (fastest) to nr_levels - 1 */
+	unsigned int nr_levels;
+	/* memory clock of a bus level in kHz, for the statistics */
+	unsigned int (*mem_clk)(unsigned int level);
+	/* bring the bus up to at least @level without waiting for a sample */
+	void (*raise)(unsigned int level);
+};
+
+#ifdef CONFIG_S5PV310_BUSFREQ
+extern int busfreq_coupling_init(struct device *dev,
+				 const struct busfreq_coupling_ops *ops);
+extern unsigned int busfreq_coupling_floor(unsigned int level);
+extern void busfreq_coupling_stall(unsigned int stall);
+extern void busfreq_coupling_account(unsigned int level);
+#else
+static inline unsigned int busfreq_coupling_floor(unsigned int level)
+{
+	return level;
+}
+static inline void busfreq_coupling_stall(unsigned int stall) { }
+static inline void busfreq_coupling_account(unsigned int level) { }
+#endif
+
+#endif /* __ASM_ARCH_BUSFREQ_COUPLING_H */
@@ -84,13 +84,13 @@ void s5pv310_cpufreq_upper_limit_free(unsigned int nId);
 
 #else
 
-static inline int s5pv310_cpufreq_lock(unsigned int nId, enum cpufreq_level_request cpufreq_level) {}
+static inline int s5pv310_cpufreq_lock(unsigned int nId, enum cpufreq_level_request cpufreq_level) { return 0; }
 static inline void s5pv310_cpufreq_lock_free(unsigned int nId) {}
 
-static inline int s5pv310_busfreq_lock(unsigned int nId, enum busfreq_level_request busfreq_level) {}
+static inline int s5pv310_busfreq_lock(unsigned int nId, enum busfreq_level_request busfreq_level) { return 0; }
 static inline void s5pv310_busfreq_lock_free(unsigned int nId) {}
 
-static inline int s5pv310_cpufreq_upper_limit(unsigned int nId, enum cpufreq_level_request cpufreq_level) {}
+static inline int s5pv310_cpufreq_upper_limit(unsigned int nId, enum cpufreq_level_request cpufreq_level) { return 0; }
 static inline void s5pv310_cpufreq_upper_limit_free(unsigned int nId) {}
 
 #endif
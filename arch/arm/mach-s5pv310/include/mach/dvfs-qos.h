@@ -0,0 +1,89 @@
+/* linux/arch/arm/mach-s5pv310/include/mach/dvfs-qos.h
+ *
+ * Copyright (c) 2010 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com
+ *
+ * S5PV310 - DVFS constraint aggregator
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+#ifndef __MACH_DVFS_QOS_H
+#define __MACH_DVFS_QOS_H
+
+#include <linux/plist.h>
+#include <linux/timer.h>
+#include <linux/notifier.h>
+
+/*
+ * Constraint classes. Values are DVFS level indexes, so a lower value
+ * always means a faster clock:
+ *  - DVFS_QOS_CPU_FLOOR / DVFS_QOS_BUS_FLOOR aggregate to the lowest
+ *    requested level (the fastest floor wins).
+ *  - DVFS_QOS_CPU_CEILING aggregates to the highest requested level
+ *    (the slowest ceiling wins).
+ */
+enum dvfs_qos_class {
+	DVFS_QOS_CPU_FLOOR,
+	DVFS_QOS_CPU_CEILING,
+	DVFS_QOS_BUS_FLOOR,
+	DVFS_QOS_NUM_CLASSES,
+};
+
+struct dvfs_qos_request {
+	struct plist_node node;
+	struct timer_list timer;
+	enum dvfs_qos_class qos_class;
+	const char *name;
+	unsigned long since;
+	bool active;
+	bool timed;		/* the timer drops the request */
+};
+
+#ifdef CONFIG_CPU_FREQ
+
+/*
+ * All request calls are safe from atomic context, except that
+ * dvfs_qos_remove_request() waits for a running timeout and so must not
+ * be called from hard irq context. A change of the aggregated value is
+ * reported to the class notifiers from process context.
+ */
+void dvfs_qos_init_request(struct dvfs_qos_request *req,
+			   enum dvfs_qos_class qos_class, const char *name);
+void dvfs_qos_update_request(struct dvfs_qos_request *req, int level);
+void dvfs_qos_update_request_timeout(struct dvfs_qos_request *req,
+				     int level, unsigned int timeout_ms);
+void dvfs_qos_remove_request(struct dvfs_qos_request *req);
+
+void dvfs_qos_set_default(enum dvfs_qos_class qos_class, int level);
+int dvfs_qos_value(enum dvfs_qos_class qos_class);
+
+int dvfs_qos_add_notifier(enum dvfs_qos_class qos_class,
+			  struct notifier_block *nb);
+int dvfs_qos_remove_notifier(enum dvfs_qos_class qos_class,
+			     struct notifier_block *nb);
+
+#else
+
+static inline void dvfs_qos_init_request(struct dvfs_qos_request *req,
+		enum dvfs_qos_class qos_class, const char *name) {}
+static inline void dvfs_qos_update_request(struct dvfs_qos_request *req,
+		int level) {}
+static inline void dvfs_qos_update_request_timeout(struct dvfs_qos_request *req,
+		int level, unsigned int timeout_ms) {}
+static inline void dvfs_qos_remove_request(struct dvfs_qos_request *req) {}
+
+static inline void dvfs_qos_set_default(enum dvfs_qos_class qos_class,
+		int level) {}
+static inline int dvfs_qos_value(enum dvfs_qos_class qos_class) { return 0; }
+
+static inline int dvfs_qos_add_notifier(enum dvfs_qos_class qos_class,
+		struct notifier_block *nb) { return 0; }
+static inline int dvfs_qos_remove_notifier(enum dvfs_qos_class qos_class,
+		struct notifier_block *nb) { return 0; }
+
+#endif
+
+#endif /* __MACH_DVFS_QOS_H */
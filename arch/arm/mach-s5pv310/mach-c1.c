@@ -4618,6 +4618,7 @@ static void __init s5pv310_reserve(void)
 #ifdef CONFIG_VIDEO_SAMSUNG_MEMSIZE_MFC
 		{
 			.name = "mfc",
+			.movable = 1,
 			.size = CONFIG_VIDEO_SAMSUNG_MEMSIZE_MFC * SZ_1K,
 			.start = 0
 		},
@@ -4625,6 +4626,7 @@ static void __init s5pv310_reserve(void)
 #ifdef CONFIG_VIDEO_SAMSUNG_MEMSIZE_MFC0
 		{
 			.name = "mfc0",
+			.movable = 1,
 			.size = CONFIG_VIDEO_SAMSUNG_MEMSIZE_MFC0 * SZ_1K,
 			{
 				.alignment = 1 << 17,
@@ -4635,6 +4637,7 @@ static void __init s5pv310_reserve(void)
 #ifdef CONFIG_VIDEO_SAMSUNG_MEMSIZE_MFC1
 		{
 			.name = "mfc1",
+			.movable = 1,
 			.size = CONFIG_VIDEO_SAMSUNG_MEMSIZE_MFC1 * SZ_1K,
 			{
 				.alignment = 1 << 17,
@@ -4645,6 +4648,7 @@ static void __init s5pv310_reserve(void)
 #ifdef CONFIG_VIDEO_SAMSUNG_MEMSIZE_FIMC0
 		{
 			.name = "fimc0",
+			.movable = 1,
 			.size = CONFIG_VIDEO_SAMSUNG_MEMSIZE_FIMC0 * SZ_1K,
 			.start = 0
 		},
@@ -4652,6 +4656,7 @@ static void __init s5pv310_reserve(void)
 #ifdef CONFIG_VIDEO_SAMSUNG_MEMSIZE_FIMC1
 		{
 			.name = "fimc1",
+			.movable = 1,
 			.size = CONFIG_VIDEO_SAMSUNG_MEMSIZE_FIMC1 * SZ_1K,
 			.start = 0
 		},
@@ -4659,6 +4664,7 @@ static void __init s5pv310_reserve(void)
 #ifdef CONFIG_VIDEO_SAMSUNG_MEMSIZE_FIMC2
 		{
 			.name = "fimc2",
+			.movable = 1,
 			.size = CONFIG_VIDEO_SAMSUNG_MEMSIZE_FIMC2 * SZ_1K,
 			.start = 0
 		},
@@ -4666,6 +4672,7 @@ static void __init s5pv310_reserve(void)
 #ifdef CONFIG_VIDEO_SAMSUNG_MEMSIZE_FIMC3
 		{
 			.name = "fimc3",
+			.movable = 1,
 			.size = CONFIG_VIDEO_SAMSUNG_MEMSIZE_FIMC3 * SZ_1K,
 			.start = 0
 		},
@@ -4680,6 +4687,7 @@ static void __init s5pv310_reserve(void)
 #ifdef CONFIG_VIDEO_SAMSUNG_MEMSIZE_JPEG
 		{
 			.name = "jpeg",
+			.movable = 1,
 			.size = CONFIG_VIDEO_SAMSUNG_MEMSIZE_JPEG * SZ_1K,
 			.start = 0
 		},
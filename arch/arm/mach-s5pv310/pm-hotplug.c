@@ -19,6 +19,7 @@
 #include <linux/io.h>
 #include <linux/platform_device.h>
 #include <linux/cpu.h>
+#include <linux/cpufreq.h>
 #include <linux/percpu.h>
 #include <linux/ktime.h>
 #include <linux/tick.h>
@@ -27,6 +28,8 @@
 #include <linux/suspend.h>
 #include <linux/reboot.h>
 #include <linux/earlysuspend.h>
+#include <linux/jiffies.h>
+#include <linux/sysfs.h>
 
 #include <plat/map-base.h>
 #include <plat/gpio-cfg.h>
@@ -35,9 +38,21 @@
 #include <mach/regs-irq.h>
 #include <linux/gpio.h>
 
-#define CPUMON 0
+/*
+ * CPU1 is brought up when the averaged number of runnable threads says a
+ * second core would actually have something to run, and taken down again
+ * once the demand has stayed low for a while.  Both edges need the
+ * condition to hold for a minimum residency, and CPU1 is kept online for
+ * at least min_online_ms after every plug-in to avoid ping-ponging.
+ */
+#define SAMPLE_RATE_MS		20
+#define NR_RUN_UP		150	/* 1.5 runnable threads (x100) */
+#define NR_RUN_DOWN		100	/* 1.0 runnable thread (x100) */
+#define UP_RESIDENCY_MS		60
+#define DOWN_RESIDENCY_MS	300
+#define MIN_ONLINE_MS		500
+#define NR_RUN_AVG_SHIFT	2	/* ewma weight of 1/4 per sample */
 
-#define CHECK_DELAY	(.5*HZ)
 #define TRANS_LOAD_L	20
 #define TRANS_LOAD_H	50
 #define TRANS_LOAD_L_SCREEN_OFF 35
@@ -50,30 +65,102 @@ static struct workqueue_struct *hotplug_wq;
 
 static struct delayed_work hotplug_work;
 
-static unsigned int hotpluging_rate = CHECK_DELAY;
-module_param_named(rate, hotpluging_rate, uint, 0644);
+static unsigned int sample_rate_ms = SAMPLE_RATE_MS;
+module_param_named(rate, sample_rate_ms, uint, 0644);
 static unsigned int user_lock;
 module_param_named(lock, user_lock, uint, 0644);
 static unsigned int trans_load_l = TRANS_LOAD_L;
 module_param_named(loadl, trans_load_l, uint, 0644);
 static unsigned int trans_load_h = TRANS_LOAD_H;
 module_param_named(loadh, trans_load_h, uint, 0644);
+static unsigned int nr_run_up = NR_RUN_UP;
+module_param_named(nr_run_up, nr_run_up, uint, 0644);
+static unsigned int nr_run_down = NR_RUN_DOWN;
+module_param_named(nr_run_down, nr_run_down, uint, 0644);
+static unsigned int up_residency_ms = UP_RESIDENCY_MS;
+module_param_named(up_residency, up_residency_ms, uint, 0644);
+static unsigned int down_residency_ms = DOWN_RESIDENCY_MS;
+module_param_named(down_residency, down_residency_ms, uint, 0644);
+static unsigned int min_online_ms = MIN_ONLINE_MS;
+module_param_named(min_online, min_online_ms, uint, 0644);
 
 struct cpu_time_info {
 	cputime64_t prev_cpu_idle;
 	cputime64_t prev_cpu_wall;
 	unsigned int load;
+	unsigned int avg_nr_run;	/* x100, ewma */
 };
 
 static DEFINE_PER_CPU(struct cpu_time_info, hotplug_cpu_time);
 
+/* decision statistics, exported through sysfs */
+struct hotplug_stats {
+	unsigned long samples;
+	unsigned long idle_skipped;
+	unsigned long up_count;
+	unsigned long down_count;
+	unsigned long up_vetoed_load;
+	unsigned long down_vetoed_sched;
+	unsigned long down_vetoed_online;
+	unsigned int avg_nr_run;
+	unsigned int avg_load;
+	u64 online_time_ms;
+};
+
+static struct hotplug_stats hotplug_stats;
+
+static unsigned long up_pending_since;
+static unsigned long down_pending_since;
+static unsigned long cpu1_online_since;
+
 /* mutex can be used since hotplug_timer does not run in
    timer(softirq) context but in process context */
 static DEFINE_MUTEX(hotplug_lock);
 
+/*
+ * Only CPU1 is ever taken down, so small tasks are best packed on CPU0
+ * (see POWER_PACKING in kernel/sched_features.h).
+ */
+int arch_sched_pack_cpu(void)
+{
+	return 0;
+}
+
+static inline unsigned long hotplug_sample_delay(void)
+{
+	unsigned long delay = msecs_to_jiffies(sample_rate_ms);
+
+	return delay ? delay : 1;
+}
+
+static void hotplug_cpu1_up(void)
+{
+	cpu_up(1);
+	if (!cpu_online(1))
+		return;
+
+	hotplug_stats.up_count++;
+	cpu1_online_since = jiffies;
+}
+
+static void hotplug_cpu1_down(void)
+{
+	cpu_down(1);
+	if (cpu_online(1))
+		return;
+
+	per_cpu(hotplug_cpu_time, 1).avg_nr_run = 0;
+	hotplug_stats.down_count++;
+	hotplug_stats.online_time_ms +=
+		jiffies_to_msecs(jiffies - cpu1_online_since);
+}
+
 static void hotplug_timer(struct work_struct *work)
 {
-	unsigned int i, avg_load = 0, load = 0;
+	unsigned int i, avg_load = 0, load = 0, nr_run = 0;
+	unsigned long now = jiffies;
+	int want_up, want_down;
+	bool idle = true;
 
 	mutex_lock(&hotplug_lock);
 
@@ -84,6 +171,7 @@ static void hotplug_timer(struct work_struct *work)
 		struct cpu_time_info *tmp_info;
 		cputime64_t cur_wall_time, cur_idle_time;
 		unsigned int idle_time, wall_time;
+		unsigned int cur_nr_run;
 
 		tmp_info = &per_cpu(hotplug_cpu_time, i);
 
@@ -97,36 +185,100 @@ static void hotplug_timer(struct work_struct *work)
 							tmp_info->prev_cpu_wall);
 		tmp_info->prev_cpu_wall = cur_wall_time;
 
-		if (wall_time < idle_time)
+		if (wall_time < idle_time || !wall_time)
 			goto no_hotplug;
 
+		if (!cpufreq_window_idle(wall_time, idle_time))
+			idle = false;
+
 		tmp_info->load = 100 * (wall_time - idle_time) / wall_time;
 
 		load += tmp_info->load;
+
+		/* do not count ourselves on the sampling cpu */
+		cur_nr_run = nr_running_cpu(i);
+		if (i == raw_smp_processor_id() && cur_nr_run)
+			cur_nr_run--;
+
+		tmp_info->avg_nr_run += (int)(cur_nr_run * 100 -
+					      tmp_info->avg_nr_run) >>
+					NR_RUN_AVG_SHIFT;
+		nr_run += tmp_info->avg_nr_run;
 	}
 
 	avg_load = load / num_online_cpus();
 
-	if (avg_load < trans_load_l && cpu_online(1)) {
-		printk("cpu1 turning off!\n");
-		cpu_down(1);
-#if CPUMON
-		printk(KERN_ERR "CPUMON D %d\n", avg_load);
-#endif
-		printk("cpu1 off end!\n");
-		hotpluging_rate = CHECK_DELAY;
-	} else if (avg_load > trans_load_h && !cpu_online(1)) {
-		printk("cpu1 turning on!\n");
-		cpu_up(1);
-#if CPUMON
-		printk(KERN_ERR "CPUMON U %d\n", avg_load);
-#endif
-		printk("cpu1 on end!\n");
-		hotpluging_rate = CHECK_DELAY * 4;
+	/*
+	 * cpu0 alone and it did nothing but idle: there is no demand to
+	 * bring cpu1 up for, and the averages were decayed above.
+	 */
+	if (idle && !cpu_online(1)) {
+		cpufreq_sample_account(CPUFREQ_SAMPLER_HOTPLUG, true, true);
+		hotplug_stats.idle_skipped++;
+		up_pending_since = 0;
+		goto no_hotplug;
 	}
+	cpufreq_sample_account(CPUFREQ_SAMPLER_HOTPLUG, idle, false);
+
+	hotplug_stats.samples++;
+	hotplug_stats.avg_load = avg_load;
+	hotplug_stats.avg_nr_run = nr_run;
+
+	if (!cpu_online(1)) {
+		down_pending_since = 0;
+		want_up = nr_run >= nr_run_up;
+		if (want_up && avg_load <= trans_load_h) {
+			hotplug_stats.up_vetoed_load++;
+			want_up = 0;
+		}
+		if (!want_up) {
+			up_pending_since = 0;
+			goto no_hotplug;
+		}
+		if (!up_pending_since)
+			up_pending_since = now;
+		if (time_before(now, up_pending_since +
+				msecs_to_jiffies(up_residency_ms)))
+			goto no_hotplug;
+
+		up_pending_since = 0;
+		hotplug_cpu1_up();
+	} else {
+		up_pending_since = 0;
+		want_down = nr_run <= nr_run_down || avg_load < trans_load_l;
+		if (!want_down) {
+			down_pending_since = 0;
+			goto no_hotplug;
+		}
+		if (!down_pending_since)
+			down_pending_since = now;
+		if (time_before(now, down_pending_since +
+				msecs_to_jiffies(down_residency_ms)))
+			goto no_hotplug;
+		if (time_before(now, cpu1_online_since +
+				msecs_to_jiffies(min_online_ms))) {
+			hotplug_stats.down_vetoed_online++;
+			goto no_hotplug;
+		}
+		/*
+		 * The scheduler monitor asks us to keep cpu1 while it still
+		 * pulls tasks over or runs rt work there.  A cpu0 idle hint,
+		 * raised when cpu0 went idle outside of load balancing,
+		 * overrides a stale lock.
+		 */
+		if (sched_hotplug_locked() && !sched_hotplug_forced()) {
+			hotplug_stats.down_vetoed_sched++;
+			goto no_hotplug;
+		}
+
+		down_pending_since = 0;
+		hotplug_cpu1_down();
+	}
+
  no_hotplug:
 
-	queue_delayed_work_on(0, hotplug_wq, &hotplug_work, hotpluging_rate);
+	queue_delayed_work_on(0, hotplug_wq, &hotplug_work,
+			      hotplug_sample_delay());
 
 	mutex_unlock(&hotplug_lock);
 }
@@ -191,8 +343,11 @@ static void hotplug_late_resume(struct early_suspend *handler)
 	mutex_lock(&hotplug_lock);
 	trans_load_l = TRANS_LOAD_L;
 	trans_load_h = TRANS_LOAD_H;
-	cpu_up(1); //when the screen is on, activate the second cpu no matter what the load is
-	queue_delayed_work_on(0, hotplug_wq, &hotplug_work, hotpluging_rate);
+	/* when the screen is on, activate the second cpu no matter what the load is */
+	if (!cpu_online(1))
+		hotplug_cpu1_up();
+	queue_delayed_work_on(0, hotplug_wq, &hotplug_work,
+			      hotplug_sample_delay());
 	mutex_unlock(&hotplug_lock);
 }
 
@@ -213,6 +368,8 @@ static int __init s5pv310_pm_hotplug_init(void)
 
 	INIT_DELAYED_WORK_DEFERRABLE(&hotplug_work, hotplug_timer);
 
+	cpu1_online_since = jiffies;
+
 	queue_delayed_work_on(0, hotplug_wq, &hotplug_work, 60 * HZ);
 
 	register_pm_notifier(&s5pv310_pm_hotplug_notifier);
@@ -229,6 +386,58 @@ static struct platform_device s5pv310_pm_hotplug_device = {
 	.id = -1,
 };
 
+#define show_one(name, fmt)						\
+static ssize_t show_##name(struct device *dev,				\
+			   struct device_attribute *attr, char *buf)	\
+{									\
+	return sprintf(buf, fmt "\n", hotplug_stats.name);		\
+}									\
+static DEVICE_ATTR(name, 0444, show_##name, NULL)
+
+show_one(samples, "%lu");
+show_one(idle_skipped, "%lu");
+show_one(up_count, "%lu");
+show_one(down_count, "%lu");
+show_one(up_vetoed_load, "%lu");
+show_one(down_vetoed_sched, "%lu");
+show_one(down_vetoed_online, "%lu");
+show_one(avg_nr_run, "%u");
+show_one(avg_load, "%u");
+
+static ssize_t show_online_time_ms(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	u64 total;
+
+	mutex_lock(&hotplug_lock);
+	total = hotplug_stats.online_time_ms;
+	if (cpu_online(1))
+		total += jiffies_to_msecs(jiffies - cpu1_online_since);
+	mutex_unlock(&hotplug_lock);
+
+	return sprintf(buf, "%llu\n", total);
+}
+static DEVICE_ATTR(online_time_ms, 0444, show_online_time_ms, NULL);
+
+static struct attribute *hotplug_stats_attributes[] = {
+	&dev_attr_samples.attr,
+	&dev_attr_idle_skipped.attr,
+	&dev_attr_up_count.attr,
+	&dev_attr_down_count.attr,
+	&dev_attr_up_vetoed_load.attr,
+	&dev_attr_down_vetoed_sched.attr,
+	&dev_attr_down_vetoed_online.attr,
+	&dev_attr_avg_nr_run.attr,
+	&dev_attr_avg_load.attr,
+	&dev_attr_online_time_ms.attr,
+	NULL
+};
+
+static struct attribute_group hotplug_stats_attr_group = {
+	.name = "stats",
+	.attrs = hotplug_stats_attributes,
+};
+
 static int __init s5pv310_pm_hotplug_device_init(void)
 {
 	int ret;
@@ -240,6 +449,12 @@ static int __init s5pv310_pm_hotplug_device_init(void)
 		return ret;
 	}
 
+	ret = sysfs_create_group(&s5pv310_pm_hotplug_device.dev.kobj,
+				 &hotplug_stats_attr_group);
+	if (ret)
+		printk(KERN_ERR "pm-hotplug: failed to create stats (%d)\n",
+		       ret);
+
 	printk(KERN_INFO "s5pv310_pm_hotplug_device_init: %d\n", ret);
 
 	return ret;
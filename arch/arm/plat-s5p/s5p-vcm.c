@@ -11,6 +11,13 @@
 #include <linux/err.h>
 #include <linux/bitops.h>
 #include <linux/genalloc.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/timer.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/sysmmu.h>
 
 #define PG_FLAG_MASK 0x3
 #define PG_LV1_SECTION_FLAG 0x2
@@ -45,22 +52,82 @@
 #define LV2OFF_FROM_VADDR(addr) ((addr & 0xFF000) >> SPAGESHIFT)
 #define LV2OFF_FROM_VADDR_LPAGE(addr) ((addr & 0xF0000) >> SPAGESHIFT)
 
+/* a large page takes 16 consecutive 2nd level entries */
+#define LPAGE_ENTRIES (1 << (LPAGESHIFT - SPAGESHIFT))
+
+enum {
+	S5P_VCM_SECTION,
+	S5P_VCM_LPAGE,
+	S5P_VCM_SPAGE,
+	S5P_VCM_PGSIZES
+};
+
 /* slab cache for 2nd level page tables */
 static struct kmem_cache *l2pgtbl_cachep;
 
 /* function pointer to vcm_mmu_activate() defined in mm/vcm.c */
 static int (*vcm_mmu_activate)(struct vcm *vcm);
+/* and to vcm_mmu_res(), vcm_mmu_unreserve() and vcm_mmu_cleanup() */
+static struct vcm_res *(*vcm_mmu_res)(struct vcm *vcm, resource_size_t size,
+					unsigned flags);
+static void (*vcm_mmu_unreserve)(struct vcm_res *res);
+static void (*vcm_mmu_cleanup)(struct vcm *vcm);
+
+/*
+ * TLB invalidation is lazy: unbinding a reservation only clears its
+ * entries and marks the TLB stale, and unreserving it queues its address
+ * range instead of giving it back. Queued ranges are given back after
+ * the TLB is invalidated, when the queue fills up, S5P_VCM_FLUSH_DELAY
+ * after the first unbinding, or when a reservation finds no room, so a
+ * stale TLB entry never translates an address reused for something else.
+ * Binding a reservation while the TLB is stale invalidates it right
+ * away, as its address may have been bound to other memory until then.
+ */
+#define S5P_VCM_FLUSH_QUEUE 32
+#define S5P_VCM_FLUSH_DELAY (HZ / 100)
 
 struct s5p_vcm_unified {
 	struct s5p_vcm_mmu {
 		struct vcm_mmu mmu;
 		const struct s5p_vcm_driver *driver;
+		enum vcm_dev_id id;
+
+		/* Protects the fields below */
+		spinlock_t fq_lock;
+		/* entries were removed since the TLB was invalidated */
+		bool tlb_stale;
+		unsigned int unmaps;
+		unsigned int fq_count;
+		struct s5p_vcm_fq_entry {
+			dma_addr_t start;
+			resource_size_t size;
+		} fq[S5P_VCM_FLUSH_QUEUE];
+		struct timer_list fq_timer;
+		/* TLB invalidations in the second from rate_start */
+		unsigned long rate_start;
+		unsigned int rate_flushes;
+		unsigned int flushes_per_sec;
 	} *vcms[VCM_DEV_NUM];
 
 	struct gen_pool *pool;
 	unsigned long *pgd;
+
+	/* live entries and all mappings made, by page size */
+	atomic_t mapped[S5P_VCM_PGSIZES];
+	atomic_t total[S5P_VCM_PGSIZES];
 } shared_vcm;
 
+static inline void s5p_vcm_count_map(int pgsize)
+{
+	atomic_inc(&shared_vcm.mapped[pgsize]);
+	atomic_inc(&shared_vcm.total[pgsize]);
+}
+
+static inline void s5p_vcm_count_unmap(int pgsize)
+{
+	atomic_dec(&shared_vcm.mapped[pgsize]);
+}
+
 static inline enum vcm_dev_id find_s5p_vcm_mmu_id(struct vcm *vcm)
 {
 	int i;
@@ -92,6 +159,60 @@ static inline void s5p_mmu_cacheflush_contig(void *vastart, void *vaend)
 				virt_to_phys(vaend));
 }
 
+/* Called with s5p_mmu->fq_lock held */
+static void s5p_vcm_invalidate_locked(struct s5p_vcm_mmu *s5p_mmu)
+{
+	unsigned long elapsed;
+
+	if (!s5p_mmu->tlb_stale)
+		return;
+
+	if (s5p_mmu->driver && s5p_mmu->driver->tlb_invalidator)
+		s5p_mmu->driver->tlb_invalidator(s5p_mmu->id);
+	s5p_mmu->tlb_stale = false;
+
+	elapsed = jiffies - s5p_mmu->rate_start;
+	if (elapsed >= HZ) {
+		s5p_mmu->flushes_per_sec = s5p_mmu->rate_flushes * HZ / elapsed;
+		s5p_mmu->rate_flushes = 0;
+		s5p_mmu->rate_start = jiffies;
+	}
+	s5p_mmu->rate_flushes++;
+}
+
+/* Invalidates the TLB if it is stale and gives the queued ranges back */
+static void s5p_vcm_flush(struct s5p_vcm_mmu *s5p_mmu)
+{
+	struct s5p_vcm_fq_entry fq[S5P_VCM_FLUSH_QUEUE];
+	struct vcm_res res = { .vcm = &s5p_mmu->mmu.vcm };
+	unsigned int count, unmaps, i;
+	unsigned long flags;
+
+	spin_lock_irqsave(&s5p_mmu->fq_lock, flags);
+	s5p_vcm_invalidate_locked(s5p_mmu);
+	unmaps = s5p_mmu->unmaps;
+	s5p_mmu->unmaps = 0;
+	count = s5p_mmu->fq_count;
+	memcpy(fq, s5p_mmu->fq, count * sizeof(*fq));
+	s5p_mmu->fq_count = 0;
+	spin_unlock_irqrestore(&s5p_mmu->fq_lock, flags);
+
+	if (unmaps || count)
+		trace_sysmmu_tlb_flush(s5p_mmu->id, unmaps, count,
+					s5p_mmu->flushes_per_sec);
+
+	for (i = 0; i < count; i++) {
+		res.start = fq[i].start;
+		res.res_size = fq[i].size;
+		vcm_mmu_unreserve(&res);
+	}
+}
+
+static void s5p_vcm_flush_timer(unsigned long data)
+{
+	s5p_vcm_flush((struct s5p_vcm_mmu *)data);
+}
+
 static void s5p_mmu_cleanup(struct vcm *vcm)
 {
 	enum vcm_dev_id id;
@@ -129,6 +250,15 @@ static void s5p_remove_2nd_mapping(unsigned long *base, resource_size_t *vaddr,
 
 	/* This works on both of small pages and large pages */
 	while (wsize) {
+		switch (*entry & PG_FLAG_MASK) {
+		case PG_LV2_LPAGE_FLAG:
+			if (((entry - base) & (LPAGE_ENTRIES - 1)) == 0)
+				s5p_vcm_count_unmap(S5P_VCM_LPAGE);
+			break;
+		case PG_LV2_SPAGE_FLAG:
+			s5p_vcm_count_unmap(S5P_VCM_SPAGE);
+			break;
+		}
 		*entry = 0;
 		wsize -= SPAGESIZE;
 		entry++;
@@ -164,6 +294,7 @@ static void s5p_remove_mapping(unsigned long *pgd, resource_size_t vaddr,
 			BUG_ON(vaddr & SECTIONMASK);
 
 			*first_entry = 0;
+			s5p_vcm_count_unmap(S5P_VCM_SECTION);
 			vsize -= SECTIONSIZE;
 			vaddr += SECTIONSIZE;
 			break;
@@ -183,14 +314,15 @@ static void s5p_remove_mapping(unsigned long *pgd, resource_size_t vaddr,
 	s5p_mmu_cacheflush_contig(flush_start, flush_end);
 }
 
+/* chunk is what is left of *_parts_cur to map, it is updated as well */
 static int s5p_write_2nd_table(unsigned long *base, resource_size_t *vaddr,
-		resource_size_t vend, struct vcm_phys_part **_parts_cur,
+		resource_size_t vend, struct vcm_phys_part *chunk,
+		struct vcm_phys_part **_parts_cur,
 		struct vcm_phys_part *parts_end)
 {
 	unsigned long *entry;
 	unsigned long *flush_start;
 	struct vcm_phys_part *parts_cur = *_parts_cur;
-	struct vcm_phys_part chunk = {0};
 
 	BUG_ON(*vaddr & SPAGEMASK);
 
@@ -212,59 +344,59 @@ static int s5p_write_2nd_table(unsigned long *base, resource_size_t *vaddr,
 	while ((parts_cur != parts_end) && (*vaddr < vend)) {
 		unsigned long update_size;
 
-		if (chunk.size == 0) {
-			chunk.start = parts_cur->start;
-			chunk.size = parts_cur->size;
+		if (chunk->size == 0) {
+			chunk->start = parts_cur->start;
+			chunk->size = parts_cur->size;
 		}
 
 		/* Reports an error if the size of a chunk to map is
 		 * smaller than the smallest page size. */
-		if (chunk.size < SPAGESIZE)
+		if (chunk->size < SPAGESIZE)
 			return -EBADR;
 
 		if ((*entry & PG_FLAG_MASK) != PG_FAULT_FLAG)
 			return -EADDRINUSE;
 
 		if (((*vaddr & LPAGEMASK) == 0)
-				&& ((chunk.start & LPAGEMASK) == 0)
+				&& ((chunk->start & LPAGEMASK) == 0)
 				&& ((vend - *vaddr) >= LPAGESIZE)
-				&& (chunk.size >= LPAGESIZE)) {
+				&& (chunk->size >= LPAGESIZE)) {
 			int i;
 
-			for (i = 0; i < (1 << (LPAGESHIFT - SPAGESHIFT)); i++) {
+			for (i = 0; i < LPAGE_ENTRIES; i++) {
 				if ((*entry & PG_FLAG_MASK) != PG_FAULT_FLAG)
 					return -EADDRINUSE;
-				*entry = chunk.start | PG_LV2_LPAGE_FLAG;
+				*entry = chunk->start | PG_LV2_LPAGE_FLAG;
 				entry++;
 				*vaddr += SPAGESIZE;
 			}
+			s5p_vcm_count_map(S5P_VCM_LPAGE);
 			update_size = LPAGESIZE;
 		} else if (((*vaddr & SPAGEMASK) == 0)
 				&& ((vend - *vaddr) >= SPAGESIZE)
-				&& (chunk.size >= SPAGESIZE)
-				&& ((chunk.start & SPAGEMASK) == 0)) {
-			*entry = chunk.start | PG_LV2_SPAGE_FLAG;
+				&& (chunk->size >= SPAGESIZE)
+				&& ((chunk->start & SPAGEMASK) == 0)) {
+			*entry = chunk->start | PG_LV2_SPAGE_FLAG;
 			entry++;
+			s5p_vcm_count_map(S5P_VCM_SPAGE);
 			update_size = SPAGESIZE;
 			*vaddr += update_size;
 		} else {
 			return -EBADR;
 		}
 
-		chunk.size -= update_size;
-		if (chunk.size == 0)
+		chunk->size -= update_size;
+		if (chunk->size == 0)
 			parts_cur++;
 		else
-			chunk.start += update_size;
+			chunk->start += update_size;
 	}
 
 	*_parts_cur = parts_cur;
 
 	s5p_mmu_cacheflush_contig(flush_start, entry);
 
-	/* Return value here must be positive number including zero */
-	/* Returning larger than 0 means the current chunk isn't exausted. */
-	return (int)(chunk.size >> SPAGESHIFT);
+	return 0;
 }
 
 inline int lv2_pgtable_empty(unsigned long *pte_start)
@@ -351,6 +483,7 @@ section_mapping:
 		do {
 			*first_entry = (chunk.start & ~SECTIONMASK)
 					| PG_LV1_SECTION_FLAG;
+			s5p_vcm_count_map(S5P_VCM_SECTION);
 			first_entry++;
 			chunk.start += SECTIONSIZE;
 			chunk.size -= SECTIONSIZE;
@@ -374,13 +507,11 @@ new_page_mapping:
 		*first_entry = virt_to_phys(second_pgtable) | PG_LV1_PAGE_FLAG;
 
 page_mapping:
-		ret = s5p_write_2nd_table(second_pgtable, &vcur , vend,
-						&parts, parts_end);
+		/* the table carries on from where the sections stopped */
+		ret = s5p_write_2nd_table(second_pgtable, &vcur, vend,
+						&chunk, &parts, parts_end);
 		if (ret < 0)
 			goto fail;
-		/* ret is the adjustment of the current chunk */
-		chunk.size = (resource_size_t)(ret << SPAGESHIFT);
-		chunk.start = parts->start + chunk.size;
 
 		first_entry++;
 	}
@@ -395,11 +526,25 @@ fail:
 
 static int s5p_mmu_activate(struct vcm_res *res, struct vcm_phys *phys)
 {
+	struct s5p_vcm_mmu *s5p_mmu;
+	int ret;
+
 	/* We don't need to check res and phys because vcm_bind() in mm/vcm.c
 	 * already have checked them.
 	 */
-	return s5p_write_mapping(shared_vcm.pgd, res->start, phys->size,
+	ret = s5p_write_mapping(shared_vcm.pgd, res->start, phys->size,
 					phys->parts, phys->count);
+	if (ret < 0)
+		return ret;
+
+	s5p_mmu = find_s5p_vcm_mmu(res->vcm);
+	if (s5p_mmu && s5p_mmu->tlb_stale) {
+		spin_lock(&s5p_mmu->fq_lock);
+		s5p_vcm_invalidate_locked(s5p_mmu);
+		spin_unlock(&s5p_mmu->fq_lock);
+	}
+
+	return ret;
 }
 
 static void s5p_mmu_deactivate(struct vcm_res *res, struct vcm_phys *phys)
@@ -420,8 +565,71 @@ static void s5p_mmu_deactivate(struct vcm_res *res, struct vcm_phys *phys)
 
 	s5p_remove_mapping(shared_vcm.pgd, res->start, res->bound_size);
 
-	if (s5p_mmu->driver && s5p_mmu->driver->tlb_invalidator)
-		s5p_mmu->driver->tlb_invalidator(id);
+	spin_lock(&s5p_mmu->fq_lock);
+	s5p_mmu->tlb_stale = true;
+	s5p_mmu->unmaps++;
+	if (!timer_pending(&s5p_mmu->fq_timer))
+		mod_timer(&s5p_mmu->fq_timer, jiffies + S5P_VCM_FLUSH_DELAY);
+	spin_unlock(&s5p_mmu->fq_lock);
+}
+
+static struct vcm_res *s5p_vcm_mmu_res(struct vcm *vcm, resource_size_t size,
+					unsigned flags)
+{
+	struct s5p_vcm_mmu *s5p_mmu = find_s5p_vcm_mmu(vcm);
+	struct vcm_res *res;
+
+	res = vcm_mmu_res(vcm, size, flags);
+	if (IS_ERR(res) && PTR_ERR(res) == -ENOSPC &&
+			s5p_mmu && s5p_mmu->fq_count) {
+		s5p_vcm_flush(s5p_mmu);
+		res = vcm_mmu_res(vcm, size, flags);
+	}
+
+	return res;
+}
+
+static void s5p_vcm_mmu_unreserve(struct vcm_res *res)
+{
+	struct s5p_vcm_mmu *s5p_mmu = find_s5p_vcm_mmu(res->vcm);
+	unsigned long flags;
+	bool full;
+
+	if (!s5p_mmu) {
+		vcm_mmu_unreserve(res);
+		return;
+	}
+
+	for (;;) {
+		spin_lock_irqsave(&s5p_mmu->fq_lock, flags);
+		full = s5p_mmu->fq_count == S5P_VCM_FLUSH_QUEUE;
+		if (!full) {
+			s5p_mmu->fq[s5p_mmu->fq_count].start = res->start;
+			s5p_mmu->fq[s5p_mmu->fq_count].size = res->res_size;
+			s5p_mmu->fq_count++;
+			if (!timer_pending(&s5p_mmu->fq_timer))
+				mod_timer(&s5p_mmu->fq_timer,
+					  jiffies + S5P_VCM_FLUSH_DELAY);
+		}
+		spin_unlock_irqrestore(&s5p_mmu->fq_lock, flags);
+
+		if (!full)
+			break;
+		s5p_vcm_flush(s5p_mmu);
+	}
+}
+
+static void s5p_vcm_mmu_cleanup(struct vcm *vcm)
+{
+	struct s5p_vcm_mmu *s5p_mmu = find_s5p_vcm_mmu(vcm);
+
+	/* the ranges go back to the pool, which is destroyed next */
+	if (s5p_mmu) {
+		del_timer_sync(&s5p_mmu->fq_timer);
+		s5p_vcm_flush(s5p_mmu);
+	}
+
+	vcm_mmu_cleanup(vcm);
 }
 
 /* This is exactly same as vcm_mmu_activate() in mm/vcm.c. We have to include
@@ -432,6 +640,7 @@ static int s5p_vcm_mmu_activate(struct vcm *vcm)
 {
 	struct s5p_vcm_mmu *s5p_mmu;
 	enum vcm_dev_id id;
+	unsigned long flags;
 	int ret;
 
 	id = find_s5p_vcm_mmu_id(vcm);
@@ -447,14 +656,18 @@ static int s5p_vcm_mmu_activate(struct vcm *vcm)
 	if (ret)
 		return ret;
 
-	if (s5p_mmu->driver) {
-	       if (s5p_mmu->driver->pgd_base_specifier)
-			s5p_mmu->driver->pgd_base_specifier(id,
-					virt_to_phys(shared_vcm.pgd));
+	if (s5p_mmu->driver && s5p_mmu->driver->pgd_base_specifier)
+		s5p_mmu->driver->pgd_base_specifier(id,
+				virt_to_phys(shared_vcm.pgd));
 
-		if (s5p_mmu->driver->tlb_invalidator)
-			s5p_mmu->driver->tlb_invalidator(id);
-	}
+	/*
+	 * The new page table needs a clean TLB; the flush invalidates it
+	 * once and then gives the queued ranges back.
+	 */
+	spin_lock_irqsave(&s5p_mmu->fq_lock, flags);
+	s5p_mmu->tlb_stale = true;
+	spin_unlock_irqrestore(&s5p_mmu->fq_lock, flags);
+	s5p_vcm_flush(s5p_mmu);
 
 	return 0;
 }
@@ -506,6 +719,36 @@ static struct vcm_mmu_driver s5p_vcm_mmu_driver = {
 	.deactivate = &s5p_mmu_deactivate
 };
 
+static int s5p_vcm_mappings_show(struct seq_file *s, void *unused)
+{
+	static const char * const names[S5P_VCM_PGSIZES] = {
+		[S5P_VCM_SECTION] = "1M",
+		[S5P_VCM_LPAGE] = "64K",
+		[S5P_VCM_SPAGE] = "4K",
+	};
+	int i;
+
+	seq_printf(s, "page     mapped      total\n");
+	for (i = 0; i < S5P_VCM_PGSIZES; i++)
+		seq_printf(s, "%-4s %10d %10d\n", names[i],
+				atomic_read(&shared_vcm.mapped[i]),
+				atomic_read(&shared_vcm.total[i]));
+
+	return 0;
+}
+
+static int s5p_vcm_mappings_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, s5p_vcm_mappings_show, NULL);
+}
+
+static const struct file_operations s5p_vcm_mappings_fops = {
+	.open = s5p_vcm_mappings_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int __init s5p_vcm_init(void)
 {
 	int ret;
@@ -529,6 +772,9 @@ static int __init s5p_vcm_init(void)
 	if (!l2pgtbl_cachep)
 		return -ENOMEM;
 
+	debugfs_create_file("s5p_vcm_mappings", S_IRUGO, NULL, NULL,
+			    &s5p_vcm_mappings_fops);
+
 	return 0;
 }
 subsys_initcall(s5p_vcm_init);
@@ -573,9 +819,20 @@ vcm_create_unified(resource_size_t size, enum vcm_dev_id id,
 	vcm_driver.phys = &s5p_vcm_mmu_phys;
 	vcm_mmu_activate = vcm_driver.activate;
 	vcm_driver.activate = &s5p_vcm_mmu_activate;
+	vcm_mmu_res = vcm_driver.res;
+	vcm_driver.res = &s5p_vcm_mmu_res;
+	vcm_mmu_unreserve = vcm_driver.unreserve;
+	vcm_driver.unreserve = &s5p_vcm_mmu_unreserve;
+	vcm_mmu_cleanup = vcm_driver.cleanup;
+	vcm_driver.cleanup = &s5p_vcm_mmu_cleanup;
 	s5p_vcm_mmu->mmu.vcm.driver = &vcm_driver;
 
 	s5p_vcm_mmu->driver = driver;
+	s5p_vcm_mmu->id = id;
+	spin_lock_init(&s5p_vcm_mmu->fq_lock);
+	setup_timer(&s5p_vcm_mmu->fq_timer, s5p_vcm_flush_timer,
+			(unsigned long)s5p_vcm_mmu);
+	s5p_vcm_mmu->rate_start = jiffies;
 
 	shared_vcm.vcms[id] = s5p_vcm_mmu;
 
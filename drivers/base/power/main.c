@@ -23,6 +23,7 @@
 #include <linux/pm.h>
 #include <linux/pm_runtime.h>
 #include <linux/resume-trace.h>
+#include <linux/suspend_profile.h>
 #include <linux/interrupt.h>
 #include <linux/sched.h>
 #include <linux/async.h>
@@ -439,6 +440,7 @@ static void dpm_show_time(ktime_t starttime, pm_message_t state, char *info)
  */
 static int device_resume_noirq(struct device *dev, pm_message_t state)
 {
+	ktime_t start = suspend_profile_start();
 	int error = 0;
 
 	TRACE_DEVICE(dev);
@@ -464,6 +466,7 @@ static int device_resume_noirq(struct device *dev, pm_message_t state)
 	}
 
 End:
+	suspend_profile_device(SUSPEND_PROFILE_RESUME_NOIRQ, dev, start);
 	TRACE_RESUME(error);
 	return error;
 }
@@ -525,6 +528,7 @@ static int legacy_resume(struct device *dev, int (*cb)(struct device *dev))
  */
 static int device_resume(struct device *dev, pm_message_t state, bool async)
 {
+	ktime_t start;
 	int error = 0;
 
 	TRACE_DEVICE(dev);
@@ -534,6 +538,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	    && (dev->parent->power.status >= DPM_OFF
 		|| dev->parent->power.status == DPM_RESUMING))
 		dpm_wait(dev->parent, async);
+	start = suspend_profile_start();
 	device_lock(dev);
 
 	dev->power.status = DPM_RESUMING;
@@ -570,6 +575,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	}
  End:
 	device_unlock(dev);
+	suspend_profile_device(SUSPEND_PROFILE_RESUME, dev, start);
 	complete_all(&dev->power.completion);
 
 	TRACE_RESUME(error);
@@ -783,6 +789,7 @@ static pm_message_t resume_event(pm_message_t sleep_state)
  */
 static int device_suspend_noirq(struct device *dev, pm_message_t state)
 {
+	ktime_t start = suspend_profile_start();
 	int error = 0;
 
 	if (dev->class && dev->class->pm) {
@@ -805,6 +812,7 @@ static int device_suspend_noirq(struct device *dev, pm_message_t state)
 	}
 
 End:
+	suspend_profile_device(SUSPEND_PROFILE_SUSPEND_NOIRQ, dev, start);
 	return error;
 }
 
@@ -875,8 +883,10 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 	int error = 0;
 	struct timer_list timer;
 	struct dpm_drv_wd_data data;
+	ktime_t start;
 
 	dpm_wait_for_children(dev, async);
+	start = suspend_profile_start();
 
 	data.dev = dev;
 	data.tsk = get_current();
@@ -927,6 +937,7 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 
  End:
 	device_unlock(dev);
+	suspend_profile_device(SUSPEND_PROFILE_SUSPEND, dev, start);
 
 	del_timer_sync(&timer);
 	destroy_timer_on_stack(&timer);
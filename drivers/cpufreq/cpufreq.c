@@ -26,8 +26,10 @@
 #include <linux/device.h>
 #include <linux/slab.h>
 #include <linux/cpu.h>
+#include <linux/sched.h>
 #include <linux/completion.h>
 #include <linux/mutex.h>
+#include <trace/events/power.h>
 
 #define dprintk(msg...) cpufreq_debug_printk(CPUFREQ_DEBUG_CORE, \
 						"cpufreq-core", msg)
@@ -356,6 +358,15 @@ void cpufreq_notify_transition(struct cpufreq_freqs *freqs, unsigned int state)
 		adjust_jiffies(CPUFREQ_POSTCHANGE, freqs);
 		srcu_notifier_call_chain(&cpufreq_transition_notifier_list,
 				CPUFREQ_POSTCHANGE, freqs);
+		trace_power_frequency(POWER_PSTATE, freqs->new);
+		/* drivers of shared clocks may only notify the policy cpu */
+		if (likely(policy)) {
+			unsigned int j;
+
+			for_each_cpu(j, policy->cpus)
+				sched_set_freq_scale(j, freqs->new,
+						     policy->cpuinfo.max_freq);
+		}
 		if (likely(policy) && likely(policy->cpu == freqs->cpu))
 			policy->cur = freqs->new;
 		break;
@@ -1596,6 +1607,13 @@ int __cpufreq_driver_getavg(struct cpufreq_policy *policy, unsigned int cpu)
 }
 EXPORT_SYMBOL_GPL(__cpufreq_driver_getavg);
 
+/* the flags of the registered driver, 0 if there is none */
+unsigned int cpufreq_driver_flags(void)
+{
+	return cpufreq_driver ? cpufreq_driver->flags : 0;
+}
+EXPORT_SYMBOL_GPL(cpufreq_driver_flags);
+
 /*
  * when "event" is CPUFREQ_GOV_LIMITS
  */
@@ -2010,6 +2028,98 @@ int cpufreq_unregister_driver(struct cpufreq_driver *driver)
 }
 EXPORT_SYMBOL_GPL(cpufreq_unregister_driver);
 
+
+/*********************************************************************
+ *                      DVFS SAMPLING STATISTICS                     *
+ *********************************************************************/
+
+/*
+ * A sample that finds its cpu idle for the whole window is a wakeup the
+ * cpu would not have needed: the sampling timer is the only thing that
+ * ran. Deferrable samplers only see such windows when something else
+ * woke the cpu, so this tells how much the remaining timer driven
+ * sampling costs an otherwise idle system.
+ */
+struct cpufreq_sampler_stats {
+	unsigned long samples;
+	unsigned long idle;
+	unsigned long skipped;
+	unsigned long window_start;
+	unsigned int window_idle;
+	unsigned int wakeups_per_sec;
+};
+
+static const char * const cpufreq_sampler_names[CPUFREQ_SAMPLER_MAX] = {
+	[CPUFREQ_SAMPLER_GOVERNOR]	= "governor",
+	[CPUFREQ_SAMPLER_HOTPLUG]	= "hotplug",
+	[CPUFREQ_SAMPLER_BUSFREQ]	= "busfreq",
+};
+
+static struct cpufreq_sampler_stats cpufreq_sampler_stats[CPUFREQ_SAMPLER_MAX];
+static DEFINE_SPINLOCK(cpufreq_sampler_lock);
+
+/**
+ * cpufreq_sample_account - account one DVFS sample
+ * @sampler: who sampled
+ * @idle: the sampled cpus did nothing but idle since the previous sample
+ * @skipped: the sampler took its idle fast path and evaluated nothing
+ */
+void cpufreq_sample_account(enum cpufreq_sampler sampler, bool idle,
+			    bool skipped)
+{
+	struct cpufreq_sampler_stats *s = &cpufreq_sampler_stats[sampler];
+	unsigned long now = jiffies;
+	unsigned long flags;
+
+	spin_lock_irqsave(&cpufreq_sampler_lock, flags);
+	s->samples++;
+	if (skipped)
+		s->skipped++;
+	if (idle) {
+		s->idle++;
+		s->window_idle++;
+	}
+	if (time_after_eq(now, s->window_start + HZ)) {
+		s->wakeups_per_sec = s->window_idle * HZ /
+				     (now - s->window_start);
+		s->window_idle = 0;
+		s->window_start = now;
+	}
+	spin_unlock_irqrestore(&cpufreq_sampler_lock, flags);
+}
+EXPORT_SYMBOL_GPL(cpufreq_sample_account);
+
+static ssize_t show_sampling_wakeups(struct kobject *kobj,
+				     struct attribute *attr, char *buf)
+{
+	struct cpufreq_sampler_stats stats[CPUFREQ_SAMPLER_MAX];
+	unsigned long now = jiffies;
+	unsigned long flags;
+	ssize_t len;
+	int i;
+
+	spin_lock_irqsave(&cpufreq_sampler_lock, flags);
+	memcpy(stats, cpufreq_sampler_stats, sizeof(stats));
+	spin_unlock_irqrestore(&cpufreq_sampler_lock, flags);
+
+	len = sprintf(buf, "sampler samples idle skipped wakeups/s\n");
+	for (i = 0; i < CPUFREQ_SAMPLER_MAX; i++) {
+		struct cpufreq_sampler_stats *s = &stats[i];
+
+		/* a sampler that stopped sampling does not wake anybody */
+		if (time_after_eq(now, s->window_start + 2 * HZ))
+			s->wakeups_per_sec = s->window_idle * HZ /
+					     (now - s->window_start);
+
+		len += sprintf(buf + len, "%s %lu %lu %lu %u\n",
+			       cpufreq_sampler_names[i], s->samples, s->idle,
+			       s->skipped, s->wakeups_per_sec);
+	}
+
+	return len;
+}
+define_one_global_ro(sampling_wakeups);
+
 static int __init cpufreq_core_init(void)
 {
 	int cpu;
@@ -2023,6 +2133,9 @@ static int __init cpufreq_core_init(void)
 						&cpu_sysdev_class.kset.kobj);
 	BUG_ON(!cpufreq_global_kobject);
 
+	if (sysfs_create_file(cpufreq_global_kobject, &sampling_wakeups.attr))
+		pr_err("cpufreq: failed to create sampling_wakeups\n");
+
 	return 0;
 }
 core_initcall(cpufreq_core_init);
@@ -23,42 +23,37 @@
  *
  */
 
+#include <linux/module.h>
 #include <linux/cpu.h>
 #include <linux/cpumask.h>
 #include <linux/cpufreq.h>
+#include <linux/jiffies.h>
 #include <linux/sched.h>
-#include <linux/tick.h>
-#include <linux/timer.h>
-#include <linux/workqueue.h>
 #include <linux/moduleparam.h>
-#include <asm/cputime.h>
 #include <linux/earlysuspend.h>
 
-static void (*pm_idle_old)(void);
-static atomic_t active_count = ATOMIC_INIT(0);
+#include "cpufreq_governor.h"
 
+/*
+ * Sampling, idle accounting and the timers are done by the common
+ * governor core, every sample_rate_jiffies. What is kept here is how long
+ * the policy has been at its current frequency.
+ */
 struct brazilianwax_info_s {
-        struct cpufreq_policy *cur_policy;
-        struct timer_list timer;
-        u64 time_in_idle;
-        u64 idle_exit_time;
-        u64 freq_change_time;
-        u64 freq_change_time_in_idle;
-        int cur_cpu_load;
-        unsigned int force_ramp_up;
-        unsigned int enable;
+        struct cpufreq_frequency_table *freq_table;
+        unsigned int freq;
+        /* us */
+        unsigned int time_since_change;
         int max_speed;
         int min_speed;
 };
 static DEFINE_PER_CPU(struct brazilianwax_info_s, brazilianwax_info);
 
-/* Workqueues handle frequency scaling */
-static struct workqueue_struct *up_wq;
-static struct workqueue_struct *down_wq;
-static struct work_struct freq_scale_work;
+static atomic_t active_count = ATOMIC_INIT(0);
 
-static cpumask_t work_cpumask;
 static unsigned int suspended;
+/* the screen went on or off since the last sample */
+static unsigned int suspend_changed;
 
 enum {
         BRAZILIANWAX_DEBUG_JUMPS=1,
@@ -122,7 +117,12 @@ static unsigned int suspendfreq = 400000;
  * Sampling rate, I highly recommend to leave it at 2.
  */
 #define DEFAULT_SAMPLE_RATE_JIFFIES 2
-static unsigned int sample_rate_jiffies;
+
+/*
+ * Sample at once when the scheduler sees the utilization of a cpu rise by
+ * this percentage of the current speed, as the idle exit hook used to.
+ */
+#define DEFAULT_UTIL_KICK 10
 
 /*
  * Minimum Freqeuncy delta when ramping up.
@@ -152,6 +152,7 @@ static unsigned long x_cpu_load;
  */
 #define DEFAULT_MIN_CPU_LOAD 25
 static unsigned long min_cpu_load;
+
 #define RAPID_MIN_CPU_LOAD 5
 static unsigned long rapid_min_cpu_load;
 
@@ -169,6 +170,8 @@ struct cpufreq_governor cpufreq_gov_brazilianwax = {
         .owner = THIS_MODULE,
 };
 
+static struct cpufreq_gov brazilianwax_gov;
+
 static void brazilianwax_update_min_max(struct brazilianwax_info_s *this_brazilianwax, struct cpufreq_policy *policy, int suspend) {
         if (suspend) {
                 this_brazilianwax->min_speed = policy->min;
@@ -190,208 +193,132 @@ inline static unsigned int validate_freq(struct brazilianwax_info_s *this_brazil
         return freq;
 }
 
-static void reset_timer(unsigned long cpu, struct brazilianwax_info_s *this_brazilianwax) {
-  this_brazilianwax->time_in_idle = get_cpu_idle_time_us(cpu, &this_brazilianwax->idle_exit_time);
-  mod_timer(&this_brazilianwax->timer, jiffies + sample_rate_jiffies);
-}
-
-static void cpufreq_brazilianwax_timer(unsigned long data)
+static unsigned int cpufreq_brazilianwax_select(struct cpufreq_gov_cpu *gcpu,
+                unsigned int cpu_load)
 {
-        u64 delta_idle;
-        u64 delta_time;
-        int cpu_load;
-        u64 update_time;
-  	u64 now_idle; 	
-	unsigned long new_rate;
+        struct brazilianwax_info_s *this_brazilianwax = &per_cpu(brazilianwax_info, gcpu->cpu);
+        struct cpufreq_policy *policy = gcpu->cur_policy;
+        unsigned int force_ramp_up;
+        unsigned int index;
+        unsigned long new_rate;
+        int new_freq;
+
+        /* a new frequency took effect since the last sample */
+        if (this_brazilianwax->freq != policy->cur) {
+                this_brazilianwax->freq = policy->cur;
+                this_brazilianwax->time_since_change = 0;
+        }
+        if (this_brazilianwax->time_since_change < UINT_MAX - gcpu->window)
+                this_brazilianwax->time_since_change += gcpu->window;
 
-        struct brazilianwax_info_s *this_brazilianwax = &per_cpu(brazilianwax_info, data);
-        struct cpufreq_policy *policy = this_brazilianwax->cur_policy;
+        brazilianwax_update_min_max(this_brazilianwax,policy,suspended);
 
-        now_idle = get_cpu_idle_time_us(data, &update_time);
+        if (xchg(&suspend_changed, 0)) {
+                this_brazilianwax->time_since_change = 0;
+                if (suspended) {
+                        if (debug_mask & BRAZILIANWAX_DEBUG_JUMPS)
+                                printk(KERN_INFO "SmartassS: suspending at %d\n",policy->cur);
+                        return suspendfreq;
+                }
 
-        if (this_brazilianwax->idle_exit_time == 0 || update_time == this_brazilianwax->idle_exit_time)
-                return;
+                // resume at max speed:
+                new_freq = validate_freq(this_brazilianwax,sleep_wakeup_freq);
 
-        delta_idle = cputime64_sub(now_idle, this_brazilianwax->time_in_idle);
-        delta_time = cputime64_sub(update_time, this_brazilianwax->idle_exit_time);
-        //printk(KERN_INFO "brazilianwaxT: t=%llu i=%llu\n",cputime64_sub(update_time,this_brazilianwax->idle_exit_time),delta_idle);
+                if (debug_mask & BRAZILIANWAX_DEBUG_JUMPS)
+                        printk(KERN_INFO "SmartassS: awaking at %d\n",new_freq);
 
-        // If timer ran less than 1ms after short-term sample started, retry.
-        if (delta_time < 1000) {
-                if (!timer_pending(&this_brazilianwax->timer))
-                        reset_timer(data,this_brazilianwax);
-                return;
+                gcpu->relation = CPUFREQ_RELATION_L;
+                return new_freq;
         }
 
-        if (delta_idle > delta_time)
-                cpu_load = 0;
-        else
-                cpu_load = 100 * (unsigned int)(delta_time - delta_idle) / (unsigned int)delta_time;
-
         if (debug_mask & BRAZILIANWAX_DEBUG_LOAD)
-                printk(KERN_INFO "brazilianwaxT @ %d: load %d (delta_time %llu)\n",policy->cur,cpu_load,delta_time);
-
-        this_brazilianwax->cur_cpu_load = cpu_load;
+                printk(KERN_INFO "brazilianwaxT @ %d: load %d (window %u)\n",policy->cur,cpu_load,gcpu->window);
 
-        // Scale up if load is above max or if there where no idle cycles since coming out of idle,
+        // Scale up if load is above max or if there where no idle cycles since the last sample,
         // or when we are above our max speed for a very long time (should only happend if entering sleep
         // at high loads)
-        if ((cpu_load > max_cpu_load || delta_idle == 0) &&
+        if ((cpu_load > max_cpu_load || cpu_load == 100) &&
             !(policy->cur > this_brazilianwax->max_speed &&
-              cputime64_sub(update_time, this_brazilianwax->freq_change_time) > 100*down_rate_us)) {
-
-                if (policy->cur > this_brazilianwax->max_speed) {
-                        reset_timer(data,this_brazilianwax);
-                }
+              this_brazilianwax->time_since_change > 100*down_rate_us)) {
 
                 if (policy->cur == policy->max)
-                        return;
-
-                if (nr_running() < 1)
-                        return;
+                        return 0;
 
 		new_rate = up_rate_us;
 
 		// minimize going above 1.8Ghz
 		if (policy->cur > up_min_freq) new_rate = 75000;
 
-                if (cputime64_sub(update_time, this_brazilianwax->freq_change_time) < new_rate) 
-                        return;
-
-                this_brazilianwax->force_ramp_up = 1;
-                cpumask_set_cpu(data, &work_cpumask);
-                queue_work(up_wq, &freq_scale_work);
-                return;
-        }
-
-        /*
-         * There is a window where if the cpu utlization can go from low to high
-         * between the timer expiring, delta_idle will be > 0 and the cpu will
-         * be 100% busy, preventing idle from running, and this timer from
-         * firing. So setup another timer to fire to check cpu utlization.
-         * Do not setup the timer if there is no scheduled work or if at max speed.
-         */
-        if (policy->cur < this_brazilianwax->max_speed && !timer_pending(&this_brazilianwax->timer) && nr_running() > 0)
-                reset_timer(data,this_brazilianwax);
-
-        if (policy->cur == policy->min)
-                return;
-
-        /*
-         * Do not scale down unless we have been at this frequency for the
-         * minimum sample time.
-         */
-        if (cputime64_sub(update_time, this_brazilianwax->freq_change_time) < down_rate_us)
-                return;
-
-        cpumask_set_cpu(data, &work_cpumask);
-        queue_work(down_wq, &freq_scale_work);
-}
-
-static void cpufreq_idle(void)
-{
-        struct brazilianwax_info_s *this_brazilianwax = &per_cpu(brazilianwax_info, smp_processor_id());
-        struct cpufreq_policy *policy = this_brazilianwax->cur_policy;
-
-        if (!this_brazilianwax->enable) {
-                pm_idle_old();
-                return;
-        }
-
-        if (policy->cur == this_brazilianwax->min_speed && timer_pending(&this_brazilianwax->timer))
-                del_timer(&this_brazilianwax->timer);
-
-        pm_idle_old();
+                if (this_brazilianwax->time_since_change < new_rate)
+                        return 0;
 
-        if (!timer_pending(&this_brazilianwax->timer))
-                reset_timer(smp_processor_id(), this_brazilianwax);
-}
+                /* the sampling work itself is one of the running tasks */
+                force_ramp_up = cpu_load == 100 && nr_running() > 1;
 
-/* We use the same work function to sale up and down */
-static void cpufreq_brazilianwax_freq_change_time_work(struct work_struct *work)
-{
-        unsigned int cpu;
-        int new_freq, old_freq;
-        unsigned int force_ramp_up;
-        int cpu_load;
-        struct brazilianwax_info_s *this_brazilianwax;
-        struct cpufreq_policy *policy;
-        unsigned int relation = CPUFREQ_RELATION_L;
-        cpumask_t tmp_mask = work_cpumask;
-        for_each_cpu(cpu, &tmp_mask) {
-                this_brazilianwax = &per_cpu(brazilianwax_info, cpu);
-                policy = this_brazilianwax->cur_policy;
-                cpu_load = this_brazilianwax->cur_cpu_load;
-                force_ramp_up = this_brazilianwax->force_ramp_up && nr_running() > 1;
-                this_brazilianwax->force_ramp_up = 0;
-
-                if (force_ramp_up || cpu_load > max_cpu_load) {
-		  if (!suspended) {
+		if (!suspended) {
 			if (force_ramp_up && up_min_freq && policy->cur < up_min_freq) {
-			  	// imoseyon - ramp up faster
-                                new_freq = up_min_freq;
-                                relation = CPUFREQ_RELATION_L;
+				// imoseyon - ramp up faster
+				new_freq = up_min_freq;
+				gcpu->relation = CPUFREQ_RELATION_L;
 			} else if (ramp_up_step) {
-                                new_freq = policy->cur + ramp_up_step;
-                                relation = CPUFREQ_RELATION_H;
-                        } else {
-                                new_freq = this_brazilianwax->max_speed;
-                                relation = CPUFREQ_RELATION_H;
-                        }
+				new_freq = policy->cur + ramp_up_step;
+			} else {
+				new_freq = this_brazilianwax->max_speed;
+			}
 			// try to minimize going above 1.8Ghz
 			if ((new_freq > threshold_freq) && (cpu_load < 95)) {
 				new_freq = threshold_freq;
-				relation = CPUFREQ_RELATION_H;
+				gcpu->relation = CPUFREQ_RELATION_H;
 			}
-		  } else {
+		} else {
 			new_freq = policy->cur + 150000;
-			if (new_freq > suspendfreq) new_freq = suspendfreq; 	
-			relation = CPUFREQ_RELATION_H;
-		  }
-		
-                } else if (cpu_load < min_cpu_load) {
+			if (new_freq > suspendfreq) new_freq = suspendfreq;
+		}
+        } else {
+                if (policy->cur == policy->min)
+                        return 0;
+
+                /*
+                 * Do not scale down unless we have been at this frequency for the
+                 * minimum sample time.
+                 */
+                if (this_brazilianwax->time_since_change < down_rate_us)
+                        return 0;
+
+                if (cpu_load < min_cpu_load) {
 			if (cpu_load < rapid_min_cpu_load) {
 				new_freq = awake_min_freq;
 			} else if (ramp_down_step) {
-                                  new_freq = policy->cur - ramp_down_step;
+                                new_freq = policy->cur - ramp_down_step;
                         } else {
                                 cpu_load += 100 - max_cpu_load; // dummy load.
                                 new_freq = policy->cur * cpu_load / 100;
                         }
-                        relation = CPUFREQ_RELATION_L;
+                        gcpu->relation = CPUFREQ_RELATION_L;
                 }
                 else new_freq = policy->cur;
+        }
 
-		old_freq = policy->cur;
-                new_freq = validate_freq(this_brazilianwax,new_freq);
+        new_freq = validate_freq(this_brazilianwax,new_freq);
 
-                if (new_freq != policy->cur) {
-                        if (debug_mask & BRAZILIANWAX_DEBUG_JUMPS)
-                                printk(KERN_INFO "SmartassQ: jumping from %d to %d\n",policy->cur,new_freq);
-
-                        __cpufreq_driver_target(policy, new_freq, relation);
-
-                        this_brazilianwax->freq_change_time_in_idle =
-                                get_cpu_idle_time_us(cpu,&this_brazilianwax->freq_change_time);
-
-			if (relation == CPUFREQ_RELATION_L && old_freq == policy->cur) {
-			  // step down one more time
-			  new_freq = new_freq - 100000;
-			  __cpufreq_driver_target(policy, new_freq, relation);
-			  this_brazilianwax->freq_change_time_in_idle =
-					get_cpu_idle_time_us(cpu,&this_brazilianwax->freq_change_time);
-			} 
-			if (relation == CPUFREQ_RELATION_H && old_freq == policy->cur) {
-			  // step up one more time
-			  new_freq = new_freq + 100000;
-			  __cpufreq_driver_target(policy, new_freq, relation);
-			  this_brazilianwax->freq_change_time_in_idle =
-					get_cpu_idle_time_us(cpu,&this_brazilianwax->freq_change_time);
-			} 
-                }
+        if (new_freq == policy->cur)
+                return 0;
+
+        if (debug_mask & BRAZILIANWAX_DEBUG_JUMPS)
+                printk(KERN_INFO "SmartassQ: jumping from %d to %d\n",policy->cur,new_freq);
 
-                cpumask_clear_cpu(cpu, &work_cpumask);
+        // step one more time if the table has nothing in that direction
+        if (this_brazilianwax->freq_table &&
+            !cpufreq_frequency_table_target(policy, this_brazilianwax->freq_table,
+                                            new_freq, gcpu->relation, &index) &&
+            this_brazilianwax->freq_table[index].frequency == policy->cur) {
+                if (gcpu->relation == CPUFREQ_RELATION_L)
+                        new_freq = new_freq - 100000;
+                else
+                        new_freq = new_freq + 100000;
         }
+
+        return new_freq;
 }
 
 static ssize_t show_debug_mask(struct cpufreq_policy *policy, char *buf)
@@ -406,7 +333,7 @@ static ssize_t store_debug_mask(struct cpufreq_policy *policy, const char *buf,
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0)
           debug_mask = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr debug_mask_attr = __ATTR(debug_mask, 0644,
@@ -424,7 +351,7 @@ static ssize_t store_up_rate_us(struct cpufreq_policy *policy, const char *buf,
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0 && input <= 100000000)
           up_rate_us = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr up_rate_us_attr = __ATTR(up_rate_us, 0644,
@@ -440,9 +367,12 @@ static ssize_t store_down_rate_us(struct cpufreq_policy *policy, const char *buf
         ssize_t res;
         unsigned long input;
         res = strict_strtoul(buf, 0, &input);
-        if (res >= 0 && input >= 0 && input <= 100000000)
+        if (res >= 0 && input >= 0 && input <= 100000000) {
           down_rate_us = input;
-        return res;
+          /* an idle cpu is woken up to ramp down once it may */
+          brazilianwax_gov.timer_slack = input;
+        }
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr down_rate_us_attr = __ATTR(down_rate_us, 0644,
@@ -460,7 +390,7 @@ static ssize_t store_up_min_freq(struct cpufreq_policy *policy, const char *buf,
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           up_min_freq = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr up_min_freq_attr = __ATTR(up_min_freq, 0644,
@@ -478,7 +408,7 @@ static ssize_t store_sleep_max_freq(struct cpufreq_policy *policy, const char *b
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           sleep_max_freq = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr sleep_max_freq_attr = __ATTR(sleep_max_freq, 0644,
@@ -496,7 +426,7 @@ static ssize_t store_sleep_wakeup_freq(struct cpufreq_policy *policy, const char
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           sleep_wakeup_freq = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr sleep_wakeup_freq_attr = __ATTR(sleep_wakeup_freq, 0644,
@@ -514,7 +444,7 @@ static ssize_t store_awake_min_freq(struct cpufreq_policy *policy, const char *b
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           awake_min_freq = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr awake_min_freq_attr = __ATTR(awake_min_freq, 0644,
@@ -522,7 +452,7 @@ static struct freq_attr awake_min_freq_attr = __ATTR(awake_min_freq, 0644,
 
 static ssize_t show_sample_rate_jiffies(struct cpufreq_policy *policy, char *buf)
 {
-        return sprintf(buf, "%u\n", sample_rate_jiffies);
+        return sprintf(buf, "%lu\n", usecs_to_jiffies(brazilianwax_gov.sampling_rate));
 }
 
 static ssize_t store_sample_rate_jiffies(struct cpufreq_policy *policy, const char *buf, size_t count)
@@ -531,8 +461,8 @@ static ssize_t store_sample_rate_jiffies(struct cpufreq_policy *policy, const ch
         unsigned long input;
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input > 0 && input <= 1000)
-          sample_rate_jiffies = input;
-        return res;
+          brazilianwax_gov.sampling_rate = jiffies_to_usecs(input);
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr sample_rate_jiffies_attr = __ATTR(sample_rate_jiffies, 0644,
@@ -550,7 +480,7 @@ static ssize_t store_ramp_up_step(struct cpufreq_policy *policy, const char *buf
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           ramp_up_step = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr ramp_up_step_attr = __ATTR(ramp_up_step, 0644,
@@ -568,7 +498,7 @@ static ssize_t store_ramp_down_step(struct cpufreq_policy *policy, const char *b
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           ramp_down_step = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr ramp_down_step_attr = __ATTR(ramp_down_step, 0644,
@@ -586,7 +516,7 @@ static ssize_t store_max_cpu_load(struct cpufreq_policy *policy, const char *buf
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input > 0 && input <= 100)
           max_cpu_load = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr max_cpu_load_attr = __ATTR(max_cpu_load, 0644,
@@ -604,7 +534,7 @@ static ssize_t store_min_cpu_load(struct cpufreq_policy *policy, const char *buf
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input > 0 && input < 100)
           min_cpu_load = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr min_cpu_load_attr = __ATTR(min_cpu_load, 0644,
@@ -626,61 +556,28 @@ static struct attribute * brazilianwax_attributes[] = {
         NULL,
 };
 
-static struct attribute_group brazilianwax_attr_group = {
-        .attrs = brazilianwax_attributes,
-        .name = "brazilianwax",
-};
-
-static void brazilianwax_suspend(int cpu, int suspend)
-{
-        struct brazilianwax_info_s *this_brazilianwax = &per_cpu(brazilianwax_info, smp_processor_id());
-        struct cpufreq_policy *policy = this_brazilianwax->cur_policy;
-        unsigned int new_freq;
-
-        if (!this_brazilianwax->enable || sleep_max_freq==0) // disable behavior for sleep_max_freq==0
-                return;
-
-        brazilianwax_update_min_max(this_brazilianwax,policy,suspend);
-        if (!suspend) { // resume at max speed:
-		suspended=0;
-                new_freq = validate_freq(this_brazilianwax,sleep_wakeup_freq);
-
-                if (debug_mask & BRAZILIANWAX_DEBUG_JUMPS)
-                        printk(KERN_INFO "SmartassS: awaking at %d\n",new_freq);
-
-                __cpufreq_driver_target(policy, new_freq,
-                                        CPUFREQ_RELATION_L);
-
-                if (policy->cur < this_brazilianwax->max_speed && !timer_pending(&this_brazilianwax->timer))
-                        reset_timer(smp_processor_id(),this_brazilianwax);
-        	pr_info("[imoseyon] brazilianwax awake at %d\n", policy->cur);
-        } else {
-                // to avoid wakeup issues with quick sleep/wakeup don't change actual frequency when entering sleep
-                // to allow some time to settle down.
-                // we reset the timer, if eventually, even at full load the timer will lower the freqeuncy.
-                reset_timer(smp_processor_id(),this_brazilianwax);
-
-                this_brazilianwax->freq_change_time_in_idle =
-                        get_cpu_idle_time_us(cpu,&this_brazilianwax->freq_change_time);
-
-                if (debug_mask & BRAZILIANWAX_DEBUG_JUMPS)
-                        printk(KERN_INFO "SmartassS: suspending at %d\n",policy->cur);
-		__cpufreq_driver_target(policy, suspendfreq, CPUFREQ_RELATION_H);
-        	pr_info("[imoseyon] brazilianwax suspending with %d\n", policy->cur);
-		suspended=1;
-        }
-}
-
 static void brazilianwax_early_suspend(struct early_suspend *handler) {
         int i;
+
+        if (sleep_max_freq==0) // disable behavior for sleep_max_freq==0
+                return;
+        suspended = 1;
+        suspend_changed = 1;
+        /* go to suspendfreq at once */
         for_each_online_cpu(i)
-                brazilianwax_suspend(i,1);
+                cpufreq_gov_kick(i);
 }
 
 static void brazilianwax_late_resume(struct early_suspend *handler) {
         int i;
+
+        if (sleep_max_freq==0)
+                return;
+        suspended = 0;
+        suspend_changed = 1;
+        /* wake up at sleep_wakeup_freq at once */
         for_each_online_cpu(i)
-                brazilianwax_suspend(i,0);
+                cpufreq_gov_kick(i);
 }
 
 static struct early_suspend brazilianwax_power_suspend = {
@@ -689,68 +586,56 @@ static struct early_suspend brazilianwax_power_suspend = {
 	.level = EARLY_SUSPEND_LEVEL_DISABLE_FB + 1,
 };
 
-static int cpufreq_governor_brazilianwax(struct cpufreq_policy *new_policy,
-                unsigned int event)
+static void cpufreq_brazilianwax_start(struct cpufreq_gov_cpu *gcpu)
 {
-        unsigned int cpu = new_policy->cpu;
-        int rc;
-        struct brazilianwax_info_s *this_brazilianwax = &per_cpu(brazilianwax_info, cpu);
-
-        switch (event) {
-        case CPUFREQ_GOV_START:
-                if ((!cpu_online(cpu)) || (!new_policy->cur))
-                        return -EINVAL;
-
-                /*
-                 * Do not register the idle hook and create sysfs
-                 * entries if we have already done so.
-                 */
-                if (atomic_inc_return(&active_count) <= 1) {
-                        rc = sysfs_create_group(&new_policy->kobj, &brazilianwax_attr_group);
-                        if (rc)
-                                return rc;
-                        pm_idle_old = pm_idle;
-                        pm_idle = cpufreq_idle;
-                }
+        struct brazilianwax_info_s *this_brazilianwax = &per_cpu(brazilianwax_info, gcpu->cpu);
+        struct cpufreq_policy *policy = gcpu->cur_policy;
 
-                this_brazilianwax->cur_policy = new_policy;
-                this_brazilianwax->enable = 1;
+        this_brazilianwax->freq_table = cpufreq_frequency_get_table(gcpu->cpu);
+        brazilianwax_update_min_max(this_brazilianwax,policy,suspended);
+        this_brazilianwax->freq = policy->cur;
+        this_brazilianwax->time_since_change = 0;
 
-		// imoseyon - should only register for suspend when governor active
-        	register_early_suspend(&brazilianwax_power_suspend); 
-        	pr_info("[imoseyon] brazilianwax active\n");
+        if (policy->cur != this_brazilianwax->max_speed) {
+                if (debug_mask & BRAZILIANWAX_DEBUG_JUMPS)
+                        printk(KERN_INFO "SmartassI: initializing to %d\n",this_brazilianwax->max_speed);
+                __cpufreq_driver_target(policy, this_brazilianwax->max_speed, CPUFREQ_RELATION_H);
+        }
 
-                // notice no break here!
+        // imoseyon - should only register for suspend when governor active
+        if (atomic_inc_return(&active_count) > 1)
+                return;
+        register_early_suspend(&brazilianwax_power_suspend);
+        pr_info("[imoseyon] brazilianwax active\n");
+}
 
-        case CPUFREQ_GOV_LIMITS:
-                brazilianwax_update_min_max(this_brazilianwax,new_policy,suspended);
-                if (this_brazilianwax->cur_policy->cur != this_brazilianwax->max_speed) {
-                        if (debug_mask & BRAZILIANWAX_DEBUG_JUMPS)
-                                printk(KERN_INFO "SmartassI: initializing to %d\n",this_brazilianwax->max_speed);
-                        __cpufreq_driver_target(new_policy, this_brazilianwax->max_speed, CPUFREQ_RELATION_H);
-                }
-                break;
+static void cpufreq_brazilianwax_stop(struct cpufreq_gov_cpu *gcpu)
+{
+        if (atomic_dec_return(&active_count) > 0)
+                return;
+        // unregister when governor exits
+        unregister_early_suspend(&brazilianwax_power_suspend);
+        pr_info("[imoseyon] brazilianwax inactive\n");
+}
 
-        case CPUFREQ_GOV_STOP:
-                del_timer(&this_brazilianwax->timer);
-                this_brazilianwax->enable = 0;
+static const struct cpufreq_gov_ops brazilianwax_ops = {
+        .select = cpufreq_brazilianwax_select,
+        .start = cpufreq_brazilianwax_start,
+        .stop = cpufreq_brazilianwax_stop,
+};
 
-                if (atomic_dec_return(&active_count) > 1)
-                        return 0;
-                sysfs_remove_group(&new_policy->kobj,
-                                &brazilianwax_attr_group);
-
-                pm_idle = pm_idle_old;
-		// unregister when governor exits
-        	unregister_early_suspend(&brazilianwax_power_suspend);
-        	pr_info("[imoseyon] brazilianwax inactive\n");
-                break;
-        }
+static struct cpufreq_gov brazilianwax_gov = {
+        .governor = &cpufreq_gov_brazilianwax,
+        .ops = &brazilianwax_ops,
+        .attrs = brazilianwax_attributes,
+};
 
-        return 0;
+static int cpufreq_governor_brazilianwax(struct cpufreq_policy *new_policy,
+                unsigned int event)
+{
+        return cpufreq_gov_event(&brazilianwax_gov, new_policy, event);
 }
 
-
 static int __init cpufreq_brazilianwax_init(void)
 {
         unsigned int i;
@@ -761,11 +646,10 @@ static int __init cpufreq_brazilianwax_init(void)
         up_min_freq = DEFAULT_UP_MIN_FREQ;
         sleep_max_freq = DEFAULT_SLEEP_MAX_FREQ;
         sleep_wakeup_freq = DEFAULT_SLEEP_WAKEUP_FREQ;
-        threshold_freq = UP_THRESHOLD_FREQ;
         awake_min_freq = DEFAULT_AWAKE_MIN_FREQ;
-        sample_rate_jiffies = DEFAULT_SAMPLE_RATE_JIFFIES;
         ramp_up_step = DEFAULT_RAMP_UP_STEP;
         ramp_down_step = DEFAULT_RAMP_DOWN_STEP;
+        threshold_freq = UP_THRESHOLD_FREQ;
         max_cpu_load = DEFAULT_MAX_CPU_LOAD;
         x_cpu_load = DEFAULT_X_CPU_LOAD;
         min_cpu_load = DEFAULT_MIN_CPU_LOAD;
@@ -776,45 +660,34 @@ static int __init cpufreq_brazilianwax_init(void)
         /* Initalize per-cpu data: */
         for_each_possible_cpu(i) {
                 this_brazilianwax = &per_cpu(brazilianwax_info, i);
-                this_brazilianwax->enable = 0;
-                this_brazilianwax->cur_policy = 0;
-                this_brazilianwax->force_ramp_up = 0;
                 this_brazilianwax->max_speed = DEFAULT_SLEEP_WAKEUP_FREQ;
                 this_brazilianwax->min_speed = DEFAULT_AWAKE_MIN_FREQ;
-                this_brazilianwax->time_in_idle = 0;
-                this_brazilianwax->idle_exit_time = 0;
-                this_brazilianwax->freq_change_time = 0;
-                this_brazilianwax->freq_change_time_in_idle = 0;
-                this_brazilianwax->cur_cpu_load = 0;
-                // intialize timer:
-                init_timer_deferrable(&this_brazilianwax->timer);
-                this_brazilianwax->timer.function = cpufreq_brazilianwax_timer;
-                this_brazilianwax->timer.data = i;
+                this_brazilianwax->freq = 0;
+                this_brazilianwax->time_since_change = 0;
         }
 
-        /* Scale up is high priority */
-        up_wq = create_workqueue("kbrazilianwax_up");
-        down_wq = create_workqueue("kbrazilianwax_down");
-
-        INIT_WORK(&freq_scale_work, cpufreq_brazilianwax_freq_change_time_work);
+        brazilianwax_gov.min_sampling_rate = jiffies_to_usecs(1);
+        brazilianwax_gov.sampling_rate =
+                jiffies_to_usecs(DEFAULT_SAMPLE_RATE_JIFFIES);
+        /* an idle cpu is woken up to ramp down once it may */
+        brazilianwax_gov.timer_slack = down_rate_us;
+        brazilianwax_gov.util_kick = DEFAULT_UTIL_KICK;
 
         pr_info("[imoseyon] brazilianwax enter\n");
 
-        return cpufreq_register_governor(&cpufreq_gov_brazilianwax);
+        return cpufreq_gov_register(&brazilianwax_gov);
 }
 
 #ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_BRAZILIANWAX
-pure_initcall(cpufreq_brazilianwax_init);
+fs_initcall(cpufreq_brazilianwax_init);
 #else
 module_init(cpufreq_brazilianwax_init);
 #endif
 
 static void __exit cpufreq_brazilianwax_exit(void)
 {
+        cpufreq_gov_unregister(&brazilianwax_gov);
         pr_info("[imoseyon] brazilianwax exit\n");
-        cpufreq_unregister_governor(&cpufreq_gov_brazilianwax);
-        destroy_workqueue(up_wq);
-        destroy_workqueue(down_wq);
 }
 
 module_exit(cpufreq_brazilianwax_exit);
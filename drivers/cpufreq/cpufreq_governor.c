@@ -0,0 +1,839 @@
+/*
+ *  drivers/cpufreq/cpufreq_governor.c
+ *
+ *  Common sampling core for the load based cpufreq governors.
+ *
+ *  The governors in this directory mostly differ in how they turn a load
+ *  figure into a frequency; the per cpu deferrable sampling work, the
+ *  idle time accounting, the transition notifier and the sysfs plumbing
+ *  are the same everywhere and live here. A governor only provides a
+ *  struct cpufreq_gov_ops and its own tunables.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/cpufreq.h>
+#include <linux/cpu.h>
+#include <linux/jiffies.h>
+#include <linux/kernel_stat.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/tick.h>
+#include <linux/workqueue.h>
+
+#include "cpufreq_governor.h"
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/cpufreq_gov.h>
+
+#define MIN_SAMPLING_RATE_RATIO			(2)
+#define LATENCY_MULTIPLIER			(1000)
+#define MIN_LATENCY_MULTIPLIER			(100)
+
+static struct workqueue_struct *kgovernor_wq;
+
+/* number of cpus running any governor built on this core */
+static unsigned int gov_core_enable;
+static DEFINE_MUTEX(gov_core_mutex);
+
+/* sampling state of the policy cpu, while a core governor runs on it */
+static DEFINE_PER_CPU(struct cpufreq_gov_cpu *, gov_cpu_active);
+
+static inline cputime64_t get_cpu_idle_time_jiffy(unsigned int cpu,
+						  cputime64_t *wall)
+{
+	cputime64_t idle_time;
+	cputime64_t cur_wall_time;
+	cputime64_t busy_time;
+
+	cur_wall_time = jiffies64_to_cputime64(get_jiffies_64());
+	busy_time = cputime64_add(kstat_cpu(cpu).cpustat.user,
+			kstat_cpu(cpu).cpustat.system);
+
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.irq);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.softirq);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.steal);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.nice);
+
+	idle_time = cputime64_sub(cur_wall_time, busy_time);
+	if (wall)
+		*wall = (cputime64_t)jiffies_to_usecs(cur_wall_time);
+
+	return (cputime64_t)jiffies_to_usecs(idle_time);
+}
+
+static inline cputime64_t get_cpu_idle_time(unsigned int cpu, cputime64_t *wall)
+{
+	u64 idle_time = get_cpu_idle_time_us(cpu, wall);
+
+	if (idle_time == -1ULL)
+		return get_cpu_idle_time_jiffy(cpu, wall);
+
+	return idle_time;
+}
+
+static inline cputime64_t get_cpu_iowait_time(unsigned int cpu, cputime64_t *wall)
+{
+	u64 iowait_time = get_cpu_iowait_time_us(cpu, wall);
+
+	if (iowait_time == -1ULL)
+		return 0;
+
+	return iowait_time;
+}
+
+static void gov_reset_idle(struct cpufreq_gov *gov, unsigned int cpu)
+{
+	struct cpufreq_gov_cpu *gcpu = cpufreq_gov_cpu(gov, cpu);
+
+	gcpu->prev_cpu_idle = get_cpu_idle_time(cpu, &gcpu->prev_cpu_wall);
+	gcpu->prev_cpu_iowait = get_cpu_iowait_time(cpu, NULL);
+	if (gov->ignore_nice)
+		gcpu->prev_cpu_nice = kstat_cpu(cpu).cpustat.nice;
+}
+
+/*
+ * highest load of all cpus of the policy since the last sample, *idle
+ * tells whether all of them did nothing but idle in the meantime and
+ * *window how long the sample was
+ */
+static unsigned int gov_policy_load(struct cpufreq_gov *gov,
+				    struct cpufreq_policy *policy, bool *idle,
+				    unsigned int *window)
+{
+	unsigned int max_load = 0;
+	unsigned int j;
+
+	*idle = true;
+	*window = 0;
+
+	for_each_cpu(j, policy->cpus) {
+		struct cpufreq_gov_cpu *j_gcpu = cpufreq_gov_cpu(gov, j);
+		cputime64_t cur_wall_time, cur_idle_time, cur_iowait_time;
+		unsigned int idle_time, wall_time, iowait_time, load;
+
+		cur_idle_time = get_cpu_idle_time(j, &cur_wall_time);
+		cur_iowait_time = get_cpu_iowait_time(j, NULL);
+
+		wall_time = (unsigned int) cputime64_sub(cur_wall_time,
+				j_gcpu->prev_cpu_wall);
+		j_gcpu->prev_cpu_wall = cur_wall_time;
+
+		idle_time = (unsigned int) cputime64_sub(cur_idle_time,
+				j_gcpu->prev_cpu_idle);
+		j_gcpu->prev_cpu_idle = cur_idle_time;
+
+		iowait_time = (unsigned int) cputime64_sub(cur_iowait_time,
+				j_gcpu->prev_cpu_iowait);
+		j_gcpu->prev_cpu_iowait = cur_iowait_time;
+
+		if (gov->ignore_nice) {
+			cputime64_t cur_nice;
+			unsigned long cur_nice_jiffies;
+
+			cur_nice = cputime64_sub(kstat_cpu(j).cpustat.nice,
+					j_gcpu->prev_cpu_nice);
+			/*
+			 * Assumption: nice time between sampling periods will
+			 * be less than 2^32 jiffies for 32 bit sys
+			 */
+			cur_nice_jiffies = (unsigned long)
+				cputime64_to_jiffies64(cur_nice);
+
+			j_gcpu->prev_cpu_nice = kstat_cpu(j).cpustat.nice;
+			idle_time += jiffies_to_usecs(cur_nice_jiffies);
+		}
+
+		/*
+		 * Waiting for disk IO is an indication that we are
+		 * performance critical, not that the cpu is idle.
+		 */
+		if (gov->io_is_busy && idle_time >= iowait_time)
+			idle_time -= iowait_time;
+
+		if (gov->util_kick)
+			j_gcpu->util_base = sched_cpu_util(j);
+
+		if (unlikely(!wall_time || wall_time < idle_time))
+			continue;
+
+		if (!cpufreq_window_idle(wall_time, idle_time))
+			*idle = false;
+		if (wall_time > *window)
+			*window = wall_time;
+
+		load = 100 * (wall_time - idle_time) / wall_time;
+		j_gcpu->load = load;
+		if (load > max_load)
+			max_load = load;
+	}
+
+	return max_load;
+}
+
+/*
+ * Request freq. The driver is not called if that is the current one,
+ * unless it does more than set the cpu frequency in ->target(): the
+ * S5PV310 driver re-evaluates the bus level there, which has to happen
+ * every sample.
+ */
+static void gov_target(struct cpufreq_gov_cpu *gcpu, unsigned int freq)
+{
+	struct cpufreq_policy *policy = gcpu->cur_policy;
+	unsigned int old_freq = policy->cur;
+
+	if (freq == old_freq &&
+	    !(cpufreq_driver_flags() & CPUFREQ_TARGET_ALWAYS))
+		return;
+
+	__cpufreq_driver_target(policy, freq, gcpu->relation);
+	if (policy->cur != old_freq)
+		gcpu->transitions++;
+}
+
+static void gov_check_cpu(struct cpufreq_gov_cpu *gcpu, bool kicked)
+{
+	struct cpufreq_gov *gov = gcpu->gov;
+	struct cpufreq_policy *policy = gcpu->cur_policy;
+	unsigned int load, freq;
+	bool idle, skip;
+
+	load = gov_policy_load(gov, policy, &idle, &gcpu->window);
+	gcpu->samples++;
+	gcpu->freq_lo = 0;
+
+	/*
+	 * Nothing but our own timer ran since the last sample and there is
+	 * no lower frequency to go to: whatever the governor decides, it
+	 * cannot change anything, so do not bother it. A kick is always
+	 * passed on, it is how the governor is told to raise the frequency.
+	 */
+	skip = !kicked && !gov->sample_idle && idle &&
+	       policy->cur == policy->min;
+	cpufreq_sample_account(CPUFREQ_SAMPLER_GOVERNOR, idle, skip);
+	gcpu->relation = CPUFREQ_RELATION_H;
+	if (skip) {
+		gcpu->load = 0;
+		gcpu->skipped++;
+		/* nothing to hold at the lowest frequency */
+		gcpu->rate_mult = 1;
+		gov_target(gcpu, policy->cur);
+		return;
+	}
+
+	freq = gov->ops->select(gcpu, load);
+
+	trace_cpufreq_gov_sample(gov->governor->name, gcpu->cpu, load,
+				 policy->cur, freq);
+
+	if (!freq) {
+		gov_target(gcpu, policy->cur);
+		return;
+	}
+
+	if (freq > policy->max)
+		freq = policy->max;
+	if (freq < policy->min)
+		freq = policy->min;
+
+	gcpu->requested_freq = freq;
+	gov_target(gcpu, freq);
+}
+
+static inline int gov_sampling_delay(struct cpufreq_gov_cpu *gcpu)
+{
+	/* We want all CPUs to do sampling nearly on same jiffy */
+	int delay = usecs_to_jiffies(gcpu->gov->sampling_rate *
+				     gcpu->rate_mult);
+
+	if (delay < 1)
+		delay = 1;
+
+	return delay - jiffies % delay;
+}
+
+static void gov_timer(struct work_struct *work)
+{
+	struct cpufreq_gov_cpu *gcpu =
+		container_of(work, struct cpufreq_gov_cpu, work.work);
+	struct cpufreq_gov *gov = gcpu->gov;
+	struct cpufreq_policy *policy = gcpu->cur_policy;
+	int delay;
+
+	mutex_lock(&gcpu->timer_mutex);
+
+	if (gcpu->sub_sample) {
+		/* second part of a period split by select() */
+		gcpu->sub_sample = 0;
+		__cpufreq_driver_target(policy, gcpu->freq_lo,
+					CPUFREQ_RELATION_H);
+		delay = gov_sampling_delay(gcpu);
+	} else {
+		/* after select(), which may have changed rate_mult */
+		gov_check_cpu(gcpu, false);
+		delay = gov_sampling_delay(gcpu);
+		if (gcpu->freq_lo) {
+			gcpu->sub_sample = 1;
+			delay = gcpu->freq_hi_jiffies;
+		}
+	}
+
+	/*
+	 * The work is deferrable. Should this cpu go idle above the lowest
+	 * frequency, make sure it still wakes up to lower it.
+	 */
+	if (gov->timer_slack && policy->cur > policy->min)
+		mod_timer_pinned(&gcpu->slack_timer, jiffies + delay +
+				 usecs_to_jiffies(gov->timer_slack));
+	else
+		del_timer(&gcpu->slack_timer);
+
+	queue_delayed_work_on(gcpu->cpu, kgovernor_wq, &gcpu->work, delay);
+	mutex_unlock(&gcpu->timer_mutex);
+}
+
+static void gov_slack_timer(unsigned long data)
+{
+	/* waking the cpu up is enough, the sampling work is due by now */
+}
+
+static void gov_kick_work(struct work_struct *work)
+{
+	struct cpufreq_gov_cpu *gcpu =
+		container_of(work, struct cpufreq_gov_cpu, kick_work);
+
+	mutex_lock(&gcpu->timer_mutex);
+	/* the second part of a split period is due shortly anyway */
+	if (gcpu->enable && !gcpu->sub_sample) {
+		gov_check_cpu(gcpu, true);
+		/* only the periodic sample splits its period */
+		gcpu->freq_lo = 0;
+	}
+	mutex_unlock(&gcpu->timer_mutex);
+}
+
+/*
+ * Called by the scheduler with the runqueue lock held. Queueing the
+ * sample from here would wake the worker and take a runqueue lock, so
+ * a timer kicks it from softirq instead.
+ */
+static void gov_util_hook(struct sched_util_hook *hook, int cpu,
+			  unsigned long util)
+{
+	struct cpufreq_gov_cpu *gcpu =
+		container_of(hook, struct cpufreq_gov_cpu, util_hook);
+	struct cpufreq_policy *policy = gcpu->cur_policy;
+	unsigned long capacity;
+
+	if (util <= gcpu->util_base || timer_pending(&gcpu->util_timer))
+		return;
+
+	/* the utilization a busy cpu reaches at the current frequency */
+	capacity = SCHED_UTIL_SCALE * policy->cur / policy->max;
+	if ((util - gcpu->util_base) * 100 < gcpu->gov->util_kick * capacity)
+		return;
+
+	gcpu->util_base = util;
+	mod_timer_pinned(&gcpu->util_timer, jiffies);
+}
+
+static void gov_util_timer(unsigned long data)
+{
+	cpufreq_gov_kick(data);
+}
+
+static inline void gov_timer_init(struct cpufreq_gov_cpu *gcpu)
+{
+	struct cpufreq_gov *gov = gcpu->gov;
+	int delay;
+
+	if (gov->start_delay)
+		delay = usecs_to_jiffies(gov->start_delay);
+	else
+		delay = gov_sampling_delay(gcpu);
+
+	gcpu->sub_sample = 0;
+	gcpu->enable = 1;
+	INIT_DELAYED_WORK_DEFERRABLE(&gcpu->work, gov_timer);
+	queue_delayed_work_on(gcpu->cpu, kgovernor_wq, &gcpu->work, delay);
+}
+
+static inline void gov_timer_exit(struct cpufreq_gov_cpu *gcpu)
+{
+	gcpu->enable = 0;
+	cancel_delayed_work_sync(&gcpu->work);
+	cancel_work_sync(&gcpu->kick_work);
+	del_timer_sync(&gcpu->slack_timer);
+}
+
+/* keep track of frequency transitions done behind our back */
+static int gov_cpufreq_notifier(struct notifier_block *nb, unsigned long val,
+				void *data)
+{
+	struct cpufreq_freqs *freq = data;
+	struct cpufreq_policy *policy;
+	struct cpufreq_gov_cpu *gcpu;
+
+	if (val != CPUFREQ_POSTCHANGE)
+		return 0;
+
+	gcpu = per_cpu(gov_cpu_active, freq->cpu);
+	if (!gcpu || !gcpu->enable)
+		return 0;
+
+	policy = gcpu->cur_policy;
+
+	/*
+	 * we only care if our internally tracked freq moves outside
+	 * the 'valid' ranges of freqency available to us otherwise
+	 * we do not change it
+	 */
+	if (gcpu->requested_freq > policy->max ||
+	    gcpu->requested_freq < policy->min)
+		gcpu->requested_freq = freq->new;
+
+	return 0;
+}
+
+static struct notifier_block gov_cpufreq_notifier_block = {
+	.notifier_call = gov_cpufreq_notifier,
+};
+
+/************************** sysfs interface ************************/
+/*
+ * A per policy directory finds its governor in policy->governor_data.
+ * A global one gets its own copy of the common global_attrs, each
+ * pointing back to the governor.
+ */
+struct gov_global_attr {
+	struct global_attr attr;
+	struct cpufreq_gov *gov;
+};
+
+static inline struct cpufreq_gov *to_gov(struct attribute *attr)
+{
+	return container_of(attr, struct gov_global_attr, attr.attr)->gov;
+}
+
+#define show_gov(_name)							\
+static ssize_t show_##_name##_policy(struct cpufreq_policy *policy,	\
+				     char *buf)				\
+{									\
+	return show_##_name(cpufreq_gov_of(policy), buf);		\
+}									\
+static ssize_t show_##_name##_global(struct kobject *kobj,		\
+				     struct attribute *attr, char *buf)	\
+{									\
+	return show_##_name(to_gov(attr), buf);				\
+}
+
+#define store_gov(_name)						\
+static ssize_t store_##_name##_policy(struct cpufreq_policy *policy,	\
+				      const char *buf, size_t count)	\
+{									\
+	return store_##_name(cpufreq_gov_of(policy), buf, count);	\
+}									\
+static ssize_t store_##_name##_global(struct kobject *kobj,		\
+				      struct attribute *attr,		\
+				      const char *buf, size_t count)	\
+{									\
+	return store_##_name(to_gov(attr), buf, count);			\
+}
+
+#define define_gov_ro(_name)						\
+show_gov(_name)								\
+static struct freq_attr _name##_policy =				\
+	__ATTR(_name, 0444, show_##_name##_policy, NULL);		\
+static struct global_attr _name##_global =				\
+	__ATTR(_name, 0444, show_##_name##_global, NULL)
+
+#define define_gov_rw(_name)						\
+show_gov(_name)								\
+store_gov(_name)							\
+static struct freq_attr _name##_policy =				\
+	__ATTR(_name, 0644, show_##_name##_policy,			\
+	       store_##_name##_policy);					\
+static struct global_attr _name##_global =				\
+	__ATTR(_name, 0644, show_##_name##_global,			\
+	       store_##_name##_global)
+
+static ssize_t show_sampling_rate_min(struct cpufreq_gov *gov, char *buf)
+{
+	return sprintf(buf, "%u\n", gov->min_sampling_rate);
+}
+
+static ssize_t show_sampling_rate(struct cpufreq_gov *gov, char *buf)
+{
+	return sprintf(buf, "%u\n", gov->sampling_rate);
+}
+
+static ssize_t store_sampling_rate(struct cpufreq_gov *gov,
+				   const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+
+	ret = sscanf(buf, "%u", &input);
+	if (ret != 1)
+		return -EINVAL;
+
+	mutex_lock(&gov->mutex);
+	gov->sampling_rate = max(input, gov->min_sampling_rate);
+	mutex_unlock(&gov->mutex);
+
+	return count;
+}
+
+static ssize_t show_ignore_nice_load(struct cpufreq_gov *gov, char *buf)
+{
+	return sprintf(buf, "%u\n", gov->ignore_nice);
+}
+
+static ssize_t store_ignore_nice_load(struct cpufreq_gov *gov,
+				      const char *buf, size_t count)
+{
+	unsigned int input;
+	unsigned int j;
+	int ret;
+
+	ret = sscanf(buf, "%u", &input);
+	if (ret != 1)
+		return -EINVAL;
+
+	if (input > 1)
+		input = 1;
+
+	mutex_lock(&gov->mutex);
+	if (input == gov->ignore_nice) { /* nothing to do */
+		mutex_unlock(&gov->mutex);
+		return count;
+	}
+	gov->ignore_nice = input;
+
+	/* we need to re-evaluate prev_cpu_idle */
+	for_each_online_cpu(j)
+		gov_reset_idle(gov, j);
+	mutex_unlock(&gov->mutex);
+
+	return count;
+}
+
+/* one line for each policy running the governor */
+static ssize_t show_stats(struct cpufreq_gov *gov, char *buf)
+{
+	ssize_t len = 0;
+	unsigned int j;
+
+	for_each_online_cpu(j) {
+		struct cpufreq_gov_cpu *gcpu = cpufreq_gov_cpu(gov, j);
+
+		if (!gcpu->enable)
+			continue;
+
+		len += sprintf(buf + len, "cpu%u samples %lu skipped %lu "
+			       "transitions %lu load %u\n", j, gcpu->samples,
+			       gcpu->skipped, gcpu->transitions, gcpu->load);
+	}
+
+	return len;
+}
+
+define_gov_ro(sampling_rate_min);
+define_gov_rw(sampling_rate);
+define_gov_rw(ignore_nice_load);
+define_gov_ro(stats);
+
+static struct attribute *gov_common_attributes[] = {
+	&sampling_rate_min_policy.attr,
+	&sampling_rate_policy.attr,
+	&ignore_nice_load_policy.attr,
+	&stats_policy.attr,
+	NULL
+};
+
+static struct global_attr *gov_common_global_attributes[] = {
+	&sampling_rate_min_global,
+	&sampling_rate_global,
+	&ignore_nice_load_global,
+	&stats_global,
+};
+
+/************************** sysfs end ************************/
+
+static inline struct kobject *gov_kobj(struct cpufreq_gov *gov,
+				       struct cpufreq_policy *policy)
+{
+	return gov->sysfs_global ? cpufreq_global_kobject : &policy->kobj;
+}
+
+static int gov_start(struct cpufreq_gov *gov, struct cpufreq_policy *policy)
+{
+	unsigned int cpu = policy->cpu;
+	struct cpufreq_gov_cpu *gcpu = cpufreq_gov_cpu(gov, cpu);
+	unsigned int j;
+	int rc = 0;
+
+	if ((!cpu_online(cpu)) || (!policy->cur))
+		return -EINVAL;
+
+	policy->governor_data = gov;
+
+	mutex_lock(&gov->mutex);
+
+	/* a global directory is shared by all policies */
+	if (!gov->sysfs_global || !gov->enable)
+		rc = sysfs_create_group(gov_kobj(gov, policy),
+					&gov->attr_group);
+	if (rc) {
+		mutex_unlock(&gov->mutex);
+		policy->governor_data = NULL;
+		return rc;
+	}
+
+	for_each_cpu(j, policy->cpus) {
+		struct cpufreq_gov_cpu *j_gcpu = cpufreq_gov_cpu(gov, j);
+
+		j_gcpu->cur_policy = policy;
+		gov_reset_idle(gov, j);
+		per_cpu(gov_cpu_active, j) = gcpu;
+		if (gov->util_kick) {
+			j_gcpu->util_base = sched_cpu_util(j);
+			sched_util_set_hook(j, &j_gcpu->util_hook);
+		}
+	}
+	gcpu->down_skip = 0;
+	gcpu->rate_mult = 1;
+	gcpu->requested_freq = policy->cur;
+	gcpu->samples = 0;
+	gcpu->skipped = 0;
+	gcpu->transitions = 0;
+
+	mutex_init(&gcpu->timer_mutex);
+	gov->enable++;
+
+	/* first user of this governor: derive the sampling rate */
+	if (gov->enable == 1) {
+		unsigned int latency;
+		/* policy latency is in nS. Convert it to uS first */
+		latency = policy->cpuinfo.transition_latency / 1000;
+		if (latency == 0)
+			latency = 1;
+
+		if (!gov->min_sampling_rate)
+			gov->min_sampling_rate =
+				MIN_SAMPLING_RATE_RATIO * jiffies_to_usecs(10);
+		/* Bring kernel and HW constraints together */
+		gov->min_sampling_rate = max(gov->min_sampling_rate,
+				MIN_LATENCY_MULTIPLIER * latency);
+		if (!gov->sampling_rate)
+			gov->sampling_rate = max(gov->min_sampling_rate,
+					latency * LATENCY_MULTIPLIER);
+	}
+	mutex_unlock(&gov->mutex);
+
+	mutex_lock(&gov_core_mutex);
+	if (gov_core_enable++ == 0)
+		cpufreq_register_notifier(&gov_cpufreq_notifier_block,
+					  CPUFREQ_TRANSITION_NOTIFIER);
+	mutex_unlock(&gov_core_mutex);
+
+	if (gov->ops->start)
+		gov->ops->start(gcpu);
+
+	gov_timer_init(gcpu);
+
+	return 0;
+}
+
+static void gov_stop(struct cpufreq_gov *gov, struct cpufreq_policy *policy)
+{
+	struct cpufreq_gov_cpu *gcpu = cpufreq_gov_cpu(gov, policy->cpu);
+	unsigned int j;
+	bool remove;
+
+	/* no more kicks or notifier updates once the work is cancelled */
+	for_each_cpu(j, policy->cpus) {
+		if (gov->util_kick) {
+			sched_util_clear_hook(j);
+			del_timer_sync(&cpufreq_gov_cpu(gov, j)->util_timer);
+		}
+		per_cpu(gov_cpu_active, j) = NULL;
+	}
+
+	gov_timer_exit(gcpu);
+
+	if (gov->ops->stop)
+		gov->ops->stop(gcpu);
+
+	mutex_lock(&gov->mutex);
+	gov->enable--;
+	remove = !gov->sysfs_global || !gov->enable;
+	mutex_destroy(&gcpu->timer_mutex);
+	mutex_unlock(&gov->mutex);
+
+	/* not under gov->mutex, the stores take it */
+	if (remove)
+		sysfs_remove_group(gov_kobj(gov, policy), &gov->attr_group);
+	policy->governor_data = NULL;
+
+	mutex_lock(&gov_core_mutex);
+	if (--gov_core_enable == 0)
+		cpufreq_unregister_notifier(&gov_cpufreq_notifier_block,
+					    CPUFREQ_TRANSITION_NOTIFIER);
+	mutex_unlock(&gov_core_mutex);
+}
+
+static void gov_limits(struct cpufreq_gov *gov, struct cpufreq_policy *policy)
+{
+	struct cpufreq_gov_cpu *gcpu = cpufreq_gov_cpu(gov, policy->cpu);
+
+	mutex_lock(&gcpu->timer_mutex);
+	if (policy->max < gcpu->cur_policy->cur)
+		__cpufreq_driver_target(gcpu->cur_policy,
+				policy->max, CPUFREQ_RELATION_H);
+	else if (policy->min > gcpu->cur_policy->cur)
+		__cpufreq_driver_target(gcpu->cur_policy,
+				policy->min, CPUFREQ_RELATION_L);
+	mutex_unlock(&gcpu->timer_mutex);
+}
+
+/*
+ * The ->governor callback of each governor built on the core, called
+ * with its own struct cpufreq_gov.
+ */
+int cpufreq_gov_event(struct cpufreq_gov *gov, struct cpufreq_policy *policy,
+		      unsigned int event)
+{
+	switch (event) {
+	case CPUFREQ_GOV_START:
+		return gov_start(gov, policy);
+	case CPUFREQ_GOV_STOP:
+		gov_stop(gov, policy);
+		break;
+	case CPUFREQ_GOV_LIMITS:
+		gov_limits(gov, policy);
+		break;
+	}
+	return 0;
+}
+EXPORT_SYMBOL_GPL(cpufreq_gov_event);
+
+/*
+ * Sample the policy of @cpu now rather than at the end of the period,
+ * if a core governor runs it. Callable from atomic context.
+ */
+void cpufreq_gov_kick(unsigned int cpu)
+{
+	struct cpufreq_gov_cpu *gcpu = per_cpu(gov_cpu_active, cpu);
+
+	if (gcpu && gcpu->enable)
+		queue_work_on(gcpu->cpu, kgovernor_wq, &gcpu->kick_work);
+}
+EXPORT_SYMBOL_GPL(cpufreq_gov_kick);
+
+int cpufreq_gov_register(struct cpufreq_gov *gov)
+{
+	unsigned int ncommon = ARRAY_SIZE(gov_common_attributes) - 1;
+	unsigned int nattrs = 0;
+	struct attribute **attrs;
+	unsigned int i;
+	int err = -ENOMEM;
+
+	if (!gov->governor || !gov->governor->governor ||
+	    !gov->ops || !gov->ops->select)
+		return -EINVAL;
+
+	while (gov->attrs && gov->attrs[nattrs])
+		nattrs++;
+
+	attrs = kcalloc(ncommon + nattrs + 1, sizeof(*attrs), GFP_KERNEL);
+	if (!attrs)
+		return -ENOMEM;
+
+	if (gov->sysfs_global) {
+		gov->global_attrs = kcalloc(ncommon,
+					    sizeof(*gov->global_attrs),
+					    GFP_KERNEL);
+		if (!gov->global_attrs)
+			goto err_attrs;
+
+		for (i = 0; i < ncommon; i++) {
+			struct gov_global_attr *ga = &gov->global_attrs[i];
+
+			ga->attr = *gov_common_global_attributes[i];
+			sysfs_attr_init(&ga->attr.attr);
+			ga->gov = gov;
+			attrs[i] = &ga->attr.attr;
+		}
+	} else {
+		for (i = 0; i < ncommon; i++)
+			attrs[i] = gov_common_attributes[i];
+	}
+	for (i = 0; i < nattrs; i++)
+		attrs[ncommon + i] = gov->attrs[i];
+
+	gov->cpu_data = alloc_percpu(struct cpufreq_gov_cpu);
+	if (!gov->cpu_data)
+		goto err_global;
+
+	for_each_possible_cpu(i) {
+		struct cpufreq_gov_cpu *gcpu = cpufreq_gov_cpu(gov, i);
+
+		gcpu->gov = gov;
+		gcpu->cpu = i;
+		INIT_WORK(&gcpu->kick_work, gov_kick_work);
+		setup_timer(&gcpu->slack_timer, gov_slack_timer, i);
+		setup_timer(&gcpu->util_timer, gov_util_timer, i);
+		gcpu->util_hook.func = gov_util_hook;
+	}
+
+	gov->attr_group.name = gov->sysfs_name ? gov->sysfs_name :
+			       gov->governor->name;
+	gov->attr_group.attrs = attrs;
+	mutex_init(&gov->mutex);
+
+	err = cpufreq_register_governor(gov->governor);
+	if (err)
+		goto err_percpu;
+
+	return 0;
+
+err_percpu:
+	free_percpu(gov->cpu_data);
+err_global:
+	kfree(gov->global_attrs);
+	gov->global_attrs = NULL;
+err_attrs:
+	kfree(attrs);
+	return err;
+}
+EXPORT_SYMBOL_GPL(cpufreq_gov_register);
+
+void cpufreq_gov_unregister(struct cpufreq_gov *gov)
+{
+	cpufreq_unregister_governor(gov->governor);
+
+	free_percpu(gov->cpu_data);
+	kfree(gov->global_attrs);
+	gov->global_attrs = NULL;
+	kfree(gov->attr_group.attrs);
+}
+EXPORT_SYMBOL_GPL(cpufreq_gov_unregister);
+
+static int __init cpufreq_gov_core_init(void)
+{
+	kgovernor_wq = create_workqueue("kgovernor");
+	if (!kgovernor_wq) {
+		printk(KERN_ERR "Creation of kgovernor failed\n");
+		return -EFAULT;
+	}
+
+	return 0;
+}
+core_initcall(cpufreq_gov_core_init);
@@ -0,0 +1,168 @@
+/*
+ *  drivers/cpufreq/cpufreq_governor.h
+ *
+ *  Common sampling core for the load based cpufreq governors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _CPUFREQ_GOVERNOR_H
+#define _CPUFREQ_GOVERNOR_H
+
+#include <linux/cpufreq.h>
+#include <linux/workqueue.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/sysfs.h>
+#include <linux/timer.h>
+#include <asm/cputime.h>
+
+struct cpufreq_gov;
+struct gov_global_attr;
+
+/* Per cpu sampling state, owned by the core */
+struct cpufreq_gov_cpu {
+	cputime64_t prev_cpu_idle;
+	cputime64_t prev_cpu_iowait;
+	cputime64_t prev_cpu_wall;
+	cputime64_t prev_cpu_nice;
+	struct cpufreq_policy *cur_policy;
+	struct cpufreq_gov *gov;
+	struct delayed_work work;
+	/* an immediate sample, see cpufreq_gov_kick() */
+	struct work_struct kick_work;
+	/* wakes an idle policy cpu left above the lowest frequency */
+	struct timer_list slack_timer;
+	/* scheduler utilization of this cpu, see cpufreq_gov::util_kick */
+	struct sched_util_hook util_hook;
+	struct timer_list util_timer;
+	/* sched_cpu_util() of this cpu at the last sample */
+	unsigned long util_base;
+	/*
+	 * serializes governor limit changes with the sampling work, so the
+	 * policy callback never runs while limits are being updated.
+	 */
+	struct mutex timer_mutex;
+	unsigned int requested_freq;
+	/*
+	 * relation the frequency returned by select() is rounded with,
+	 * CPUFREQ_RELATION_H unless select() says otherwise
+	 */
+	unsigned int relation;
+	/*
+	 * select() may split the coming period: the frequency it returns
+	 * for freq_hi_jiffies, then freq_lo for the rest of it. 0 freq_lo
+	 * keeps the whole period at one frequency.
+	 */
+	unsigned int freq_lo;
+	unsigned int freq_hi_jiffies;
+	/*
+	 * the next sample is rate_mult sampling periods away, 1 after
+	 * start; select() may change it to hold its frequency longer
+	 */
+	unsigned int rate_mult;
+	/* length of the sampling window the load was measured over, in us */
+	unsigned int window;
+	unsigned int down_skip;
+	unsigned int load;
+	unsigned long samples;
+	/* samples that found the policy idle at its lowest frequency */
+	unsigned long skipped;
+	unsigned long transitions;
+	int cpu;
+	unsigned int enable:1;
+	unsigned int sub_sample:1;
+};
+
+struct cpufreq_gov_ops {
+	/*
+	 * Called every sampling period with the highest load (0..100) seen
+	 * on the cpus of the policy. Returns the frequency to request or
+	 * 0 to keep the current request.
+	 */
+	unsigned int (*select)(struct cpufreq_gov_cpu *gcpu, unsigned int load);
+	/* optional, called on governor start/stop for the policy cpu */
+	void (*start)(struct cpufreq_gov_cpu *gcpu);
+	void (*stop)(struct cpufreq_gov_cpu *gcpu);
+};
+
+struct cpufreq_gov {
+	/*
+	 * the governor stays a separate object so the existing
+	 * CPUFREQ_DEFAULT_GOVERNOR declarations in <linux/cpufreq.h> keep
+	 * working; its ->governor callback passes its events on to
+	 * cpufreq_gov_event().
+	 */
+	struct cpufreq_governor *governor;
+	const struct cpufreq_gov_ops *ops;
+	/*
+	 * governor specific tunables, appended to the common ones: global_attrs
+	 * if sysfs_global is set, freq_attrs otherwise
+	 */
+	struct attribute **attrs;
+	/* sysfs directory name, defaults to the governor name */
+	const char *sysfs_name;
+	/*
+	 * the directory lives in /sys/devices/system/cpu/cpufreq rather than
+	 * under each policy
+	 */
+	unsigned int sysfs_global:1;
+
+	/*
+	 * common tunables; a governor may preset them, 0 picks the core
+	 * defaults derived from the transition latency
+	 */
+	unsigned int sampling_rate;
+	unsigned int min_sampling_rate;
+	unsigned int ignore_nice;
+	/* iowait counts as busy time */
+	unsigned int io_is_busy;
+	/* us before the first sample after start, 0 for one period */
+	unsigned int start_delay;
+	/*
+	 * us an idle policy cpu may hold a frequency above the lowest one
+	 * before it is woken up to sample, 0 lets it sleep through
+	 */
+	unsigned int timer_slack;
+	/*
+	 * sample at once when the scheduler utilization of a cpu rose by
+	 * this percentage of what the current frequency can do since the
+	 * last sample, 0 only samples on the timer
+	 */
+	unsigned int util_kick;
+	/*
+	 * select() does more than pick a frequency, e.g. cpu hotplug, and
+	 * is called on idle samples at the lowest frequency as well
+	 */
+	unsigned int sample_idle:1;
+
+	/* private to the core */
+	struct cpufreq_gov_cpu __percpu *cpu_data;
+	struct attribute_group attr_group;
+	struct gov_global_attr *global_attrs;
+	struct mutex mutex;
+	unsigned int enable;
+};
+
+static inline struct cpufreq_gov_cpu *cpufreq_gov_cpu(struct cpufreq_gov *gov,
+						      unsigned int cpu)
+{
+	return per_cpu_ptr(gov->cpu_data, cpu);
+}
+
+/* the core governor running the policy, valid between start and stop */
+static inline struct cpufreq_gov *cpufreq_gov_of(struct cpufreq_policy *policy)
+{
+	return policy->governor_data;
+}
+
+int cpufreq_gov_event(struct cpufreq_gov *gov, struct cpufreq_policy *policy,
+		      unsigned int event);
+void cpufreq_gov_kick(unsigned int cpu);
+int cpufreq_gov_register(struct cpufreq_gov *gov);
+void cpufreq_gov_unregister(struct cpufreq_gov *gov);
+
+#endif /* _CPUFREQ_GOVERNOR_H */
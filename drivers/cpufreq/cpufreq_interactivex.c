@@ -16,41 +16,37 @@
  *
  */
 
+#include <linux/module.h>
 #include <linux/cpu.h>
 #include <linux/cpumask.h>
 #include <linux/cpufreq.h>
+#include <linux/jiffies.h>
 #include <linux/mutex.h>
 #include <linux/sched.h>
-#include <linux/tick.h>
-#include <linux/timer.h>
 #include <linux/workqueue.h>
 #include <linux/earlysuspend.h>
 
-#include <asm/cputime.h>
+#include "cpufreq_governor.h"
 
-static void (*pm_idle_old)(void);
 static atomic_t active_count = ATOMIC_INIT(0);
 
-static DEFINE_PER_CPU(struct timer_list, cpu_timer);
-
-static DEFINE_PER_CPU(u64, time_in_idle);
-static DEFINE_PER_CPU(u64, idle_exit_time);
-
-static struct cpufreq_policy *policy;
-static unsigned int target_freq;
-
-/* Workqueues handle frequency scaling */
-static struct workqueue_struct *up_wq;
-static struct workqueue_struct *down_wq;
-static struct work_struct freq_scale_work;
-
-static u64 freq_change_time;
-static u64 freq_change_time_in_idle;
+/*
+ * Sampling, idle accounting and the timers are done by the common
+ * governor core, every two ticks. What is kept here is how long the
+ * policy has been at its current frequency and how busy it was since.
+ */
+struct cpufreq_interactiveX_cpuinfo {
+	unsigned int freq;
+	/* us, busy time is scaled to the load of the busiest cpu */
+	unsigned int time_since_change;
+	unsigned int busy_since_change;
+};
 
-static cpumask_t work_cpumask;
+static DEFINE_PER_CPU(struct cpufreq_interactiveX_cpuinfo, cpuinfo);
 
 static unsigned int suspended = 0;
-static unsigned int enabled = 0;
+/* the screen went on or off since the last sample */
+static unsigned int suspend_changed;
 
 static unsigned int suspendfreq = 200000;
 
@@ -63,6 +59,12 @@ static unsigned int samples = 0;
 #define DEFAULT_MIN_SAMPLE_TIME 40000;
 static unsigned long min_sample_time;
 
+/*
+ * Sample at once when the scheduler sees the utilization of a cpu rise by
+ * this percentage of the current speed, instead of at the next timer.
+ */
+#define DEFAULT_UTIL_KICK 10
+
 static unsigned int freq_threshold = 1200000;
 static unsigned int resume_speed = 800000;
 
@@ -79,160 +81,109 @@ struct cpufreq_governor cpufreq_gov_interactiveX = {
 	.owner = THIS_MODULE,
 };
 
-static void cpufreq_interactiveX_timer(unsigned long data)
+static struct cpufreq_gov interactiveX_gov;
+
+/*
+ * Choose the cpu frequency based off the load since the last frequency
+ * change. For now choose the minimum frequency that will satisfy the load,
+ * which is not always the lower power.
+ */
+static unsigned int cpufreq_interactiveX_calc_freq(struct cpufreq_policy *policy,
+		struct cpufreq_interactiveX_cpuinfo *pcpu)
 {
-	u64 delta_idle;
-	u64 update_time;
-	u64 *cpu_time_in_idle;
-	u64 *cpu_idle_exit_time;
-	struct timer_list *t;
+	unsigned int cpu_load;
 
-	u64 now_idle = get_cpu_idle_time_us(data,
-						&update_time);
+	if (pcpu->time_since_change < 100)
+		return policy->cur;
 
+	cpu_load = pcpu->busy_since_change / (pcpu->time_since_change / 100);
 
-	cpu_time_in_idle = &per_cpu(time_in_idle, data);
-	cpu_idle_exit_time = &per_cpu(idle_exit_time, data);
+	return policy->cur * cpu_load / 100;
+}
 
-	if (update_time == *cpu_idle_exit_time)
-		return;
+static unsigned int cpufreq_interactiveX_select(struct cpufreq_gov_cpu *gcpu,
+						unsigned int load)
+{
+	struct cpufreq_policy *policy = gcpu->cur_policy;
+	struct cpufreq_interactiveX_cpuinfo *pcpu =
+		&per_cpu(cpuinfo, gcpu->cpu);
+	unsigned int target_freq;
+
+	/* a new frequency took effect since the last sample */
+	if (pcpu->freq != policy->cur) {
+		pcpu->freq = policy->cur;
+		pcpu->time_since_change = 0;
+		pcpu->busy_since_change = 0;
+	}
+	if (pcpu->time_since_change < UINT_MAX - gcpu->window) {
+		pcpu->time_since_change += gcpu->window;
+		pcpu->busy_since_change += gcpu->window / 100 * load;
+	}
 
-	delta_idle = cputime64_sub(now_idle, *cpu_time_in_idle);
+	if (xchg(&suspend_changed, 0)) {
+		pcpu->time_since_change = 0;
+		pcpu->busy_since_change = 0;
+		if (!suspended) { // resume at max speed:
+			pr_info("[imoseyon] interactiveX awake at %d\n", resume_speed);
+			gcpu->relation = CPUFREQ_RELATION_L;
+			return resume_speed;
+		}
+		pr_info("[imoseyon] interactiveX suspended at %d\n", suspendfreq);
+		return suspendfreq;
+	}
 
-	/* Scale up if there were no idle cycles since coming out of idle */
-	if (delta_idle == 0) {
+	/* Scale up if there were no idle cycles since the last sample */
+	if (load == 100) {
 		if (policy->cur == policy->max)
-			return;
-
-		if (nr_running() < 1)
-			return;
+			return 0;
 
 		// imoseyon - when over 1.8Ghz jump less
 		if (policy->max > freq_threshold) {
 			if (samples > 0) {
 			  target_freq = policy->max;
 			  samples = 0;
-			} else { 
+			} else {
 			  samples++;
 			  target_freq = freq_threshold;
-			}  
+			}
 		} else target_freq = policy->max;
 
-		cpumask_set_cpu(data, &work_cpumask);
-		queue_work(up_wq, &freq_scale_work);
-		return;
-	}
-	samples = 0; // reset sample counter
-	/*
-	 * There is a window where if the cpu utlization can go from low to high
-	 * between the timer expiring, delta_idle will be > 0 and the cpu will
-	 * be 100% busy, preventing idle from running, and this timer from
-	 * firing. So setup another timer to fire to check cpu utlization.
-	 * Do not setup the timer if there is no scheduled work.
-	 */
-	t = &per_cpu(cpu_timer, data);
-	if (!timer_pending(t) && nr_running() > 0) {
-			*cpu_time_in_idle = get_cpu_idle_time_us(
-					data, cpu_idle_exit_time);
-			mod_timer(t, jiffies + 2);
-	}
-
-	if (policy->cur == policy->min)
-		return;
-
-	/*
-	 * Do not scale down unless we have been at this frequency for the
-	 * minimum sample time.
-	 */
-	if (cputime64_sub(update_time, freq_change_time) < min_sample_time)
-		return;
-
-	target_freq = policy->min;
-	cpumask_set_cpu(data, &work_cpumask);
-	queue_work(down_wq, &freq_scale_work);
-}
-
-static void cpufreq_idle(void)
-{
-	struct timer_list *t;
-	u64 *cpu_time_in_idle;
-	u64 *cpu_idle_exit_time;
-
-	pm_idle_old();
-
-	if (!cpumask_test_cpu(smp_processor_id(), policy->cpus))
-			return;
-
-	/* Timer to fire in 1-2 ticks, jiffie aligned. */
-	t = &per_cpu(cpu_timer, smp_processor_id());
-	cpu_idle_exit_time = &per_cpu(idle_exit_time, smp_processor_id());
-	cpu_time_in_idle = &per_cpu(time_in_idle, smp_processor_id());
-
-	if (timer_pending(t) == 0) {
-		*cpu_time_in_idle = get_cpu_idle_time_us(
-				smp_processor_id(), cpu_idle_exit_time);
-		mod_timer(t, jiffies + 2);
-	}
-}
-
-/*
- * Choose the cpu frequency based off the load. For now choose the minimum
- * frequency that will satisfy the load, which is not always the lower power.
- */
-static unsigned int cpufreq_interactiveX_calc_freq(unsigned int cpu)
-{
-	unsigned int delta_time;
-	unsigned int idle_time;
-	unsigned int cpu_load;
-	unsigned int newfreq;
-	u64 current_wall_time;
-	u64 current_idle_time;;
-
-	current_idle_time = get_cpu_idle_time_us(cpu, &current_wall_time);
-
-	idle_time = (unsigned int) current_idle_time - freq_change_time_in_idle;
-	delta_time = (unsigned int) current_wall_time - freq_change_time;
-
-	cpu_load = 100 * (delta_time - idle_time) / delta_time;
-
-	newfreq = policy->cur * cpu_load / 100;	
-
-	return newfreq;
-}
+		if (suspended) {
+			// special care when suspended
+			if (target_freq > suspendfreq)
+				target_freq = suspendfreq;
+		} else if (nr_running() <= 1) {
+			/* the sampling work itself is one of the running tasks */
+			return 0;
+		}
+	} else {
+		samples = 0; // reset sample counter
 
+		if (policy->cur == policy->min)
+			return 0;
 
-/* We use the same work function to sale up and down */
-static void cpufreq_interactiveX_freq_change_time_work(struct work_struct *work)
-{
-	unsigned int cpu;
-	cpumask_t tmp_mask = work_cpumask;
+		/*
+		 * Do not scale down unless we have been at this frequency for the
+		 * minimum sample time.
+		 */
+		if (pcpu->time_since_change < min_sample_time)
+			return 0;
 
-	for_each_cpu(cpu, &tmp_mask) {
-		if (!suspended && (target_freq == policy->max || target_freq == freq_threshold)) {
-			if (nr_running() == 1) {
-				cpumask_clear_cpu(cpu, &work_cpumask);
-				return;
-			}
-			__cpufreq_driver_target(policy, target_freq, CPUFREQ_RELATION_H);
-		} else {
-			if (!suspended) {
-		  	  target_freq = cpufreq_interactiveX_calc_freq(cpu);
-			  __cpufreq_driver_target(policy, target_freq, CPUFREQ_RELATION_L);
-			} else {  // special care when suspended
-			  if (target_freq > suspendfreq) {
-			     __cpufreq_driver_target(policy, suspendfreq, CPUFREQ_RELATION_H);
-			  } else {
-		  	    target_freq = cpufreq_interactiveX_calc_freq(cpu);
-			    if (target_freq < policy->cur) 
-			      __cpufreq_driver_target(policy, target_freq, CPUFREQ_RELATION_H);
-			  }
-		       }
-		}
-	  freq_change_time_in_idle = get_cpu_idle_time_us(cpu, &freq_change_time);
-	  cpumask_clear_cpu(cpu, &work_cpumask);
+		target_freq = cpufreq_interactiveX_calc_freq(policy, pcpu);
+		/* 0 would keep the current speed */
+		if (target_freq < policy->min)
+			target_freq = policy->min;
+		if (!suspended)
+			gcpu->relation = CPUFREQ_RELATION_L;
+		else if (target_freq >= policy->cur)
+			target_freq = 0;
+
+		/* the load is measured afresh from here */
+		pcpu->time_since_change = 0;
+		pcpu->busy_since_change = 0;
 	}
 
-
+	return target_freq;
 }
 
 static ssize_t show_min_sample_time(struct kobject *kobj,
@@ -244,7 +195,14 @@ static ssize_t show_min_sample_time(struct kobject *kobj,
 static ssize_t store_min_sample_time(struct kobject *kobj,
 			struct attribute *attr, const char *buf, size_t count)
 {
-	return strict_strtoul(buf, 0, &min_sample_time);
+	unsigned long val;
+
+	if (strict_strtoul(buf, 0, &val))
+		return -EINVAL;
+	min_sample_time = val;
+	/* an idle cpu is woken up to ramp down once it may */
+	interactiveX_gov.timer_slack = val;
+	return count;
 }
 
 static struct global_attr min_sample_time_attr = __ATTR(min_sample_time, 0644,
@@ -255,27 +213,14 @@ static struct attribute *interactiveX_attributes[] = {
 	NULL,
 };
 
-static struct attribute_group interactiveX_attr_group = {
-	.attrs = interactiveX_attributes,
-	.name = "interactiveX",
-};
-
 static void interactiveX_suspend(int suspend)
 {
-	unsigned int max_speed;
-
-	max_speed = resume_speed;
-
-	if (!enabled) return;
-        if (!suspend) { // resume at max speed:
-		suspended = 0;
-                __cpufreq_driver_target(policy, max_speed, CPUFREQ_RELATION_L);
-                pr_info("[imoseyon] interactiveX awake at %d\n", policy->cur);
-        } else {
-		suspended = 1;
-                __cpufreq_driver_target(policy, suspendfreq, CPUFREQ_RELATION_H);
-                pr_info("[imoseyon] interactiveX suspended at %d\n", policy->cur);
-        }
+	unsigned int cpu;
+
+	suspended = suspend;
+	suspend_changed = 1;
+	for_each_online_cpu(cpu)
+		cpufreq_gov_kick(cpu);
 }
 
 static void interactiveX_early_suspend(struct early_suspend *handler) {
@@ -292,87 +237,67 @@ static struct early_suspend interactiveX_power_suspend = {
         .level = EARLY_SUSPEND_LEVEL_DISABLE_FB + 1,
 };
 
-static int cpufreq_governor_interactiveX(struct cpufreq_policy *new_policy,
-		unsigned int event)
+static void cpufreq_interactiveX_start(struct cpufreq_gov_cpu *gcpu)
 {
-	int rc;
-	switch (event) {
-	case CPUFREQ_GOV_START:
-		if (!cpu_online(new_policy->cpu))
-			return -EINVAL;
+	struct cpufreq_interactiveX_cpuinfo *pcpu =
+		&per_cpu(cpuinfo, gcpu->cpu);
 
-		/*
-		 * Do not register the idle hook and create sysfs
-		 * entries if we have already done so.
-		 */
-		if (atomic_inc_return(&active_count) > 1)
-			return 0;
+	pcpu->freq = gcpu->cur_policy->cur;
+	pcpu->time_since_change = 0;
+	pcpu->busy_since_change = 0;
 
-		rc = sysfs_create_group(cpufreq_global_kobject,
-				&interactiveX_attr_group);
-		if (rc)
-			return rc;
-
-		pm_idle_old = pm_idle;
-		pm_idle = cpufreq_idle;
-		policy = new_policy;
-		enabled = 1;
-        	register_early_suspend(&interactiveX_power_suspend);
-        	pr_info("[imoseyon] interactiveX active\n");
-		break;
-
-	case CPUFREQ_GOV_STOP:
-		if (atomic_dec_return(&active_count) > 1)
-			return 0;
+	/* Do not register the suspend handlers if we have already done so. */
+	if (atomic_inc_return(&active_count) > 1)
+		return;
 
-		sysfs_remove_group(cpufreq_global_kobject,
-				&interactiveX_attr_group);
-
-		pm_idle = pm_idle_old;
-		del_timer(&per_cpu(cpu_timer, new_policy->cpu));
-		enabled = 0;
-        	unregister_early_suspend(&interactiveX_power_suspend);
-        	pr_info("[imoseyon] interactiveX inactive\n");
-			break;
-
-	case CPUFREQ_GOV_LIMITS:
-		if (new_policy->max < new_policy->cur)
-			__cpufreq_driver_target(new_policy,
-					new_policy->max, CPUFREQ_RELATION_H);
-		else if (new_policy->min > new_policy->cur)
-			__cpufreq_driver_target(new_policy,
-					new_policy->min, CPUFREQ_RELATION_L);
-		break;
-	}
-	return 0;
+	register_early_suspend(&interactiveX_power_suspend);
+	pr_info("[imoseyon] interactiveX active\n");
 }
 
-static int __init cpufreq_interactiveX_init(void)
+static void cpufreq_interactiveX_stop(struct cpufreq_gov_cpu *gcpu)
 {
-	unsigned int i;
-	struct timer_list *t;
-	min_sample_time = DEFAULT_MIN_SAMPLE_TIME;
+	if (atomic_dec_return(&active_count) > 0)
+		return;
 
-	/* Initalize per-cpu timers */
-	for_each_possible_cpu(i) {
-		t = &per_cpu(cpu_timer, i);
-		init_timer_deferrable(t);
-		t->function = cpufreq_interactiveX_timer;
-		t->data = i;
-	}
+	unregister_early_suspend(&interactiveX_power_suspend);
+	pr_info("[imoseyon] interactiveX inactive\n");
+}
 
-	/* Scale up is high priority */
-	up_wq = create_workqueue("kinteractiveX_up");
-	down_wq = create_workqueue("knteractive_down");
+static const struct cpufreq_gov_ops interactiveX_ops = {
+	.select	= cpufreq_interactiveX_select,
+	.start	= cpufreq_interactiveX_start,
+	.stop	= cpufreq_interactiveX_stop,
+};
+
+static struct cpufreq_gov interactiveX_gov = {
+	.governor	= &cpufreq_gov_interactiveX,
+	.ops		= &interactiveX_ops,
+	.attrs		= interactiveX_attributes,
+	.sysfs_global	= 1,
+};
+
+static int cpufreq_governor_interactiveX(struct cpufreq_policy *new_policy,
+		unsigned int event)
+{
+	return cpufreq_gov_event(&interactiveX_gov, new_policy, event);
+}
+
+static int __init cpufreq_interactiveX_init(void)
+{
+	min_sample_time = DEFAULT_MIN_SAMPLE_TIME;
 
-	INIT_WORK(&freq_scale_work, cpufreq_interactiveX_freq_change_time_work);
+	/* sample every two ticks, as the old per cpu timers did */
+	interactiveX_gov.min_sampling_rate = jiffies_to_usecs(2);
+	interactiveX_gov.sampling_rate = jiffies_to_usecs(2);
+	interactiveX_gov.timer_slack = min_sample_time;
+	interactiveX_gov.util_kick = DEFAULT_UTIL_KICK;
 
         pr_info("[imoseyon] interactiveX enter\n");
-	return cpufreq_register_governor(&cpufreq_gov_interactiveX);
+	return cpufreq_gov_register(&interactiveX_gov);
 }
 
 #ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_INTERACTIVEX
-pure_initcall(cpufreq_interactiveX_init);
+fs_initcall(cpufreq_interactiveX_init);
 #else
 module_init(cpufreq_interactiveX_init);
 #endif
@@ -380,9 +305,7 @@ module_init(cpufreq_interactiveX_init);
 static void __exit cpufreq_interactiveX_exit(void)
 {
         pr_info("[imoseyon] interactiveX exit\n");
-	cpufreq_unregister_governor(&cpufreq_gov_interactiveX);
-	destroy_workqueue(up_wq);
-	destroy_workqueue(down_wq);
+	cpufreq_gov_unregister(&interactiveX_gov);
 }
 
 module_exit(cpufreq_interactiveX_exit);
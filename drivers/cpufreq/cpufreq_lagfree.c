@@ -13,23 +13,15 @@
 
 #include <linux/kernel.h>
 #include <linux/module.h>
-#include <linux/smp.h>
 #include <linux/init.h>
-#include <linux/interrupt.h>
-#include <linux/ctype.h>
 #include <linux/cpufreq.h>
-#include <linux/sysctl.h>
-#include <linux/types.h>
-#include <linux/fs.h>
-#include <linux/sysfs.h>
 #include <linux/cpu.h>
-#include <linux/kmod.h>
-#include <linux/workqueue.h>
 #include <linux/jiffies.h>
-#include <linux/kernel_stat.h>
-#include <linux/percpu.h>
 #include <linux/mutex.h>
 #include <linux/earlysuspend.h>
+
+#include "cpufreq_governor.h"
+
 /*
  * dbs is used in this file as a shortform for demandbased switching
  * It helps to keep variable names smaller, simpler
@@ -44,7 +36,7 @@
 
 /*
  * The polling frequency of this governor depends on the capability of
- * the processor. Default polling frequency is 1000 times the transition
+ * the processor. Default polling frequency is 500 times the transition
  * latency of the processor. The governor will work on any processor with
  * transition latency <= 10mS, using appropriate sampling
  * rate.
@@ -54,100 +46,45 @@
  */
 #define MIN_SAMPLING_RATE_RATIO			(1)
 
-static unsigned int min_sampling_rate;
-unsigned int suspended = 0;
+static unsigned int suspended;
 #define LATENCY_MULTIPLIER			(500)
-#define MIN_LATENCY_MULTIPLIER			(100)
 #define DEF_SAMPLING_DOWN_FACTOR		(2)
-#define MAX_SAMPLING_DOWN_FACTOR		(10)
+#define MAX_SAMPLING_DOWN_FACTOR		(25)
 #define TRANSITION_LATENCY_LIMIT		(10 * 1000 * 1000)
 
-static void do_dbs_timer(struct work_struct *work);
+/* number of policies running the governor */
+static atomic_t active_count = ATOMIC_INIT(0);
 
-struct cpu_dbs_info_s {
-	struct cpufreq_policy *cur_policy;
-	unsigned int prev_cpu_idle_up;
-	unsigned int prev_cpu_idle_down;
-	unsigned int enable;
-	unsigned int down_skip;
-	unsigned int requested_freq;
-};
-static DEFINE_PER_CPU(struct cpu_dbs_info_s, cpu_dbs_info);
-
-static unsigned int dbs_enable;	/* number of CPUs using this policy */
+/*
+ * Sum of the loads seen since the last frequency decrease check, the
+ * decrease is decided on their average over sampling_down_factor samples.
+ */
+static DEFINE_PER_CPU(unsigned int, dbs_down_load);
 
 /*
- * DEADLOCK ALERT! There is a ordering requirement between cpu_hotplug
- * lock and dbs_mutex. cpu_hotplug lock should always be held before
- * dbs_mutex. If any function that can potentially take cpu_hotplug lock
- * (like __cpufreq_driver_target()) is being called with dbs_mutex taken, then
- * cpu_hotplug lock should be taken before that. Note that cpu_hotplug lock
- * is recursive for the same process. -Venki
+ * dbs_mutex protects data in dbs_tuners_ins from concurrent changes on
+ * different CPUs. Sampling, idle accounting and sampling_rate /
+ * ignore_nice_load are handled by the common governor core.
  */
-static DEFINE_MUTEX (dbs_mutex);
-static DECLARE_DELAYED_WORK(dbs_work, do_dbs_timer);
+static DEFINE_MUTEX(dbs_mutex);
 
 struct dbs_tuners {
-	unsigned int sampling_rate;
 	unsigned int sampling_down_factor;
 	unsigned int up_threshold;
 	unsigned int down_threshold;
-	unsigned int ignore_nice;
-	//unsigned int freq_step;
 };
 
 static struct dbs_tuners dbs_tuners_ins = {
 	.up_threshold = DEF_FREQUENCY_UP_THRESHOLD,
 	.down_threshold = DEF_FREQUENCY_DOWN_THRESHOLD,
 	.sampling_down_factor = DEF_SAMPLING_DOWN_FACTOR,
-	.ignore_nice = 1,
-	//.freq_step = 5,
-};
-
-static inline unsigned int get_cpu_idle_time(unsigned int cpu)
-{
-	unsigned int add_nice = 0, ret;
-
-	if (dbs_tuners_ins.ignore_nice)
-		add_nice = kstat_cpu(cpu).cpustat.nice;
-
-	ret = kstat_cpu(cpu).cpustat.idle +
-		kstat_cpu(cpu).cpustat.iowait +
-		add_nice;
-
-	return ret;
-}
-
-/* keep track of frequency transitions */
-static int
-dbs_cpufreq_notifier(struct notifier_block *nb, unsigned long val,
-		     void *data)
-{
-	struct cpufreq_freqs *freq = data;
-	struct cpu_dbs_info_s *this_dbs_info = &per_cpu(cpu_dbs_info,
-							freq->cpu);
-
-	if (!this_dbs_info->enable)
-		return 0;
-
-	this_dbs_info->requested_freq = freq->new;
-
-	return 0;
-}
-
-static struct notifier_block dbs_cpufreq_notifier_block = {
-	.notifier_call = dbs_cpufreq_notifier
 };
 
 /************************** sysfs interface ************************/
 static ssize_t show_sampling_rate_max(struct cpufreq_policy *policy, char *buf)
 {
-	return sprintf (buf, "%u\n", min_sampling_rate*100);
-}
-
-static ssize_t show_sampling_rate_min(struct cpufreq_policy *policy, char *buf)
-{
-	return sprintf (buf, "%u\n", min_sampling_rate);
+	return sprintf (buf, "%u\n",
+			cpufreq_gov_of(policy)->min_sampling_rate * 100);
 }
 
 #define define_one_ro(_name)				\
@@ -155,7 +92,6 @@ static struct freq_attr _name =				\
 __ATTR(_name, 0444, show_##_name, NULL)
 
 define_one_ro(sampling_rate_max);
-define_one_ro(sampling_rate_min);
 
 /* cpufreq_lagfree Governor Tunables */
 #define show_one(file_name, object)					\
@@ -164,12 +100,9 @@ static ssize_t show_##file_name						\
 {									\
 	return sprintf(buf, "%u\n", dbs_tuners_ins.object);		\
 }
-show_one(sampling_rate, sampling_rate);
 show_one(sampling_down_factor, sampling_down_factor);
 show_one(up_threshold, up_threshold);
 show_one(down_threshold, down_threshold);
-show_one(ignore_nice_load, ignore_nice);
-//show_one(freq_step, freq_step);
 
 static ssize_t store_sampling_down_factor(struct cpufreq_policy *unused,
 		const char *buf, size_t count)
@@ -177,7 +110,7 @@ static ssize_t store_sampling_down_factor(struct cpufreq_policy *unused,
 	unsigned int input;
 	int ret;
 	ret = sscanf (buf, "%u", &input);
-	if (ret != 1 || input > 25 || input < 1)
+	if (ret != 1 || input > MAX_SAMPLING_DOWN_FACTOR || input < 1)
 		return -EINVAL;
 
 	mutex_lock(&dbs_mutex);
@@ -187,25 +120,6 @@ static ssize_t store_sampling_down_factor(struct cpufreq_policy *unused,
 	return count;
 }
 
-static ssize_t store_sampling_rate(struct cpufreq_policy *unused,
-		const char *buf, size_t count)
-{
-	unsigned int input;
-	int ret;
-	ret = sscanf (buf, "%u", &input);
-
-	mutex_lock(&dbs_mutex);
-	if (ret != 1 || input > min_sampling_rate*100 || input < min_sampling_rate) {
-		mutex_unlock(&dbs_mutex);
-		return -EINVAL;
-	}
-
-	dbs_tuners_ins.sampling_rate = input;
-	mutex_unlock(&dbs_mutex);
-
-	return count;
-}
-
 static ssize_t store_up_threshold(struct cpufreq_policy *unused,
 		const char *buf, size_t count)
 {
@@ -244,260 +158,103 @@ static ssize_t store_down_threshold(struct cpufreq_policy *unused,
 	return count;
 }
 
-static ssize_t store_ignore_nice_load(struct cpufreq_policy *policy,
-		const char *buf, size_t count)
-{
-	unsigned int input;
-	int ret;
-
-	unsigned int j;
-
-	ret = sscanf(buf, "%u", &input);
-	if (ret != 1)
-		return -EINVAL;
-
-	if (input > 1)
-		input = 1;
-
-	mutex_lock(&dbs_mutex);
-	if (input == dbs_tuners_ins.ignore_nice) { /* nothing to do */
-		mutex_unlock(&dbs_mutex);
-		return count;
-	}
-	dbs_tuners_ins.ignore_nice = input;
-
-	/* we need to re-evaluate prev_cpu_idle_up and prev_cpu_idle_down */
-	for_each_online_cpu(j) {
-		struct cpu_dbs_info_s *j_dbs_info;
-		j_dbs_info = &per_cpu(cpu_dbs_info, j);
-		j_dbs_info->prev_cpu_idle_up = get_cpu_idle_time(j);
-		j_dbs_info->prev_cpu_idle_down = j_dbs_info->prev_cpu_idle_up;
-	}
-	mutex_unlock(&dbs_mutex);
-
-	return count;
-}
-
-/*static ssize_t store_freq_step(struct cpufreq_policy *policy,
-		const char *buf, size_t count)
-{
-	unsigned int input;
-	int ret;
-
-	ret = sscanf(buf, "%u", &input);
-
-	if (ret != 1)
-		return -EINVAL;
-
-	if (input > 100)
-		input = 100;
-
-	/ * no need to test here if freq_step is zero as the user might actually
-	 * want this, they would be crazy though :) * /
-	mutex_lock(&dbs_mutex);
-	dbs_tuners_ins.freq_step = input;
-	mutex_unlock(&dbs_mutex);
-
-	return count;
-}*/
-
 #define define_one_rw(_name) \
 static struct freq_attr _name = \
 __ATTR(_name, 0644, show_##_name, store_##_name)
 
-define_one_rw(sampling_rate);
 define_one_rw(sampling_down_factor);
 define_one_rw(up_threshold);
 define_one_rw(down_threshold);
-define_one_rw(ignore_nice_load);
-//define_one_rw(freq_step);
 
 static struct attribute * dbs_attributes[] = {
 	&sampling_rate_max.attr,
-	&sampling_rate_min.attr,
-	&sampling_rate.attr,
 	&sampling_down_factor.attr,
 	&up_threshold.attr,
 	&down_threshold.attr,
-	&ignore_nice_load.attr,
-	//&freq_step.attr,
 	NULL
 };
 
-static struct attribute_group dbs_attr_group = {
-	.attrs = dbs_attributes,
-	.name = "lagfree",
-};
-
 /************************** sysfs end ************************/
 
-static void dbs_check_cpu(int cpu)
+/* the screen on and off limits */
+static unsigned int lagfree_clamp(unsigned int freq)
 {
-	unsigned int idle_ticks, up_idle_ticks, down_idle_ticks;
-	unsigned int tmp_idle_ticks, total_idle_ticks;
-	unsigned int freq_target;
-	unsigned int freq_down_sampling_rate;
-	struct cpu_dbs_info_s *this_dbs_info = &per_cpu(cpu_dbs_info, cpu);
-	struct cpufreq_policy *policy;
-
-	if (!this_dbs_info->enable)
-		return;
+	if (suspended && freq > FREQ_SLEEP_MAX)
+		freq = FREQ_SLEEP_MAX;
+	if (!suspended && freq < FREQ_AWAKE_MIN)
+		freq = FREQ_AWAKE_MIN;
 
-	policy = this_dbs_info->cur_policy;
+	return freq;
+}
+
+static unsigned int lagfree_select(struct cpufreq_gov_cpu *this_dbs_info,
+				   unsigned int load)
+{
+	unsigned int *down_load = &per_cpu(dbs_down_load, this_dbs_info->cpu);
+	unsigned int freq = this_dbs_info->requested_freq;
+	struct cpufreq_policy *policy = this_dbs_info->cur_policy;
 
 	/*
-	 * The default safe range is 20% to 80%
+	 * The default safe range is 30% to 60%
 	 * Every sampling_rate, we check
-	 *	- If current idle time is less than 20%, then we try to
+	 *	- If current load is more than 60%, then we try to
 	 *	  increase frequency
 	 * Every sampling_rate*sampling_down_factor, we check
-	 *	- If current idle time is more than 80%, then we try to
-	 *	  decrease frequency
+	 *	- If the load over that period is less than 30%, then we
+	 *	  try to decrease frequency
 	 *
-	 * Any frequency increase takes it to the maximum frequency.
-	 * Frequency reduction happens at minimum steps of
-	 * 5% (default) of max_frequency
+	 * Any frequency increase takes it to the maximum frequency, or
+	 * by 15% of it with the screen off.
+	 * Frequency reduction happens at steps of 200MHz.
 	 */
 
 	/* Check for frequency increase */
-	idle_ticks = UINT_MAX;
-
-	/* Check for frequency increase */
-	total_idle_ticks = get_cpu_idle_time(cpu);
-	tmp_idle_ticks = total_idle_ticks -
-		this_dbs_info->prev_cpu_idle_up;
-	this_dbs_info->prev_cpu_idle_up = total_idle_ticks;
-
-	if (tmp_idle_ticks < idle_ticks)
-		idle_ticks = tmp_idle_ticks;
-
-	/* Scale idle ticks by 100 and compare with up and down ticks */
-	idle_ticks *= 100;
-	up_idle_ticks = (100 - dbs_tuners_ins.up_threshold) *
-			usecs_to_jiffies(dbs_tuners_ins.sampling_rate);
-
-	if (idle_ticks < up_idle_ticks) {
+	if (load > dbs_tuners_ins.up_threshold) {
 		this_dbs_info->down_skip = 0;
-		this_dbs_info->prev_cpu_idle_down =
-			this_dbs_info->prev_cpu_idle_up;
+		*down_load = 0;
 
 		/* if we are already at full speed then break out early */
-		if (this_dbs_info->requested_freq == policy->max && !suspended)
-			return;
+		if (freq == policy->max && !suspended)
+			return 0;
 
-		//freq_target = (dbs_tuners_ins.freq_step * policy->max) / 100;
 		if (suspended)
-			freq_target = (FREQ_STEP_UP_SLEEP_PERCENT * policy->max) / 100;
+			freq += (FREQ_STEP_UP_SLEEP_PERCENT * policy->max) / 100;
 		else
-			freq_target = policy->max;
-
-		/* max freq cannot be less than 100. But who knows.... */
-		if (unlikely(freq_target == 0))
-			freq_target = 5;
-
-		this_dbs_info->requested_freq += freq_target;
-		if (this_dbs_info->requested_freq > policy->max)
-			this_dbs_info->requested_freq = policy->max;
-		
-		//Screen off mode
-		if (suspended && this_dbs_info->requested_freq > FREQ_SLEEP_MAX)
-		    this_dbs_info->requested_freq = FREQ_SLEEP_MAX;
-		    
-		//Screen off mode
-		if (!suspended && this_dbs_info->requested_freq < FREQ_AWAKE_MIN)
-		    this_dbs_info->requested_freq = FREQ_AWAKE_MIN;
-
-		__cpufreq_driver_target(policy, this_dbs_info->requested_freq,
-			CPUFREQ_RELATION_H);
-		return;
+			freq = policy->max;
+
+		if (freq > policy->max)
+			freq = policy->max;
+
+		return lagfree_clamp(freq);
 	}
 
 	/* Check for frequency decrease */
+	*down_load += load;
 	this_dbs_info->down_skip++;
 	if (this_dbs_info->down_skip < dbs_tuners_ins.sampling_down_factor)
-		return;
-
-	/* Check for frequency decrease */
-	total_idle_ticks = this_dbs_info->prev_cpu_idle_up;
-	tmp_idle_ticks = total_idle_ticks -
-		this_dbs_info->prev_cpu_idle_down;
-	this_dbs_info->prev_cpu_idle_down = total_idle_ticks;
-
-	if (tmp_idle_ticks < idle_ticks)
-		idle_ticks = tmp_idle_ticks;
+		return 0;
 
-	/* Scale idle ticks by 100 and compare with up and down ticks */
-	idle_ticks *= 100;
+	load = *down_load / this_dbs_info->down_skip;
 	this_dbs_info->down_skip = 0;
+	*down_load = 0;
 
-	freq_down_sampling_rate = dbs_tuners_ins.sampling_rate *
-		dbs_tuners_ins.sampling_down_factor;
-	down_idle_ticks = (100 - dbs_tuners_ins.down_threshold) *
-		usecs_to_jiffies(freq_down_sampling_rate);
-
-	if (idle_ticks > down_idle_ticks) {
-		/*
-		 * if we are already at the lowest speed then break out early
-		 * or if we 'cannot' reduce the speed as the user might want
-		 * freq_target to be zero
-		 */
-		if (this_dbs_info->requested_freq == policy->min && suspended
-				/*|| dbs_tuners_ins.freq_step == 0*/)
-			return;
-
-		//freq_target = (dbs_tuners_ins.freq_step * policy->max) / 100;
-		freq_target = FREQ_STEP_DOWN; //policy->max;
-
-		/* max freq cannot be less than 100. But who knows.... */
-		if (unlikely(freq_target == 0))
-			freq_target = 5;
-
-		// prevent going under 0
-		if(freq_target > this_dbs_info->requested_freq)
-			this_dbs_info->requested_freq = policy->min;
-		else
-			this_dbs_info->requested_freq -= freq_target;
-		
-		if (this_dbs_info->requested_freq < policy->min)
-			this_dbs_info->requested_freq = policy->min;
-			
-		//Screen on mode
-		if (!suspended && this_dbs_info->requested_freq < FREQ_AWAKE_MIN)
-		    this_dbs_info->requested_freq = FREQ_AWAKE_MIN;
-		
-		//Screen off mode
-		if (suspended && this_dbs_info->requested_freq > FREQ_SLEEP_MAX)
-		    this_dbs_info->requested_freq = FREQ_SLEEP_MAX;
-
-		__cpufreq_driver_target(policy, this_dbs_info->requested_freq,
-				CPUFREQ_RELATION_H);
-		return;
-	}
-}
+	if (load >= dbs_tuners_ins.down_threshold)
+		return 0;
 
-static void do_dbs_timer(struct work_struct *work)
-{
-	int i;
-	mutex_lock(&dbs_mutex);
-	for_each_online_cpu(i)
-		dbs_check_cpu(i);
-	schedule_delayed_work(&dbs_work,
-			usecs_to_jiffies(dbs_tuners_ins.sampling_rate));
-	mutex_unlock(&dbs_mutex);
-}
+	/* if we are already at the lowest speed then break out early */
+	if (freq == policy->min && suspended)
+		return 0;
 
-static inline void dbs_timer_init(void)
-{
-	init_timer_deferrable(&dbs_work.timer);
-	schedule_delayed_work(&dbs_work,
-			usecs_to_jiffies(dbs_tuners_ins.sampling_rate));
-	return;
-}
+	/* prevent going under 0 */
+	if (FREQ_STEP_DOWN > freq)
+		freq = policy->min;
+	else
+		freq -= FREQ_STEP_DOWN;
 
-static inline void dbs_timer_exit(void)
-{
-	cancel_delayed_work(&dbs_work);
-	return;
+	if (freq < policy->min)
+		freq = policy->min;
+
+	return lagfree_clamp(freq);
 }
 
 static void lagfree_early_suspend(struct early_suspend *handler) {
@@ -514,116 +271,51 @@ static struct early_suspend lagfree_power_suspend = {
 	.level = EARLY_SUSPEND_LEVEL_DISABLE_FB + 1,
 };
 
-static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
-				   unsigned int event)
+static struct cpufreq_gov lagfree_gov;
+
+static void lagfree_start(struct cpufreq_gov_cpu *gcpu)
 {
-	unsigned int cpu = policy->cpu;
-	struct cpu_dbs_info_s *this_dbs_info;
-	unsigned int j;
-	int rc;
-
-	this_dbs_info = &per_cpu(cpu_dbs_info, cpu);
-
-	switch (event) {
-	case CPUFREQ_GOV_START:
-		if ((!cpu_online(cpu)) || (!policy->cur))
-			return -EINVAL;
-
-		if (this_dbs_info->enable) /* Already enabled */
-			break;
-
-		mutex_lock(&dbs_mutex);
-
-		rc = sysfs_create_group(&policy->kobj, &dbs_attr_group);
-		if (rc) {
-			mutex_unlock(&dbs_mutex);
-			return rc;
-		}
-
-		for_each_cpu(j, policy->cpus) {
-			struct cpu_dbs_info_s *j_dbs_info;
-			j_dbs_info = &per_cpu(cpu_dbs_info, j);
-			j_dbs_info->cur_policy = policy;
-
-			j_dbs_info->prev_cpu_idle_up = get_cpu_idle_time(cpu);
-			j_dbs_info->prev_cpu_idle_down
-				= j_dbs_info->prev_cpu_idle_up;
-		}
-		this_dbs_info->enable = 1;
-		this_dbs_info->down_skip = 0;
-		this_dbs_info->requested_freq = policy->cur;
-
-		dbs_enable++;
-		/*
-		 * Start the timerschedule work, when this governor
-		 * is used for first time
-		 */
-		if (dbs_enable == 1) {
-			unsigned int latency;
-			/* policy latency is in nS. Convert it to uS first */
-			latency = policy->cpuinfo.transition_latency / 1000;
-			if (latency == 0)
-				latency = 1;
-
-			/*
-			 * conservative does not implement micro like ondemand
-			 * governor, thus we are bound to jiffes/HZ
-			 */
-			min_sampling_rate =
-				MIN_SAMPLING_RATE_RATIO * jiffies_to_usecs(1);
-			/* Bring kernel and HW constraints together */
-			min_sampling_rate = max(min_sampling_rate,
-					MIN_LATENCY_MULTIPLIER * latency);
-			dbs_tuners_ins.sampling_rate =
-				max(min_sampling_rate,
-				    latency * LATENCY_MULTIPLIER);
-
-			dbs_timer_init();
-			cpufreq_register_notifier(
-					&dbs_cpufreq_notifier_block,
-					CPUFREQ_TRANSITION_NOTIFIER);
-		}
+	struct cpufreq_policy *policy = gcpu->cur_policy;
+	unsigned int latency;
 
-		mutex_unlock(&dbs_mutex);
-		register_early_suspend(&lagfree_power_suspend);
-		break;
-
-	case CPUFREQ_GOV_STOP:
-		mutex_lock(&dbs_mutex);
-		this_dbs_info->enable = 0;
-		sysfs_remove_group(&policy->kobj, &dbs_attr_group);
-		dbs_enable--;
-		/*
-		 * Stop the timerschedule work, when this governor
-		 * is used for first time
-		 */
-		if (dbs_enable == 0) {
-			dbs_timer_exit();
-			cpufreq_unregister_notifier(
-					&dbs_cpufreq_notifier_block,
-					CPUFREQ_TRANSITION_NOTIFIER);
-		}
+	per_cpu(dbs_down_load, gcpu->cpu) = 0;
 
-		mutex_unlock(&dbs_mutex);
-		unregister_early_suspend(&lagfree_power_suspend);
-		break;
-
-	case CPUFREQ_GOV_LIMITS:
-		mutex_lock(&dbs_mutex);
-		if (policy->max < this_dbs_info->cur_policy->cur)
-			__cpufreq_driver_target(
-					this_dbs_info->cur_policy,
-					policy->max, CPUFREQ_RELATION_H);
-		else if (policy->min > this_dbs_info->cur_policy->cur)
-			__cpufreq_driver_target(
-					this_dbs_info->cur_policy,
-					policy->min, CPUFREQ_RELATION_L);
-		mutex_unlock(&dbs_mutex);
-		break;
-	}
-	return 0;
+	if (atomic_inc_return(&active_count) > 1)
+		return;
+
+	/*
+	 * The first user picks the sampling rate, from a lower multiple of
+	 * the transition latency than the core default.
+	 */
+	latency = policy->cpuinfo.transition_latency / 1000;
+	if (latency == 0)
+		latency = 1;
+
+	mutex_lock(&dbs_mutex);
+	lagfree_gov.sampling_rate = max(lagfree_gov.min_sampling_rate,
+					latency * LATENCY_MULTIPLIER);
+	mutex_unlock(&dbs_mutex);
+
+	register_early_suspend(&lagfree_power_suspend);
+}
+
+static void lagfree_stop(struct cpufreq_gov_cpu *gcpu)
+{
+	if (atomic_dec_return(&active_count) > 0)
+		return;
+
+	unregister_early_suspend(&lagfree_power_suspend);
 }
 
+static const struct cpufreq_gov_ops lagfree_ops = {
+	.select	= lagfree_select,
+	.start	= lagfree_start,
+	.stop	= lagfree_stop,
+};
+
+static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
+				unsigned int event);
+
 #ifndef CONFIG_CPU_FREQ_DEFAULT_GOV_LAGFREE
 static
 #endif
@@ -634,17 +326,35 @@ struct cpufreq_governor cpufreq_gov_lagfree = {
 	.owner			= THIS_MODULE,
 };
 
+static struct cpufreq_gov lagfree_gov = {
+	.governor	= &cpufreq_gov_lagfree,
+	.ops		= &lagfree_ops,
+	.attrs		= dbs_attributes,
+	/* niced tasks do not raise the frequency */
+	.ignore_nice	= 1,
+};
+
+static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
+				unsigned int event)
+{
+	return cpufreq_gov_event(&lagfree_gov, policy, event);
+}
+
 static int __init cpufreq_gov_dbs_init(void)
 {
-	return cpufreq_register_governor(&cpufreq_gov_lagfree);
+	/*
+	 * lagfree does not implement micro like ondemand governor, thus we
+	 * are bound to jiffes/HZ
+	 */
+	lagfree_gov.min_sampling_rate =
+		MIN_SAMPLING_RATE_RATIO * jiffies_to_usecs(1);
+
+	return cpufreq_gov_register(&lagfree_gov);
 }
 
 static void __exit cpufreq_gov_dbs_exit(void)
 {
-	/* Make sure that the scheduled work is indeed not running */
-	flush_scheduled_work();
-
-	cpufreq_unregister_governor(&cpufreq_gov_lagfree);
+	cpufreq_gov_unregister(&lagfree_gov);
 }
 
 
@@ -17,17 +17,16 @@
 #include <linux/cpufreq.h>
 #include <linux/cpu.h>
 #include <linux/jiffies.h>
-#include <linux/kernel_stat.h>
 #include <linux/mutex.h>
-#include <linux/hrtimer.h>
 #include <linux/tick.h>
-#include <linux/ktime.h>
 #include <linux/sched.h>
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
 #include <linux/earlysuspend.h>
 #endif
 
+#include "cpufreq_governor.h"
+
 /*
  * dbs is used in this file as a shortform for demandbased switching
  * It helps to keep variable names smaller, simpler
@@ -53,13 +52,9 @@
  */
 #define MIN_SAMPLING_RATE_RATIO			(2)
 
-static unsigned int min_sampling_rate, current_sampling_rate;
-
 #define LATENCY_MULTIPLIER			(1000)
-#define MIN_LATENCY_MULTIPLIER			(100)
 #define TRANSITION_LATENCY_LIMIT		(10 * 1000 * 1000)
 
-static void do_dbs_timer(struct work_struct *work);
 static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 				unsigned int event);
 
@@ -73,45 +68,22 @@ struct cpufreq_governor cpufreq_gov_lazy = {
     .owner                  = THIS_MODULE,
 };
 
-/* Sampling types */
-enum {DBS_NORMAL_SAMPLE, DBS_SUB_SAMPLE};
-
-struct cpu_dbs_info_s {
-    cputime64_t prev_cpu_idle;
-    cputime64_t prev_cpu_iowait;
-    cputime64_t prev_cpu_wall;
-    cputime64_t prev_cpu_nice;
-    struct cpufreq_policy *cur_policy;
-    struct delayed_work work;
-    struct cpufreq_frequency_table *freq_table;
-    unsigned int freq_lo;
-    unsigned int freq_lo_jiffies;
-    unsigned int freq_hi_jiffies;
-    int cpu;
-    unsigned int sample_type:1;
-    /*
-     * percpu mutex that serializes governor limit change with
-     * do_dbs_timer invocation. We do not want do_dbs_timer to run
-     * when user is changing the governor or limits.
-     */
-    struct mutex timer_mutex;
-};
-static DEFINE_PER_CPU(struct cpu_dbs_info_s, od_cpu_dbs_info);
+static DEFINE_PER_CPU(struct cpufreq_frequency_table *, lazy_freq_table);
 
-static unsigned int dbs_enable;	/* number of CPUs using this policy */
+/* number of policies running the governor */
+static atomic_t active_count = ATOMIC_INIT(0);
 
 /*
- * dbs_mutex protects protects dbs_enable in governor start/stop.
+ * dbs_mutex protects data in dbs_tuners_ins from concurrent changes on
+ * different CPUs. Sampling, idle accounting and sampling_rate /
+ * ignore_nice_load / io_is_busy are handled by the common governor core.
  */
 static DEFINE_MUTEX(dbs_mutex);
 
 static struct dbs_tuners {
-    unsigned int sampling_rate;
     unsigned int up_threshold;
     unsigned int down_differential;
-    unsigned int ignore_nice;
     unsigned int powersave_bias;
-    unsigned int io_is_busy;
     unsigned int min_timeinstate;
 #ifdef CONFIG_HAS_EARLYSUSPEND
     bool screenoff_maxfreq;
@@ -119,20 +91,28 @@ static struct dbs_tuners {
 } dbs_tuners_ins = {
     .up_threshold = DEF_FREQUENCY_UP_THRESHOLD,
     .down_differential = DEF_FREQUENCY_DOWN_DIFFERENTIAL,
-    .ignore_nice = 0,
     .powersave_bias = 0,
 #ifdef CONFIG_HAS_EARLYSUSPEND
     .screenoff_maxfreq = false,
 #endif
 };
 
+static struct cpufreq_gov lazy_gov;
+
 #ifdef CONFIG_HAS_EARLYSUSPEND
 static bool suspended = false;
 
 static void lazy_early_suspend(struct early_suspend *handler)
 {
+    unsigned int cpu;
+
     suspended = true;
 
+    /* go to max at once rather than at the end of the period */
+    if (dbs_tuners_ins.screenoff_maxfreq)
+	for_each_online_cpu(cpu)
+	    cpufreq_gov_kick(cpu);
+
     return;
 }
 
@@ -150,109 +130,61 @@ static struct early_suspend lazy_suspend = {
 };
 #endif
 
-static inline cputime64_t get_cpu_idle_time_jiffy(unsigned int cpu,
-						  cputime64_t *wall)
-{
-    cputime64_t idle_time;
-    cputime64_t cur_wall_time;
-    cputime64_t busy_time;
-
-    cur_wall_time = jiffies64_to_cputime64(get_jiffies_64());
-    busy_time = cputime64_add(kstat_cpu(cpu).cpustat.user,
-			      kstat_cpu(cpu).cpustat.system);
-
-    busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.irq);
-    busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.softirq);
-    busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.steal);
-    busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.nice);
-
-    idle_time = cputime64_sub(cur_wall_time, busy_time);
-    if (wall)
-	*wall = (cputime64_t)jiffies_to_usecs(cur_wall_time);
-
-    return (cputime64_t)jiffies_to_usecs(idle_time);
-}
-
-static inline cputime64_t get_cpu_idle_time(unsigned int cpu, cputime64_t *wall)
-{
-    u64 idle_time = get_cpu_idle_time_us(cpu, wall);
-
-    if (idle_time == -1ULL)
-	return get_cpu_idle_time_jiffy(cpu, wall);
-
-    return idle_time;
-}
-
-static inline cputime64_t get_cpu_iowait_time(unsigned int cpu, cputime64_t *wall)
-{
-    u64 iowait_time = get_cpu_iowait_time_us(cpu, wall);
-
-    if (iowait_time == -1ULL)
-	return 0;
-
-    return iowait_time;
-}
-
 /*
  * Find right freq to be set now with powersave_bias on.
- * Returns the freq_hi to be used right now and will set freq_hi_jiffies,
- * freq_lo, and freq_lo_jiffies in percpu area for averaging freqs.
+ * Returns the freq_hi to be used right now and will set freq_hi_jiffies
+ * and freq_lo for the core to split the period between them.
  */
-static unsigned int powersave_bias_target(struct cpufreq_policy *policy,
+static unsigned int powersave_bias_target(struct cpufreq_gov_cpu *gcpu,
 					  unsigned int freq_next,
 					  unsigned int relation)
 {
     unsigned int freq_req, freq_reduc, freq_avg;
     unsigned int freq_hi, freq_lo;
     unsigned int index = 0;
-    unsigned int jiffies_total, jiffies_hi, jiffies_lo;
-    struct cpu_dbs_info_s *dbs_info = &per_cpu(od_cpu_dbs_info,
-					       policy->cpu);
+    unsigned int jiffies_total, jiffies_hi;
+    struct cpufreq_policy *policy = gcpu->cur_policy;
+    struct cpufreq_frequency_table *freq_table =
+	per_cpu(lazy_freq_table, policy->cpu);
 
-    if (!dbs_info->freq_table) {
-	dbs_info->freq_lo = 0;
-	dbs_info->freq_lo_jiffies = 0;
+    if (!freq_table) {
+	gcpu->freq_lo = 0;
 	return freq_next;
     }
 
-    cpufreq_frequency_table_target(policy, dbs_info->freq_table, freq_next,
+    cpufreq_frequency_table_target(policy, freq_table, freq_next,
 				   relation, &index);
-    freq_req = dbs_info->freq_table[index].frequency;
+    freq_req = freq_table[index].frequency;
     freq_reduc = freq_req * dbs_tuners_ins.powersave_bias / 1000;
     freq_avg = freq_req - freq_reduc;
 
     /* Find freq bounds for freq_avg in freq_table */
     index = 0;
-    cpufreq_frequency_table_target(policy, dbs_info->freq_table, freq_avg,
+    cpufreq_frequency_table_target(policy, freq_table, freq_avg,
 				   CPUFREQ_RELATION_H, &index);
-    freq_lo = dbs_info->freq_table[index].frequency;
+    freq_lo = freq_table[index].frequency;
     index = 0;
-    cpufreq_frequency_table_target(policy, dbs_info->freq_table, freq_avg,
+    cpufreq_frequency_table_target(policy, freq_table, freq_avg,
 				   CPUFREQ_RELATION_L, &index);
-    freq_hi = dbs_info->freq_table[index].frequency;
+    freq_hi = freq_table[index].frequency;
 
     /* Find out how long we have to be in hi and lo freqs */
     if (freq_hi == freq_lo) {
-	dbs_info->freq_lo = 0;
-	dbs_info->freq_lo_jiffies = 0;
+	gcpu->freq_lo = 0;
 	return freq_lo;
     }
-    jiffies_total = usecs_to_jiffies(current_sampling_rate);
+    jiffies_total = usecs_to_jiffies(lazy_gov.sampling_rate);
     jiffies_hi = (freq_avg - freq_lo) * jiffies_total;
     jiffies_hi += ((freq_hi - freq_lo) / 2);
     jiffies_hi /= (freq_hi - freq_lo);
-    jiffies_lo = jiffies_total - jiffies_hi;
-    dbs_info->freq_lo = freq_lo;
-    dbs_info->freq_lo_jiffies = jiffies_lo;
-    dbs_info->freq_hi_jiffies = jiffies_hi;
+    gcpu->freq_lo = freq_lo;
+    gcpu->freq_hi_jiffies = jiffies_hi;
     return freq_hi;
 }
 
 static void lazy_powersave_bias_init_cpu(int cpu)
 {
-    struct cpu_dbs_info_s *dbs_info = &per_cpu(od_cpu_dbs_info, cpu);
-    dbs_info->freq_table = cpufreq_frequency_get_table(cpu);
-    dbs_info->freq_lo = 0;
+    per_cpu(lazy_freq_table, cpu) = cpufreq_frequency_get_table(cpu);
 }
 
 static void lazy_powersave_bias_init(void)
@@ -265,43 +197,21 @@ static void lazy_powersave_bias_init(void)
 
 /************************** sysfs interface ************************/
 
-static ssize_t show_sampling_rate_min(struct kobject *kobj,
-				      struct attribute *attr, char *buf)
-{
-    return sprintf(buf, "%u\n", min_sampling_rate);
-}
-
-define_one_global_ro(sampling_rate_min);
-
 /* cpufreq_lazy Governor Tunables */
 #define show_one(file_name, object)				\
     static ssize_t show_##file_name				\
     (struct kobject *kobj, struct attribute *attr, char *buf)	\
     {								\
-	return sprintf(buf, "%u\n", dbs_tuners_ins.object);	\
+	return sprintf(buf, "%u\n", object);			\
     }
-show_one(sampling_rate, sampling_rate);
-show_one(io_is_busy, io_is_busy);
-show_one(up_threshold, up_threshold);
-show_one(ignore_nice_load, ignore_nice);
-show_one(powersave_bias, powersave_bias);
-show_one(min_timeinstate, min_timeinstate);
+show_one(io_is_busy, lazy_gov.io_is_busy);
+show_one(up_threshold, dbs_tuners_ins.up_threshold);
+show_one(powersave_bias, dbs_tuners_ins.powersave_bias);
+show_one(min_timeinstate, dbs_tuners_ins.min_timeinstate);
 #ifdef CONFIG_HAS_EARLYSUSPEND
-show_one(screenoff_maxfreq, screenoff_maxfreq);
+show_one(screenoff_maxfreq, dbs_tuners_ins.screenoff_maxfreq);
 #endif
 
-static ssize_t store_sampling_rate(struct kobject *a, struct attribute *b,
-				   const char *buf, size_t count)
-{
-    unsigned int input;
-    int ret;
-    ret = sscanf(buf, "%u", &input);
-    if (ret != 1)
-	return -EINVAL;
-    dbs_tuners_ins.sampling_rate = max(input, min_sampling_rate);
-    return count;
-}
-
 static ssize_t store_io_is_busy(struct kobject *a, struct attribute *b,
 				const char *buf, size_t count)
 {
@@ -311,7 +221,9 @@ static ssize_t store_io_is_busy(struct kobject *a, struct attribute *b,
     ret = sscanf(buf, "%u", &input);
     if (ret != 1)
 	return -EINVAL;
-    dbs_tuners_ins.io_is_busy = !!input;
+    mutex_lock(&dbs_mutex);
+    lazy_gov.io_is_busy = !!input;
+    mutex_unlock(&dbs_mutex);
     return count;
 }
 
@@ -326,41 +238,9 @@ static ssize_t store_up_threshold(struct kobject *a, struct attribute *b,
 	input < MIN_FREQUENCY_UP_THRESHOLD) {
 	return -EINVAL;
     }
+    mutex_lock(&dbs_mutex);
     dbs_tuners_ins.up_threshold = input;
-    return count;
-}
-
-static ssize_t store_ignore_nice_load(struct kobject *a, struct attribute *b,
-				      const char *buf, size_t count)
-{
-    unsigned int input;
-    int ret;
-
-    unsigned int j;
-
-    ret = sscanf(buf, "%u", &input);
-    if (ret != 1)
-	return -EINVAL;
-
-    if (input > 1)
-	input = 1;
-
-    if (input == dbs_tuners_ins.ignore_nice) { /* nothing to do */
-	mutex_unlock(&dbs_mutex);
-	return count;
-    }
-    dbs_tuners_ins.ignore_nice = input;
-
-    /* we need to re-evaluate prev_cpu_idle */
-    for_each_online_cpu(j) {
-	struct cpu_dbs_info_s *dbs_info;
-	dbs_info = &per_cpu(od_cpu_dbs_info, j);
-	dbs_info->prev_cpu_idle = get_cpu_idle_time(j,
-						    &dbs_info->prev_cpu_wall);
-	if (dbs_tuners_ins.ignore_nice)
-	    dbs_info->prev_cpu_nice = kstat_cpu(j).cpustat.nice;
-
-    }
+    mutex_unlock(&dbs_mutex);
     return count;
 }
 
@@ -377,8 +257,10 @@ static ssize_t store_powersave_bias(struct kobject *a, struct attribute *b,
     if (input > 1000)
 	input = 1000;
 
+    mutex_lock(&dbs_mutex);
     dbs_tuners_ins.powersave_bias = input;
     lazy_powersave_bias_init();
+    mutex_unlock(&dbs_mutex);
     return count;
 }
 
@@ -390,7 +272,9 @@ static ssize_t store_min_timeinstate(struct kobject *a, struct attribute *b,
     ret = sscanf(buf, "%u", &input);
     if (ret != 1)
 	return -EINVAL;
-    dbs_tuners_ins.min_timeinstate = max(input, min_sampling_rate);
+    mutex_lock(&dbs_mutex);
+    dbs_tuners_ins.min_timeinstate = max(input, lazy_gov.min_sampling_rate);
+    mutex_unlock(&dbs_mutex);
     return count;
 }
 
@@ -408,10 +292,8 @@ static ssize_t store_screenoff_maxfreq(struct kobject *a, struct attribute *b,
 }
 #endif
 
-define_one_global_rw(sampling_rate);
 define_one_global_rw(io_is_busy);
 define_one_global_rw(up_threshold);
-define_one_global_rw(ignore_nice_load);
 define_one_global_rw(powersave_bias);
 define_one_global_rw(min_timeinstate);
 #ifdef CONFIG_HAS_EARLYSUSPEND
@@ -419,10 +301,7 @@ define_one_global_rw(screenoff_maxfreq);
 #endif
 
 static struct attribute *dbs_attributes[] = {
-    &sampling_rate_min.attr,
-    &sampling_rate.attr,
     &up_threshold.attr,
-    &ignore_nice_load.attr,
     &powersave_bias.attr,
     &io_is_busy.attr,
     &min_timeinstate.attr,
@@ -432,43 +311,54 @@ static struct attribute *dbs_attributes[] = {
     NULL
 };
 
-static struct attribute_group dbs_attr_group = {
-    .attrs = dbs_attributes,
-    .name = "lazy",
-};
-
 /************************** sysfs end ************************/
 
-static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
+/*
+ * A new frequency is held for min_timeinstate before the next sample,
+ * in whole sampling periods.
+ */
+static unsigned int lazy_hold(struct cpufreq_gov_cpu *gcpu, unsigned int freq)
 {
-    unsigned int max_load_freq;
+    gcpu->rate_mult = DIV_ROUND_UP(dbs_tuners_ins.min_timeinstate,
+				   lazy_gov.sampling_rate);
+    if (!gcpu->rate_mult)
+	gcpu->rate_mult = 1;
 
+    return freq;
+}
+
+static unsigned int lazy_freq_increase(struct cpufreq_gov_cpu *gcpu)
+{
+    struct cpufreq_policy *policy = gcpu->cur_policy;
+
+    /* if we are already at full speed then break out early */
+    if (!dbs_tuners_ins.powersave_bias) {
+	if (policy->cur == policy->max)
+	    return 0;
+
+	return lazy_hold(gcpu, policy->max);
+    }
+
+    gcpu->relation = CPUFREQ_RELATION_L;
+    return lazy_hold(gcpu, powersave_bias_target(gcpu, policy->max,
+						 CPUFREQ_RELATION_H));
+}
+
+static unsigned int lazy_select(struct cpufreq_gov_cpu *this_dbs_info,
+				unsigned int load)
+{
+    unsigned int max_load_freq;
+    unsigned int freq_next;
     struct cpufreq_policy *policy;
-    unsigned int j;
+    int freq_avg;
 
-    this_dbs_info->freq_lo = 0;
     policy = this_dbs_info->cur_policy;
 
-    current_sampling_rate = dbs_tuners_ins.sampling_rate;
+    this_dbs_info->rate_mult = 1;
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
-    if (suspended && dbs_tuners_ins.screenoff_maxfreq) {
-	/* if we are already at full speed then break out early */
-	if (!dbs_tuners_ins.powersave_bias) {
-	    if (policy->cur == policy->max)
-		return;
-
-	    __cpufreq_driver_target(policy, policy->max,
-				    CPUFREQ_RELATION_H);
-	} else {
-	    int freq = powersave_bias_target(policy, policy->max,
-					     CPUFREQ_RELATION_H);
-	    __cpufreq_driver_target(policy, freq,
-				    CPUFREQ_RELATION_L);
-	}
-	current_sampling_rate = dbs_tuners_ins.min_timeinstate;
-	return;
-    }
+    if (suspended && dbs_tuners_ins.screenoff_maxfreq)
+	return lazy_freq_increase(this_dbs_info);
 #endif
 
     /*
@@ -484,96 +374,20 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
      */
 
     /* Get Absolute Load - in terms of freq */
-    max_load_freq = 0;
-
-    for_each_cpu(j, policy->cpus) {
-	struct cpu_dbs_info_s *j_dbs_info;
-	cputime64_t cur_wall_time, cur_idle_time, cur_iowait_time;
-	unsigned int idle_time, wall_time, iowait_time;
-	unsigned int load, load_freq;
-	int freq_avg;
-
-	j_dbs_info = &per_cpu(od_cpu_dbs_info, j);
+    freq_avg = __cpufreq_driver_getavg(policy, policy->cpu);
+    if (freq_avg <= 0)
+	freq_avg = policy->cur;
 
-	cur_idle_time = get_cpu_idle_time(j, &cur_wall_time);
-	cur_iowait_time = get_cpu_iowait_time(j, &cur_wall_time);
-
-	wall_time = (unsigned int) cputime64_sub(cur_wall_time,
-						 j_dbs_info->prev_cpu_wall);
-	j_dbs_info->prev_cpu_wall = cur_wall_time;
-
-	idle_time = (unsigned int) cputime64_sub(cur_idle_time,
-						 j_dbs_info->prev_cpu_idle);
-	j_dbs_info->prev_cpu_idle = cur_idle_time;
-
-	iowait_time = (unsigned int) cputime64_sub(cur_iowait_time,
-						   j_dbs_info->prev_cpu_iowait);
-	j_dbs_info->prev_cpu_iowait = cur_iowait_time;
-
-	if (dbs_tuners_ins.ignore_nice) {
-	    cputime64_t cur_nice;
-	    unsigned long cur_nice_jiffies;
-
-	    cur_nice = cputime64_sub(kstat_cpu(j).cpustat.nice,
-				     j_dbs_info->prev_cpu_nice);
-	    /*
-	     * Assumption: nice time between sampling periods will
-	     * be less than 2^32 jiffies for 32 bit sys
-	     */
-	    cur_nice_jiffies = (unsigned long)
-		cputime64_to_jiffies64(cur_nice);
-
-	    j_dbs_info->prev_cpu_nice = kstat_cpu(j).cpustat.nice;
-	    idle_time += jiffies_to_usecs(cur_nice_jiffies);
-	}
-
-	/*
-	 * For the purpose of lazy, waiting for disk IO is an
-	 * indication that you're performance critical, and not that
-	 * the system is actually idle. So subtract the iowait time
-	 * from the cpu idle time.
-	 */
-
-	if (dbs_tuners_ins.io_is_busy && idle_time >= iowait_time)
-	    idle_time -= iowait_time;
-
-	if (unlikely(!wall_time || wall_time < idle_time))
-	    continue;
-
-	load = 100 * (wall_time - idle_time) / wall_time;
-
-	freq_avg = __cpufreq_driver_getavg(policy, j);
-	if (freq_avg <= 0)
-	    freq_avg = policy->cur;
-
-	load_freq = load * freq_avg;
-	if (load_freq > max_load_freq)
-	    max_load_freq = load_freq;
-    }
+    max_load_freq = load * freq_avg;
 
     /* Check for frequency increase */
-    if (max_load_freq > dbs_tuners_ins.up_threshold * policy->cur) {
-	/* if we are already at full speed then break out early */
-	if (!dbs_tuners_ins.powersave_bias) {
-	    if (policy->cur == policy->max)
-		return;
-
-	    __cpufreq_driver_target(policy, policy->max,
-				    CPUFREQ_RELATION_H);
-	} else {
-	    int freq = powersave_bias_target(policy, policy->max,
-					     CPUFREQ_RELATION_H);
-	    __cpufreq_driver_target(policy, freq,
-				    CPUFREQ_RELATION_L);
-	}
-	current_sampling_rate = dbs_tuners_ins.min_timeinstate;
-	return;
-    }
+    if (max_load_freq > dbs_tuners_ins.up_threshold * policy->cur)
+	return lazy_freq_increase(this_dbs_info);
 
     /* Check for frequency decrease */
     /* if we cannot reduce the frequency anymore, break out early */
     if (policy->cur == policy->min)
-	return;
+	return 0;
 
     /*
      * The optimal frequency is the frequency that is the lowest that
@@ -583,7 +397,6 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
     if (max_load_freq <
 	(dbs_tuners_ins.up_threshold - dbs_tuners_ins.down_differential) *
 	policy->cur) {
-	unsigned int freq_next;
 	freq_next = max_load_freq /
 	    (dbs_tuners_ins.up_threshold -
 	     dbs_tuners_ins.down_differential);
@@ -591,182 +404,64 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 	if (freq_next < policy->min)
 	    freq_next = policy->min;
 
-	if (!dbs_tuners_ins.powersave_bias) {
-	    __cpufreq_driver_target(policy, freq_next,
-				    CPUFREQ_RELATION_L);
-	} else {
-	    int freq = powersave_bias_target(policy, freq_next,
-					     CPUFREQ_RELATION_L);
-	    __cpufreq_driver_target(policy, freq,
-				    CPUFREQ_RELATION_L);
-	}
-	current_sampling_rate = dbs_tuners_ins.min_timeinstate;
-    }
-}
+	this_dbs_info->relation = CPUFREQ_RELATION_L;
+	if (!dbs_tuners_ins.powersave_bias)
+	    return lazy_hold(this_dbs_info, freq_next);
 
-static void do_dbs_timer(struct work_struct *work)
-{
-    struct cpu_dbs_info_s *dbs_info =
-	container_of(work, struct cpu_dbs_info_s, work.work);
-    unsigned int cpu = dbs_info->cpu;
-    int delay;
-    int sample_type = dbs_info->sample_type;
-
-    mutex_lock(&dbs_info->timer_mutex);
-
-    /* Common NORMAL_SAMPLE setup */
-    dbs_info->sample_type = DBS_NORMAL_SAMPLE;
-    if (!dbs_tuners_ins.powersave_bias ||
-	sample_type == DBS_NORMAL_SAMPLE) {
-	dbs_check_cpu(dbs_info);
-	if (dbs_info->freq_lo) {
-	    /* Setup timer for SUB_SAMPLE */
-	    dbs_info->sample_type = DBS_SUB_SAMPLE;
-	    delay = dbs_info->freq_hi_jiffies;
-	} else {
-	    delay = usecs_to_jiffies(current_sampling_rate);
-	    if (num_online_cpus() > 1)
-		delay -= jiffies % delay;
-	}
-    } else {
-	__cpufreq_driver_target(dbs_info->cur_policy,
-				dbs_info->freq_lo, CPUFREQ_RELATION_H);
-	delay = usecs_to_jiffies(current_sampling_rate);
-	if (num_online_cpus() > 1)
-	    delay -= jiffies % delay;
+	return lazy_hold(this_dbs_info,
+			 powersave_bias_target(this_dbs_info, freq_next,
+					       CPUFREQ_RELATION_L));
     }
-    schedule_delayed_work_on(cpu, &dbs_info->work, delay);
-    mutex_unlock(&dbs_info->timer_mutex);
+
+    return 0;
 }
 
-static inline void dbs_timer_init(struct cpu_dbs_info_s *dbs_info)
+static void lazy_start(struct cpufreq_gov_cpu *gcpu)
 {
-    /* We want all CPUs to do sampling nearly on same jiffy */
-    int delay = usecs_to_jiffies(current_sampling_rate);
-    delay -= jiffies % delay;
+    struct cpufreq_policy *policy = gcpu->cur_policy;
+    unsigned int latency;
 
-    dbs_info->sample_type = DBS_NORMAL_SAMPLE;
-    INIT_DELAYED_WORK_DEFERRABLE(&dbs_info->work, do_dbs_timer);
-    schedule_delayed_work_on(dbs_info->cpu, &dbs_info->work, delay);
-}
+    lazy_powersave_bias_init_cpu(gcpu->cpu);
 
-static inline void dbs_timer_exit(struct cpu_dbs_info_s *dbs_info)
-{
-    cancel_delayed_work_sync(&dbs_info->work);
-}
+    if (atomic_inc_return(&active_count) > 1)
+	return;
 
-/*
- * Not all CPUs want IO time to be accounted as busy; this dependson how
- * efficient idling at a higher frequency/voltage is.
- * Pavel Machek says this is not so for various generations of AMD and old
- * Intel systems.
- * Mike Chan (androidlcom) calis this is also not true for ARM.
- * Because of this, whitelist specific known (series) of CPUs by default, and
- * leave all others up to the user.
- */
-static int should_io_be_busy(void)
-{
-#if defined(CONFIG_X86)
     /*
-     * For Intel, Core 2 (model 15) andl later have an efficient idle.
+     * The first user samples at the shortest rate the hardware allows,
+     * a new frequency is then held for 1000 times the latency.
      */
-    if (boot_cpu_data.x86_vendor == X86_VENDOR_INTEL &&
-	boot_cpu_data.x86 == 6 &&
-	boot_cpu_data.x86_model >= 15)
-	return 1;
-#endif
-    return 0;
+    latency = policy->cpuinfo.transition_latency / 1000;
+    if (latency == 0)
+	latency = 1;
+
+    mutex_lock(&dbs_mutex);
+    lazy_gov.sampling_rate = lazy_gov.min_sampling_rate;
+    dbs_tuners_ins.min_timeinstate = latency * LATENCY_MULTIPLIER;
+    mutex_unlock(&dbs_mutex);
 }
 
+static void lazy_stop(struct cpufreq_gov_cpu *gcpu)
+{
+    atomic_dec(&active_count);
+}
+
+static const struct cpufreq_gov_ops lazy_ops = {
+    .select	= lazy_select,
+    .start	= lazy_start,
+    .stop	= lazy_stop,
+};
+
+static struct cpufreq_gov lazy_gov = {
+    .governor	= &cpufreq_gov_lazy,
+    .ops	= &lazy_ops,
+    .attrs	= dbs_attributes,
+    .sysfs_global = 1,
+};
+
 static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 				unsigned int event)
 {
-    unsigned int cpu = policy->cpu;
-    struct cpu_dbs_info_s *this_dbs_info;
-    unsigned int j;
-    int rc;
-
-    this_dbs_info = &per_cpu(od_cpu_dbs_info, cpu);
-
-    switch (event) {
-    case CPUFREQ_GOV_START:
-	if ((!cpu_online(cpu)) || (!policy->cur))
-	    return -EINVAL;
-
-	mutex_lock(&dbs_mutex);
-
-	dbs_enable++;
-	for_each_cpu(j, policy->cpus) {
-	    struct cpu_dbs_info_s *j_dbs_info;
-	    j_dbs_info = &per_cpu(od_cpu_dbs_info, j);
-	    j_dbs_info->cur_policy = policy;
-
-	    j_dbs_info->prev_cpu_idle = get_cpu_idle_time(j,
-							  &j_dbs_info->prev_cpu_wall);
-	    if (dbs_tuners_ins.ignore_nice) {
-		j_dbs_info->prev_cpu_nice =
-		    kstat_cpu(j).cpustat.nice;
-	    }
-	}
-	this_dbs_info->cpu = cpu;
-	lazy_powersave_bias_init_cpu(cpu);
-	/*
-	 * Start the timerschedule work, when this governor
-	 * is used for first time
-	 */
-	if (dbs_enable == 1) {
-	    unsigned int latency;
-
-	    rc = sysfs_create_group(cpufreq_global_kobject,
-				    &dbs_attr_group);
-	    if (rc) {
-		mutex_unlock(&dbs_mutex);
-		return rc;
-	    }
-
-	    /* policy latency is in nS. Convert it to uS first */
-	    latency = policy->cpuinfo.transition_latency / 1000;
-	    if (latency == 0)
-		latency = 1;
-	    /* Bring kernel and HW constraints together */
-	    min_sampling_rate = max(min_sampling_rate,
-				    MIN_LATENCY_MULTIPLIER * latency);
-	    dbs_tuners_ins.sampling_rate = min_sampling_rate;
-	    current_sampling_rate = dbs_tuners_ins.sampling_rate;
-	    dbs_tuners_ins.min_timeinstate = latency * LATENCY_MULTIPLIER;
-	    dbs_tuners_ins.io_is_busy = should_io_be_busy();
-	}
-	mutex_unlock(&dbs_mutex);
-
-	mutex_init(&this_dbs_info->timer_mutex);
-	dbs_timer_init(this_dbs_info);
-	break;
-
-    case CPUFREQ_GOV_STOP:
-	dbs_timer_exit(this_dbs_info);
-
-	mutex_lock(&dbs_mutex);
-	mutex_destroy(&this_dbs_info->timer_mutex);
-	dbs_enable--;
-	mutex_unlock(&dbs_mutex);
-	if (!dbs_enable)
-	    sysfs_remove_group(cpufreq_global_kobject,
-			       &dbs_attr_group);
-
-	break;
-
-    case CPUFREQ_GOV_LIMITS:
-	mutex_lock(&this_dbs_info->timer_mutex);
-	if (policy->max < this_dbs_info->cur_policy->cur)
-	    __cpufreq_driver_target(this_dbs_info->cur_policy,
-				    policy->max, CPUFREQ_RELATION_H);
-	else if (policy->min > this_dbs_info->cur_policy->cur)
-	    __cpufreq_driver_target(this_dbs_info->cur_policy,
-				    policy->min, CPUFREQ_RELATION_L);
-	mutex_unlock(&this_dbs_info->timer_mutex);
-	break;
-    }
-    return 0;
+    return cpufreq_gov_event(&lazy_gov, policy, event);
 }
 
 static int __init cpufreq_gov_dbs_init(void)
@@ -787,10 +482,10 @@ static int __init cpufreq_gov_dbs_init(void)
 	 * not depending on HZ, but fixed (very low). The deferred
 	 * timer might skip some samples if idle/sleeping as needed.
 	 */
-	min_sampling_rate = MICRO_FREQUENCY_MIN_SAMPLE_RATE;
+	lazy_gov.min_sampling_rate = MICRO_FREQUENCY_MIN_SAMPLE_RATE;
     } else {
 	/* For correct statistics, we need 10 ticks for each measure */
-	min_sampling_rate =
+	lazy_gov.min_sampling_rate =
 	    MIN_SAMPLING_RATE_RATIO * jiffies_to_usecs(10);
     }
 
@@ -798,12 +493,12 @@ static int __init cpufreq_gov_dbs_init(void)
     register_early_suspend(&lazy_suspend);
 #endif
 
-    return cpufreq_register_governor(&cpufreq_gov_lazy);
+    return cpufreq_gov_register(&lazy_gov);
 }
 
 static void __exit cpufreq_gov_dbs_exit(void)
 {
-    cpufreq_unregister_governor(&cpufreq_gov_lazy);
+    cpufreq_gov_unregister(&lazy_gov);
 }
 
 
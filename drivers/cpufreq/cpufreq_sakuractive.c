@@ -24,14 +24,13 @@
 #include <linux/cpufreq.h>
 #include <linux/cpu.h>
 #include <linux/jiffies.h>
-#include <linux/kernel_stat.h>
 #include <linux/mutex.h>
-#include <linux/hrtimer.h>
-#include <linux/tick.h>
-#include <linux/ktime.h>
 #include <linux/sched.h>
 #include <linux/err.h>
 #include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include "cpufreq_governor.h"
 
 /* greater than 80% avg load across online CPUs increases frequency */
 #define DEFAULT_UP_FREQ_MIN_LOAD			(80)
@@ -51,10 +50,8 @@
 /* default number of sampling periods to average before hotplug-out decision */
 #define DEFAULT_HOTPLUG_OUT_SAMPLING_PERIODS		(20)
 
-static void do_dbs_timer(struct work_struct *work);
 static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
 		unsigned int event);
-//static int hotplug_boost(struct cpufreq_policy *policy);
 
 #ifndef CONFIG_CPU_FREQ_DEFAULT_GOV_SAKURACTIVE
 static
@@ -65,107 +62,76 @@ struct cpufreq_governor cpufreq_gov_sakuractive = {
        .owner                  = THIS_MODULE,
 };
 
-struct cpu_dbs_info_s {
-	cputime64_t prev_cpu_idle;
-	cputime64_t prev_cpu_wall;
-	cputime64_t prev_cpu_nice;
-	struct cpufreq_policy *cur_policy;
-	struct delayed_work work;
-	struct work_struct cpu_up_work;
-	struct work_struct cpu_down_work;
-	struct cpufreq_frequency_table *freq_table;
-	int cpu;
-	unsigned int boost_applied;
-	/*
-	 * percpu mutex that serializes governor limit change with
-	 * do_dbs_timer invocation. We do not want do_dbs_timer to run
-	 * when user is changing the governor or limits.
-	 */
-	struct mutex timer_mutex;
-};
-static DEFINE_PER_CPU(struct cpu_dbs_info_s, hp_cpu_dbs_info);
-
-static unsigned int dbs_enable;	/* number of CPUs using this policy */
+/* number of policies running the governor */
+static atomic_t active_count = ATOMIC_INIT(0);
 
 /*
  * dbs_mutex protects data in dbs_tuners_ins from concurrent changes on
- * different CPUs. It protects dbs_enable in governor start/stop.
+ * different CPUs. Sampling, idle accounting and sampling_rate /
+ * ignore_nice_load / io_is_busy are handled by the common governor core.
  */
 static DEFINE_MUTEX(dbs_mutex);
 
 static struct workqueue_struct	*khotplug_wq;
 
+static void do_cpu_up(struct work_struct *work)
+{
+	cpu_up(1);
+}
+
+static void do_cpu_down(struct work_struct *work)
+{
+	cpu_down(1);
+}
+
+/* hotplug cannot run from the sampling work, it stops the governor */
+static DECLARE_WORK(cpu_up_work, do_cpu_up);
+static DECLARE_WORK(cpu_down_work, do_cpu_down);
+
 static struct dbs_tuners {
-	unsigned int sampling_rate;
 	unsigned int up_threshold;
 	unsigned int down_differential;
 	unsigned int down_threshold;
 	unsigned int hotplug_in_sampling_periods;
 	unsigned int hotplug_out_sampling_periods;
 	unsigned int hotplug_load_index;
+	/*
+	 * circular buffer of the average loads of the last
+	 * max(hotplug_in_sampling_periods, hotplug_out_sampling_periods)
+	 * samples
+	 */
 	unsigned int *hotplug_load_history;
-	unsigned int ignore_nice;
-	unsigned int io_is_busy;
 	unsigned int boost_timeout;
 } dbs_tuners_ins = {
-	.sampling_rate =		DEFAULT_SAMPLING_PERIOD,
 	.up_threshold =			DEFAULT_UP_FREQ_MIN_LOAD,
 	.down_differential =            DEFAULT_FREQ_DOWN_DIFFERENTIAL,
 	.down_threshold =		DEFAULT_DOWN_FREQ_MAX_LOAD,
 	.hotplug_in_sampling_periods =	DEFAULT_HOTPLUG_IN_SAMPLING_PERIODS,
 	.hotplug_out_sampling_periods =	DEFAULT_HOTPLUG_OUT_SAMPLING_PERIODS,
 	.hotplug_load_index =		0,
-	.ignore_nice =			0,
-	.io_is_busy =			0,
 	.boost_timeout = 0,
 };
 
-/*
- * A corner case exists when switching io_is_busy at run-time: comparing idle
- * times from a non-io_is_busy period to an io_is_busy period (or vice-versa)
- * will misrepresent the actual change in system idleness.  We ignore this
- * corner case: enabling io_is_busy might cause freq increase and disabling
- * might cause freq decrease, which probably matches the original intent.
- */
-static inline cputime64_t get_cpu_idle_time(unsigned int cpu, cputime64_t *wall)
-{
-        u64 idle_time;
-        u64 iowait_time;
-
-        /* cpufreq-sakuractive always assumes CONFIG_NO_HZ */
-        idle_time = get_cpu_idle_time_us(cpu, wall);
-
-	/* add time spent doing I/O to idle time */
-        if (dbs_tuners_ins.io_is_busy) {
-                iowait_time = get_cpu_iowait_time_us(cpu, wall);
-                /* cpufreq-sakuractive always assumes CONFIG_NO_HZ */
-                if (iowait_time != -1ULL && idle_time >= iowait_time)
-                        idle_time -= iowait_time;
-        }
-
-        return idle_time;
-}
+static struct cpufreq_gov sakuractive_gov;
 
 /************************** sysfs interface ************************/
 
-/* XXX look at global sysfs macros in cpufreq.h, can those be used here? */
-
 /* cpufreq_sakuractive Governor Tunables */
 #define show_one(file_name, object)					\
 static ssize_t show_##file_name						\
 (struct kobject *kobj, struct attribute *attr, char *buf)		\
 {									\
-	return sprintf(buf, "%u\n", dbs_tuners_ins.object);		\
+	return sprintf(buf, "%u\n", object);				\
 }
-show_one(sampling_rate, sampling_rate);
-show_one(up_threshold, up_threshold);
-show_one(down_differential, down_differential);
-show_one(down_threshold, down_threshold);
-show_one(hotplug_in_sampling_periods, hotplug_in_sampling_periods);
-show_one(hotplug_out_sampling_periods, hotplug_out_sampling_periods);
-show_one(ignore_nice_load, ignore_nice);
-show_one(io_is_busy, io_is_busy);
-show_one(boost_timeout, boost_timeout);
+show_one(up_threshold, dbs_tuners_ins.up_threshold);
+show_one(down_differential, dbs_tuners_ins.down_differential);
+show_one(down_threshold, dbs_tuners_ins.down_threshold);
+show_one(hotplug_in_sampling_periods,
+	 dbs_tuners_ins.hotplug_in_sampling_periods);
+show_one(hotplug_out_sampling_periods,
+	 dbs_tuners_ins.hotplug_out_sampling_periods);
+show_one(io_is_busy, sakuractive_gov.io_is_busy);
+show_one(boost_timeout, dbs_tuners_ins.boost_timeout);
 
 static ssize_t store_boost_timeout(struct kobject *a, struct attribute *b,
 				   const char *buf, size_t count)
@@ -183,22 +149,6 @@ static ssize_t store_boost_timeout(struct kobject *a, struct attribute *b,
 	return count;
 }
 
-static ssize_t store_sampling_rate(struct kobject *a, struct attribute *b,
-				   const char *buf, size_t count)
-{
-	unsigned int input;
-	int ret;
-	ret = sscanf(buf, "%u", &input);
-	if (ret != 1)
-		return -EINVAL;
-
-	mutex_lock(&dbs_mutex);
-	dbs_tuners_ins.sampling_rate = input;
-	mutex_unlock(&dbs_mutex);
-
-	return count;
-}
-
 static ssize_t store_up_threshold(struct kobject *a, struct attribute *b,
 				  const char *buf, size_t count)
 {
@@ -252,139 +202,78 @@ static ssize_t store_down_threshold(struct kobject *a, struct attribute *b,
 	return count;
 }
 
-static ssize_t store_hotplug_in_sampling_periods(struct kobject *a,
-		struct attribute *b, const char *buf, size_t count)
+/*
+ * Make room for input samples in the load history, the new slots start
+ * at the current average. Called with dbs_mutex held.
+ */
+static int resize_load_history(unsigned int input)
 {
-	unsigned int input;
 	unsigned int *temp;
 	unsigned int max_windows;
-	int ret;
-	ret = sscanf(buf, "%u", &input);
+	unsigned int i;
 
-	if (ret != 1)
-		return -EINVAL;
-
-	/* already using this value, bail out */
-	if (input == dbs_tuners_ins.hotplug_in_sampling_periods)
-		return count;
-
-	mutex_lock(&dbs_mutex);
-	ret = count;
 	max_windows = max(dbs_tuners_ins.hotplug_in_sampling_periods,
 			dbs_tuners_ins.hotplug_out_sampling_periods);
 
 	/* no need to resize array */
-	if (input <= max_windows) {
-		dbs_tuners_ins.hotplug_in_sampling_periods = input;
-		goto out;
-	}
+	if (input <= max_windows)
+		return 0;
 
 	/* resize array */
 	temp = kmalloc((sizeof(unsigned int) * input), GFP_KERNEL);
 
-	if (!temp || IS_ERR(temp)) {
-		ret = -ENOMEM;
-		goto out;
-	}
+	if (!temp || IS_ERR(temp))
+		return -ENOMEM;
 
 	memcpy(temp, dbs_tuners_ins.hotplug_load_history,
 			(max_windows * sizeof(unsigned int)));
+	for (i = max_windows; i < input; i++)
+		temp[i] = 50;
 	kfree(dbs_tuners_ins.hotplug_load_history);
 
-	/* replace old buffer, old number of sampling periods & old index */
+	/* replace old buffer & old index */
 	dbs_tuners_ins.hotplug_load_history = temp;
-	dbs_tuners_ins.hotplug_in_sampling_periods = input;
 	dbs_tuners_ins.hotplug_load_index = max_windows;
-out:
-	mutex_unlock(&dbs_mutex);
 
-	return ret;
+	return 0;
 }
 
-static ssize_t store_hotplug_out_sampling_periods(struct kobject *a,
+static ssize_t store_hotplug_in_sampling_periods(struct kobject *a,
 		struct attribute *b, const char *buf, size_t count)
 {
 	unsigned int input;
-	unsigned int *temp;
-	unsigned int max_windows;
 	int ret;
 	ret = sscanf(buf, "%u", &input);
 
-	if (ret != 1)
+	if (ret != 1 || input < 1)
 		return -EINVAL;
 
-	/* already using this value, bail out */
-	if (input == dbs_tuners_ins.hotplug_out_sampling_periods)
-		return count;
-
 	mutex_lock(&dbs_mutex);
-	ret = count;
-	max_windows = max(dbs_tuners_ins.hotplug_in_sampling_periods,
-			dbs_tuners_ins.hotplug_out_sampling_periods);
-
-	/* no need to resize array */
-	if (input <= max_windows) {
-		dbs_tuners_ins.hotplug_out_sampling_periods = input;
-		goto out;
-	}
-
-	/* resize array */
-	temp = kmalloc((sizeof(unsigned int) * input), GFP_KERNEL);
-
-	if (!temp || IS_ERR(temp)) {
-		ret = -ENOMEM;
-		goto out;
-	}
-
-	memcpy(temp, dbs_tuners_ins.hotplug_load_history,
-			(max_windows * sizeof(unsigned int)));
-	kfree(dbs_tuners_ins.hotplug_load_history);
-
-	/* replace old buffer, old number of sampling periods & old index */
-	dbs_tuners_ins.hotplug_load_history = temp;
-	dbs_tuners_ins.hotplug_out_sampling_periods = input;
-	dbs_tuners_ins.hotplug_load_index = max_windows;
-out:
+	ret = resize_load_history(input);
+	if (!ret)
+		dbs_tuners_ins.hotplug_in_sampling_periods = input;
 	mutex_unlock(&dbs_mutex);
 
-	return ret;
+	return ret ? ret : count;
 }
 
-static ssize_t store_ignore_nice_load(struct kobject *a, struct attribute *b,
-				      const char *buf, size_t count)
+static ssize_t store_hotplug_out_sampling_periods(struct kobject *a,
+		struct attribute *b, const char *buf, size_t count)
 {
 	unsigned int input;
 	int ret;
-
-	unsigned int j;
-
 	ret = sscanf(buf, "%u", &input);
-	if (ret != 1)
-		return -EINVAL;
 
-	if (input > 1)
-		input = 1;
+	if (ret != 1 || input < 1)
+		return -EINVAL;
 
 	mutex_lock(&dbs_mutex);
-	if (input == dbs_tuners_ins.ignore_nice) { /* nothing to do */
-		mutex_unlock(&dbs_mutex);
-		return count;
-	}
-	dbs_tuners_ins.ignore_nice = input;
-
-	/* we need to re-evaluate prev_cpu_idle */
-	for_each_online_cpu(j) {
-		struct cpu_dbs_info_s *dbs_info;
-		dbs_info = &per_cpu(hp_cpu_dbs_info, j);
-		dbs_info->prev_cpu_idle = get_cpu_idle_time(j,
-						&dbs_info->prev_cpu_wall);
-		if (dbs_tuners_ins.ignore_nice)
-			dbs_info->prev_cpu_nice = kstat_cpu(j).cpustat.nice;
-
-	}
+	ret = resize_load_history(input);
+	if (!ret)
+		dbs_tuners_ins.hotplug_out_sampling_periods = input;
 	mutex_unlock(&dbs_mutex);
 
-	return count;
+	return ret ? ret : count;
 }
 
 static ssize_t store_io_is_busy(struct kobject *a, struct attribute *b,
@@ -398,48 +287,38 @@ static ssize_t store_io_is_busy(struct kobject *a, struct attribute *b,
 		return -EINVAL;
 
 	mutex_lock(&dbs_mutex);
-	dbs_tuners_ins.io_is_busy = !!input;
+	sakuractive_gov.io_is_busy = !!input;
 	mutex_unlock(&dbs_mutex);
 
 	return count;
 }
 
-define_one_global_rw(sampling_rate);
 define_one_global_rw(up_threshold);
 define_one_global_rw(down_differential);
 define_one_global_rw(down_threshold);
 define_one_global_rw(hotplug_in_sampling_periods);
 define_one_global_rw(hotplug_out_sampling_periods);
-define_one_global_rw(ignore_nice_load);
 define_one_global_rw(io_is_busy);
 define_one_global_rw(boost_timeout);
 
 static struct attribute *dbs_attributes[] = {
-	&sampling_rate.attr,
 	&up_threshold.attr,
 	&down_differential.attr,
 	&down_threshold.attr,
 	&hotplug_in_sampling_periods.attr,
 	&hotplug_out_sampling_periods.attr,
-	&ignore_nice_load.attr,
 	&io_is_busy.attr,
 	&boost_timeout.attr,
 	NULL
 };
 
-static struct attribute_group dbs_attr_group = {
-	.attrs = dbs_attributes,
-	.name = "sakuractive",
-};
-
 /************************** sysfs end ************************/
 
-static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
+static unsigned int sakuractive_select(struct cpufreq_gov_cpu *this_dbs_info,
+				       unsigned int max_load)
 {
 	/* combined load of all enabled CPUs */
 	unsigned int total_load = 0;
-	/* single largest CPU load percentage*/
-	unsigned int max_load = 0;
 	/* largest CPU load in terms of frequency */
 	unsigned int max_load_freq = 0;
 	/* average load across all enabled CPUs */
@@ -449,50 +328,16 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 	unsigned int hotplug_out_avg_load = 0;
 	/* number of sampling periods averaged for hotplug decisions */
 	unsigned int periods;
+	unsigned int freq_next = 0;
 
 	struct cpufreq_policy *policy;
 	unsigned int i, j;
 
 	policy = this_dbs_info->cur_policy;
 
-	/*
-	 * cpu load accounting
-	 * get highest load, total load and average load across all CPUs
-	 */
-	for_each_cpu(j, policy->cpus) {
-		unsigned int load;
-		unsigned int idle_time, wall_time;
-		cputime64_t cur_wall_time, cur_idle_time;
-		struct cpu_dbs_info_s *j_dbs_info;
-
-		j_dbs_info = &per_cpu(hp_cpu_dbs_info, j);
-
-		/* update both cur_idle_time and cur_wall_time */
-		cur_idle_time = get_cpu_idle_time(j, &cur_wall_time);
-
-		/* how much wall time has passed since last iteration? */
-		wall_time = (unsigned int) cputime64_sub(cur_wall_time,
-				j_dbs_info->prev_cpu_wall);
-		j_dbs_info->prev_cpu_wall = cur_wall_time;
-
-		/* how much idle time has passed since last iteration? */
-		idle_time = (unsigned int) cputime64_sub(cur_idle_time,
-				j_dbs_info->prev_cpu_idle);
-		j_dbs_info->prev_cpu_idle = cur_idle_time;
-
-		if (unlikely(!wall_time || wall_time < idle_time))
-			continue;
-
-		/* load is the percentage of time not spent in idle */
-		load = 100 * (wall_time - idle_time) / wall_time;
-
-		/* keep track of combined load across all CPUs */
-		total_load += load;
-
-		/* keep track of highest single load across all CPUs */
-		if (load > max_load)
-			max_load = load;
-	}
+	/* the core left the load of each cpu of the policy in its gcpu */
+	for_each_cpu(j, policy->cpus)
+		total_load += cpufreq_gov_cpu(&sakuractive_gov, j)->load;
 
 	/* use the max load in the OPP freq change policy */
 	max_load_freq = max_load * policy->cur;
@@ -511,6 +356,10 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 	periods = max(dbs_tuners_ins.hotplug_in_sampling_periods,
 			dbs_tuners_ins.hotplug_out_sampling_periods);
 
+	/* the number of periods may have been lowered since the last sample */
+	if (dbs_tuners_ins.hotplug_load_index >= periods)
+		dbs_tuners_ins.hotplug_load_index = 0;
+
 	/* store avg_load in the circular buffer */
 	dbs_tuners_ins.hotplug_load_history[dbs_tuners_ins.hotplug_load_index]
 		= avg_load;
@@ -545,7 +394,7 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 		if (num_online_cpus() < 2 && hotplug_in_avg_load >
 				dbs_tuners_ins.up_threshold) {
 			queue_work_on(this_dbs_info->cpu, khotplug_wq,
-					&this_dbs_info->cpu_up_work);
+					&cpu_up_work);
 			goto out;
 		}
 	}
@@ -554,8 +403,7 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 	if (max_load > dbs_tuners_ins.up_threshold) {
 		/* increase to highest frequency supported */
 		if (policy->cur < policy->max)
-			__cpufreq_driver_target(policy, policy->max,
-					CPUFREQ_RELATION_H);
+			freq_next = policy->max;
 
 		goto out;
 	}
@@ -568,7 +416,7 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 			if (num_online_cpus() > 1 && hotplug_out_avg_load <
 					dbs_tuners_ins.down_threshold) {
 				queue_work_on(this_dbs_info->cpu, khotplug_wq,
-					&this_dbs_info->cpu_down_work);
+					&cpu_down_work);
 			}
 			goto out;
 		}
@@ -581,7 +429,6 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 	if ((max_load_freq <
 	    (dbs_tuners_ins.up_threshold - dbs_tuners_ins.down_differential) *
 	     policy->cur) && (policy->cur > policy->min)) {
-		unsigned int freq_next;
 		freq_next = max_load_freq /
 				(dbs_tuners_ins.up_threshold -
 				 dbs_tuners_ins.down_differential);
@@ -589,219 +436,102 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 		if (freq_next < policy->min)
 			freq_next = policy->min;
 
-		 __cpufreq_driver_target(policy, freq_next,
-					 CPUFREQ_RELATION_L);
+		this_dbs_info->relation = CPUFREQ_RELATION_L;
 	}
 out:
 	mutex_unlock(&dbs_mutex);
-	return;
+	return freq_next;
 }
 
-static void do_cpu_up(struct work_struct *work)
+static void sakuractive_start(struct cpufreq_gov_cpu *gcpu)
 {
-	cpu_up(1);
-}
+	unsigned int i, max_periods;
 
-static void do_cpu_down(struct work_struct *work)
-{
-	cpu_down(1);
-}
+	mutex_lock(&dbs_mutex);
 
-static void do_dbs_timer(struct work_struct *work)
-{
-	struct cpu_dbs_info_s *dbs_info =
-		container_of(work, struct cpu_dbs_info_s, work.work);
-	unsigned int cpu = dbs_info->cpu;
-	int delay = 0;
-
-	mutex_lock(&dbs_info->timer_mutex);
-	if (!dbs_info->boost_applied) {
-	    dbs_check_cpu(dbs_info);
-		/* We want all related CPUs to do sampling nearly on same jiffy */
-		delay = usecs_to_jiffies(dbs_tuners_ins.sampling_rate);
-	} else {
-		delay = usecs_to_jiffies(dbs_tuners_ins.boost_timeout);
-		dbs_info->boost_applied = 0;
-		if (num_online_cpus() < 2)
-			queue_work_on(cpu, khotplug_wq,
-						&dbs_info->cpu_up_work);
-	}
-	queue_delayed_work_on(cpu, khotplug_wq, &dbs_info->work, delay);
-	mutex_unlock(&dbs_info->timer_mutex);
-}
+	/* every policy starts from a half loaded history */
+	max_periods = max(dbs_tuners_ins.hotplug_in_sampling_periods,
+			dbs_tuners_ins.hotplug_out_sampling_periods);
+	for (i = 0; i < max_periods; i++)
+		dbs_tuners_ins.hotplug_load_history[i] = 50;
+	dbs_tuners_ins.hotplug_load_index = 0;
 
-static inline void dbs_timer_init(struct cpu_dbs_info_s *dbs_info)
-{
-	/* We want all related CPUs to do sampling nearly on same jiffy */
-	int delay = usecs_to_jiffies(dbs_tuners_ins.sampling_rate);
-	delay -= jiffies % delay;
-
-	INIT_DELAYED_WORK_DEFERRABLE(&dbs_info->work, do_dbs_timer);
-	INIT_WORK(&dbs_info->cpu_up_work, do_cpu_up);
-	INIT_WORK(&dbs_info->cpu_down_work, do_cpu_down);
-	if (!dbs_info->boost_applied)
-		delay = usecs_to_jiffies(dbs_tuners_ins.boost_timeout);
-	queue_delayed_work_on(dbs_info->cpu, khotplug_wq, &dbs_info->work,
-		delay);
-}
+	/*
+	 * The first sample waits for boost_timeout, 30 sampling periods
+	 * unless set, so that boot is not slowed down by the hotplug.
+	 */
+	if (atomic_inc_return(&active_count) == 1 &&
+	    !dbs_tuners_ins.boost_timeout)
+		dbs_tuners_ins.boost_timeout = sakuractive_gov.sampling_rate * 30;
+	sakuractive_gov.start_delay = dbs_tuners_ins.boost_timeout;
 
-static inline void dbs_timer_exit(struct cpu_dbs_info_s *dbs_info)
-{
-	cancel_delayed_work_sync(&dbs_info->work);
+	mutex_unlock(&dbs_mutex);
 }
 
-static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
-				   unsigned int event)
+/*
+ * XXX BIG CAVEAT: Stopping the governor with CPU1 offline will result in it
+ * remaining offline until the user onlines it again.  It is up to the user
+ * to do this (for now).
+ */
+static void sakuractive_stop(struct cpufreq_gov_cpu *gcpu)
 {
-	unsigned int cpu = policy->cpu;
-	struct cpu_dbs_info_s *this_dbs_info;
-	unsigned int i, j, max_periods;
-	int rc;
-
-	this_dbs_info = &per_cpu(hp_cpu_dbs_info, cpu);
-
-	switch (event) {
-	case CPUFREQ_GOV_START:
-		if ((!cpu_online(cpu)) || (!policy->cur))
-			return -EINVAL;
-
-		mutex_lock(&dbs_mutex);
-		dbs_enable++;
-		for_each_cpu(j, policy->cpus) {
-			struct cpu_dbs_info_s *j_dbs_info;
-			j_dbs_info = &per_cpu(hp_cpu_dbs_info, j);
-			j_dbs_info->cur_policy = policy;
-
-			j_dbs_info->prev_cpu_idle = get_cpu_idle_time(j,
-						&j_dbs_info->prev_cpu_wall);
-			if (dbs_tuners_ins.ignore_nice) {
-				j_dbs_info->prev_cpu_nice =
-						kstat_cpu(j).cpustat.nice;
-			}
-
-			max_periods = max(DEFAULT_HOTPLUG_IN_SAMPLING_PERIODS,
-					DEFAULT_HOTPLUG_OUT_SAMPLING_PERIODS);
-			dbs_tuners_ins.hotplug_load_history = kmalloc(
-					(sizeof(unsigned int) * max_periods),
-					GFP_KERNEL);
-			if (!dbs_tuners_ins.hotplug_load_history) {
-				WARN_ON(1);
-				return -ENOMEM;
-			}
-			for (i = 0; i < max_periods; i++)
-				dbs_tuners_ins.hotplug_load_history[i] = 50;
-		}
-		this_dbs_info->cpu = cpu;
-		this_dbs_info->freq_table = cpufreq_frequency_get_table(cpu);
-		/*
-		 * Start the timerschedule work, when this governor
-		 * is used for first time
-		 */
-		if (dbs_enable == 1) {
-			rc = sysfs_create_group(cpufreq_global_kobject,
-						&dbs_attr_group);
-			if (rc) {
-				mutex_unlock(&dbs_mutex);
-				return rc;
-			}
-		}
-		if (!dbs_tuners_ins.boost_timeout)
-			dbs_tuners_ins.boost_timeout =  dbs_tuners_ins.sampling_rate * 30;
-		mutex_unlock(&dbs_mutex);
-
-		mutex_init(&this_dbs_info->timer_mutex);
-		dbs_timer_init(this_dbs_info);
-		break;
-
-	case CPUFREQ_GOV_STOP:
-		dbs_timer_exit(this_dbs_info);
-
-		mutex_lock(&dbs_mutex);
-		mutex_destroy(&this_dbs_info->timer_mutex);
-		dbs_enable--;
-		mutex_unlock(&dbs_mutex);
-		if (!dbs_enable)
-			sysfs_remove_group(cpufreq_global_kobject,
-					   &dbs_attr_group);
-		kfree(dbs_tuners_ins.hotplug_load_history);
-		/*
-		 * XXX BIG CAVEAT: Stopping the governor with CPU1 offline
-		 * will result in it remaining offline until the user onlines
-		 * it again.  It is up to the user to do this (for now).
-		 */
-		break;
-
-	case CPUFREQ_GOV_LIMITS:
-		mutex_lock(&this_dbs_info->timer_mutex);
-		if (policy->max < this_dbs_info->cur_policy->cur)
-			__cpufreq_driver_target(this_dbs_info->cur_policy,
-				policy->max, CPUFREQ_RELATION_H);
-		else if (policy->min > this_dbs_info->cur_policy->cur)
-			__cpufreq_driver_target(this_dbs_info->cur_policy,
-				policy->min, CPUFREQ_RELATION_L);
-		mutex_unlock(&this_dbs_info->timer_mutex);
-		break;
-	}
-	return 0;
+	atomic_dec(&active_count);
 }
 
-#if 0
-static int hotplug_boost(struct cpufreq_policy *policy)
-{
-	unsigned int cpu = policy->cpu;
-	struct cpu_dbs_info_s *this_dbs_info;
-
-	this_dbs_info = &per_cpu(hp_cpu_dbs_info, cpu);
-
-#if 0
-	/* Already at max? */
-	if (policy->cur == policy->max)
-		return;
-#endif
+static const struct cpufreq_gov_ops sakuractive_ops = {
+	.select	= sakuractive_select,
+	.start	= sakuractive_start,
+	.stop	= sakuractive_stop,
+};
 
-	mutex_lock(&this_dbs_info->timer_mutex);
-	this_dbs_info->boost_applied = 1;
-	__cpufreq_driver_target(policy, policy->max,
-		CPUFREQ_RELATION_H);
-	mutex_unlock(&this_dbs_info->timer_mutex);
+static struct cpufreq_gov sakuractive_gov = {
+	.governor	= &cpufreq_gov_sakuractive,
+	.ops		= &sakuractive_ops,
+	.attrs		= dbs_attributes,
+	.sysfs_global	= 1,
+	.sampling_rate	= DEFAULT_SAMPLING_PERIOD,
+	/* an idle system at the lowest frequency unplugs cpu1 */
+	.sample_idle	= 1,
+};
 
-	return 0;
+static int cpufreq_governor_dbs(struct cpufreq_policy *policy,
+				   unsigned int event)
+{
+	return cpufreq_gov_event(&sakuractive_gov, policy, event);
 }
-#endif
 
 static int __init cpufreq_gov_dbs_init(void)
 {
 	int err;
-	cputime64_t wall;
-	u64 idle_time;
-	int cpu = get_cpu();
-
-	idle_time = get_cpu_idle_time_us(cpu, &wall);
-	put_cpu();
-	if (idle_time != -1ULL) {
-		dbs_tuners_ins.up_threshold = DEFAULT_UP_FREQ_MIN_LOAD;
-	} else {
-		pr_err("cpufreq-sakuractive: %s: assumes CONFIG_NO_HZ\n",
-				__func__);
-		return -EINVAL;
-	}
+	unsigned int max_periods;
+
+	max_periods = max(DEFAULT_HOTPLUG_IN_SAMPLING_PERIODS,
+			DEFAULT_HOTPLUG_OUT_SAMPLING_PERIODS);
+	dbs_tuners_ins.hotplug_load_history = kmalloc(
+			(sizeof(unsigned int) * max_periods), GFP_KERNEL);
+	if (!dbs_tuners_ins.hotplug_load_history)
+		return -ENOMEM;
 
 	khotplug_wq = create_workqueue("khotplug");
 	if (!khotplug_wq) {
 		pr_err("Creation of khotplug failed\n");
+		kfree(dbs_tuners_ins.hotplug_load_history);
 		return -EFAULT;
 	}
-	err = cpufreq_register_governor(&cpufreq_gov_sakuractive);
-	if (err)
+	err = cpufreq_gov_register(&sakuractive_gov);
+	if (err) {
 		destroy_workqueue(khotplug_wq);
+		kfree(dbs_tuners_ins.hotplug_load_history);
+	}
 
 	return err;
 }
 
 static void __exit cpufreq_gov_dbs_exit(void)
 {
-	cpufreq_unregister_governor(&cpufreq_gov_sakuractive);
+	cpufreq_gov_unregister(&sakuractive_gov);
 	destroy_workqueue(khotplug_wq);
+	kfree(dbs_tuners_ins.hotplug_load_history);
 }
 
 MODULE_AUTHOR("sakuramilk <c.sakuramilk@gmail.com>");
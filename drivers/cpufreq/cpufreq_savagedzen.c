@@ -25,42 +25,34 @@
  *
  */
 
+#include <linux/module.h>
 #include <linux/cpu.h>
 #include <linux/cpumask.h>
 #include <linux/cpufreq.h>
+#include <linux/jiffies.h>
 #include <linux/sched.h>
-#include <linux/tick.h>
-#include <linux/timer.h>
-#include <linux/workqueue.h>
 #include <linux/moduleparam.h>
-#include <asm/cputime.h>
 #include <linux/earlysuspend.h>
 
-static void (*pm_idle_old)(void);
-static atomic_t active_count = ATOMIC_INIT(0);
+#include "cpufreq_governor.h"
 
+/*
+ * Sampling, idle accounting and the timers are done by the common
+ * governor core, every sample_rate_jiffies. What is kept here is how long
+ * the policy has been at its current frequency.
+ */
 struct savagedzen_info_s {
-        struct cpufreq_policy *cur_policy;
-        struct timer_list timer;
-        u64 time_in_idle;
-        u64 idle_exit_time;
-        u64 freq_change_time;
-        u64 freq_change_time_in_idle;
-        int cur_cpu_load;
-        unsigned int force_ramp_up;
-        unsigned int enable;
+        unsigned int freq;
+        /* us */
+        unsigned int time_since_change;
         int max_speed;
         int min_speed;
 };
 static DEFINE_PER_CPU(struct savagedzen_info_s, savagedzen_info);
 
-/* Workqueues handle frequency scaling */
-static struct workqueue_struct *up_wq;
-static struct workqueue_struct *down_wq;
-static struct work_struct freq_scale_work;
-
-static cpumask_t work_cpumask;
 static unsigned int suspended;
+/* the screen went on or off since the last sample */
+static unsigned int suspend_changed;
 
 enum {
         SAVAGEDZEN_DEBUG_JUMPS=1,
@@ -119,7 +111,12 @@ static unsigned int awake_min_freq;
  * Sampling rate, I highly recommend to leave it at 2.
  */
 #define DEFAULT_SAMPLE_RATE_JIFFIES 2
-static unsigned int sample_rate_jiffies;
+
+/*
+ * Sample at once when the scheduler sees the utilization of a cpu rise by
+ * this percentage of the current speed, as the idle exit hook used to.
+ */
+#define DEFAULT_UTIL_KICK 10
 
 /*
  * Freqeuncy delta when ramping up.
@@ -161,6 +158,8 @@ struct cpufreq_governor cpufreq_gov_savagedzen = {
         .owner = THIS_MODULE,
 };
 
+static struct cpufreq_gov savagedzen_gov;
+
 static void savagedzen_update_min_max(struct savagedzen_info_s *this_savagedzen, struct cpufreq_policy *policy, int suspend) {
         if (suspend) {
                 this_savagedzen->min_speed = policy->min;
@@ -181,163 +180,102 @@ inline static unsigned int validate_freq(struct savagedzen_info_s *this_savagedz
         return freq;
 }
 
-static void reset_timer(unsigned long cpu, struct savagedzen_info_s *this_savagedzen) {
-  this_savagedzen->time_in_idle = get_cpu_idle_time_us(cpu, &this_savagedzen->idle_exit_time);
-  mod_timer(&this_savagedzen->timer, jiffies + sample_rate_jiffies);
-}
-
-static void cpufreq_savagedzen_timer(unsigned long data)
+static unsigned int cpufreq_savagedzen_select(struct cpufreq_gov_cpu *gcpu,
+                unsigned int cpu_load)
 {
-        u64 delta_idle;
-        u64 delta_time;
-        int cpu_load;
-        u64 update_time;
-        u64 now_idle;
-        struct savagedzen_info_s *this_savagedzen = &per_cpu(savagedzen_info, data);
-        struct cpufreq_policy *policy = this_savagedzen->cur_policy;
-
-        now_idle = get_cpu_idle_time_us(data, &update_time);
-
-        if (this_savagedzen->idle_exit_time == 0 || update_time == this_savagedzen->idle_exit_time)
-                return;
-
-        delta_idle = cputime64_sub(now_idle, this_savagedzen->time_in_idle);
-        delta_time = cputime64_sub(update_time, this_savagedzen->idle_exit_time);
-        //printk(KERN_INFO "savagedzenT: t=%llu i=%llu\n",cputime64_sub(update_time,this_savagedzen->idle_exit_time),delta_idle);
-
-        // If timer ran less than 1ms after short-term sample started, retry.
-        if (delta_time < 1000) {
-                if (!timer_pending(&this_savagedzen->timer))
-                        reset_timer(data,this_savagedzen);
-                return;
-        }
-
-        if (delta_idle > delta_time)
-                cpu_load = 0;
-        else
-                cpu_load = 100 * (unsigned int)(delta_time - delta_idle) / (unsigned int)delta_time;
+        struct savagedzen_info_s *this_savagedzen = &per_cpu(savagedzen_info, gcpu->cpu);
+        struct cpufreq_policy *policy = gcpu->cur_policy;
+        unsigned int force_ramp_up;
+        int new_freq;
 
-        if (debug_mask & SAVAGEDZEN_DEBUG_LOAD)
-                printk(KERN_INFO "savagedzenT @ %d: load %d (delta_time %llu)\n",policy->cur,cpu_load,delta_time);
+        /* a new frequency took effect since the last sample */
+        if (this_savagedzen->freq != policy->cur) {
+                this_savagedzen->freq = policy->cur;
+                this_savagedzen->time_since_change = 0;
+        }
+        if (this_savagedzen->time_since_change < UINT_MAX - gcpu->window)
+                this_savagedzen->time_since_change += gcpu->window;
 
-        this_savagedzen->cur_cpu_load = cpu_load;
+        // sleep_max_freq==0 disables the sleep and wakeup limits
+        savagedzen_update_min_max(this_savagedzen, policy,
+                                suspended && sleep_max_freq);
 
-        // Scale up if load is above max or if there where no idle cycles since coming out of idle.
-        if (cpu_load > max_cpu_load || delta_idle == 0) {
-                if (policy->cur == policy->max)
-                        return;
+        if (xchg(&suspend_changed, 0) && sleep_max_freq) {
+                if (suspended) {
+                        // cap the frequency at once, the samples go on from there
+                        if (policy->cur > this_savagedzen->max_speed) {
+                                new_freq = this_savagedzen->max_speed;
 
-                if (nr_running() < 1)
-                        return;
+                                if (debug_mask & SAVAGEDZEN_DEBUG_JUMPS)
+                                        printk(KERN_INFO "savagedzenS: suspending at %d\n",new_freq);
 
-                if (cputime64_sub(update_time, this_savagedzen->freq_change_time) < up_rate_us)
-                        return;
+                                return new_freq;
+                        }
+                } else { // resume at max speed:
+                        new_freq = validate_freq(this_savagedzen,sleep_wakeup_freq);
 
+                        if (debug_mask & SAVAGEDZEN_DEBUG_JUMPS)
+                                printk(KERN_INFO "savagedzenS: awaking at %d\n",new_freq);
 
-                this_savagedzen->force_ramp_up = 1;
-                cpumask_set_cpu(data, &work_cpumask);
-                queue_work(up_wq, &freq_scale_work);
-                return;
+                        gcpu->relation = CPUFREQ_RELATION_L;
+                        return new_freq;
+                }
         }
 
-        /*
-         * There is a window where if the cpu utlization can go from low to high
-         * between the timer expiring, delta_idle will be > 0 and the cpu will
-         * be 100% busy, preventing idle from running, and this timer from
-         * firing. So setup another timer to fire to check cpu utlization.
-         * Do not setup the timer if there is no scheduled work or if at max speed.
-         */
-        if (policy->cur < this_savagedzen->max_speed && !timer_pending(&this_savagedzen->timer) && nr_running() > 0)
-                reset_timer(data,this_savagedzen);
-
-        if (policy->cur == policy->min)
-                return;
-
-        /*
-         * Do not scale down unless we have been at this frequency for the
-         * minimum sample time.
-         */
-        if (cputime64_sub(update_time, this_savagedzen->freq_change_time) < down_rate_us)
-                return;
-
-        cpumask_set_cpu(data, &work_cpumask);
-        queue_work(down_wq, &freq_scale_work);
-}
+        if (debug_mask & SAVAGEDZEN_DEBUG_LOAD)
+                printk(KERN_INFO "savagedzenT @ %d: load %d (window %u)\n",policy->cur,cpu_load,gcpu->window);
 
-static void cpufreq_idle(void)
-{
-        struct savagedzen_info_s *this_savagedzen = &per_cpu(savagedzen_info, smp_processor_id());
-        struct cpufreq_policy *policy = this_savagedzen->cur_policy;
+        // Scale up if load is above max or if there where no idle cycles since the last sample.
+        if (cpu_load > max_cpu_load || cpu_load == 100) {
+                if (policy->cur == policy->max)
+                        return 0;
 
-        if (!this_savagedzen->enable) {
-                pm_idle_old();
-                return;
-        }
+                if (this_savagedzen->time_since_change < up_rate_us)
+                        return 0;
 
-        if (policy->cur == this_savagedzen->min_speed && timer_pending(&this_savagedzen->timer))
-                del_timer(&this_savagedzen->timer);
+                /* the sampling work itself is one of the running tasks */
+                force_ramp_up = cpu_load == 100 && nr_running() > 1;
 
-        pm_idle_old();
+                if (force_ramp_up && up_min_freq) {
+                        new_freq = up_min_freq;
+                        gcpu->relation = CPUFREQ_RELATION_L;
+                } else if (ramp_up_step) {
+                        new_freq = policy->cur + ramp_up_step;
+                } else {
+                        new_freq = this_savagedzen->max_speed;
+                }
+        } else {
+                if (policy->cur == policy->min)
+                        return 0;
 
-        if (!timer_pending(&this_savagedzen->timer))
-                reset_timer(smp_processor_id(), this_savagedzen);
-}
+                /*
+                 * Do not scale down unless we have been at this frequency for the
+                 * minimum sample time.
+                 */
+                if (this_savagedzen->time_since_change < down_rate_us)
+                        return 0;
 
-/* We use the same work function to sale up and down */
-static void cpufreq_savagedzen_freq_change_time_work(struct work_struct *work)
-{
-        unsigned int cpu;
-        int new_freq;
-        unsigned int force_ramp_up;
-        int cpu_load;
-        struct savagedzen_info_s *this_savagedzen;
-        struct cpufreq_policy *policy;
-        unsigned int relation = CPUFREQ_RELATION_L;
-        cpumask_t tmp_mask = work_cpumask;
-        for_each_cpu(cpu, &tmp_mask) {
-                this_savagedzen = &per_cpu(savagedzen_info, cpu);
-                policy = this_savagedzen->cur_policy;
-                cpu_load = this_savagedzen->cur_cpu_load;
-                force_ramp_up = this_savagedzen->force_ramp_up && nr_running() > 1;
-                this_savagedzen->force_ramp_up = 0;
-
-                if (force_ramp_up || cpu_load > max_cpu_load) {
-                        if (force_ramp_up && up_min_freq) {
-                                new_freq = up_min_freq;
-                                relation = CPUFREQ_RELATION_L;
-                        } else if (ramp_up_step) {
-                                new_freq = policy->cur + ramp_up_step;
-                                relation = CPUFREQ_RELATION_H;
-                        } else {
-                                new_freq = this_savagedzen->max_speed;
-                                relation = CPUFREQ_RELATION_H;
-                        }
-                }
-                else if (cpu_load < min_cpu_load) {
+                if (cpu_load < min_cpu_load) {
                         if (ramp_down_step)
                                 new_freq = policy->cur - ramp_down_step;
                         else {
                                 cpu_load += 100 - max_cpu_load; // dummy load.
                                 new_freq = policy->cur * cpu_load / 100;
                         }
-                        relation = CPUFREQ_RELATION_L;
+                        gcpu->relation = CPUFREQ_RELATION_L;
                 }
                 else new_freq = policy->cur;
+        }
 
-                new_freq = validate_freq(this_savagedzen,new_freq);
-
-                if (new_freq != policy->cur) {
-                        if (debug_mask & SAVAGEDZEN_DEBUG_JUMPS)
-                                printk(KERN_INFO "savagedzenQ: jumping from %d to %d\n",policy->cur,new_freq);
+        new_freq = validate_freq(this_savagedzen,new_freq);
 
-                        __cpufreq_driver_target(policy, new_freq, relation);
+        if (new_freq == policy->cur)
+                return 0;
 
-                        this_savagedzen->freq_change_time_in_idle =
-                                get_cpu_idle_time_us(cpu,&this_savagedzen->freq_change_time);
-                }
+        if (debug_mask & SAVAGEDZEN_DEBUG_JUMPS)
+                printk(KERN_INFO "savagedzenQ: jumping from %d to %d\n",policy->cur,new_freq);
 
-                cpumask_clear_cpu(cpu, &work_cpumask);
-        }
+        return new_freq;
 }
 
 static ssize_t show_debug_mask(struct cpufreq_policy *policy, char *buf)
@@ -352,7 +290,7 @@ static ssize_t store_debug_mask(struct cpufreq_policy *policy, const char *buf,
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0)
           debug_mask = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr debug_mask_attr = __ATTR(debug_mask, 0644,
@@ -370,7 +308,7 @@ static ssize_t store_up_rate_us(struct cpufreq_policy *policy, const char *buf,
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0 && input <= 100000000)
           up_rate_us = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr up_rate_us_attr = __ATTR(up_rate_us, 0644,
@@ -386,9 +324,12 @@ static ssize_t store_down_rate_us(struct cpufreq_policy *policy, const char *buf
         ssize_t res;
         unsigned long input;
         res = strict_strtoul(buf, 0, &input);
-        if (res >= 0 && input >= 0 && input <= 100000000)
+        if (res >= 0 && input >= 0 && input <= 100000000) {
           down_rate_us = input;
-        return res;
+          /* an idle cpu is woken up to ramp down once it may */
+          savagedzen_gov.timer_slack = input;
+        }
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr down_rate_us_attr = __ATTR(down_rate_us, 0644,
@@ -406,7 +347,7 @@ static ssize_t store_up_min_freq(struct cpufreq_policy *policy, const char *buf,
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           up_min_freq = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr up_min_freq_attr = __ATTR(up_min_freq, 0644,
@@ -424,7 +365,7 @@ static ssize_t store_sleep_max_freq(struct cpufreq_policy *policy, const char *b
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           sleep_max_freq = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr sleep_max_freq_attr = __ATTR(sleep_max_freq, 0644,
@@ -442,7 +383,7 @@ static ssize_t store_sleep_wakeup_freq(struct cpufreq_policy *policy, const char
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           sleep_wakeup_freq = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr sleep_wakeup_freq_attr = __ATTR(sleep_wakeup_freq, 0644,
@@ -460,7 +401,7 @@ static ssize_t store_awake_min_freq(struct cpufreq_policy *policy, const char *b
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           awake_min_freq = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr awake_min_freq_attr = __ATTR(awake_min_freq, 0644,
@@ -468,7 +409,7 @@ static struct freq_attr awake_min_freq_attr = __ATTR(awake_min_freq, 0644,
 
 static ssize_t show_sample_rate_jiffies(struct cpufreq_policy *policy, char *buf)
 {
-        return sprintf(buf, "%u\n", sample_rate_jiffies);
+        return sprintf(buf, "%lu\n", usecs_to_jiffies(savagedzen_gov.sampling_rate));
 }
 
 static ssize_t store_sample_rate_jiffies(struct cpufreq_policy *policy, const char *buf, size_t count)
@@ -477,8 +418,8 @@ static ssize_t store_sample_rate_jiffies(struct cpufreq_policy *policy, const ch
         unsigned long input;
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input > 0 && input <= 1000)
-          sample_rate_jiffies = input;
-        return res;
+          savagedzen_gov.sampling_rate = jiffies_to_usecs(input);
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr sample_rate_jiffies_attr = __ATTR(sample_rate_jiffies, 0644,
@@ -496,7 +437,7 @@ static ssize_t store_ramp_up_step(struct cpufreq_policy *policy, const char *buf
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           ramp_up_step = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr ramp_up_step_attr = __ATTR(ramp_up_step, 0644,
@@ -514,7 +455,7 @@ static ssize_t store_ramp_down_step(struct cpufreq_policy *policy, const char *b
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           ramp_down_step = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr ramp_down_step_attr = __ATTR(ramp_down_step, 0644,
@@ -532,7 +473,7 @@ static ssize_t store_max_cpu_load(struct cpufreq_policy *policy, const char *buf
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input > 0 && input <= 100)
           max_cpu_load = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr max_cpu_load_attr = __ATTR(max_cpu_load, 0644,
@@ -550,7 +491,7 @@ static ssize_t store_min_cpu_load(struct cpufreq_policy *policy, const char *buf
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input > 0 && input < 100)
           min_cpu_load = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr min_cpu_load_attr = __ATTR(min_cpu_load, 0644,
@@ -572,108 +513,58 @@ static struct attribute * savagedzen_attributes[] = {
         NULL,
 };
 
-static struct attribute_group savagedzen_attr_group = {
-        .attrs = savagedzen_attributes,
-        .name = "savagedzen",
-};
-
-static int cpufreq_governor_savagedzen(struct cpufreq_policy *new_policy,
-                unsigned int event)
+static void cpufreq_savagedzen_start(struct cpufreq_gov_cpu *gcpu)
 {
-        unsigned int cpu = new_policy->cpu;
-        int rc;
-        struct savagedzen_info_s *this_savagedzen = &per_cpu(savagedzen_info, cpu);
-
-        switch (event) {
-        case CPUFREQ_GOV_START:
-                if ((!cpu_online(cpu)) || (!new_policy->cur))
-                        return -EINVAL;
-
-                /*
-                 * Do not register the idle hook and create sysfs
-                 * entries if we have already done so.
-                 */
-                if (atomic_inc_return(&active_count) <= 1) {
-                        rc = sysfs_create_group(&new_policy->kobj, &savagedzen_attr_group);
-                        if (rc)
-                                return rc;
-                        pm_idle_old = pm_idle;
-                        pm_idle = cpufreq_idle;
-                }
-
-                this_savagedzen->cur_policy = new_policy;
-                this_savagedzen->enable = 1;
-
-                // notice no break here!
-
-        case CPUFREQ_GOV_LIMITS:
-                savagedzen_update_min_max(this_savagedzen,new_policy,suspended);
-                if (this_savagedzen->cur_policy->cur != this_savagedzen->max_speed) {
-                        if (debug_mask & SAVAGEDZEN_DEBUG_JUMPS)
-                                printk(KERN_INFO "savagedzenI: initializing to %d\n",this_savagedzen->max_speed);
-                        __cpufreq_driver_target(new_policy, this_savagedzen->max_speed, CPUFREQ_RELATION_H);
-                }
-                break;
-
-        case CPUFREQ_GOV_STOP:
-                del_timer(&this_savagedzen->timer);
-                this_savagedzen->enable = 0;
+        struct savagedzen_info_s *this_savagedzen = &per_cpu(savagedzen_info, gcpu->cpu);
+        struct cpufreq_policy *policy = gcpu->cur_policy;
 
-                if (atomic_dec_return(&active_count) > 1)
-                        return 0;
-                sysfs_remove_group(&new_policy->kobj,
-                                &savagedzen_attr_group);
+        savagedzen_update_min_max(this_savagedzen, policy,
+                                suspended && sleep_max_freq);
+        this_savagedzen->freq = policy->cur;
+        this_savagedzen->time_since_change = 0;
 
-                pm_idle = pm_idle_old;
-                break;
+        if (policy->cur != this_savagedzen->max_speed) {
+                if (debug_mask & SAVAGEDZEN_DEBUG_JUMPS)
+                        printk(KERN_INFO "savagedzenI: initializing to %d\n",this_savagedzen->max_speed);
+                __cpufreq_driver_target(policy, this_savagedzen->max_speed, CPUFREQ_RELATION_H);
         }
-
-        return 0;
 }
 
-static void savagedzen_suspend(int cpu, int suspend)
-{
-        struct savagedzen_info_s *this_savagedzen = &per_cpu(savagedzen_info, smp_processor_id());
-        struct cpufreq_policy *policy = this_savagedzen->cur_policy;
-        unsigned int new_freq;
-
-        if (!this_savagedzen->enable || sleep_max_freq==0) // disable behavior for sleep_max_freq==0
-                return;
-
-        savagedzen_update_min_max(this_savagedzen,policy,suspend);
-        if (suspend) {
-            if (policy->cur > this_savagedzen->max_speed) {
-                    new_freq = this_savagedzen->max_speed;
-
-                    if (debug_mask & SAVAGEDZEN_DEBUG_JUMPS)
-                            printk(KERN_INFO "savagedzenS: suspending at %d\n",new_freq);
-
-                    __cpufreq_driver_target(policy, new_freq,
-                                            CPUFREQ_RELATION_H);
-            }
-        } else { // resume at max speed:
-                new_freq = validate_freq(this_savagedzen,sleep_wakeup_freq);
+static const struct cpufreq_gov_ops savagedzen_ops = {
+        .select = cpufreq_savagedzen_select,
+        .start = cpufreq_savagedzen_start,
+};
 
-                if (debug_mask & SAVAGEDZEN_DEBUG_JUMPS)
-                        printk(KERN_INFO "savagedzenS: awaking at %d\n",new_freq);
+static struct cpufreq_gov savagedzen_gov = {
+        .governor = &cpufreq_gov_savagedzen,
+        .ops = &savagedzen_ops,
+        .attrs = savagedzen_attributes,
+};
 
-                __cpufreq_driver_target(policy, new_freq,
-                                        CPUFREQ_RELATION_L);
-        }
+static int cpufreq_governor_savagedzen(struct cpufreq_policy *new_policy,
+                unsigned int event)
+{
+        return cpufreq_gov_event(&savagedzen_gov, new_policy, event);
 }
 
 static void savagedzen_early_suspend(struct early_suspend *handler) {
         int i;
+
         suspended = 1;
+        suspend_changed = 1;
+        /* drop to sleep_max_freq at once */
         for_each_online_cpu(i)
-                savagedzen_suspend(i,1);
+                cpufreq_gov_kick(i);
 }
 
 static void savagedzen_late_resume(struct early_suspend *handler) {
         int i;
+
         suspended = 0;
+        suspend_changed = 1;
+        /* wake up at sleep_wakeup_freq at once */
         for_each_online_cpu(i)
-                savagedzen_suspend(i,0);
+                cpufreq_gov_kick(i);
 }
 
 static struct early_suspend savagedzen_power_suspend = {
@@ -692,7 +583,6 @@ static int __init cpufreq_savagedzen_init(void)
         sleep_max_freq = DEFAULT_SLEEP_MAX_FREQ;
         sleep_wakeup_freq = DEFAULT_SLEEP_WAKEUP_FREQ;
         awake_min_freq = DEFAULT_AWAKE_MIN_FREQ;
-        sample_rate_jiffies = DEFAULT_SAMPLE_RATE_JIFFIES;
         ramp_up_step = DEFAULT_RAMP_UP_STEP;
         ramp_down_step = DEFAULT_RAMP_DOWN_STEP;
         max_cpu_load = DEFAULT_MAX_CPU_LOAD;
@@ -703,44 +593,34 @@ static int __init cpufreq_savagedzen_init(void)
         /* Initalize per-cpu data: */
         for_each_possible_cpu(i) {
                 this_savagedzen = &per_cpu(savagedzen_info, i);
-                this_savagedzen->enable = 0;
-                this_savagedzen->cur_policy = 0;
-                this_savagedzen->force_ramp_up = 0;
                 this_savagedzen->max_speed = DEFAULT_SLEEP_WAKEUP_FREQ;
                 this_savagedzen->min_speed = DEFAULT_AWAKE_MIN_FREQ;
-                this_savagedzen->time_in_idle = 0;
-                this_savagedzen->idle_exit_time = 0;
-                this_savagedzen->freq_change_time = 0;
-                this_savagedzen->freq_change_time_in_idle = 0;
-                this_savagedzen->cur_cpu_load = 0;
-                // intialize timer:
-                init_timer_deferrable(&this_savagedzen->timer);
-                this_savagedzen->timer.function = cpufreq_savagedzen_timer;
-                this_savagedzen->timer.data = i;
+                this_savagedzen->freq = 0;
+                this_savagedzen->time_since_change = 0;
         }
 
-        /* Scale up is high priority */
-        up_wq = create_workqueue("ksavagedzen_up");
-        down_wq = create_workqueue("ksavagedzen_down");
-
-        INIT_WORK(&freq_scale_work, cpufreq_savagedzen_freq_change_time_work);
+        savagedzen_gov.min_sampling_rate = jiffies_to_usecs(1);
+        savagedzen_gov.sampling_rate =
+                jiffies_to_usecs(DEFAULT_SAMPLE_RATE_JIFFIES);
+        /* an idle cpu is woken up to ramp down once it may */
+        savagedzen_gov.timer_slack = down_rate_us;
+        savagedzen_gov.util_kick = DEFAULT_UTIL_KICK;
 
         register_early_suspend(&savagedzen_power_suspend);
 
-        return cpufreq_register_governor(&cpufreq_gov_savagedzen);
+        return cpufreq_gov_register(&savagedzen_gov);
 }
 
 #ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_SAVAGEDZEN
-pure_initcall(cpufreq_savagedzen_init);
+fs_initcall(cpufreq_savagedzen_init);
 #else
 module_init(cpufreq_savagedzen_init);
 #endif
 
 static void __exit cpufreq_savagedzen_exit(void)
 {
-        cpufreq_unregister_governor(&cpufreq_gov_savagedzen);
-        destroy_workqueue(up_wq);
-        destroy_workqueue(down_wq);
+        unregister_early_suspend(&savagedzen_power_suspend);
+        cpufreq_gov_unregister(&savagedzen_gov);
 }
 
 module_exit(cpufreq_savagedzen_exit);
@@ -23,42 +23,34 @@
  *
  */
 
+#include <linux/module.h>
 #include <linux/cpu.h>
 #include <linux/cpumask.h>
 #include <linux/cpufreq.h>
+#include <linux/jiffies.h>
 #include <linux/sched.h>
-#include <linux/tick.h>
-#include <linux/timer.h>
-#include <linux/workqueue.h>
 #include <linux/moduleparam.h>
-#include <asm/cputime.h>
 #include <linux/earlysuspend.h>
 
-static void (*pm_idle_old)(void);
-static atomic_t active_count = ATOMIC_INIT(0);
+#include "cpufreq_governor.h"
 
+/*
+ * Sampling, idle accounting and the timers are done by the common
+ * governor core, every sample_rate_jiffies. What is kept here is how long
+ * the policy has been at its current frequency.
+ */
 struct smartass_info_s {
-        struct cpufreq_policy *cur_policy;
-        struct timer_list timer;
-        u64 time_in_idle;
-        u64 idle_exit_time;
-        u64 freq_change_time;
-        u64 freq_change_time_in_idle;
-        int cur_cpu_load;
-        unsigned int force_ramp_up;
-        unsigned int enable;
+        unsigned int freq;
+        /* us */
+        unsigned int time_since_change;
         int max_speed;
         int min_speed;
 };
 static DEFINE_PER_CPU(struct smartass_info_s, smartass_info);
 
-/* Workqueues handle frequency scaling */
-static struct workqueue_struct *up_wq;
-static struct workqueue_struct *down_wq;
-static struct work_struct freq_scale_work;
-
-static cpumask_t work_cpumask;
 static unsigned int suspended;
+/* the screen went on or off since the last sample */
+static unsigned int suspend_changed;
 
 enum {
         SMARTASS_DEBUG_JUMPS=1,
@@ -117,7 +109,12 @@ static unsigned int awake_min_freq;
  * Sampling rate, I highly recommend to leave it at 2.
  */
 #define DEFAULT_SAMPLE_RATE_JIFFIES 2
-static unsigned int sample_rate_jiffies;
+
+/*
+ * Sample at once when the scheduler sees the utilization of a cpu rise by
+ * this percentage of the current speed, as the idle exit hook used to.
+ */
+#define DEFAULT_UTIL_KICK 10
 
 /*
  * Freqeuncy delta when ramping up.
@@ -159,6 +156,8 @@ struct cpufreq_governor cpufreq_gov_smartass = {
         .owner = THIS_MODULE,
 };
 
+static struct cpufreq_gov smartass_gov;
+
 static void smartass_update_min_max(struct smartass_info_s *this_smartass, struct cpufreq_policy *policy, int suspend) {
         if (suspend) {
                 this_smartass->min_speed = policy->min;
@@ -179,172 +178,106 @@ inline static unsigned int validate_freq(struct smartass_info_s *this_smartass,
         return freq;
 }
 
-static void reset_timer(unsigned long cpu, struct smartass_info_s *this_smartass) {
-  this_smartass->time_in_idle = get_cpu_idle_time_us(cpu, &this_smartass->idle_exit_time);
-  mod_timer(&this_smartass->timer, jiffies + sample_rate_jiffies);
-}
-
-static void cpufreq_smartass_timer(unsigned long data)
+static unsigned int cpufreq_smartass_select(struct cpufreq_gov_cpu *gcpu,
+                unsigned int cpu_load)
 {
-        u64 delta_idle;
-        u64 delta_time;
-        int cpu_load;
-        u64 update_time;
-        u64 now_idle;
-        struct smartass_info_s *this_smartass = &per_cpu(smartass_info, data);
-        struct cpufreq_policy *policy = this_smartass->cur_policy;
-
-        now_idle = get_cpu_idle_time_us(data, &update_time);
-
-        if (this_smartass->idle_exit_time == 0 || update_time == this_smartass->idle_exit_time)
-                return;
-
-        delta_idle = cputime64_sub(now_idle, this_smartass->time_in_idle);
-        delta_time = cputime64_sub(update_time, this_smartass->idle_exit_time);
-        //printk(KERN_INFO "smartassT: t=%llu i=%llu\n",cputime64_sub(update_time,this_smartass->idle_exit_time),delta_idle);
-
-        // If timer ran less than 1ms after short-term sample started, retry.
-        if (delta_time < 1000) {
-                if (!timer_pending(&this_smartass->timer))
-                        reset_timer(data,this_smartass);
-                return;
-        }
-
-        if (delta_idle > delta_time)
-                cpu_load = 0;
-        else
-                cpu_load = 100 * (unsigned int)(delta_time - delta_idle) / (unsigned int)delta_time;
-
-        if (debug_mask & SMARTASS_DEBUG_LOAD)
-                printk(KERN_INFO "smartassT @ %d: load %d (delta_time %llu)\n",policy->cur,cpu_load,delta_time);
+        struct smartass_info_s *this_smartass = &per_cpu(smartass_info, gcpu->cpu);
+        struct cpufreq_policy *policy = gcpu->cur_policy;
+        unsigned int force_ramp_up;
+        int new_freq;
 
-        this_smartass->cur_cpu_load = cpu_load;
+        /* a new frequency took effect since the last sample */
+        if (this_smartass->freq != policy->cur) {
+                this_smartass->freq = policy->cur;
+                this_smartass->time_since_change = 0;
+        }
+        if (this_smartass->time_since_change < UINT_MAX - gcpu->window)
+                this_smartass->time_since_change += gcpu->window;
 
-        // Scale up if load is above max or if there where no idle cycles since coming out of idle,
-        // or when we are above our max speed for a very long time (should only happend if entering sleep
-        // at high loads)
-        if ((cpu_load > max_cpu_load || delta_idle == 0) &&
-            !(policy->cur > this_smartass->max_speed &&
-              cputime64_sub(update_time, this_smartass->freq_change_time) > 100*down_rate_us)) {
+        // sleep_max_freq==0 disables the sleep and wakeup limits
+        smartass_update_min_max(this_smartass, policy,
+                                suspended && sleep_max_freq);
 
-                if (policy->cur > this_smartass->max_speed) {
-                        reset_timer(data,this_smartass);
+        if (xchg(&suspend_changed, 0) && sleep_max_freq) {
+                // to avoid wakeup issues with quick sleep/wakeup don't change actual frequency when entering sleep
+                // to allow some time to settle down.
+                // if eventually, even at full load the timer will lower the freqeuncy.
+                this_smartass->time_since_change = 0;
+                if (suspended) {
+                        if (debug_mask & SMARTASS_DEBUG_JUMPS)
+                                printk(KERN_INFO "SmartassS: suspending at %d\n",policy->cur);
+                        return 0;
                 }
 
-                if (policy->cur == policy->max)
-                        return;
-
-                if (nr_running() < 1)
-                        return;
-
-                if (cputime64_sub(update_time, this_smartass->freq_change_time) < up_rate_us)
-                        return;
+                // resume at max speed:
+                new_freq = validate_freq(this_smartass,sleep_wakeup_freq);
 
+                if (debug_mask & SMARTASS_DEBUG_JUMPS)
+                        printk(KERN_INFO "SmartassS: awaking at %d\n",new_freq);
 
-                this_smartass->force_ramp_up = 1;
-                cpumask_set_cpu(data, &work_cpumask);
-                queue_work(up_wq, &freq_scale_work);
-                return;
+                gcpu->relation = CPUFREQ_RELATION_L;
+                return new_freq;
         }
 
-        /*
-         * There is a window where if the cpu utlization can go from low to high
-         * between the timer expiring, delta_idle will be > 0 and the cpu will
-         * be 100% busy, preventing idle from running, and this timer from
-         * firing. So setup another timer to fire to check cpu utlization.
-         * Do not setup the timer if there is no scheduled work or if at max speed.
-         */
-        if (policy->cur < this_smartass->max_speed && !timer_pending(&this_smartass->timer) && nr_running() > 0)
-                reset_timer(data,this_smartass);
-
-        if (policy->cur == policy->min)
-                return;
-
-        /*
-         * Do not scale down unless we have been at this frequency for the
-         * minimum sample time.
-         */
-        if (cputime64_sub(update_time, this_smartass->freq_change_time) < down_rate_us)
-                return;
+        if (debug_mask & SMARTASS_DEBUG_LOAD)
+                printk(KERN_INFO "smartassT @ %d: load %d (window %u)\n",policy->cur,cpu_load,gcpu->window);
 
-        cpumask_set_cpu(data, &work_cpumask);
-        queue_work(down_wq, &freq_scale_work);
-}
+        // Scale up if load is above max or if there where no idle cycles since the last sample,
+        // or when we are above our max speed for a very long time (should only happend if entering sleep
+        // at high loads)
+        if ((cpu_load > max_cpu_load || cpu_load == 100) &&
+            !(policy->cur > this_smartass->max_speed &&
+              this_smartass->time_since_change > 100*down_rate_us)) {
 
-static void cpufreq_idle(void)
-{
-        struct smartass_info_s *this_smartass = &per_cpu(smartass_info, smp_processor_id());
-        struct cpufreq_policy *policy = this_smartass->cur_policy;
+                if (policy->cur == policy->max)
+                        return 0;
 
-        if (!this_smartass->enable) {
-                pm_idle_old();
-                return;
-        }
+                if (this_smartass->time_since_change < up_rate_us)
+                        return 0;
 
-        if (policy->cur == this_smartass->min_speed && timer_pending(&this_smartass->timer))
-                del_timer(&this_smartass->timer);
+                /* the sampling work itself is one of the running tasks */
+                force_ramp_up = cpu_load == 100 && nr_running() > 1;
 
-        pm_idle_old();
+                if (force_ramp_up && up_min_freq) {
+                        new_freq = up_min_freq;
+                        gcpu->relation = CPUFREQ_RELATION_L;
+                } else if (ramp_up_step) {
+                        new_freq = policy->cur + ramp_up_step;
+                } else {
+                        new_freq = this_smartass->max_speed;
+                }
+        } else {
+                if (policy->cur == policy->min)
+                        return 0;
 
-        if (!timer_pending(&this_smartass->timer))
-                reset_timer(smp_processor_id(), this_smartass);
-}
+                /*
+                 * Do not scale down unless we have been at this frequency for the
+                 * minimum sample time.
+                 */
+                if (this_smartass->time_since_change < down_rate_us)
+                        return 0;
 
-/* We use the same work function to sale up and down */
-static void cpufreq_smartass_freq_change_time_work(struct work_struct *work)
-{
-        unsigned int cpu;
-        int new_freq;
-        unsigned int force_ramp_up;
-        int cpu_load;
-        struct smartass_info_s *this_smartass;
-        struct cpufreq_policy *policy;
-        unsigned int relation = CPUFREQ_RELATION_L;
-        cpumask_t tmp_mask = work_cpumask;
-        for_each_cpu(cpu, &tmp_mask) {
-                this_smartass = &per_cpu(smartass_info, cpu);
-                policy = this_smartass->cur_policy;
-                cpu_load = this_smartass->cur_cpu_load;
-                force_ramp_up = this_smartass->force_ramp_up && nr_running() > 1;
-                this_smartass->force_ramp_up = 0;
-
-                if (force_ramp_up || cpu_load > max_cpu_load) {
-                        if (force_ramp_up && up_min_freq) {
-                                new_freq = up_min_freq;
-                                relation = CPUFREQ_RELATION_L;
-                        } else if (ramp_up_step) {
-                                new_freq = policy->cur + ramp_up_step;
-                                relation = CPUFREQ_RELATION_H;
-                        } else {
-                                new_freq = this_smartass->max_speed;
-                                relation = CPUFREQ_RELATION_H;
-                        }
-                }
-                else if (cpu_load < min_cpu_load) {
+                if (cpu_load < min_cpu_load) {
                         if (ramp_down_step)
                                 new_freq = policy->cur - ramp_down_step;
                         else {
                                 cpu_load += 100 - max_cpu_load; // dummy load.
                                 new_freq = policy->cur * cpu_load / 100;
                         }
-                        relation = CPUFREQ_RELATION_L;
+                        gcpu->relation = CPUFREQ_RELATION_L;
                 }
                 else new_freq = policy->cur;
+        }
 
-                new_freq = validate_freq(this_smartass,new_freq);
+        new_freq = validate_freq(this_smartass,new_freq);
 
-                if (new_freq != policy->cur) {
-                        if (debug_mask & SMARTASS_DEBUG_JUMPS)
-                                printk(KERN_INFO "SmartassQ: jumping from %d to %d\n",policy->cur,new_freq);
+        if (new_freq == policy->cur)
+                return 0;
 
-                        __cpufreq_driver_target(policy, new_freq, relation);
+        if (debug_mask & SMARTASS_DEBUG_JUMPS)
+                printk(KERN_INFO "SmartassQ: jumping from %d to %d\n",policy->cur,new_freq);
 
-                        this_smartass->freq_change_time_in_idle =
-                                get_cpu_idle_time_us(cpu,&this_smartass->freq_change_time);
-                }
-
-                cpumask_clear_cpu(cpu, &work_cpumask);
-        }
+        return new_freq;
 }
 
 static ssize_t show_debug_mask(struct cpufreq_policy *policy, char *buf)
@@ -359,7 +292,7 @@ static ssize_t store_debug_mask(struct cpufreq_policy *policy, const char *buf,
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0)
           debug_mask = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr debug_mask_attr = __ATTR(debug_mask, 0644,
@@ -377,7 +310,7 @@ static ssize_t store_up_rate_us(struct cpufreq_policy *policy, const char *buf,
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0 && input <= 100000000)
           up_rate_us = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr up_rate_us_attr = __ATTR(up_rate_us, 0644,
@@ -393,9 +326,12 @@ static ssize_t store_down_rate_us(struct cpufreq_policy *policy, const char *buf
         ssize_t res;
         unsigned long input;
         res = strict_strtoul(buf, 0, &input);
-        if (res >= 0 && input >= 0 && input <= 100000000)
+        if (res >= 0 && input >= 0 && input <= 100000000) {
           down_rate_us = input;
-        return res;
+          /* an idle cpu is woken up to ramp down once it may */
+          smartass_gov.timer_slack = input;
+        }
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr down_rate_us_attr = __ATTR(down_rate_us, 0644,
@@ -413,7 +349,7 @@ static ssize_t store_up_min_freq(struct cpufreq_policy *policy, const char *buf,
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           up_min_freq = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr up_min_freq_attr = __ATTR(up_min_freq, 0644,
@@ -431,7 +367,7 @@ static ssize_t store_sleep_max_freq(struct cpufreq_policy *policy, const char *b
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           sleep_max_freq = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr sleep_max_freq_attr = __ATTR(sleep_max_freq, 0644,
@@ -449,7 +385,7 @@ static ssize_t store_sleep_wakeup_freq(struct cpufreq_policy *policy, const char
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           sleep_wakeup_freq = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr sleep_wakeup_freq_attr = __ATTR(sleep_wakeup_freq, 0644,
@@ -467,7 +403,7 @@ static ssize_t store_awake_min_freq(struct cpufreq_policy *policy, const char *b
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           awake_min_freq = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr awake_min_freq_attr = __ATTR(awake_min_freq, 0644,
@@ -475,7 +411,7 @@ static struct freq_attr awake_min_freq_attr = __ATTR(awake_min_freq, 0644,
 
 static ssize_t show_sample_rate_jiffies(struct cpufreq_policy *policy, char *buf)
 {
-        return sprintf(buf, "%u\n", sample_rate_jiffies);
+        return sprintf(buf, "%lu\n", usecs_to_jiffies(smartass_gov.sampling_rate));
 }
 
 static ssize_t store_sample_rate_jiffies(struct cpufreq_policy *policy, const char *buf, size_t count)
@@ -484,8 +420,8 @@ static ssize_t store_sample_rate_jiffies(struct cpufreq_policy *policy, const ch
         unsigned long input;
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input > 0 && input <= 1000)
-          sample_rate_jiffies = input;
-        return res;
+          smartass_gov.sampling_rate = jiffies_to_usecs(input);
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr sample_rate_jiffies_attr = __ATTR(sample_rate_jiffies, 0644,
@@ -503,7 +439,7 @@ static ssize_t store_ramp_up_step(struct cpufreq_policy *policy, const char *buf
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           ramp_up_step = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr ramp_up_step_attr = __ATTR(ramp_up_step, 0644,
@@ -521,7 +457,7 @@ static ssize_t store_ramp_down_step(struct cpufreq_policy *policy, const char *b
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input >= 0)
           ramp_down_step = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr ramp_down_step_attr = __ATTR(ramp_down_step, 0644,
@@ -539,7 +475,7 @@ static ssize_t store_max_cpu_load(struct cpufreq_policy *policy, const char *buf
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input > 0 && input <= 100)
           max_cpu_load = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr max_cpu_load_attr = __ATTR(max_cpu_load, 0644,
@@ -557,7 +493,7 @@ static ssize_t store_min_cpu_load(struct cpufreq_policy *policy, const char *buf
         res = strict_strtoul(buf, 0, &input);
         if (res >= 0 && input > 0 && input < 100)
           min_cpu_load = input;
-        return res;
+        return res < 0 ? res : count;
 }
 
 static struct freq_attr min_cpu_load_attr = __ATTR(min_cpu_load, 0644,
@@ -579,110 +515,53 @@ static struct attribute * smartass_attributes[] = {
         NULL,
 };
 
-static struct attribute_group smartass_attr_group = {
-        .attrs = smartass_attributes,
-        .name = "smartass",
-};
-
-static int cpufreq_governor_smartass(struct cpufreq_policy *new_policy,
-                unsigned int event)
+static void cpufreq_smartass_start(struct cpufreq_gov_cpu *gcpu)
 {
-        unsigned int cpu = new_policy->cpu;
-        int rc;
-        struct smartass_info_s *this_smartass = &per_cpu(smartass_info, cpu);
+        struct smartass_info_s *this_smartass = &per_cpu(smartass_info, gcpu->cpu);
+        struct cpufreq_policy *policy = gcpu->cur_policy;
 
-        switch (event) {
-        case CPUFREQ_GOV_START:
-                if ((!cpu_online(cpu)) || (!new_policy->cur))
-                        return -EINVAL;
+        smartass_update_min_max(this_smartass, policy,
+                                suspended && sleep_max_freq);
+        this_smartass->freq = policy->cur;
+        this_smartass->time_since_change = 0;
 
-                /*
-                 * Do not register the idle hook and create sysfs
-                 * entries if we have already done so.
-                 */
-                if (atomic_inc_return(&active_count) <= 1) {
-                        rc = sysfs_create_group(&new_policy->kobj, &smartass_attr_group);
-                        if (rc)
-                                return rc;
-                        pm_idle_old = pm_idle;
-                        pm_idle = cpufreq_idle;
-                }
-
-                this_smartass->cur_policy = new_policy;
-                this_smartass->enable = 1;
-
-                // notice no break here!
-
-        case CPUFREQ_GOV_LIMITS:
-                smartass_update_min_max(this_smartass,new_policy,suspended);
-                if (this_smartass->cur_policy->cur != this_smartass->max_speed) {
-                        if (debug_mask & SMARTASS_DEBUG_JUMPS)
-                                printk(KERN_INFO "SmartassI: initializing to %d\n",this_smartass->max_speed);
-                        __cpufreq_driver_target(new_policy, this_smartass->max_speed, CPUFREQ_RELATION_H);
-                }
-                break;
-
-        case CPUFREQ_GOV_STOP:
-                del_timer(&this_smartass->timer);
-                this_smartass->enable = 0;
-
-                if (atomic_dec_return(&active_count) > 1)
-                        return 0;
-                sysfs_remove_group(&new_policy->kobj,
-                                &smartass_attr_group);
-
-                pm_idle = pm_idle_old;
-                break;
+        if (policy->cur != this_smartass->max_speed) {
+                if (debug_mask & SMARTASS_DEBUG_JUMPS)
+                        printk(KERN_INFO "SmartassI: initializing to %d\n",this_smartass->max_speed);
+                __cpufreq_driver_target(policy, this_smartass->max_speed, CPUFREQ_RELATION_H);
         }
-
-        return 0;
 }
 
-static void smartass_suspend(int cpu, int suspend)
-{
-        struct smartass_info_s *this_smartass = &per_cpu(smartass_info, smp_processor_id());
-        struct cpufreq_policy *policy = this_smartass->cur_policy;
-        unsigned int new_freq;
-
-        if (!this_smartass->enable || sleep_max_freq==0) // disable behavior for sleep_max_freq==0
-                return;
-
-        smartass_update_min_max(this_smartass,policy,suspend);
-        if (!suspend) { // resume at max speed:
-                new_freq = validate_freq(this_smartass,sleep_wakeup_freq);
-
-                if (debug_mask & SMARTASS_DEBUG_JUMPS)
-                        printk(KERN_INFO "SmartassS: awaking at %d\n",new_freq);
-
-                __cpufreq_driver_target(policy, new_freq,
-                                        CPUFREQ_RELATION_L);
-
-                if (policy->cur < this_smartass->max_speed && !timer_pending(&this_smartass->timer))
-                        reset_timer(smp_processor_id(),this_smartass);
-        } else {
-                // to avoid wakeup issues with quick sleep/wakeup don't change actual frequency when entering sleep
-                // to allow some time to settle down.
-                // we reset the timer, if eventually, even at full load the timer will lower the freqeuncy.
-                reset_timer(smp_processor_id(),this_smartass);
+static const struct cpufreq_gov_ops smartass_ops = {
+        .select = cpufreq_smartass_select,
+        .start = cpufreq_smartass_start,
+};
 
-                this_smartass->freq_change_time_in_idle =
-                        get_cpu_idle_time_us(cpu,&this_smartass->freq_change_time);
+static struct cpufreq_gov smartass_gov = {
+        .governor = &cpufreq_gov_smartass,
+        .ops = &smartass_ops,
+        .attrs = smartass_attributes,
+};
 
-                if (debug_mask & SMARTASS_DEBUG_JUMPS)
-                        printk(KERN_INFO "SmartassS: suspending at %d\n",policy->cur);
-        }
+static int cpufreq_governor_smartass(struct cpufreq_policy *new_policy,
+                unsigned int event)
+{
+        return cpufreq_gov_event(&smartass_gov, new_policy, event);
 }
 
 static void smartass_early_suspend(struct early_suspend *handler) {
-        int i;
-        for_each_online_cpu(i)
-                smartass_suspend(i,1);
+        suspended = 1;
+        suspend_changed = 1;
 }
 
 static void smartass_late_resume(struct early_suspend *handler) {
         int i;
+
+        suspended = 0;
+        suspend_changed = 1;
+        /* wake up at sleep_wakeup_freq at once */
         for_each_online_cpu(i)
-                smartass_suspend(i,0);
+                cpufreq_gov_kick(i);
 }
 
 static struct early_suspend smartass_power_suspend = {
@@ -702,7 +581,6 @@ static int __init cpufreq_smartass_init(void)
         sleep_max_freq = DEFAULT_SLEEP_MAX_FREQ;
         sleep_wakeup_freq = DEFAULT_SLEEP_WAKEUP_FREQ;
         awake_min_freq = DEFAULT_AWAKE_MIN_FREQ;
-        sample_rate_jiffies = DEFAULT_SAMPLE_RATE_JIFFIES;
         ramp_up_step = DEFAULT_RAMP_UP_STEP;
         ramp_down_step = DEFAULT_RAMP_DOWN_STEP;
         max_cpu_load = DEFAULT_MAX_CPU_LOAD;
@@ -713,44 +591,34 @@ static int __init cpufreq_smartass_init(void)
         /* Initalize per-cpu data: */
         for_each_possible_cpu(i) {
                 this_smartass = &per_cpu(smartass_info, i);
-                this_smartass->enable = 0;
-                this_smartass->cur_policy = 0;
-                this_smartass->force_ramp_up = 0;
                 this_smartass->max_speed = DEFAULT_SLEEP_WAKEUP_FREQ;
                 this_smartass->min_speed = DEFAULT_AWAKE_MIN_FREQ;
-                this_smartass->time_in_idle = 0;
-                this_smartass->idle_exit_time = 0;
-                this_smartass->freq_change_time = 0;
-                this_smartass->freq_change_time_in_idle = 0;
-                this_smartass->cur_cpu_load = 0;
-                // intialize timer:
-                init_timer_deferrable(&this_smartass->timer);
-                this_smartass->timer.function = cpufreq_smartass_timer;
-                this_smartass->timer.data = i;
+                this_smartass->freq = 0;
+                this_smartass->time_since_change = 0;
         }
 
-        /* Scale up is high priority */
-        up_wq = create_rt_workqueue("ksmartass_up");
-        down_wq = create_workqueue("ksmartass_down");
-
-        INIT_WORK(&freq_scale_work, cpufreq_smartass_freq_change_time_work);
+        smartass_gov.min_sampling_rate = jiffies_to_usecs(1);
+        smartass_gov.sampling_rate =
+                jiffies_to_usecs(DEFAULT_SAMPLE_RATE_JIFFIES);
+        /* an idle cpu is woken up to ramp down once it may */
+        smartass_gov.timer_slack = down_rate_us;
+        smartass_gov.util_kick = DEFAULT_UTIL_KICK;
 
         register_early_suspend(&smartass_power_suspend);
 
-        return cpufreq_register_governor(&cpufreq_gov_smartass);
+        return cpufreq_gov_register(&smartass_gov);
 }
 
 #ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_SMARTASS
-pure_initcall(cpufreq_smartass_init);
+fs_initcall(cpufreq_smartass_init);
 #else
 module_init(cpufreq_smartass_init);
 #endif
 
 static void __exit cpufreq_smartass_exit(void)
 {
-        cpufreq_unregister_governor(&cpufreq_gov_smartass);
-        destroy_workqueue(up_wq);
-        destroy_workqueue(down_wq);
+        unregister_early_suspend(&smartass_power_suspend);
+        cpufreq_gov_unregister(&smartass_gov);
 }
 
 module_exit(cpufreq_smartass_exit);
@@ -24,17 +24,17 @@
  *
  */
 
+#include <linux/module.h>
 #include <linux/cpu.h>
 #include <linux/cpumask.h>
 #include <linux/cpufreq.h>
+#include <linux/jiffies.h>
 #include <linux/sched.h>
-#include <linux/tick.h>
-#include <linux/timer.h>
-#include <linux/workqueue.h>
 #include <linux/moduleparam.h>
-#include <asm/cputime.h>
 #include <linux/earlysuspend.h>
 
+#include "cpufreq_governor.h"
+
 
 /******************** Tunable parameters: ********************/
 
@@ -109,40 +109,34 @@ static unsigned int sleep_wakeup_freq;
  * Sampling rate, I highly recommend to leave it at 2.
  */
 #define DEFAULT_SAMPLE_RATE_JIFFIES 2
-static unsigned int sample_rate_jiffies;
 
+/*
+ * Sample at once when the scheduler sees the utilization of a cpu rise by
+ * this percentage of the current speed, as the idle exit hook used to.
+ */
+#define DEFAULT_UTIL_KICK 10
 
-/*************** End of tunables ***************/
 
+/*************** End of tunables ***************/
 
-static void (*pm_idle_old)(void);
-static atomic_t active_count = ATOMIC_INIT(0);
 
+/*
+ * Sampling, idle accounting and the timers are done by the common
+ * governor core, every sample_rate_jiffies. What is kept here is how long
+ * the policy has been at its current frequency.
+ */
 struct smartass_info_s {
-	struct cpufreq_policy *cur_policy;
 	struct cpufreq_frequency_table *freq_table;
-	struct timer_list timer;
-	u64 time_in_idle;
-	u64 idle_exit_time;
-	u64 freq_change_time;
-	u64 freq_change_time_in_idle;
-	int cur_cpu_load;
-	int old_freq;
-	int ramp_dir;
-	unsigned int enable;
+	unsigned int freq;
+	/* us */
+	unsigned int time_since_change;
 	int ideal_speed;
 };
 static DEFINE_PER_CPU(struct smartass_info_s, smartass_info);
 
-/* Workqueues handle frequency scaling */
-static struct workqueue_struct *up_wq;
-static struct workqueue_struct *down_wq;
-static struct work_struct freq_scale_work;
-
-static cpumask_t work_cpumask;
-static spinlock_t cpumask_lock;
-
 static unsigned int suspended;
+/* the screen went on or off since the last sample */
+static unsigned int suspend_changed;
 
 #define dprintk(flag,msg...) do { \
 	if (debug_mask & flag) printk(KERN_DEBUG msg); \
@@ -172,6 +166,8 @@ struct cpufreq_governor cpufreq_gov_smartass2 = {
 	.owner = THIS_MODULE,
 };
 
+static struct cpufreq_gov smartass_gov;
+
 inline static void smartass_update_min_max(struct smartass_info_s *this_smartass, struct cpufreq_policy *policy, int suspend) {
 	if (suspend) {
 		this_smartass->ideal_speed = // sleep_ideal_freq; but make sure it obeys the policy min/max
@@ -184,15 +180,6 @@ inline static void smartass_update_min_max(struct smartass_info_s *this_smartass
 	}
 }
 
-inline static void smartass_update_min_max_allcpus(void) {
-	unsigned int i;
-	for_each_online_cpu(i) {
-		struct smartass_info_s *this_smartass = &per_cpu(smartass_info, i);
-		if (this_smartass->enable)
-			smartass_update_min_max(this_smartass,this_smartass->cur_policy,suspended);
-	}
-}
-
 inline static unsigned int validate_freq(struct cpufreq_policy *policy, int freq) {
 	if (freq > (int)policy->max)
 		return policy->max;
@@ -201,30 +188,12 @@ inline static unsigned int validate_freq(struct cpufreq_policy *policy, int freq
 	return freq;
 }
 
-inline static void reset_timer(unsigned long cpu, struct smartass_info_s *this_smartass) {
-	this_smartass->time_in_idle = get_cpu_idle_time_us(cpu, &this_smartass->idle_exit_time);
-	mod_timer(&this_smartass->timer, jiffies + sample_rate_jiffies);
-}
-
-inline static void work_cpumask_set(unsigned long cpu) {
-	unsigned long flags;
-	spin_lock_irqsave(&cpumask_lock, flags);
-	cpumask_set_cpu(cpu, &work_cpumask);
-	spin_unlock_irqrestore(&cpumask_lock, flags);
-}
-
-inline static int work_cpumask_test_and_clear(unsigned long cpu) {
-	unsigned long flags;
-	int res = 0;
-	spin_lock_irqsave(&cpumask_lock, flags);
-	res = cpumask_test_and_clear_cpu(cpu, &work_cpumask);
-	spin_unlock_irqrestore(&cpumask_lock, flags);
-	return res;
-}
-
-inline static int target_freq(struct cpufreq_policy *policy, struct smartass_info_s *this_smartass,
+/* returns the frequency for the core to set, 0 to stay at old_freq */
+inline static unsigned int target_freq(struct cpufreq_gov_cpu *gcpu, struct smartass_info_s *this_smartass,
 			      int new_freq, int old_freq, int prefered_relation) {
-	int index, target;
+	unsigned int index;
+	int target;
+	struct cpufreq_policy *policy = gcpu->cur_policy;
 	struct cpufreq_frequency_table *table = this_smartass->freq_table;
 
 	if (new_freq == old_freq)
@@ -263,197 +232,113 @@ inline static int target_freq(struct cpufreq_policy *policy, struct smartass_inf
 	}
 	else target = new_freq;
 
-	__cpufreq_driver_target(policy, target, prefered_relation);
+	gcpu->relation = prefered_relation;
 
-	dprintk(SMARTASS_DEBUG_JUMPS,"SmartassQ: jumping from %d to %d => %d (%d)\n",
-		old_freq,new_freq,target,policy->cur);
+	dprintk(SMARTASS_DEBUG_JUMPS,"SmartassQ: jumping from %d to %d => %d\n",
+		old_freq,new_freq,target);
 
 	return target;
 }
 
-static void cpufreq_smartass_timer(unsigned long cpu)
+static unsigned int cpufreq_smartass_select(struct cpufreq_gov_cpu *gcpu,
+		unsigned int cpu_load)
 {
-	u64 delta_idle;
-	u64 delta_time;
-	int cpu_load;
-	int old_freq;
-	u64 update_time;
-	u64 now_idle;
-	int queued_work = 0;
-	struct smartass_info_s *this_smartass = &per_cpu(smartass_info, cpu);
-	struct cpufreq_policy *policy = this_smartass->cur_policy;
-
-	now_idle = get_cpu_idle_time_us(cpu, &update_time);
-	old_freq = policy->cur;
-
-	if (this_smartass->idle_exit_time == 0 || update_time == this_smartass->idle_exit_time)
-		return;
-
-	delta_idle = cputime64_sub(now_idle, this_smartass->time_in_idle);
-	delta_time = cputime64_sub(update_time, this_smartass->idle_exit_time);
+	struct smartass_info_s *this_smartass = &per_cpu(smartass_info, gcpu->cpu);
+	struct cpufreq_policy *policy = gcpu->cur_policy;
+	int old_freq = policy->cur;
+	int new_freq;
+	unsigned int relation = CPUFREQ_RELATION_L;
 
-	// If timer ran less than 1ms after short-term sample started, retry.
-	if (delta_time < 1000) {
-		if (!timer_pending(&this_smartass->timer))
-			reset_timer(cpu,this_smartass);
-		return;
+	/* a new frequency took effect since the last sample */
+	if (this_smartass->freq != policy->cur) {
+		this_smartass->freq = policy->cur;
+		this_smartass->time_since_change = 0;
 	}
+	if (this_smartass->time_since_change < UINT_MAX - gcpu->window)
+		this_smartass->time_since_change += gcpu->window;
 
-	if (delta_idle > delta_time)
-		cpu_load = 0;
-	else
-		cpu_load = 100 * (unsigned int)(delta_time - delta_idle) / (unsigned int)delta_time;
+	smartass_update_min_max(this_smartass,policy,suspended);
 
-	dprintk(SMARTASS_DEBUG_LOAD,"smartassT @ %d: load %d (delta_time %llu)\n",
-		old_freq,cpu_load,delta_time);
+	if (xchg(&suspend_changed, 0)) {
+		if (!suspended) { // resume at max speed:
+			new_freq = validate_freq(policy,sleep_wakeup_freq);
 
-	this_smartass->cur_cpu_load = cpu_load;
-	this_smartass->old_freq = old_freq;
+			dprintk(SMARTASS_DEBUG_JUMPS,"SmartassS: awaking at %d\n",new_freq);
 
-	// Scale up if load is above max or if there where no idle cycles since coming out of idle,
-	// additionally, if we are at or above the ideal_speed, verify we have been at this frequency
-	// for at least up_rate_us:
-	if (cpu_load > max_cpu_load || delta_idle == 0)
-	{
-		if (old_freq < policy->max &&
-			 (old_freq < this_smartass->ideal_speed || delta_idle == 0 ||
-			  cputime64_sub(update_time, this_smartass->freq_change_time) >= up_rate_us))
-		{
-			dprintk(SMARTASS_DEBUG_ALG,"smartassT @ %d ramp up: load %d (delta_idle %llu)\n",
-				old_freq,cpu_load,delta_idle);
-			this_smartass->ramp_dir = 1;
-			work_cpumask_set(cpu);
-			queue_work(up_wq, &freq_scale_work);
-			queued_work = 1;
+			return target_freq(gcpu,this_smartass,new_freq,old_freq,
+					   CPUFREQ_RELATION_L);
 		}
-		else this_smartass->ramp_dir = 0;
-	}
-	// Similarly for scale down: load should be below min and if we are at or below ideal
-	// frequency we require that we have been at this frequency for at least down_rate_us:
-	else if (cpu_load < min_cpu_load && old_freq > policy->min &&
-		 (old_freq > this_smartass->ideal_speed ||
-		  cputime64_sub(update_time, this_smartass->freq_change_time) >= down_rate_us))
-	{
-		dprintk(SMARTASS_DEBUG_ALG,"smartassT @ %d ramp down: load %d (delta_idle %llu)\n",
-			old_freq,cpu_load,delta_idle);
-		this_smartass->ramp_dir = -1;
-		work_cpumask_set(cpu);
-		queue_work(down_wq, &freq_scale_work);
-		queued_work = 1;
-	}
-	else this_smartass->ramp_dir = 0;
-
-	// To avoid unnecessary load when the CPU is already at high load, we don't
-	// reset ourselves if we are at max speed. If and when there are idle cycles,
-	// the idle loop will activate the timer.
-	// Additionally, if we queued some work, the work task will reset the timer
-	// after it has done its adjustments.
-	if (!queued_work && old_freq < policy->max)
-		reset_timer(cpu,this_smartass);
-}
 
-static void cpufreq_idle(void)
-{
-	struct smartass_info_s *this_smartass = &per_cpu(smartass_info, smp_processor_id());
-	struct cpufreq_policy *policy = this_smartass->cur_policy;
+		// to avoid wakeup issues with quick sleep/wakeup don't change actual frequency when entering sleep
+		// to allow some time to settle down. Instead we just reset our statistics.
+		// Eventually, the next samples will adjust the frequency if necessary.
+		this_smartass->time_since_change = 0;
 
-	if (!this_smartass->enable) {
-		pm_idle_old();
-		return;
+		dprintk(SMARTASS_DEBUG_JUMPS,"SmartassS: suspending at %d\n",old_freq);
+		return 0;
 	}
 
-	if (policy->cur == policy->min && timer_pending(&this_smartass->timer))
-		del_timer(&this_smartass->timer);
+	dprintk(SMARTASS_DEBUG_LOAD,"smartassT @ %d: load %d (window %u)\n",
+		old_freq,cpu_load,gcpu->window);
 
-	pm_idle_old();
+	// Scale up if load is above max or if there where no idle cycles since the last sample,
+	// additionally, if we are at or above the ideal_speed, verify we have been at this frequency
+	// for at least up_rate_us:
+	if (cpu_load > max_cpu_load || cpu_load == 100)
+	{
+		if (old_freq >= policy->max ||
+		    (old_freq >= this_smartass->ideal_speed && cpu_load < 100 &&
+		     this_smartass->time_since_change < up_rate_us))
+			return 0;
 
-	if (!timer_pending(&this_smartass->timer))
-		reset_timer(smp_processor_id(), this_smartass);
-}
+		/* the sampling work itself is one of the running tasks */
+		if (nr_running() <= 1) {
+			dprintk(SMARTASS_DEBUG_ALG,"smartassQ @ %d nothing: nr_running=%lu\n",
+				old_freq,nr_running());
+			return 0;
+		}
 
-/* We use the same work function to sale up and down */
-static void cpufreq_smartass_freq_change_time_work(struct work_struct *work)
-{
-	unsigned int cpu;
-	int new_freq;
-	int old_freq;
-	int ramp_dir;
-	struct smartass_info_s *this_smartass;
-	struct cpufreq_policy *policy;
-	unsigned int relation = CPUFREQ_RELATION_L;
-	for_each_possible_cpu(cpu) {
-		this_smartass = &per_cpu(smartass_info, cpu);
-		if (!work_cpumask_test_and_clear(cpu))
-			continue;
-
-		ramp_dir = this_smartass->ramp_dir;
-		this_smartass->ramp_dir = 0;
-
-		old_freq = this_smartass->old_freq;
-		policy = this_smartass->cur_policy;
-
-		if (old_freq != policy->cur) {
-			// frequency was changed by someone else?
-			printk(KERN_WARNING "Smartass: frequency changed by 3rd party: %d to %d\n",
-			       old_freq,policy->cur);
-			new_freq = old_freq;
+		// ramp up logic:
+		if (old_freq < this_smartass->ideal_speed)
+			new_freq = this_smartass->ideal_speed;
+		else if (ramp_up_step) {
+			new_freq = old_freq + ramp_up_step;
+			relation = CPUFREQ_RELATION_H;
 		}
-		else if (ramp_dir > 0 && nr_running() > 1) {
-			// ramp up logic:
-			if (old_freq < this_smartass->ideal_speed)
-				new_freq = this_smartass->ideal_speed;
-			else if (ramp_up_step) {
-				new_freq = old_freq + ramp_up_step;
-				relation = CPUFREQ_RELATION_H;
-			}
-			else {
-				new_freq = policy->max;
-				relation = CPUFREQ_RELATION_H;
-			}
-			dprintk(SMARTASS_DEBUG_ALG,"smartassQ @ %d ramp up: ramp_dir=%d ideal=%d\n",
-				old_freq,ramp_dir,this_smartass->ideal_speed);
+		else {
+			new_freq = policy->max;
+			relation = CPUFREQ_RELATION_H;
 		}
-		else if (ramp_dir < 0) {
-			// ramp down logic:
-			if (old_freq > this_smartass->ideal_speed) {
-				new_freq = this_smartass->ideal_speed;
-				relation = CPUFREQ_RELATION_H;
-			}
-			else if (ramp_down_step)
-				new_freq = old_freq - ramp_down_step;
-			else {
-				// Load heuristics: Adjust new_freq such that, assuming a linear
-				// scaling of load vs. frequency, the load in the new frequency
-				// will be max_cpu_load:
-				new_freq = old_freq * this_smartass->cur_cpu_load / max_cpu_load;
-				if (new_freq > old_freq) // min_cpu_load > max_cpu_load ?!
-					new_freq = old_freq -1;
-			}
-			dprintk(SMARTASS_DEBUG_ALG,"smartassQ @ %d ramp down: ramp_dir=%d ideal=%d\n",
-				old_freq,ramp_dir,this_smartass->ideal_speed);
+		dprintk(SMARTASS_DEBUG_ALG,"smartassQ @ %d ramp up: load %d ideal=%d\n",
+			old_freq,cpu_load,this_smartass->ideal_speed);
+	}
+	// Similarly for scale down: load should be below min and if we are at or below ideal
+	// frequency we require that we have been at this frequency for at least down_rate_us:
+	else if (cpu_load < min_cpu_load && old_freq > policy->min &&
+		 (old_freq > this_smartass->ideal_speed ||
+		  this_smartass->time_since_change >= down_rate_us))
+	{
+		// ramp down logic:
+		if (old_freq > this_smartass->ideal_speed) {
+			new_freq = this_smartass->ideal_speed;
+			relation = CPUFREQ_RELATION_H;
 		}
-		else { // ramp_dir==0 ?! Could the timer change its mind about a queued ramp up/down
-		       // before the work task gets to run?
-		       // This may also happen if we refused to ramp up because the nr_running()==1
-			new_freq = old_freq;
-			dprintk(SMARTASS_DEBUG_ALG,"smartassQ @ %d nothing: ramp_dir=%d nr_running=%lu\n",
-				old_freq,ramp_dir,nr_running());
+		else if (ramp_down_step)
+			new_freq = old_freq - ramp_down_step;
+		else {
+			// Load heuristics: Adjust new_freq such that, assuming a linear
+			// scaling of load vs. frequency, the load in the new frequency
+			// will be max_cpu_load:
+			new_freq = old_freq * cpu_load / max_cpu_load;
+			if (new_freq > old_freq) // min_cpu_load > max_cpu_load ?!
+				new_freq = old_freq -1;
 		}
-
-		// do actual ramp up (returns 0, if frequency change failed):
-		new_freq = target_freq(policy,this_smartass,new_freq,old_freq,relation);
-		if (new_freq)
-			this_smartass->freq_change_time_in_idle =
-				get_cpu_idle_time_us(cpu,&this_smartass->freq_change_time);
-
-		// reset timer:
-		if (new_freq < policy->max)
-			reset_timer(cpu,this_smartass);
-		// if we are maxed out, it is pointless to use the timer
-		// (idle cycles wake up the timer when the timer comes)
-		else if (timer_pending(&this_smartass->timer))
-			del_timer(&this_smartass->timer);
+		dprintk(SMARTASS_DEBUG_ALG,"smartassQ @ %d ramp down: load %d ideal=%d\n",
+			old_freq,cpu_load,this_smartass->ideal_speed);
 	}
+	else return 0;
+
+	return target_freq(gcpu,this_smartass,new_freq,old_freq,relation);
 }
 
 static ssize_t show_debug_mask(struct kobject *kobj, struct attribute *attr, char *buf)
@@ -468,7 +353,7 @@ static ssize_t store_debug_mask(struct kobject *kobj, struct attribute *attr, co
 	res = strict_strtoul(buf, 0, &input);
 	if (res >= 0)
 		debug_mask = input;
-	return res;
+	return res < 0 ? res : count;
 }
 
 static ssize_t show_up_rate_us(struct kobject *kobj, struct attribute *attr, char *buf)
@@ -483,7 +368,7 @@ static ssize_t store_up_rate_us(struct kobject *kobj, struct attribute *attr, co
 	res = strict_strtoul(buf, 0, &input);
 	if (res >= 0 && input >= 0 && input <= 100000000)
 		up_rate_us = input;
-	return res;
+	return res < 0 ? res : count;
 }
 
 static ssize_t show_down_rate_us(struct kobject *kobj, struct attribute *attr, char *buf)
@@ -496,9 +381,12 @@ static ssize_t store_down_rate_us(struct kobject *kobj, struct attribute *attr,
 	ssize_t res;
 	unsigned long input;
 	res = strict_strtoul(buf, 0, &input);
-	if (res >= 0 && input >= 0 && input <= 100000000)
+	if (res >= 0 && input >= 0 && input <= 100000000) {
 		down_rate_us = input;
-	return res;
+		/* an idle cpu is woken up to ramp down once it may */
+		smartass_gov.timer_slack = input;
+	}
+	return res < 0 ? res : count;
 }
 
 static ssize_t show_sleep_ideal_freq(struct kobject *kobj, struct attribute *attr, char *buf)
@@ -511,12 +399,9 @@ static ssize_t store_sleep_ideal_freq(struct kobject *kobj, struct attribute *at
 	ssize_t res;
 	unsigned long input;
 	res = strict_strtoul(buf, 0, &input);
-	if (res >= 0 && input >= 0) {
+	if (res >= 0 && input >= 0)
 		sleep_ideal_freq = input;
-		if (suspended)
-			smartass_update_min_max_allcpus();
-	}
-	return res;
+	return res < 0 ? res : count;
 }
 
 static ssize_t show_sleep_wakeup_freq(struct kobject *kobj, struct attribute *attr, char *buf)
@@ -531,7 +416,7 @@ static ssize_t store_sleep_wakeup_freq(struct kobject *kobj, struct attribute *a
 	res = strict_strtoul(buf, 0, &input);
 	if (res >= 0 && input >= 0)
 		sleep_wakeup_freq = input;
-	return res;
+	return res < 0 ? res : count;
 }
 
 static ssize_t show_awake_ideal_freq(struct kobject *kobj, struct attribute *attr, char *buf)
@@ -544,17 +429,14 @@ static ssize_t store_awake_ideal_freq(struct kobject *kobj, struct attribute *at
 	ssize_t res;
 	unsigned long input;
 	res = strict_strtoul(buf, 0, &input);
-	if (res >= 0 && input >= 0) {
+	if (res >= 0 && input >= 0)
 		awake_ideal_freq = input;
-		if (!suspended)
-			smartass_update_min_max_allcpus();
-	}
-	return res;
+	return res < 0 ? res : count;
 }
 
 static ssize_t show_sample_rate_jiffies(struct kobject *kobj, struct attribute *attr, char *buf)
 {
-	return sprintf(buf, "%u\n", sample_rate_jiffies);
+	return sprintf(buf, "%lu\n", usecs_to_jiffies(smartass_gov.sampling_rate));
 }
 
 static ssize_t store_sample_rate_jiffies(struct kobject *kobj, struct attribute *attr, const char *buf, size_t count)
@@ -563,8 +445,8 @@ static ssize_t store_sample_rate_jiffies(struct kobject *kobj, struct attribute
 	unsigned long input;
 	res = strict_strtoul(buf, 0, &input);
 	if (res >= 0 && input > 0 && input <= 1000)
-		sample_rate_jiffies = input;
-	return res;
+		smartass_gov.sampling_rate = jiffies_to_usecs(input);
+	return res < 0 ? res : count;
 }
 
 static ssize_t show_ramp_up_step(struct kobject *kobj, struct attribute *attr, char *buf)
@@ -579,7 +461,7 @@ static ssize_t store_ramp_up_step(struct kobject *kobj, struct attribute *attr,
 	res = strict_strtoul(buf, 0, &input);
 	if (res >= 0 && input >= 0)
 		ramp_up_step = input;
-	return res;
+	return res < 0 ? res : count;
 }
 
 static ssize_t show_ramp_down_step(struct kobject *kobj, struct attribute *attr, char *buf)
@@ -594,7 +476,7 @@ static ssize_t store_ramp_down_step(struct kobject *kobj, struct attribute *attr
 	res = strict_strtoul(buf, 0, &input);
 	if (res >= 0 && input >= 0)
 		ramp_down_step = input;
-	return res;
+	return res < 0 ? res : count;
 }
 
 static ssize_t show_max_cpu_load(struct kobject *kobj, struct attribute *attr, char *buf)
@@ -609,7 +491,7 @@ static ssize_t store_max_cpu_load(struct kobject *kobj, struct attribute *attr,
 	res = strict_strtoul(buf, 0, &input);
 	if (res >= 0 && input > 0 && input <= 100)
 		max_cpu_load = input;
-	return res;
+	return res < 0 ? res : count;
 }
 
 static ssize_t show_min_cpu_load(struct kobject *kobj, struct attribute *attr, char *buf)
@@ -624,7 +506,7 @@ static ssize_t store_min_cpu_load(struct kobject *kobj, struct attribute *attr,
 	res = strict_strtoul(buf, 0, &input);
 	if (res >= 0 && input > 0 && input < 100)
 		min_cpu_load = input;
-	return res;
+	return res < 0 ? res : count;
 }
 
 #define define_global_rw_attr(_name)		\
@@ -658,127 +540,44 @@ static struct attribute * smartass_attributes[] = {
 	NULL,
 };
 
-static struct attribute_group smartass_attr_group = {
-	.attrs = smartass_attributes,
-	.name = "smartass",
-};
-
-static int cpufreq_governor_smartass(struct cpufreq_policy *new_policy,
-		unsigned int event)
+static void cpufreq_smartass_start(struct cpufreq_gov_cpu *gcpu)
 {
-	unsigned int cpu = new_policy->cpu;
-	int rc;
-	struct smartass_info_s *this_smartass = &per_cpu(smartass_info, cpu);
-
-	switch (event) {
-	case CPUFREQ_GOV_START:
-		if ((!cpu_online(cpu)) || (!new_policy->cur))
-			return -EINVAL;
-
-		this_smartass->cur_policy = new_policy;
-
-		this_smartass->enable = 1;
-
-		smartass_update_min_max(this_smartass,new_policy,suspended);
-
-		this_smartass->freq_table = cpufreq_frequency_get_table(cpu);
-		if (!this_smartass->freq_table)
-			printk(KERN_WARNING "Smartass: no frequency table for cpu %d?!\n",cpu);
-
-		smp_wmb();
-
-		// Do not register the idle hook and create sysfs
-		// entries if we have already done so.
-		if (atomic_inc_return(&active_count) <= 1) {
-			rc = sysfs_create_group(cpufreq_global_kobject,
-						&smartass_attr_group);
-			if (rc)
-				return rc;
-
-			pm_idle_old = pm_idle;
-			pm_idle = cpufreq_idle;
-		}
-
-		if (this_smartass->cur_policy->cur < new_policy->max && !timer_pending(&this_smartass->timer))
-			reset_timer(cpu,this_smartass);
-
-		break;
-
-	case CPUFREQ_GOV_LIMITS:
-		smartass_update_min_max(this_smartass,new_policy,suspended);
-
-		if (this_smartass->cur_policy->cur > new_policy->max) {
-			dprintk(SMARTASS_DEBUG_JUMPS,"SmartassI: jumping to new max freq: %d\n",new_policy->max);
-			__cpufreq_driver_target(this_smartass->cur_policy,
-						new_policy->max, CPUFREQ_RELATION_H);
-		}
-		else if (this_smartass->cur_policy->cur < new_policy->min) {
-			dprintk(SMARTASS_DEBUG_JUMPS,"SmartassI: jumping to new min freq: %d\n",new_policy->min);
-			__cpufreq_driver_target(this_smartass->cur_policy,
-						new_policy->min, CPUFREQ_RELATION_L);
-		}
+	struct smartass_info_s *this_smartass = &per_cpu(smartass_info, gcpu->cpu);
+	struct cpufreq_policy *policy = gcpu->cur_policy;
 
-		if (this_smartass->cur_policy->cur < new_policy->max && !timer_pending(&this_smartass->timer))
-			reset_timer(cpu,this_smartass);
+	this_smartass->freq_table = cpufreq_frequency_get_table(gcpu->cpu);
+	if (!this_smartass->freq_table)
+		printk(KERN_WARNING "Smartass: no frequency table for cpu %d?!\n",gcpu->cpu);
 
-		break;
-
-	case CPUFREQ_GOV_STOP:
-		this_smartass->enable = 0;
-		smp_wmb();
-		del_timer(&this_smartass->timer);
-		flush_work(&freq_scale_work);
-		this_smartass->idle_exit_time = 0;
-
-		if (atomic_dec_return(&active_count) <= 1) {
-			sysfs_remove_group(cpufreq_global_kobject,
-					   &smartass_attr_group);
-			pm_idle = pm_idle_old;
-		}
-		break;
-	}
-
-	return 0;
+	smartass_update_min_max(this_smartass,policy,suspended);
+	this_smartass->freq = policy->cur;
+	this_smartass->time_since_change = 0;
 }
 
-static void smartass_suspend(int cpu, int suspend)
-{
-	struct smartass_info_s *this_smartass = &per_cpu(smartass_info, smp_processor_id());
-	struct cpufreq_policy *policy = this_smartass->cur_policy;
-	unsigned int new_freq;
-
-	if (!this_smartass->enable)
-		return;
-
-	smartass_update_min_max(this_smartass,policy,suspend);
-	if (!suspend) { // resume at max speed:
-		new_freq = validate_freq(policy,sleep_wakeup_freq);
-
-		dprintk(SMARTASS_DEBUG_JUMPS,"SmartassS: awaking at %d\n",new_freq);
-
-		__cpufreq_driver_target(policy, new_freq,
-					CPUFREQ_RELATION_L);
-	} else {
-		// to avoid wakeup issues with quick sleep/wakeup don't change actual frequency when entering sleep
-		// to allow some time to settle down. Instead we just reset our statistics (and reset the timer).
-		// Eventually, the timer will adjust the frequency if necessary.
-
-		this_smartass->freq_change_time_in_idle =
-			get_cpu_idle_time_us(cpu,&this_smartass->freq_change_time);
+static const struct cpufreq_gov_ops smartass_ops = {
+	.select = cpufreq_smartass_select,
+	.start = cpufreq_smartass_start,
+};
 
-		dprintk(SMARTASS_DEBUG_JUMPS,"SmartassS: suspending at %d\n",policy->cur);
-	}
+static struct cpufreq_gov smartass_gov = {
+	.governor = &cpufreq_gov_smartass2,
+	.ops = &smartass_ops,
+	.attrs = smartass_attributes,
+	.sysfs_name = "smartass",
+	.sysfs_global = 1,
+};
 
-	reset_timer(smp_processor_id(),this_smartass);
+static int cpufreq_governor_smartass(struct cpufreq_policy *new_policy,
+		unsigned int event)
+{
+	return cpufreq_gov_event(&smartass_gov, new_policy, event);
 }
 
 static void smartass_early_suspend(struct early_suspend *handler) {
-	int i;
 	if (suspended || sleep_ideal_freq==0) // disable behavior for sleep_ideal_freq==0
 		return;
 	suspended = 1;
-	for_each_online_cpu(i)
-		smartass_suspend(i,1);
+	suspend_changed = 1;
 }
 
 static void smartass_late_resume(struct early_suspend *handler) {
@@ -786,8 +585,10 @@ static void smartass_late_resume(struct early_suspend *handler) {
 	if (!suspended) // already not suspended so nothing to do
 		return;
 	suspended = 0;
+	suspend_changed = 1;
+	/* wake up at sleep_wakeup_freq at once */
 	for_each_online_cpu(i)
-		smartass_suspend(i,0);
+		cpufreq_gov_kick(i);
 }
 
 static struct early_suspend smartass_power_suspend = {
@@ -800,53 +601,29 @@ static struct early_suspend smartass_power_suspend = {
 
 static int __init cpufreq_smartass_init(void)
 {
-	unsigned int i;
-	struct smartass_info_s *this_smartass;
 	debug_mask = 0;
 	up_rate_us = DEFAULT_UP_RATE_US;
 	down_rate_us = DEFAULT_DOWN_RATE_US;
 	sleep_ideal_freq = DEFAULT_SLEEP_IDEAL_FREQ;
 	sleep_wakeup_freq = DEFAULT_SLEEP_WAKEUP_FREQ;
 	awake_ideal_freq = DEFAULT_AWAKE_IDEAL_FREQ;
-	sample_rate_jiffies = DEFAULT_SAMPLE_RATE_JIFFIES;
 	ramp_up_step = DEFAULT_RAMP_UP_STEP;
 	ramp_down_step = DEFAULT_RAMP_DOWN_STEP;
 	max_cpu_load = DEFAULT_MAX_CPU_LOAD;
 	min_cpu_load = DEFAULT_MIN_CPU_LOAD;
 
-	spin_lock_init(&cpumask_lock);
-
 	suspended = 0;
 
-	/* Initalize per-cpu data: */
-	for_each_possible_cpu(i) {
-		this_smartass = &per_cpu(smartass_info, i);
-		this_smartass->enable = 0;
-		this_smartass->cur_policy = 0;
-		this_smartass->ramp_dir = 0;
-		this_smartass->time_in_idle = 0;
-		this_smartass->idle_exit_time = 0;
-		this_smartass->freq_change_time = 0;
-		this_smartass->freq_change_time_in_idle = 0;
-		this_smartass->cur_cpu_load = 0;
-		// intialize timer:
-		init_timer_deferrable(&this_smartass->timer);
-		this_smartass->timer.function = cpufreq_smartass_timer;
-		this_smartass->timer.data = i;
-		work_cpumask_test_and_clear(i);
-	}
-
-	// Scale up is high priority
-	up_wq = create_workqueue("ksmartass_up");
-	down_wq = create_workqueue("ksmartass_down");
-	if (!up_wq || !down_wq)
-		return -ENOMEM;
-
-	INIT_WORK(&freq_scale_work, cpufreq_smartass_freq_change_time_work);
+	smartass_gov.min_sampling_rate = jiffies_to_usecs(1);
+	smartass_gov.sampling_rate =
+		jiffies_to_usecs(DEFAULT_SAMPLE_RATE_JIFFIES);
+	/* an idle cpu is woken up to ramp down once it may */
+	smartass_gov.timer_slack = down_rate_us;
+	smartass_gov.util_kick = DEFAULT_UTIL_KICK;
 
 	register_early_suspend(&smartass_power_suspend);
 
-	return cpufreq_register_governor(&cpufreq_gov_smartass2);
+	return cpufreq_gov_register(&smartass_gov);
 }
 
 #ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_SMARTASS2
@@ -857,9 +634,8 @@ module_init(cpufreq_smartass_init);
 
 static void __exit cpufreq_smartass_exit(void)
 {
-	cpufreq_unregister_governor(&cpufreq_gov_smartass2);
-	destroy_workqueue(up_wq);
-	destroy_workqueue(down_wq);
+	unregister_early_suspend(&smartass_power_suspend);
+	cpufreq_gov_unregister(&smartass_gov);
 }
 
 module_exit(cpufreq_smartass_exit);
@@ -44,6 +44,11 @@
 #define FIMG2D_DMA_CACHE_CLEAN		_IOWR(FIMG2D_IOCTL_MAGIC, 5, struct fimg2d_dma_info)
 #define FIMG2D_DMA_CACHE_FLUSH		_IOWR(FIMG2D_IOCTL_MAGIC, 6, struct fimg2d_dma_info)
 #define FIMG2D_DMA_CACHE_FLUSH_ALL	_IO(FIMG2D_IOCTL_MAGIC, 7)
+#define FIMG2D_BITBLT_BATCH		_IOWR(FIMG2D_IOCTL_MAGIC, 8, struct fimg2d_user_batch)
+
+/* batch */
+#define FIMG2D_BATCH_MAX		(256)
+#define FIMG2D_BATCH_ASYNC		(1 << 0)
 
 
 typedef int FIMG2D_ADDR_TYPE_T;
@@ -189,6 +194,33 @@ struct fimg2d_user_region {
 	struct fimg2d_rect *dst;
 };
 
+/**
+ * struct fimg2d_batch_region - region in a batch
+ * @src: src region
+ * @dst: dst region
+*/
+struct fimg2d_batch_region {
+	struct fimg2d_rect src;
+	struct fimg2d_rect dst;
+};
+
+/**
+ * struct fimg2d_user_batch - batch of regions for user
+ * @count: number of regions, up to FIMG2D_BATCH_MAX
+ * @regions: array of regions
+ * @flags: FIMG2D_BATCH_ASYNC to return before the bitblt is done
+ * @fence_fd: fence for FIMG2D_BATCH_ASYNC, readable once done (out)
+ *
+ * The regions are rendered with the configured context as if added one
+ * by one with FIMG2D_BITBLT_UPDATE, then closed.
+*/
+struct fimg2d_user_batch {
+	int count;
+	struct fimg2d_batch_region *regions;
+	int flags;
+	int fence_fd;
+};
+
 /**
  * struct fimg2d_user_context - context for user
  * @op: bitblt operation type
@@ -221,6 +253,18 @@ struct fimg2d_region {
 	struct list_head node;
 };
 
+/**
+ * struct fimg2d_fence - completion of an asynchronous batch
+ * @ref: reference counter (fence fd and context until done)
+ * @signaled: 1 if the bitblt is done
+ * @wq: wait queue head for poll
+*/
+struct fimg2d_fence {
+	atomic_t ref;
+	int signaled;
+	wait_queue_head_t wq;
+};
+
 /**
  * struct fimg2d_context - context info
  * @op: bitblt operation type
@@ -235,6 +279,7 @@ struct fimg2d_region {
  * @node: list head for context queue
  * @reg_q: region queue
  * @wq: wait queue head
+ * @fence: signaled when the closed regions are done
 */
 struct fimg2d_context {
 	FIMG2D_BITBLT_T op;
@@ -250,6 +295,7 @@ struct fimg2d_context {
 	struct list_head reg_q;
 	wait_queue_head_t wq;
 	unsigned long pgd;
+	struct fimg2d_fence *fence;
 };
 
 /**
@@ -319,6 +365,13 @@ extern int fimg2d_set_context(struct fimg2d_control *info,
 		struct fimg2d_context *ctx, struct fimg2d_user_context __user *c);
 extern int fimg2d_add_region(struct fimg2d_control *info,
 		struct fimg2d_context *ctx, struct fimg2d_user_region __user *r);
+extern int fimg2d_add_batch(struct fimg2d_control *info,
+		struct fimg2d_context *ctx, struct fimg2d_user_batch __user *b);
+extern struct fimg2d_fence *fimg2d_create_fence(void);
+extern void fimg2d_put_fence(struct fimg2d_fence *fence);
+extern void fimg2d_attach_fence(struct fimg2d_control *info,
+		struct fimg2d_context *ctx, struct fimg2d_fence *fence);
+extern void fimg2d_signal_fence(struct fimg2d_context *ctx);
 extern void fimg2d_do_bitblt(struct fimg2d_control *info);
 extern int fimg2d_close_bitblt(struct fimg2d_control *info, struct fimg2d_context *ctx);
 extern int fimg2d_register_ops(struct fimg2d_control *info);
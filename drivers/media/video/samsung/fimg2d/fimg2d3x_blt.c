@@ -282,6 +282,7 @@ noreg:
 			fimg2d_debug("try to wake up for %p\n", ctx);
 			info->active = NULL;
 			wake_up(&ctx->wq);
+			fimg2d_signal_fence(ctx);
 
 			ctx = fimg2d_find_context(info, (void *)1, fimg2d_match_closed);
 			spin_unlock(&info->lock);
@@ -208,6 +208,132 @@ int fimg2d_add_region(struct fimg2d_control *info, struct fimg2d_context *ctx,
 	return 0;
 }
 
+/**
+ * fimg2d_add_batch - [GENERIC] add a batch of regions to existing context
+ * @info: controller info
+ * @ctx: context info
+ * @b: user passed batch
+ *
+ * All regions are added in order, or none if one fails.
+*/
+int fimg2d_add_batch(struct fimg2d_control *info, struct fimg2d_context *ctx,
+			struct fimg2d_user_batch __user *b)
+{
+	struct fimg2d_batch_region __user *regions;
+	struct fimg2d_region *reg, *tmp;
+	LIST_HEAD(batch);
+	int count, i, ret;
+
+	fimg2d_debug("context: %p\n", ctx);
+
+	if (atomic_read(&ctx->closed)) {
+		printk(KERN_ERR "closed: not permitted to add batch\n");
+		return -EFAULT;
+	}
+
+	if (get_user(count, &b->count) || get_user(regions, &b->regions))
+		return -EFAULT;
+
+	if (count <= 0 || count > FIMG2D_BATCH_MAX) {
+		printk(KERN_ERR "invalid batch size: %d\n", count);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < count; i++) {
+		reg = kzalloc(sizeof(*reg), GFP_KERNEL);
+		if (!reg) {
+			printk(KERN_ERR "failed to create region header\n");
+			ret = -ENOMEM;
+			goto err;
+		}
+
+		INIT_LIST_HEAD(&reg->node);
+		list_add_tail(&reg->node, &batch);
+
+		if (copy_from_user(&reg->src, &regions[i].src,
+					sizeof(reg->src)) ||
+			copy_from_user(&reg->dst, &regions[i].dst,
+					sizeof(reg->dst))) {
+			printk(KERN_ERR "failed to set region info\n");
+			ret = -EFAULT;
+			goto err;
+		}
+	}
+
+	/* add to region queue */
+	list_splice_tail(&batch, &ctx->reg_q);
+
+	return 0;
+
+err:
+	list_for_each_entry_safe(reg, tmp, &batch, node)
+		kfree(reg);
+
+	return ret;
+}
+
+/**
+ * fimg2d_create_fence - [GENERIC] create an unsignaled fence
+*/
+struct fimg2d_fence *fimg2d_create_fence(void)
+{
+	struct fimg2d_fence *fence;
+
+	fence = kzalloc(sizeof(*fence), GFP_KERNEL);
+	if (!fence)
+		return NULL;
+
+	atomic_set(&fence->ref, 1);
+	init_waitqueue_head(&fence->wq);
+
+	return fence;
+}
+
+/**
+ * fimg2d_put_fence - [GENERIC] drop a reference to a fence
+ * @fence: fence info
+*/
+void fimg2d_put_fence(struct fimg2d_fence *fence)
+{
+	if (atomic_dec_and_test(&fence->ref))
+		kfree(fence);
+}
+
+/**
+ * fimg2d_attach_fence - [GENERIC] signal a fence when a context is done
+ * @info: controller info
+ * @ctx: context info, regions added but not closed yet
+ * @fence: fence info
+*/
+void fimg2d_attach_fence(struct fimg2d_control *info,
+			struct fimg2d_context *ctx, struct fimg2d_fence *fence)
+{
+	atomic_inc(&fence->ref);
+
+	spin_lock(&info->lock);
+	ctx->fence = fence;
+	spin_unlock(&info->lock);
+}
+
+/**
+ * fimg2d_signal_fence - [GENERIC] signal the fence of a done context
+ * @ctx: context info
+ *
+ * Called with info->lock held.
+*/
+void fimg2d_signal_fence(struct fimg2d_context *ctx)
+{
+	struct fimg2d_fence *fence = ctx->fence;
+
+	if (!fence)
+		return;
+
+	ctx->fence = NULL;
+	fence->signaled = 1;
+	wake_up(&fence->wq);
+	fimg2d_put_fence(fence);
+}
+
 /**
  * fimg2d_close_bitblt - [GENERIC] close context
  * @info: controller info
@@ -23,6 +23,8 @@
 #include <linux/slab.h>
 #include <linux/workqueue.h>
 #include <linux/dma-mapping.h>
+#include <linux/anon_inodes.h>
+#include <linux/file.h>
 #include <asm/atomic.h>
 #include <asm/cacheflush.h>
 #include <plat/cpu.h>
@@ -64,6 +66,29 @@ static irqreturn_t fimg2d_irq(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+/**
+ * fimg2d_wait_closed - [INTERNAL] waits for closed regions
+ * @info: controller info
+ * @ctx: context info
+ *
+ * This function waits until the regions closed for this context are done,
+ * also if rendering did not start yet.
+*/
+static void fimg2d_wait_closed(struct fimg2d_control *info,
+				struct fimg2d_context *ctx)
+{
+	int ret;
+
+	if (!atomic_read(&ctx->closed))
+		return;
+
+	fimg2d_debug("%p waiting for closed regions\n", ctx);
+
+	ret = wait_event_timeout(ctx->wq, !atomic_read(&ctx->closed), 10000);
+	if (ret == 0)
+		printk(KERN_ERR "wait timeout\n");
+}
+
 /**
  * fimg2d_open - [GENERIC] open
  * @inode: pointer to inode
@@ -123,6 +148,9 @@ static int fimg2d_release(struct inode *inode, struct file *file)
 
 	fimg2d_debug("context: %p\n", ctx);
 
+	/* regions closed but not rendered yet, e.g. an async batch */
+	fimg2d_wait_closed(info, ctx);
+
 	spin_lock(&info->lock);
 	active = info->active;
 	fimg2d_debug("active: %p\n", ctx);
@@ -208,6 +236,138 @@ static void fimg2d_wait(struct fimg2d_control *info, struct fimg2d_context *ctx)
 	}
 }
 
+/**
+ * fimg2d_dispatch - [INTERNAL] starts rendering if hardware is idle
+ * @info: controller info
+ * @ctx: closed context
+ *
+ * Otherwise the kernel thread finds the context when done with others.
+*/
+static void fimg2d_dispatch(struct fimg2d_control *info,
+				struct fimg2d_context *ctx)
+{
+	int idle;
+
+	spin_lock(&info->lock);
+	idle = !info->active;
+	if (idle)
+		info->active = ctx;
+	spin_unlock(&info->lock);
+
+	if (idle) {
+		fimg2d_debug("dispatch to kernel thread\n");
+		queue_work(info->workqueue, &fimg2d_work);
+	}
+}
+
+/**
+ * fimg2d_fence_poll - [GENERIC] poll on a fence fd
+ * @file: pointer to file
+ * @wait: poll_table_struct
+*/
+static unsigned int fimg2d_fence_poll(struct file *file,
+				struct poll_table_struct *wait)
+{
+	struct fimg2d_fence *fence = file->private_data;
+
+	poll_wait(file, &fence->wq, wait);
+
+	return fence->signaled ? (POLLIN | POLLRDNORM) : 0;
+}
+
+/**
+ * fimg2d_fence_release - [GENERIC] release a fence fd
+ * @inode: pointer to inode
+ * @file: pointer to file
+*/
+static int fimg2d_fence_release(struct inode *inode, struct file *file)
+{
+	fimg2d_put_fence(file->private_data);
+
+	return 0;
+}
+
+static const struct file_operations fimg2d_fence_fops = {
+	.poll		= fimg2d_fence_poll,
+	.release	= fimg2d_fence_release,
+};
+
+/**
+ * fimg2d_bitblt_batch - [INTERNAL] adds a batch of regions and closes
+ * @info: controller info
+ * @ctx: context info
+ * @b: user passed batch
+ *
+ * Without FIMG2D_BATCH_ASYNC this returns when the regions are done.
+ * With it, it returns right after queueing them and passes back a fence fd
+ * which polls readable once they are done.
+*/
+static int fimg2d_bitblt_batch(struct fimg2d_control *info,
+		struct fimg2d_context *ctx, struct fimg2d_user_batch __user *b)
+{
+	struct fimg2d_fence *fence = NULL;
+	struct file *file = NULL;
+	int flags, fd = -1;
+	int ret;
+
+	if (get_user(flags, &b->flags))
+		return -EFAULT;
+
+	/* previous async batch of this context */
+	fimg2d_wait_closed(info, ctx);
+
+	if (flags & FIMG2D_BATCH_ASYNC) {
+		fence = fimg2d_create_fence();
+		if (!fence)
+			return -ENOMEM;
+
+		fd = get_unused_fd_flags(O_CLOEXEC);
+		if (fd < 0) {
+			fimg2d_put_fence(fence);
+			return fd;
+		}
+
+		/* the file owns the first reference */
+		file = anon_inode_getfile("fimg2d-fence", &fimg2d_fence_fops,
+					fence, O_RDONLY);
+		if (IS_ERR(file)) {
+			put_unused_fd(fd);
+			fimg2d_put_fence(fence);
+			return PTR_ERR(file);
+		}
+
+		if (put_user(fd, &b->fence_fd)) {
+			ret = -EFAULT;
+			goto err;
+		}
+	}
+
+	ret = fimg2d_add_batch(info, ctx, b);
+	if (ret)
+		goto err;
+
+	if (fence) {
+		fimg2d_attach_fence(info, ctx, fence);
+		fd_install(fd, file);
+	}
+
+	fimg2d_close_bitblt(info, ctx);
+	fimg2d_dispatch(info, ctx);
+
+	if (!fence)
+		fimg2d_wait_closed(info, ctx);
+
+	return 0;
+
+err:
+	if (file) {
+		put_unused_fd(fd);
+		fput(file);
+	}
+
+	return ret;
+}
+
 #ifdef CONFIG_OUTER_CACHE
 /*
  * @sta_addr: virtual address for s5p-vmem, physical address for others
@@ -338,6 +498,7 @@ static int fimg2d_do_cache_op(unsigned int cmd, unsigned long arg)
  *   (usually changes coordinate values)
  *
  * FIMG2D_BITBLT_CLOSE: closes for existing context
+ * FIMG2D_BITBLT_BATCH: updates with many regions and closes
  * FIMG2D_BITBLT_WAIT: waits for done of previous rendering
  * FIMG2D_DMA_XXX: performs cache operation
 */
@@ -345,11 +506,11 @@ static int fimg2d_ioctl(struct inode *inode, struct file *file,
 			unsigned int cmd, unsigned long arg)
 {
 	int ret = 0;
-	struct fimg2d_context *active = NULL;
 	struct fimg2d_context *ctx = NULL;
 	union {
 		struct fimg2d_user_context *u_ctx;
 		struct fimg2d_user_region *u_reg;
+		struct fimg2d_user_batch *u_batch;
 	} p;
 
 	ctx = file->private_data;
@@ -362,12 +523,14 @@ static int fimg2d_ioctl(struct inode *inode, struct file *file,
 	case FIMG2D_BITBLT_CONFIG:
 		fimg2d_debug("FIMG2D_BITBLT_CONFIG: %p\n", ctx);
 		p.u_ctx = (struct fimg2d_user_context *)arg;
+		fimg2d_wait_closed(info, ctx);
 		ret = fimg2d_set_context(info, ctx, p.u_ctx);
 		break;
 
 	case FIMG2D_BITBLT_UPDATE:
 		fimg2d_debug("FIMG2D_BITBLT_UPDATE: %p\n", ctx);
 		p.u_reg = (struct fimg2d_user_region *)arg;
+		fimg2d_wait_closed(info, ctx);
 		ret = fimg2d_add_region(info, ctx, p.u_reg);
 		break;
 
@@ -375,24 +538,21 @@ static int fimg2d_ioctl(struct inode *inode, struct file *file,
 		fimg2d_debug("FIMG2D_BITBLT_CLOSE: %p\n", ctx);
 		ret = fimg2d_close_bitblt(info, ctx);
 
-		spin_lock(&info->lock);
-		active = info->active;
-		spin_unlock(&info->lock);
-
 		/* start kernel thread if hardware is idle */
-		if (!active) {
-			spin_lock(&info->lock);
-			info->active = ctx;
-			spin_unlock(&info->lock);
-			fimg2d_debug("dispatch to kernel thread\n");
-			queue_work(info->workqueue, &fimg2d_work);
-		}
+		fimg2d_dispatch(info, ctx);
+
 		/* some existing application releases memory right after 
 		 * calling this ioctl without a call of bitblt wait.
 		 * so, it happens that memory is freed while it is being accessed. */
 		fimg2d_wait(info, ctx);
 		break;
 
+	case FIMG2D_BITBLT_BATCH:
+		fimg2d_debug("FIMG2D_BITBLT_BATCH: %p\n", ctx);
+		p.u_batch = (struct fimg2d_user_batch *)arg;
+		ret = fimg2d_bitblt_batch(info, ctx, p.u_batch);
+		break;
+
 	case FIMG2D_BITBLT_WAIT:
 		fimg2d_debug("FIMG2D_BITBLT_WAIT: %p\n", ctx);
 		fimg2d_wait(info, ctx);
@@ -17,31 +17,19 @@
 
 #include "mali_osk.h"
 
-/**
- * The actual descriptor mapping table, never directly accessed by clients
- */
-typedef struct mali_descriptor_table
-{
-	u32 * usage; /**< Pointer to bitpattern indicating if a descriptor is valid/used or not */
-	void** mappings; /**< Array of the pointers the descriptors map to */
-} mali_descriptor_table;
-
 /**
  * The descriptor mapping object
  * Provides a separate namespace where we can map an integer to a pointer
  */
 typedef struct mali_descriptor_mapping
 {
-    _mali_osk_lock_t *lock; /**< Lock protecting access to the mapping object */
-	int max_nr_mappings_allowed; /**< Max number of mappings to support in this namespace */
-	int current_nr_mappings; /**< Current number of possible mappings */
-	mali_descriptor_table * table; /**< Pointer to the current mapping table */
+	_mali_osk_idmap_t *idmap; /**< The IDs in use, looked up without a lock */
 } mali_descriptor_mapping;
 
 /**
  * Create a descriptor mapping object
- * Create a descriptor mapping capable of holding init_entries growable to max_entries
- * @param init_entries Number of entries to preallocate memory for
+ * Create a descriptor mapping capable of holding max_entries
+ * @param init_entries Unused, the mapping grows as needed
  * @param max_entries Number of entries to max support
  * @return Pointer to a descriptor mapping object, NULL on failure
  */
@@ -64,6 +52,7 @@ _mali_osk_errcode_t mali_descriptor_mapping_allocate_mapping(mali_descriptor_map
 
 /**
  * Get the value mapped to by a descriptor ID
+ * Does not block, and may run concurrently with changes to the map.
  * @param map The map to lookup the descriptor id in
  * @param descriptor The descriptor ID to lookup
  * @param target Pointer to a pointer which will receive the stored value
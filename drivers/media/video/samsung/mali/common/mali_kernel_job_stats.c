@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2011 Samsung Electronics
+ *
+ * This program is free software and is provided to you under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation, and any use by you of this program is subject to the terms of such GNU licence.
+ *
+ * A copy of the licence is included with the program, and can also be obtained from Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "mali_kernel_common.h"
+#include "mali_kernel_rendercore.h"
+#include "mali_kernel_job_stats.h"
+#include "mali_osk.h"
+
+/*
+ * Everything is counted at job end, under one IRQ spinlock, from the
+ * timestamps taken at submit and start. That is a few hundred times a
+ * second at most, so plain arrays are searched. Durations come from the
+ * monotonic clock, only the submit time shown with the recent jobs is
+ * wall clock.
+ */
+static _mali_osk_lock_t *stats_lock;
+
+static mali_job_stats stats;
+
+
+static u32 duration_bucket(u64 ns)
+{
+	u64 units = ns >> MALI_JOB_STATS_BUCKET_SHIFT;
+	u32 bucket;
+
+	if (0 != (units >> 32))
+	{
+		return MALI_JOB_STATS_BUCKETS - 1;
+	}
+	if (0 == (u32)units)
+	{
+		return 0;
+	}
+
+	bucket = 32 - _mali_osk_clz((u32)units);
+	if (bucket >= MALI_JOB_STATS_BUCKETS)
+	{
+		bucket = MALI_JOB_STATS_BUCKETS - 1;
+	}
+	return bucket;
+}
+
+/* Must hold stats_lock */
+static mali_job_stats_process *get_process(u32 pid)
+{
+	mali_job_stats_process *process;
+	mali_job_stats_process *oldest = NULL;
+	int i;
+
+	for (i = 0; i < MALI_JOB_STATS_PROCESSES; i++)
+	{
+		process = &stats.processes[i];
+		if (process->pid == pid)
+		{
+			return process;
+		}
+		/* Free slots have last_ns 0, so they are taken first */
+		if (NULL == oldest || process->last_ns < oldest->last_ns)
+		{
+			oldest = process;
+		}
+	}
+
+	_mali_osk_memset(oldest, 0, sizeof(*oldest));
+	oldest->pid = pid;
+	return oldest;
+}
+
+
+
+_mali_osk_errcode_t mali_job_stats_init(void)
+{
+	stats_lock = _mali_osk_lock_init( _MALI_OSK_LOCKFLAG_SPINLOCK_IRQ|_MALI_OSK_LOCKFLAG_NONINTERRUPTABLE, 0, 0 );
+	if (NULL == stats_lock)
+	{
+		return _MALI_OSK_ERR_FAULT;
+	}
+
+	_mali_osk_memset(&stats, 0, sizeof(stats));
+	stats.since_ns = _mali_osk_time_get_monotonic_ns();
+
+	return _MALI_OSK_ERR_OK;
+}
+
+
+
+void mali_job_stats_term(void)
+{
+	_mali_osk_lock_term(stats_lock);
+	stats_lock = NULL;
+}
+
+
+
+void mali_job_stats_job_submit(struct mali_core_job *job)
+{
+	job->pid = _mali_osk_get_pid();
+	job->submit_time_ns = _mali_osk_time_get_ns();
+	job->submit_ns = _mali_osk_time_get_monotonic_ns();
+	job->start_ns = 0;
+}
+
+
+
+void mali_job_stats_job_start(struct mali_core_job *job)
+{
+	job->start_ns = _mali_osk_time_get_monotonic_ns();
+}
+
+
+
+void mali_job_stats_job_end(struct mali_core_job *job, _mali_core_type core_type, mali_bool success)
+{
+	u64 end_ns = _mali_osk_time_get_monotonic_ns();
+	u64 wait_ns = job->start_ns - job->submit_ns;
+	u64 run_ns = end_ns - job->start_ns;
+	mali_job_stats_core_type type;
+	mali_job_stats_core *core;
+	mali_job_stats_process *process;
+	mali_job_stats_job *recent;
+
+	if (_MALI_GP2 == core_type || _MALI_400_GP == core_type)
+	{
+		type = MALI_JOB_STATS_GP;
+	}
+	else
+	{
+		type = MALI_JOB_STATS_PP;
+	}
+
+	_mali_osk_lock_wait(stats_lock, _MALI_OSK_LOCKMODE_RW);
+
+	core = &stats.cores[type];
+	core->jobs++;
+	if (MALI_TRUE != success)
+	{
+		core->failed++;
+	}
+	core->wait_ns += wait_ns;
+	core->run_ns += run_ns;
+	if (run_ns > core->run_max_ns)
+	{
+		core->run_max_ns = run_ns;
+	}
+	core->wait_histogram[duration_bucket(wait_ns)]++;
+	core->run_histogram[duration_bucket(run_ns)]++;
+
+	process = get_process(job->pid);
+	process->jobs[type]++;
+	process->run_ns[type] += run_ns;
+	process->last_ns = end_ns;
+
+	recent = &stats.recent[stats.recent_next];
+	recent->pid = job->pid;
+	recent->core_type = type;
+	recent->success = (MALI_TRUE == success);
+	recent->submit_time_ns = job->submit_time_ns;
+	recent->wait_ns = wait_ns;
+	recent->run_ns = run_ns;
+	stats.recent_next = (stats.recent_next + 1) % MALI_JOB_STATS_RECENT;
+
+	_mali_osk_lock_signal(stats_lock, _MALI_OSK_LOCKMODE_RW);
+}
+
+
+
+void mali_job_stats_utilization(u32 utilization)
+{
+	u32 bucket = utilization / (256 / MALI_JOB_STATS_UTILIZATION_BUCKETS);
+
+	if (bucket >= MALI_JOB_STATS_UTILIZATION_BUCKETS)
+	{
+		bucket = MALI_JOB_STATS_UTILIZATION_BUCKETS - 1;
+	}
+
+	_mali_osk_lock_wait(stats_lock, _MALI_OSK_LOCKMODE_RW);
+	stats.utilization_histogram[bucket]++;
+	_mali_osk_lock_signal(stats_lock, _MALI_OSK_LOCKMODE_RW);
+}
+
+
+
+void mali_job_stats_get(mali_job_stats *copy)
+{
+	_mali_osk_lock_wait(stats_lock, _MALI_OSK_LOCKMODE_RW);
+	_mali_osk_memcpy(copy, &stats, sizeof(stats));
+	copy->now_ns = _mali_osk_time_get_monotonic_ns();
+	_mali_osk_lock_signal(stats_lock, _MALI_OSK_LOCKMODE_RW);
+}
+
+
+
+void mali_job_stats_reset(void)
+{
+	_mali_osk_lock_wait(stats_lock, _MALI_OSK_LOCKMODE_RW);
+	_mali_osk_memset(&stats, 0, sizeof(stats));
+	stats.since_ns = _mali_osk_time_get_monotonic_ns();
+	_mali_osk_lock_signal(stats_lock, _MALI_OSK_LOCKMODE_RW);
+}
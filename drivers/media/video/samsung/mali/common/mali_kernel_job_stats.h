@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2011 Samsung Electronics
+ *
+ * This program is free software and is provided to you under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation, and any use by you of this program is subject to the terms of such GNU licence.
+ *
+ * A copy of the licence is included with the program, and can also be obtained from Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __MALI_KERNEL_JOB_STATS_H__
+#define __MALI_KERNEL_JOB_STATS_H__
+
+#include "mali_osk.h"
+#include "mali_uk_types.h"
+
+/* Job durations are counted in power of two buckets, the first one ends at 2^16 ns (65 us) */
+#define MALI_JOB_STATS_BUCKETS 16
+#define MALI_JOB_STATS_BUCKET_SHIFT 16
+
+/* Processes that ran jobs, the one idle the longest is dropped when full */
+#define MALI_JOB_STATS_PROCESSES 32
+
+/* Last jobs done, with their timestamps */
+#define MALI_JOB_STATS_RECENT 64
+
+/* Utilization reported to DVFS, in buckets of 16 out of 256 */
+#define MALI_JOB_STATS_UTILIZATION_BUCKETS 16
+
+typedef enum mali_job_stats_core_type
+{
+	MALI_JOB_STATS_GP,
+	MALI_JOB_STATS_PP,
+	MALI_JOB_STATS_CORE_TYPES
+} mali_job_stats_core_type;
+
+typedef struct mali_job_stats_core
+{
+	u32 jobs;
+	u32 failed;                 /**< Jobs that did not end with JOB_STATUS_END_SUCCESS */
+	u64 wait_ns;                /**< Sum of submit to start */
+	u64 run_ns;                 /**< Sum of start to end */
+	u64 run_max_ns;
+	u32 wait_histogram[MALI_JOB_STATS_BUCKETS];
+	u32 run_histogram[MALI_JOB_STATS_BUCKETS];
+} mali_job_stats_core;
+
+typedef struct mali_job_stats_process
+{
+	u32 pid;                    /**< 0 if the slot is free */
+	u32 jobs[MALI_JOB_STATS_CORE_TYPES];
+	u64 run_ns[MALI_JOB_STATS_CORE_TYPES];
+	u64 last_ns;                /**< End of its last job, on the clock of now_ns */
+} mali_job_stats_process;
+
+typedef struct mali_job_stats_job
+{
+	u32 pid;
+	u16 core_type;
+	u16 success;
+	u64 submit_time_ns;         /**< Wall clock */
+	u64 wait_ns;
+	u64 run_ns;
+} mali_job_stats_job;
+
+typedef struct mali_job_stats
+{
+	u64 since_ns;               /**< Start of counting, at init or the last reset */
+	u64 now_ns;                 /**< When this copy was taken, on the same clock */
+	mali_job_stats_core cores[MALI_JOB_STATS_CORE_TYPES];
+	mali_job_stats_process processes[MALI_JOB_STATS_PROCESSES];
+	u32 utilization_histogram[MALI_JOB_STATS_UTILIZATION_BUCKETS];
+	mali_job_stats_job recent[MALI_JOB_STATS_RECENT];
+	u32 recent_next;            /**< Where the next job goes, the oldest one once recent[] is full */
+} mali_job_stats;
+
+struct mali_core_job;
+
+/**
+ * Initialize the job statistics.
+ *
+ * @return _MALI_OSK_ERR_OK on success, otherwise failure.
+ */
+_mali_osk_errcode_t mali_job_stats_init(void);
+
+/**
+ * Terminate the job statistics.
+ */
+void mali_job_stats_term(void);
+
+/**
+ * Should be called when a job is handed to the scheduler, from the submitting process
+ */
+void mali_job_stats_job_submit(struct mali_core_job *job);
+
+/**
+ * Should be called when a job is put on a core
+ */
+void mali_job_stats_job_start(struct mali_core_job *job);
+
+/**
+ * Should be called when a job is taken off its core, done or not
+ *
+ * @param job The job, as started by mali_job_stats_job_start()
+ * @param core_type The type of core it ran on
+ * @param success MALI_TRUE if it ended with JOB_STATUS_END_SUCCESS
+ */
+void mali_job_stats_job_end(struct mali_core_job *job, _mali_core_type core_type, mali_bool success);
+
+/**
+ * Should be called with each utilization reported to DVFS, 0 to 256
+ */
+void mali_job_stats_utilization(u32 utilization);
+
+/**
+ * Copy the statistics gathered since init or the last reset.
+ *
+ * @param copy Where to copy them
+ */
+void mali_job_stats_get(mali_job_stats *copy);
+
+/**
+ * Start counting again from zero.
+ */
+void mali_job_stats_reset(void);
+
+#endif /* __MALI_KERNEL_JOB_STATS_H__ */
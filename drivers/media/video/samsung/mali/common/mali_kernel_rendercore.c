@@ -18,6 +18,9 @@
 #if MALI_GPU_UTILIZATION
 #include "mali_kernel_utilization.h"
 #endif
+#if MALI_JOB_STATS
+#include "mali_kernel_job_stats.h"
+#endif
 #if MALI_TIMELINE_PROFILING_ENABLED
 #include "mali_kernel_profiling.h"
 #endif
@@ -157,6 +160,19 @@ static _mali_osk_errcode_t rendercore_subsystem_startup(mali_kernel_subsystem_id
 	}
 #endif
 
+#if MALI_JOB_STATS
+	if (mali_job_stats_init() != _MALI_OSK_ERR_OK)
+	{
+#if MALI_GPU_UTILIZATION
+		mali_utilization_term();
+#endif
+		_mali_osk_lock_term(rendercores_global_mutex);
+		rendercores_global_mutex = NULL;
+		MALI_PRINT_ERROR(("Failed: mali_job_stats_init\n")) ;
+        MALI_ERROR(_MALI_OSK_ERR_FAULT);
+	}
+#endif
+
 #if MALI_TIMELINE_PROFILING_ENABLED
 	if (_mali_profiling_init() != _MALI_OSK_ERR_OK)
 	{
@@ -195,6 +211,12 @@ static void rendercore_subsystem_terminate(mali_kernel_subsystem_identifier id)
 	mali_utilization_term();
 #endif
 
+	/* After the utilization timer, which reports to it, is gone. The
+	 * subsystems based on the rendercore have detached their last jobs. */
+#if MALI_JOB_STATS
+	mali_job_stats_term();
+#endif
+
 	rendercore_dummy_subsystem.name = NULL; /* The original string was on the constant pool, do not free */
 	rendercore_dummy_subsystem.magic_nr = 0;
 
@@ -1127,6 +1149,9 @@ static void mali_core_subsystem_move_set_working(mali_core_renderunit *core, mal
 	core->current_job = job ;
 	core->state = CORE_WORKING ;
 	job->start_time_jiffies = _mali_osk_time_tickcount();
+#if MALI_JOB_STATS
+	mali_job_stats_job_start(job);
+#endif
 	_mali_osk_list_move( &core->list, &session->renderunits_working_head );
 
 }
@@ -1509,6 +1534,10 @@ _mali_osk_errcode_t mali_core_session_add_job(mali_core_session * session, mali_
 	/* Continue to add the new job as the next job from this session */
 	MALI_DEBUG_PRINT(6, ("Core: session_add_job job=0x%x\n", job));
 
+#if MALI_JOB_STATS
+	mali_job_stats_job_submit(job);
+#endif
+
 	/* Adding this session to the subsystem list of sessions with pending job, with priority */
 	session->job_waiting_to_run = job;
 
@@ -1556,6 +1585,9 @@ static void mali_core_renderunit_detach_job_from_core(mali_core_renderunit* core
 		if ( NULL != job )
 		{
 			mali_core_job_set_run_time(job);
+#if MALI_JOB_STATS
+			mali_job_stats_job_end(job, subsystem->core_type, (JOB_STATUS_END_SUCCESS == end_status) ? MALI_TRUE : MALI_FALSE);
+#endif
 			core->current_job = NULL;
 		}
 	}
@@ -212,6 +212,12 @@ typedef struct mali_core_job
 	unsigned long watchdog_jiffies;
 	u32 abort_id;
 	u32 job_nr;
+#if MALI_JOB_STATS
+	u32 pid;        /* Process that submitted the job */
+	u64 submit_time_ns; /* Wall clock, to line the job up with other logs */
+	u64 submit_ns;  /* Monotonic, for the durations */
+	u64 start_ns;
+#endif
 } mali_core_job;
 
 /*
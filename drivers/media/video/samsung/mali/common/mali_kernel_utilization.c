@@ -12,6 +12,7 @@
 #include "mali_kernel_utilization.h"
 #include "mali_osk.h"
 #include "mali_platform.h"
+#include "mali_kernel_job_stats.h"
 
 /* Define how often to calculate and report GPU utilization, in milliseconds */
 #define MALI_GPU_UTILIZATION_TIMEOUT 1000 // 2000
@@ -48,6 +49,9 @@ static void calculate_gpu_utilization(void* arg)
 		_mali_osk_lock_signal(time_data_lock, _MALI_OSK_LOCKMODE_RW);
 
 		/* No work done for this period, report zero usage */
+#if MALI_JOB_STATS
+		mali_job_stats_utilization(0);
+#endif
 		mali_gpu_utilization_handler(0);
 
 		return;
@@ -104,6 +108,9 @@ static void calculate_gpu_utilization(void* arg)
 
 	_mali_osk_timer_add(utilization_timer, _mali_osk_time_mstoticks(MALI_GPU_UTILIZATION_TIMEOUT));
 
+#if MALI_JOB_STATS
+	mali_job_stats_utilization(utilization);
+#endif
 	mali_gpu_utilization_handler(utilization);
 }
 
@@ -1527,6 +1527,15 @@ void _mali_osk_time_ubusydelay( u32 usecs );
  */
 u64 _mali_osk_time_get_ns( void );
 
+/** @brief Return time in nano seconds of a clock that is never set, since any given reference.
+ *
+ * Unlike _mali_osk_time_get_ns(), the difference of two readings is always
+ * the time that passed in between.
+ *
+ * @return Time in nano seconds
+ */
+u64 _mali_osk_time_get_monotonic_ns( void );
+
 
 /** @} */ /* end group _mali_osk_time */
 
@@ -1545,6 +1554,110 @@ u64 _mali_osk_time_get_ns( void );
 u32 _mali_osk_clz( u32 val );
 /** @} */ /* end group _mali_osk_math */
 
+/** @defgroup _mali_osk_idmap OSK ID maps
+ * @{ */
+
+/** @brief Private type for ID map objects */
+typedef struct _mali_osk_idmap_t_struct _mali_osk_idmap_t;
+
+/** @brief Create an ID map
+ *
+ * An ID map hands out small positive integers for pointers and looks them
+ * up again. Lookups do not take a lock, so they may run concurrently with
+ * allocations and removals; what a looked up pointer refers to must be kept
+ * alive by the caller.
+ *
+ * @param max_id IDs handed out are below this value
+ * @return On success, a pointer to a _mali_osk_idmap_t object. NULL on failure.
+ */
+_mali_osk_idmap_t *_mali_osk_idmap_init( int max_id );
+
+/** @brief Destroy an ID map, the pointers it maps to are not touched
+ *
+ * Waits for the objects handed to _mali_osk_idmap_target_free() to be freed.
+ *
+ * @param map the ID map to destroy
+ */
+void _mali_osk_idmap_term( _mali_osk_idmap_t *map );
+
+/** @brief Map the lowest free ID to a pointer
+ *
+ * ID 0 is never handed out.
+ *
+ * @param map the ID map
+ * @param target the pointer to map to, must not be NULL
+ * @param[out] id receives the ID
+ * @return _MALI_OSK_ERR_OK on success, otherwise a suitable _mali_osk_errcode_t on failure.
+ */
+_mali_osk_errcode_t _mali_osk_idmap_alloc( _mali_osk_idmap_t *map, void *target, int *id );
+
+/** @brief Look up the pointer an ID maps to
+ *
+ * @param map the ID map
+ * @param id the ID to look up
+ * @return the pointer, NULL if the ID is not mapped
+ */
+void *_mali_osk_idmap_lookup( _mali_osk_idmap_t *map, int id );
+
+/** @brief Look up the pointer an ID maps to and take a reference on it
+ *
+ * get runs inside the lookup, where what the ID maps to cannot be freed if
+ * it was allocated with _mali_osk_idmap_target_calloc(). It must not sleep,
+ * and fails if the object is already on its way out.
+ *
+ * @param map the ID map
+ * @param id the ID to look up
+ * @param get takes a reference on the pointer, MALI_FALSE if it could not
+ * @return the pointer, NULL if the ID is not mapped or get failed
+ */
+void *_mali_osk_idmap_lookup_get( _mali_osk_idmap_t *map, int id, mali_bool (*get)(void *) );
+
+/** @brief Allocate zeroed memory for an object looked up with _mali_osk_idmap_lookup_get()
+ *
+ * @param size bytes to allocate
+ * @return the memory, NULL on failure
+ */
+void *_mali_osk_idmap_target_calloc( u32 size );
+
+/** @brief Free an object from _mali_osk_idmap_target_calloc()
+ *
+ * The memory is freed once no lookup of map that may still see the object
+ * is running, so this is safe right after its ID was removed from map, or
+ * while it still is mapped if get fails on it.
+ *
+ * @param map the ID map the object was mapped in
+ * @param target the object
+ */
+void _mali_osk_idmap_target_free( _mali_osk_idmap_t *map, void *target );
+
+/** @brief Map an ID that is in use to another pointer
+ *
+ * @param map the ID map
+ * @param id the ID
+ * @param target the pointer to map to, must not be NULL
+ * @return _MALI_OSK_ERR_OK on success, _MALI_OSK_ERR_FAULT if the ID is not mapped.
+ */
+_mali_osk_errcode_t _mali_osk_idmap_replace( _mali_osk_idmap_t *map, int id, void *target );
+
+/** @brief Free an ID for reuse
+ *
+ * @param map the ID map
+ * @param id the ID to free
+ * @return the pointer the ID mapped to, NULL if it was not mapped
+ */
+void *_mali_osk_idmap_remove( _mali_osk_idmap_t *map, int id );
+
+/** @brief Call a function for every mapped ID
+ *
+ * Allocations and removals wait until this returns, so  callback must not
+ * change the map.
+ *
+ * @param map the ID map
+ * @param callback called with every ID and the pointer it maps to
+ */
+void _mali_osk_idmap_for_each( _mali_osk_idmap_t *map, void (*callback)(int, void *) );
+/** @} */ /* end group _mali_osk_idmap */
+
 
 /** @addtogroup _mali_osk_miscellaneous
  * @{ */
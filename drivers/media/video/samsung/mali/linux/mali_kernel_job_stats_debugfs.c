@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2011 Samsung Electronics
+ *
+ * This program is free software and is provided to you under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation, and any use by you of this program is subject to the terms of such GNU licence.
+ *
+ * A copy of the licence is included with the program, and can also be obtained from Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file mali_kernel_job_stats_debugfs.c
+ * Shows the job statistics in debugfs, in mali/:
+ *
+ * - job_stats: jobs, queue wait and run time of the GP and PP cores with
+ *   histograms of both, GPU time per process and a histogram of the
+ *   utilization reported to DVFS. Writing anything to it starts over.
+ * - jobs: the last jobs done, with wall clock submit time to line them up
+ *   with logcat.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sched.h>
+#include <linux/pid_namespace.h>
+#include <linux/sort.h>
+#include <asm/div64.h>
+
+#include "mali_kernel_common.h"
+#include "mali_kernel_job_stats.h"
+#include "mali_kernel_linux.h"
+
+static struct dentry *mali_debugfs_dir;
+
+static const char * const core_names[MALI_JOB_STATS_CORE_TYPES] = { "GP", "PP" };
+
+static u32 ns_to_us(u64 ns)
+{
+	do_div(ns, 1000);
+	return (u32)ns;
+}
+
+static u32 ns_to_ms(u64 ns)
+{
+	do_div(ns, 1000000);
+	return (u32)ns;
+}
+
+static void pid_to_comm(u32 pid, char *comm)
+{
+	struct task_struct *task;
+
+	strcpy(comm, "-");
+
+	rcu_read_lock();
+	task = pid_task(find_pid_ns(pid, &init_pid_ns), PIDTYPE_PID);
+	if (task)
+		get_task_comm(comm, task);
+	rcu_read_unlock();
+}
+
+static u64 process_run_ns(const mali_job_stats_process *process)
+{
+	return process->run_ns[MALI_JOB_STATS_GP] + process->run_ns[MALI_JOB_STATS_PP];
+}
+
+/* Busiest first */
+static int process_cmp(const void *a, const void *b)
+{
+	u64 run_a = process_run_ns(a);
+	u64 run_b = process_run_ns(b);
+
+	if (run_a == run_b)
+		return 0;
+	return run_a > run_b ? -1 : 1;
+}
+
+static int job_stats_show(struct seq_file *s, void *unused)
+{
+	mali_job_stats *stats;
+	mali_job_stats_process *process;
+	char comm[TASK_COMM_LEN];
+	int i, b;
+
+	stats = kmalloc(sizeof(*stats), GFP_KERNEL);
+	if (NULL == stats)
+		return -ENOMEM;
+
+	mali_job_stats_get(stats);
+
+	seq_printf(s, "since reset: %u ms\n\n", ns_to_ms(stats->now_ns - stats->since_ns));
+
+	seq_printf(s, "core     jobs  failed    wait ms     run ms  longest us\n");
+	for (i = 0; i < MALI_JOB_STATS_CORE_TYPES; i++)
+	{
+		mali_job_stats_core *core = &stats->cores[i];
+
+		seq_printf(s, "%-4s %8u %7u %10u %10u %11u\n", core_names[i],
+			   core->jobs, core->failed, ns_to_ms(core->wait_ns),
+			   ns_to_ms(core->run_ns), ns_to_us(core->run_max_ns));
+	}
+
+	seq_printf(s, "\nduration       GP wait   GP run  PP wait   PP run\n");
+	for (b = 0; b < MALI_JOB_STATS_BUCKETS; b++)
+	{
+		if (b < MALI_JOB_STATS_BUCKETS - 1)
+			seq_printf(s, "<  %8u us", (1u << (MALI_JOB_STATS_BUCKET_SHIFT + b)) / 1000);
+		else
+			seq_printf(s, ">= %8u us", (1u << (MALI_JOB_STATS_BUCKET_SHIFT + b - 1)) / 1000);
+		seq_printf(s, " %8u %8u %8u %8u\n",
+			   stats->cores[MALI_JOB_STATS_GP].wait_histogram[b],
+			   stats->cores[MALI_JOB_STATS_GP].run_histogram[b],
+			   stats->cores[MALI_JOB_STATS_PP].wait_histogram[b],
+			   stats->cores[MALI_JOB_STATS_PP].run_histogram[b]);
+	}
+
+	sort(stats->processes, MALI_JOB_STATS_PROCESSES, sizeof(stats->processes[0]), process_cmp, NULL);
+
+	seq_printf(s, "\n  pid comm              GP jobs    GP ms  PP jobs    PP ms  idle ms\n");
+	for (i = 0; i < MALI_JOB_STATS_PROCESSES; i++)
+	{
+		process = &stats->processes[i];
+		if (0 == process->pid)
+			continue;
+
+		pid_to_comm(process->pid, comm);
+		seq_printf(s, "%5u %-16s %8u %8u %8u %8u %8u\n", process->pid, comm,
+			   process->jobs[MALI_JOB_STATS_GP], ns_to_ms(process->run_ns[MALI_JOB_STATS_GP]),
+			   process->jobs[MALI_JOB_STATS_PP], ns_to_ms(process->run_ns[MALI_JOB_STATS_PP]),
+			   ns_to_ms(stats->now_ns - process->last_ns));
+	}
+
+	/* Same units as the gpu_control thresholds */
+	seq_printf(s, "\nutilization  periods\n");
+	for (b = 0; b < MALI_JOB_STATS_UTILIZATION_BUCKETS; b++)
+	{
+		seq_printf(s, "%3u-%3u%%   %8u\n",
+			   b * 100 / MALI_JOB_STATS_UTILIZATION_BUCKETS,
+			   (b + 1) * 100 / MALI_JOB_STATS_UTILIZATION_BUCKETS,
+			   stats->utilization_histogram[b]);
+	}
+
+	kfree(stats);
+	return 0;
+}
+
+static int job_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, job_stats_show, NULL);
+}
+
+static ssize_t job_stats_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos)
+{
+	mali_job_stats_reset();
+	return count;
+}
+
+static const struct file_operations job_stats_fops = {
+	.open		= job_stats_open,
+	.read		= seq_read,
+	.write		= job_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int jobs_show(struct seq_file *s, void *unused)
+{
+	mali_job_stats *stats;
+	mali_job_stats_job *job;
+	char comm[TASK_COMM_LEN];
+	u64 submit_s;
+	u32 submit_us;
+	int i;
+
+	stats = kmalloc(sizeof(*stats), GFP_KERNEL);
+	if (NULL == stats)
+		return -ENOMEM;
+
+	mali_job_stats_get(stats);
+
+	seq_printf(s, "        submitted core   wait us    run us    pid comm\n");
+	for (i = 0; i < MALI_JOB_STATS_RECENT; i++)
+	{
+		/* Oldest first */
+		job = &stats->recent[(stats->recent_next + i) % MALI_JOB_STATS_RECENT];
+		if (0 == job->pid)
+			continue;
+
+		submit_s = job->submit_time_ns;
+		submit_us = do_div(submit_s, 1000000000) / 1000;
+		pid_to_comm(job->pid, comm);
+		seq_printf(s, "%10u.%06u %-4s %9u %9u %6u %s%s\n",
+			   (u32)submit_s, submit_us, core_names[job->core_type],
+			   ns_to_us(job->wait_ns), ns_to_us(job->run_ns),
+			   job->pid, comm, job->success ? "" : " (failed)");
+	}
+
+	kfree(stats);
+	return 0;
+}
+
+static int jobs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, jobs_show, NULL);
+}
+
+static const struct file_operations jobs_fops = {
+	.open		= jobs_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+void mali_job_stats_debugfs_init(void)
+{
+	mali_debugfs_dir = debugfs_create_dir("mali", NULL);
+	if (IS_ERR_OR_NULL(mali_debugfs_dir))
+	{
+		mali_debugfs_dir = NULL;
+		return;
+	}
+
+	debugfs_create_file("job_stats", S_IRUGO | S_IWUSR, mali_debugfs_dir, NULL, &job_stats_fops);
+	debugfs_create_file("jobs", S_IRUGO, mali_debugfs_dir, NULL, &jobs_fops);
+}
+
+void mali_job_stats_debugfs_term(void)
+{
+	debugfs_remove_recursive(mali_debugfs_dir);
+	mali_debugfs_dir = NULL;
+}
@@ -159,6 +159,10 @@ int mali_driver_init(void)
         return -EFAULT;
     }
 
+#if MALI_JOB_STATS
+	mali_job_stats_debugfs_init();
+#endif
+
     return 0;
 }
 
@@ -174,6 +178,10 @@ void mali_driver_exit(void)
 #endif
 #endif
 #endif
+#endif
+
+#if MALI_JOB_STATS
+	mali_job_stats_debugfs_term();
 #endif
 	 mali_kernel_destructor();
 
@@ -19,6 +19,11 @@ extern "C"
 _mali_osk_errcode_t initialize_kernel_device(void);
 void terminate_kernel_device(void);
 
+#if MALI_JOB_STATS
+void mali_job_stats_debugfs_init(void);
+void mali_job_stats_debugfs_term(void);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2010 ARM Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation, and any use by you of this program is subject to the terms of such GNU licence.
+ *
+ * A copy of the licence is included with the program, and can also be obtained from Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file mali_osk_idmap.c
+ * Implementation of the OS abstraction layer for the kernel device driver
+ *
+ * ID maps sit on an IDR: lookups walk it under rcu_read_lock() only, the
+ * mutex orders the writers. Every map has its own IDR and so its own cache
+ * of preallocated layers, filled by idr_pre_get() outside of any lookup.
+ * Targets that are referenced from inside a lookup carry an rcu_head in
+ * front of them and are freed after a grace period.
+ */
+
+#include <linux/err.h>
+#include <linux/idr.h>
+#include <linux/mutex.h>
+#include <linux/rcupdate.h>
+#include <linux/slab.h>
+
+#include "mali_osk.h"
+
+struct _mali_osk_idmap_t_struct
+{
+	struct idr idr;
+	struct mutex lock;
+	int max_id;
+	/* a target free may still be pending, see _mali_osk_idmap_term() */
+	int deferred;
+};
+
+struct idmap_target_head
+{
+	struct rcu_head rcu;
+} __aligned(sizeof(u64));
+
+_mali_osk_idmap_t *_mali_osk_idmap_init( int max_id )
+{
+	_mali_osk_idmap_t *map;
+
+	map = kmalloc(sizeof(*map), GFP_KERNEL);
+	if (NULL == map) return NULL;
+
+	idr_init(&map->idr);
+	mutex_init(&map->lock);
+	map->max_id = max_id;
+	map->deferred = 0;
+
+	return map;
+}
+
+void _mali_osk_idmap_term( _mali_osk_idmap_t *map )
+{
+	/* the callbacks of _mali_osk_idmap_target_free() live in this module */
+	if (map->deferred) rcu_barrier();
+	idr_remove_all(&map->idr);
+	idr_destroy(&map->idr);
+	kfree(map);
+}
+
+_mali_osk_errcode_t _mali_osk_idmap_alloc( _mali_osk_idmap_t *map, void *target, int *id )
+{
+	int ret;
+
+	BUG_ON(NULL == target);
+
+	mutex_lock(&map->lock);
+	do
+	{
+		if (!idr_pre_get(&map->idr, GFP_KERNEL))
+		{
+			ret = -ENOMEM;
+			break;
+		}
+		/* id 0 is never handed out, to prevent NULL/zero logic to kick in */
+		ret = idr_get_new_above(&map->idr, target, 1, id);
+	} while (-EAGAIN == ret);
+
+	if (0 == ret && *id >= map->max_id)
+	{
+		idr_remove(&map->idr, *id);
+		ret = -ENOSPC;
+	}
+	mutex_unlock(&map->lock);
+
+	return ret ? _MALI_OSK_ERR_NOMEM : _MALI_OSK_ERR_OK;
+}
+
+void *_mali_osk_idmap_lookup( _mali_osk_idmap_t *map, int id )
+{
+	void *target;
+
+	if (id <= 0) return NULL;
+
+	rcu_read_lock();
+	target = idr_find(&map->idr, id);
+	rcu_read_unlock();
+
+	return target;
+}
+
+void *_mali_osk_idmap_lookup_get( _mali_osk_idmap_t *map, int id, mali_bool (*get)(void *) )
+{
+	void *target;
+
+	if (id <= 0) return NULL;
+
+	rcu_read_lock();
+	target = idr_find(&map->idr, id);
+	if (NULL != target && MALI_TRUE != get(target)) target = NULL;
+	rcu_read_unlock();
+
+	return target;
+}
+
+void *_mali_osk_idmap_target_calloc( u32 size )
+{
+	struct idmap_target_head *head;
+
+	head = kzalloc(sizeof(*head) + size, GFP_KERNEL);
+	if (NULL == head) return NULL;
+
+	return head + 1;
+}
+
+static void idmap_target_free_rcu(struct rcu_head *rcu)
+{
+	kfree(container_of(rcu, struct idmap_target_head, rcu));
+}
+
+void _mali_osk_idmap_target_free( _mali_osk_idmap_t *map, void *target )
+{
+	struct idmap_target_head *head = (struct idmap_target_head *)target - 1;
+
+	map->deferred = 1;
+	call_rcu(&head->rcu, idmap_target_free_rcu);
+}
+
+_mali_osk_errcode_t _mali_osk_idmap_replace( _mali_osk_idmap_t *map, int id, void *target )
+{
+	void *old;
+
+	BUG_ON(NULL == target);
+
+	if (id <= 0) return _MALI_OSK_ERR_FAULT;
+
+	mutex_lock(&map->lock);
+	old = idr_replace(&map->idr, target, id);
+	mutex_unlock(&map->lock);
+
+	return IS_ERR(old) ? _MALI_OSK_ERR_FAULT : _MALI_OSK_ERR_OK;
+}
+
+void *_mali_osk_idmap_remove( _mali_osk_idmap_t *map, int id )
+{
+	void *target;
+
+	if (id <= 0) return NULL;
+
+	mutex_lock(&map->lock);
+	target = idr_find(&map->idr, id);
+	if (NULL != target) idr_remove(&map->idr, id);
+	mutex_unlock(&map->lock);
+
+	return target;
+}
+
+struct idmap_for_each_data
+{
+	void (*callback)(int, void *);
+};
+
+static int idmap_for_each_one(int id, void *target, void *data)
+{
+	((struct idmap_for_each_data *)data)->callback(id, target);
+	return 0;
+}
+
+void _mali_osk_idmap_for_each( _mali_osk_idmap_t *map, void (*callback)(int, void *) )
+{
+	struct idmap_for_each_data data = { callback };
+
+	mutex_lock(&map->lock);
+	idr_for_each(&map->idr, idmap_for_each_one, &data);
+	mutex_unlock(&map->lock);
+}
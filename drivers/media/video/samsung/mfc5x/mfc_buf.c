@@ -12,15 +12,20 @@
  */
 
 #include <linux/slab.h>
-#include <linux/spinlock.h>
+#include <linux/mutex.h>
 #include <linux/mm.h>
 #include <linux/err.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 
 #include "mfc.h"
 #include "mfc_mem.h"
 #include "mfc_buf.h"
 #include "mfc_log.h"
 #include "mfc_errno.h"
+#include "mfc_region.h"
 
 #ifdef CONFIG_VIDEO_MFC_VCM_UMP
 #include <plat/s5p-vcm.h>
@@ -34,23 +39,31 @@
 #undef DEBUG_ALLOC_FREE
 
 static struct list_head mfc_alloc_head[MFC_MAX_MEM_PORT_NUM];
-/* The free node list sorted by real address */
-static struct list_head mfc_free_head[MFC_MAX_MEM_PORT_NUM];
+/* The free space of each port, indexed by address and by size */
+static struct mfc_region mfc_free_region[MFC_MAX_MEM_PORT_NUM];
 
-/* FIXME: test locking, add locking mechanisim */
 /*
-static spinlock_t lock;
-*/
+ * Each port has its own lock over its free space and its allocated
+ * buffers, the ioctls allocating stream buffers do not take dev->lock.
+ */
+static struct mutex mfc_buf_lock[MFC_MAX_MEM_PORT_NUM];
+
+/* time spent looking for free space, in ns */
+static u64 mfc_alloc_ns[MFC_MAX_MEM_PORT_NUM];
+static u32 mfc_alloc_max_ns[MFC_MAX_MEM_PORT_NUM];
+
+static struct dentry *mfc_buf_debugfs;
 
 void mfc_print_buf(void)
 {
 #ifdef PRINT_BUF
 	struct list_head *pos;
 	struct mfc_alloc_buffer *alloc = NULL;
-	struct mfc_free_buffer *free = NULL;
+	struct mfc_region *region;
 	int port, i;
 
 	for (port = 0; port < mfc_mem_count(); port++) {
+		mutex_lock(&mfc_buf_lock[port]);
 		mfc_dbg("---- port %d buffer list ----", port);
 
 		i = 0;
@@ -95,171 +108,122 @@ void mfc_print_buf(void)
 			i++;
 		}
 
-		i = 0;
-		list_for_each(pos, &mfc_free_head[port]) {
-			free = list_entry(pos, struct mfc_free_buffer, list);
-			mfc_dbg("[F #%04d] addr: 0x%08lx, size: %d",
-				i, free->real, free->size);
-			i++;
-		}
+		region = &mfc_free_region[port];
+		mfc_dbg("[F] free: %lu, blocks: %u, largest: %lu",
+			region->free, region->blocks,
+			mfc_region_largest(region));
+		mutex_unlock(&mfc_buf_lock[port]);
 	}
 #endif
 }
 
+/* called with mfc_buf_lock[port] held */
 static int mfc_put_free_buf(unsigned int addr, int size, int port)
 {
-	struct list_head *pos, *nxt;
-	struct mfc_free_buffer *free;
-	struct mfc_free_buffer *next = NULL;
-	struct mfc_free_buffer *prev;
-	/* 0x00: not merged, 0x01: prev merged, 0x02: next merged */
-	int merged = 0x00;
-
 	mfc_dbg("addr: 0x%08x, size: %d, port: %d\n", addr, size, port);
 
-	list_for_each_safe(pos, nxt, &mfc_free_head[port]) {
-		next = list_entry(pos, struct mfc_free_buffer, list);
-
-		/*
-		 * When the allocated address must be align without VMEM,
-		 * the free buffer can be overlap
-		 * previous free buffer temporaily
-		 * Target buffer will be shrink after this operation
-		 */
-		if (addr <= next->real) {
-			prev = list_entry(pos->prev, struct mfc_free_buffer, list);
-
-			mfc_dbg("prev->addr: 0x%08lx, size: %d", prev->real, prev->size);
-			/* merge previous free buffer */
-			if (prev && ((prev->real + prev->size) == addr)) {
-				addr  = prev->real;
-				size += prev->size;
-
-				prev->size = size;
-
-				merged |= 0x01;
-				mfc_dbg("auto merge free buffer[p]: addr: 0x%08lx, size: %d",
-					prev->real, prev->size);
-			}
-
-			mfc_dbg("next->addr: 0x%08lx, size: %d", next->real, next->size);
-			/* merge next free buffer */
-			if ((addr + size) == next->real) {
-				next->real  = addr;
-				next->size += size;
-
-				if (merged)
-					prev->size = next->size;
-
-				merged |= 0x02;
-				mfc_dbg("auto merge free buffer[n]: addr: 0x%08lx, size: %d",
-					next->real, next->size);
-			}
-
-			break;
-		}
-	}
+	return mfc_region_free(&mfc_free_region[port], addr, size);
+}
 
-	if (!merged) {
-		free = (struct mfc_free_buffer *)
-			kzalloc(sizeof(struct mfc_free_buffer), GFP_KERNEL);
+/* called with mfc_buf_lock[port] held */
+static unsigned int mfc_get_free_buf(int size, int align, int port)
+{
+	unsigned int addr;
+	ktime_t start;
+	u32 ns;
 
-		if (unlikely(free == NULL))
-			return -ENOMEM;
+	mfc_dbg("size: %d, align: %d, port: %d\n",
+			size, align, port);
 
-		free->real = addr;
-		free->size = size;
+	start = ktime_get();
+	addr = mfc_region_alloc(&mfc_free_region[port], size, align);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
 
-		list_add_tail(&free->list, pos);
-	}
+	mfc_alloc_ns[port] += ns;
+	if (ns > mfc_alloc_max_ns[port])
+		mfc_alloc_max_ns[port] = ns;
 
-	/* bi-directional merged */
-	else if ((merged & 0x03) == 0x03) {
-		list_del(&next->list);
-		kfree(next);
-	}
+	if (!addr)
+		mfc_err("no suitable free node in mfc buffer\n");
 
-	return 0;
+	return addr;
 }
 
-static unsigned int mfc_get_free_buf(int size, int align, int port)
+/* called with mfc_buf_lock[port] held */
+static int mfc_release_buf(struct mfc_alloc_buffer *alloc, int port)
 {
-	struct list_head *pos, *nxt;
-	struct mfc_free_buffer *free;
-	struct mfc_free_buffer *match = NULL;
-	int align_size = 0;
-	unsigned int addr = 0;
+	int ret;
 
-	mfc_dbg("size: %d, align: %d, port: %d\n",
-			size, align, port);
+#if defined(CONFIG_VIDEO_MFC_VCM_UMP)
+	if (alloc->ump_handle)
+		mfc_ump_unmap(alloc->ump_handle);
 
-	if (list_empty(&mfc_free_head[port])) {
-		mfc_err("no free node in mfc buffer\n");
+	if (alloc->vcm_k)
+		mfc_vcm_unmap(alloc->vcm_k);
 
-		return 0;
-	}
+	if (alloc->vcm_s)
+		mfc_vcm_unbind(alloc->vcm_s, alloc->type & MBT_OTHER);
 
-	/* find best fit area */
-	list_for_each_safe(pos, nxt, &mfc_free_head[port]) {
-		free = list_entry(pos, struct mfc_free_buffer, list);
+	ret = mfc_put_free_buf(alloc->vcm_addr, alloc->vcm_size, port);
+#elif defined(CONFIG_S5P_VMEM)
+	if (alloc->vmem_cookie)
+		s5p_vfree(alloc->vmem_cookie);
 
-#if (defined(CONFIG_VIDEO_MFC_VCM_UMP) || defined(CONFIG_S5P_VMEM))
-		/*
-		 * Align the start address.
-		 * We assume the start address of free buffer aligned with 4KB
-		 */
-		align_size = ALIGN(align_size + size, PAGE_SIZE) - size;
-
-		if (align > PAGE_SIZE) {
-			align_size  = ALIGN(free->real, align) - free->real;
-			align_size += ALIGN(align_size + size, PAGE_SIZE) - size;
-		} else {
-			align_size = ALIGN(align_size + size, PAGE_SIZE) - size;
-		}
+	ret = mfc_put_free_buf(alloc->vmem_addr, alloc->vmem_size, port);
 #else
-		align_size = ALIGN(free->real, align) - free->real;
+	ret = mfc_put_free_buf(alloc->real, alloc->size, port);
 #endif
-		if (free->size >= (size + align_size)) {
-			if (match != NULL) {
-				if (free->size < match->size)
-					match = free;
-			} else {
-				match = free;
-			}
-		}
+	if (ret < 0) {
+		mfc_err("failed to add free buffer\n");
+
+		return ret;
 	}
 
-	if (match != NULL) {
-		addr = match->real;
+	list_del(&alloc->list);
+	kfree(alloc);
 
-#if !(defined(CONFIG_VIDEO_MFC_VCM_UMP) || defined(CONFIG_S5P_VMEM))
-		if (align_size > 0) {
-			/*
-			 * When the allocated address must be align without VMEM,
-			 * the free buffer can be overlap
-			 * previous free buffer temporaily
-			 */
-			if (mfc_put_free_buf(match->real, align_size, port) < 0)
-				return 0;
-		}
-#endif
-		/* change allocated buffer address & size */
-		match->real += (size + align_size);
-		match->size -= (size + align_size);
+	return 0;
+}
 
-		if (match->size == 0) {
-			list_del(&match->list);
-			kfree(match);
-		}
-	} else {
-		mfc_err("no suitable free node in mfc buffer\n");
+static int mfc_buf_debug_show(struct seq_file *s, void *unused)
+{
+	struct mfc_region *r;
+	unsigned long tries;
+	int port;
 
-		return 0;
+	for (port = 0; port < mfc_mem_count(); port++) {
+		mutex_lock(&mfc_buf_lock[port]);
+		r = &mfc_free_region[port];
+		tries = r->allocs + r->fails;
+
+		seq_printf(s, "port %d: 0x%08lx-0x%08lx, %lu KB free in %u "
+			   "blocks, largest %lu KB\n", port, r->base,
+			   r->base + r->size, r->free >> 10, r->blocks,
+			   mfc_region_largest(r) >> 10);
+		seq_printf(s, "  allocs %lu, failed %lu, frees %lu, "
+			   "blocks probed %lu\n",
+			   r->allocs, r->fails, r->frees, r->probes);
+		seq_printf(s, "  alloc time avg %llu ns, max %u ns\n",
+			   tries ? div_u64(mfc_alloc_ns[port], tries) : 0ULL,
+			   mfc_alloc_max_ns[port]);
+		mutex_unlock(&mfc_buf_lock[port]);
 	}
 
-	return addr;
+	return 0;
+}
+
+static int mfc_buf_debug_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mfc_buf_debug_show, inode->i_private);
 }
 
+static const struct file_operations mfc_buf_debug_fops = {
+	.open		= mfc_buf_debug_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 int mfc_init_buf(void)
 {
 	int port;
@@ -267,15 +231,14 @@ int mfc_init_buf(void)
 
 	for (port = 0; port < mfc_mem_count(); port++) {
 		INIT_LIST_HEAD(&mfc_alloc_head[port]);
-		INIT_LIST_HEAD(&mfc_free_head[port]);
+		mutex_init(&mfc_buf_lock[port]);
 
-		ret = mfc_put_free_buf(mfc_mem_data_base(port),
-			mfc_mem_data_size(port), port);
+		ret = mfc_region_init(&mfc_free_region[port],
+			mfc_mem_data_base(port), mfc_mem_data_size(port));
 	}
 
-	/*
-	spin_lock_init(&lock);
-	*/
+	mfc_buf_debugfs = debugfs_create_file("mfc_buf", S_IRUGO, NULL, NULL,
+					      &mfc_buf_debug_fops);
 
 	mfc_print_buf();
 
@@ -286,123 +249,31 @@ void mfc_final_buf(void)
 {
 	struct list_head *pos, *nxt;
 	struct mfc_alloc_buffer *alloc;
-	struct mfc_free_buffer *free;
 	int port;
-	/*
-	unsigned long flags;
-	*/
 
-	/*
-	spin_lock_irqsave(&lock, flags);
-	*/
+	debugfs_remove(mfc_buf_debugfs);
+	mfc_buf_debugfs = NULL;
 
 	for (port = 0; port < mfc_mem_count(); port++) {
+		mutex_lock(&mfc_buf_lock[port]);
 		list_for_each_safe(pos, nxt, &mfc_alloc_head[port]) {
 			alloc = list_entry(pos, struct mfc_alloc_buffer, list);
-#if defined(CONFIG_VIDEO_MFC_VCM_UMP)
-			if (alloc->ump_handle)
-				mfc_ump_unmap(alloc->ump_handle);
-
-			if (alloc->vcm_k)
-				mfc_vcm_unmap(alloc->vcm_k);
-
-			if (alloc->vcm_s)
-				mfc_vcm_unbind(alloc->vcm_s,
-						alloc->type & MBT_OTHER);
-
-			if (mfc_put_free_buf(alloc->vcm_addr,
-				alloc->vcm_size, port) < 0) {
-
-				mfc_err("failed to add free buffer\n");
-			} else {
-				list_del(&alloc->list);
-				kfree(alloc);
-			}
-#elif defined(CONFIG_S5P_VMEM)
-			if (alloc->vmem_cookie)
-				s5p_vfree(alloc->vmem_cookie);
-
-			if (mfc_put_free_buf(alloc->vmem_addr,
-				alloc->vmem_size, port) < 0) {
-
-				mfc_err("failed to add free buffer\n");
-			} else {
-				list_del(&alloc->list);
-				kfree(alloc);
-			}
-#else
-			if (mfc_put_free_buf(alloc->real,
-				alloc->size, port) < 0) {
-
-				mfc_err("failed to add free buffer\n");
-			} else {
-				list_del(&alloc->list);
-				kfree(alloc);
-			}
-#endif
+			mfc_release_buf(alloc, port);
 		}
+		mutex_unlock(&mfc_buf_lock[port]);
 	}
 
-	/*
-	spin_unlock_irqrestore(&lock, flags);
-	*/
-
 	mfc_print_buf();
 
-	/*
-	spin_lock_irqsave(&lock, flags);
-	*/
-
 	for (port = 0; port < mfc_mem_count(); port++) {
-		list_for_each_safe(pos, nxt, &mfc_free_head[port]) {
-			free = list_entry(pos, struct mfc_free_buffer, list);
-			list_del(&free->list);
-			kfree(free);
-		}
+		mutex_lock(&mfc_buf_lock[port]);
+		mfc_region_final(&mfc_free_region[port]);
+		mutex_unlock(&mfc_buf_lock[port]);
 	}
 
-	/*
-	spin_unlock_irqrestore(&lock, flags);
-	*/
-
 	mfc_print_buf();
 }
 
-void mfc_merge_buf(void)
-{
-	struct list_head *pos, *nxt;
-	struct mfc_free_buffer *n1;
-	struct mfc_free_buffer *n2;
-	int port;
-
-	for (port = 0; port < mfc_mem_count(); port++) {
-		list_for_each_safe(pos, nxt, &mfc_free_head[port]) {
-			n1 = list_entry(pos, struct mfc_free_buffer, list);
-			n2 = list_entry(nxt, struct mfc_free_buffer, list);
-
-			mfc_dbg("merge pre: n1: 0x%08lx, n2: 0x%08lx",
-				n1->real, n2->real);
-
-			if (!list_is_last(pos, &mfc_free_head[port])) {
-				if ((n1->real + n1->size) == n2->real) {
-					n2->real  = n1->real;
-					n2->size += n1->size;
-					list_del(&n1->list);
-					kfree(n1);
-				}
-			}
-
-			mfc_dbg("merge aft: n1: 0x%08lx, n2: 0x%08lx, last: %d",
-				n1->real, n2->real,
-				list_is_last(pos, &mfc_free_head[port]));
-		}
-	}
-
-#ifdef DEBUG_ALLOC_FREE
-	mfc_print_buf();
-#endif
-}
-
 /* FIXME: port auto select, return values */
 struct mfc_alloc_buffer *_mfc_alloc_buf(
 	struct mfc_inst_ctx *ctx, int size, int align, int flag)
@@ -411,14 +282,9 @@ struct mfc_alloc_buffer *_mfc_alloc_buf(
 	struct mfc_alloc_buffer *alloc;
 	int port = flag & 0xFFFF;
 #if defined(CONFIG_VIDEO_MFC_VCM_UMP)
-	int align_size = 0;
 	struct ump_vcm ump_vcm;
-#elif defined(CONFIG_S5P_VMEM)
-	int align_size = 0;
 #endif
-	/*
-	unsigned long flags;
-	*/
+	int span;
 
 	if (size <= 0)
 		return NULL;
@@ -433,38 +299,34 @@ struct mfc_alloc_buffer *_mfc_alloc_buf(
 	if (port > (mfc_mem_count() - 1))
 		port = mfc_mem_count() - 1;
 
-	/*
-	spin_lock_irqsave(&lock, flags);
-	*/
+#if (defined(CONFIG_VIDEO_MFC_VCM_UMP) || defined(CONFIG_S5P_VMEM))
+	/* buffers are mapped by whole pages */
+	span = ALIGN(size, PAGE_SIZE);
+	if (align < PAGE_SIZE)
+		align = PAGE_SIZE;
+#else
+	span = size;
+#endif
 
-	addr = mfc_get_free_buf(size, align, port);
+	mutex_lock(&mfc_buf_lock[port]);
+	addr = mfc_get_free_buf(span, align, port);
+	mutex_unlock(&mfc_buf_lock[port]);
 
 	mfc_dbg("mfc_get_free_buf: 0x%08x\n", addr);
 
 	if (!addr) {
 		mfc_dbg("cannot get suitable free buffer\n");
-		/* FIXME: is it need?
-		mfc_put_free_buf(addr, size, port);
-		*/
 		kfree(alloc);
-		/*
-		spin_unlock_irqrestore(&lock, flags);
-		*/
 
 		return NULL;
 	}
 
 #if defined(CONFIG_VIDEO_MFC_VCM_UMP)
-	if (align > PAGE_SIZE) {
-		align_size = ALIGN(addr, align) - addr;
-		align_size += ALIGN(align_size + size, PAGE_SIZE) - size;
-	} else {
-		align_size = ALIGN(align_size + size, PAGE_SIZE) - size;
-	}
-
-	alloc->vcm_s = mfc_vcm_bind(addr, size + align_size);
+	alloc->vcm_s = mfc_vcm_bind(addr, span);
 	if (IS_ERR(alloc->vcm_s)) {
-		mfc_put_free_buf(addr, size, port);
+		mutex_lock(&mfc_buf_lock[port]);
+		mfc_put_free_buf(addr, span, port);
+		mutex_unlock(&mfc_buf_lock[port]);
 		kfree(alloc);
 
 		return NULL;
@@ -478,7 +340,9 @@ struct mfc_alloc_buffer *_mfc_alloc_buf(
 		if (IS_ERR(alloc->vcm_k)) {
 			mfc_vcm_unbind(alloc->vcm_s,
 					alloc->type & MBT_OTHER);
-			mfc_put_free_buf(addr, size, port);
+			mutex_lock(&mfc_buf_lock[port]);
+			mfc_put_free_buf(addr, span, port);
+			mutex_unlock(&mfc_buf_lock[port]);
 			kfree(alloc);
 
 			return NULL;
@@ -498,10 +362,12 @@ struct mfc_alloc_buffer *_mfc_alloc_buf(
 			mfc_vcm_unmap(alloc->vcm_k);
 			mfc_vcm_unbind(alloc->vcm_s,
 					alloc->type & MBT_OTHER);
-			mfc_put_free_buf(addr, size, port);
+			mutex_lock(&mfc_buf_lock[port]);
+			mfc_put_free_buf(addr, span, port);
+			mutex_unlock(&mfc_buf_lock[port]);
 			kfree(alloc);
 
-		return NULL;
+			return NULL;
 			/*
 			return PTR_ERR(alloc->vcm_k);
 			*/
@@ -509,30 +375,24 @@ struct mfc_alloc_buffer *_mfc_alloc_buf(
 	}
 
 	alloc->vcm_addr = addr;
-	alloc->vcm_size = size + align_size;
+	alloc->vcm_size = span;
 #elif defined(CONFIG_S5P_VMEM)
-	if (align > PAGE_SIZE) {
-		align_size = ALIGN(addr, align) - addr;
-		align_size += ALIGN(align_size + size, PAGE_SIZE) - size;
-	} else {
-		align_size = ALIGN(align_size + size, PAGE_SIZE) - size;
-	}
-
-	alloc->vmem_cookie = s5p_vmem_vmemmap(size + align_size,
-			addr, addr + (size + align_size));
+	alloc->vmem_cookie = s5p_vmem_vmemmap(span, addr, addr + span);
 
 	if (!alloc->vmem_cookie) {
 		mfc_dbg("cannot map free buffer to memory\n");
-		mfc_put_free_buf(addr, size, port);
+		mutex_lock(&mfc_buf_lock[port]);
+		mfc_put_free_buf(addr, span, port);
+		mutex_unlock(&mfc_buf_lock[port]);
 		kfree(alloc);
 
 		return NULL;
 	}
 
 	alloc->vmem_addr = addr;
-	alloc->vmem_size = size + align_size;
+	alloc->vmem_size = span;
 #endif
-	alloc->real = ALIGN(addr, align);
+	alloc->real = addr;
 	alloc->size = size;
 
 #if defined(CONFIG_VIDEO_MFC_VCM_UMP)
@@ -555,11 +415,9 @@ struct mfc_alloc_buffer *_mfc_alloc_buf(
 	alloc->type = flag & 0xFFFF0000;
 	alloc->owner = ctx->id;
 
+	mutex_lock(&mfc_buf_lock[port]);
 	list_add(&alloc->list, &mfc_alloc_head[port]);
-
-	/*
-	spin_unlock_irqrestore(&lock, flags);
-	*/
+	mutex_unlock(&mfc_buf_lock[port]);
 
 #ifdef DEBUG_ALLOC_FREE
 	mfc_print_buf();
@@ -606,7 +464,9 @@ unsigned int mfc_vcm_bind_from_others(struct mfc_inst_ctx *ctx,
 		goto err_ret;
 	}
 
-	addr = mfc_get_free_buf(size, ALIGN_2KB, port);
+	mutex_lock(&mfc_buf_lock[port]);
+	addr = mfc_get_free_buf(size, PAGE_SIZE, port);
+	mutex_unlock(&mfc_buf_lock[port]);
 	if (!addr) {
 		mfc_dbg("cannot get suitable free buffer\n");
 		goto err_ret_alloc;
@@ -616,7 +476,7 @@ unsigned int mfc_vcm_bind_from_others(struct mfc_inst_ctx *ctx,
 	s_res = kzalloc(sizeof(struct vcm_mmu_res), GFP_KERNEL);
 	if (!s_res) {
 		mfc_dbg("%s: Failed to get vcm_mmu_res\n", __func__);
-		goto err_ret_alloc;
+		goto err_ret_free;
 	}
 
 	s_res->res.start = addr;
@@ -639,7 +499,9 @@ unsigned int mfc_vcm_bind_from_others(struct mfc_inst_ctx *ctx,
 	alloc->type = flag & 0xFFFF0000;
 	alloc->owner = ctx->id;
 
+	mutex_lock(&mfc_buf_lock[port]);
 	list_add(&alloc->list, &mfc_alloc_head[port]);
+	mutex_unlock(&mfc_buf_lock[port]);
 
 	mfc_print_buf();
 
@@ -647,6 +509,10 @@ unsigned int mfc_vcm_bind_from_others(struct mfc_inst_ctx *ctx,
 
 err_ret_s_res:
 	kfree(s_res);
+err_ret_free:
+	mutex_lock(&mfc_buf_lock[port]);
+	mfc_put_free_buf(addr, size, port);
+	mutex_unlock(&mfc_buf_lock[port]);
 err_ret_alloc:
 	kfree(alloc);
 err_ret:
@@ -684,75 +550,26 @@ int _mfc_free_buf(unsigned long real)
 	struct mfc_alloc_buffer *alloc;
 	int port;
 	int found = 0;
-	/*
-	unsigned long flags;
-	*/
 
 	mfc_dbg("addr: 0x%08lx\n", real);
 
-	/*
-	spin_lock_irqsave(&lock, flags);
-	*/
-
 	for (port = 0; port < mfc_mem_count(); port++) {
+		mutex_lock(&mfc_buf_lock[port]);
 		list_for_each_safe(pos, nxt, &mfc_alloc_head[port]) {
 			alloc = list_entry(pos, struct mfc_alloc_buffer, list);
 
 			if (alloc->real == real) {
 				found = 1;
-#if defined(CONFIG_VIDEO_MFC_VCM_UMP)
-				if (alloc->ump_handle)
-					mfc_ump_unmap(alloc->ump_handle);
-
-				if (alloc->vcm_k)
-					mfc_vcm_unmap(alloc->vcm_k);
-
-				if (alloc->vcm_s)
-					mfc_vcm_unbind(alloc->vcm_s,
-							alloc->type & MBT_OTHER);
-
-				if (mfc_put_free_buf(alloc->vcm_addr,
-					alloc->vcm_size, port) < 0) {
-
-					mfc_err("failed to add free buffer\n");
-				} else {
-					list_del(&alloc->list);
-					kfree(alloc);
-				}
-#elif defined(CONFIG_S5P_VMEM)
-				if (alloc->vmem_cookie)
-					s5p_vfree(alloc->vmem_cookie);
-
-				if (mfc_put_free_buf(alloc->vmem_addr,
-					alloc->vmem_size, port) < 0) {
-
-					mfc_err("failed to add free buffer\n");
-				} else {
-					list_del(&alloc->list);
-					kfree(alloc);
-				}
-#else
-				if (mfc_put_free_buf(alloc->real,
-					alloc->size, port) < 0) {
-
-					mfc_err("failed to add free buffer\n");
-				} else {
-					list_del(&alloc->list);
-					kfree(alloc);
-				}
-#endif
+				mfc_release_buf(alloc, port);
 				break;
 			}
 		}
+		mutex_unlock(&mfc_buf_lock[port]);
 
 		if (found)
 			break;
 	}
 
-	/*
-	spin_unlock_irqrestore(&lock, flags);
-	*/
-
 #ifdef DEBUG_ALLOC_FREE
 	mfc_print_buf();
 #endif
@@ -784,13 +601,14 @@ void mfc_free_buf_dpb(int owner)
 	struct mfc_alloc_buffer *alloc;
 
 	for (port = 0; port < mfc_mem_count(); port++) {
+		mutex_lock(&mfc_buf_lock[port]);
 		list_for_each_safe(pos, nxt, &mfc_alloc_head[port]) {
 			alloc = list_entry(pos, struct mfc_alloc_buffer, list);
 
-			if ((alloc->owner == owner) && (alloc->type == MBT_DPB)) {
-				_mfc_free_buf(alloc->real);
-					}
-				}
+			if ((alloc->owner == owner) && (alloc->type == MBT_DPB))
+				mfc_release_buf(alloc, port);
+		}
+		mutex_unlock(&mfc_buf_lock[port]);
 	}
 }
 
@@ -800,70 +618,20 @@ void mfc_free_buf_inst(int owner)
 	struct list_head *pos, *nxt;
 	int port;
 	struct mfc_alloc_buffer *alloc;
-	/*
-	unsigned long flags;
-	*/
 
 	mfc_dbg("owner: %d\n", owner);
 
-	/*
-	spin_lock_irqsave(&lock, flags);
-	*/
-
 	for (port = 0; port < mfc_mem_count(); port++) {
+		mutex_lock(&mfc_buf_lock[port]);
 		list_for_each_safe(pos, nxt, &mfc_alloc_head[port]) {
 			alloc = list_entry(pos, struct mfc_alloc_buffer, list);
 
-			if (alloc->owner == owner) {
-#if defined(CONFIG_VIDEO_MFC_VCM_UMP)
-				if (alloc->ump_handle)
-					mfc_ump_unmap(alloc->ump_handle);
-
-				if (alloc->vcm_k)
-					mfc_vcm_unmap(alloc->vcm_k);
-
-				if (alloc->vcm_s)
-					mfc_vcm_unbind(alloc->vcm_s,
-							alloc->type & MBT_OTHER);
-
-				if (mfc_put_free_buf(alloc->vcm_addr,
-					alloc->vcm_size, port) < 0) {
-
-					mfc_err("failed to add free buffer\n");
-				} else {
-					list_del(&alloc->list);
-					kfree(alloc);
-				}
-#elif defined(CONFIG_S5P_VMEM)
-				if (alloc->vmem_cookie)
-					s5p_vfree(alloc->vmem_cookie);
-
-				if (mfc_put_free_buf(alloc->vmem_addr,
-					alloc->vmem_size, port) < 0) {
-
-					mfc_err("failed to add free buffer\n");
-				} else {
-					list_del(&alloc->list);
-					kfree(alloc);
-				}
-#else
-				if (mfc_put_free_buf(alloc->real,
-					alloc->size, port) < 0) {
-
-					mfc_err("failed to add free buffer\n");
-				} else {
-					list_del(&alloc->list);
-					kfree(alloc);
-				}
-#endif
-			}
+			if (alloc->owner == owner)
+				mfc_release_buf(alloc, port);
 		}
+		mutex_unlock(&mfc_buf_lock[port]);
 	}
 
-	/*
-	spin_unlock_irqrestore(&lock, flags);
-	*/
-
 #ifdef DEBUG_ALLOC_FREE
 	mfc_print_buf();
 #endif
@@ -874,6 +642,7 @@ unsigned long mfc_get_buf_real(int owner, unsigned int key)
 	struct list_head *pos, *nxt;
 	int port;
 	struct mfc_alloc_buffer *alloc;
+	unsigned long real = 0;
 
 #if defined(CONFIG_VIDEO_MFC_VCM_UMP)
 		mfc_dbg("owner: %d, secure id: 0x%08x\n", owner, key);
@@ -884,6 +653,7 @@ unsigned long mfc_get_buf_real(int owner, unsigned int key)
 #endif
 
 	for (port = 0; port < mfc_mem_count(); port++) {
+		mutex_lock(&mfc_buf_lock[port]);
 		list_for_each_safe(pos, nxt, &mfc_alloc_head[port]) {
 			alloc = list_entry(pos, struct mfc_alloc_buffer, list);
 
@@ -891,20 +661,26 @@ unsigned long mfc_get_buf_real(int owner, unsigned int key)
 #if defined(CONFIG_VIDEO_MFC_VCM_UMP)
 				if (alloc->ump_handle) {
 					if (mfc_ump_get_id(alloc->ump_handle) == key)
-						return alloc->real;
+						real = alloc->real;
 				}
 #elif defined(CONFIG_S5P_VMEM)
 				if (alloc->vmem_cookie == key)
-					return alloc->real;
+					real = alloc->real;
 #else
 				if (alloc->ofs == key)
-					return alloc->real;
+					real = alloc->real;
 #endif
+				if (real)
+					break;
 			}
 		}
+		mutex_unlock(&mfc_buf_lock[port]);
+
+		if (real)
+			break;
 	}
 
-	return 0;
+	return real;
 }
 
 #if 0
@@ -961,19 +737,27 @@ void *mfc_get_buf_ump_handle(unsigned long real)
 	struct list_head *pos, *nxt;
 	int port;
 	struct mfc_alloc_buffer *alloc;
+	void *handle = NULL;
 
 	mfc_dbg("real: 0x%08lx\n", real);
 
 	for (port = 0; port < mfc_mem_count(); port++) {
+		mutex_lock(&mfc_buf_lock[port]);
 		list_for_each_safe(pos, nxt, &mfc_alloc_head[port]) {
 			alloc = list_entry(pos, struct mfc_alloc_buffer, list);
 
-			if (alloc->real == real)
-				return alloc->ump_handle;
+			if (alloc->real == real) {
+				handle = alloc->ump_handle;
+				break;
+			}
 		}
+		mutex_unlock(&mfc_buf_lock[port]);
+
+		if (handle)
+			break;
 	}
 
-	return NULL;
+	return handle;
 }
 #endif
 
@@ -154,17 +154,10 @@ struct mfc_alloc_buffer {
 #endif
 };
 
-struct mfc_free_buffer {
-	struct list_head list;
-	unsigned long real;	/* phys. or virt. addr for MFC	*/
-	unsigned int size;
-};
-
 void mfc_print_buf(void);
 
 int mfc_init_buf(void);
 void mfc_final_buf(void);
-void mfc_merge_buf(void);
 struct mfc_alloc_buffer *_mfc_alloc_buf(
 	struct mfc_inst_ctx *ctx, int size, int align, int flag);
 int mfc_alloc_buf(
@@ -25,6 +25,7 @@
 #include <linux/slab.h>
 #include <linux/dma-mapping.h>
 #include <linux/delay.h>
+#include <linux/poll.h>
 
 #include <linux/sched.h>
 #include <linux/firmware.h>
@@ -203,6 +204,8 @@ static int mfc_release(struct inode *inode, struct file *file)
 
 	dev = mfc_ctx->dev;
 
+	mfc_cancel_jobs(mfc_ctx);
+
 	mutex_lock(&dev->lock);
 
 #ifdef CONFIG_CPU_FREQ
@@ -343,6 +346,15 @@ static long mfc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		break;
 
 	case IOCTL_MFC_DEC_EXE:
+		/* would overtake the frames queued before */
+		if (!mfc_jobs_idle(mfc_ctx)) {
+			mfc_err("IOCTL_MFC_DEC_EXE with queued jobs\n");
+			in_param.ret_code = MFC_STATE_INVALID;
+			ret = -EBUSY;
+
+			break;
+		}
+
 		mutex_lock(&dev->lock);
 
 		mfc_clock_on();
@@ -354,6 +366,15 @@ static long mfc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		break;
 
 	case IOCTL_MFC_ENC_EXE:
+		/* would overtake the frames queued before */
+		if (!mfc_jobs_idle(mfc_ctx)) {
+			mfc_err("IOCTL_MFC_ENC_EXE with queued jobs\n");
+			in_param.ret_code = MFC_STATE_INVALID;
+			ret = -EBUSY;
+
+			break;
+		}
+
 		mutex_lock(&dev->lock);
 
 		mfc_clock_on();
@@ -364,6 +385,38 @@ static long mfc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		mutex_unlock(&dev->lock);
 		break;
 
+	case IOCTL_MFC_QUEUE_EXE:
+		in_param.ret_code = mfc_queue_job(mfc_ctx, &in_param);
+		if (in_param.ret_code == MFC_QUEUE_FULL)
+			ret = -EAGAIN;
+		else
+			ret = in_param.ret_code;
+
+		break;
+
+	case IOCTL_MFC_DEQUEUE_EXE:
+		ret = mfc_dequeue_job(mfc_ctx, &in_param,
+				      file->f_flags & O_NONBLOCK);
+		if (ret == -ERESTARTSYS)
+			return ret;
+
+		if (ret == MFC_QUEUE_EMPTY) {
+			in_param.ret_code = MFC_QUEUE_EMPTY;
+			ret = -EAGAIN;
+		} else {
+			/* what the queued exec ioctl returned */
+			ret = in_param.ret_code;
+		}
+
+		break;
+
+	case IOCTL_MFC_SET_EVENTFD:
+		in_param.ret_code = mfc_set_job_eventfd(mfc_ctx,
+					in_param.args.eventfd.fd);
+		ret = in_param.ret_code;
+
+		break;
+
 	case IOCTL_MFC_GET_IN_BUF:
 		if (in_param.args.mem_alloc.type == ENCODER) {
 			buf_arg.type = ENCODER;
@@ -793,12 +846,26 @@ static int mfc_mmap(struct file *file, struct vm_area_struct *vma)
 	return 0;
 }
 
+static unsigned int mfc_poll(struct file *file, poll_table *wait)
+{
+	struct mfc_inst_ctx *mfc_ctx;
+
+	mfc_ctx = (struct mfc_inst_ctx *)file->private_data;
+	if (!mfc_ctx)
+		return POLLERR;
+
+	poll_wait(file, &mfc_ctx->job_wait, wait);
+
+	return mfc_poll_jobs(mfc_ctx);
+}
+
 static const struct file_operations mfc_fops = {
 	.owner		= THIS_MODULE,
 	.open		= mfc_open,
 	.release	= mfc_release,
 	.unlocked_ioctl	= mfc_ioctl,
 	.mmap		= mfc_mmap,
+	.poll		= mfc_poll,
 };
 
 static struct miscdevice mfc_miscdev = {
@@ -846,6 +913,9 @@ static int __devinit mfc_probe(struct platform_device *pdev)
 	init_waitqueue_head(&mfcdev->wait_codec[0]);
 	init_waitqueue_head(&mfcdev->wait_codec[1]);
 	atomic_set(&mfcdev->inst_cnt, 0);
+	spin_lock_init(&mfcdev->sched_lock);
+	mfc_sched_init(&mfcdev->sched);
+	INIT_WORK(&mfcdev->sched_work, mfc_run_jobs);
 #ifdef CONFIG_CPU_FREQ
 	atomic_set(&mfcdev->busfreq_lock_cnt, 0);
 	atomic_set(&mfcdev->cpufreq_lock_cnt, 0);
@@ -952,6 +1022,14 @@ static int __devinit mfc_probe(struct platform_device *pdev)
 	mfc_init_decoders();
 	mfc_init_encoders();
 
+	/* frozen across suspend, a job in progress finishes first */
+	mfcdev->sched_wq = create_freezeable_workqueue("mfc_sched");
+	if (mfcdev->sched_wq == NULL) {
+		mfc_err("failed to create job workqueue\n");
+		ret = -ENOMEM;
+		goto err_sched_wq;
+	}
+
 	ret = misc_register(&mfc_miscdev);
 
 	if (ret) {
@@ -964,6 +1042,9 @@ static int __devinit mfc_probe(struct platform_device *pdev)
 	return 0;
 
 err_misc_reg:
+	destroy_workqueue(mfcdev->sched_wq);
+
+err_sched_wq:
 	mfc_final_buf();
 
 #ifdef SYSMMU_MFC_ON
@@ -1025,6 +1106,7 @@ static int __devexit mfc_remove(struct platform_device *pdev)
 
 	misc_deregister(&mfc_miscdev);
 
+	destroy_workqueue(dev->sched_wq);
 	mfc_final_buf();
 #ifdef SYSMMU_MFC_ON
 	mfc_clock_on();
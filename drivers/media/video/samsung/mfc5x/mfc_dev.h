@@ -16,6 +16,8 @@
 
 #include <linux/mutex.h>
 #include <linux/firmware.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 
 #include "mfc_inst.h"
 
@@ -98,6 +100,12 @@ struct mfc_dev {
 	wait_queue_head_t	wait_codec[2];
 	int			irq_codec[2];
 
+	/* queued exec ioctls, run one at a time by sched_work */
+	spinlock_t		sched_lock;
+	struct mfc_sched	sched;
+	struct workqueue_struct	*sched_wq;
+	struct work_struct	sched_work;
+
 	struct mfc_fw		fw;
 
 	struct s5p_vcm_mmu	*_vcm_mmu;
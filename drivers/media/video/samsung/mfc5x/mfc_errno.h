@@ -64,6 +64,8 @@ enum mfc_ret_code {
 	MFC_GET_CONF_FAIL = -6007,
 	MFC_SET_CONF_FAIL = -6008,
 	MFC_INVALID_PARAM_FAIL = -6009,
+	MFC_QUEUE_FULL = -6010,
+	MFC_QUEUE_EMPTY = -6011,
 	MFC_API_FAIL = -9000,
 
 	MFC_CMD_FAIL = -1003,
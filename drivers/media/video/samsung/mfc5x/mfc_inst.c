@@ -13,8 +13,12 @@
 
 #include <linux/slab.h>
 #include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/poll.h>
+#include <linux/eventfd.h>
 
 #include "mfc_inst.h"
+#include "mfc_dev.h"
 #include "mfc_log.h"
 #include "mfc_buf.h"
 #include "mfc_cmd.h"
@@ -64,6 +68,9 @@ struct mfc_inst_ctx *mfc_create_inst(void)
 
 	INIT_LIST_HEAD(&ctx->presetcfgs);
 
+	mfc_sched_queue_init(&ctx->jobs, MFC_JOB_DEPTH);
+	init_waitqueue_head(&ctx->job_wait);
+
 	return ctx;
 }
 
@@ -225,3 +232,207 @@ int mfc_set_inst_cfg(struct mfc_inst_ctx *ctx, unsigned int type, int *value)
 	return ret;
 }
 
+/*
+ * Exec ioctls queued with IOCTL_MFC_QUEUE_EXE run on dev->sched_wq, one
+ * after the other without waiting for userspace in between, the instances
+ * taking turns. Each finished job wakes up pollers of its instance and
+ * signals its eventfd, IOCTL_MFC_DEQUEUE_EXE hands back the results in
+ * the order the jobs were queued.
+ */
+int mfc_queue_job(struct mfc_inst_ctx *ctx, struct mfc_common_args *args)
+{
+	struct mfc_dev *dev = ctx->dev;
+	struct mfc_inst_job *ijob;
+	int ret;
+
+	if (ctx->state < INST_STATE_INIT)
+		return MFC_STATE_INVALID;
+
+	ijob = kmalloc(sizeof(struct mfc_inst_job), GFP_KERNEL);
+	if (unlikely(ijob == NULL))
+		return MFC_MEM_ALLOC_FAIL;
+
+	ijob->ctx = ctx;
+	memcpy(&ijob->args, args, sizeof(struct mfc_common_args));
+
+	spin_lock(&dev->sched_lock);
+	ret = mfc_sched_submit(&dev->sched, &ctx->jobs, &ijob->job);
+	spin_unlock(&dev->sched_lock);
+
+	if (ret < 0) {
+		kfree(ijob);
+		return MFC_QUEUE_FULL;
+	}
+
+	queue_work(dev->sched_wq, &dev->sched_work);
+
+	return MFC_OK;
+}
+
+static struct mfc_inst_job *mfc_collect_job(struct mfc_inst_ctx *ctx,
+					    int *idle)
+{
+	struct mfc_dev *dev = ctx->dev;
+	struct mfc_job *job;
+
+	spin_lock(&dev->sched_lock);
+	job = mfc_sched_collect(&ctx->jobs);
+	if (idle)
+		*idle = ctx->jobs.queued == 0;
+	spin_unlock(&dev->sched_lock);
+
+	return job ? container_of(job, struct mfc_inst_job, job) : NULL;
+}
+
+int mfc_dequeue_job(struct mfc_inst_ctx *ctx, struct mfc_common_args *args,
+		    int nonblock)
+{
+	struct mfc_inst_job *ijob;
+	int idle, ret;
+
+	for (;;) {
+		ijob = mfc_collect_job(ctx, &idle);
+		if (ijob != NULL)
+			break;
+		if (idle || nonblock)
+			return MFC_QUEUE_EMPTY;
+
+		ret = wait_event_interruptible(ctx->job_wait,
+				(mfc_poll_jobs(ctx) & POLLIN) || mfc_jobs_idle(ctx));
+		if (ret < 0)
+			return ret;
+	}
+
+	memcpy(args, &ijob->args, sizeof(struct mfc_common_args));
+	kfree(ijob);
+
+	return MFC_OK;
+}
+
+static int mfc_job_running(struct mfc_inst_ctx *ctx)
+{
+	struct mfc_dev *dev = ctx->dev;
+	int running;
+
+	spin_lock(&dev->sched_lock);
+	running = ctx->jobs.running != NULL;
+	spin_unlock(&dev->sched_lock);
+
+	return running;
+}
+
+/* drops the jobs of an instance being released, waits for a running one */
+void mfc_cancel_jobs(struct mfc_inst_ctx *ctx)
+{
+	struct mfc_dev *dev = ctx->dev;
+	struct mfc_inst_job *ijob, *tmp;
+	LIST_HEAD(jobs);
+	int running;
+
+	spin_lock(&dev->sched_lock);
+	running = mfc_sched_cancel(&dev->sched, &ctx->jobs, &jobs);
+	spin_unlock(&dev->sched_lock);
+
+	list_for_each_entry_safe(ijob, tmp, &jobs, job.list)
+		kfree(ijob);
+
+	if (running) {
+		wait_event(ctx->job_wait, !mfc_job_running(ctx));
+		while ((ijob = mfc_collect_job(ctx, NULL)) != NULL)
+			kfree(ijob);
+	}
+
+	if (ctx->job_eventfd) {
+		eventfd_ctx_put(ctx->job_eventfd);
+		ctx->job_eventfd = NULL;
+	}
+}
+
+/* no job queued, running or waiting to be dequeued */
+int mfc_jobs_idle(struct mfc_inst_ctx *ctx)
+{
+	struct mfc_dev *dev = ctx->dev;
+	int idle;
+
+	spin_lock(&dev->sched_lock);
+	idle = ctx->jobs.queued == 0;
+	spin_unlock(&dev->sched_lock);
+
+	return idle;
+}
+
+unsigned int mfc_poll_jobs(struct mfc_inst_ctx *ctx)
+{
+	struct mfc_dev *dev = ctx->dev;
+	unsigned int mask = 0;
+
+	spin_lock(&dev->sched_lock);
+	if (mfc_sched_has_done(&ctx->jobs))
+		mask |= POLLIN | POLLRDNORM;
+	if (!mfc_sched_full(&ctx->jobs))
+		mask |= POLLOUT | POLLWRNORM;
+	spin_unlock(&dev->sched_lock);
+
+	return mask;
+}
+
+int mfc_set_job_eventfd(struct mfc_inst_ctx *ctx, int fd)
+{
+	struct mfc_dev *dev = ctx->dev;
+	struct eventfd_ctx *efd = NULL, *old;
+
+	if (fd >= 0) {
+		efd = eventfd_ctx_fdget(fd);
+		if (IS_ERR(efd))
+			return MFC_INVALID_PARAM_FAIL;
+	}
+
+	spin_lock(&dev->sched_lock);
+	old = ctx->job_eventfd;
+	ctx->job_eventfd = efd;
+	spin_unlock(&dev->sched_lock);
+
+	if (old)
+		eventfd_ctx_put(old);
+
+	return MFC_OK;
+}
+
+void mfc_run_jobs(struct work_struct *work)
+{
+	struct mfc_dev *dev = container_of(work, struct mfc_dev, sched_work);
+	struct mfc_inst_job *ijob;
+	struct mfc_inst_ctx *ctx;
+	struct mfc_job *job;
+	int ret;
+
+	spin_lock(&dev->sched_lock);
+	while ((job = mfc_sched_next(&dev->sched)) != NULL) {
+		spin_unlock(&dev->sched_lock);
+
+		ijob = container_of(job, struct mfc_inst_job, job);
+		ctx = ijob->ctx;
+
+		mutex_lock(&dev->lock);
+		mfc_clock_on();
+		if (ctx->type == ENCODER)
+			ret = mfc_exec_encoding(ctx, &ijob->args.args);
+		else
+			ret = mfc_exec_decoding(ctx, &ijob->args.args);
+		mfc_clock_off();
+		mutex_unlock(&dev->lock);
+
+		ijob->args.ret_code = ret;
+
+		/*
+		 * Woken up under the lock, mfc_cancel_jobs() may free the
+		 * instance as soon as it sees the job completed.
+		 */
+		spin_lock(&dev->sched_lock);
+		mfc_sched_complete(&dev->sched, job, ret);
+		wake_up(&ctx->job_wait);
+		if (ctx->job_eventfd)
+			eventfd_signal(ctx->job_eventfd, 1);
+	}
+	spin_unlock(&dev->sched_lock);
+}
@@ -15,9 +15,14 @@
 #define __MFC_INST_H __FILE__
 
 #include <linux/list.h>
+#include <linux/wait.h>
 
 #include "mfc.h"
 #include "mfc_interface.h"
+#include "mfc_sched.h"
+
+/* exec ioctls an instance may have queued and not dequeued */
+#define MFC_JOB_DEPTH		4
 
 
 /* FIXME: instance state should be more specific */
@@ -204,6 +209,18 @@ struct mfc_inst_ctx {
 	int busfreq_flag; /* context bus frequency flag*/
 	int cpufreq_flag; /* context CPU frequency flag*/
 #endif
+
+	/* IOCTL_MFC_QUEUE_EXE, under dev->sched_lock */
+	struct mfc_sched_queue jobs;
+	wait_queue_head_t job_wait;
+	struct eventfd_ctx *job_eventfd;
+};
+
+/* a queued exec ioctl and, once it ran, its result */
+struct mfc_inst_job {
+	struct mfc_job job;
+	struct mfc_inst_ctx *ctx;
+	struct mfc_common_args args;
 };
 
 struct mfc_inst_ctx *mfc_create_inst(void);
@@ -212,4 +229,15 @@ int mfc_set_inst_state(struct mfc_inst_ctx *ctx, enum instance_state state);
 int mfc_chk_inst_state(struct mfc_inst_ctx *ctx, enum instance_state state);
 int mfc_set_inst_cfg(struct mfc_inst_ctx *ctx, unsigned int type, int *value);
 
+struct work_struct;
+
+int mfc_queue_job(struct mfc_inst_ctx *ctx, struct mfc_common_args *args);
+int mfc_dequeue_job(struct mfc_inst_ctx *ctx, struct mfc_common_args *args,
+		    int nonblock);
+void mfc_cancel_jobs(struct mfc_inst_ctx *ctx);
+int mfc_jobs_idle(struct mfc_inst_ctx *ctx);
+unsigned int mfc_poll_jobs(struct mfc_inst_ctx *ctx);
+int mfc_set_job_eventfd(struct mfc_inst_ctx *ctx, int fd);
+void mfc_run_jobs(struct work_struct *work);
+
 #endif /* __MFC_INST_H */
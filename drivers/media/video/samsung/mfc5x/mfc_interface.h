@@ -31,6 +31,9 @@
 #define IOCTL_MFC_ENC_INIT			(0x00800002)
 #define IOCTL_MFC_DEC_EXE			(0x00800003)
 #define IOCTL_MFC_ENC_EXE			(0x00800004)
+#define IOCTL_MFC_QUEUE_EXE			(0x00800005)
+#define IOCTL_MFC_DEQUEUE_EXE		(0x00800006)
+#define IOCTL_MFC_SET_EVENTFD		(0x00800007)
 
 #define IOCTL_MFC_GET_IN_BUF		(0x00800010)
 #define IOCTL_MFC_FREE_BUF			(0x00800011)
@@ -379,6 +382,10 @@ struct mfc_mem_free_arg {
 };
 /* RMVME */
 
+struct mfc_eventfd_arg {
+	int fd;		/* [IN] signalled per finished queued job, -1: none */
+};
+
 union mfc_args {
 	/*
 	struct mfc_enc_init_arg enc_init;
@@ -404,6 +411,8 @@ union mfc_args {
 	struct mfc_mem_alloc_arg mem_alloc;
 	struct mfc_mem_free_arg mem_free;
 	/* RMVME */
+
+	struct mfc_eventfd_arg eventfd;
 };
 
 struct mfc_common_args {
@@ -0,0 +1,300 @@
+/*
+ * linux/drivers/media/video/samsung/mfc5x/mfc_region.c
+ *
+ * Copyright (c) 2010 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * Free space index of an MFC memory port
+ *
+ * Allocations take the smallest free block the aligned buffer fits in,
+ * the padding in front of the buffer stays free. Frees merge the range
+ * with the free blocks right before and after it. Both only depend on
+ * the rbtree and kmalloc, tools/mfc-buf-test runs them in userspace.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include "mfc_region.h"
+
+struct mfc_region_block {
+	struct rb_node addr_node;
+	struct rb_node size_node;
+	unsigned long start;
+	unsigned long size;
+};
+
+static void mfc_region_insert_addr(struct mfc_region *region,
+				   struct mfc_region_block *blk)
+{
+	struct rb_node **p = &region->addr_root.rb_node;
+	struct rb_node *parent = NULL;
+	struct mfc_region_block *b;
+
+	while (*p) {
+		parent = *p;
+		b = rb_entry(parent, struct mfc_region_block, addr_node);
+		if (blk->start < b->start)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&blk->addr_node, parent, p);
+	rb_insert_color(&blk->addr_node, &region->addr_root);
+}
+
+/* by size, then by address so that equal blocks are taken low to high */
+static void mfc_region_insert_size(struct mfc_region *region,
+				   struct mfc_region_block *blk)
+{
+	struct rb_node **p = &region->size_root.rb_node;
+	struct rb_node *parent = NULL;
+	struct mfc_region_block *b;
+
+	while (*p) {
+		parent = *p;
+		b = rb_entry(parent, struct mfc_region_block, size_node);
+		if (blk->size < b->size ||
+		    (blk->size == b->size && blk->start < b->start))
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&blk->size_node, parent, p);
+	rb_insert_color(&blk->size_node, &region->size_root);
+}
+
+static void mfc_region_insert(struct mfc_region *region,
+			      struct mfc_region_block *blk)
+{
+	mfc_region_insert_addr(region, blk);
+	mfc_region_insert_size(region, blk);
+	region->blocks++;
+}
+
+static void mfc_region_erase(struct mfc_region *region,
+			     struct mfc_region_block *blk)
+{
+	rb_erase(&blk->addr_node, &region->addr_root);
+	rb_erase(&blk->size_node, &region->size_root);
+	region->blocks--;
+}
+
+/* the block keeps its place by address, only its size changed */
+static void mfc_region_resize(struct mfc_region *region,
+			      struct mfc_region_block *blk)
+{
+	rb_erase(&blk->size_node, &region->size_root);
+	mfc_region_insert_size(region, blk);
+}
+
+/* the smallest free block of at least @size bytes */
+static struct mfc_region_block *mfc_region_fit(struct mfc_region *region,
+					       unsigned long size)
+{
+	struct rb_node *node = region->size_root.rb_node;
+	struct mfc_region_block *b, *best = NULL;
+
+	while (node) {
+		b = rb_entry(node, struct mfc_region_block, size_node);
+		if (b->size >= size) {
+			best = b;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+
+	return best;
+}
+
+int mfc_region_init(struct mfc_region *region,
+		    unsigned long base, unsigned long size)
+{
+	struct mfc_region_block *blk;
+
+	memset(region, 0, sizeof(*region));
+	region->addr_root = RB_ROOT;
+	region->size_root = RB_ROOT;
+	region->base = base;
+	region->size = size;
+
+	if (!size)
+		return 0;
+
+	blk = kmalloc(sizeof(*blk), GFP_KERNEL);
+	if (unlikely(blk == NULL))
+		return -ENOMEM;
+
+	blk->start = base;
+	blk->size = size;
+	mfc_region_insert(region, blk);
+	region->free = size;
+
+	return 0;
+}
+
+void mfc_region_final(struct mfc_region *region)
+{
+	struct mfc_region_block *blk;
+	struct rb_node *node;
+
+	while ((node = rb_first(&region->addr_root)) != NULL) {
+		blk = rb_entry(node, struct mfc_region_block, addr_node);
+		mfc_region_erase(region, blk);
+		kfree(blk);
+	}
+	region->free = 0;
+}
+
+/**
+ * mfc_region_alloc - allocate from a region
+ * @region: the region
+ * @size: bytes to allocate
+ * @align: alignment of the start, a power of 2
+ *
+ * Returns the start of the allocation or 0 if it did not fit.
+ */
+unsigned long mfc_region_alloc(struct mfc_region *region,
+			       unsigned long size, unsigned long align)
+{
+	struct mfc_region_block *blk, *head = NULL;
+	struct rb_node *node;
+	unsigned long start = 0, pad = 0;
+
+	if (!align)
+		align = 1;
+	if (!size || (align & (align - 1)))
+		goto fail;
+
+	/*
+	 * Past the best fit only blocks of less than size + align bytes may
+	 * be too short once aligned, a larger one always fits.
+	 */
+	for (blk = mfc_region_fit(region, size); blk != NULL; ) {
+		region->probes++;
+		start = ALIGN(blk->start, align);
+		pad = start - blk->start;
+		if (blk->size >= pad + size)
+			break;
+
+		node = rb_next(&blk->size_node);
+		blk = node ? rb_entry(node, struct mfc_region_block,
+				      size_node) : NULL;
+	}
+	if (blk == NULL)
+		goto fail;
+
+	if (pad) {
+		head = kmalloc(sizeof(*head), GFP_KERNEL);
+		if (unlikely(head == NULL))
+			goto fail;
+	}
+
+	mfc_region_erase(region, blk);
+	if (head != NULL) {
+		head->start = blk->start;
+		head->size = pad;
+		mfc_region_insert(region, head);
+	}
+
+	blk->start = start + size;
+	blk->size -= pad + size;
+	if (blk->size)
+		mfc_region_insert(region, blk);
+	else
+		kfree(blk);
+
+	region->free -= size;
+	region->allocs++;
+
+	return start;
+
+fail:
+	region->fails++;
+
+	return 0;
+}
+
+/**
+ * mfc_region_free - give a range back to a region
+ * @region: the region
+ * @start: start of the range
+ * @size: its size
+ *
+ * Returns -EINVAL if the range is not in the region or partly free
+ * already, -ENOMEM if it merges with no free block and no new block
+ * could be allocated for it.
+ */
+int mfc_region_free(struct mfc_region *region,
+		    unsigned long start, unsigned long size)
+{
+	struct rb_node *node = region->addr_root.rb_node;
+	struct mfc_region_block *b, *prev = NULL, *next = NULL;
+	int merge_prev, merge_next;
+
+	if (!size || start < region->base ||
+	    start + size > region->base + region->size)
+		return -EINVAL;
+
+	while (node) {
+		b = rb_entry(node, struct mfc_region_block, addr_node);
+		if (b->start < start) {
+			prev = b;
+			node = node->rb_right;
+		} else {
+			next = b;
+			node = node->rb_left;
+		}
+	}
+
+	if ((prev && prev->start + prev->size > start) ||
+	    (next && start + size > next->start))
+		return -EINVAL;
+
+	merge_prev = prev && prev->start + prev->size == start;
+	merge_next = next && start + size == next->start;
+
+	if (merge_prev && merge_next) {
+		mfc_region_erase(region, next);
+		prev->size += size + next->size;
+		mfc_region_resize(region, prev);
+		kfree(next);
+	} else if (merge_prev) {
+		prev->size += size;
+		mfc_region_resize(region, prev);
+	} else if (merge_next) {
+		next->start = start;
+		next->size += size;
+		mfc_region_resize(region, next);
+	} else {
+		b = kmalloc(sizeof(*b), GFP_KERNEL);
+		if (unlikely(b == NULL))
+			return -ENOMEM;
+
+		b->start = start;
+		b->size = size;
+		mfc_region_insert(region, b);
+	}
+
+	region->free += size;
+	region->frees++;
+
+	return 0;
+}
+
+unsigned long mfc_region_largest(struct mfc_region *region)
+{
+	struct rb_node *node = rb_last(&region->size_root);
+
+	if (node == NULL)
+		return 0;
+
+	return rb_entry(node, struct mfc_region_block, size_node)->size;
+}
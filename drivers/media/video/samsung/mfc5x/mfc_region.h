@@ -0,0 +1,48 @@
+/*
+ * linux/drivers/media/video/samsung/mfc5x/mfc_region.h
+ *
+ * Copyright (c) 2010 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * Free space index of an MFC memory port
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef __MFC_REGION_H_
+#define __MFC_REGION_H_ __FILE__
+
+#include <linux/rbtree.h>
+
+/*
+ * The free blocks of a region are kept in two trees: by address to find
+ * the neighbours a freed range merges with, by size to find the smallest
+ * block a buffer fits in. The caller serializes the calls on a region.
+ */
+struct mfc_region {
+	struct rb_root addr_root;
+	struct rb_root size_root;
+	unsigned long base;
+	unsigned long size;
+	unsigned long free;	/* bytes free */
+	unsigned int blocks;	/* free blocks */
+
+	/* statistics */
+	unsigned long allocs;
+	unsigned long fails;
+	unsigned long frees;
+	unsigned long probes;	/* free blocks looked at by allocations */
+};
+
+int mfc_region_init(struct mfc_region *region,
+		    unsigned long base, unsigned long size);
+void mfc_region_final(struct mfc_region *region);
+unsigned long mfc_region_alloc(struct mfc_region *region,
+			       unsigned long size, unsigned long align);
+int mfc_region_free(struct mfc_region *region,
+		    unsigned long start, unsigned long size);
+unsigned long mfc_region_largest(struct mfc_region *region);
+
+#endif /* __MFC_REGION_H_ */
@@ -0,0 +1,170 @@
+/*
+ * linux/drivers/media/video/samsung/mfc5x/mfc_sched.c
+ *
+ * Copyright (c) 2010 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * Job scheduler for Samsung MFC (Multi Function Codec - FIMV) driver
+ *
+ * Only keeps the order the jobs run in, the caller runs them and does the
+ * locking. Depends on nothing but the list helpers, tools/mfc-sched-test
+ * runs it against a simulated codec in userspace.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/errno.h>
+
+#include "mfc_sched.h"
+
+void mfc_sched_init(struct mfc_sched *sched)
+{
+	INIT_LIST_HEAD(&sched->ready);
+	sched->running = NULL;
+
+	sched->submits = 0;
+	sched->rejects = 0;
+	sched->runs = 0;
+	sched->cancels = 0;
+}
+
+void mfc_sched_queue_init(struct mfc_sched_queue *queue, unsigned int depth)
+{
+	INIT_LIST_HEAD(&queue->turn);
+	INIT_LIST_HEAD(&queue->pending);
+	INIT_LIST_HEAD(&queue->done);
+	queue->running = NULL;
+	queue->depth = depth;
+	queue->queued = 0;
+	queue->seq = 0;
+}
+
+/**
+ * mfc_sched_submit - queue a job behind the others of its queue
+ * @sched: the scheduler
+ * @queue: queue of the instance
+ * @job: the job
+ *
+ * Returns -EBUSY if the queue already holds as many jobs as it may.
+ */
+int mfc_sched_submit(struct mfc_sched *sched, struct mfc_sched_queue *queue,
+		     struct mfc_job *job)
+{
+	if (mfc_sched_full(queue)) {
+		sched->rejects++;
+		return -EBUSY;
+	}
+
+	job->queue = queue;
+	job->seq = queue->seq++;
+	job->ret = 0;
+
+	/* a queue waiting for its turn already is on the ready list */
+	if (list_empty(&queue->pending))
+		list_add_tail(&queue->turn, &sched->ready);
+	list_add_tail(&job->list, &queue->pending);
+	queue->queued++;
+	sched->submits++;
+
+	return 0;
+}
+
+/**
+ * mfc_sched_next - take the job to run next
+ * @sched: the scheduler
+ *
+ * Returns NULL while a job is running or if none is pending. Otherwise
+ * the first job of the queue whose turn it is, the queue goes to the end
+ * of the ready list if it has more.
+ */
+struct mfc_job *mfc_sched_next(struct mfc_sched *sched)
+{
+	struct mfc_sched_queue *queue;
+	struct mfc_job *job;
+
+	if (sched->running || list_empty(&sched->ready))
+		return NULL;
+
+	queue = list_first_entry(&sched->ready, struct mfc_sched_queue, turn);
+	job = list_first_entry(&queue->pending, struct mfc_job, list);
+	list_del_init(&job->list);
+
+	list_del_init(&queue->turn);
+	if (!list_empty(&queue->pending))
+		list_add_tail(&queue->turn, &sched->ready);
+
+	queue->running = job;
+	sched->running = job;
+	sched->runs++;
+
+	return job;
+}
+
+/**
+ * mfc_sched_complete - account for the end of the running job
+ * @sched: the scheduler
+ * @job: the job mfc_sched_next() returned
+ * @ret: its result, kept in the job
+ */
+void mfc_sched_complete(struct mfc_sched *sched, struct mfc_job *job, int ret)
+{
+	struct mfc_sched_queue *queue = job->queue;
+
+	job->ret = ret;
+	list_add_tail(&job->list, &queue->done);
+	queue->running = NULL;
+	sched->running = NULL;
+}
+
+/**
+ * mfc_sched_collect - take the oldest done job of a queue
+ * @queue: the queue
+ *
+ * Returns NULL if no job is done. The job no longer counts against the
+ * depth of the queue.
+ */
+struct mfc_job *mfc_sched_collect(struct mfc_sched_queue *queue)
+{
+	struct mfc_job *job;
+
+	if (list_empty(&queue->done))
+		return NULL;
+
+	job = list_first_entry(&queue->done, struct mfc_job, list);
+	list_del_init(&job->list);
+	queue->queued--;
+
+	return job;
+}
+
+/**
+ * mfc_sched_cancel - take all jobs off a queue
+ * @sched: the scheduler
+ * @queue: the queue
+ * @jobs: the pending and done jobs are moved to this list
+ *
+ * Returns 1 if a job of the queue is running. It can not be taken back,
+ * once completed the caller has to collect it.
+ */
+int mfc_sched_cancel(struct mfc_sched *sched, struct mfc_sched_queue *queue,
+		     struct list_head *jobs)
+{
+	struct mfc_job *job;
+
+	list_del_init(&queue->turn);
+
+	list_for_each_entry(job, &queue->pending, list) {
+		queue->queued--;
+		sched->cancels++;
+	}
+	list_splice_tail_init(&queue->pending, jobs);
+
+	list_for_each_entry(job, &queue->done, list)
+		queue->queued--;
+	list_splice_tail_init(&queue->done, jobs);
+
+	return queue->running != NULL;
+}
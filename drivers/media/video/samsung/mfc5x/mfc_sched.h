@@ -0,0 +1,78 @@
+/*
+ * linux/drivers/media/video/samsung/mfc5x/mfc_sched.h
+ *
+ * Copyright (c) 2010 Samsung Electronics Co., Ltd.
+ *		http://www.samsung.com/
+ *
+ * Job scheduler for Samsung MFC (Multi Function Codec - FIMV) driver
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef __MFC_SCHED_H_
+#define __MFC_SCHED_H_ __FILE__
+
+#include <linux/list.h>
+
+struct mfc_sched_queue;
+
+struct mfc_job {
+	struct list_head list;
+	struct mfc_sched_queue *queue;
+	unsigned long seq;		/* submission order of the queue */
+	int ret;			/* what the backend returned */
+};
+
+/*
+ * The jobs of one instance. A job counts against the depth from its
+ * submission until it is collected, pending, running or done.
+ */
+struct mfc_sched_queue {
+	struct list_head turn;		/* on mfc_sched.ready */
+	struct list_head pending;
+	struct list_head done;
+	struct mfc_job *running;
+	unsigned int depth;
+	unsigned int queued;
+	unsigned long seq;
+};
+
+/*
+ * The codec runs one job at a time. The queues with pending jobs take
+ * turns, one job each, in the order they became ready. The caller
+ * serializes the calls on a scheduler and its queues.
+ */
+struct mfc_sched {
+	struct list_head ready;
+	struct mfc_job *running;
+
+	/* statistics */
+	unsigned long submits;
+	unsigned long rejects;		/* submitted to a full queue */
+	unsigned long runs;
+	unsigned long cancels;
+};
+
+void mfc_sched_init(struct mfc_sched *sched);
+void mfc_sched_queue_init(struct mfc_sched_queue *queue, unsigned int depth);
+int mfc_sched_submit(struct mfc_sched *sched, struct mfc_sched_queue *queue,
+		     struct mfc_job *job);
+struct mfc_job *mfc_sched_next(struct mfc_sched *sched);
+void mfc_sched_complete(struct mfc_sched *sched, struct mfc_job *job, int ret);
+struct mfc_job *mfc_sched_collect(struct mfc_sched_queue *queue);
+int mfc_sched_cancel(struct mfc_sched *sched, struct mfc_sched_queue *queue,
+		     struct list_head *jobs);
+
+static inline int mfc_sched_full(struct mfc_sched_queue *queue)
+{
+	return queue->queued >= queue->depth;
+}
+
+static inline int mfc_sched_has_done(struct mfc_sched_queue *queue)
+{
+	return !list_empty(&queue->done);
+}
+
+#endif /* __MFC_SCHED_H_ */
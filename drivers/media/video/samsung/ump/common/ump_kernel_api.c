@@ -34,24 +34,32 @@ UMP_KERNEL_API_EXPORT ump_secure_id ump_dd_secure_id_get(ump_dd_handle memh)
 
 
 
+/*
+ * Secure IDs are looked up without secure_id_map_lock. A descriptor whose
+ * reference count already dropped to zero is being released, so the lookup
+ * only succeeds if it can take a reference on a live one. Descriptors are
+ * freed after the lookups that may still see them.
+ */
+static mali_bool ump_dd_mem_get(void * target)
+{
+	ump_dd_mem * mem = (ump_dd_mem *)target;
+
+	return _ump_osk_atomic_inc_not_zero(&mem->ref_count) ? MALI_TRUE : MALI_FALSE;
+}
+
+
+
 UMP_KERNEL_API_EXPORT ump_dd_handle ump_dd_handle_create_from_secure_id(ump_secure_id secure_id)
 {
 	ump_dd_mem * mem;
 
-	_mali_osk_lock_wait(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
-
 	DBG_MSG(5, ("Getting handle from secure ID. ID: %u\n", secure_id));
-	if (0 != ump_descriptor_mapping_get(device.secure_id_map, (int)secure_id, (void**)&mem))
+	if (0 != ump_descriptor_mapping_get_ref(device.secure_id_map, (int)secure_id, (void**)&mem, ump_dd_mem_get))
 	{
-		_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
 		DBG_MSG(1, ("Secure ID not found. ID: %u\n", secure_id));
 		return UMP_DD_HANDLE_INVALID;
 	}
 
-	ump_dd_reference_add(mem);
-
-	_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
-
 	return (ump_dd_handle)mem;
 }
 
@@ -156,12 +164,6 @@ UMP_KERNEL_API_EXPORT void ump_dd_reference_release(ump_dd_handle memh)
 
 	DEBUG_ASSERT_POINTER(mem);
 
-	/* We must hold this mutex while doing the atomic_dec_and_read, to protect
-	that elements in the ump_descriptor_mapping table is always valid.  If they
-	are not, userspace may accidently map in this secure_ids right before its freed
-	giving a mapped backdoor into unallocated memory.*/
-	_mali_osk_lock_wait(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
-
 	new_ref = _ump_osk_atomic_dec_and_read(&mem->ref_count);
 
 	DBG_MSG(4, ("Memory reference decremented. ID: %u, new value: %d\n", mem->secure_id, new_ref));
@@ -170,15 +172,14 @@ UMP_KERNEL_API_EXPORT void ump_dd_reference_release(ump_dd_handle memh)
 	{
 		DBG_MSG(3, ("Final release of memory. ID: %u\n", mem->secure_id));
 
+		/* Lookups can no longer take a reference, see ump_dd_mem_get() */
+		_mali_osk_lock_wait(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
 		ump_descriptor_mapping_free(device.secure_id_map, (int)mem->secure_id);
-
 		_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
+
+		_ump_osk_msync_term(mem);
 		mem->release_func(mem->ctx, mem);
-		_mali_osk_free(mem);
-	}
-	else
-	{
-		_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
+		ump_descriptor_mapping_target_free(device.secure_id_map, mem);
 	}
 }
 
@@ -273,12 +274,12 @@ _mali_osk_errcode_t _ump_ukk_size_get( _ump_uk_size_get_s *user_interaction )
 
 	DEBUG_ASSERT_POINTER( user_interaction );
 
-	/* We lock the mappings so things don't get removed while we are looking for the memory */
-	_mali_osk_lock_wait(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
-	if (0 == ump_descriptor_mapping_get(device.secure_id_map, (int)user_interaction->secure_id, (void**)&mem))
+	/* The reference keeps the memory from being released while we look at it */
+	if (0 == ump_descriptor_mapping_get_ref(device.secure_id_map, (int)user_interaction->secure_id, (void**)&mem, ump_dd_mem_get))
 	{
 		user_interaction->size = mem->size_bytes;
 		DBG_MSG(4, ("Returning size. ID: %u, size: %lu ", (ump_secure_id)user_interaction->secure_id, (unsigned long)user_interaction->size));
+		ump_dd_reference_release(mem);
 		ret = _MALI_OSK_ERR_OK;
 	}
 	else
@@ -287,7 +288,6 @@ _mali_osk_errcode_t _ump_ukk_size_get( _ump_uk_size_get_s *user_interaction )
 		DBG_MSG(1, ("Failed to look up mapping in ump_ioctl_size_get(). ID: %u\n", (ump_secure_id)user_interaction->secure_id));
 	}
 
-	_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
 	return ret;
 }
 
@@ -296,11 +296,8 @@ _mali_osk_errcode_t _ump_ukk_size_get( _ump_uk_size_get_s *user_interaction )
 void _ump_ukk_msync( _ump_uk_msync_s *args )
 {
 	ump_dd_mem * mem = NULL;
-	_mali_osk_lock_wait(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
-	ump_descriptor_mapping_get(device.secure_id_map, (int)args->secure_id, (void**)&mem);
-	_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
 
-	if (NULL==mem)
+	if (0 != ump_descriptor_mapping_get_ref(device.secure_id_map, (int)args->secure_id, (void**)&mem, ump_dd_mem_get))
 	{
 		DBG_MSG(1, ("Failed to look up mapping in _ump_ukk_msync(). ID: %u\n", (ump_secure_id)args->secure_id));
 		return;
@@ -313,17 +310,19 @@ void _ump_ukk_msync( _ump_uk_msync_s *args )
 	if ( _UMP_UK_MSYNC_READOUT_CACHE_ENABLED==args->op )
 	{
 		DBG_MSG(3, ("_ump_ukk_msync READOUT  ID: %u Enabled: %d\n", (ump_secure_id)args->secure_id, mem->is_cached));
-		return;
 	}
-
 	/* Nothing to do if the memory is not caches */
-	if ( 0==mem->is_cached )
+	else if ( 0==mem->is_cached )
 	{
 		DBG_MSG(3, ("_ump_ukk_msync IGNORING ID: %u Enabled: %d  OP: %d\n", (ump_secure_id)args->secure_id, mem->is_cached, args->op));
-		return ;
 	}
-	DBG_MSG(3, ("_ump_ukk_msync FLUSHING ID: %u Enabled: %d  OP: %d\n", (ump_secure_id)args->secure_id, mem->is_cached, args->op));
+	else
+	{
+		DBG_MSG(3, ("_ump_ukk_msync FLUSHING ID: %u Enabled: %d  OP: %d\n", (ump_secure_id)args->secure_id, mem->is_cached, args->op));
+
+		/* The actual cache flush - Implemented for each OS*/
+		_ump_osk_msync( mem , args->op, (u32)args->mapping, (u32)args->address, args->size);
+	}
 
-	/* The actual cache flush - Implemented for each OS*/
-	_ump_osk_msync( mem , args->op, (u32)args->mapping, (u32)args->address, args->size);
+	ump_dd_reference_release(mem);
 }
@@ -17,31 +17,19 @@
 
 #include "mali_osk.h"
 
-/**
- * The actual descriptor mapping table, never directly accessed by clients
- */
-typedef struct ump_descriptor_table
-{
-	u32 * usage; /**< Pointer to bitpattern indicating if a descriptor is valid/used or not */
-	void** mappings; /**< Array of the pointers the descriptors map to */
-} ump_descriptor_table;
-
 /**
  * The descriptor mapping object
  * Provides a separate namespace where we can map an integer to a pointer
  */
 typedef struct ump_descriptor_mapping
 {
-	_mali_osk_lock_t *lock; /**< Lock protecting access to the mapping object */
-	int max_nr_mappings_allowed; /**< Max number of mappings to support in this namespace */
-	int current_nr_mappings; /**< Current number of possible mappings */
-	ump_descriptor_table * table; /**< Pointer to the current mapping table */
+	_mali_osk_idmap_t *idmap; /**< The IDs in use, looked up without a lock */
 } ump_descriptor_mapping;
 
 /**
  * Create a descriptor mapping object
- * Create a descriptor mapping capable of holding init_entries growable to max_entries
- * @param init_entries Number of entries to preallocate memory for
+ * Create a descriptor mapping capable of holding max_entries
+ * @param init_entries Unused, the mapping grows as needed
  * @param max_entries Number of entries to max support
  * @return Pointer to a descriptor mapping object, NULL on failure
  */
@@ -64,6 +52,7 @@ int ump_descriptor_mapping_allocate_mapping(ump_descriptor_mapping * map, void *
 
 /**
  * Get the value mapped to by a descriptor ID
+ * Does not block, and may run concurrently with changes to the map.
  * @param map The map to lookup the descriptor id in
  * @param descriptor The descriptor ID to lookup
  * @param target Pointer to a pointer which will receive the stored value
@@ -71,6 +60,34 @@ int ump_descriptor_mapping_allocate_mapping(ump_descriptor_mapping * map, void *
  */
 int ump_descriptor_mapping_get(ump_descriptor_mapping * map, int descriptor, void** target);
 
+/**
+ * Get the value mapped to by a descriptor ID and take a reference on it
+ * Does not block. get is called where the value cannot be freed, provided
+ * it came from ump_descriptor_mapping_target_calloc(), and must fail once
+ * the value is being released.
+ * @param map The map to lookup the descriptor id in
+ * @param descriptor The descriptor ID to lookup
+ * @param target Pointer to a pointer which will receive the stored value
+ * @param get Takes the reference, MALI_FALSE if the value is going away
+ * @return 0 on successful lookup, negative on error
+ */
+int ump_descriptor_mapping_get_ref(ump_descriptor_mapping * map, int descriptor, void** target, mali_bool (*get)(void *));
+
+/**
+ * Allocate zeroed memory for a value that is looked up with ump_descriptor_mapping_get_ref()
+ * @param size Bytes to allocate
+ * @return The memory, NULL on failure
+ */
+void * ump_descriptor_mapping_target_calloc(u32 size);
+
+/**
+ * Free a value from ump_descriptor_mapping_target_calloc()
+ * The memory is freed once the lookups that may still see the value are done.
+ * @param map The map the value was mapped in
+ * @param target The value to free
+ */
+void ump_descriptor_mapping_target_free(ump_descriptor_mapping * map, void * target);
+
 /**
  * Set the value mapped to by a descriptor ID
  * @param map The map to lookup the descriptor id in
@@ -53,21 +53,24 @@ UMP_KERNEL_API_EXPORT ump_dd_handle ump_dd_handle_create_from_phys_blocks(ump_dd
 	}
 
 	/* Allocate the ump_dd_mem struct for this allocation */
-	mem = _mali_osk_malloc(sizeof(*mem));
+	mem = ump_descriptor_mapping_target_calloc(sizeof(*mem));
 	if (NULL == mem)
 	{
 		DBG_MSG(1, ("Could not allocate ump_dd_mem in ump_dd_handle_create_from_phys_blocks()\n"));
 		return UMP_DD_HANDLE_INVALID;
 	}
 
-	/* Find a secure ID for this allocation */
+	/*
+	 * Find a secure ID for this allocation. Lookups see it from now on, but
+	 * cannot take a reference until ref_count leaves zero at the end.
+	 */
 	_mali_osk_lock_wait(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
 	map_id = ump_descriptor_mapping_allocate_mapping(device.secure_id_map, (void*) mem);
+	_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
 
 	if (map_id < 0)
 	{
-		_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
-		_mali_osk_free(mem);
+		ump_descriptor_mapping_target_free(device.secure_id_map, mem);
 		DBG_MSG(1, ("Failed to allocate secure ID in ump_dd_handle_create_from_phys_blocks()\n"));
 		return UMP_DD_HANDLE_INVALID;
 	}
@@ -76,9 +79,10 @@ UMP_KERNEL_API_EXPORT ump_dd_handle ump_dd_handle_create_from_phys_blocks(ump_dd
 	mem->block_array = _mali_osk_malloc(sizeof(ump_dd_physical_block)* num_blocks);
 	if (NULL == mem->block_array)
 	{
+		_mali_osk_lock_wait(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
 		ump_descriptor_mapping_free(device.secure_id_map, map_id);
 		_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
-		_mali_osk_free(mem);
+		ump_descriptor_mapping_target_free(device.secure_id_map, mem);
 		DBG_MSG(1, ("Could not allocate a mem handle for function ump_dd_handle_create_from_phys_blocks().\n"));
 		return UMP_DD_HANDLE_INVALID;
 	}
@@ -86,7 +90,6 @@ UMP_KERNEL_API_EXPORT ump_dd_handle ump_dd_handle_create_from_phys_blocks(ump_dd
 	_mali_osk_memcpy(mem->block_array, blocks, sizeof(ump_dd_physical_block) * num_blocks);
 
 	/* And setup the rest of the ump_dd_mem struct */
-	_mali_osk_atomic_init(&mem->ref_count, 1);
 	mem->secure_id = (ump_secure_id)map_id;
 	mem->size_bytes = size_total;
 	mem->nr_blocks = num_blocks;
@@ -95,8 +98,10 @@ UMP_KERNEL_API_EXPORT ump_dd_handle ump_dd_handle_create_from_phys_blocks(ump_dd
 	mem->release_func = phys_blocks_release;
 	/* For now UMP handles created by ump_dd_handle_create_from_phys_blocks() is forced to be Uncached */
 	mem->is_cached = 0;
+	_ump_osk_msync_init(mem);
 
-	_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
+	/* Publish it, this orders the setup above before any lookup's reference */
+	_ump_osk_atomic_inc_and_read(&mem->ref_count);
 	DBG_MSG(3, ("UMP memory created. ID: %u, size: %lu\n", mem->secure_id, mem->size_bytes));
 
 	return (ump_dd_handle)mem;
@@ -128,7 +133,7 @@ _mali_osk_errcode_t _ump_ukk_allocate( _ump_uk_allocate_s *user_interaction )
 	}
 
 
-	new_allocation = _mali_osk_calloc( 1, sizeof(ump_dd_mem));
+	new_allocation = ump_descriptor_mapping_target_calloc(sizeof(ump_dd_mem));
 	if (NULL==new_allocation)
 	{
 		_mali_osk_free(session_memory_element);
@@ -136,22 +141,21 @@ _mali_osk_errcode_t _ump_ukk_allocate( _ump_uk_allocate_s *user_interaction )
 		return _MALI_OSK_ERR_NOMEM;
 	}
 
-	/* Create a secure ID for this allocation */
+	/* Create a secure ID for this allocation, ref_count stays zero until it is set up */
 	_mali_osk_lock_wait(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
 	map_id = ump_descriptor_mapping_allocate_mapping(device.secure_id_map, (void*)new_allocation);
+	_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
 
 	if (map_id < 0)
 	{
-		_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
 		_mali_osk_free(session_memory_element);
-		_mali_osk_free(new_allocation);
+		ump_descriptor_mapping_target_free(device.secure_id_map, new_allocation);
 		DBG_MSG(1, ("Failed to allocate secure ID in ump_ioctl_allocate()\n"));
 		return - _MALI_OSK_ERR_INVALID_FUNC;
 	}
 
 	/* Initialize the part of the new_allocation that we know so for */
 	new_allocation->secure_id = (ump_secure_id)map_id;
-	_mali_osk_atomic_init(&new_allocation->ref_count,1);
 	if ( 0==(UMP_REF_DRV_UK_CONSTRAINT_USE_CACHE & user_interaction->constraints) )
 		 new_allocation->is_cached = 0;
 	else new_allocation->is_cached = 1;
@@ -170,17 +174,20 @@ _mali_osk_errcode_t _ump_ukk_allocate( _ump_uk_allocate_s *user_interaction )
 	if (!device.backend->allocate( device.backend->ctx, new_allocation ) )
 	{
 		DBG_MSG(3, ("OOM: No more UMP memory left. Failed to allocate memory in ump_ioctl_allocate(). Size: %lu, requested size: %lu\n", new_allocation->size_bytes, (unsigned long)user_interaction->size));
+		_mali_osk_lock_wait(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
 		ump_descriptor_mapping_free(device.secure_id_map, map_id);
 		_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
-		_mali_osk_free(new_allocation);
+		ump_descriptor_mapping_target_free(device.secure_id_map, new_allocation);
 		_mali_osk_free(session_memory_element);
 		return _MALI_OSK_ERR_INVALID_FUNC;
 	}
 
 	new_allocation->ctx = device.backend->ctx;
 	new_allocation->release_func = device.backend->release;
+	_ump_osk_msync_init(new_allocation);
 
-	_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
+	/* Publish it, this orders the setup above before any lookup's reference */
+	_ump_osk_atomic_inc_and_read(&new_allocation->ref_count);
 
 	/* Initialize the session_memory_element, and add it to the session object */
 	session_memory_element->mem = new_allocation;
@@ -204,19 +211,15 @@ UMP_KERNEL_API_EXPORT ump_dd_status_code ump_dd_meminfo_set(ump_dd_handle memh,
 
 	secure_id = ump_dd_secure_id_get(memh);
 
-	_mali_osk_lock_wait(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
-	if (0 == ump_descriptor_mapping_get(device.secure_id_map, (int)secure_id, (void**)&mem))
-	{
-		device.backend->set(mem, args);
-	}
-	else
+	mem = (ump_dd_mem *)ump_dd_handle_create_from_secure_id(secure_id);
+	if (UMP_DD_HANDLE_INVALID == (ump_dd_handle)mem)
 	{
-		_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
 		DBG_MSG(1, ("Failed to look up mapping in ump_meminfo_set(). ID: %u\n", (ump_secure_id)secure_id));
 		return UMP_DD_INVALID;
 	}
 
-	_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
+	device.backend->set(mem, args);
+	ump_dd_reference_release(mem);
 
 	return UMP_DD_SUCCESS;
 }
@@ -226,19 +229,15 @@ UMP_KERNEL_API_EXPORT void *ump_dd_meminfo_get(ump_secure_id secure_id, void* ar
 	ump_dd_mem * mem;
 	void *result;
 
-	_mali_osk_lock_wait(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
-	if (0 == ump_descriptor_mapping_get(device.secure_id_map, (int)secure_id, (void**)&mem))
+	mem = (ump_dd_mem *)ump_dd_handle_create_from_secure_id(secure_id);
+	if (UMP_DD_HANDLE_INVALID == (ump_dd_handle)mem)
 	{
-		result = device.backend->get(mem, args);
-	}
-	else
-	{
-		_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
 		DBG_MSG(1, ("Failed to look up mapping in ump_meminfo_get(). ID: %u\n", (ump_secure_id)secure_id));
 		return UMP_DD_HANDLE_INVALID;
 	}
 
-	_mali_osk_lock_signal(device.secure_id_map_lock, _MALI_OSK_LOCKMODE_RW);
+	result = device.backend->get(mem, args);
+	ump_dd_reference_release(mem);
 
 	return result;
 }
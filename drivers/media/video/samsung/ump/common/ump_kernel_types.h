@@ -28,6 +28,7 @@ typedef struct ump_dd_mem
 	void * ctx;
 	void * backend_info;
 	int is_cached;
+	void * sync_info;  /**< CPU access tracking of the OS layer, NULL if none */
 } ump_dd_mem;
 
 
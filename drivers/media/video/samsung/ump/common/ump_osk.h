@@ -33,6 +33,8 @@ int _ump_osk_atomic_inc_and_read( _mali_osk_atomic_t *atom );
 
 int _ump_osk_atomic_dec_and_read( _mali_osk_atomic_t *atom );
 
+int _ump_osk_atomic_inc_not_zero( _mali_osk_atomic_t *atom );
+
 _mali_osk_errcode_t _ump_osk_mem_mapregion_init( ump_memory_allocation *descriptor );
 
 _mali_osk_errcode_t _ump_osk_mem_mapregion_map( ump_memory_allocation * descriptor, u32 offset, u32 * phys_addr, unsigned long size );
@@ -41,6 +43,10 @@ void _ump_osk_mem_mapregion_term( ump_memory_allocation * descriptor );
 
 void _ump_osk_msync( ump_dd_mem * mem, ump_uk_msync_op op,  u32 start, u32 address, u32 size);
 
+void _ump_osk_msync_init( ump_dd_mem * mem );
+
+void _ump_osk_msync_term( ump_dd_mem * mem );
+
 void _ump_osk_mem_mapregion_get( ump_dd_mem ** mem, unsigned long vaddr);
 
 #ifdef __cplusplus
@@ -58,6 +58,9 @@ typedef enum
 {
 	_UMP_UK_MSYNC_CLEAN = 0,
 	_UMP_UK_MSYNC_CLEAN_AND_INVALIDATE = 1,
+	_UMP_UK_MSYNC_BEGIN_CPU_ACCESS = 2,     /**< the CPU is about to access [address, address+size) */
+	_UMP_UK_MSYNC_END_CPU_ACCESS = 3,       /**< the CPU is done with [address, address+size) */
+	_UMP_UK_MSYNC_CPU_WRITE = 64,           /**< or'ed to the two above when the CPU writes */
 	_UMP_UK_MSYNC_READOUT_CACHE_ENABLED = 128,
 } ump_uk_msync_op;
 
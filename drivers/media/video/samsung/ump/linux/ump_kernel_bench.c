@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2010 ARM Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation, and any use by you of this program is subject to the terms of such GNU licence.
+ *
+ * A copy of the licence is included with the program, and can also be obtained from Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * @file ump_kernel_bench.c
+ * Secure ID allocation and lookup throughput
+ *
+ * Creates a number of UMP handles the way gralloc buffers are created, then
+ * looks random secure IDs up from one thread per online CPU, the way drivers
+ * resolve them on every frame. Load it on two kernels to compare them:
+ *
+ *     insmod ump_kernel_bench.ko handles=512 lookups=200000
+ *     echo 1 > /sys/module/ump_kernel_bench/parameters/run
+ */
+
+#include <linux/completion.h>
+#include <linux/cpumask.h>
+#include <linux/gfp.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <asm/atomic.h>
+
+#include "ump_kernel_interface_ref_drv.h"
+
+static unsigned int handles = 512;
+module_param(handles, uint, 0644);
+MODULE_PARM_DESC(handles, "Number of UMP handles alive during the lookups");
+
+static unsigned int lookups = 100000;
+module_param(lookups, uint, 0644);
+MODULE_PARM_DESC(lookups, "Number of secure ID lookups per thread");
+
+static DEFINE_MUTEX(bench_mutex);
+
+struct bench_lookup
+{
+	ump_secure_id *ids;
+	atomic_t running;
+	struct completion done;
+	u64 ns;
+	unsigned long failed;
+	spinlock_t lock;
+};
+
+static int bench_lookup_thread(void *data)
+{
+	struct bench_lookup *b = data;
+	unsigned long failed = 0;
+	ump_dd_handle h;
+	ktime_t t;
+	u64 ns;
+	unsigned int i;
+
+	t = ktime_get();
+	for (i = 0; i < lookups; i++)
+	{
+		h = ump_dd_handle_create_from_secure_id(b->ids[random32() % handles]);
+		if (UMP_DD_HANDLE_INVALID == h)
+		{
+			failed++;
+			continue;
+		}
+		ump_dd_reference_release(h);
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), t));
+
+	spin_lock(&b->lock);
+	b->ns += ns;
+	b->failed += failed;
+	spin_unlock(&b->lock);
+
+	if (atomic_dec_and_test(&b->running))
+		complete(&b->done);
+	return 0;
+}
+
+static int ump_bench_run(void)
+{
+	ump_dd_physical_block block;
+	ump_dd_handle *h;
+	struct bench_lookup b;
+	struct page *page;
+	unsigned int i, created = 0, threads = 0;
+	int cpu, ret = 0;
+	u64 alloc_ns, free_ns;
+	ktime_t t;
+
+	if (0 == handles) return -EINVAL;
+
+	h = kcalloc(handles, sizeof(*h), GFP_KERNEL);
+	b.ids = kcalloc(handles, sizeof(*b.ids), GFP_KERNEL);
+	page = alloc_page(GFP_KERNEL);
+	if (NULL == h || NULL == b.ids || NULL == page)
+	{
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	/* every handle describes the same page, only the IDs matter here */
+	block.addr = page_to_phys(page);
+	block.size = PAGE_SIZE;
+
+	mutex_lock(&bench_mutex);
+
+	t = ktime_get();
+	for (created = 0; created < handles; created++)
+	{
+		h[created] = ump_dd_handle_create_from_phys_blocks(&block, 1);
+		if (UMP_DD_HANDLE_INVALID == h[created]) break;
+		b.ids[created] = ump_dd_secure_id_get(h[created]);
+	}
+	alloc_ns = ktime_to_ns(ktime_sub(ktime_get(), t));
+
+	if (created < handles)
+	{
+		printk(KERN_ERR "ump_bench: only %u of %u handles created\n", created, handles);
+		ret = -ENOMEM;
+		goto release;
+	}
+
+	atomic_set(&b.running, 1);
+	init_completion(&b.done);
+	spin_lock_init(&b.lock);
+	b.ns = 0;
+	b.failed = 0;
+	for_each_online_cpu(cpu)
+	{
+		struct task_struct *task;
+
+		task = kthread_create(bench_lookup_thread, &b, "ump_bench/%d", cpu);
+		if (IS_ERR(task)) continue;
+		kthread_bind(task, cpu);
+		atomic_inc(&b.running);
+		threads++;
+		wake_up_process(task);
+	}
+	if (atomic_dec_and_test(&b.running))
+		complete(&b.done);
+	wait_for_completion(&b.done);
+
+	printk(KERN_INFO "ump_bench: %u handles: alloc %llu ns/id, "
+	       "lookup %llu ns/id on %u threads (%lu failed)\n",
+	       handles, div_u64(alloc_ns, handles),
+	       threads ? div_u64(b.ns, (u64)threads * lookups) : 0ULL,
+	       threads, b.failed);
+
+release:
+	t = ktime_get();
+	for (i = 0; i < created; i++)
+		ump_dd_reference_release(h[i]);
+	free_ns = ktime_to_ns(ktime_sub(ktime_get(), t));
+	if (created)
+		printk(KERN_INFO "ump_bench: free %llu ns/id\n", div_u64(free_ns, created));
+
+	mutex_unlock(&bench_mutex);
+out:
+	if (page) __free_page(page);
+	kfree(b.ids);
+	kfree(h);
+	return ret;
+}
+
+static int ump_bench_param_run(const char *val, struct kernel_param *kp)
+{
+	return ump_bench_run();
+}
+
+module_param_call(run, ump_bench_param_run, NULL, NULL, 0200);
+MODULE_PARM_DESC(run, "Write anything to run the benchmark again");
+
+static int __init ump_bench_init(void)
+{
+	return ump_bench_run();
+}
+module_init(ump_bench_init);
+
+static void __exit ump_bench_exit(void)
+{
+	/* nop, every run releases what it created */
+}
+module_exit(ump_bench_exit);
+
+MODULE_DESCRIPTION("UMP secure ID allocation and lookup benchmark");
+MODULE_LICENSE("GPL");
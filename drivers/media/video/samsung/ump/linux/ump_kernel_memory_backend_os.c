@@ -17,22 +17,59 @@
 #include <asm/semaphore.h>
 #endif
 
+#include <linux/debugfs.h>
 #include <linux/dma-mapping.h>
+#include <linux/list.h>
 #include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <asm/atomic.h>
 #include <linux/vmalloc.h>
 #include <asm/cacheflush.h>
+#include <asm/outercache.h>
 #include "ump_kernel_common.h"
 #include "ump_kernel_memory_backend.h"
 
 
 
+/*
+ * Released blocks are zeroed, flushed out of the caches and kept on a pool,
+ * so that the next allocation can hand them out as they are whatever its
+ * caching. Buffers of 64K and more are built from 64K blocks where possible,
+ * which the SYSMMU and the Mali MMU map with fewer entries. The pool gives
+ * its pages back to the system under memory pressure.
+ */
+#define UMP_OS_HIGH_ORDER 4
+#define UMP_OS_POOL_ORDERS 2
+
+static const unsigned int ump_os_pool_order[UMP_OS_POOL_ORDERS] = { UMP_OS_HIGH_ORDER, 0 };
+
+static unsigned int ump_os_pool_pages = 1024;
+module_param(ump_os_pool_pages, uint, S_IRUGO | S_IWUSR); /* rw-r--r-- */
+MODULE_PARM_DESC(ump_os_pool_pages, "Number of released pages the OS memory backend keeps for reuse");
+
 typedef struct os_allocator
 {
 	struct semaphore mutex;
 	u32 num_pages_max;       /**< Maximum number of pages to allocate from the OS */
 	u32 num_pages_allocated; /**< Number of pages allocated from the OS */
+
+	spinlock_t pool_lock;
+	struct list_head pool[UMP_OS_POOL_ORDERS]; /**< Clean blocks of each ump_os_pool_order, linked by page->lru */
+	u32 pool_pages;          /**< Number of pages on the pools */
+	struct shrinker shrinker;
+
+	/* statistics, under pool_lock */
+	unsigned long pool_hits;
+	unsigned long pool_misses;
+	unsigned long high_order_allocs;
+	unsigned long high_order_fallbacks;
+	unsigned long pool_shrunk;
+	unsigned long alloc_failures;
+
+	struct dentry *debugfs_dir;
 } os_allocator;
 
 
@@ -40,6 +77,8 @@ typedef struct os_allocator
 static void os_free(void* ctx, ump_dd_mem * descriptor);
 static int os_allocate(void* ctx, ump_dd_mem * descriptor);
 static void os_memory_backend_destroy(ump_memory_backend * backend);
+static int os_pool_shrink(struct shrinker *shrinker, int nr_to_scan, gfp_t gfp_mask);
+static void os_debugfs_init(os_allocator * info);
 
 
 
@@ -50,8 +89,9 @@ ump_memory_backend * ump_os_memory_backend_create(const int max_allocation)
 {
 	ump_memory_backend * backend;
 	os_allocator * info;
+	int i;
 
-	info = kmalloc(sizeof(os_allocator), GFP_KERNEL);
+	info = kzalloc(sizeof(os_allocator), GFP_KERNEL);
 	if (NULL == info)
 	{
 		return NULL;
@@ -62,6 +102,12 @@ ump_memory_backend * ump_os_memory_backend_create(const int max_allocation)
 
 	init_MUTEX(&info->mutex);
 
+	spin_lock_init(&info->pool_lock);
+	for (i = 0; i < UMP_OS_POOL_ORDERS; i++)
+	{
+		INIT_LIST_HEAD(&info->pool[i]);
+	}
+
 	backend = kmalloc(sizeof(ump_memory_backend), GFP_KERNEL);
 	if (NULL == backend)
 	{
@@ -78,20 +124,199 @@ ump_memory_backend * ump_os_memory_backend_create(const int max_allocation)
 	backend->get = NULL;
 	backend->set = NULL;
 
+	info->shrinker.shrink = os_pool_shrink;
+	info->shrinker.seeks = DEFAULT_SEEKS;
+	register_shrinker(&info->shrinker);
+
+	os_debugfs_init(info);
+
 	return backend;
 }
 
 
 
+/*
+ * Take up to nr_pages pages off the pools, the caller frees them
+ */
+static u32 os_pool_drain(os_allocator * info, struct list_head * pages, u32 nr_pages)
+{
+	struct page * page;
+	u32 drained = 0;
+	int i;
+
+	spin_lock(&info->pool_lock);
+	for (i = 0; i < UMP_OS_POOL_ORDERS && drained < nr_pages; i++)
+	{
+		while (drained < nr_pages && !list_empty(&info->pool[i]))
+		{
+			page = list_first_entry(&info->pool[i], struct page, lru);
+			list_move(&page->lru, pages);
+			drained += 1 << ump_os_pool_order[i];
+		}
+	}
+	info->pool_pages -= drained;
+	spin_unlock(&info->pool_lock);
+
+	return drained;
+}
+
+static void os_pool_free_pages(struct list_head * pages)
+{
+	struct page * page, * tmp;
+
+	list_for_each_entry_safe(page, tmp, pages, lru)
+	{
+		list_del(&page->lru);
+		__free_pages(page, page_private(page));
+	}
+}
+
+static int os_pool_shrink(struct shrinker *shrinker, int nr_to_scan, gfp_t gfp_mask)
+{
+	os_allocator * info = container_of(shrinker, os_allocator, shrinker);
+	LIST_HEAD(pages);
+	u32 drained;
+
+	if (nr_to_scan > 0)
+	{
+		drained = os_pool_drain(info, &pages, nr_to_scan);
+		os_pool_free_pages(&pages);
+
+		spin_lock(&info->pool_lock);
+		info->pool_shrunk += drained;
+		spin_unlock(&info->pool_lock);
+	}
+
+	return info->pool_pages;
+}
+
+/*
+ * Get a clean, zeroed block of the given pool
+ */
+static struct page * os_pool_get(os_allocator * info, int pool)
+{
+	struct page * page = NULL;
+
+	spin_lock(&info->pool_lock);
+	if (!list_empty(&info->pool[pool]))
+	{
+		page = list_first_entry(&info->pool[pool], struct page, lru);
+		list_del(&page->lru);
+		set_page_private(page, 0);
+		info->pool_pages -= 1 << ump_os_pool_order[pool];
+		info->pool_hits++;
+	}
+	else
+	{
+		info->pool_misses++;
+	}
+	spin_unlock(&info->pool_lock);
+
+	return page;
+}
+
+/*
+ * Give back a block, to the pool if it has room for it
+ */
+static void os_pool_put(os_allocator * info, struct page * page, int pool, int is_cached)
+{
+	unsigned int order = ump_os_pool_order[pool];
+	unsigned long size = PAGE_SIZE << order;
+	void * virt = page_address(page);
+	u32 phys = page_to_phys(page);
+
+	if (info->pool_pages + (1 << order) > ump_os_pool_pages)
+	{
+		if (!is_cached)
+		{
+			dma_unmap_page(NULL, phys, size, DMA_BIDIRECTIONAL);
+		}
+		__free_pages(page, order);
+		return;
+	}
+
+	/* the next owner may map it either way, leave nothing in the caches */
+	memset(virt, 0, size);
+	dmac_flush_range(virt, virt + size);
+	outer_flush_range(phys, phys + size);
+
+	set_page_private(page, order);
+
+	spin_lock(&info->pool_lock);
+	list_add(&page->lru, &info->pool[pool]);
+	info->pool_pages += 1 << order;
+	spin_unlock(&info->pool_lock);
+}
+
+static int os_pool_index(unsigned long size)
+{
+	int i;
+
+	for (i = 0; i < UMP_OS_POOL_ORDERS; i++)
+	{
+		if ((PAGE_SIZE << ump_os_pool_order[i]) == size)
+		{
+			return i;
+		}
+	}
+
+	BUG();
+	return 0;
+}
+
+/*
+ * Allocate a block of the given pool, from the pool first
+ */
+static struct page * os_block_alloc(os_allocator * info, int pool, int is_cached)
+{
+	unsigned int order = ump_os_pool_order[pool];
+	gfp_t gfp = GFP_KERNEL | __GFP_ZERO | __GFP_NORETRY | __GFP_NOWARN;
+	struct page * new_page;
+
+	new_page = os_pool_get(info, pool);
+	if (NULL != new_page)
+	{
+		return new_page;
+	}
+
+	if (!is_cached && 0 == order)
+	{
+		gfp |= __GFP_COLD;
+	}
+
+	new_page = alloc_pages(gfp, order);
+	if (NULL == new_page)
+	{
+		return NULL;
+	}
+
+	/* Ensure page caches are flushed. */
+	if (!is_cached)
+	{
+		dma_map_page(NULL, new_page, 0, PAGE_SIZE << order, DMA_BIDIRECTIONAL);
+	}
+
+	return new_page;
+}
+
+
+
 /*
  * Destroy specified OS memory backend
  */
 static void os_memory_backend_destroy(ump_memory_backend * backend)
 {
 	os_allocator * info = (os_allocator*)backend->ctx;
+	LIST_HEAD(pages);
 
 	DBG_MSG_IF(1, 0 != info->num_pages_allocated, ("%d pages still in use during shutdown\n", info->num_pages_allocated));
 
+	debugfs_remove_recursive(info->debugfs_dir);
+	unregister_shrinker(&info->shrinker);
+
+	os_pool_drain(info, &pages, info->pool_pages);
+	os_pool_free_pages(&pages);
+
 	kfree(info);
 	kfree(backend);
 }
@@ -105,8 +330,10 @@ static int os_allocate(void* ctx, ump_dd_mem * descriptor)
 {
 	u32 left;
 	os_allocator * info;
+	int blocks_allocated = 0;
 	int pages_allocated = 0;
 	int is_cached;
+	int pool = 0;
 
 	BUG_ON(!descriptor);
 	BUG_ON(!ctx);
@@ -126,6 +353,7 @@ static int os_allocate(void* ctx, ump_dd_mem * descriptor)
 
 	DBG_MSG(5, ("Allocating page array. Size: %lu\n", descriptor->nr_blocks * sizeof(ump_dd_physical_block)));
 
+	/* room for the worst case, a block per page */
 	descriptor->block_array = (ump_dd_physical_block *)vmalloc(sizeof(ump_dd_physical_block) * descriptor->nr_blocks);
 	if (NULL == descriptor->block_array)
 	{
@@ -134,69 +362,96 @@ static int os_allocate(void* ctx, ump_dd_mem * descriptor)
 		return 0; /* failure */
 	}
 
-	while (left > 0 && ((info->num_pages_allocated + pages_allocated) < info->num_pages_max))
+	while (left > 0)
 	{
 		struct page * new_page;
+		u32 block_size;
 
-		if (is_cached)
+		/* the largest block the rest of the buffer fills, as long as they come */
+		while (pool < UMP_OS_POOL_ORDERS - 1 && left < (PAGE_SIZE << ump_os_pool_order[pool]))
 		{
-			new_page = alloc_page(GFP_KERNEL | __GFP_ZERO | __GFP_NORETRY | __GFP_NOWARN );
-		} else
+			pool++;
+		}
+		block_size = PAGE_SIZE << ump_os_pool_order[pool];
+
+		if ((info->num_pages_allocated + pages_allocated + (block_size >> PAGE_SHIFT)) > info->num_pages_max)
 		{
-			new_page = alloc_page(GFP_KERNEL | __GFP_ZERO | __GFP_NORETRY | __GFP_NOWARN | __GFP_COLD);
+			if (pool < UMP_OS_POOL_ORDERS - 1)
+			{
+				pool++;
+				continue;
+			}
+			break;
 		}
+
+		new_page = os_block_alloc(info, pool, is_cached);
 		if (NULL == new_page)
 		{
+			if (pool < UMP_OS_POOL_ORDERS - 1)
+			{
+				spin_lock(&info->pool_lock);
+				info->high_order_fallbacks++;
+				spin_unlock(&info->pool_lock);
+				pool++;
+				continue;
+			}
 			MSG_ERR(("Failed to alloc_page, NULL == new_page\n"));
 			break;
 		}
 
-		/* Ensure page caches are flushed. */
-		if ( is_cached )
-		{
-			descriptor->block_array[pages_allocated].addr = page_to_phys(new_page);
-			descriptor->block_array[pages_allocated].size = PAGE_SIZE;
-		} else
+		if (0 != ump_os_pool_order[pool])
 		{
-			descriptor->block_array[pages_allocated].addr = dma_map_page(NULL, new_page, 0, PAGE_SIZE, DMA_BIDIRECTIONAL );
-			descriptor->block_array[pages_allocated].size = PAGE_SIZE;
+			spin_lock(&info->pool_lock);
+			info->high_order_allocs++;
+			spin_unlock(&info->pool_lock);
 		}
 
-		DBG_MSG(5, ("Allocated page 0x%08lx cached: %d\n", descriptor->block_array[pages_allocated].addr, is_cached));
+		descriptor->block_array[blocks_allocated].addr = page_to_phys(new_page);
+		descriptor->block_array[blocks_allocated].size = block_size;
 
-		if (left < PAGE_SIZE)
+		DBG_MSG(5, ("Allocated block 0x%08lx size %u cached: %d\n", descriptor->block_array[blocks_allocated].addr, block_size, is_cached));
+
+		if (left < block_size)
 		{
 			left = 0;
 		}
 		else
 		{
-			left -= PAGE_SIZE;
+			left -= block_size;
 		}
 
-		pages_allocated++;
+		blocks_allocated++;
+		pages_allocated += block_size >> PAGE_SHIFT;
 	}
 
-	DBG_MSG(5, ("Alloce for ID:%2d got %d pages, cached: %d\n", descriptor->secure_id,  pages_allocated));
+	DBG_MSG(5, ("Alloce for ID:%2d got %d pages in %d blocks, cached: %d\n", descriptor->secure_id, pages_allocated, blocks_allocated, is_cached));
 
 	if (left)
 	{
 		DBG_MSG(1, ("Failed to allocate needed pages\n"));
 
-		while(pages_allocated)
+		while(blocks_allocated)
 		{
-			pages_allocated--;
-			if ( !is_cached )
-			{
-				dma_unmap_page(NULL, descriptor->block_array[pages_allocated].addr, PAGE_SIZE, DMA_BIDIRECTIONAL);
-			}
-			__free_page(pfn_to_page(descriptor->block_array[pages_allocated].addr >> PAGE_SHIFT) );
+			ump_dd_physical_block * block;
+
+			blocks_allocated--;
+			block = &descriptor->block_array[blocks_allocated];
+			os_pool_put(info, pfn_to_page(block->addr >> PAGE_SHIFT), os_pool_index(block->size), is_cached);
 		}
 
+		spin_lock(&info->pool_lock);
+		info->alloc_failures++;
+		spin_unlock(&info->pool_lock);
+
+		vfree(descriptor->block_array);
+		descriptor->block_array = NULL;
+
 		up(&info->mutex);
 
 		return 0; /* failure */
 	}
 
+	descriptor->nr_blocks = blocks_allocated;
 	info->num_pages_allocated += pages_allocated;
 
 	DBG_MSG(6, ("%d out of %d pages now allocated\n", info->num_pages_allocated, info->num_pages_max));
@@ -213,6 +468,7 @@ static int os_allocate(void* ctx, ump_dd_mem * descriptor)
 static void os_free(void* ctx, ump_dd_mem * descriptor)
 {
 	os_allocator * info;
+	u32 nr_pages = 0;
 	int i;
 
 	BUG_ON(!ctx);
@@ -220,7 +476,12 @@ static void os_free(void* ctx, ump_dd_mem * descriptor)
 
 	info = (os_allocator*)ctx;
 
-	BUG_ON(descriptor->nr_blocks > info->num_pages_allocated);
+	for ( i = 0; i < descriptor->nr_blocks; i++)
+	{
+		nr_pages += descriptor->block_array[i].size >> PAGE_SHIFT;
+	}
+
+	BUG_ON(nr_pages > info->num_pages_allocated);
 
 	if (down_interruptible(&info->mutex))
 	{
@@ -228,21 +489,83 @@ static void os_free(void* ctx, ump_dd_mem * descriptor)
 		return;
 	}
 
-	DBG_MSG(5, ("Releasing %lu OS pages\n", descriptor->nr_blocks));
+	DBG_MSG(5, ("Releasing %u OS pages in %lu blocks\n", nr_pages, descriptor->nr_blocks));
 
-	info->num_pages_allocated -= descriptor->nr_blocks;
+	info->num_pages_allocated -= nr_pages;
 
 	up(&info->mutex);
 
 	for ( i = 0; i < descriptor->nr_blocks; i++)
 	{
-		DBG_MSG(6, ("Freeing physical page. Address: 0x%08lx\n", descriptor->block_array[i].addr));
-		if ( ! descriptor->is_cached)
+		ump_dd_physical_block * block = &descriptor->block_array[i];
+
+		DBG_MSG(6, ("Freeing physical block. Address: 0x%08lx\n", block->addr));
+		os_pool_put(info, pfn_to_page(block->addr >> PAGE_SHIFT), os_pool_index(block->size), descriptor->is_cached);
+	}
+
+	vfree(descriptor->block_array);
+}
+
+
+
+/*
+ * Allocation statistics, in debugfs/ump/os_memory
+ */
+static int os_debugfs_show(struct seq_file *s, void *unused)
+{
+	os_allocator * info = s->private;
+	u32 pool_blocks[UMP_OS_POOL_ORDERS];
+	struct list_head * entry;
+	int i;
+
+	spin_lock(&info->pool_lock);
+	for (i = 0; i < UMP_OS_POOL_ORDERS; i++)
+	{
+		pool_blocks[i] = 0;
+		list_for_each(entry, &info->pool[i])
 		{
-			dma_unmap_page(NULL, descriptor->block_array[i].addr, PAGE_SIZE, DMA_BIDIRECTIONAL);
+			pool_blocks[i]++;
 		}
-		__free_page(pfn_to_page(descriptor->block_array[i].addr>>PAGE_SHIFT) );
 	}
+	seq_printf(s, "pages_allocated:      %u\n", info->num_pages_allocated);
+	seq_printf(s, "pages_max:            %u\n", info->num_pages_max);
+	seq_printf(s, "pool_pages:           %u\n", info->pool_pages);
+	for (i = 0; i < UMP_OS_POOL_ORDERS; i++)
+	{
+		seq_printf(s, "pool_blocks_%luk: %u\n", (PAGE_SIZE << ump_os_pool_order[i]) >> 10, pool_blocks[i]);
+	}
+	seq_printf(s, "pool_hits:            %lu\n", info->pool_hits);
+	seq_printf(s, "pool_misses:          %lu\n", info->pool_misses);
+	seq_printf(s, "pool_shrunk_pages:    %lu\n", info->pool_shrunk);
+	seq_printf(s, "high_order_allocs:    %lu\n", info->high_order_allocs);
+	seq_printf(s, "high_order_fallbacks: %lu\n", info->high_order_fallbacks);
+	seq_printf(s, "alloc_failures:       %lu\n", info->alloc_failures);
+	spin_unlock(&info->pool_lock);
+
+	return 0;
+}
 
-	vfree(descriptor->block_array);
+static int os_debugfs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, os_debugfs_show, inode->i_private);
+}
+
+static const struct file_operations os_debugfs_fops =
+{
+	.open = os_debugfs_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void os_debugfs_init(os_allocator * info)
+{
+	info->debugfs_dir = debugfs_create_dir("ump", NULL);
+	if (IS_ERR_OR_NULL(info->debugfs_dir))
+	{
+		info->debugfs_dir = NULL;
+		return;
+	}
+
+	debugfs_create_file("os_memory", S_IRUGO, info->debugfs_dir, info, &os_debugfs_fops);
 }
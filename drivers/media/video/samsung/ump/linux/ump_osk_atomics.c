@@ -25,3 +25,8 @@ int _ump_osk_atomic_inc_and_read( _mali_osk_atomic_t *atom )
 {
 	return atomic_inc_return((atomic_t *)&atom->u.val);
 }
+
+int _ump_osk_atomic_inc_not_zero( _mali_osk_atomic_t *atom )
+{
+	return atomic_inc_not_zero((atomic_t *)&atom->u.val);
+}
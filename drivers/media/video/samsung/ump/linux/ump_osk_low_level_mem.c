@@ -29,6 +29,7 @@
 #include <asm/memory.h>
 #include <asm/cacheflush.h>
 #include <linux/dma-mapping.h>
+#include <linux/bufsync.h>
 
 typedef struct ump_vma_usage_tracker
 {
@@ -278,12 +279,127 @@ static void _ump_osk_msync_with_virt(ump_dd_mem * mem, ump_uk_msync_op op, u32 s
 	return;
 }
 
+/*
+ * CPU access tracking: clients that bracket their CPU accesses with
+ * _UMP_UK_MSYNC_BEGIN/END_CPU_ACCESS get only what they wrote cleaned on
+ * _UMP_UK_MSYNC_CLEAN, and invalidation only after a device had the
+ * memory.
+ */
+typedef struct ump_osk_sync
+{
+	struct bufsync sync;
+	ump_dd_mem *mem;
+} ump_osk_sync;
+
+static void _ump_osk_sync_range(struct bufsync *sync, unsigned long offset,
+				unsigned long len, enum dma_data_direction dir)
+{
+	ump_dd_mem *mem = container_of(sync, ump_osk_sync, sync)->mem;
+	ump_dd_physical_block *block;
+	unsigned long i, skip, chunk;
+	u32 start_p;
+	void *start_v;
+
+	for (i = 0; i < mem->nr_blocks && len; i++) {
+		block = &mem->block_array[i];
+		if (offset >= block->size) {
+			offset -= block->size;
+			continue;
+		}
+		skip = offset;
+		chunk = min_t(unsigned long, len, block->size - skip);
+		offset = 0;
+		len -= chunk;
+
+		start_p = block->addr + skip;
+		start_v = phys_to_virt(start_p);
+		switch (dir) {
+		case DMA_TO_DEVICE:
+			dmac_map_area(start_v, chunk, DMA_TO_DEVICE);
+			outer_clean_range(start_p, start_p + chunk);
+			break;
+		case DMA_FROM_DEVICE:
+			outer_inv_range(start_p, start_p + chunk);
+			dmac_unmap_area(start_v, chunk, DMA_FROM_DEVICE);
+			break;
+		default:
+			dmac_flush_range(start_v, start_v + chunk);
+			outer_flush_range(start_p, start_p + chunk);
+			break;
+		}
+	}
+}
+
+static const struct bufsync_ops ump_osk_sync_ops = {
+	.sync = _ump_osk_sync_range,
+};
+
+void _ump_osk_msync_init( ump_dd_mem * mem )
+{
+	ump_osk_sync *info;
+
+	/* without it every msync maintains the range it is given, as before */
+	info = kmalloc(sizeof(*info), GFP_KERNEL);
+	if (info) {
+		/* uncached memory never gets here, see _ump_ukk_msync() */
+		bufsync_init(&info->sync, &ump_osk_sync_ops, mem->size_bytes, true);
+		info->mem = mem;
+	}
+	mem->sync_info = info;
+}
+
+void _ump_osk_msync_term( ump_dd_mem * mem )
+{
+	kfree(mem->sync_info);
+	mem->sync_info = NULL;
+}
+
+/* returns 1 if the tracking took care of op */
+static int _ump_osk_msync_tracked(ump_dd_mem * mem, ump_uk_msync_op op, u32 start, u32 address, u32 size)
+{
+	ump_osk_sync *info = mem->sync_info;
+	enum dma_data_direction dir = DMA_FROM_DEVICE;
+
+	if (NULL == info)
+		return 0;
+
+	if (op & _UMP_UK_MSYNC_CPU_WRITE)
+		dir = DMA_BIDIRECTIONAL;
+
+	/* no address means the whole memory, as for the other ops */
+	if (0 == address) {
+		address = start;
+		size = mem->size_bytes;
+	}
+
+	switch (op & ~_UMP_UK_MSYNC_CPU_WRITE) {
+	case _UMP_UK_MSYNC_BEGIN_CPU_ACCESS:
+		if (address >= start)
+			bufsync_begin_cpu_access(&info->sync, address - start, size, dir);
+		return 1;
+	case _UMP_UK_MSYNC_END_CPU_ACCESS:
+		if (address >= start)
+			bufsync_end_cpu_access(&info->sync, address - start, size, dir);
+		return 1;
+	case _UMP_UK_MSYNC_CLEAN:
+		if (!bufsync_tracked(&info->sync))
+			return 0;
+		bufsync_begin_device_access(&info->sync, DMA_BIDIRECTIONAL);
+		return 1;
+	default:
+		return 0;
+	}
+}
+
 void _ump_osk_msync( ump_dd_mem * mem, ump_uk_msync_op op, u32 start, u32 address, u32 size)
 {
 	int i;
 	u32 start_p, end_p;
 	ump_dd_physical_block *block;
 
+	if (_ump_osk_msync_tracked(mem, op, start, address, size))
+		return;
+
 	DBG_MSG(3,
 		("Flushing nr of blocks: %u. First: paddr: 0x%08x vaddr: 0x%08x size:%dB\n",
 		 mem->nr_blocks, mem->block_array[0].addr,
@@ -0,0 +1,258 @@
+/*
+ * Contiguous Memory Allocator stress test
+ * Copyright (c) 2010 by Samsung Electronics.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License or (at your optional) any later version of the license.
+ */
+
+/*
+ * Replays the allocation patterns of the camera and the video decoder
+ * against CMA regions so that the region statistics in SysFS (latency,
+ * failures, holes, largest_free) show how a board's region sizes hold
+ * up.  The test runs when the module is loaded and again whenever
+ * a pattern name is written to /sys/module/cma_stress/parameters/run:
+ *
+ *     modprobe cma-stress regions=fimc0,fimc1 pattern=camera loops=100
+ *     echo video > /sys/module/cma_stress/parameters/run
+ *
+ * Allocations come from the named regions, not through a device
+ * mapping, so the drivers owning them should be idle.
+ */
+
+#define pr_fmt(fmt) "cma-stress: " fmt
+
+#include <linux/errno.h>       /* Error numbers */
+#include <linux/err.h>         /* IS_ERR_VALUE() */
+#include <linux/kernel.h>
+#include <linux/ktime.h>       /* ktime_get() */
+#include <linux/math64.h>      /* div_u64() */
+#include <linux/module.h>      /* Standard module stuff */
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/random.h>      /* random32() */
+#include <linux/sched.h>       /* cond_resched() */
+#include <linux/string.h>
+
+#include <linux/cma.h>
+
+
+/************************* Patterns *************************/
+
+#define CMA_STRESS_SLOTS	16
+
+/* Allocates @size bytes into @slot, or frees @slot if @size is zero. */
+struct cma_stress_op {
+	unsigned char slot;
+	size_t size;
+};
+
+#define A(slot, size)	{ slot, size }
+#define F(slot)		{ slot, 0 }
+
+#define YUV420(w, h)	((w) * (h) * 3 / 2)
+#define YUV422(w, h)	((w) * (h) * 2)
+
+/*
+ * Camera: open with a VGA preview, switch the preview to 720p,
+ * take a 5M picture with a thumbnail, go back to preview and close.
+ */
+static const struct cma_stress_op cma_stress_camera[] = {
+	A(0, YUV420(640, 480)), A(1, YUV420(640, 480)),
+	A(2, YUV420(640, 480)), A(3, YUV420(640, 480)),
+	F(0), F(1), F(2), F(3),
+	A(0, YUV420(1280, 720)), A(1, YUV420(1280, 720)),
+	A(2, YUV420(1280, 720)), A(3, YUV420(1280, 720)),
+	A(4, YUV422(2560, 1920)), A(5, YUV422(320, 240)),
+	F(4), F(5),
+	F(0), F(1), F(2), F(3),
+};
+
+/*
+ * Video decoder: a 720p stream with eight reference frames and its
+ * bitstream buffer, a resolution change to 1080p with six, then a
+ * stream seek that reallocates the bitstream buffer.
+ */
+static const struct cma_stress_op cma_stress_video[] = {
+	A(0, 1 << 20),
+	A(1, YUV420(1280, 736)), A(2, YUV420(1280, 736)),
+	A(3, YUV420(1280, 736)), A(4, YUV420(1280, 736)),
+	A(5, YUV420(1280, 736)), A(6, YUV420(1280, 736)),
+	A(7, YUV420(1280, 736)), A(8, YUV420(1280, 736)),
+	F(1), F(2), F(3), F(4), F(5), F(6), F(7), F(8),
+	A(1, YUV420(1920, 1088)), A(2, YUV420(1920, 1088)),
+	A(3, YUV420(1920, 1088)), A(4, YUV420(1920, 1088)),
+	A(5, YUV420(1920, 1088)), A(6, YUV420(1920, 1088)),
+	F(0), A(0, 2 << 20),
+	F(1), F(2), F(3), F(4), F(5), F(6), F(0),
+};
+
+struct cma_stress_pattern {
+	const char *name;
+	const struct cma_stress_op *ops;
+	unsigned count;
+};
+
+static const struct cma_stress_pattern cma_stress_patterns[] = {
+	{ "camera", cma_stress_camera, ARRAY_SIZE(cma_stress_camera) },
+	{ "video",  cma_stress_video,  ARRAY_SIZE(cma_stress_video)  },
+	/* random sizes from 64K to 4M, freed in random order */
+	{ "random", NULL, 64 },
+};
+
+
+/************************* Runner *************************/
+
+static char *regions = "fimc0,fimc1,mfc";
+module_param(regions, charp, 0644);
+MODULE_PARM_DESC(regions, "Comma separated regions to allocate from");
+
+static char *pattern = "camera";
+module_param(pattern, charp, 0644);
+MODULE_PARM_DESC(pattern, "Pattern to run at load: camera, video or random");
+
+static unsigned loops = 10;
+module_param(loops, uint, 0644);
+MODULE_PARM_DESC(loops, "Number of times a pattern is replayed");
+
+static DEFINE_MUTEX(cma_stress_mutex);
+
+struct cma_stress_result {
+	unsigned long allocs, failures;
+	u64 total_us;
+	unsigned long max_us;
+};
+
+static void cma_stress_alloc(dma_addr_t *slot, size_t size,
+			     struct cma_stress_result *res)
+{
+	unsigned long us;
+	ktime_t t;
+
+	if (!IS_ERR_VALUE(*slot))
+		cma_free(*slot);
+
+	t = ktime_get();
+	*slot = cma_alloc_from(regions, size, 0);
+	us = ktime_to_us(ktime_sub(ktime_get(), t));
+
+	if (IS_ERR_VALUE(*slot)) {
+		res->failures++;
+		pr_debug("%zu bytes failed: %d\n", size, (int)*slot);
+		return;
+	}
+
+	res->allocs++;
+	res->total_us += us;
+	if (us > res->max_us)
+		res->max_us = us;
+}
+
+static void cma_stress_free(dma_addr_t *slot)
+{
+	if (!IS_ERR_VALUE(*slot))
+		cma_free(*slot);
+	*slot = -ENOMEM;
+}
+
+static void cma_stress_replay(const struct cma_stress_pattern *p,
+			      dma_addr_t *slots,
+			      struct cma_stress_result *res)
+{
+	const struct cma_stress_op *op;
+	unsigned i, n;
+	size_t size;
+
+	if (p->ops) {
+		for (op = p->ops; op < p->ops + p->count; ++op)
+			if (op->size)
+				cma_stress_alloc(&slots[op->slot],
+						 PAGE_ALIGN(op->size), res);
+			else
+				cma_stress_free(&slots[op->slot]);
+		return;
+	}
+
+	for (i = 0; i < p->count; ++i) {
+		n = random32() % CMA_STRESS_SLOTS;
+		if (!IS_ERR_VALUE(slots[n])) {
+			cma_stress_free(&slots[n]);
+			continue;
+		}
+		/* log-uniform between 64K and 4M */
+		size = (64 << 10) << (random32() % 6);
+		size += random32() % size;
+		cma_stress_alloc(&slots[n], PAGE_ALIGN(size), res);
+	}
+}
+
+static int cma_stress_run(const char *name)
+{
+	const struct cma_stress_pattern *p = NULL;
+	struct cma_stress_result res = { 0 };
+	dma_addr_t slots[CMA_STRESS_SLOTS];
+	struct cma_info info;
+	size_t len = strcspn(name, "\n");
+	unsigned i;
+
+	for (i = 0; i < ARRAY_SIZE(cma_stress_patterns); ++i)
+		if (strlen(cma_stress_patterns[i].name) == len &&
+		    !strncmp(cma_stress_patterns[i].name, name, len))
+			p = &cma_stress_patterns[i];
+	if (!p)
+		return -EINVAL;
+
+	if (cma_info_about(&info, regions) || !info.count) {
+		pr_err("no regions in \"%s\"\n", regions);
+		return -ENOENT;
+	}
+
+	mutex_lock(&cma_stress_mutex);
+
+	for (i = 0; i < CMA_STRESS_SLOTS; ++i)
+		slots[i] = -ENOMEM;
+
+	for (i = 0; i < loops; ++i) {
+		cma_stress_replay(p, slots, &res);
+		cond_resched();
+	}
+
+	for (i = 0; i < CMA_STRESS_SLOTS; ++i)
+		cma_stress_free(&slots[i]);
+
+	mutex_unlock(&cma_stress_mutex);
+
+	pr_info("%s x%u on %s (%zu bytes in %u regions): %lu allocs, "
+		"%lu failed, avg %lluus, max %luus\n",
+		p->name, loops, regions, info.total_size, info.count,
+		res.allocs, res.failures,
+		res.allocs ? div_u64(res.total_us, res.allocs) : 0ULL,
+		res.max_us);
+
+	return 0;
+}
+
+static int cma_stress_param_run(const char *val, struct kernel_param *kp)
+{
+	return cma_stress_run(val);
+}
+
+module_param_call(run, cma_stress_param_run, NULL, NULL, 0200);
+MODULE_PARM_DESC(run, "Write a pattern name to replay it");
+
+static int __init cma_stress_init(void)
+{
+	return cma_stress_run(pattern);
+}
+module_init(cma_stress_init);
+
+static void __exit cma_stress_exit(void)
+{
+	/* nop, every run frees what it allocated */
+}
+module_exit(cma_stress_exit);
+
+MODULE_DESCRIPTION("CMA allocation pattern stress test");
+MODULE_LICENSE("GPL");
@@ -15,14 +15,18 @@
 
 #include <linux/miscdevice.h>
 #include <linux/platform_device.h>
+#include <linux/device.h>
 #include <linux/fs.h>
 #include <linux/file.h>
 #include <linux/mm.h>
 #include <linux/list.h>
 #include <linux/debugfs.h>
 #include <linux/android_pmem.h>
+#include <linux/bufsync.h>
+#include <linux/kref.h>
 #include <linux/mempolicy.h>
 #include <linux/sched.h>
+#include <linux/spinlock.h>
 #include <asm/io.h>
 #include <asm/uaccess.h>
 #include <asm/cacheflush.h>
@@ -31,7 +35,7 @@
 #endif
 
 #define PMEM_MAX_DEVICES 10
-#define PMEM_MAX_ORDER 128
+#define PMEM_MAX_ORDER BITS_PER_LONG
 #define PMEM_MIN_ALLOC PAGE_SIZE
 
 #define PMEM_DEBUG 1
@@ -77,16 +81,43 @@ struct pmem_data {
 	struct list_head region_list;
 	/* a linked list of data so we can access them for debugging */
 	struct list_head list;
+	/* the device this file was opened on */
+	int id;
+	/* cache state of the allocation, shared with the connected files */
+	struct pmem_sync *sync;
 #if PMEM_DEBUG
 	int ref;
 #endif
 };
 
+/*
+ * Cache state of an allocation. It is made with the allocation and each
+ * file connected to it takes a reference, so what one client dirtied is
+ * cleaned whichever file hands the buffer to a device.
+ */
+struct pmem_sync {
+	struct bufsync sync;
+	struct kref ref;
+	/* physical and ioremapped start of the allocation */
+	unsigned long paddr;
+	void *vaddr;
+};
+
 struct pmem_bits {
 	unsigned allocated:1;		/* 1 if allocated, 0 if free */
 	unsigned order:7;		/* size of the region in pmem space */
 };
 
+/*
+ * The free regions of one order, one bit per aligned block of that order
+ * set when a free region starts there. The maps of all orders take two
+ * bits per bitmap entry and share one allocation, starting at order 0.
+ */
+struct pmem_free_area {
+	unsigned long *map;
+	unsigned long nr_free;
+};
+
 struct pmem_region_node {
 	struct pmem_region region;
 	struct list_head list;
@@ -119,6 +150,10 @@ struct pmem_info {
 	/* the bitmap for the region indicating which entries are allocated
 	 * and which are free */
 	struct pmem_bits *bitmap;
+	/* the free regions of the bitmap, by order */
+	struct pmem_free_area free_area[PMEM_MAX_ORDER];
+	/* number of allocations that found no free region */
+	unsigned long alloc_failures;
 	/* indicates the region should not be managed with an allocator */
 	unsigned no_allocator;
 	/* indicates maps of this region should be cached, if a mix of
@@ -134,19 +169,19 @@ struct pmem_info {
 	 * needed */
 	struct semaphore data_list_sem;
 	struct list_head data_list;
-	/* pmem_sem protects the bitmap array
-	 * a write lock should be held when modifying entries in bitmap
-	 * a read lock should be held when reading data from bits or
-	 * dereferencing a pointer into bitmap
+	/* alloc_lock protects the bitmap array and the free maps, it is
+	 * taken by pmem_allocate and pmem_free only. The entry of an
+	 * allocated region is not touched until the region is freed, so the
+	 * mmap, remap and revoke paths read its order without the lock.
 	 *
 	 * pmem_data->sem protects the pmem data of a particular file
 	 * Many of the function that require the pmem_data->sem have a non-
 	 * locking version for when the caller is already holding that sem.
 	 *
 	 * IF YOU TAKE BOTH LOCKS TAKE THEM IN THIS ORDER:
-	 * down(pmem_data->sem) => down(bitmap_sem)
+	 * down(pmem_data->sem) => spin_lock(alloc_lock)
 	 */
-	struct rw_semaphore bitmap_sem;
+	spinlock_t alloc_lock;
 
 	long (*ioctl)(struct file *, unsigned int, unsigned long);
 	int (*release)(struct inode *, struct file *);
@@ -235,34 +270,74 @@ static int is_master_owner(struct file *file)
 	return ret;
 }
 
+/* caller should hold alloc_lock */
+static void pmem_free_area_add(int id, int index, unsigned long order)
+{
+	PMEM_ORDER(id, index) = order;
+	__set_bit(index >> order, pmem[id].free_area[order].map);
+	pmem[id].free_area[order].nr_free++;
+}
+
+static void pmem_free_area_del(int id, int index)
+{
+	unsigned long order = PMEM_ORDER(id, index);
+
+	__clear_bit(index >> order, pmem[id].free_area[order].map);
+	pmem[id].free_area[order].nr_free--;
+}
+
+static int pmem_free_area_alloc(int id)
+{
+	unsigned long *map;
+	size_t longs = 0;
+	int i;
+
+	for (i = 0; i < PMEM_MAX_ORDER; i++)
+		longs += BITS_TO_LONGS(pmem[id].num_entries >> i);
+
+	map = kzalloc(longs * sizeof(unsigned long), GFP_KERNEL);
+	if (!map)
+		return -ENOMEM;
+
+	for (i = 0; i < PMEM_MAX_ORDER; i++) {
+		pmem[id].free_area[i].map = map;
+		map += BITS_TO_LONGS(pmem[id].num_entries >> i);
+	}
+
+	return 0;
+}
+
 static int pmem_free(int id, int index)
 {
-	/* caller should hold the write lock on pmem_sem! */
 	int buddy, curr = index;
+	unsigned long order;
 	DLOG("index %d\n", index);
 
+	spin_lock(&pmem[id].alloc_lock);
 	if (pmem[id].no_allocator) {
 		pmem[id].allocated = 0;
-		return 0;
+		goto out;
 	}
 	/* clean up the bitmap, merging any buddies */
 	pmem[id].bitmap[curr].allocated = 0;
+	order = PMEM_ORDER(id, curr);
 	/* find a slots buddy Buddy# = Slot# ^ (1 << order)
-	 * if the buddy is also free merge them
+	 * if the buddy is also free and of the same order it is the head of
+	 * a free region, take it out of its free map and merge them
 	 * repeat until the buddy is not free or end of the bitmap is reached
 	 */
-	do {
-		buddy = PMEM_BUDDY_INDEX(id, curr);
-		if (PMEM_IS_FREE(id, buddy) &&
-				PMEM_ORDER(id, buddy) == PMEM_ORDER(id, curr)) {
-			PMEM_ORDER(id, buddy)++;
-			PMEM_ORDER(id, curr)++;
-			curr = min(buddy, curr);
-		} else {
+	while (order + 1 < PMEM_MAX_ORDER) {
+		buddy = curr ^ (1 << order);
+		if (buddy + (1 << order) > pmem[id].num_entries ||
+		    !PMEM_IS_FREE(id, buddy) || PMEM_ORDER(id, buddy) != order)
 			break;
-		}
-	} while (curr < pmem[id].num_entries);
-
+		pmem_free_area_del(id, buddy);
+		curr = min(buddy, curr);
+		order++;
+	}
+	pmem_free_area_add(id, curr, order);
+out:
+	spin_unlock(&pmem[id].alloc_lock);
 	return 0;
 }
 
@@ -300,9 +375,7 @@ static int pmem_release(struct inode *inode, struct file *file)
 
 	/* if its not a conencted file and it has an allocation, free it */
 	if (!(PMEM_FLAGS_CONNECTED & data->flags) && has_allocation(file)) {
-		down_write(&pmem[id].bitmap_sem);
 		ret = pmem_free(id, data->index);
-		up_write(&pmem[id].bitmap_sem);
 	}
 
 	/* if this file is a submap (mapped, connected file), downref the
@@ -322,6 +395,9 @@ static int pmem_release(struct inode *inode, struct file *file)
 	}
 	BUG_ON(!list_empty(&data->region_list));
 
+	if (data->sync)
+		pmem_sync_put(data->sync);
+
 	up_write(&data->sem);
 	kfree(data);
 	if (pmem[id].release)
@@ -330,6 +406,9 @@ static int pmem_release(struct inode *inode, struct file *file)
 	return ret;
 }
 
+static int pmem_sync_setup(struct file *file, struct pmem_data *data);
+static void pmem_sync_put(struct pmem_sync *sync);
+
 static int pmem_open(struct inode *inode, struct file *file)
 {
 	struct pmem_data *data;
@@ -352,6 +431,8 @@ static int pmem_open(struct inode *inode, struct file *file)
 	data->vma = NULL;
 	data->pid = 0;
 	data->master_file = NULL;
+	data->id = id;
+	data->sync = NULL;
 #if PMEM_DEBUG
 	data->ref = 0;
 #endif
@@ -381,63 +462,55 @@ static unsigned long pmem_order(unsigned long len)
 
 static int pmem_allocate(int id, unsigned long len)
 {
-	/* caller should hold the write lock on pmem_sem! */
 	/* return the corresponding pdata[] entry */
-	int curr = 0;
-	int end = pmem[id].num_entries;
 	int best_fit = -1;
 	unsigned long order = pmem_order(len);
+	unsigned long curr;
 
+	spin_lock(&pmem[id].alloc_lock);
 	if (pmem[id].no_allocator) {
 		DLOG("no allocator");
-		if ((len > pmem[id].size) || pmem[id].allocated)
-			return -1;
-		pmem[id].allocated = 1;
-		return len;
+		if (!(len > pmem[id].size) && !pmem[id].allocated) {
+			pmem[id].allocated = 1;
+			best_fit = len;
+		}
+		goto out;
 	}
 
-	if (order > PMEM_MAX_ORDER)
-		return -1;
 	DLOG("order %lx\n", order);
 
-	/* look through the bitmap:
-	 * 	if you find a free slot of the correct order use it
-	 * 	otherwise, use the best fit (smallest with size > order) slot
-	 */
-	while (curr < end) {
-		if (PMEM_IS_FREE(id, curr)) {
-			if (PMEM_ORDER(id, curr) == (unsigned char)order) {
-				/* set the not free bit and clear others */
-				best_fit = curr;
-				break;
-			}
-			if (PMEM_ORDER(id, curr) > (unsigned char)order &&
-			    (best_fit < 0 ||
-			     PMEM_ORDER(id, curr) < PMEM_ORDER(id, best_fit)))
-				best_fit = curr;
-		}
-		curr = PMEM_NEXT_INDEX(id, curr);
+	/* take the lowest region of the smallest order >= the one asked for */
+	for (curr = order; curr < PMEM_MAX_ORDER; curr++) {
+		if (!pmem[id].free_area[curr].nr_free)
+			continue;
+		best_fit = find_first_bit(pmem[id].free_area[curr].map,
+					  pmem[id].num_entries >> curr) << curr;
+		break;
 	}
 
 	/* if best_fit < 0, there are no suitable slots,
 	 * return an error
 	 */
 	if (best_fit < 0) {
+		pmem[id].alloc_failures++;
 		printk("pmem: no space left to allocate!\n");
-		return -1;
+		goto out;
 	}
+	pmem_free_area_del(id, best_fit);
 
 	/* now partition the best fit:
-	 * 	split the slot into 2 buddies of order - 1
+	 * 	split the slot into 2 buddies of order - 1, the upper one
+	 * 	goes into the free map of that order
 	 * 	repeat until the slot is of the correct order
 	 */
-	while (PMEM_ORDER(id, best_fit) > (unsigned char)order) {
-		int buddy;
-		PMEM_ORDER(id, best_fit) -= 1;
-		buddy = PMEM_BUDDY_INDEX(id, best_fit);
-		PMEM_ORDER(id, buddy) = PMEM_ORDER(id, best_fit);
+	while (curr > order) {
+		curr--;
+		pmem_free_area_add(id, best_fit + (1 << curr), curr);
 	}
+	PMEM_ORDER(id, best_fit) = order;
 	pmem[id].bitmap[best_fit].allocated = 1;
+out:
+	spin_unlock(&pmem[id].alloc_lock);
 	return best_fit;
 }
 
@@ -608,10 +681,12 @@ static int pmem_mmap(struct file *file, struct vm_area_struct *vma)
 	}
 	/* if file->private_data == unalloced, alloc*/
 	if (data && data->index == -1) {
-		down_write(&pmem[id].bitmap_sem);
 		index = pmem_allocate(id, vma->vm_end - vma->vm_start);
-		up_write(&pmem[id].bitmap_sem);
 		data->index = index;
+		if (index >= 0 && pmem_sync_setup(file, data)) {
+			pmem_free(id, index);
+			data->index = -1;
+		}
 	}
 	/* either no space was available or an error occured */
 	if (!has_allocation(file)) {
@@ -782,14 +857,90 @@ void put_pmem_file(struct file *file)
 	fput(file);
 }
 
+/* cache maintenance of part of an allocation */
+static void pmem_sync_range(struct bufsync *sync, unsigned long offset,
+			    unsigned long len, enum dma_data_direction dir)
+{
+	struct pmem_sync *psync = container_of(sync, struct pmem_sync, sync);
+	void *vaddr = psync->vaddr + offset;
+	unsigned long paddr = psync->paddr + offset;
+
+	switch (dir) {
+	case DMA_TO_DEVICE:
+		dmac_map_area(vaddr, len, DMA_TO_DEVICE);
+		outer_clean_range(paddr, paddr + len);
+		break;
+	case DMA_FROM_DEVICE:
+		outer_inv_range(paddr, paddr + len);
+		dmac_unmap_area(vaddr, len, DMA_FROM_DEVICE);
+		break;
+	default:
+		/* flushing the whole caches is cheaper for large buffers */
+		if (len >= SZ_1M) {
+			flush_all_cpu_caches();
+			outer_flush_all();
+			break;
+		}
+		if (len >= SZ_64K)
+			flush_all_cpu_caches();
+		else
+			dmac_flush_range(vaddr, vaddr + len);
+		outer_flush_range(paddr, paddr + len);
+		break;
+	}
+}
+
+static const struct bufsync_ops pmem_sync_ops = {
+	.sync = pmem_sync_range,
+};
+
+/*
+ * called with data->sem held for writing once the file made an
+ * allocation, the files connected to it share the state set up here
+ */
+static int pmem_sync_setup(struct file *file, struct pmem_data *data)
+{
+	struct pmem_sync *sync;
+	int id = get_id(file);
+
+	sync = kmalloc(sizeof(struct pmem_sync), GFP_KERNEL);
+	if (!sync)
+		return -ENOMEM;
+
+	bufsync_init(&sync->sync, &pmem_sync_ops, pmem_len(id, data),
+		     pmem[id].cached && !(file->f_flags & O_SYNC));
+	kref_init(&sync->ref);
+	sync->paddr = pmem_start_addr(id, data);
+	sync->vaddr = pmem_start_vaddr(id, data);
+	data->sync = sync;
+	return 0;
+}
+
+static void pmem_sync_release(struct kref *ref)
+{
+	kfree(container_of(ref, struct pmem_sync, ref));
+}
+
+static void pmem_sync_put(struct pmem_sync *sync)
+{
+	kref_put(&sync->ref, pmem_sync_release);
+}
+
+static enum dma_data_direction pmem_sync_dir(unsigned int flags)
+{
+	if ((flags & PMEM_SYNC_RW) == PMEM_SYNC_READ)
+		return DMA_FROM_DEVICE;
+	if ((flags & PMEM_SYNC_RW) == PMEM_SYNC_WRITE)
+		return DMA_TO_DEVICE;
+	return DMA_BIDIRECTIONAL;
+}
+
 void flush_pmem_file(struct file *file, unsigned long offset, unsigned long len)
 {
 	struct pmem_data *data;
 	int id;
-	void *vaddr;
 	struct pmem_region_node *region_node;
 	struct list_head *elt;
-	void *flush_start, *flush_end;
 
 	if (!is_pmem_file(file) || !has_allocation(file)) {
 		return;
@@ -797,23 +948,21 @@ void flush_pmem_file(struct file *file, unsigned long offset, unsigned long len)
 
 	id = get_id(file);
 	data = (struct pmem_data *)file->private_data;
+	/* uncached and write-combined mappings need no maintenance */
 	if (!pmem[id].cached || file->f_flags & O_SYNC)
 		return;
 
 	down_read(&data->sem);
-	vaddr = pmem_start_vaddr(id, data);
+	/* the client tells what it touched, only clean what it wrote */
+	if (bufsync_tracked(&data->sync->sync)) {
+		bufsync_begin_device_access(&data->sync->sync,
+					    DMA_BIDIRECTIONAL);
+		goto end;
+	}
 	/* if this isn't a submmapped file, flush the whole thing */
 	if (unlikely(!(data->flags & PMEM_FLAGS_CONNECTED))) {
-		if (pmem_len(id, data) >= SZ_1M) {
-			flush_all_cpu_caches();
-                       	outer_flush_all();
-		} else if (pmem_len(id, data) >= SZ_64K) {
-			flush_all_cpu_caches();
-			outer_flush_range(virt_to_phys(vaddr), virt_to_phys(vaddr + pmem_len(id, data)));
-		} else {
-			dmac_flush_range(vaddr, vaddr + pmem_len(id, data));
-			outer_flush_range(virt_to_phys(vaddr), virt_to_phys(vaddr + pmem_len(id, data)));
-		}		
+		pmem_sync_range(&data->sync->sync, 0, pmem_len(id, data),
+				DMA_BIDIRECTIONAL);
 		goto end;
 	}
 	/* otherwise, flush the region of the file we are drawing */
@@ -822,19 +971,10 @@ void flush_pmem_file(struct file *file, unsigned long offset, unsigned long len)
 		if ((offset >= region_node->region.offset) &&
 		    ((offset + len) <= (region_node->region.offset +
 			region_node->region.len))) {
-			flush_start = vaddr + region_node->region.offset;
-			flush_end = flush_start + region_node->region.len;
-
-			if (pmem_len(id, data) >= SZ_1M) {
-				flush_all_cpu_caches();
-	                 	outer_flush_all();
-			} else if (pmem_len(id, data) >= SZ_64K) {
-				flush_all_cpu_caches();
-				outer_flush_range(virt_to_phys(flush_start), virt_to_phys(flush_end));
-			} else {
-				dmac_flush_range(flush_start, flush_end);
-				outer_flush_range(virt_to_phys(flush_start), virt_to_phys(flush_end));
-			}			
+			pmem_sync_range(&data->sync->sync,
+					region_node->region.offset,
+					region_node->region.len,
+					DMA_BIDIRECTIONAL);
 			break;
 		}
 	}
@@ -874,6 +1014,13 @@ static int pmem_connect(unsigned long connect, struct file *file)
 	}
 	data->index = src_data->index;
 	data->flags |= PMEM_FLAGS_CONNECTED;
+	/* the open src_file keeps its data and the state alive meanwhile */
+	if (data->sync != src_data->sync) {
+		if (data->sync)
+			pmem_sync_put(data->sync);
+		kref_get(&src_data->sync->ref);
+		data->sync = src_data->sync;
+	}
 	data->master_fd = connect;
 	data->master_file = src_file;
 
@@ -1161,7 +1308,15 @@ static long pmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			if (has_allocation(file))
 				return -EINVAL;
 			data = (struct pmem_data *)file->private_data;
+			down_write(&data->sem);
 			data->index = pmem_allocate(id, arg);
+			if (data->index >= 0 && pmem_sync_setup(file, data)) {
+				pmem_free(id, data->index);
+				data->index = -1;
+				up_write(&data->sem);
+				return -ENOMEM;
+			}
+			up_write(&data->sem);
 			break;
 		}
 	case PMEM_CONNECT:
@@ -1178,6 +1333,32 @@ static long pmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			flush_pmem_file(file, region.offset, region.len);
 			break;
 		}
+	case PMEM_BEGIN_CPU_ACCESS:
+	case PMEM_END_CPU_ACCESS:
+		{
+			struct pmem_sync_region region;
+			enum dma_data_direction dir;
+			if (copy_from_user(&region, (void __user *)arg,
+					   sizeof(struct pmem_sync_region)))
+				return -EFAULT;
+			if (!(region.flags & PMEM_SYNC_RW))
+				return -EINVAL;
+			if (!has_allocation(file))
+				return -EINVAL;
+			data = (struct pmem_data *)file->private_data;
+			dir = pmem_sync_dir(region.flags);
+			down_read(&data->sem);
+			if (cmd == PMEM_BEGIN_CPU_ACCESS)
+				bufsync_begin_cpu_access(&data->sync->sync,
+							 region.offset,
+							 region.len, dir);
+			else
+				bufsync_end_cpu_access(&data->sync->sync,
+						       region.offset,
+						       region.len, dir);
+			up_read(&data->sem);
+			break;
+		}
 	default:
 		if (pmem[id].ioctl)
 			return pmem[id].ioctl(file, cmd, arg);
@@ -1238,6 +1419,94 @@ static struct file_operations debug_fops = {
 };
 #endif
 
+/* fragmentation of the allocator, under /sys/class/misc/<name>/ */
+static struct pmem_info *dev_to_pmem(struct device *dev)
+{
+	struct miscdevice *misc = dev_get_drvdata(dev);
+
+	return container_of(misc, struct pmem_info, dev);
+}
+
+static ssize_t show_free_blocks(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct pmem_info *info = dev_to_pmem(dev);
+	unsigned long nr_free[PMEM_MAX_ORDER];
+	ssize_t len = 0;
+	int i, top = 0;
+
+	spin_lock(&info->alloc_lock);
+	for (i = 0; i < PMEM_MAX_ORDER; i++) {
+		nr_free[i] = info->free_area[i].nr_free;
+		if (nr_free[i])
+			top = i;
+	}
+	spin_unlock(&info->alloc_lock);
+
+	/* one count per order, as in /proc/buddyinfo */
+	for (i = 0; i <= top; i++)
+		len += sprintf(buf + len, "%lu ", nr_free[i]);
+	buf[len - 1] = '\n';
+
+	return len;
+}
+static DEVICE_ATTR(free_blocks, 0444, show_free_blocks, NULL);
+
+static ssize_t show_free_size(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct pmem_info *info = dev_to_pmem(dev);
+	unsigned long entries = 0;
+	int i;
+
+	spin_lock(&info->alloc_lock);
+	for (i = 0; i < PMEM_MAX_ORDER; i++)
+		entries += info->free_area[i].nr_free << i;
+	spin_unlock(&info->alloc_lock);
+
+	return sprintf(buf, "%lu\n", entries * PMEM_MIN_ALLOC);
+}
+static DEVICE_ATTR(free_size, 0444, show_free_size, NULL);
+
+static ssize_t show_largest_free(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct pmem_info *info = dev_to_pmem(dev);
+	unsigned long largest = 0;
+	int i;
+
+	spin_lock(&info->alloc_lock);
+	for (i = PMEM_MAX_ORDER - 1; i >= 0; i--) {
+		if (info->free_area[i].nr_free) {
+			largest = (1UL << i) * PMEM_MIN_ALLOC;
+			break;
+		}
+	}
+	spin_unlock(&info->alloc_lock);
+
+	return sprintf(buf, "%lu\n", largest);
+}
+static DEVICE_ATTR(largest_free, 0444, show_largest_free, NULL);
+
+static ssize_t show_alloc_failures(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", dev_to_pmem(dev)->alloc_failures);
+}
+static DEVICE_ATTR(alloc_failures, 0444, show_alloc_failures, NULL);
+
+static struct attribute *pmem_attributes[] = {
+	&dev_attr_free_blocks.attr,
+	&dev_attr_free_size.attr,
+	&dev_attr_largest_free.attr,
+	&dev_attr_alloc_failures.attr,
+	NULL
+};
+
+static struct attribute_group pmem_attr_group = {
+	.attrs = pmem_attributes,
+};
+
 #if 0
 static struct miscdevice pmem_dev = {
 	.name = "pmem",
@@ -1265,7 +1534,7 @@ int pmem_setup(struct android_pmem_platform_data *pdata,
 	pmem[id].size = pdata->size;
 	pmem[id].ioctl = ioctl;
 	pmem[id].release = release;
-	init_rwsem(&pmem[id].bitmap_sem);
+	spin_lock_init(&pmem[id].alloc_lock);
 	init_MUTEX(&pmem[id].data_list_sem);
 	INIT_LIST_HEAD(&pmem[id].data_list);
 	pmem[id].dev.name = pdata->name;
@@ -1288,13 +1557,24 @@ int pmem_setup(struct android_pmem_platform_data *pdata,
 	memset(pmem[id].bitmap, 0, sizeof(struct pmem_bits) *
 					  pmem[id].num_entries);
 
+	if (pmem_free_area_alloc(id)) {
+		kfree(pmem[id].bitmap);
+		goto err_no_mem_for_metadata;
+	}
+
 	for (i = sizeof(pmem[id].num_entries) * 8 - 1; i >= 0; i--) {
 		if ((pmem[id].num_entries) &  1<<i) {
-			PMEM_ORDER(id, index) = i;
+			pmem_free_area_add(id, index, i);
 			index = PMEM_NEXT_INDEX(id, index);
 		}
 	}
 
+	if (!pmem[id].no_allocator &&
+	    sysfs_create_group(&pmem[id].dev.this_device->kobj,
+			       &pmem_attr_group))
+		printk(KERN_WARNING "%s: unable to create sysfs entries\n",
+		       pdata->name);
+
 	if (pmem[id].cached)
 		pmem[id].vbase = ioremap_cached(pmem[id].base,
 						pmem[id].size);
@@ -1319,6 +1599,10 @@ int pmem_setup(struct android_pmem_platform_data *pdata,
 #endif
 	return 0;
 error_cant_remap:
+	if (!pmem[id].no_allocator)
+		sysfs_remove_group(&pmem[id].dev.this_device->kobj,
+				   &pmem_attr_group);
+	kfree(pmem[id].free_area[0].map);
 	kfree(pmem[id].bitmap);
 err_no_mem_for_metadata:
 	misc_deregister(&pmem[id].dev);
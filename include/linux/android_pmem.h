@@ -34,6 +34,18 @@
  */
 #define PMEM_GET_TOTAL_SIZE	_IOW(PMEM_IOCTL_MAGIC, 7, unsigned int)
 #define PMEM_CACHE_FLUSH	_IOW(PMEM_IOCTL_MAGIC, 8, unsigned int)
+/* Bracket CPU accesses to part of the buffer with a pmem_sync_region, so
+ * that PMEM_CACHE_FLUSH only cleans what the CPU wrote and reads only
+ * invalidate after a device had the buffer. The state is kept with the
+ * allocation and shared by the files connected to it. Once any of them
+ * used these, PMEM_CACHE_FLUSH trusts them for the rest of its life.
+ */
+#define PMEM_BEGIN_CPU_ACCESS	_IOW(PMEM_IOCTL_MAGIC, 9, unsigned int)
+#define PMEM_END_CPU_ACCESS	_IOW(PMEM_IOCTL_MAGIC, 10, unsigned int)
+
+#define PMEM_SYNC_READ		0x1
+#define PMEM_SYNC_WRITE		0x2
+#define PMEM_SYNC_RW		(PMEM_SYNC_READ | PMEM_SYNC_WRITE)
 
 struct android_pmem_platform_data
 {
@@ -57,6 +69,12 @@ struct pmem_region {
 	unsigned long len;
 };
 
+struct pmem_sync_region {
+	unsigned long offset;
+	unsigned long len;
+	unsigned int flags;	/* PMEM_SYNC_READ and/or PMEM_SYNC_WRITE */
+};
+
 #ifdef CONFIG_ANDROID_PMEM
 int is_pmem_file(struct file *file);
 int get_pmem_file(int fd, unsigned long *start, unsigned long *vstart,
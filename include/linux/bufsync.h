@@ -0,0 +1,69 @@
+/*
+ * include/linux/bufsync.h
+ *
+ * CPU cache ownership tracking for buffers shared with devices
+ *
+ * A buffer exporter (pmem, UMP) keeps a struct bufsync next to each
+ * buffer its clients map. Clients bracket what they do with the
+ * buffer on the CPU by bufsync_begin_cpu_access() and
+ * bufsync_end_cpu_access() and hand it over with
+ * bufsync_begin_device_access(). From that the exporter knows which
+ * part of the buffer the CPU may have dirtied and whether a device may
+ * have written it since the CPU last looked, and only asks its backend
+ * to clean or invalidate what is needed, nothing at all for buffers
+ * mapped uncached or write-combined.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef __LINUX_BUFSYNC_H
+#define __LINUX_BUFSYNC_H
+
+#include <linux/dma-mapping.h>
+#include <linux/spinlock.h>
+#include <linux/types.h>
+
+struct bufsync;
+
+struct bufsync_ops {
+	/*
+	 * Cache maintenance of [offset, offset + len) of the buffer:
+	 * DMA_TO_DEVICE cleans, DMA_FROM_DEVICE invalidates and
+	 * DMA_BIDIRECTIONAL does both. Called with no lock held.
+	 */
+	void (*sync)(struct bufsync *sync, unsigned long offset,
+		     unsigned long len, enum dma_data_direction dir);
+};
+
+struct bufsync {
+	spinlock_t lock;
+	const struct bufsync_ops *ops;
+	unsigned long size;
+	/* CPU mappings of the buffer go through the caches */
+	unsigned cached:1;
+	/* the client told about its CPU accesses, so they can be trusted */
+	unsigned tracked:1;
+	/* a device may have written the buffer since the CPU invalidated */
+	unsigned stale:1;
+	/* the part of the buffer the CPU wrote since it was last cleaned */
+	unsigned long dirty_start, dirty_end;
+};
+
+void bufsync_init(struct bufsync *sync, const struct bufsync_ops *ops,
+		  unsigned long size, bool cached);
+
+void bufsync_begin_cpu_access(struct bufsync *sync, unsigned long offset,
+			      unsigned long len, enum dma_data_direction dir);
+void bufsync_end_cpu_access(struct bufsync *sync, unsigned long offset,
+			    unsigned long len, enum dma_data_direction dir);
+void bufsync_begin_device_access(struct bufsync *sync,
+				 enum dma_data_direction dir);
+
+static inline bool bufsync_tracked(struct bufsync *sync)
+{
+	return sync->tracked;
+}
+
+#endif /* __LINUX_BUFSYNC_H */
@@ -198,6 +198,11 @@ cma_info_about(struct cma_info *info, const const char *regions)
 
 struct cma_allocator;
 
+/* Allocation latency buckets: <16us, <64us, ... <64ms, the rest. */
+#define CMA_STATS_LATENCY_BUCKETS	8
+/* Failed allocation size buckets: <64K, <256K, ... <16M, the rest. */
+#define CMA_STATS_SIZE_BUCKETS		6
+
 /**
  * struct cma_region - a region reserved for CMA allocations.
  * @name:	Unique name of the region.  Read only.
@@ -215,6 +220,8 @@ struct cma_allocator;
  * @private_data:	Allocator's private data.
  * @users:	Number of chunks allocated in this region.
  * @list:	Entry in list of regions.  Private.
+ * @lend:	Statistics of taking lent memory back.  Read only.
+ * @stats:	Allocation statistics shown in SysFS.  Private.
  * @used:	Whether region was already used, ie. there was at least
  *		one allocation request for.  Private.
  * @registered:	Whether this region has been registered.  Read only.
@@ -223,6 +230,9 @@ struct cma_allocator;
  *		this region is converted from early to normal.  Early.
  *		Private.
  * @free_alloc_name:	Whether @alloc_name was kmalloced().  Private.
+ * @movable:	Whether the free parts of the region are lent to the page
+ *		allocator for movable pages.  They are migrated away when
+ *		a chunk is allocated.  Early.
  *
  * Regions come in two types: an early region and normal region.  The
  * former can be reserved or not-reserved.  Fields marked as "early"
@@ -256,6 +266,22 @@ struct cma_region {
 
 #if defined CONFIG_CMA_SYSFS
 	struct kobject kobj;
+	struct {
+		unsigned long allocs;
+		unsigned long latency[CMA_STATS_LATENCY_BUCKETS];
+		unsigned long failures[CMA_STATS_SIZE_BUCKETS];
+	} stats;
+#endif
+
+#if defined CONFIG_CMA_MIGRATE
+	struct {
+		unsigned long lent;	/* pages given to the page allocator */
+		unsigned long allocs;	/* allocations that took pages back */
+		unsigned long failed;	/* ... and failed to */
+		unsigned long migrated;	/* pages migrated out */
+		u64 total_us;		/* time spent taking pages back */
+		unsigned long max_us;
+	} lend;
 #endif
 
 	unsigned used:1;
@@ -263,6 +289,7 @@ struct cma_region {
 	unsigned reserved:1;
 	unsigned copy_name:1;
 	unsigned free_alloc_name:1;
+	unsigned movable:1;
 };
 
 
@@ -360,6 +387,10 @@ struct cma_chunk {
  * @free:	Frees allocated chunk.  May also assume that it is the only
  *		call that uses given region.  This has to free() the chunk
  *		object as well.  Required.
+ * @holes:	Returns the number of free holes in given region and
+ *		stores the size of the largest one in bytes.  May also
+ *		assume that it is the only call that uses given region.
+ *		Optional.
  * @list:	Entry in list of allocators.  Private.
  */
 struct cma_allocator {
@@ -370,6 +401,7 @@ struct cma_allocator {
 	struct cma_chunk *(*alloc)(struct cma_region *reg, size_t size,
 				   dma_addr_t alignment);
 	void (*free)(struct cma_chunk *chunk);
+	unsigned (*holes)(struct cma_region *reg, size_t *largest);
 
 	struct list_head list;
 };
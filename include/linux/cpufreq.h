@@ -96,6 +96,9 @@ struct cpufreq_policy {
 					 * governors are used */
         unsigned int		policy; /* see above */
 	struct cpufreq_governor	*governor; /* see below */
+	void			*governor_data; /* owned by the governor
+						 * between GOV_START and
+						 * GOV_STOP */
 
 	struct work_struct	update; /* if update_policy() needs to be
 					 * called, but you're in IRQ context */
@@ -249,9 +252,14 @@ struct cpufreq_driver {
 					 * frequency transitions */
 #define CPUFREQ_PM_NO_WARN	0x04	/* don't warn on suspend/resume speed
 					 * mismatches */
+#define CPUFREQ_TARGET_ALWAYS	0x08	/* ->target() does work of its own,
+					 * e.g. bus DVFS, so governors call it
+					 * every sample even if the frequency
+					 * stays */
 
 int cpufreq_register_driver(struct cpufreq_driver *driver_data);
 int cpufreq_unregister_driver(struct cpufreq_driver *driver_data);
+unsigned int cpufreq_driver_flags(void);
 
 
 void cpufreq_notify_transition(struct cpufreq_freqs *freqs, unsigned int state);
@@ -343,6 +351,42 @@ static inline unsigned int cpufreq_quick_get(unsigned int cpu)
 #endif
 
 
+/*********************************************************************
+ *                      DVFS SAMPLING STATISTICS                     *
+ *********************************************************************/
+
+/* periodic samplers picking a cpu frequency, core count or bus level */
+enum cpufreq_sampler {
+	CPUFREQ_SAMPLER_GOVERNOR,
+	CPUFREQ_SAMPLER_HOTPLUG,
+	CPUFREQ_SAMPLER_BUSFREQ,
+	CPUFREQ_SAMPLER_MAX,
+};
+
+/*
+ * Busy time in a sampling window, in us, that is still taken for the
+ * timer interrupt and the sample itself rather than for real work.
+ */
+#define CPUFREQ_IDLE_SLACK_US	500
+
+/* the cpu did nothing but idle between two samples */
+static inline bool cpufreq_window_idle(unsigned int wall_us,
+				       unsigned int idle_us)
+{
+	return wall_us && idle_us + CPUFREQ_IDLE_SLACK_US >= wall_us;
+}
+
+#ifdef CONFIG_CPU_FREQ
+void cpufreq_sample_account(enum cpufreq_sampler sampler, bool idle,
+			    bool skipped);
+#else
+static inline void cpufreq_sample_account(enum cpufreq_sampler sampler,
+					  bool idle, bool skipped)
+{
+}
+#endif
+
+
 /*********************************************************************
  *                       CPUFREQ DEFAULT GOVERNOR                    *
  *********************************************************************/
@@ -41,7 +41,18 @@
 #define MIGRATE_PCPTYPES      3 /* the number of types on the pcp lists */
 #define MIGRATE_RESERVE       3
 #define MIGRATE_ISOLATE       4 /* can't allocate from here */
+#ifdef CONFIG_CMA_MIGRATE
+#define MIGRATE_CMA           5 /* CMA region lent out for movable pages */
+#define MIGRATE_TYPES         6
+#else
 #define MIGRATE_TYPES         5
+#endif
+
+#ifdef CONFIG_CMA_MIGRATE
+#  define is_migrate_cma(migratetype) unlikely((migratetype) == MIGRATE_CMA)
+#else
+#  define is_migrate_cma(migratetype) false
+#endif
 
 #define for_each_migratetype_order(order, type) \
 	for (order = 0; order < MAX_ORDER; order++) \
@@ -104,6 +115,7 @@ enum zone_stat_item {
 	NR_ISOLATED_ANON,	/* Temporary isolated pages from anon lru */
 	NR_ISOLATED_FILE,	/* Temporary isolated pages from file lru */
 	NR_SHMEM,		/* shmem pages (included tmpfs/GEM pages) */
+	NR_FREE_CMA_PAGES,	/* part of NR_FREE_PAGES in MIGRATE_CMA blocks */
 #ifdef CONFIG_NUMA
 	NUMA_HIT,		/* allocated in intended node */
 	NUMA_MISS,		/* allocated in non intended node */
@@ -140,8 +140,22 @@ extern unsigned long nr_running(void);
 extern unsigned long nr_uninterruptible(void);
 extern unsigned long nr_iowait(void);
 extern unsigned long nr_iowait_cpu(int cpu);
+extern unsigned long nr_running_cpu(int cpu);
 extern unsigned long this_cpu_load(void);
 
+/* per cpu utilization for the frequency governors, see kernel/sched_util.h */
+#define SCHED_UTIL_SHIFT	10
+#define SCHED_UTIL_SCALE	(1UL << SCHED_UTIL_SHIFT)
+
+struct sched_util_hook {
+	void (*func)(struct sched_util_hook *hook, int cpu, unsigned long util);
+};
+
+extern unsigned long sched_cpu_util(int cpu);
+extern void sched_set_freq_scale(int cpu, unsigned int cur, unsigned int max);
+extern void sched_util_set_hook(int cpu, struct sched_util_hook *hook);
+extern void sched_util_clear_hook(int cpu);
+
 
 extern void calc_global_load(unsigned long ticks);
 
@@ -994,6 +1008,8 @@ static inline int test_sd_parent(struct sched_domain *sd, int flag)
 unsigned long default_scale_freq_power(struct sched_domain *sd, int cpu);
 unsigned long default_scale_smt_power(struct sched_domain *sd, int cpu);
 
+int arch_sched_pack_cpu(void);
+
 #else /* CONFIG_SMP */
 
 struct sched_domain_attr;
@@ -1135,6 +1151,10 @@ struct sched_entity {
 
 	u64			nr_migrations;
 
+	/* decayed, frequency invariant utilization, see kernel/sched_util.h */
+	u64			util_stamp;
+	unsigned long		util_avg;
+
 #ifdef CONFIG_SCHEDSTATS
 	struct sched_statistics statistics;
 #endif
@@ -1887,6 +1907,8 @@ extern enum sched_tunable_scaling sysctl_sched_tunable_scaling;
 
 #ifdef CONFIG_SCHED_DEBUG
 extern unsigned int sysctl_sched_migration_cost;
+extern unsigned int sysctl_sched_pack_util;
+extern unsigned int sysctl_sched_pack_task_util;
 extern unsigned int sysctl_sched_nr_migrate;
 extern unsigned int sysctl_sched_time_avg;
 extern unsigned int sysctl_timer_migration;
@@ -2572,8 +2594,8 @@ static inline unsigned long rlimit_max(unsigned int limit)
 	return task_rlimit_max(current, limit);
 }
 
-extern unsigned int d_hotplug_lock;
-extern unsigned int force_hotplug;
+extern int sched_hotplug_locked(void);
+extern int sched_hotplug_forced(void);
 #endif /* __KERNEL__ */
 
 #endif
@@ -0,0 +1,57 @@
+/*
+ * include/linux/suspend_profile.h
+ *
+ * Suspend/resume latency profiler
+ *
+ * Times the early suspend and late resume handlers, the sync before
+ * suspend and every device's suspend and resume callbacks. The time each
+ * phase took and its slowest handlers are kept for the last few cycles
+ * and shown in debugfs, in suspend_profile.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef __LINUX_SUSPEND_PROFILE_H
+#define __LINUX_SUSPEND_PROFILE_H
+
+#include <linux/ktime.h>
+
+struct device;
+
+/* in the order they run, a phase earlier than the last one starts a cycle */
+enum suspend_profile_phase {
+	SUSPEND_PROFILE_EARLY_SUSPEND,
+	SUSPEND_PROFILE_SYNC,
+	SUSPEND_PROFILE_SUSPEND,
+	SUSPEND_PROFILE_SUSPEND_NOIRQ,
+	SUSPEND_PROFILE_RESUME_NOIRQ,
+	SUSPEND_PROFILE_RESUME,
+	SUSPEND_PROFILE_LATE_RESUME,
+	SUSPEND_PROFILE_PHASES
+};
+
+#ifdef CONFIG_SUSPEND_PROFILE
+static inline ktime_t suspend_profile_start(void)
+{
+	return ktime_get();
+}
+
+extern void suspend_profile_handler(enum suspend_profile_phase phase,
+				    void *fn, ktime_t start);
+extern void suspend_profile_device(enum suspend_profile_phase phase,
+				   struct device *dev, ktime_t start);
+#else
+static inline ktime_t suspend_profile_start(void)
+{
+	return ktime_set(0, 0);
+}
+
+static inline void suspend_profile_handler(enum suspend_profile_phase phase,
+					   void *fn, ktime_t start) { }
+static inline void suspend_profile_device(enum suspend_profile_phase phase,
+					  struct device *dev, ktime_t start) { }
+#endif
+
+#endif /* __LINUX_SUSPEND_PROFILE_H */
@@ -306,4 +306,17 @@ static inline void restore_pgdat_percpu_threshold(pg_data_t *pgdat) { }
 static inline void refresh_cpu_vm_stats(int cpu) { }
 #endif
 
+/*
+ * Pages going to or coming off the free lists of @migratetype. Free pages
+ * in CMA pageblocks are also counted apart, only movable allocations may
+ * use them.
+ */
+static inline void __mod_zone_freepage_state(struct zone *zone, int nr_pages,
+					     int migratetype)
+{
+	__mod_zone_page_state(zone, NR_FREE_PAGES, nr_pages);
+	if (is_migrate_cma(migratetype))
+		__mod_zone_page_state(zone, NR_FREE_CMA_PAGES, nr_pages);
+}
+
 #endif /* _LINUX_VMSTAT_H */
@@ -32,6 +32,9 @@ enum {
 	WAKE_LOCK_TYPE_COUNT
 };
 
+/* activations by hold time, 1ms, then each bucket 4 times longer */
+#define WAKE_LOCK_HIST_BUCKETS 10
+
 struct wake_lock {
 #ifdef CONFIG_HAS_WAKELOCK
 	struct list_head    link;
@@ -47,6 +50,7 @@ struct wake_lock {
 		ktime_t         prevent_suspend_time;
 		ktime_t         max_time;
 		ktime_t         last_time;
+		unsigned int    hist[WAKE_LOCK_HIST_BUCKETS];
 	} stat;
 #endif
 #endif
@@ -0,0 +1,40 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM cpufreq_gov
+
+#if !defined(_TRACE_CPUFREQ_GOV_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_CPUFREQ_GOV_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(cpufreq_gov_sample,
+
+	TP_PROTO(const char *gov, unsigned int cpu, unsigned int load,
+		 unsigned int cur, unsigned int target),
+
+	TP_ARGS(gov, cpu, load, cur, target),
+
+	TP_STRUCT__entry(
+		__string(	gov,		gov		)
+		__field(	unsigned int,	cpu		)
+		__field(	unsigned int,	load		)
+		__field(	unsigned int,	cur		)
+		__field(	unsigned int,	target		)
+	),
+
+	TP_fast_assign(
+		__assign_str(gov, gov);
+		__entry->cpu = cpu;
+		__entry->load = load;
+		__entry->cur = cur;
+		__entry->target = target;
+	),
+
+	TP_printk("gov=%s cpu=%u load=%u cur=%u target=%u",
+		  __get_str(gov), __entry->cpu, __entry->load,
+		  __entry->cur, __entry->target)
+);
+
+#endif /* _TRACE_CPUFREQ_GOV_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,56 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM cpufreq_interactive
+
+#if !defined(_TRACE_CPUFREQ_INTERACTIVE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_CPUFREQ_INTERACTIVE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(cpufreq_interactive_boost,
+
+	TP_PROTO(unsigned int type, unsigned int code, unsigned int freq),
+
+	TP_ARGS(type, code, freq),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	type		)
+		__field(	unsigned int,	code		)
+		__field(	unsigned int,	freq		)
+	),
+
+	TP_fast_assign(
+		__entry->type = type;
+		__entry->code = code;
+		__entry->freq = freq;
+	),
+
+	TP_printk("type=%u code=%u freq=%u",
+		  __entry->type, __entry->code, __entry->freq)
+);
+
+TRACE_EVENT(cpufreq_interactive_boost_done,
+
+	TP_PROTO(unsigned int cpu, unsigned int freq, unsigned int latency_us),
+
+	TP_ARGS(cpu, freq, latency_us),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	cpu		)
+		__field(	unsigned int,	freq		)
+		__field(	unsigned int,	latency_us	)
+	),
+
+	TP_fast_assign(
+		__entry->cpu = cpu;
+		__entry->freq = freq;
+		__entry->latency_us = latency_us;
+	),
+
+	TP_printk("cpu=%u freq=%u latency=%uus",
+		  __entry->cpu, __entry->freq, __entry->latency_us)
+);
+
+#endif /* _TRACE_CPUFREQ_INTERACTIVE_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,38 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM sysmmu
+
+#if !defined(_TRACE_SYSMMU_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_SYSMMU_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(sysmmu_tlb_flush,
+
+	TP_PROTO(int id, unsigned int unmaps, unsigned int freed,
+		 unsigned int rate),
+
+	TP_ARGS(id, unmaps, freed, rate),
+
+	TP_STRUCT__entry(
+		__field(	int,		id		)
+		__field(	unsigned int,	unmaps		)
+		__field(	unsigned int,	freed		)
+		__field(	unsigned int,	rate		)
+	),
+
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->unmaps = unmaps;
+		__entry->freed = freed;
+		__entry->rate = rate;
+	),
+
+	TP_printk("id=%d unmaps=%u freed=%u flushes_per_sec=%u",
+		  __entry->id, __entry->unmaps, __entry->freed,
+		  __entry->rate)
+);
+
+#endif /* _TRACE_SYSMMU_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
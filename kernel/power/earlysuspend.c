@@ -17,6 +17,7 @@
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/rtc.h>
+#include <linux/suspend_profile.h>
 #include <linux/syscalls.h> /* sys_sync */
 #include <linux/wakelock.h>
 #include <linux/workqueue.h>
@@ -88,6 +89,7 @@ static void early_suspend(struct work_struct *work)
 {
 	struct early_suspend *pos;
 	unsigned long irqflags;
+	ktime_t start;
 	int abort = 0;
 
 	mutex_lock(&early_suspend_lock);
@@ -108,8 +110,12 @@ static void early_suspend(struct work_struct *work)
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("early_suspend: call handlers\n");
 	list_for_each_entry(pos, &early_suspend_handlers, link) {
-		if (pos->suspend != NULL)
+		if (pos->suspend != NULL) {
+			start = suspend_profile_start();
 			pos->suspend(pos);
+			suspend_profile_handler(SUSPEND_PROFILE_EARLY_SUSPEND,
+						pos->suspend, start);
+		}
 	}
 	mutex_unlock(&early_suspend_lock);
 
@@ -130,6 +136,7 @@ static void late_resume(struct work_struct *work)
 {
 	struct early_suspend *pos;
 	unsigned long irqflags;
+	ktime_t start;
 	int abort = 0;
 
 	mutex_lock(&early_suspend_lock);
@@ -149,7 +156,10 @@ static void late_resume(struct work_struct *work)
 		pr_info("late_resume: call handlers\n");
 	list_for_each_entry_reverse(pos, &early_suspend_handlers, link)
 		if (pos->resume != NULL) {
+			start = suspend_profile_start();
 			pos->resume(pos);
+			suspend_profile_handler(SUSPEND_PROFILE_LATE_RESUME,
+						pos->resume, start);
 			if (in_atomic()) {
 				pr_err("%s: became atomic after executing %p(%p)\n",
 				       __func__, pos->resume, pos);
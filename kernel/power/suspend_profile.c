@@ -0,0 +1,203 @@
+/* kernel/power/suspend_profile.c
+ *
+ * Suspend/resume latency profiler
+ *
+ * A new cycle starts with a handler of an earlier phase than the last
+ * one timed: the first early suspend handler after a late resume, or the
+ * sync before suspending again while the screen stays off. For each of
+ * the last SUSPEND_PROFILE_CYCLES cycles the time from the start of the
+ * first handler of a phase to the end of its last one is kept, async
+ * device callbacks included, along with the SUSPEND_PROFILE_SLOWEST
+ * slowest handlers of the cycle.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/debugfs.h>
+#include <linux/device.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/suspend_profile.h>
+
+#define SUSPEND_PROFILE_CYCLES	16
+#define SUSPEND_PROFILE_SLOWEST	8
+
+struct suspend_profile_entry {
+	void *fn;		/* the handler, NULL for a device */
+	char name[32];		/* driver and device name */
+	enum suspend_profile_phase phase;
+	u32 usecs;
+};
+
+struct suspend_profile_cycle {
+	unsigned int seq;
+	enum suspend_profile_phase last;
+	unsigned int calls[SUSPEND_PROFILE_PHASES];
+	ktime_t begin[SUSPEND_PROFILE_PHASES];
+	ktime_t end[SUSPEND_PROFILE_PHASES];
+	int nr_slowest;
+	struct suspend_profile_entry slowest[SUSPEND_PROFILE_SLOWEST];
+};
+
+static const char *phase_names[SUSPEND_PROFILE_PHASES] = {
+	[SUSPEND_PROFILE_EARLY_SUSPEND]	= "early_suspend",
+	[SUSPEND_PROFILE_SYNC]		= "sync",
+	[SUSPEND_PROFILE_SUSPEND]	= "suspend",
+	[SUSPEND_PROFILE_SUSPEND_NOIRQ]	= "suspend_noirq",
+	[SUSPEND_PROFILE_RESUME_NOIRQ]	= "resume_noirq",
+	[SUSPEND_PROFILE_RESUME]	= "resume",
+	[SUSPEND_PROFILE_LATE_RESUME]	= "late_resume",
+};
+
+static DEFINE_SPINLOCK(profile_lock);
+static struct suspend_profile_cycle cycles[SUSPEND_PROFILE_CYCLES];
+static unsigned int nr_cycles;
+
+static void suspend_profile_add(enum suspend_profile_phase phase, void *fn,
+				struct device *dev, ktime_t start)
+{
+	struct suspend_profile_cycle *c;
+	struct suspend_profile_entry *e;
+	unsigned long flags;
+	ktime_t now = ktime_get();
+	u32 usecs = ktime_us_delta(now, start);
+	int i;
+
+	spin_lock_irqsave(&profile_lock, flags);
+	c = &cycles[(nr_cycles - 1) % SUSPEND_PROFILE_CYCLES];
+	if (!nr_cycles || phase < c->last) {
+		c = &cycles[nr_cycles % SUSPEND_PROFILE_CYCLES];
+		memset(c, 0, sizeof(*c));
+		c->seq = nr_cycles++;
+	}
+	c->last = phase;
+
+	if (!c->calls[phase]++ || ktime_to_ns(start) <
+				  ktime_to_ns(c->begin[phase]))
+		c->begin[phase] = start;
+	if (ktime_to_ns(now) > ktime_to_ns(c->end[phase]))
+		c->end[phase] = now;
+
+	/* keep the slowest handlers sorted, the slowest first */
+	for (i = 0; i < c->nr_slowest; i++)
+		if (usecs > c->slowest[i].usecs)
+			break;
+	if (i == SUSPEND_PROFILE_SLOWEST)
+		goto out;
+	if (c->nr_slowest < SUSPEND_PROFILE_SLOWEST)
+		c->nr_slowest++;
+	memmove(&c->slowest[i + 1], &c->slowest[i],
+		(c->nr_slowest - i - 1) * sizeof(*e));
+
+	e = &c->slowest[i];
+	e->fn = fn;
+	e->phase = phase;
+	e->usecs = usecs;
+	if (dev)
+		snprintf(e->name, sizeof(e->name), "%s %s",
+			 dev_driver_string(dev), dev_name(dev));
+	else
+		e->name[0] = '\0';
+out:
+	spin_unlock_irqrestore(&profile_lock, flags);
+}
+
+/**
+ * suspend_profile_handler - account for an early suspend handler or sync
+ * @phase: phase the handler ran in
+ * @fn: the handler, shown by symbol name
+ * @start: suspend_profile_start() before calling it
+ */
+void suspend_profile_handler(enum suspend_profile_phase phase, void *fn,
+			     ktime_t start)
+{
+	suspend_profile_add(phase, fn, NULL, start);
+}
+
+/**
+ * suspend_profile_device - account for the callbacks of a device
+ * @phase: phase the callbacks ran in
+ * @dev: the device
+ * @start: suspend_profile_start() before calling them
+ *
+ * May be called with interrupts off.
+ */
+void suspend_profile_device(enum suspend_profile_phase phase,
+			    struct device *dev, ktime_t start)
+{
+	suspend_profile_add(phase, NULL, dev, start);
+}
+
+static int suspend_profile_show(struct seq_file *m, void *unused)
+{
+	struct suspend_profile_cycle *c;
+	struct suspend_profile_entry *e;
+	unsigned long flags;
+	unsigned int n, count;
+	int p, i;
+
+	spin_lock_irqsave(&profile_lock, flags);
+	count = min_t(unsigned int, nr_cycles, SUSPEND_PROFILE_CYCLES);
+	for (n = 0; n < count; n++) {
+		c = &cycles[(nr_cycles - 1 - n) % SUSPEND_PROFILE_CYCLES];
+
+		seq_printf(m, "cycle %u\n", c->seq);
+		for (p = 0; p < SUSPEND_PROFILE_PHASES; p++) {
+			if (!c->calls[p])
+				continue;
+			seq_printf(m, "  %-14s %4u calls %8lld us\n",
+				   phase_names[p], c->calls[p],
+				   ktime_us_delta(c->end[p], c->begin[p]));
+		}
+		if (c->calls[SUSPEND_PROFILE_RESUME_NOIRQ] &&
+		    c->calls[SUSPEND_PROFILE_LATE_RESUME])
+			seq_printf(m, "  resume to screen on %lld us\n",
+				   ktime_us_delta(
+					c->end[SUSPEND_PROFILE_LATE_RESUME],
+					c->begin[SUSPEND_PROFILE_RESUME_NOIRQ]));
+
+		for (i = 0; i < c->nr_slowest; i++) {
+			e = &c->slowest[i];
+			seq_printf(m, "    %-14s %8u us  ",
+				   phase_names[e->phase], e->usecs);
+			if (e->fn)
+				seq_printf(m, "%pf\n", e->fn);
+			else
+				seq_printf(m, "%s\n", e->name);
+		}
+	}
+	spin_unlock_irqrestore(&profile_lock, flags);
+
+	return 0;
+}
+
+static int suspend_profile_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, suspend_profile_show, NULL);
+}
+
+static const struct file_operations suspend_profile_fops = {
+	.open		= suspend_profile_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init suspend_profile_init(void)
+{
+	debugfs_create_file("suspend_profile", S_IRUGO, NULL, NULL,
+			    &suspend_profile_fops);
+	return 0;
+}
+late_initcall(suspend_profile_init);
@@ -14,6 +14,7 @@
  */
 
 #include <linux/ctype.h>
+#include <linux/dcache.h>
 #include <linux/module.h>
 #include <linux/wakelock.h>
 #include <linux/slab.h>
@@ -32,8 +33,13 @@ module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 
 static DEFINE_MUTEX(tree_lock);
 
+/*
+ * The tree is ordered by name hash first, so a lookup mostly compares
+ * integers and only looks at the name of the lock it finds.
+ */
 struct user_wake_lock {
 	struct rb_node		node;
+	unsigned int		hash;
 	struct wake_lock	wake_lock;
 	char			name[0];
 };
@@ -48,6 +54,7 @@ static struct user_wake_lock *lookup_wake_lock_name(
 	int diff;
 	u64 timeout;
 	int name_len;
+	unsigned int hash;
 	const char *arg;
 
 	/* Find length of lock name and start of optional timeout string */
@@ -79,12 +86,17 @@ static struct user_wake_lock *lookup_wake_lock_name(
 		*timeoutptr = 0;
 
 	/* Lookup wake lock in rbtree */
+	hash = full_name_hash(buf, name_len);
 	while (*p) {
 		parent = *p;
 		l = rb_entry(parent, struct user_wake_lock, node);
-		diff = strncmp(buf, l->name, name_len);
-		if (!diff && l->name[name_len])
-			diff = -1;
+		if (hash != l->hash)
+			diff = hash < l->hash ? -1 : 1;
+		else {
+			diff = strncmp(buf, l->name, name_len);
+			if (!diff && l->name[name_len])
+				diff = -1;
+		}
 		if (debug_mask & DEBUG_ERROR)
 			pr_info("lookup_wake_lock_name: compare %.*s %s %d\n",
 				name_len, buf, l->name, diff);
@@ -112,6 +124,7 @@ static struct user_wake_lock *lookup_wake_lock_name(
 		return ERR_PTR(-ENOMEM);
 	}
 	memcpy(l->name, buf, name_len);
+	l->hash = hash;
 	if (debug_mask & DEBUG_NEW)
 		pr_info("lookup_wake_lock_name: new wake lock %s\n", l->name);
 	wake_lock_init(&l->wake_lock, WAKE_LOCK_SUSPEND, l->name);
@@ -17,6 +17,7 @@
 #include <linux/platform_device.h>
 #include <linux/rtc.h>
 #include <linux/suspend.h>
+#include <linux/suspend_profile.h>
 #include <linux/syscalls.h> /* sys_sync */
 #include <linux/wakelock.h>
 #ifdef CONFIG_WAKELOCK_STAT
@@ -42,7 +43,10 @@ module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 
 static DEFINE_SPINLOCK(list_lock);
 static LIST_HEAD(inactive_locks);
+/* active locks without a timeout */
 static struct list_head active_wake_locks[WAKE_LOCK_TYPE_COUNT];
+/* active locks with a timeout, the one expiring first at the head */
+static struct list_head timed_wake_locks[WAKE_LOCK_TYPE_COUNT];
 static int current_event_num;
 struct workqueue_struct *suspend_work_queue;
 struct workqueue_struct *sync_work_queue;
@@ -136,6 +140,58 @@ static int wakelock_stats_show(struct seq_file *m, void *unused)
 	for (type = 0; type < WAKE_LOCK_TYPE_COUNT; type++) {
 		list_for_each_entry(lock, &active_wake_locks[type], link)
 			ret = print_lock_stat(m, lock);
+		list_for_each_entry(lock, &timed_wake_locks[type], link)
+			ret = print_lock_stat(m, lock);
+	}
+	spin_unlock_irqrestore(&list_lock, irqflags);
+	return 0;
+}
+
+/*
+ * Activations by how long the lock was held: under 1ms, then under 4ms,
+ * 16ms, 64ms, 256ms, 1s, 4s, 16s, 64s and the rest.
+ */
+static void wake_lock_hist_add(struct wake_lock *lock, ktime_t duration)
+{
+	s64 ms = ktime_to_ms(duration);
+	int bucket;
+
+	if (ms <= 0)
+		bucket = 0;
+	else if (ms >= 1 << (2 * (WAKE_LOCK_HIST_BUCKETS - 2)))
+		bucket = WAKE_LOCK_HIST_BUCKETS - 1;
+	else
+		bucket = (fls((int)ms) + 1) / 2;
+	lock->stat.hist[bucket]++;
+}
+
+static int print_lock_hist(struct seq_file *m, struct wake_lock *lock)
+{
+	int i;
+
+	seq_printf(m, "\"%s\"", lock->name);
+	for (i = 0; i < WAKE_LOCK_HIST_BUCKETS; i++)
+		seq_printf(m, "\t%u", lock->stat.hist[i]);
+	return seq_putc(m, '\n');
+}
+
+static int wakelock_hist_show(struct seq_file *m, void *unused)
+{
+	unsigned long irqflags;
+	struct wake_lock *lock;
+	int type;
+
+	spin_lock_irqsave(&list_lock, irqflags);
+
+	seq_puts(m, "name\t<1ms\t<4ms\t<16ms\t<64ms\t<256ms\t<1s\t<4s"
+			"\t<16s\t<64s\t>=64s\n");
+	list_for_each_entry(lock, &inactive_locks, link)
+		print_lock_hist(m, lock);
+	for (type = 0; type < WAKE_LOCK_TYPE_COUNT; type++) {
+		list_for_each_entry(lock, &active_wake_locks[type], link)
+			print_lock_hist(m, lock);
+		list_for_each_entry(lock, &timed_wake_locks[type], link)
+			print_lock_hist(m, lock);
 	}
 	spin_unlock_irqrestore(&list_lock, irqflags);
 	return 0;
@@ -155,6 +211,7 @@ static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 	if (expired)
 		lock->stat.expire_count++;
 	duration = ktime_sub(now, lock->stat.last_time);
+	wake_lock_hist_add(lock, duration);
 	lock->stat.total_time = ktime_add(lock->stat.total_time, duration);
 	if (ktime_to_ns(duration) > ktime_to_ns(lock->stat.max_time))
 		lock->stat.max_time = duration;
@@ -167,15 +224,14 @@ static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 	}
 }
 
-static void update_sleep_wait_stats_locked(int done)
+static void update_sleep_wait_stats_list_locked(struct list_head *list,
+		int done, ktime_t elapsed)
 {
 	struct wake_lock *lock;
-	ktime_t now, etime, elapsed, add;
+	ktime_t etime, add;
 	int expired;
 
-	now = ktime_get();
-	elapsed = ktime_sub(now, last_sleep_time_update);
-	list_for_each_entry(lock, &active_wake_locks[WAKE_LOCK_SUSPEND], link) {
+	list_for_each_entry(lock, list, link) {
 		expired = get_expired_time(lock, &etime);
 		if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND) {
 			if (expired)
@@ -190,6 +246,18 @@ static void update_sleep_wait_stats_locked(int done)
 		else
 			lock->flags |= WAKE_LOCK_PREVENTING_SUSPEND;
 	}
+}
+
+static void update_sleep_wait_stats_locked(int done)
+{
+	ktime_t now, elapsed;
+
+	now = ktime_get();
+	elapsed = ktime_sub(now, last_sleep_time_update);
+	update_sleep_wait_stats_list_locked(
+		&active_wake_locks[WAKE_LOCK_SUSPEND], done, elapsed);
+	update_sleep_wait_stats_list_locked(
+		&timed_wake_locks[WAKE_LOCK_SUSPEND], done, elapsed);
 	last_sleep_time_update = now;
 }
 #endif
@@ -215,38 +283,58 @@ static void print_active_locks(int type)
 
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
 	list_for_each_entry(lock, &active_wake_locks[type], link) {
-		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
-			long timeout = lock->expires - jiffies;
-			if (timeout > 0)
-				pr_info("active wake lock %s, time left %ld\n",
-					lock->name, timeout);
-			else if (print_expired)
-				pr_info("wake lock %s, expired\n", lock->name);
-		} else {
-			pr_info("active wake lock %s\n", lock->name);
-			if (!(debug_mask & DEBUG_EXPIRE))
-				print_expired = false;
-		}
+		pr_info("active wake lock %s\n", lock->name);
+		if (!(debug_mask & DEBUG_EXPIRE))
+			print_expired = false;
+	}
+	list_for_each_entry(lock, &timed_wake_locks[type], link) {
+		long timeout = lock->expires - jiffies;
+		if (timeout > 0)
+			pr_info("active wake lock %s, time left %ld\n",
+				lock->name, timeout);
+		else if (print_expired)
+			pr_info("wake lock %s, expired\n", lock->name);
 	}
 }
 
+/*
+ * Only the locks that expired are looked at: the rest of the timed locks
+ * expire after them and the last one tells how long they last.
+ */
 static long has_wake_lock_locked(int type)
 {
-	struct wake_lock *lock, *n;
-	long max_timeout = 0;
+	struct list_head *timed = &timed_wake_locks[type];
+	struct wake_lock *lock;
 
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
-	list_for_each_entry_safe(lock, n, &active_wake_locks[type], link) {
-		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
-			long timeout = lock->expires - jiffies;
-			if (timeout <= 0)
-				expire_wake_lock(lock);
-			else if (timeout > max_timeout)
-				max_timeout = timeout;
-		} else
-			return -1;
+	if (!list_empty(&active_wake_locks[type]))
+		return -1;
+
+	while (!list_empty(timed)) {
+		lock = list_first_entry(timed, struct wake_lock, link);
+		if ((long)(lock->expires - jiffies) > 0)
+			break;
+		expire_wake_lock(lock);
+	}
+	if (list_empty(timed))
+		return 0;
+
+	lock = list_entry(timed->prev, struct wake_lock, link);
+	return lock->expires - jiffies;
+}
+
+/* Locks mostly get the same timeouts, so look from the tail */
+static void add_timed_wake_lock_locked(struct wake_lock *lock, int type)
+{
+	struct list_head *pos;
+	struct wake_lock *l;
+
+	list_for_each_prev(pos, &timed_wake_locks[type]) {
+		l = list_entry(pos, struct wake_lock, link);
+		if (!time_before(lock->expires, l->expires))
+			break;
 	}
-	return max_timeout;
+	list_add(&lock->link, pos);
 }
 
 long has_wake_lock(int type)
@@ -265,6 +353,7 @@ static void suspend(struct work_struct *work)
 {
 	int ret;
 	int entry_event_num;
+	ktime_t start;
 
 	if (has_wake_lock(WAKE_LOCK_SUSPEND)) {
 		if (debug_mask & DEBUG_SUSPEND)
@@ -272,7 +361,9 @@ static void suspend(struct work_struct *work)
 		return;
 	}
 	entry_event_num = current_event_num;
+	start = suspend_profile_start();
 	sys_sync();
+	suspend_profile_handler(SUSPEND_PROFILE_SYNC, sys_sync, start);
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("suspend: enter suspend\n");
 	ret = pm_suspend(requested_suspend_state);
@@ -353,6 +444,7 @@ void wake_lock_init(struct wake_lock *lock, int type, const char *name)
 	lock->stat.prevent_suspend_time = ktime_set(0, 0);
 	lock->stat.max_time = ktime_set(0, 0);
 	lock->stat.last_time = ktime_set(0, 0);
+	memset(lock->stat.hist, 0, sizeof(lock->stat.hist));
 #endif
 	lock->flags = (type & WAKE_LOCK_TYPE_MASK) | WAKE_LOCK_INITIALIZED;
 
@@ -366,6 +458,10 @@ EXPORT_SYMBOL(wake_lock_init);
 void wake_lock_destroy(struct wake_lock *lock)
 {
 	unsigned long irqflags;
+#ifdef CONFIG_WAKELOCK_STAT
+	int i;
+#endif
+
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_lock_destroy name=%s\n", lock->name);
 	spin_lock_irqsave(&list_lock, irqflags);
@@ -383,6 +479,8 @@ void wake_lock_destroy(struct wake_lock *lock)
 		deleted_wake_locks.stat.max_time =
 			ktime_add(deleted_wake_locks.stat.max_time,
 				  lock->stat.max_time);
+		for (i = 0; i < WAKE_LOCK_HIST_BUCKETS; i++)
+			deleted_wake_locks.stat.hist[i] += lock->stat.hist[i];
 	}
 #endif
 	list_del(&lock->link);
@@ -428,7 +526,7 @@ static void wake_lock_internal(
 				(timeout % HZ) * MSEC_PER_SEC / HZ);
 		lock->expires = jiffies + timeout;
 		lock->flags |= WAKE_LOCK_AUTO_EXPIRE;
-		list_add_tail(&lock->link, &active_wake_locks[type]);
+		add_timed_wake_lock_locked(lock, type);
 	} else {
 		if (debug_mask & DEBUG_WAKE_LOCK)
 			pr_info("wake_lock: %s, type %d\n", lock->name, type);
@@ -537,13 +635,28 @@ static const struct file_operations wakelock_stats_fops = {
 	.release = single_release,
 };
 
+static int wakelock_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wakelock_hist_show, NULL);
+}
+
+static const struct file_operations wakelock_hist_fops = {
+	.owner = THIS_MODULE,
+	.open = wakelock_hist_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int __init wakelocks_init(void)
 {
 	int ret;
 	int i;
 
-	for (i = 0; i < ARRAY_SIZE(active_wake_locks); i++)
+	for (i = 0; i < ARRAY_SIZE(active_wake_locks); i++) {
 		INIT_LIST_HEAD(&active_wake_locks[i]);
+		INIT_LIST_HEAD(&timed_wake_locks[i]);
+	}
 
 #ifdef CONFIG_WAKELOCK_STAT
 	wake_lock_init(&deleted_wake_locks, WAKE_LOCK_SUSPEND,
@@ -579,6 +692,7 @@ static int __init wakelocks_init(void)
 
 #ifdef CONFIG_WAKELOCK_STAT
 	proc_create("wakelocks", S_IRUGO, NULL, &wakelock_stats_fops);
+	proc_create("wakelock_histogram", S_IRUGO, NULL, &wakelock_hist_fops);
 #endif
 
 	return 0;
@@ -602,6 +716,7 @@ err_platform_device_register:
 static void  __exit wakelocks_exit(void)
 {
 #ifdef CONFIG_WAKELOCK_STAT
+	remove_proc_entry("wakelock_histogram", NULL);
 	remove_proc_entry("wakelocks", NULL);
 #endif
 	destroy_workqueue(suspend_work_queue);
@@ -499,6 +499,11 @@ struct rq {
 
 	atomic_t nr_iowait;
 
+	/* decayed, frequency invariant utilization, see sched_util.h */
+	u64 util_stamp;
+	unsigned long util_avg;
+	int util_busy;
+
 #ifdef CONFIG_SMP
 	struct root_domain *rd;
 	struct sched_domain *sd;
@@ -1951,14 +1956,18 @@ static void sched_irq_time_avg_update(struct rq *rq, u64 curr_irq_time) { }
 
 #include "sched_stats.h"
 
+#include "sched_util.h"
+
 static void inc_nr_running(struct rq *rq)
 {
 	rq->nr_running++;
+	sched_util_nr_running(rq);
 }
 
 static void dec_nr_running(struct rq *rq)
 {
 	rq->nr_running--;
+	sched_util_nr_running(rq);
 }
 
 static void set_load_weight(struct task_struct *p)
@@ -1980,6 +1989,7 @@ static void enqueue_task(struct rq *rq, struct task_struct *p, int flags)
 {
 	update_rq_clock(rq);
 	sched_info_queued(p);
+	sched_util_enqueue(rq, p, flags);
 	p->sched_class->enqueue_task(rq, p, flags);
 	p->se.on_rq = 1;
 }
@@ -1988,6 +1998,7 @@ static void dequeue_task(struct rq *rq, struct task_struct *p, int flags)
 {
 	update_rq_clock(rq);
 	sched_info_dequeued(p);
+	sched_util_dequeue(rq, p, flags);
 	p->sched_class->dequeue_task(rq, p, flags);
 	p->se.on_rq = 0;
 }
@@ -2016,6 +2027,7 @@ static void deactivate_task(struct rq *rq, struct task_struct *p, int flags)
 	dec_nr_running(rq);
 }
 
+#include "sched_monitor.h"
 #include "sched_idletask.c"
 #include "sched_fair.c"
 #include "sched_rt.c"
@@ -2552,6 +2564,8 @@ static void __sched_fork(struct task_struct *p)
 	p->se.sum_exec_runtime		= 0;
 	p->se.prev_sum_exec_runtime	= 0;
 	p->se.nr_migrations		= 0;
+	p->se.util_stamp		= 0;
+	p->se.util_avg			= 0;
 
 #ifdef CONFIG_SCHEDSTATS
 	memset(&p->se.statistics, 0, sizeof(p->se.statistics));
@@ -2999,6 +3013,11 @@ unsigned long nr_iowait_cpu(int cpu)
 	return atomic_read(&this->nr_iowait);
 }
 
+unsigned long nr_running_cpu(int cpu)
+{
+	return cpu_rq(cpu)->nr_running;
+}
+
 unsigned long this_cpu_load(void)
 {
 	struct rq *this = this_rq();
@@ -3762,6 +3781,7 @@ void scheduler_tick(void)
 	raw_spin_lock(&rq->lock);
 	update_rq_clock(rq);
 	update_cpu_load_active(rq);
+	sched_util_tick(rq);
 	curr->sched_class->task_tick(rq, curr, 0);
 	raw_spin_unlock(&rq->lock);
 
@@ -278,6 +278,7 @@ static void print_cpu(struct seq_file *m, int cpu)
 	P(cpu_load[2]);
 	P(cpu_load[3]);
 	P(cpu_load[4]);
+	P(util_avg);
 #undef P
 #undef PN
 
@@ -342,6 +343,19 @@ static int sched_debug_show(struct seq_file *m, void *v)
 		sysctl_sched_tunable_scaling,
 		sched_tunable_scaling_names[sysctl_sched_tunable_scaling]);
 
+#ifdef CONFIG_SMP
+#define P(x) \
+	SEQ_printf(m, "  .%-40s: %Ld\n", #x, (long long)(x))
+	P(sysctl_sched_pack_util);
+	P(sysctl_sched_pack_task_util);
+	P(sched_pack_stats.packed);
+	P(sched_pack_stats.big);
+	P(sched_pack_stats.full);
+	P(sched_pack_stats.lb_kept);
+	P(sched_pack_stats.hotplug_released);
+#undef P
+#endif
+
 	for_each_online_cpu(cpu)
 		print_cpu(m, cpu);
 
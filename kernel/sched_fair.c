@@ -89,6 +89,15 @@ unsigned int normalized_sysctl_sched_wakeup_granularity = 1000000UL;
 
 const_debug unsigned int sysctl_sched_migration_cost = 500000UL;
 
+/*
+ * Power aware packing: utilization of cpu0 (SCHED_UTIL_SCALE based) up
+ * to which small tasks are kept there, and the utilization below which
+ * a task counts as small.
+ * (default: 640 (~60%) and 200 (~20%))
+ */
+const_debug unsigned int sysctl_sched_pack_util = 640;
+const_debug unsigned int sysctl_sched_pack_task_util = 200;
+
 static const struct sched_class fair_sched_class;
 
 /**************************************************************
@@ -1383,6 +1392,94 @@ find_idlest_cpu(struct sched_group *group, struct task_struct *p, int this_cpu)
 	return idlest;
 }
 
+/*
+ * Power aware packing
+ *
+ * Two small tasks spread over both cores keep the second one busy
+ * although the first could run both at a modest speed, and a dynamic
+ * hotplug policy then never gets to take a core down. While the pack cpu
+ * has room below sysctl_sched_pack_util, small tasks are woken on it and
+ * the load balancer leaves them there; past the threshold the usual
+ * spreading takes over.
+ */
+
+/*
+ * The cpu small tasks are packed on, or -1 not to pack. Platforms that
+ * take cores down when idle return the one they keep online.
+ */
+int __weak arch_sched_pack_cpu(void)
+{
+	return -1;
+}
+
+static struct sched_pack_stats {
+	unsigned long packed;		/* placed on the pack cpu */
+	unsigned long big;		/* task too big to be packed */
+	unsigned long full;		/* pack cpu without room */
+	unsigned long lb_kept;		/* balancing did not pull from it */
+	unsigned long hotplug_released;	/* cpu1 not held for packed load */
+} sched_pack_stats;
+
+static inline int sched_pack_room(int pack_cpu, unsigned long extra)
+{
+	return pack_cpu >= 0 && cpu_active(pack_cpu) &&
+	       sched_cpu_util(pack_cpu) + extra < sysctl_sched_pack_util;
+}
+
+/* the cpu to wake p on, or -1 to place it as usual */
+static int sched_pack_task(struct task_struct *p)
+{
+	int pack_cpu;
+
+	if (!sched_feat(POWER_PACKING) || num_online_cpus() == 1)
+		return -1;
+
+	pack_cpu = arch_sched_pack_cpu();
+	if (pack_cpu < 0 || !cpumask_test_cpu(pack_cpu, &p->cpus_allowed))
+		return -1;
+
+	if (p->se.util_avg >= sysctl_sched_pack_task_util) {
+		sched_pack_stats.big++;
+		return -1;
+	}
+
+	if (!sched_pack_room(pack_cpu, p->se.util_avg)) {
+		sched_pack_stats.full++;
+		return -1;
+	}
+
+	sched_pack_stats.packed++;
+	return pack_cpu;
+}
+
+/* don't pull packed tasks off the pack cpu while it has room */
+static inline int sched_pack_keep(int this_cpu, struct rq *busiest)
+{
+	int pack_cpu;
+
+	if (!sched_feat(POWER_PACKING))
+		return 0;
+
+	pack_cpu = arch_sched_pack_cpu();
+	if (this_cpu == pack_cpu || cpu_of(busiest) != pack_cpu ||
+	    !sched_pack_room(pack_cpu, 0))
+		return 0;
+
+	sched_pack_stats.lb_kept++;
+	return 1;
+}
+
+/* called from update_hotplug_monitor(), see sched_monitor.h */
+static int sched_pack_release_cpu1(void)
+{
+	if (!sched_feat(POWER_PACKING) ||
+	    !sched_pack_room(arch_sched_pack_cpu(), 0))
+		return 0;
+
+	sched_pack_stats.hotplug_released++;
+	return 1;
+}
+
 /*
  * Try and locate an idle CPU in the sched_domain.
  */
@@ -1456,6 +1553,11 @@ select_task_rq_fair(struct rq *rq, struct task_struct *p, int sd_flag, int wake_
 	int sync = wake_flags & WF_SYNC;
 
 	if (sd_flag & SD_BALANCE_WAKE) {
+		int pack_cpu = sched_pack_task(p);
+
+		if (pack_cpu >= 0)
+			return pack_cpu;
+
 		if (cpumask_test_cpu(cpu, &p->cpus_allowed))
 			want_affine = 1;
 		new_cpu = prev_cpu;
@@ -2880,7 +2982,7 @@ static int active_load_balance_cpu_stop(void *data);
  */
 static int load_balance(int this_cpu, struct rq *this_rq,
 			struct sched_domain *sd, enum cpu_idle_type idle,
-			int *balance)
+			int *balance, unsigned long *lb_imbalance)
 {
 	int ld_moved, all_pinned = 0, active_balance = 0, sd_idle = 0;
 	struct sched_group *group;
@@ -2891,6 +2993,9 @@ static int load_balance(int this_cpu, struct rq *this_rq,
 
 	cpumask_copy(cpus, cpu_active_mask);
 
+	if (lb_imbalance)
+		*lb_imbalance = 0;
+
 	/*
 	 * When power savings policy is enabled for the parent domain, idle
 	 * sibling can pick up load irrespective of busy siblings. In this case,
@@ -2924,7 +3029,12 @@ redo:
 
 	BUG_ON(busiest == this_rq);
 
+	if (sched_pack_keep(this_cpu, busiest))
+		goto out_balanced;
+
 	schedstat_add(sd, lb_imbalance[idle], imbalance);
+	if (lb_imbalance)
+		*lb_imbalance = imbalance;
 
 	ld_moved = 0;
 	if (busiest->nr_running > 1) {
@@ -3080,7 +3190,8 @@ static void idle_balance(int this_cpu, struct rq *this_rq)
 		if (sd->flags & SD_BALANCE_NEWIDLE) {
 			/* If we've pulled tasks over stop searching: */
 			pulled_task = load_balance(this_cpu, this_rq,
-						   sd, CPU_NEWLY_IDLE, &balance);
+						   sd, CPU_NEWLY_IDLE, &balance,
+						   NULL);
 		}
 
 		interval = msecs_to_jiffies(sd->balance_interval);
@@ -3437,6 +3548,10 @@ static void rebalance_domains(int cpu, enum cpu_idle_type idle)
 	unsigned long next_balance = jiffies + 60*HZ;
 	int update_next_balance = 0;
 	int need_serialize;
+	int moved;
+	/* imbalance and tasks pulled at the topmost domain balanced */
+	unsigned long imbalance, top_imbalance = 0;
+	unsigned int top_pulled = 0;
 
 	for_each_domain(cpu, sd) {
 		if (!(sd->flags & SD_LOAD_BALANCE))
@@ -3461,7 +3576,9 @@ static void rebalance_domains(int cpu, enum cpu_idle_type idle)
 		}
 
 		if (time_after_eq(jiffies, sd->last_balance + interval)) {
-			if (load_balance(cpu, rq, sd, idle, &balance)) {
+			moved = load_balance(cpu, rq, sd, idle, &balance,
+					     &imbalance);
+			if (moved) {
 				/*
 				 * We've pulled tasks over so either we're no
 				 * longer idle, or one of our SMT siblings is
@@ -3470,6 +3587,11 @@ static void rebalance_domains(int cpu, enum cpu_idle_type idle)
 				idle = CPU_NOT_IDLE;
 			}
 			sd->last_balance = jiffies;
+			/* not ours to balance when another cpu of the group is */
+			if (balance) {
+				top_imbalance = imbalance;
+				top_pulled = moved > 0 ? moved : 0;
+			}
 		}
 		if (need_serialize)
 			spin_unlock(&balancing);
@@ -3495,6 +3617,9 @@ out:
 	 */
 	if (likely(update_next_balance))
 		rq->next_balance = next_balance;
+
+	/* refresh the hints consumed by the dynamic cpu hotplug policy */
+	update_hotplug_monitor(cpu, top_imbalance, top_pulled);
 }
 
 #ifdef CONFIG_NO_HZ
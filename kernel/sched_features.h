@@ -66,3 +66,9 @@ SCHED_FEAT(OWNER_SPIN, 1)
  * Decrement CPU power based on irq activity
  */
 SCHED_FEAT(NONIRQ_POWER, 1)
+
+/*
+ * Wake small tasks on arch_sched_pack_cpu() while it has room, so the
+ * other cores can go offline
+ */
+SCHED_FEAT(POWER_PACKING, 0)
@@ -10,8 +10,18 @@
  * published by the Free Software Foundation.
  */
 #ifdef CONFIG_SMP
-unsigned int d_hotplug_lock;
-unsigned int force_hotplug;
+/*
+ * Written by rebalance_domains() for the cpu it balanced, from that
+ * cpu's softirq or the nohz idle balancer's, read by the hotplug policy.
+ */
+struct hotplug_hint {
+	unsigned int lock;	/* keep cpu1 online */
+	unsigned int force;	/* cpu0 idle outside load balancing */
+};
+
+static DEFINE_PER_CPU(struct hotplug_hint, hotplug_hint);
+
+static int sched_pack_release_cpu1(void);
 
 static int is_rt_task_run(struct task_struct *p)
 {
@@ -20,24 +30,32 @@ static int is_rt_task_run(struct task_struct *p)
     return (rq->rt.rt_nr_running?1:0);
 }
 
-static void update_hotplug_monitor(struct sched_domain *sd, unsigned int on_load_balance)
+/*
+ * imbalance and pulled are what load_balance() found and moved at the
+ * topmost domain this cpu balanced in this pass.
+ */
+static void update_hotplug_monitor(int this_cpu, unsigned long imbalance,
+				   unsigned int pulled)
 {
-	unsigned int cpu, run_task_prio[2];
+	struct hotplug_hint *hint = &per_cpu(hotplug_hint, this_cpu);
+	unsigned int cpu, run_task_prio[2] = { 0, 0 };
+	unsigned int rt_on_cpu1 = 0;
+	unsigned int lock = 0;
     	struct task_struct *p;
 
-	d_hotplug_lock = 0;
-	
-	if(0 < on_load_balance)
-	    	d_hotplug_lock = 1;
+	if (pulled || imbalance)
+	    	lock = 1;
 	else if(idle_cpu(0))
-	    	force_hotplug = 1;
+	    	hint->force = 1;
 	
 	for_each_online_cpu(cpu) {
+		if (cpu > 1)
+			break;
 
 	        p = cpu_curr(cpu);
 
 		if(cpu && is_rt_task_run(p))
-		    d_hotplug_lock = 1;
+		    rt_on_cpu1 = 1;
 
 		if(p->policy == SCHED_FIFO || p->policy == SCHED_RR)
 		    run_task_prio[cpu] = MAX_RT_PRIO-1 - p->rt_priority;
@@ -46,10 +64,40 @@ static void update_hotplug_monitor(struct sched_domain *sd, unsigned int on_load
 	}
 	
 	if(run_task_prio[0] > run_task_prio[1]){
-	    	d_hotplug_lock = 1;
+	    	lock = 1;
 	}
-		
-	
+
+	/*
+	 * Small tasks are being packed on cpu0 and it still has room:
+	 * whatever was pulled over, cpu1 is not needed for them.
+	 */
+	if (lock && sched_pack_release_cpu1())
+		lock = 0;
+
+	if (rt_on_cpu1)
+		lock = 1;
+
+	hint->lock = lock;
 }
-#endif
 
+/* any online cpu's last balance pass wants cpu1 kept */
+int sched_hotplug_locked(void)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu)
+		if (ACCESS_ONCE(per_cpu(hotplug_hint, cpu).lock))
+			return 1;
+	return 0;
+}
+
+/* consume the cpu0-idle hints, overriding a stale lock */
+int sched_hotplug_forced(void)
+{
+	int cpu, force = 0;
+
+	for_each_possible_cpu(cpu)
+		force |= xchg(&per_cpu(hotplug_hint, cpu).force, 0);
+	return force;
+}
+#endif
@@ -0,0 +1,232 @@
+/*
+ * kernel/sched_util.h
+ *
+ * Per cpu utilization signal for the frequency governors.
+ *
+ * The governors estimate load from get_cpu_idle_time_us() deltas taken
+ * on their own timers. Here the runqueue keeps a decayed average of the
+ * time it had something to run instead, updated when it goes busy or
+ * idle and on every tick, and tells a governor hooked to the cpu when
+ * the figure changes.
+ *
+ * The average is kept in ~1ms periods (2^20ns) with a half-life of 32
+ * periods. A busy period contributes the current frequency relative to
+ * the highest one, so a cpu running flat out at half speed shows half
+ * the utilization of one running flat out at full speed: the signal
+ * tells how much capacity is in use, not how long the cpu was busy.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define SCHED_UTIL_PERIOD_SHIFT	20
+#define SCHED_UTIL_HALFLIFE	32
+
+/* y^n * 2^32, y^32 = 1/2 */
+static const u32 sched_util_yn[SCHED_UTIL_HALFLIFE] = {
+	0xffffffff, 0xfa83b2db, 0xf5257d15, 0xefe4b99b,
+	0xeac0c6e7, 0xe5b906e7, 0xe0ccdeec, 0xdbfbb797,
+	0xd744fcca, 0xd2a81d91, 0xce248c15, 0xc9b9bd86,
+	0xc5672a11, 0xc12c4cca, 0xbd08a39f, 0xb8fbaf47,
+	0xb504f333, 0xb123f581, 0xad583eea, 0xa9a15ab4,
+	0xa5fed6a9, 0xa2704303, 0x9ef53260, 0x9b8d39b9,
+	0x9837f051, 0x94f4efa8, 0x91c3d373, 0x8ea4398b,
+	0x8b95c1e3, 0x88980e80, 0x85aac367, 0x82cd8698,
+};
+
+/* current frequency relative to the highest one, SCHED_UTIL_SCALE based */
+static DEFINE_PER_CPU(unsigned long, sched_freq_scale) = SCHED_UTIL_SCALE;
+
+static DEFINE_PER_CPU(struct sched_util_hook *, sched_util_hooks);
+
+static unsigned long sched_util_decay(unsigned long val, u64 periods)
+{
+	unsigned int n;
+
+	/* nothing of the scale survives 11 half-lives */
+	if (periods > SCHED_UTIL_HALFLIFE * 11)
+		return 0;
+
+	n = (unsigned int)periods;
+	val >>= n / SCHED_UTIL_HALFLIFE;
+	n %= SCHED_UTIL_HALFLIFE;
+
+	return (unsigned long)(((u64)val * sched_util_yn[n]) >> 32);
+}
+
+/* move *util towards target by 1 - y^periods for the time since *stamp */
+static void sched_util_accumulate(u64 *stamp, unsigned long *util, u64 now,
+				  unsigned long target)
+{
+	u64 delta = now - *stamp;
+	u64 periods;
+
+	if ((s64)delta < 0) {
+		*stamp = now;
+		return;
+	}
+
+	periods = delta >> SCHED_UTIL_PERIOD_SHIFT;
+	if (!periods)
+		return;
+	*stamp += periods << SCHED_UTIL_PERIOD_SHIFT;
+
+	if (*util >= target)
+		*util = target + sched_util_decay(*util - target, periods);
+	else
+		*util = target - sched_util_decay(target - *util, periods);
+}
+
+/* bring rq->util_avg up to rq->clock, called with rq->lock held */
+static void sched_util_update(struct rq *rq)
+{
+	unsigned long target = 0;
+
+	if (rq->util_busy)
+		target = per_cpu(sched_freq_scale, cpu_of(rq));
+
+	sched_util_accumulate(&rq->util_stamp, &rq->util_avg, rq->clock,
+			      target);
+}
+
+static void sched_util_notify(struct rq *rq, unsigned long old_util)
+{
+	struct sched_util_hook *hook;
+
+	if (rq->util_avg == old_util)
+		return;
+
+	hook = rcu_dereference_sched(per_cpu(sched_util_hooks, cpu_of(rq)));
+	if (hook)
+		hook->func(hook, cpu_of(rq), rq->util_avg);
+}
+
+/* the runqueue may have gone busy or idle */
+static inline void sched_util_nr_running(struct rq *rq)
+{
+	unsigned long old_util = rq->util_avg;
+
+	if (rq->util_busy == !!rq->nr_running)
+		return;
+
+	sched_util_update(rq);
+	rq->util_busy = !!rq->nr_running;
+	sched_util_notify(rq, old_util);
+}
+
+/*
+ * A task gets the same signal over the time it is runnable versus
+ * asleep, so its figure tells what it would add to a cpu it is put on.
+ * It starts from the first sleep, fresh tasks count as small.
+ */
+static inline void sched_util_enqueue(struct rq *rq, struct task_struct *p,
+				      int flags)
+{
+	if (!(flags & ENQUEUE_WAKEUP) || !p->se.util_stamp)
+		return;
+
+	sched_util_accumulate(&p->se.util_stamp, &p->se.util_avg, rq->clock, 0);
+}
+
+static inline void sched_util_dequeue(struct rq *rq, struct task_struct *p,
+				      int flags)
+{
+	if (!(flags & DEQUEUE_SLEEP))
+		return;
+
+	if (!p->se.util_stamp) {
+		p->se.util_stamp = rq->clock;
+		return;
+	}
+
+	sched_util_accumulate(&p->se.util_stamp, &p->se.util_avg, rq->clock,
+			      per_cpu(sched_freq_scale, cpu_of(rq)));
+}
+
+static inline void sched_util_tick(struct rq *rq)
+{
+	unsigned long old_util = rq->util_avg;
+
+	sched_util_update(rq);
+	sched_util_notify(rq, old_util);
+}
+
+/**
+ * sched_cpu_util - utilization of a cpu
+ * @cpu: the cpu
+ *
+ * Returns the decayed, frequency invariant utilization of @cpu, where
+ * SCHED_UTIL_SCALE means busy all the time at the highest frequency.
+ */
+unsigned long sched_cpu_util(int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+	unsigned long util = ACCESS_ONCE(rq->util_avg);
+	s64 delta;
+
+	/* a tickless idle cpu does not decay its figure itself */
+	if (!rq->util_busy) {
+		delta = sched_clock_cpu(cpu) - ACCESS_ONCE(rq->util_stamp);
+		if (delta > 0)
+			util = sched_util_decay(util,
+					delta >> SCHED_UTIL_PERIOD_SHIFT);
+	}
+
+	return util;
+}
+EXPORT_SYMBOL_GPL(sched_cpu_util);
+
+/**
+ * sched_set_freq_scale - tell the scheduler the frequency a cpu runs at
+ * @cpu: the cpu
+ * @cur: current frequency
+ * @max: highest frequency of the cpu
+ */
+void sched_set_freq_scale(int cpu, unsigned int cur, unsigned int max)
+{
+	struct rq *rq = cpu_rq(cpu);
+	unsigned long scale = SCHED_UTIL_SCALE;
+	unsigned long flags;
+
+	if (max && cur < max)
+		scale = ((unsigned long)cur << SCHED_UTIL_SHIFT) / max;
+
+	/* close the time spent at the old frequency first */
+	raw_spin_lock_irqsave(&rq->lock, flags);
+	update_rq_clock(rq);
+	sched_util_update(rq);
+	per_cpu(sched_freq_scale, cpu) = scale;
+	raw_spin_unlock_irqrestore(&rq->lock, flags);
+}
+
+/**
+ * sched_util_set_hook - get told about utilization changes of a cpu
+ * @cpu: the cpu
+ * @hook: hook to call
+ *
+ * @hook->func is called with the runqueue lock held and interrupts off
+ * whenever the utilization of @cpu changed, i.e. when the cpu goes busy
+ * or idle and on the scheduler tick. It must not sleep, take the
+ * runqueue lock or wake up tasks; record the figure and defer the
+ * frequency change to a timer or a running thread.
+ */
+void sched_util_set_hook(int cpu, struct sched_util_hook *hook)
+{
+	BUG_ON(!hook || !hook->func);
+	rcu_assign_pointer(per_cpu(sched_util_hooks, cpu), hook);
+}
+EXPORT_SYMBOL_GPL(sched_util_set_hook);
+
+/**
+ * sched_util_clear_hook - stop utilization callbacks for a cpu
+ * @cpu: the cpu
+ *
+ * Returns once no callback for @cpu runs anymore, may sleep.
+ */
+void sched_util_clear_hook(int cpu)
+{
+	rcu_assign_pointer(per_cpu(sched_util_hooks, cpu), NULL);
+	synchronize_sched();
+}
+EXPORT_SYMBOL_GPL(sched_util_clear_hook);
@@ -0,0 +1,145 @@
+/*
+ * lib/bufsync.c
+ *
+ * CPU cache ownership tracking for buffers shared with devices
+ *
+ * The direction passed for a CPU access follows the data: DMA_FROM_DEVICE
+ * when the CPU only reads what a device produced, DMA_TO_DEVICE when it
+ * only writes for a device and DMA_BIDIRECTIONAL for both. For a device
+ * access DMA_TO_DEVICE means the device only reads the buffer.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/bufsync.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+
+void bufsync_init(struct bufsync *sync, const struct bufsync_ops *ops,
+		  unsigned long size, bool cached)
+{
+	spin_lock_init(&sync->lock);
+	sync->ops = ops;
+	sync->size = size;
+	sync->cached = cached;
+	sync->tracked = 0;
+	sync->stale = 0;
+	sync->dirty_start = sync->dirty_end = 0;
+}
+EXPORT_SYMBOL(bufsync_init);
+
+static bool bufsync_clip(struct bufsync *sync, unsigned long *offset,
+			 unsigned long *len)
+{
+	if (*offset >= sync->size)
+		return false;
+	*len = min(*len, sync->size - *offset);
+	return *len != 0;
+}
+
+/**
+ * bufsync_begin_cpu_access - the CPU is about to access part of a buffer
+ * @sync: the buffer
+ * @offset: start of the part accessed
+ * @len: its length
+ * @dir: DMA_FROM_DEVICE to read, DMA_TO_DEVICE to write, or both
+ *
+ * Invalidates the part if a device may have written the buffer since
+ * the CPU last did. Writes need it as much as reads: a stale line the
+ * CPU partly writes would be cleaned back over the device's data.
+ */
+void bufsync_begin_cpu_access(struct bufsync *sync, unsigned long offset,
+			      unsigned long len, enum dma_data_direction dir)
+{
+	enum dma_data_direction op = DMA_FROM_DEVICE;
+
+	if (!sync->cached || !bufsync_clip(sync, &offset, &len))
+		return;
+
+	spin_lock(&sync->lock);
+	sync->tracked = 1;
+	if (!sync->stale) {
+		spin_unlock(&sync->lock);
+		return;
+	}
+	/* whatever the CPU dirtied in there has to reach memory first */
+	if (sync->dirty_start < offset + len && offset < sync->dirty_end)
+		op = DMA_BIDIRECTIONAL;
+	if (offset == 0 && len == sync->size) {
+		sync->stale = 0;
+		sync->dirty_start = sync->dirty_end = 0;
+	}
+	spin_unlock(&sync->lock);
+
+	sync->ops->sync(sync, offset, len, op);
+}
+EXPORT_SYMBOL(bufsync_begin_cpu_access);
+
+/**
+ * bufsync_end_cpu_access - the CPU is done with part of a buffer
+ * @sync: the buffer
+ * @offset: start of the part accessed
+ * @len: its length
+ * @dir: direction given to bufsync_begin_cpu_access()
+ *
+ * A part the CPU wrote is added to the range cleaned when the buffer
+ * is handed to a device, nothing is done for reads.
+ */
+void bufsync_end_cpu_access(struct bufsync *sync, unsigned long offset,
+			    unsigned long len, enum dma_data_direction dir)
+{
+	if (!sync->cached || dir == DMA_FROM_DEVICE ||
+	    !bufsync_clip(sync, &offset, &len))
+		return;
+
+	spin_lock(&sync->lock);
+	sync->tracked = 1;
+	if (sync->dirty_start == sync->dirty_end) {
+		sync->dirty_start = offset;
+		sync->dirty_end = offset + len;
+	} else {
+		sync->dirty_start = min(sync->dirty_start, offset);
+		sync->dirty_end = max(sync->dirty_end, offset + len);
+	}
+	spin_unlock(&sync->lock);
+}
+EXPORT_SYMBOL(bufsync_end_cpu_access);
+
+/**
+ * bufsync_begin_device_access - hand a buffer over to a device
+ * @sync: the buffer
+ * @dir: DMA_TO_DEVICE if the device only reads the buffer
+ *
+ * Cleans what the CPU wrote since the last hand-off. A client that never
+ * told about its accesses gets the whole buffer cleaned and invalidated,
+ * as it may read the buffer later without asking.
+ */
+void bufsync_begin_device_access(struct bufsync *sync,
+				 enum dma_data_direction dir)
+{
+	enum dma_data_direction op = DMA_TO_DEVICE;
+	unsigned long start, end;
+
+	if (!sync->cached)
+		return;
+
+	spin_lock(&sync->lock);
+	if (sync->tracked) {
+		start = sync->dirty_start;
+		end = sync->dirty_end;
+	} else {
+		start = 0;
+		end = sync->size;
+		op = DMA_BIDIRECTIONAL;
+	}
+	sync->dirty_start = sync->dirty_end = 0;
+	if (dir != DMA_TO_DEVICE)
+		sync->stale = 1;
+	spin_unlock(&sync->lock);
+
+	if (start != end)
+		sync->ops->sync(sync, start, end - start, op);
+}
+EXPORT_SYMBOL(bufsync_begin_device_access);
@@ -103,35 +103,52 @@ void gen_pool_destroy(struct gen_pool *pool)
 EXPORT_SYMBOL(gen_pool_destroy);
 
 /**
- * gen_pool_alloc - allocate special memory from the pool
+ * gen_pool_alloc_aligned - allocate aligned special memory from the pool
  * @pool: pool to allocate from
  * @size: number of bytes to allocate from the pool
+ * @alignment_order: log base 2 of the alignment of the returned address
  *
- * Allocate the requested number of bytes from the specified pool.
- * Uses a first-fit algorithm.
+ * Allocate the requested number of bytes from the specified pool, at an
+ * address that is a multiple of 1 << @alignment_order.  Uses a first-fit
+ * algorithm.
  */
-unsigned long gen_pool_alloc(struct gen_pool *pool, size_t size)
+unsigned long gen_pool_alloc_aligned(struct gen_pool *pool, size_t size,
+				     unsigned alignment_order)
 {
 	struct list_head *_chunk;
 	struct gen_pool_chunk *chunk;
-	unsigned long addr, flags;
+	unsigned long addr, flags, align_mask = 0;
 	int order = pool->min_alloc_order;
-	int nbits, start_bit, end_bit;
+	int nbits, start_bit, end_bit, bias, aligned;
 
 	if (size == 0)
 		return 0;
 
 	nbits = (size + (1UL << order) - 1) >> order;
+	if (alignment_order > order)
+		align_mask = (1UL << (alignment_order - order)) - 1;
 
 	read_lock(&pool->lock);
 	list_for_each(_chunk, &pool->chunks) {
 		chunk = list_entry(_chunk, struct gen_pool_chunk, next_chunk);
 
 		end_bit = (chunk->end_addr - chunk->start_addr) >> order;
+		/* the chunk itself need not be aligned */
+		bias = (chunk->start_addr >> order) & align_mask;
 
 		spin_lock_irqsave(&chunk->lock, flags);
-		start_bit = bitmap_find_next_zero_area(chunk->bits, end_bit, 0,
-						nbits, 0);
+		start_bit = 0;
+		for (;;) {
+			start_bit = bitmap_find_next_zero_area(chunk->bits,
+						end_bit, start_bit, nbits, 0);
+			if (start_bit >= end_bit)
+				break;
+			aligned = ((start_bit + bias + align_mask) &
+				   ~align_mask) - bias;
+			if (aligned == start_bit)
+				break;
+			start_bit = aligned;
+		}
 		if (start_bit >= end_bit) {
 			spin_unlock_irqrestore(&chunk->lock, flags);
 			continue;
@@ -147,6 +164,20 @@ unsigned long gen_pool_alloc(struct gen_pool *pool, size_t size)
 	read_unlock(&pool->lock);
 	return 0;
 }
+EXPORT_SYMBOL(gen_pool_alloc_aligned);
+
+/**
+ * gen_pool_alloc - allocate special memory from the pool
+ * @pool: pool to allocate from
+ * @size: number of bytes to allocate from the pool
+ *
+ * Allocate the requested number of bytes from the specified pool.
+ * Uses a first-fit algorithm.
+ */
+unsigned long gen_pool_alloc(struct gen_pool *pool, size_t size)
+{
+	return gen_pool_alloc_aligned(pool, size, 0);
+}
 EXPORT_SYMBOL(gen_pool_alloc);
 
 /**
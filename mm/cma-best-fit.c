@@ -174,6 +174,24 @@ void cma_bf_free(struct cma_chunk *chunk)
 }
 
 
+unsigned cma_bf_holes(struct cma_region *reg, size_t *largest)
+{
+	struct cma_bf_private *prv = reg->private_data;
+	struct rb_node *node;
+	unsigned holes = 0;
+
+	node = rb_last(&prv->by_size_root);
+	*largest = node
+		? rb_entry(node, struct cma_bf_item, by_size)->ch.size
+		: 0;
+
+	for (node = rb_first(&prv->by_start_root); node; node = rb_next(node))
+		++holes;
+
+	return holes;
+}
+
+
 /************************* Basic Tree Manipulation *************************/
 
 static void __cma_bf_hole_insert_by_size(struct cma_bf_item *item)
@@ -401,6 +419,7 @@ static int cma_bf_module_init(void)
 		.cleanup = cma_bf_cleanup,
 		.alloc   = cma_bf_alloc,
 		.free    = cma_bf_free,
+		.holes   = cma_bf_holes,
 	};
 	return cma_allocator_register(&alloc);
 }
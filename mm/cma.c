@@ -33,10 +33,17 @@
 #include <linux/mutex.h>       /* mutex */
 #include <linux/slab.h>        /* kmalloc() */
 #include <linux/string.h>      /* str*() */
+#include <linux/ktime.h>       /* ktime_get() */
+#include <linux/math64.h>      /* div_u64() */
+#include <linux/page-isolation.h> /* alloc_contig_range() */
 
 #include <linux/cma.h>
 #include <linux/vmalloc.h>
 
+#if defined CONFIG_CMA_MIGRATE && defined CONFIG_ARM
+#  include <asm/dma-mapping.h> /* __dma_page_cpu_to_dev() */
+#endif
+
 /*
  * Protects cma_regions, cma_allocators, cma_map, cma_map_length,
  * cma_kobj, cma_sysfs_regions and cma_chunks_by_start.
@@ -269,6 +276,7 @@ int __init __must_check cma_early_region_register(struct cma_region *reg)
 /************************* Regions & Allocators *************************/
 
 static void __cma_sysfs_region_add(struct cma_region *reg);
+static void __cma_region_lend(struct cma_region *reg);
 
 static int __cma_region_attach_alloc(struct cma_region *reg);
 static void __maybe_unused __cma_region_detach_alloc(struct cma_region *reg);
@@ -597,6 +605,8 @@ static int __init cma_init(void)
 		 */
 		if (reg->reserved && cma_region_register(reg) < 0)
 			/* ignore error */;
+		else if (reg->reserved && reg->movable)
+			__cma_region_lend(reg);
 	}
 
 	INIT_LIST_HEAD(&cma_early_regions);
@@ -813,6 +823,80 @@ static ssize_t cma_sysfs_region_users_show(struct cma_region *reg, char *page)
 	return snprintf(page, PAGE_SIZE, "%u\n", reg->users);
 }
 
+static ssize_t
+cma_sysfs_region_holes_show(struct cma_region *reg, char *page)
+{
+	size_t largest;
+
+	if (!reg->alloc || !reg->alloc->holes)
+		return 0;
+	return snprintf(page, PAGE_SIZE, "%u\n",
+			reg->alloc->holes(reg, &largest));
+}
+
+static ssize_t
+cma_sysfs_region_largest_free_show(struct cma_region *reg, char *page)
+{
+	size_t largest;
+
+	if (!reg->alloc || !reg->alloc->holes)
+		return 0;
+	reg->alloc->holes(reg, &largest);
+	return snprintf(page, PAGE_SIZE, "%zu\n", largest);
+}
+
+static ssize_t
+cma_sysfs_region_latency_show(struct cma_region *reg, char *page)
+{
+	unsigned long us = 16;
+	ssize_t len = 0;
+	int i;
+
+	len += snprintf(page, PAGE_SIZE, "allocs %lu\n", reg->stats.allocs);
+	for (i = 0; i < CMA_STATS_LATENCY_BUCKETS - 1; ++i, us <<= 2)
+		len += snprintf(page + len, PAGE_SIZE - len, "<%luus %lu\n",
+				us, reg->stats.latency[i]);
+	len += snprintf(page + len, PAGE_SIZE - len, ">=%luus %lu\n",
+			us >> 2, reg->stats.latency[i]);
+
+	return len;
+}
+
+static ssize_t
+cma_sysfs_region_failures_show(struct cma_region *reg, char *page)
+{
+	static const char *const sizes[CMA_STATS_SIZE_BUCKETS] = {
+		"<64K", "<256K", "<1M", "<4M", "<16M", ">=16M"
+	};
+	ssize_t len = 0;
+	int i;
+
+	for (i = 0; i < CMA_STATS_SIZE_BUCKETS; ++i)
+		len += snprintf(page + len, PAGE_SIZE - len, "%s %lu\n",
+				sizes[i], reg->stats.failures[i]);
+
+	return len;
+}
+
+#if defined CONFIG_CMA_MIGRATE
+
+static ssize_t cma_sysfs_region_lend_show(struct cma_region *reg, char *page)
+{
+	if (!reg->movable)
+		return 0;
+
+	return snprintf(page, PAGE_SIZE,
+			"lent %lu\nallocs %lu\nfailed %lu\nmigrated %lu\n"
+			"avg_us %lu\nmax_us %lu\n",
+			reg->lend.lent, reg->lend.allocs, reg->lend.failed,
+			reg->lend.migrated,
+			reg->lend.allocs ? (unsigned long)div_u64(
+				reg->lend.total_us, reg->lend.allocs) : 0,
+			reg->lend.max_us);
+}
+
+#endif
+
 static ssize_t cma_sysfs_region_alloc_show(struct cma_region *reg, char *page)
 {
 	if (reg->alloc)
@@ -903,6 +987,13 @@ static struct kobj_type cma_sysfs_region_type = {
 		CMA_ATTR_RO_INLINE(region, size),
 		CMA_ATTR_RO_INLINE(region, free),
 		CMA_ATTR_RO_INLINE(region, users),
+		CMA_ATTR_RO_INLINE(region, holes),
+		CMA_ATTR_RO_INLINE(region, largest_free),
+		CMA_ATTR_RO_INLINE(region, latency),
+		CMA_ATTR_RO_INLINE(region, failures),
+#if defined CONFIG_CMA_MIGRATE
+		CMA_ATTR_RO_INLINE(region, lend),
+#endif
 		CMA_ATTR_INLINE(region, alloc),
 		NULL
 	},
@@ -926,6 +1017,30 @@ static void __cma_sysfs_region_add(struct cma_region *reg)
 		/* Ignore any errors. */;
 }
 
+/* Called with cma_mutex held after each allocation attempt in @reg. */
+static void __cma_stats_account(struct cma_region *reg, size_t size,
+				dma_addr_t addr, ktime_t start)
+{
+	unsigned long us, limit = 16;
+	int i;
+
+	if (IS_ERR_VALUE(addr)) {
+		for (i = 0, limit = 64 << 10;
+		     i < CMA_STATS_SIZE_BUCKETS - 1 && size >= limit;
+		     ++i, limit <<= 2)
+			/* nop */;
+		++reg->stats.failures[i];
+		return;
+	}
+
+	us = ktime_to_us(ktime_sub(ktime_get(), start));
+	for (i = 0; i < CMA_STATS_LATENCY_BUCKETS - 1 && us >= limit;
+	     ++i, limit <<= 2)
+		/* nop */;
+	++reg->stats.latency[i];
+	++reg->stats.allocs;
+}
+
 #else
 
 static void __cma_sysfs_region_add(struct cma_region *reg)
@@ -933,6 +1048,123 @@ static void __cma_sysfs_region_add(struct cma_region *reg)
 	/* nop */
 }
 
+static inline void __cma_stats_account(struct cma_region *reg, size_t size,
+				       dma_addr_t addr, ktime_t start)
+{
+	/* nop */
+}
+
+#endif
+
+
+/************************* Lending *************************/
+
+#if defined CONFIG_CMA_MIGRATE
+
+/*
+ * Only whole isolatable blocks can be lent, the head and tail of
+ * a region not aligned to them stay reserved.  Returns the part of
+ * [start, start + size) that is lent as pfns.
+ */
+static void __cma_lent_range(const struct cma_region *reg,
+			     dma_addr_t start, size_t size,
+			     unsigned long *spfn, unsigned long *epfn)
+{
+	unsigned long align = max_t(unsigned long, MAX_ORDER_NR_PAGES,
+				    pageblock_nr_pages);
+	unsigned long lo = ALIGN(PFN_UP(reg->start), align);
+	unsigned long hi = PFN_DOWN(reg->start + reg->size) & ~(align - 1);
+
+	*spfn = max(lo, (unsigned long)PFN_DOWN(start));
+	*epfn = min(hi, (unsigned long)PFN_DOWN(start + size));
+}
+
+static void __cma_region_lend(struct cma_region *reg)
+{
+	unsigned long pfn, end;
+
+	__cma_lent_range(reg, reg->start, reg->size, &pfn, &end);
+	if (pfn >= end || !pfn_valid(pfn) || !pfn_valid(end - 1) ||
+	    page_zone(pfn_to_page(pfn)) != page_zone(pfn_to_page(end - 1))) {
+		pr_warn("%s: cannot lend region\n", reg->name ?: "(private)");
+		reg->movable = 0;
+		return;
+	}
+
+	reg->lend.lent = end - pfn;
+	for (; pfn < end; pfn += pageblock_nr_pages)
+		init_cma_reserved_pageblock(pfn_to_page(pfn));
+
+	pr_debug("%s: lent %lu pages\n", reg->name ?: "(private)",
+		 reg->lend.lent);
+}
+
+/* Takes the lent part of a chunk back from the page allocator. */
+static int __cma_chunk_claim(struct cma_region *reg, struct cma_chunk *chunk)
+{
+	unsigned long pfn, end, us;
+	ktime_t t;
+	int ret;
+
+	__cma_lent_range(reg, chunk->start, chunk->size, &pfn, &end);
+	if (pfn >= end)
+		return 0;
+
+	t = ktime_get();
+	ret = alloc_contig_range(pfn, end, MIGRATE_CMA);
+	us = ktime_to_us(ktime_sub(ktime_get(), t));
+
+	++reg->lend.allocs;
+	reg->lend.total_us += us;
+	if (us > reg->lend.max_us)
+		reg->lend.max_us = us;
+
+	if (ret < 0) {
+		++reg->lend.failed;
+		pr_debug("%s: could not take back %p/%p: %d\n",
+			 reg->name ?: "(private)", (void *)chunk->start,
+			 (void *)chunk->size, ret);
+		return ret;
+	}
+	reg->lend.migrated += ret;
+
+#ifdef CONFIG_ARM
+	/* the pages went through the cache while they were lent */
+	__dma_page_cpu_to_dev(pfn_to_page(pfn), 0,
+			      (end - pfn) << PAGE_SHIFT, DMA_BIDIRECTIONAL);
+#endif
+	return 0;
+}
+
+static void __cma_chunk_unclaim(struct cma_region *reg,
+				struct cma_chunk *chunk)
+{
+	unsigned long pfn, end;
+
+	__cma_lent_range(reg, chunk->start, chunk->size, &pfn, &end);
+	if (pfn < end)
+		free_contig_range(pfn, end - pfn);
+}
+
+#else
+
+static void __cma_region_lend(struct cma_region *reg)
+{
+	/* nop */
+}
+
+static inline int
+__cma_chunk_claim(struct cma_region *reg, struct cma_chunk *chunk)
+{
+	return 0;
+}
+
+static inline void
+__cma_chunk_unclaim(struct cma_region *reg, struct cma_chunk *chunk)
+{
+	/* nop */
+}
+
 #endif
 
 
@@ -994,11 +1226,17 @@ static int __must_check __cma_chunk_insert(struct cma_chunk *chunk)
 
 static void __cma_chunk_free(struct cma_chunk *chunk)
 {
+	struct cma_region *reg = chunk->reg;
+	size_t size = chunk->size;
+
 	rb_erase(&chunk->by_start, &cma_chunks_by_start);
 
-	chunk->reg->alloc->free(chunk);
-	--chunk->reg->users;
-	chunk->reg->free_space += chunk->size;
+	if (reg->movable)
+		__cma_chunk_unclaim(reg, chunk);
+
+	reg->alloc->free(chunk);
+	--reg->users;
+	reg->free_space += size;
 }
 
 
@@ -1011,8 +1249,8 @@ __cma_where_from(const struct device *dev, const char *type);
 /* Allocate. */
 
 static dma_addr_t __must_check
-__cma_alloc_from_region(struct cma_region *reg,
-			size_t size, dma_addr_t alignment)
+___cma_alloc_from_region(struct cma_region *reg,
+			 size_t size, dma_addr_t alignment)
 {
 	struct cma_chunk *chunk;
 
@@ -1034,8 +1272,18 @@ __cma_alloc_from_region(struct cma_region *reg,
 	if (!chunk)
 		return -ENOMEM;
 
+	if (reg->movable) {
+		int ret = __cma_chunk_claim(reg, chunk);
+		if (ret < 0) {
+			reg->alloc->free(chunk);
+			return ret;
+		}
+	}
+
 	if (unlikely(__cma_chunk_insert(chunk) < 0)) {
 		/* We should *never* be here. */
+		if (reg->movable)
+			__cma_chunk_unclaim(reg, chunk);
 		chunk->reg->alloc->free(chunk);
 		kfree(chunk);
 		return -EADDRINUSE;
@@ -1048,6 +1296,20 @@ __cma_alloc_from_region(struct cma_region *reg,
 	return chunk->start;
 }
 
+static dma_addr_t __must_check
+__cma_alloc_from_region(struct cma_region *reg,
+			size_t size, dma_addr_t alignment)
+{
+	ktime_t start = ktime_get();
+	dma_addr_t addr;
+
+	addr = ___cma_alloc_from_region(reg, size, alignment);
+	if (reg)
+		__cma_stats_account(reg, size, addr, start);
+
+	return addr;
+}
+
 dma_addr_t __must_check
 cma_alloc_from_region(struct cma_region *reg,
 		      size_t size, dma_addr_t alignment)
@@ -50,6 +50,8 @@
 #include <linux/kmemleak.h>
 #include <linux/memory.h>
 #include <linux/compaction.h>
+#include <linux/migrate.h>
+#include <linux/mm_inline.h>
 #include <trace/events/kmem.h>
 #include <linux/ftrace_event.h>
 
@@ -223,7 +225,8 @@ int page_group_by_mobility_disabled __read_mostly;
 static void set_pageblock_migratetype(struct page *page, int migratetype)
 {
 
-	if (unlikely(page_group_by_mobility_disabled))
+	if (unlikely(page_group_by_mobility_disabled) &&
+	    !is_migrate_cma(migratetype))
 		migratetype = MIGRATE_UNMOVABLE;
 
 	set_pageblock_flags_group(page, (unsigned long)migratetype,
@@ -624,10 +627,10 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 			list_del(&page->lru);
 			/* MIGRATE_MOVABLE list may include MIGRATE_RESERVEs */
 			__free_one_page(page, zone, 0, page_private(page));
+			__mod_zone_freepage_state(zone, 1, page_private(page));
 			trace_mm_page_pcpu_drain(page, 0, page_private(page));
 		} while (--to_free && --batch_free && !list_empty(list));
 	}
-	__mod_zone_page_state(zone, NR_FREE_PAGES, count);
 	spin_unlock(&zone->lock);
 }
 
@@ -639,7 +642,7 @@ static void free_one_page(struct zone *zone, struct page *page, int order,
 	zone->pages_scanned = 0;
 
 	__free_one_page(page, zone, order, migratetype);
-	__mod_zone_page_state(zone, NR_FREE_PAGES, 1 << order);
+	__mod_zone_freepage_state(zone, 1 << order, migratetype);
 	spin_unlock(&zone->lock);
 }
 
@@ -824,11 +827,17 @@ struct page *__rmqueue_smallest(struct zone *zone, unsigned int order,
  * This array describes the order lists are fallen back to when
  * the free lists for the desirable migrate type are depleted
  */
-static int fallbacks[MIGRATE_TYPES][MIGRATE_TYPES-1] = {
-	[MIGRATE_UNMOVABLE]   = { MIGRATE_RECLAIMABLE, MIGRATE_MOVABLE,   MIGRATE_RESERVE },
-	[MIGRATE_RECLAIMABLE] = { MIGRATE_UNMOVABLE,   MIGRATE_MOVABLE,   MIGRATE_RESERVE },
-	[MIGRATE_MOVABLE]     = { MIGRATE_RECLAIMABLE, MIGRATE_UNMOVABLE, MIGRATE_RESERVE },
-	[MIGRATE_RESERVE]     = { MIGRATE_RESERVE,     MIGRATE_RESERVE,   MIGRATE_RESERVE }, /* Never used */
+static int fallbacks[MIGRATE_TYPES][4] = {
+	[MIGRATE_UNMOVABLE]   = { MIGRATE_RECLAIMABLE, MIGRATE_MOVABLE,     MIGRATE_RESERVE },
+	[MIGRATE_RECLAIMABLE] = { MIGRATE_UNMOVABLE,   MIGRATE_MOVABLE,     MIGRATE_RESERVE },
+#ifdef CONFIG_CMA_MIGRATE
+	/* only movable pages may go to pageblocks CMA wants back */
+	[MIGRATE_MOVABLE]     = { MIGRATE_CMA,         MIGRATE_RECLAIMABLE, MIGRATE_UNMOVABLE, MIGRATE_RESERVE },
+	[MIGRATE_CMA]         = { MIGRATE_RESERVE }, /* Never used */
+#else
+	[MIGRATE_MOVABLE]     = { MIGRATE_RECLAIMABLE, MIGRATE_UNMOVABLE,   MIGRATE_RESERVE },
+#endif
+	[MIGRATE_RESERVE]     = { MIGRATE_RESERVE }, /* Never used */
 };
 
 /*
@@ -924,12 +933,12 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 	/* Find the largest possible block of pages in the other list */
 	for (current_order = MAX_ORDER-1; current_order >= order;
 						--current_order) {
-		for (i = 0; i < MIGRATE_TYPES - 1; i++) {
+		for (i = 0;; i++) {
 			migratetype = fallbacks[start_migratetype][i];
 
 			/* MIGRATE_RESERVE handled later if necessary */
 			if (migratetype == MIGRATE_RESERVE)
-				continue;
+				break;
 
 			area = &(zone->free_area[current_order]);
 			if (list_empty(&area->free_list[migratetype]))
@@ -943,11 +952,13 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 			 * If breaking a large block of pages, move all free
 			 * pages to the preferred allocation list. If falling
 			 * back for a reclaimable kernel allocation, be more
-			 * agressive about taking ownership of free pages
+			 * agressive about taking ownership of free pages.
+			 * CMA pageblocks are only borrowed, never taken over.
 			 */
-			if (unlikely(current_order >= (pageblock_order >> 1)) ||
+			if (!is_migrate_cma(migratetype) &&
+			    (unlikely(current_order >= (pageblock_order >> 1)) ||
 					start_migratetype == MIGRATE_RECLAIMABLE ||
-					page_group_by_mobility_disabled) {
+					page_group_by_mobility_disabled)) {
 				unsigned long pages;
 				pages = move_freepages_block(zone, page,
 								start_migratetype);
@@ -966,7 +977,8 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 			rmv_page_order(page);
 
 			/* Take ownership for orders >= pageblock_order */
-			if (current_order >= pageblock_order)
+			if (current_order >= pageblock_order &&
+			    !is_migrate_cma(migratetype))
 				change_pageblock_range(page, current_order,
 							start_migratetype);
 
@@ -1042,7 +1054,13 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 			list_add(&page->lru, list);
 		else
 			list_add_tail(&page->lru, list);
-		set_page_private(page, migratetype);
+		/* a drained pcp page must go back to its CMA pageblock list */
+		if (is_migrate_cma(get_pageblock_migratetype(page))) {
+			set_page_private(page, MIGRATE_CMA);
+			__mod_zone_page_state(zone, NR_FREE_CMA_PAGES,
+					      -(1 << order));
+		} else
+			set_page_private(page, migratetype);
 		list = &page->lru;
 	}
 	__mod_zone_page_state(zone, NR_FREE_PAGES, -(i << order));
@@ -1178,8 +1196,8 @@ void free_hot_cold_page(struct page *page, int cold)
 	/*
 	 * We only track unmovable, reclaimable and movable on pcp lists.
 	 * Free ISOLATE pages back to the allocator because they are being
-	 * offlined but treat RESERVE as movable pages so we can get those
-	 * areas back if necessary. Otherwise, we may have to free
+	 * offlined but treat RESERVE and CMA as movable pages so we can get
+	 * those areas back if necessary. Otherwise, we may have to free
 	 * excessively into the page allocator
 	 */
 	if (migratetype >= MIGRATE_PCPTYPES) {
@@ -1263,7 +1281,8 @@ int split_free_page(struct page *page)
 	list_del(&page->lru);
 	zone->free_area[order].nr_free--;
 	rmv_page_order(page);
-	__mod_zone_page_state(zone, NR_FREE_PAGES, -(1UL << order));
+	__mod_zone_freepage_state(zone, -(1 << order),
+				  get_pageblock_migratetype(page));
 
 	/* Split into individual pages */
 	set_page_refcounted(page);
@@ -1334,7 +1353,8 @@ again:
 		spin_unlock(&zone->lock);
 		if (!page)
 			goto failed;
-		__mod_zone_page_state(zone, NR_FREE_PAGES, -(1 << order));
+		__mod_zone_freepage_state(zone, -(1 << order),
+					  get_pageblock_migratetype(page));
 	}
 
 	__count_zone_vm_events(PGALLOC, zone, 1 << order);
@@ -1363,6 +1383,7 @@ failed:
 #define ALLOC_HARDER		0x10 /* try to alloc harder */
 #define ALLOC_HIGH		0x20 /* __GFP_HIGH set */
 #define ALLOC_CPUSET		0x40 /* check for correct cpuset */
+#define ALLOC_CMA		0x80 /* movable, may use free CMA pages */
 
 #ifdef CONFIG_FAIL_PAGE_ALLOC
 
@@ -1471,6 +1492,11 @@ static bool __zone_watermark_ok(struct zone *z, int order, unsigned long mark,
 	int o;
 
 	free_pages -= (1 << order) + 1;
+#ifdef CONFIG_CMA_MIGRATE
+	/* free pages in CMA pageblocks can only be had by movable requests */
+	if (!(alloc_flags & ALLOC_CMA))
+		free_pages -= zone_page_state(z, NR_FREE_CMA_PAGES);
+#endif
 	if (alloc_flags & ALLOC_HIGH)
 		min -= min / 2;
 	if (alloc_flags & ALLOC_HARDER)
@@ -1980,6 +2006,11 @@ gfp_to_alloc_flags(gfp_t gfp_mask)
 			alloc_flags |= ALLOC_NO_WATERMARKS;
 	}
 
+#ifdef CONFIG_CMA_MIGRATE
+	if (allocflags_to_migratetype(gfp_mask) == MIGRATE_MOVABLE)
+		alloc_flags |= ALLOC_CMA;
+#endif
+
 	return alloc_flags;
 }
 
@@ -2141,6 +2172,7 @@ __alloc_pages_nodemask(gfp_t gfp_mask, unsigned int order,
 	struct zone *preferred_zone;
 	struct page *page;
 	int migratetype = allocflags_to_migratetype(gfp_mask);
+	int alloc_flags = ALLOC_WMARK_LOW|ALLOC_CPUSET;
 
 	gfp_mask &= gfp_allowed_mask;
 
@@ -2167,9 +2199,14 @@ __alloc_pages_nodemask(gfp_t gfp_mask, unsigned int order,
 		return NULL;
 	}
 
+#ifdef CONFIG_CMA_MIGRATE
+	if (migratetype == MIGRATE_MOVABLE)
+		alloc_flags |= ALLOC_CMA;
+#endif
+
 	/* First allocation attempt */
 	page = get_page_from_freelist(gfp_mask|__GFP_HARDWALL, nodemask, order,
-			zonelist, high_zoneidx, ALLOC_WMARK_LOW|ALLOC_CPUSET,
+			zonelist, high_zoneidx, alloc_flags,
 			preferred_zone, migratetype);
 	if (unlikely(!page))
 		page = __alloc_pages_slowpath(gfp_mask, order,
@@ -5329,6 +5366,7 @@ int set_migratetype_isolate(struct page *page)
 
 	spin_lock_irqsave(&zone->lock, flags);
 	if (get_pageblock_migratetype(page) == MIGRATE_MOVABLE ||
+	    is_migrate_cma(get_pageblock_migratetype(page)) ||
 	    zone_idx == ZONE_MOVABLE) {
 		ret = 0;
 		goto out;
@@ -5371,8 +5409,15 @@ int set_migratetype_isolate(struct page *page)
 
 out:
 	if (!ret) {
+		int migratetype = get_pageblock_migratetype(page);
+		int nr_pages;
+
 		set_pageblock_migratetype(page, MIGRATE_ISOLATE);
-		move_freepages_block(zone, page, MIGRATE_ISOLATE);
+		nr_pages = move_freepages_block(zone, page, MIGRATE_ISOLATE);
+		/* still free, but no longer for movable allocations */
+		if (is_migrate_cma(migratetype))
+			__mod_zone_page_state(zone, NR_FREE_CMA_PAGES,
+					      -nr_pages);
 	}
 
 	spin_unlock_irqrestore(&zone->lock, flags);
@@ -5381,19 +5426,250 @@ out:
 	return ret;
 }
 
-void unset_migratetype_isolate(struct page *page)
+void unset_migratetype_isolate(struct page *page, int migratetype)
 {
 	struct zone *zone;
 	unsigned long flags;
+	int nr_pages;
 	zone = page_zone(page);
 	spin_lock_irqsave(&zone->lock, flags);
 	if (get_pageblock_migratetype(page) != MIGRATE_ISOLATE)
 		goto out;
-	set_pageblock_migratetype(page, MIGRATE_MOVABLE);
-	move_freepages_block(zone, page, MIGRATE_MOVABLE);
+	set_pageblock_migratetype(page, migratetype);
+	nr_pages = move_freepages_block(zone, page, migratetype);
+	if (is_migrate_cma(migratetype))
+		__mod_zone_page_state(zone, NR_FREE_CMA_PAGES, nr_pages);
+out:
+	spin_unlock_irqrestore(&zone->lock, flags);
+}
+
+#ifdef CONFIG_CMA_MIGRATE
+/*
+ * CMA lends the pageblocks of its regions to the page allocator while no
+ * chunk covers them. They are freed as MIGRATE_CMA blocks, which only
+ * movable allocations fall back to and never take over, so the region
+ * can be had back by migrating the pages put there.
+ */
+void init_cma_reserved_pageblock(struct page *page)
+{
+	unsigned int i = pageblock_nr_pages;
+	struct page *p = page;
+
+	do {
+		__ClearPageReserved(p);
+		set_page_count(p, 0);
+	} while (++p, --i);
+
+	set_page_refcounted(page);
+	set_pageblock_migratetype(page, MIGRATE_CMA);
+	__free_pages(page, pageblock_order);
+	totalram_pages += pageblock_nr_pages;
+}
+
+#define CONTIG_MIGRATE_BATCH	256
+#define CONTIG_MIGRATE_TRIES	5
+
+static struct page *
+contig_migrate_alloc(struct page *page, unsigned long private, int **x)
+{
+	return alloc_page(GFP_HIGHUSER_MOVABLE);
+}
+
+/*
+ * Move the pages in use out of [start, end), which is isolated so they
+ * can't come back. Returns the number of pages left behind.
+ */
+static int __alloc_contig_migrate_range(unsigned long start, unsigned long end,
+					unsigned long *migrated)
+{
+	unsigned long pfn;
+	struct page *page;
+	int nr = 0, left = 0;
+	int ret;
+	LIST_HEAD(source);
+
+	for (pfn = start; pfn < end; pfn++) {
+		if (!pfn_valid_within(pfn))
+			continue;
+		page = pfn_to_page(pfn);
+
+		if (PageBuddy(page)) {
+			pfn += (1UL << page_order(page)) - 1;
+			continue;
+		}
+		if (!page_count(page))
+			continue;
+
+		if (isolate_lru_page(page)) {
+			/* pinned, or on its way into or out of the lru */
+			left++;
+			continue;
+		}
+		list_add_tail(&page->lru, &source);
+		inc_zone_page_state(page, NR_ISOLATED_ANON +
+				    page_is_file_cache(page));
+
+		if (++nr < CONTIG_MIGRATE_BATCH && pfn + 1 < end)
+			continue;
+
+		/* this returns # of failed pages */
+		ret = migrate_pages(&source, contig_migrate_alloc, 0, 0);
+		if (ret < 0)
+			return ret;
+		*migrated += nr - ret;
+		left += ret;
+		nr = 0;
+	}
+
+	if (nr) {
+		ret = migrate_pages(&source, contig_migrate_alloc, 0, 0);
+		if (ret < 0)
+			return ret;
+		*migrated += nr - ret;
+		left += ret;
+	}
+
+	return left;
+}
+
+/*
+ * Take the free pages covering [start, end) off the free lists as order 0
+ * pages with a reference each. The first and the last of them may reach
+ * past the range, [*outer_start, *outer_end) tells what was taken.
+ * Nothing is taken unless all of the range is free.
+ */
+static int __alloc_contig_take(unsigned long start, unsigned long end,
+			       unsigned long *outer_start,
+			       unsigned long *outer_end)
+{
+	struct zone *zone = page_zone(pfn_to_page(start));
+	unsigned long flags, pfn;
+	unsigned int order;
+	struct page *page;
+	int ret = -EBUSY;
+
+	spin_lock_irqsave(&zone->lock, flags);
+
+	/* the free page holding @start may begin further down */
+	for (order = 0; order < MAX_ORDER; order++) {
+		pfn = start & ~((1UL << order) - 1);
+		page = pfn_to_page(pfn);
+		if (PageBuddy(page) &&
+		    pfn + (1UL << page_order(page)) > start)
+			break;
+	}
+	if (order == MAX_ORDER)
+		goto out;
+	*outer_start = pfn;
+
+	while (pfn < end) {
+		page = pfn_to_page(pfn);
+		if (!PageBuddy(page))
+			goto out;
+		pfn += 1UL << page_order(page);
+	}
+	*outer_end = pfn;
+
+	for (pfn = *outer_start; pfn < *outer_end; pfn += 1UL << order) {
+		page = pfn_to_page(pfn);
+		order = page_order(page);
+
+		list_del(&page->lru);
+		zone->free_area[order].nr_free--;
+		rmv_page_order(page);
+		__mod_zone_freepage_state(zone, -(1 << order),
+					  get_pageblock_migratetype(page));
+
+		set_page_refcounted(page);
+		split_page(page, order);
+	}
+	ret = 0;
 out:
 	spin_unlock_irqrestore(&zone->lock, flags);
+	return ret;
+}
+
+/*
+ * Free pages merge up to MAX_ORDER - 1, isolate whole buddies around a
+ * range so that none of them can be handed out while it is emptied.
+ */
+#define contig_align_down(pfn) \
+	((pfn) & ~(max_t(unsigned long, MAX_ORDER_NR_PAGES, \
+			 pageblock_nr_pages) - 1))
+#define contig_align_up(pfn) \
+	ALIGN((pfn), max_t(unsigned long, MAX_ORDER_NR_PAGES, \
+			   pageblock_nr_pages))
+
+/**
+ * alloc_contig_range() - take a range of pages out of the page allocator
+ * @start:	first pfn of the range
+ * @end:	one past the last pfn of the range
+ * @migratetype:	migratetype of the pageblocks around the range, they
+ *		must all be of this type and it must be movable
+ *
+ * The pages in use in the range are migrated elsewhere, which may sleep.
+ * On success each page of the range is handed over with a reference,
+ * give them back with free_contig_range().
+ *
+ * Returns the number of pages migrated, or a negative error: -EBUSY if
+ * some page could not be moved, -EINTR if a fatal signal arrived.
+ */
+int alloc_contig_range(unsigned long start, unsigned long end,
+		       int migratetype)
+{
+	unsigned long outer_start, outer_end;
+	unsigned long migrated = 0;
+	int tries, ret;
+
+	ret = start_isolate_page_range(contig_align_down(start),
+				       contig_align_up(end), migratetype);
+	if (ret)
+		return ret;
+
+	migrate_prep();
+
+	for (tries = 0; ; tries++) {
+		if (fatal_signal_pending(current)) {
+			ret = -EINTR;
+			goto done;
+		}
+
+		ret = __alloc_contig_migrate_range(start, end, &migrated);
+		if (ret < 0)
+			goto done;
+
+		/* pages freed since then may sit in pagevecs and pcp lists */
+		lru_add_drain_all();
+		drain_all_pages();
+
+		ret = __alloc_contig_take(start, end, &outer_start, &outer_end);
+		if (!ret)
+			break;
+
+		if (tries == CONTIG_MIGRATE_TRIES)
+			goto done;
+		/* give pages under writeback or io a chance to finish */
+		congestion_wait(BLK_RW_ASYNC, HZ/50);
+	}
+
+	if (outer_start != start)
+		free_contig_range(outer_start, start - outer_start);
+	if (outer_end != end)
+		free_contig_range(end, outer_end - end);
+	ret = migrated;
+
+done:
+	undo_isolate_page_range(contig_align_down(start),
+				contig_align_up(end), migratetype);
+	return ret;
+}
+
+void free_contig_range(unsigned long pfn, unsigned long nr_pages)
+{
+	for (; nr_pages--; pfn++)
+		__free_page(pfn_to_page(pfn));
 }
+#endif /* CONFIG_CMA_MIGRATE */
 
 #ifdef CONFIG_MEMORY_HOTREMOVE
 /*
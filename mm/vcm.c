@@ -488,7 +488,13 @@ vcm_mmu_res(struct vcm *vcm, resource_size_t size, unsigned flags)
 	if (!res)
 		return ERR_PTR(-ENOMEM);
 
-	order = ffs(size) - PAGE_SHIFT - 1;
+	/*
+	 * Align the reservation on the largest page the MMU supports
+	 * that fits in it, so that physical chunks of that size bound
+	 * to it get mapped with single entries.  The lowest bit set in
+	 * the size would leave a 1M + 4K buffer with 4K pages only.
+	 */
+	order = fls(size) - PAGE_SHIFT - 1;
 	for (orders = mmu->driver->orders; *orders > order; ++orders)
 		/* nop */;
 	order = *orders + PAGE_SHIFT;
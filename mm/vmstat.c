@@ -548,6 +548,9 @@ static char * const migratetype_names[MIGRATE_TYPES] = {
 	"Movable",
 	"Reserve",
 	"Isolate",
+#ifdef CONFIG_CMA_MIGRATE
+	"CMA",
+#endif
 };
 
 static void *frag_start(struct seq_file *m, loff_t *pos)
@@ -811,6 +814,7 @@ static const char * const vmstat_text[] = {
 	"nr_isolated_anon",
 	"nr_isolated_file",
 	"nr_shmem",
+	"nr_free_cma",
 #ifdef CONFIG_NUMA
 	"numa_hit",
 	"numa_miss",
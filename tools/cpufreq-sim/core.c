@@ -0,0 +1,294 @@
+/*
+ * core.c -- userspace replacement for drivers/cpufreq/cpufreq_governor.c
+ *
+ * Copyright (C) 2011 Samsung Electronics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Governors built on the common sampling core only talk to it through
+ * cpufreq_gov_register(), cpufreq_gov_event() and their select()
+ * callback, so they are linked into the simulator unmodified. This file
+ * provides those calls and replays gov_check_cpu() against a struct
+ * sim_policy.
+ */
+
+#include <stdlib.h>
+
+#include <linux/cpufreq.h>
+#include <linux/cpuidle.h>
+#include "../../drivers/cpufreq/cpufreq_governor.h"
+
+#include "sim.h"
+
+/* same derivation as gov_start() for the S5PV310 transition latency */
+#define SIM_TRANSITION_LATENCY_NS	100000
+#define SIM_HZ				200
+#define MIN_SAMPLING_RATE_RATIO		(2)
+#define LATENCY_MULTIPLIER		(1000)
+#define MIN_LATENCY_MULTIPLIER		(100)
+
+#define SIM_MAX_CORE_GOVS		16
+
+struct task_struct sim_current_task = { .comm = "cpufreq-sim" };
+
+/*
+ * No cpuidle statistics are replayed, so wheatley counts every sample as
+ * a residency miss and behaves as ondemand once allowed_misses is reached.
+ */
+DEFINE_PER_CPU(struct cpuidle_device *, cpuidle_devices);
+
+struct sim_core_gov {
+	struct sim_governor sim;
+	struct cpufreq_gov *gov;
+	struct cpufreq_policy policy;
+};
+
+static struct sim_core_gov core_govs[SIM_MAX_CORE_GOVS];
+static int nr_core_govs;
+
+static unsigned long sim_nr_running = 1;
+
+static struct cpufreq_frequency_table sim_freq_table[SIM_MAX_LEVELS + 1];
+
+unsigned long nr_running(void)
+{
+	return sim_nr_running;
+}
+
+/* only the screen and input handlers kick, the replay has neither */
+void cpufreq_gov_kick(unsigned int cpu)
+{
+}
+
+int __cpufreq_driver_target(struct cpufreq_policy *policy,
+			    unsigned int target_freq, unsigned int relation)
+{
+	sim_driver_target(policy->sim, target_freq, relation);
+	policy->cur = policy->sim->cur;
+	return 0;
+}
+
+struct cpufreq_frequency_table *cpufreq_frequency_get_table(unsigned int cpu)
+{
+	return sim_freq_table;
+}
+
+int cpufreq_frequency_table_target(struct cpufreq_policy *policy,
+				   struct cpufreq_frequency_table *table,
+				   unsigned int target_freq,
+				   unsigned int relation,
+				   unsigned int *index)
+{
+	*index = sim_freq_index(policy->sim, target_freq, relation);
+	return 0;
+}
+
+static void sim_core_sync(struct sim_core_gov *cg, struct sim_policy *p)
+{
+	cg->policy.min = p->min;
+	cg->policy.max = p->max;
+	cg->policy.cur = p->cur;
+	cg->policy.cpuinfo.min_freq = p->table[p->nr_levels - 1];
+	cg->policy.cpuinfo.max_freq = p->table[0];
+	cg->policy.cpuinfo.transition_latency = SIM_TRANSITION_LATENCY_NS;
+	cg->policy.sim = p;
+}
+
+static void sim_core_start(struct sim_governor *sg, struct sim_policy *p)
+{
+	struct sim_core_gov *cg = sg->data;
+	struct cpufreq_gov *gov = cg->gov;
+	struct cpufreq_gov_cpu *gcpu = cpufreq_gov_cpu(gov, 0);
+	unsigned int latency = SIM_TRANSITION_LATENCY_NS / 1000;
+	int i;
+
+	sim_core_sync(cg, p);
+
+	for (i = 0; i < p->nr_levels; i++) {
+		sim_freq_table[i].index = i;
+		sim_freq_table[i].frequency = p->table[i];
+	}
+	sim_freq_table[i].frequency = CPUFREQ_TABLE_END;
+
+	cg->policy.governor_data = gov;
+	gcpu->cur_policy = &cg->policy;
+	gcpu->requested_freq = p->cur;
+	gcpu->down_skip = 0;
+	gcpu->rate_mult = 1;
+	gcpu->samples = 0;
+	gcpu->skipped = 0;
+	gcpu->transitions = 0;
+	gcpu->enable = 1;
+
+	if (!gov->min_sampling_rate)
+		gov->min_sampling_rate = MIN_SAMPLING_RATE_RATIO * 10 *
+					 (1000000 / SIM_HZ);
+	if (gov->min_sampling_rate < MIN_LATENCY_MULTIPLIER * latency)
+		gov->min_sampling_rate = MIN_LATENCY_MULTIPLIER * latency;
+	if (!gov->sampling_rate) {
+		gov->sampling_rate = latency * LATENCY_MULTIPLIER;
+		if (gov->sampling_rate < gov->min_sampling_rate)
+			gov->sampling_rate = gov->min_sampling_rate;
+	}
+
+	/* start() may pick its own sampling rate */
+	if (gov->ops->start)
+		gov->ops->start(gcpu);
+
+	sg->rate_us = gov->sampling_rate * gcpu->rate_mult;
+}
+
+/* gov_check_cpu(), minus the idle accounting done by the replay loop */
+static void sim_core_sample(struct sim_governor *sg, struct sim_policy *p,
+			    const struct sim_load *load)
+{
+	struct sim_core_gov *cg = sg->data;
+	struct cpufreq_gov *gov = cg->gov;
+	struct cpufreq_gov_cpu *gcpu = cpufreq_gov_cpu(gov, 0);
+	unsigned int freq;
+
+	sim_core_sync(cg, p);
+	sim_nr_running = load->nr_running;
+
+	/* the transition notifier keeps the request inside the limits */
+	if (gcpu->requested_freq > p->max || gcpu->requested_freq < p->min)
+		gcpu->requested_freq = p->cur;
+
+	gcpu->samples++;
+
+	/* the idle fast path of gov_check_cpu() */
+	if (!gov->sample_idle &&
+	    cpufreq_window_idle(sg->rate_us, load->idle_us) &&
+	    p->cur == p->min) {
+		gcpu->load = 0;
+		gcpu->skipped++;
+		gcpu->rate_mult = 1;
+		goto out;
+	}
+
+	gcpu->load = load->load;
+	gcpu->window = sg->rate_us;
+	gcpu->freq_lo = 0;
+	gcpu->relation = CPUFREQ_RELATION_H;
+
+	/*
+	 * a period split by select() is not replayed, the whole of it runs
+	 * at the first frequency
+	 */
+	freq = gov->ops->select(gcpu, load->load);
+	if (!freq)
+		goto out;
+
+	if (freq > p->max)
+		freq = p->max;
+	if (freq < p->min)
+		freq = p->min;
+
+	gcpu->requested_freq = freq;
+	if (freq == p->cur)
+		goto out;
+
+	__cpufreq_driver_target(&cg->policy, freq, gcpu->relation);
+	gcpu->transitions++;
+out:
+	sg->rate_us = gov->sampling_rate * gcpu->rate_mult;
+}
+
+static struct attribute *sim_core_attr(struct cpufreq_gov *gov,
+				       const char *name)
+{
+	int i;
+
+	for (i = 0; gov->attrs && gov->attrs[i]; i++)
+		if (!strcmp(gov->attrs[i]->name, name))
+			return gov->attrs[i];
+	return NULL;
+}
+
+static int sim_core_tune(struct sim_governor *sg, const char *name,
+			 const char *value)
+{
+	struct sim_core_gov *cg = sg->data;
+	struct cpufreq_gov *gov = cg->gov;
+	struct attribute *attr;
+	ssize_t ret;
+
+	if (!strcmp(name, "sampling_rate")) {
+		gov->sampling_rate = strtoul(value, NULL, 0);
+		sg->rate_us = gov->sampling_rate *
+			      cpufreq_gov_cpu(gov, 0)->rate_mult;
+		return 0;
+	}
+
+	attr = sim_core_attr(gov, name);
+	if (!attr)
+		return -EINVAL;
+
+	if (gov->sysfs_global) {
+		struct global_attr *gattr =
+			container_of(attr, struct global_attr, attr);
+
+		if (!gattr->store)
+			return -EINVAL;
+		ret = gattr->store(NULL, attr, value, strlen(value));
+	} else {
+		struct freq_attr *fattr =
+			container_of(attr, struct freq_attr, attr);
+
+		if (!fattr->store)
+			return -EINVAL;
+		ret = fattr->store(&cg->policy, value, strlen(value));
+	}
+
+	return ret < 0 ? -EINVAL : 0;
+}
+
+int cpufreq_gov_register(struct cpufreq_gov *gov)
+{
+	struct sim_core_gov *cg;
+
+	if (!gov->governor || !gov->governor->governor ||
+	    !gov->ops || !gov->ops->select)
+		return -EINVAL;
+	if (nr_core_govs == SIM_MAX_CORE_GOVS)
+		return -ENOMEM;
+
+	gov->cpu_data = calloc(SIM_NR_CPUS, sizeof(*gov->cpu_data));
+	if (!gov->cpu_data)
+		return -ENOMEM;
+	gov->cpu_data[0].gov = gov;
+
+	cg = &core_govs[nr_core_govs++];
+	cg->gov = gov;
+	cg->policy.governor = gov->governor;
+	cg->sim.name = gov->governor->name;
+	cg->sim.start = sim_core_start;
+	cg->sim.sample = sim_core_sample;
+	cg->sim.tune = sim_core_tune;
+	cg->sim.data = cg;
+
+	return 0;
+}
+
+void cpufreq_gov_unregister(struct cpufreq_gov *gov)
+{
+}
+
+/* the replay loop starts and samples the governors itself */
+int cpufreq_gov_event(struct cpufreq_gov *gov, struct cpufreq_policy *policy,
+		      unsigned int event)
+{
+	return 0;
+}
+
+int sim_core_governors(struct sim_governor **govs, int max)
+{
+	int i;
+
+	for (i = 0; i < nr_core_govs && i < max; i++)
+		govs[i] = &core_govs[i].sim;
+
+	return i;
+}
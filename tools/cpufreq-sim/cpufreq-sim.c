@@ -0,0 +1,840 @@
+/*
+ * cpufreq-sim.c -- cpufreq governor replay simulator
+ *
+ * Copyright (C) 2011 Samsung Electronics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Replays a recorded per cpu load trace against each governor and
+ * reports an energy proxy, from the S5PV310 frequency and ASV voltage
+ * tables, against the latency the workload saw.
+ *
+ * The trace is turned into work: every millisecond a cpu asks for the
+ * number of cycles it consumed in the recording. The simulated cpu runs
+ * that work at the frequency the governor picked; what does not fit is
+ * carried over, and the time needed to drain it is the latency figure.
+ * Governors see the resulting busy time exactly as they would see it
+ * through get_cpu_idle_time_us().
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+#define LAT_HIST_MS		1000
+#define MAX_GOVS		24
+#define MAX_TUNES		32
+
+struct trace {
+	const char *name;
+	unsigned int len_ms;
+	unsigned int alloc_ms;
+	/* cycles requested by each cpu during each millisecond */
+	double *demand[SIM_NR_CPUS];
+};
+
+struct result {
+	double energy;		/* sum of busy cycles * V^2 */
+	double vtime;		/* sum of time at frequency * V */
+	double lat_sum;		/* ms of backlog delay, summed over busy ms */
+	unsigned long lat_samples;
+	double lat_max;
+	unsigned long lat_hist[LAT_HIST_MS + 1];
+	unsigned long time_in_state[SIM_MAX_LEVELS];
+	unsigned long transitions;
+};
+
+/* s5pv310_freq_table and s5pv310_volt_table for the 1.2GHz parts */
+static const unsigned int s5pv310_freq[] = {
+	1200000, 1000000, 800000, 500000, 200000,
+};
+
+static const unsigned int s5pv310_volt[] = {
+	1300000, 1200000, 1100000, 1000000, 975000,
+};
+
+/*
+ * VDD_ARM offsets applied by s5pv310_asv_table_update() per ASV group,
+ * for all levels but the last one and for the last one.
+ */
+static const int asv_offset[8] = {
+	100000, 50000, 0, -25000, -50000, -50000, -100000, -125000,
+};
+
+static const int asv_offset_last[8] = {
+	75000, 25000, 0, -25000, -25000, -50000, -50000, -50000,
+};
+
+static struct sim_policy base_policy;
+
+static void setup_policy(int asv_group, unsigned int max_freq)
+{
+	int nr = sizeof(s5pv310_freq) / sizeof(s5pv310_freq[0]);
+	int last = nr - 1;
+	int i;
+
+	memset(&base_policy, 0, sizeof(base_policy));
+
+	for (i = 0; i < nr; i++) {
+		int volt = s5pv310_volt[i];
+
+		if (asv_group >= 0) {
+			if (i == last) {
+				volt += asv_offset_last[asv_group];
+			} else {
+				volt += asv_offset[asv_group];
+				/* the 1.2GHz L3 step only drops by 25mV */
+				if ((asv_group == 4 || asv_group == 5) && i == 3)
+					volt += 25000;
+			}
+			if (volt > 1350000)
+				volt = 1350000;
+			if (i != last && volt < 925000)
+				volt = 925000;
+		}
+
+		base_policy.table[i] = s5pv310_freq[i];
+		base_policy.volt[i] = volt;
+	}
+
+	base_policy.nr_levels = nr;
+	base_policy.min = s5pv310_freq[last];
+	base_policy.max = max_freq ? max_freq : s5pv310_freq[0];
+}
+
+/* cpufreq_frequency_table_target() on a fastest first table */
+int sim_freq_index(const struct sim_policy *p, unsigned int target,
+		   int relation)
+{
+	int optimal = -1, suboptimal = -1;
+	int i;
+
+	for (i = 0; i < p->nr_levels; i++) {
+		unsigned int freq = p->table[i];
+
+		if (freq < p->min || freq > p->max)
+			continue;
+
+		if (relation == SIM_RELATION_H) {
+			if (freq <= target) {
+				if (optimal < 0 || freq > p->table[optimal])
+					optimal = i;
+			} else if (suboptimal < 0 ||
+				   freq < p->table[suboptimal]) {
+				suboptimal = i;
+			}
+		} else {
+			if (freq >= target) {
+				if (optimal < 0 || freq < p->table[optimal])
+					optimal = i;
+			} else if (suboptimal < 0 ||
+				   freq > p->table[suboptimal]) {
+				suboptimal = i;
+			}
+		}
+	}
+
+	if (optimal >= 0)
+		return optimal;
+	return suboptimal >= 0 ? suboptimal : 0;
+}
+
+static int cur_index(const struct sim_policy *p)
+{
+	int i;
+
+	for (i = 0; i < p->nr_levels; i++)
+		if (p->table[i] == p->cur)
+			return i;
+	return 0;
+}
+
+void sim_driver_target(struct sim_policy *p, unsigned int target,
+		       int relation)
+{
+	unsigned int freq;
+
+	if (target > p->max)
+		target = p->max;
+	if (target < p->min)
+		target = p->min;
+
+	freq = p->table[sim_freq_index(p, target, relation)];
+	if (freq == p->cur)
+		return;
+
+	p->cur = freq;
+	p->freq_change_time = p->now;
+	p->transitions++;
+}
+
+/* trace loading */
+
+static void trace_grow(struct trace *t, unsigned int ms)
+{
+	unsigned int n;
+	int cpu;
+
+	if (ms < t->alloc_ms) {
+		if (ms >= t->len_ms)
+			t->len_ms = ms + 1;
+		return;
+	}
+
+	n = t->alloc_ms ? t->alloc_ms : 4096;
+	while (n <= ms)
+		n *= 2;
+
+	for (cpu = 0; cpu < SIM_NR_CPUS; cpu++) {
+		t->demand[cpu] = realloc(t->demand[cpu], n * sizeof(double));
+		if (!t->demand[cpu]) {
+			perror("realloc");
+			exit(1);
+		}
+		memset(t->demand[cpu] + t->alloc_ms, 0,
+		       (n - t->alloc_ms) * sizeof(double));
+	}
+	t->alloc_ms = n;
+	t->len_ms = ms + 1;
+}
+
+/* cpu was busy at freq (kHz) from t0 to t1 (us) */
+static void trace_busy(struct trace *t, int cpu, unsigned long long t0,
+		       unsigned long long t1, unsigned int freq)
+{
+	while (t0 < t1) {
+		unsigned int ms = t0 / 1000;
+		unsigned long long end = (unsigned long long)(ms + 1) * 1000;
+
+		if (end > t1)
+			end = t1;
+		trace_grow(t, ms);
+		/* kHz * ms == cycles */
+		t->demand[cpu][ms] += (double)freq * (end - t0) / 1000.0;
+		t0 = end;
+	}
+}
+
+/*
+ * ftrace output with the power events enabled:
+ *   <idle>-0     [001]   812.040216: power_start: type=1 state=1
+ *   <idle>-0     [001]   812.043529: power_end: dummy=4294967295
+ *   kworker-12   [000]   812.050003: power_frequency: type=2 state=800000
+ * All cpus share one frequency, a cpu is idle until its first event.
+ */
+enum { CPU_UNKNOWN, CPU_BUSY, CPU_IDLE };
+
+struct ftrace_state {
+	int state[SIM_NR_CPUS];
+	unsigned long long since[SIM_NR_CPUS];
+	unsigned long long t0;
+	unsigned int freq;
+	int started;
+};
+
+static void ftrace_flush(struct trace *t, struct ftrace_state *fs, int cpu,
+			 unsigned long long now)
+{
+	if (fs->state[cpu] == CPU_BUSY)
+		trace_busy(t, cpu, fs->since[cpu], now, fs->freq);
+	fs->since[cpu] = now;
+}
+
+static int parse_ftrace_line(struct trace *t, struct ftrace_state *fs,
+			     const char *line)
+{
+	unsigned long type, state;
+	unsigned long long now;
+	const char *p, *ev;
+	double ts;
+	char *end;
+	int cpu, i;
+
+	ev = strstr(line, ": power_");
+	p = strchr(line, '[');
+	if (!ev || !p)
+		return 0;
+
+	cpu = strtol(p + 1, &end, 10);
+	if (*end != ']' || cpu < 0)
+		return 0;
+	if (cpu >= SIM_NR_CPUS)
+		return 1;
+
+	/* skip the optional irq/preempt flags column */
+	p = end + 1;
+	ts = strtod(p, &end);
+	if (end == p || *end != ':') {
+		while (isspace(*p))
+			p++;
+		while (*p && !isspace(*p))
+			p++;
+		ts = strtod(p, &end);
+		if (end == p)
+			return 0;
+	}
+
+	if (!fs->started) {
+		fs->t0 = (unsigned long long)(ts * 1000000.0);
+		fs->started = 1;
+	}
+	now = (unsigned long long)(ts * 1000000.0) - fs->t0;
+
+	ev += 2;
+	if (!strncmp(ev, "power_frequency:", 16)) {
+		if (sscanf(ev + 16, " type=%lu state=%lu", &type, &state) != 2)
+			return 0;
+		for (i = 0; i < SIM_NR_CPUS; i++)
+			ftrace_flush(t, fs, i, now);
+		fs->freq = state;
+	} else if (!strncmp(ev, "power_start:", 12)) {
+		ftrace_flush(t, fs, cpu, now);
+		fs->state[cpu] = CPU_IDLE;
+	} else if (!strncmp(ev, "power_end:", 10)) {
+		ftrace_flush(t, fs, cpu, now);
+		fs->state[cpu] = CPU_BUSY;
+	}
+
+	trace_grow(t, now / 1000);
+	return 1;
+}
+
+/*
+ * Sampled load, e.g. from polling /proc/stat and scaling_cur_freq:
+ *   <time_us> <cpu> <busy_percent> <freq_khz>
+ * Each line covers the time since the previous line of that cpu.
+ */
+static int parse_sample_line(struct trace *t, unsigned long long *last,
+			     const char *line)
+{
+	unsigned long long now;
+	unsigned int busy, freq;
+	int cpu;
+
+	if (sscanf(line, "%llu %d %u %u", &now, &cpu, &busy, &freq) != 4)
+		return 0;
+	if (cpu < 0 || cpu >= SIM_NR_CPUS)
+		return 1;
+
+	/* spread the busy time evenly over the interval */
+	if (now > last[cpu] && busy)
+		trace_busy(t, cpu, last[cpu], now,
+			   (unsigned int)((unsigned long long)freq * busy / 100));
+	last[cpu] = now;
+	trace_grow(t, now / 1000);
+	return 1;
+}
+
+static int load_trace(struct trace *t, const char *path, unsigned int freq)
+{
+	struct ftrace_state fs;
+	unsigned long long last[SIM_NR_CPUS];
+	char line[1024];
+	int lineno = 0, bad = 0;
+	FILE *f;
+
+	f = strcmp(path, "-") ? fopen(path, "r") : stdin;
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+
+	memset(&fs, 0, sizeof(fs));
+	memset(last, 0, sizeof(last));
+	fs.freq = freq;
+	t->name = path;
+
+	while (fgets(line, sizeof(line), f)) {
+		lineno++;
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (strstr(line, "power_")) {
+			if (!parse_ftrace_line(t, &fs, line))
+				bad++;
+		} else if (!parse_sample_line(t, last, line)) {
+			bad++;
+		}
+	}
+
+	if (fs.started) {
+		int cpu;
+
+		for (cpu = 0; cpu < SIM_NR_CPUS; cpu++)
+			ftrace_flush(t, &fs, cpu,
+				     (unsigned long long)t->len_ms * 1000);
+	}
+
+	if (f != stdin)
+		fclose(f);
+
+	if (bad)
+		fprintf(stderr, "%s: %d of %d lines not understood\n",
+			path, bad, lineno);
+
+	if (!t->len_ms) {
+		fprintf(stderr, "%s: empty trace\n", path);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* synthetic workloads, for comparing governors without a device */
+
+static unsigned int rand_state = 1;
+
+static double jitter(double v)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return v * (0.9 + ((rand_state >> 16) % 201) / 1000.0);
+}
+
+/* a job of the given cycles arriving on cpu every period ms */
+static void add_jobs(struct trace *t, int cpu, unsigned int from,
+		     unsigned int to, unsigned int period, double cycles)
+{
+	unsigned int ms;
+
+	for (ms = from; ms < to && ms < t->len_ms; ms += period)
+		t->demand[cpu][ms] += jitter(cycles);
+}
+
+static int make_workload(struct trace *t, const char *name)
+{
+	unsigned int ms;
+
+	t->name = name;
+	rand_state = 1;
+
+	if (!strcmp(name, "idle")) {
+		/* background syncs and alarms */
+		trace_grow(t, 10000 - 1);
+		add_jobs(t, 0, 0, t->len_ms, 200, 400000);
+		add_jobs(t, 1, 50, t->len_ms, 1000, 200000);
+	} else if (!strcmp(name, "scroll")) {
+		/* 1s of list scrolling every 3s, 60fps */
+		trace_grow(t, 15000 - 1);
+		for (ms = 0; ms < t->len_ms; ms += 3000) {
+			add_jobs(t, 0, ms, ms + 1000, 16, 4800000);
+			add_jobs(t, 1, ms + 2, ms + 1000, 16, 1000000);
+		}
+	} else if (!strcmp(name, "video")) {
+		/* 30fps decode and audio */
+		trace_grow(t, 10000 - 1);
+		add_jobs(t, 0, 0, t->len_ms, 33, 8000000);
+		add_jobs(t, 1, 5, t->len_ms, 20, 200000);
+	} else if (!strcmp(name, "game")) {
+		/* 60fps render and game logic */
+		trace_grow(t, 10000 - 1);
+		add_jobs(t, 0, 0, t->len_ms, 16, 12000000);
+		add_jobs(t, 1, 8, t->len_ms, 16, 6000000);
+	} else if (!strcmp(name, "launch")) {
+		/* application start, then reading */
+		trace_grow(t, 15000 - 1);
+		for (ms = 0; ms < t->len_ms; ms += 5000) {
+			add_jobs(t, 0, ms, ms + 1500, 1, 1100000);
+			add_jobs(t, 1, ms, ms + 1500, 1, 600000);
+			add_jobs(t, 0, ms + 1500, ms + 5000, 500, 300000);
+		}
+	} else {
+		return -1;
+	}
+
+	return 0;
+}
+
+/* replay */
+
+/* -t tunables, set again after every start() as sysfs writes would be */
+static struct sim_tune {
+	const char *gov;
+	const char *name;
+	const char *value;
+} sim_tunes[MAX_TUNES];
+static int sim_nr_tunes;
+
+static void apply_tunes(struct sim_governor *gov)
+{
+	int i;
+
+	for (i = 0; i < sim_nr_tunes; i++)
+		if (!strcmp(sim_tunes[i].gov, gov->name))
+			gov->tune(gov, sim_tunes[i].name, sim_tunes[i].value);
+}
+
+static void run(struct sim_governor *gov, const struct trace *t,
+		struct result *r)
+{
+	struct sim_policy policy = base_policy;
+	struct sim_policy *p = &policy;
+	double backlog[SIM_NR_CPUS] = { 0 };
+	double win_busy[SIM_NR_CPUS] = { 0 };
+	double chg_busy[SIM_NR_CPUS] = { 0 };
+	unsigned long long win_start = 0, chg_start = 0, next_sample;
+	unsigned int ms;
+	int cpu;
+
+	memset(r, 0, sizeof(*r));
+
+	/* boot frequency */
+	p->cur = p->max;
+	if (gov->start)
+		gov->start(gov, p);
+	apply_tunes(gov);
+
+	next_sample = gov->rate_us;
+
+	for (ms = 0; ms < t->len_ms; ms++) {
+		int idx = cur_index(p);
+		double volt = p->volt[idx] / 1000000.0;
+		unsigned int nr_running = 1;
+		double cap = p->cur;
+
+		for (cpu = 0; cpu < SIM_NR_CPUS; cpu++) {
+			double done, delay;
+
+			backlog[cpu] += t->demand[cpu][ms];
+			done = backlog[cpu] < cap ? backlog[cpu] : cap;
+			backlog[cpu] -= done;
+
+			win_busy[cpu] += done / cap * 1000.0;
+			chg_busy[cpu] += done / cap * 1000.0;
+			r->energy += done * volt * volt;
+
+			if (done > 0)
+				nr_running++;
+			if (backlog[cpu] > 0)
+				nr_running++;
+
+			if (done > 0 || backlog[cpu] > 0) {
+				/* time still needed to finish queued work */
+				delay = backlog[cpu] / cap;
+				r->lat_sum += delay;
+				r->lat_samples++;
+				if (delay > r->lat_max)
+					r->lat_max = delay;
+				r->lat_hist[delay < LAT_HIST_MS ?
+					    (unsigned int)delay : LAT_HIST_MS]++;
+			}
+		}
+
+		r->vtime += volt / 1000.0;
+		r->time_in_state[idx]++;
+		p->now += 1000;
+
+		if (p->now < next_sample)
+			continue;
+
+		{
+			struct sim_load load = { .nr_running = nr_running };
+			unsigned int wall = p->now - win_start;
+			unsigned int chg_wall = p->now - chg_start;
+			unsigned long long changed = p->freq_change_time;
+
+			load.idle_us = wall;
+			for (cpu = 0; cpu < SIM_NR_CPUS; cpu++) {
+				unsigned int l = win_busy[cpu] * 100 / wall;
+				unsigned int lc = chg_wall ?
+					chg_busy[cpu] * 100 / chg_wall : l;
+
+				if (l > 100)
+					l = 100;
+				if (lc > 100)
+					lc = 100;
+				if (l >= load.load) {
+					load.load = l;
+					load.idle_us = wall - (unsigned int)
+						       win_busy[cpu];
+				}
+				if (lc > load.load_since_change)
+					load.load_since_change = lc;
+				win_busy[cpu] = 0;
+			}
+			win_start = p->now;
+
+			gov->sample(gov, p, &load);
+
+			if (p->freq_change_time != changed) {
+				chg_start = p->now;
+				for (cpu = 0; cpu < SIM_NR_CPUS; cpu++)
+					chg_busy[cpu] = 0;
+			}
+		}
+
+		next_sample = p->now + (gov->rate_us ? gov->rate_us : 1000);
+	}
+
+	r->transitions = p->transitions;
+}
+
+static double lat_percentile(const struct result *r, unsigned int pct)
+{
+	unsigned long want = r->lat_samples * pct / 100;
+	unsigned long seen = 0;
+	int i;
+
+	for (i = 0; i <= LAT_HIST_MS; i++) {
+		seen += r->lat_hist[i];
+		if (seen > want)
+			return i;
+	}
+	return LAT_HIST_MS;
+}
+
+static void report_header(const struct trace *t)
+{
+	int i;
+
+	printf("\n%s: %u ms\n", t->name, t->len_ms);
+	printf("%-15s %10s %6s %8s %8s %8s %8s %6s ",
+	       "governor", "energy", "rel%", "vtime", "lat-avg", "lat-p95",
+	       "lat-max", "trans");
+	for (i = 0; i < base_policy.nr_levels; i++)
+		printf(" %5u", base_policy.table[i] / 1000);
+	printf("\n");
+}
+
+static void report(const char *name, const struct result *r, double ref)
+{
+	unsigned long total = 0;
+	int i;
+
+	for (i = 0; i < base_policy.nr_levels; i++)
+		total += r->time_in_state[i];
+
+	printf("%-15s %10.1f %6.1f %8.3f %8.2f %8.0f %8.1f %6lu ",
+	       name, r->energy / 1e6, ref > 0 ? 100.0 * r->energy / ref : 0,
+	       r->vtime,
+	       r->lat_samples ? r->lat_sum / r->lat_samples : 0,
+	       lat_percentile(r, 95), r->lat_max, r->transitions);
+	for (i = 0; i < base_policy.nr_levels; i++)
+		printf(" %4.0f%%", total ?
+		       100.0 * r->time_in_state[i] / total : 0);
+	printf("\n");
+}
+
+/*
+ * cpufreq_stats time_in_state of the recording device, in 10ms units,
+ * reported next to the simulated governors for reference.
+ */
+static void report_time_in_state(const char *path)
+{
+	unsigned long long total = 0, t[SIM_MAX_LEVELS] = { 0 };
+	unsigned int freq;
+	unsigned long long time;
+	double vtime = 0;
+	FILE *f;
+	int i;
+
+	f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return;
+	}
+
+	while (fscanf(f, "%u %llu", &freq, &time) == 2) {
+		for (i = 0; i < base_policy.nr_levels; i++) {
+			if (base_policy.table[i] != freq)
+				continue;
+			t[i] += time * 10;
+			total += time * 10;
+			vtime += time * 10 * base_policy.volt[i] / 1e9;
+		}
+	}
+	fclose(f);
+
+	printf("%-15s %10s %6s %8.3f %8s %8s %8s %6s ", "recorded", "-", "-",
+	       vtime, "-", "-", "-", "-");
+	for (i = 0; i < base_policy.nr_levels; i++)
+		printf(" %4.0f%%", total ? 100.0 * t[i] / total : 0);
+	printf("\n");
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options] [trace...]\n"
+		"  -g gov[,gov...]    governors to run (default: all)\n"
+		"  -t gov:name=value  set a governor tunable\n"
+		"  -w workload[,...]  synthetic workload: idle, scroll, video,\n"
+		"                     game, launch or all (default: all when no\n"
+		"                     trace is given)\n"
+		"  -a group           ASV group 0-7 for the voltage table\n"
+		"                     (default 2, the nominal table)\n"
+		"  -m khz             scaling_max_freq (default 1200000)\n"
+		"  -f khz             trace frequency until the first\n"
+		"                     power_frequency event (default max)\n"
+		"  -s file            cpufreq_stats time_in_state of the trace\n"
+		"  -l                 list governors\n"
+		"\n"
+		"A trace is ftrace output with the power:power_start,\n"
+		"power:power_end and power:power_frequency events, or lines of\n"
+		"\"<time_us> <cpu> <busy_percent> <freq_khz>\".\n"
+		"energy is the sum of executed cycles * V^2 (x1e6), rel%% is\n"
+		"relative to the first governor, vtime the sum of seconds * V.\n"
+		"Latencies are in ms of queued work at the current frequency.\n",
+		prog);
+}
+
+int main(int argc, char **argv)
+{
+	static const char *all_workloads = "idle,scroll,video,game,launch";
+	struct sim_governor *govs[MAX_GOVS], *run_govs[MAX_GOVS];
+	char *tunes[MAX_TUNES];
+	const char *gov_list = NULL, *workloads = NULL, *stats = NULL;
+	int nr_govs, nr_run = 0, nr_tunes = 0;
+	unsigned int max_freq = 0, trace_freq = 0;
+	int asv_group = 2, list = 0;
+	int opt, i, j;
+
+	while ((opt = getopt(argc, argv, "g:t:w:a:m:f:s:lh")) != -1) {
+		switch (opt) {
+		case 'g':
+			gov_list = optarg;
+			break;
+		case 't':
+			if (nr_tunes < MAX_TUNES)
+				tunes[nr_tunes++] = optarg;
+			break;
+		case 'w':
+			workloads = strcmp(optarg, "all") ? optarg :
+				    all_workloads;
+			break;
+		case 'a':
+			asv_group = atoi(optarg);
+			if (asv_group < 0 || asv_group > 7) {
+				fprintf(stderr, "ASV group must be 0-7\n");
+				return 1;
+			}
+			break;
+		case 'm':
+			max_freq = strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			trace_freq = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			stats = optarg;
+			break;
+		case 'l':
+			list = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	setup_policy(asv_group, max_freq);
+
+	govs[0] = &sim_gov_performance;
+	govs[1] = &sim_gov_powersave;
+	govs[2] = &sim_gov_interactive;
+	nr_govs = 3;
+	nr_govs += sim_core_governors(govs + nr_govs, MAX_GOVS - nr_govs);
+
+	if (list) {
+		for (i = 0; i < nr_govs; i++)
+			printf("%s\n", govs[i]->name);
+		return 0;
+	}
+
+	for (i = 0; i < nr_govs; i++) {
+		if (gov_list) {
+			const char *s = gov_list;
+			size_t n = strlen(govs[i]->name);
+
+			/* smartass is also a prefix of smartassV2 */
+			while ((s = strstr(s, govs[i]->name)) &&
+			       ((s != gov_list && s[-1] != ',') ||
+				(s[n] && s[n] != ',')))
+				s += n;
+			if (!s)
+				continue;
+		}
+		run_govs[nr_run++] = govs[i];
+	}
+	if (!nr_run) {
+		fprintf(stderr, "no governor selected, try -l\n");
+		return 1;
+	}
+
+	for (i = 0; i < nr_tunes; i++) {
+		char *colon = strchr(tunes[i], ':');
+		char *eq = colon ? strchr(colon, '=') : NULL;
+		int done = 0;
+
+		if (!eq) {
+			fprintf(stderr, "bad tunable %s\n", tunes[i]);
+			return 1;
+		}
+		*colon = *eq = '\0';
+		for (j = 0; j < nr_govs; j++)
+			if (!strcmp(govs[j]->name, tunes[i]) && govs[j]->tune &&
+			    !govs[j]->tune(govs[j], colon + 1, eq + 1))
+				done = 1;
+		if (!done) {
+			fprintf(stderr, "%s: cannot set %s\n", tunes[i],
+				colon + 1);
+			return 1;
+		}
+		sim_tunes[sim_nr_tunes].gov = tunes[i];
+		sim_tunes[sim_nr_tunes].name = colon + 1;
+		sim_tunes[sim_nr_tunes].value = eq + 1;
+		sim_nr_tunes++;
+	}
+
+	if (!workloads && optind == argc)
+		workloads = all_workloads;
+
+	for (i = optind; i <= argc; i++) {
+		char *names = NULL, *name, *save = NULL;
+
+		if (i == argc) {
+			if (!workloads)
+				break;
+			names = strdup(workloads);
+		}
+
+		for (name = names ? strtok_r(names, ",", &save) : argv[i]; name;
+		     name = names ? strtok_r(NULL, ",", &save) : NULL) {
+			struct trace t;
+			double ref = 0;
+
+			memset(&t, 0, sizeof(t));
+			if (names ? make_workload(&t, name) :
+			    load_trace(&t, name, trace_freq ? trace_freq :
+				       base_policy.max)) {
+				if (names)
+					fprintf(stderr, "unknown workload %s\n",
+						name);
+				return 1;
+			}
+
+			report_header(&t);
+			for (j = 0; j < nr_run; j++) {
+				struct result r;
+
+				run(run_govs[j], &t, &r);
+				if (!j)
+					ref = r.energy;
+				report(run_govs[j]->name, &r, ref);
+			}
+			if (stats && !names)
+				report_time_in_state(stats);
+
+			for (j = 0; j < SIM_NR_CPUS; j++)
+				free(t.demand[j]);
+		}
+		free(names);
+	}
+
+	return 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * governors.c -- models of the timer driven cpufreq governors
+ *
+ * Copyright (C) 2011 Samsung Electronics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * These governors run their own timers, idle hooks and kthreads, or need
+ * the input layer, and can not be linked into userspace. Their frequency
+ * decisions are ported here with the default tunables of drivers/cpufreq,
+ * one function per governor timer; the replay loop supplies the load figures the timers
+ * would have computed from get_cpu_idle_time_us().
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+
+/* CONFIG_HZ=200 on the S5PV310 boards, timers re-arm every 2 jiffies */
+#define SIM_TIMER_RATE_US	10000
+
+static unsigned long tune_value(const char *value)
+{
+	return strtoul(value, NULL, 0);
+}
+
+/* performance / powersave */
+
+static void performance_start(struct sim_governor *gov, struct sim_policy *p)
+{
+	sim_driver_target(p, p->max, SIM_RELATION_H);
+}
+
+static void powersave_start(struct sim_governor *gov, struct sim_policy *p)
+{
+	sim_driver_target(p, p->min, SIM_RELATION_L);
+}
+
+static void static_sample(struct sim_governor *gov, struct sim_policy *p,
+			  const struct sim_load *load)
+{
+}
+
+struct sim_governor sim_gov_performance = {
+	.name		= "performance",
+	.rate_us	= 1000000,
+	.start		= performance_start,
+	.sample		= static_sample,
+};
+
+struct sim_governor sim_gov_powersave = {
+	.name		= "powersave",
+	.rate_us	= 1000000,
+	.start		= powersave_start,
+	.sample		= static_sample,
+};
+
+/*
+ * interactive: cpufreq_interactive_select(). It runs on the common core
+ * but needs the input layer for its boost, so it is modelled here too.
+ */
+
+static unsigned int ia_go_maxspeed_load = 85;
+static unsigned int ia_min_sample_time = 80000;
+static unsigned int ia_target_freq;
+
+static void interactive_start(struct sim_governor *gov, struct sim_policy *p)
+{
+	ia_target_freq = p->cur;
+}
+
+static void interactive_sample(struct sim_governor *gov, struct sim_policy *p,
+			       const struct sim_load *load)
+{
+	unsigned int cpu_load = load->load;
+	unsigned int new_freq;
+
+	if (load->load_since_change > cpu_load)
+		cpu_load = load->load_since_change;
+
+	if (cpu_load >= ia_go_maxspeed_load)
+		new_freq = p->max;
+	else
+		new_freq = p->max * cpu_load / 100;
+
+	new_freq = p->table[sim_freq_index(p, new_freq, SIM_RELATION_H)];
+	if (ia_target_freq == new_freq)
+		return;
+
+	/*
+	 * Do not scale down unless we have been at this frequency for the
+	 * minimum sample time.
+	 */
+	if (new_freq < ia_target_freq &&
+	    p->now - p->freq_change_time < ia_min_sample_time)
+		return;
+
+	ia_target_freq = new_freq;
+	sim_driver_target(p, new_freq, SIM_RELATION_H);
+}
+
+static int interactive_tune(struct sim_governor *gov, const char *name,
+			    const char *value)
+{
+	if (!strcmp(name, "go_maxspeed_load"))
+		ia_go_maxspeed_load = tune_value(value);
+	else if (!strcmp(name, "min_sample_time"))
+		ia_min_sample_time = tune_value(value);
+	else
+		return -1;
+	return 0;
+}
+
+struct sim_governor sim_gov_interactive = {
+	.name		= "interactive",
+	.rate_us	= SIM_TIMER_RATE_US,
+	.start		= interactive_start,
+	.sample		= interactive_sample,
+	.tune		= interactive_tune,
+};
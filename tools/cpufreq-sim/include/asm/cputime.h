@@ -0,0 +1,6 @@
+#ifndef _SIM_ASM_CPUTIME_H
+#define _SIM_ASM_CPUTIME_H
+
+#include <linux/kernel.h>
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef _SIM_LINUX_CPU_H
+#define _SIM_LINUX_CPU_H
+
+#include <linux/kernel.h>
+
+/* hotplug requests never reach these, see queue_work_on() */
+static inline int cpu_up(unsigned int cpu) { return 0; }
+static inline int cpu_down(unsigned int cpu) { return 0; }
+
+#endif
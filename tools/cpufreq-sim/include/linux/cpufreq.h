@@ -0,0 +1,105 @@
+#ifndef _SIM_LINUX_CPUFREQ_H
+#define _SIM_LINUX_CPUFREQ_H
+
+#include <linux/kernel.h>
+#include <linux/cpumask.h>
+
+#define CPUFREQ_NAME_LEN	16
+#define CPUFREQ_RELATION_L	SIM_RELATION_L
+#define CPUFREQ_RELATION_H	SIM_RELATION_H
+
+struct cpufreq_governor;
+
+struct cpufreq_cpuinfo {
+	unsigned int max_freq;
+	unsigned int min_freq;
+	unsigned int transition_latency;
+};
+
+struct cpufreq_policy {
+	unsigned int cpu;
+	unsigned int min;
+	unsigned int max;
+	unsigned int cur;
+	cpumask_var_t cpus;
+	struct cpufreq_cpuinfo cpuinfo;
+	struct cpufreq_governor *governor;
+	void *governor_data;
+	struct sim_policy *sim;
+};
+
+struct cpufreq_governor {
+	char name[CPUFREQ_NAME_LEN];
+	int (*governor)(struct cpufreq_policy *policy, unsigned int event);
+	unsigned int max_transition_latency;
+	struct module *owner;
+};
+
+struct freq_attr {
+	struct attribute attr;
+	ssize_t (*show)(struct cpufreq_policy *, char *);
+	ssize_t (*store)(struct cpufreq_policy *, const char *, size_t count);
+};
+
+#define __ATTR(_name, _mode, _show, _store) {				\
+	.attr = { .name = __stringify(_name), .mode = _mode },		\
+	.show = _show,							\
+	.store = _store,						\
+}
+
+struct global_attr {
+	struct attribute attr;
+	ssize_t (*show)(struct kobject *kobj,
+			struct attribute *attr, char *buf);
+	ssize_t (*store)(struct kobject *a, struct attribute *b,
+			 const char *c, size_t count);
+};
+
+#define define_one_global_ro(_name)		\
+static struct global_attr _name =		\
+__ATTR(_name, 0444, show_##_name, NULL)
+
+#define define_one_global_rw(_name)		\
+static struct global_attr _name =		\
+__ATTR(_name, 0644, show_##_name, store_##_name)
+
+#define CPUFREQ_TABLE_END	~1
+
+/* built from the levels of the simulated policy by core.c */
+struct cpufreq_frequency_table {
+	unsigned int index;
+	unsigned int frequency;
+};
+
+struct cpufreq_frequency_table *cpufreq_frequency_get_table(unsigned int cpu);
+int cpufreq_frequency_table_target(struct cpufreq_policy *policy,
+				   struct cpufreq_frequency_table *table,
+				   unsigned int target_freq,
+				   unsigned int relation,
+				   unsigned int *index);
+
+/* only the policy being replayed exists, there is none to look up */
+static inline struct cpufreq_policy *cpufreq_cpu_get(unsigned int cpu)
+{
+	return NULL;
+}
+
+/* no APERF/MPERF to average over */
+static inline int __cpufreq_driver_getavg(struct cpufreq_policy *policy,
+					  unsigned int cpu)
+{
+	return 0;
+}
+
+#define CPUFREQ_IDLE_SLACK_US	500
+
+static inline bool cpufreq_window_idle(unsigned int wall_us,
+				       unsigned int idle_us)
+{
+	return wall_us && idle_us + CPUFREQ_IDLE_SLACK_US >= wall_us;
+}
+
+int __cpufreq_driver_target(struct cpufreq_policy *policy,
+			    unsigned int target_freq, unsigned int relation);
+
+#endif /* _SIM_LINUX_CPUFREQ_H */
@@ -0,0 +1,21 @@
+#ifndef _SIM_LINUX_CPUIDLE_H
+#define _SIM_LINUX_CPUIDLE_H
+
+#include <linux/kernel.h>
+
+#define CPUIDLE_STATE_MAX	8
+
+struct cpuidle_state {
+	unsigned int usage;
+	unsigned long long time;
+};
+
+struct cpuidle_device {
+	int state_count;
+	struct cpuidle_state states[CPUIDLE_STATE_MAX];
+};
+
+/* the traces carry no idle state statistics, no cpu has a device */
+DECLARE_PER_CPU(struct cpuidle_device *, cpuidle_devices);
+
+#endif
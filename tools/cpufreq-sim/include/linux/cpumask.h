@@ -0,0 +1,15 @@
+#ifndef _SIM_LINUX_CPUMASK_H
+#define _SIM_LINUX_CPUMASK_H
+
+#include <linux/kernel.h>
+
+/* every policy spans all the simulated cpus */
+typedef unsigned long cpumask_var_t;
+
+/* the replay runs a single load, as if only the boot cpu were online */
+#define num_online_cpus()	1U
+
+#define for_each_cpu(cpu, mask) \
+	for ((cpu) = 0, (void)(mask); (cpu) < SIM_NR_CPUS; (cpu)++)
+
+#endif
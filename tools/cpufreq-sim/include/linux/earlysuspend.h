@@ -0,0 +1,22 @@
+#ifndef _SIM_LINUX_EARLYSUSPEND_H
+#define _SIM_LINUX_EARLYSUSPEND_H
+
+#include <linux/kernel.h>
+
+enum {
+	EARLY_SUSPEND_LEVEL_BLANK_SCREEN = 50,
+	EARLY_SUSPEND_LEVEL_STOP_DRAWING = 100,
+	EARLY_SUSPEND_LEVEL_DISABLE_FB = 150,
+};
+
+struct early_suspend {
+	int level;
+	void (*suspend)(struct early_suspend *h);
+	void (*resume)(struct early_suspend *h);
+};
+
+/* the replay has no screen, handlers are never called */
+static inline void register_early_suspend(struct early_suspend *h) { }
+static inline void unregister_early_suspend(struct early_suspend *h) { }
+
+#endif /* _SIM_LINUX_EARLYSUSPEND_H */
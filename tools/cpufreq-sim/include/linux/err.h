@@ -0,0 +1,13 @@
+#ifndef _SIM_LINUX_ERR_H
+#define _SIM_LINUX_ERR_H
+
+#include <linux/kernel.h>
+
+#define MAX_ERRNO		4095
+
+static inline long IS_ERR(const void *ptr)
+{
+	return (unsigned long)ptr >= (unsigned long)-MAX_ERRNO;
+}
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef _SIM_LINUX_INIT_H
+#define _SIM_LINUX_INIT_H
+
+#include <linux/kernel.h>
+
+#endif
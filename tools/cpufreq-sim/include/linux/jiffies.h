@@ -0,0 +1,19 @@
+#ifndef _SIM_LINUX_JIFFIES_H
+#define _SIM_LINUX_JIFFIES_H
+
+#include <linux/kernel.h>
+
+/* CONFIG_HZ of the S5PV310 boards */
+#define HZ			200
+
+static inline unsigned int jiffies_to_usecs(unsigned long j)
+{
+	return j * (1000000 / HZ);
+}
+
+static inline unsigned long usecs_to_jiffies(unsigned int u)
+{
+	return (u + (1000000 / HZ) - 1) / (1000000 / HZ);
+}
+
+#endif
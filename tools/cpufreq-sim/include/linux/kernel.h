@@ -0,0 +1,150 @@
+/*
+ * Minimal userspace stand-ins for the kernel interfaces used by the
+ * cpufreq governors, so that governors built on cpufreq_governor.h can
+ * be compiled unmodified into the replay simulator.
+ */
+
+#ifndef _SIM_LINUX_KERNEL_H
+#define _SIM_LINUX_KERNEL_H
+
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "../../sim.h"
+
+typedef unsigned long long u64;
+typedef unsigned long long cputime64_t;
+
+#define __init
+#define __exit
+#define __percpu
+#define likely(x)		(x)
+#define unlikely(x)		(x)
+#define __stringify(x)		#x
+
+#define KERN_ERR		"<3>"
+#define KERN_WARNING		"<4>"
+#define KERN_INFO		"<6>"
+#define KERN_DEBUG		"<7>"
+
+/* like pr_info(), informational and debug messages are not printed */
+static inline __attribute__((format(printf, 1, 2)))
+int printk(const char *fmt, ...)
+{
+	va_list args;
+	int ret;
+
+	if (fmt[0] == '<' && fmt[1] && fmt[2] == '>') {
+		if (fmt[1] > '4')
+			return 0;
+		fmt += 3;
+	}
+	va_start(args, fmt);
+	ret = vprintf(fmt, args);
+	va_end(args);
+	return ret;
+}
+
+#define printk_once		printk
+#define pr_info(fmt, ...)	do { } while (0)
+#define pr_err(fmt, ...)	fprintf(stderr, fmt, ##__VA_ARGS__)
+
+#define min(x, y)		((x) < (y) ? (x) : (y))
+#define max(x, y)		((x) > (y) ? (x) : (y))
+
+#define DIV_ROUND_UP(n, d)	(((n) + (d) - 1) / (d))
+
+static inline int strict_strtoul(const char *cp, unsigned int base,
+				 unsigned long *res)
+{
+	char *end;
+
+	*res = strtoul(cp, &end, base);
+	return end == cp ? -EINVAL : 0;
+}
+
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define EXPORT_SYMBOL(sym)
+#define EXPORT_SYMBOL_GPL(sym)
+
+struct module;
+#define THIS_MODULE		((struct module *)NULL)
+
+/* initcalls run from a constructor, exitcalls are never run */
+#define module_init(fn)						\
+	static void __attribute__((constructor)) __sim_init_##fn(void) \
+	{ fn(); }
+#define fs_initcall(fn)		module_init(fn)
+#define module_exit(fn)						\
+	static void (*__sim_exit_##fn)(void) __attribute__((unused)) = fn
+
+struct task_struct {
+	char comm[16];
+};
+extern struct task_struct sim_current_task;
+#define current			(&sim_current_task)
+
+struct mutex {
+	int locked;
+};
+#define DEFINE_MUTEX(m)		struct mutex m = { 0 }
+static inline void mutex_init(struct mutex *m) { m->locked = 0; }
+static inline void mutex_lock(struct mutex *m) { m->locked = 1; }
+static inline void mutex_unlock(struct mutex *m) { m->locked = 0; }
+
+/* the replay is single threaded */
+typedef struct {
+	int counter;
+} atomic_t;
+#define ATOMIC_INIT(i)		{ (i) }
+static inline int atomic_inc_return(atomic_t *v) { return ++v->counter; }
+static inline int atomic_dec_return(atomic_t *v) { return --v->counter; }
+static inline void atomic_dec(atomic_t *v) { v->counter--; }
+#define xchg(ptr, v)		__sync_lock_test_and_set(ptr, v)
+
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+struct work_struct {
+	int pending;
+	void (*func)(struct work_struct *work);
+};
+
+struct delayed_work {
+	int pending;
+};
+
+struct kobject;
+
+struct attribute {
+	const char *name;
+	unsigned short mode;
+};
+
+struct attribute_group {
+	const char *name;
+	struct attribute **attrs;
+};
+
+#define DEFINE_PER_CPU(type, name)	type name[SIM_NR_CPUS]
+#define DECLARE_PER_CPU(type, name)	extern type name[SIM_NR_CPUS]
+#define per_cpu(var, cpu)	((var)[cpu])
+#define per_cpu_ptr(ptr, cpu)	(&(ptr)[cpu])
+#define get_cpu()		0
+#define put_cpu()		do { } while (0)
+#define for_each_online_cpu(cpu) \
+	for ((cpu) = 0; (cpu) < SIM_NR_CPUS; (cpu)++)
+#define for_each_possible_cpu(cpu)	for_each_online_cpu(cpu)
+
+#endif /* _SIM_LINUX_KERNEL_H */
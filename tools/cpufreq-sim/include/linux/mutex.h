@@ -0,0 +1,6 @@
+#ifndef _SIM_LINUX_MUTEX_H
+#define _SIM_LINUX_MUTEX_H
+
+#include <linux/kernel.h>
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef _SIM_LINUX_SCHED_H
+#define _SIM_LINUX_SCHED_H
+
+#include <linux/kernel.h>
+
+/* runnable tasks of the sample being replayed, including the governor */
+unsigned long nr_running(void);
+
+/* the replay loop has no runqueue, util_kick is never acted on */
+struct sched_util_hook {
+	void (*func)(struct sched_util_hook *hook, int cpu, unsigned long util);
+};
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef _SIM_LINUX_SLAB_H
+#define _SIM_LINUX_SLAB_H
+
+#include <stdlib.h>
+
+#include <linux/kernel.h>
+
+#define GFP_KERNEL		0
+
+static inline void *kmalloc(size_t size, int flags)
+{
+	return malloc(size);
+}
+
+static inline void kfree(const void *p)
+{
+	free((void *)p);
+}
+
+#endif
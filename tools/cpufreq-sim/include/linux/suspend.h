@@ -0,0 +1,31 @@
+#ifndef _SIM_LINUX_SUSPEND_H
+#define _SIM_LINUX_SUSPEND_H
+
+#include <linux/kernel.h>
+
+#define NOTIFY_DONE		0x0000
+
+#define PM_HIBERNATION_PREPARE	0x0001
+#define PM_POST_HIBERNATION	0x0002
+#define PM_SUSPEND_PREPARE	0x0003
+#define PM_POST_SUSPEND		0x0004
+#define PM_RESTORE_PREPARE	0x0005
+#define PM_POST_RESTORE		0x0006
+
+struct notifier_block {
+	int (*notifier_call)(struct notifier_block *nb, unsigned long action,
+			     void *data);
+};
+
+/* the replay never suspends, notifiers are never called */
+static inline int register_pm_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
+
+static inline int unregister_pm_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef _SIM_LINUX_TICK_H
+#define _SIM_LINUX_TICK_H
+
+#include <linux/kernel.h>
+
+/* no idle micro accounting, the replay loop does the idle accounting */
+static inline u64 get_cpu_idle_time_us(int cpu, u64 *last_update_time)
+{
+	return -1ULL;
+}
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef _SIM_LINUX_TIMER_H
+#define _SIM_LINUX_TIMER_H
+
+#include <linux/kernel.h>
+
+struct timer_list {
+	int pending;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef _SIM_LINUX_WORKQUEUE_H
+#define _SIM_LINUX_WORKQUEUE_H
+
+#include <linux/kernel.h>
+
+/* queued work is dropped, the replay has nothing to run it on */
+struct workqueue_struct {
+	int unused;
+};
+
+#define DECLARE_WORK(n, f)	struct work_struct n = { .func = (f) }
+
+static inline struct workqueue_struct *create_workqueue(const char *name)
+{
+	static struct workqueue_struct wq;
+
+	return &wq;
+}
+
+static inline void destroy_workqueue(struct workqueue_struct *wq)
+{
+}
+
+static inline int queue_work_on(int cpu, struct workqueue_struct *wq,
+				struct work_struct *work)
+{
+	return 0;
+}
+
+#endif
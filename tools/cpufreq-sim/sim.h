@@ -0,0 +1,74 @@
+/*
+ * sim.h -- cpufreq governor replay simulator
+ *
+ * Copyright (C) 2011 Samsung Electronics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _CPUFREQ_SIM_H
+#define _CPUFREQ_SIM_H
+
+#define SIM_NR_CPUS		2
+#define SIM_MAX_LEVELS		8
+
+#define SIM_RELATION_L		0	/* lowest frequency at or above target */
+#define SIM_RELATION_H		1	/* highest frequency at or below target */
+
+/* one frequency domain, shared by all cpus as on S5PV310 */
+struct sim_policy {
+	unsigned int min;
+	unsigned int max;
+	unsigned int cur;
+	/* kHz, fastest first like s5pv310_freq_table */
+	unsigned int table[SIM_MAX_LEVELS];
+	unsigned int volt[SIM_MAX_LEVELS];	/* uV */
+	int nr_levels;
+
+	unsigned long long now;			/* us */
+	unsigned long long freq_change_time;	/* us */
+	unsigned long transitions;
+	void *priv;
+};
+
+/* what a governor gets to see every sampling period */
+struct sim_load {
+	/* highest busy percentage of all cpus since the previous sample */
+	unsigned int load;
+	/* highest busy percentage since the last frequency change */
+	unsigned int load_since_change;
+	/* idle time of the busiest cpu during the sampling window */
+	unsigned int idle_us;
+	/* runnable tasks, including the one evaluating the governor */
+	unsigned int nr_running;
+};
+
+struct sim_governor {
+	const char *name;
+	/* sampling period in us, may be changed by start() */
+	unsigned int rate_us;
+	void (*start)(struct sim_governor *gov, struct sim_policy *policy);
+	void (*sample)(struct sim_governor *gov, struct sim_policy *policy,
+		       const struct sim_load *load);
+	/* set a tunable, returns 0 on success */
+	int (*tune)(struct sim_governor *gov, const char *name,
+		    const char *value);
+	void *data;
+};
+
+int sim_freq_index(const struct sim_policy *policy, unsigned int target,
+		   int relation);
+void sim_driver_target(struct sim_policy *policy, unsigned int target,
+		       int relation);
+
+/* governor models ported from drivers/cpufreq */
+extern struct sim_governor sim_gov_performance;
+extern struct sim_governor sim_gov_powersave;
+extern struct sim_governor sim_gov_interactive;
+
+/* governors built on drivers/cpufreq/cpufreq_governor.c, linked as is */
+int sim_core_governors(struct sim_governor **govs, int max);
+
+#endif /* _CPUFREQ_SIM_H */
@@ -0,0 +1,301 @@
+/*
+ * fimg2d-batch-test.c -- FIMG2D batch test
+ *
+ * Copyright (C) 2011 Samsung Electronics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Runs fimg2d_ctx.c without the hardware. A few fixed cases check that a
+ * batch is queued in order behind the regions already added or not at all,
+ * and the fence references. Then random batches of several contexts are
+ * drained the way fimg2d3x_bitblt() does, one region at a time and the
+ * next closed context when one is done: every region must be rendered once
+ * and in order, every fence signaled and nothing leaked.
+ *
+ *     fimg2d-batch-test [-n batches] [-s seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/sched.h>
+#include <asm/uaccess.h>
+
+#include "test.h"
+
+#include "fimg2d.h"
+
+#define NR_CTX		4
+
+int kmalloc_fail;
+int kmalloc_live;
+int uaccess_fail;
+
+static struct fimg2d_control info;
+
+static void init_ctx(struct fimg2d_context *ctx)
+{
+	memset(ctx, 0, sizeof(*ctx));
+	INIT_LIST_HEAD(&ctx->node);
+	INIT_LIST_HEAD(&ctx->reg_q);
+	init_waitqueue_head(&ctx->wq);
+	fimg2d_enqueue(&info, &ctx->node, &info.ctx_q);
+}
+
+/* region i of a batch is tagged with x1 = tag + i */
+static void fill(struct fimg2d_batch_region *r, int count, int tag)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		r[i].src.x1 = tag + i;
+		r[i].src.x2 = tag + i + 1;
+		r[i].dst.x1 = tag + i;
+		r[i].dst.y2 = 1;
+	}
+}
+
+static int queued(struct fimg2d_context *ctx)
+{
+	struct fimg2d_region *reg;
+	int n = 0;
+
+	list_for_each_entry(reg, &ctx->reg_q, node)
+		n++;
+
+	return n;
+}
+
+static void drop_regions(struct fimg2d_context *ctx)
+{
+	struct fimg2d_region *reg;
+
+	while ((reg = fimg2d_get_first_region(ctx)) != NULL) {
+		fimg2d_dequeue(&info, &reg->node);
+		kfree(reg);
+	}
+}
+
+static void test_fixed(void)
+{
+	struct fimg2d_batch_region r[FIMG2D_BATCH_MAX + 1];
+	struct fimg2d_rect src = { 100, 0, 101, 1 }, dst = { 100, 0, 101, 1 };
+	struct fimg2d_user_region u = { &src, &dst };
+	struct fimg2d_user_batch b = { 0, r, 0, -1 };
+	struct fimg2d_context ctx;
+	struct fimg2d_region *reg;
+	struct fimg2d_fence *fence;
+	int live = kmalloc_live;
+	int i;
+
+	init_ctx(&ctx);
+
+	/* behind a region added one by one, in order */
+	check(fimg2d_add_region(&info, &ctx, &u) == 0, "add region");
+	fill(r, 8, 0);
+	b.count = 8;
+	check(fimg2d_add_batch(&info, &ctx, &b) == 0, "add batch");
+	check(queued(&ctx) == 9, "%d queued", queued(&ctx));
+	i = -1;
+	list_for_each_entry(reg, &ctx.reg_q, node) {
+		int want = i < 0 ? 100 : i;
+
+		check(reg->src.x1 == want && reg->dst.x1 == want,
+		      "region %d is %d", i, reg->src.x1);
+		i++;
+	}
+
+	/* none of a batch that does not fit or fails half way */
+	b.count = 0;
+	check(fimg2d_add_batch(&info, &ctx, &b) == -EINVAL, "empty batch");
+	b.count = -1;
+	check(fimg2d_add_batch(&info, &ctx, &b) == -EINVAL, "negative batch");
+	b.count = FIMG2D_BATCH_MAX + 1;
+	check(fimg2d_add_batch(&info, &ctx, &b) == -EINVAL, "batch too large");
+	b.count = FIMG2D_BATCH_MAX;
+	fill(r, FIMG2D_BATCH_MAX, 0);
+	uaccess_fail = 7;	/* source of the 4th region */
+	check(fimg2d_add_batch(&info, &ctx, &b) == -EFAULT, "copy fails");
+	check(queued(&ctx) == 9 && kmalloc_live == live + 9,
+	      "failed batch left %d queued, %d live", queued(&ctx),
+	      kmalloc_live - live);
+	kmalloc_fail = 5;	/* header of the 5th region */
+	check(fimg2d_add_batch(&info, &ctx, &b) == -ENOMEM, "alloc fails");
+	check(queued(&ctx) == 9 && kmalloc_live == live + 9,
+	      "failed batch left %d queued, %d live", queued(&ctx),
+	      kmalloc_live - live);
+
+	/* not while closed */
+	b.count = 1;
+	atomic_set(&ctx.closed, 1);
+	check(fimg2d_add_batch(&info, &ctx, &b) == -EFAULT, "closed");
+	atomic_set(&ctx.closed, 0);
+
+	b.count = FIMG2D_BATCH_MAX;
+	check(fimg2d_add_batch(&info, &ctx, &b) == 0, "full batch");
+	check(queued(&ctx) == 9 + FIMG2D_BATCH_MAX, "%d queued",
+	      queued(&ctx));
+	drop_regions(&ctx);
+
+	/* the context lets go of the fence once done, the fd when closed */
+	fence = fimg2d_create_fence();
+	check(fence != NULL && atomic_read(&fence->ref) == 1, "fence");
+	fimg2d_attach_fence(&info, &ctx, fence);
+	check(atomic_read(&fence->ref) == 2 && ctx.fence == fence, "attached");
+	check(info.lock.locked == 0, "lock left held");
+	fimg2d_signal_fence(&ctx);
+	check(fence->signaled && fence->wq.wakeups == 1 &&
+	      atomic_read(&fence->ref) == 1 && ctx.fence == NULL, "signaled");
+	fimg2d_signal_fence(&ctx);
+	check(fence->wq.wakeups == 1, "signaled twice");
+	fimg2d_put_fence(fence);
+
+	/* or the other way round, fd closed before done */
+	fence = fimg2d_create_fence();
+	fimg2d_attach_fence(&info, &ctx, fence);
+	fimg2d_put_fence(fence);
+	fimg2d_signal_fence(&ctx);
+
+	check(kmalloc_live == live, "%d leaked", kmalloc_live - live);
+	fimg2d_dequeue(&info, &ctx.node);
+}
+
+struct sim_ctx {
+	struct fimg2d_context ctx;
+	int next_tag;		/* tag of the next region to queue */
+	int rendered;		/* tag of the next region to render */
+	struct fimg2d_fence *fence;
+};
+
+/* one region of the active context, as fimg2d3x_bitblt() does */
+static struct fimg2d_context *render(struct fimg2d_context *ctx,
+				     struct sim_ctx *s)
+{
+	struct sim_ctx *sc = container_of(ctx, struct sim_ctx, ctx);
+	struct fimg2d_region *reg;
+
+	reg = fimg2d_get_first_region(ctx);
+	if (reg) {
+		check(reg->dst.x1 == sc->rendered, "context %ld rendered %d, "
+		      "not %d", (long)(sc - s), reg->dst.x1, sc->rendered);
+		sc->rendered++;
+		fimg2d_dequeue(&info, &reg->node);
+		kfree(reg);
+	}
+
+	if (!fimg2d_queue_is_empty(&ctx->reg_q))
+		return ctx;
+
+	spin_lock(&info.lock);
+	atomic_set(&ctx->closed, 0);
+	info.active = NULL;
+	wake_up(&ctx->wq);
+	fimg2d_signal_fence(ctx);
+
+	ctx = fimg2d_find_context(&info, (void *)1, fimg2d_match_closed);
+	info.active = ctx;
+	spin_unlock(&info.lock);
+
+	return ctx;
+}
+
+static void test_random(unsigned long batches)
+{
+	struct fimg2d_batch_region r[FIMG2D_BATCH_MAX];
+	struct fimg2d_user_batch b = { 0, r, FIMG2D_BATCH_ASYNC, -1 };
+	struct sim_ctx s[NR_CTX];
+	struct fimg2d_context *active = NULL;
+	struct timespec t0, t1;
+	unsigned long i, regions = 0, fences = 0;
+	double ns = 0;
+	int live = kmalloc_live;
+	int k, n;
+
+	for (k = 0; k < NR_CTX; k++) {
+		init_ctx(&s[k].ctx);
+		s[k].next_tag = 0;
+		s[k].rendered = 0;
+		s[k].fence = NULL;
+	}
+
+	for (i = 0; i < batches; i++) {
+		/* the engine gets through a few regions in the meantime */
+		for (n = rand() % 16; active && n; n--)
+			active = render(active, s);
+
+		k = rand() % NR_CTX;
+		if (atomic_read(&s[k].ctx.closed)) {
+			/* fimg2d_wait_closed() */
+			while (atomic_read(&s[k].ctx.closed))
+				active = render(active, s);
+		}
+		if (s[k].fence) {
+			check(s[k].fence->signaled, "context %d: fence not "
+			      "signaled after done", k);
+			fimg2d_put_fence(s[k].fence);
+			fences++;
+		}
+
+		b.count = 1 + rand() % (rand() % 4 ? 24 : FIMG2D_BATCH_MAX);
+		fill(r, b.count, s[k].next_tag);
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		check(fimg2d_add_batch(&info, &s[k].ctx, &b) == 0,
+		      "context %d: batch of %d", k, b.count);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		ns += (t1.tv_sec - t0.tv_sec) * 1e9 +
+		      (t1.tv_nsec - t0.tv_nsec);
+		s[k].next_tag += b.count;
+		regions += b.count;
+
+		s[k].fence = fimg2d_create_fence();
+		fimg2d_attach_fence(&info, &s[k].ctx, s[k].fence);
+		fimg2d_close_bitblt(&info, &s[k].ctx);
+
+		/* fimg2d_dispatch() */
+		if (!active) {
+			active = &s[k].ctx;
+			info.active = active;
+		}
+	}
+
+	while (active)
+		active = render(active, s);
+
+	for (k = 0; k < NR_CTX; k++) {
+		check(s[k].rendered == s[k].next_tag,
+		      "context %d: %d of %d regions rendered", k,
+		      s[k].rendered, s[k].next_tag);
+		check(!atomic_read(&s[k].ctx.closed), "context %d closed", k);
+		if (s[k].fence) {
+			check(s[k].fence->signaled, "context %d: fence", k);
+			fimg2d_put_fence(s[k].fence);
+			fences++;
+		}
+		fimg2d_dequeue(&info, &s[k].ctx.node);
+	}
+	check(kmalloc_live == live, "%d leaked", kmalloc_live - live);
+	check(info.lock.locked == 0, "lock left held");
+
+	printf("%lu batches, %lu regions, %lu fences, %.0f ns per region "
+	       "queued\n", batches, regions, fences, ns / regions);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long batches = 100000;
+
+	test_start(argc, argv, "batches", &batches, NULL);
+
+	INIT_LIST_HEAD(&info.ctx_q);
+
+	test_fixed();
+	test_random(batches);
+
+	return test_done();
+}
@@ -0,0 +1,530 @@
+/*
+ * fimg2d-sw-bench.c -- FIMG2D software fallback test and benchmark
+ *
+ * Copyright (C) 2011 Samsung Electronics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * A few fixed cases check fimg2d_sw.c against pixels worked out by hand,
+ * then random requests of every operation, format and rotation, with
+ * rectangles of odd sizes anywhere in images with padded strides, are
+ * rendered by the scalar and the vector path: both must give the same
+ * image and leave everything outside the destination rectangle alone.
+ *
+ * Then every operation is timed at a few sizes with the scalar and the
+ * vector path, and with the engine through /dev/fimg2d where there is
+ * one. The buffers are plain malloc()ed memory, so the engine only takes
+ * them with CONFIG_S5P_SYSMMU_FIMG2D. Its times include the ioctls, the
+ * interrupt and flushing the caches, which is what a caller pays. The
+ * largest size the CPU is still faster at is printed as a
+ * fimg2d_sw_threshold.
+ *
+ *     fimg2d-sw-bench [-c] [-n requests] [-s seed]
+ *
+ * -c only runs the checks, e.g. under qemu-arm where the times mean
+ * nothing.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "test.h"
+
+#include "fimg2d_sw.h"
+
+struct image {
+	struct fimg2d_param p;
+	unsigned char *buf;
+	size_t size;
+};
+
+static int bpp(FIMG2D_RGB_FORMAT_T fmt)
+{
+	return fmt == RGB565 ? 2 : 4;
+}
+
+static const char *fmt_name(FIMG2D_RGB_FORMAT_T fmt)
+{
+	return fmt == RGB565 ? "565" : (fmt == ARGB8888 ? "argb" : "xrgb");
+}
+
+static void image_alloc(struct image *im, FIMG2D_RGB_FORMAT_T fmt,
+			int width, int height, int pad)
+{
+	memset(im, 0, sizeof(*im));
+	im->p.type = NORMAL;
+	im->p.addr_type = FIMG2D_ADDR_USER;
+	im->p.width = width;
+	im->p.height = height;
+	im->p.stride = (width + pad) * bpp(fmt);
+	im->p.order = AX_RGB;
+	im->p.fmt = fmt;
+
+	im->size = im->p.stride * height;
+	im->buf = malloc(im->size);
+	if (im->buf == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+	im->p.addr = (unsigned long)im->buf;
+}
+
+static void image_random(struct image *im)
+{
+	size_t i;
+
+	for (i = 0; i < im->size; i++)
+		im->buf[i] = rand();
+}
+
+static void image_free(struct image *im)
+{
+	free(im->buf);
+}
+
+static uint32_t get32(struct image *im, int x, int y)
+{
+	return *(uint32_t *)(im->buf + y * im->p.stride + x * 4);
+}
+
+static uint16_t get16(struct image *im, int x, int y)
+{
+	return *(uint16_t *)(im->buf + y * im->p.stride + x * 2);
+}
+
+static void put32(struct image *im, int x, int y, uint32_t v)
+{
+	*(uint32_t *)(im->buf + y * im->p.stride + x * 4) = v;
+}
+
+static void put16(struct image *im, int x, int y, uint16_t v)
+{
+	*(uint16_t *)(im->buf + y * im->p.stride + x * 2) = v;
+}
+
+/* one pixel of src onto one of dst, both paths */
+static void blit1(struct fimg2d_user_context *c, struct image *dst)
+{
+	struct fimg2d_rect r = { 0, 0, 1, 1 };
+	unsigned char save[4];
+	int path;
+
+	memcpy(save, dst->buf, 4);
+	for (path = FIMG2D_SW_SCALAR; path <= FIMG2D_SW_VECTOR; path++) {
+		memcpy(dst->buf, save, 4);
+		check(fimg2d_sw_bitblt(c, &r, &r, path) == 0, "blit");
+	}
+}
+
+static void test_fixed(void)
+{
+	struct image a, b, c, d, e;
+	struct fimg2d_user_context ctx;
+	struct fimg2d_rect r = { 0, 0, 1, 1 }, r2;
+	int x, y, path;
+
+	image_alloc(&a, ARGB8888, 24, 24, 0);
+	image_alloc(&b, ARGB8888, 24, 24, 3);
+	image_alloc(&c, RGB565, 24, 24, 1);
+	image_alloc(&d, RGB565, 24, 24, 0);
+	image_alloc(&e, ARGB8888, 24, 24, 0);
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.src = &a.p;
+	ctx.dst = &b.p;
+
+	/* premultiplied, half over white */
+	ctx.op = OP_OVER;
+	put32(&a, 0, 0, 0x80404040);
+	put32(&b, 0, 0, 0xffffffff);
+	blit1(&ctx, &b);
+	check(get32(&b, 0, 0) == 0xffbfbfbf, "over: %08x", get32(&b, 0, 0));
+
+	/* not premultiplied, over black */
+	ctx.alpha.nonpre_type = PERPIXEL;
+	put32(&a, 0, 0, 0x80ffffff);
+	put32(&b, 0, 0, 0xff000000);
+	blit1(&ctx, &b);
+	check(get32(&b, 0, 0) == 0xff808080, "perpixel: %08x", get32(&b, 0, 0));
+
+	/* constant alpha, the source's does not count */
+	ctx.alpha.nonpre_type = CONSTANT;
+	ctx.alpha.enabled = 1;
+	ctx.alpha.value = 0x33;
+	put32(&a, 0, 0, 0x00ff0000);
+	put32(&b, 0, 0, 0xff0000ff);
+	blit1(&ctx, &b);
+	check(get32(&b, 0, 0) == 0xff3300cc, "constant: %08x", get32(&b, 0, 0));
+	memset(&ctx.alpha, 0, sizeof(ctx.alpha));
+
+	/* conversions */
+	ctx.op = OP_SRC_COPY;
+	ctx.src = &d.p;
+	put16(&d, 0, 0, 0xf81f);
+	blit1(&ctx, &b);
+	check(get32(&b, 0, 0) == 0xffff00ff, "565 to 8888: %08x",
+	      get32(&b, 0, 0));
+	ctx.src = &a.p;
+	ctx.dst = &c.p;
+	put32(&a, 0, 0, 0x0012fe07);
+	blit1(&ctx, &c);
+	check(get16(&c, 0, 0) == 0x17e0, "8888 to 565: %04x", get16(&c, 0, 0));
+
+	/* a b c   rotated by 90   d a
+	 * d e f                   e b
+	 *                         f c */
+	for (y = 0; y < 2; y++)
+		for (x = 0; x < 3; x++)
+			put32(&a, x, y, 'a' + y * 3 + x);
+	ctx.dst = &b.p;
+	r = (struct fimg2d_rect){ 0, 0, 3, 2 };
+	r2 = (struct fimg2d_rect){ 1, 1, 3, 4 };
+	for (path = FIMG2D_SW_SCALAR; path <= FIMG2D_SW_VECTOR; path++) {
+		static const char rot90[] = "daebfc", rot270[] = "cfbead";
+
+		ctx.rot = ROT90;
+		check(fimg2d_sw_bitblt(&ctx, &r, &r2, path) == 0, "rot90");
+		for (y = 0; y < 3; y++)
+			for (x = 0; x < 2; x++)
+				check(get32(&b, 1 + x, 1 + y) ==
+				      rot90[y * 2 + x], "rot90 %d, %d", x, y);
+
+		ctx.rot = ROT270;
+		check(fimg2d_sw_bitblt(&ctx, &r, &r2, path) == 0, "rot270");
+		for (y = 0; y < 3; y++)
+			for (x = 0; x < 2; x++)
+				check(get32(&b, 1 + x, 1 + y) ==
+				      rot270[y * 2 + x], "rot270 %d, %d", x, y);
+	}
+	ctx.rot = ROT180;
+	r2 = (struct fimg2d_rect){ 0, 0, 3, 2 };
+	check(fimg2d_sw_bitblt(&ctx, &r, &r2, FIMG2D_SW_VECTOR) == 0, "rot180");
+	check(get32(&b, 0, 0) == 'f' && get32(&b, 2, 1) == 'a', "rot180");
+
+	/* what the CPU leaves to the engine */
+	r2 = (struct fimg2d_rect){ 0, 0, 2, 3 };
+	check(fimg2d_sw_bitblt(&ctx, &r, &r2, FIMG2D_SW_AUTO) == -EINVAL,
+	      "rot180 of another size");
+	ctx.rot = XFLIP;
+	check(!fimg2d_sw_supported(&ctx, &r, &r), "flip");
+	ctx.rot = ORIGIN;
+	ctx.scale = 1;
+	check(!fimg2d_sw_supported(&ctx, &r, &r), "scale");
+	ctx.scale = 0;
+	ctx.op = OP_XOR;
+	check(!fimg2d_sw_supported(&ctx, &r, &r), "xor");
+	ctx.op = OP_OVER;
+	ctx.rot = ROT90;
+	check(!fimg2d_sw_supported(&ctx, &r, &r2), "rotated blend");
+	ctx.rot = ORIGIN;
+	r2 = (struct fimg2d_rect){ 20, 20, 25, 22 };
+	check(!fimg2d_sw_supported(&ctx, &r2, &r2), "out of the image");
+	b.p.addr_type = FIMG2D_ADDR_PHYS;
+	check(!fimg2d_sw_supported(&ctx, &r, &r), "physical address");
+	b.p.addr_type = FIMG2D_ADDR_USER;
+	check(fimg2d_sw_supported(&ctx, &r, &r), "blend");
+
+	/* small ones are the CPU's */
+	r2 = (struct fimg2d_rect){ 0, 0, 24, 24 };
+	fimg2d_sw_threshold = 24 * 24;
+	check(fimg2d_sw_preferred(&ctx, &r2, &r2), "at the threshold");
+	fimg2d_sw_threshold = 24 * 24 - 1;
+	check(!fimg2d_sw_preferred(&ctx, &r2, &r2), "over the threshold");
+	fimg2d_sw_threshold = FIMG2D_SW_THRESHOLD;
+
+	/* scrolling right and down within one image */
+	image_random(&a);
+	memcpy(e.buf, a.buf, e.size);
+	ctx.op = OP_SRC_COPY;
+	ctx.src = &a.p;
+	ctx.dst = &a.p;
+	r = (struct fimg2d_rect){ 0, 0, 20, 22 };
+	r2 = (struct fimg2d_rect){ 3, 1, 23, 23 };
+	check(fimg2d_sw_bitblt(&ctx, &r, &r2, FIMG2D_SW_VECTOR) == 0, "scroll");
+	for (y = 0; y < 22; y++)
+		for (x = 0; x < 20; x++)
+			check(get32(&a, x + 3, y + 1) == get32(&e, x, y),
+			      "scroll %d, %d", x, y);
+
+	image_free(&a);
+	image_free(&b);
+	image_free(&c);
+	image_free(&d);
+	image_free(&e);
+}
+
+static const FIMG2D_RGB_FORMAT_T fmts[] = { RGB565, XRGB8888, ARGB8888 };
+
+#define NR_FMTS		(sizeof(fmts) / sizeof(fmts[0]))
+
+/* everything of dst but the rectangle as in orig */
+static int outside_unchanged(struct image *dst, struct image *orig,
+			     struct fimg2d_rect *r)
+{
+	int b = bpp(dst->p.fmt), y;
+
+	for (y = 0; y < dst->p.height; y++) {
+		unsigned char *p = dst->buf + y * dst->p.stride;
+		unsigned char *q = orig->buf + y * dst->p.stride;
+
+		if (y < r->y1 || y >= r->y2) {
+			if (memcmp(p, q, dst->p.stride))
+				return 0;
+			continue;
+		}
+		if (memcmp(p, q, r->x1 * b) ||
+		    memcmp(p + r->x2 * b, q + r->x2 * b,
+			   dst->p.stride - r->x2 * b))
+			return 0;
+	}
+
+	return 1;
+}
+
+static void test_random(unsigned long n)
+{
+	static const FIMG2D_ROTATION_T rots[] = { ORIGIN, ROT90, ROT180, ROT270 };
+	static const FIMG2D_BITBLT_T ops[] = { OP_SOLID_FILL, OP_SRC_COPY, OP_OVER };
+	struct fimg2d_user_context c;
+	struct fimg2d_rect sr, dr;
+	struct image src, dst, vdst, orig;
+	unsigned long i;
+	int w, h, dw, dh, pad;
+
+	for (i = 0; i < n; i++) {
+		memset(&c, 0, sizeof(c));
+		c.op = ops[rand() % 3];
+		c.rot = c.op == OP_SRC_COPY ? rots[rand() % 4] : ORIGIN;
+		c.color = ((unsigned long)rand() << 16) ^ rand();
+		c.alpha.enabled = rand() % 2;
+		c.alpha.value = rand() % 3 ? rand() & 0xff : 0xff;
+		c.alpha.nonpre_type = rand() % 3;
+
+		w = 1 + rand() % 70;
+		h = 1 + rand() % 40;
+		dw = w;
+		dh = h;
+		if (c.rot == ROT90 || c.rot == ROT270) {
+			dw = h;
+			dh = w;
+		}
+
+		image_alloc(&src, fmts[rand() % NR_FMTS], w + rand() % 9,
+			    h + rand() % 9, rand() % 4);
+		pad = rand() % 4;
+		image_alloc(&dst, fmts[rand() % NR_FMTS], dw + rand() % 9,
+			    dh + rand() % 9, pad);
+		image_alloc(&vdst, dst.p.fmt, dst.p.width, dst.p.height, pad);
+		image_alloc(&orig, dst.p.fmt, dst.p.width, dst.p.height, pad);
+		image_random(&src);
+		image_random(&orig);
+		memcpy(dst.buf, orig.buf, dst.size);
+		memcpy(vdst.buf, orig.buf, dst.size);
+
+		sr.x1 = rand() % (src.p.width - w + 1);
+		sr.y1 = rand() % (src.p.height - h + 1);
+		sr.x2 = sr.x1 + w;
+		sr.y2 = sr.y1 + h;
+		dr.x1 = rand() % (dst.p.width - dw + 1);
+		dr.y1 = rand() % (dst.p.height - dh + 1);
+		dr.x2 = dr.x1 + dw;
+		dr.y2 = dr.y1 + dh;
+
+		c.src = &src.p;
+		c.dst = &dst.p;
+		check(fimg2d_sw_bitblt(&c, &sr, &dr, FIMG2D_SW_SCALAR) == 0,
+		      "request %lu: scalar", i);
+		c.dst = &vdst.p;
+		check(fimg2d_sw_bitblt(&c, &sr, &dr, FIMG2D_SW_VECTOR) == 0,
+		      "request %lu: vector", i);
+
+		check(memcmp(dst.buf, vdst.buf, dst.size) == 0,
+		      "request %lu: op %d rot %d %s %dx%d to %s: scalar and "
+		      "vector differ", i, c.op, c.rot, fmt_name(src.p.fmt),
+		      w, h, fmt_name(dst.p.fmt));
+		check(outside_unchanged(&dst, &orig, &dr),
+		      "request %lu: op %d rot %d %s %dx%d to %s: wrote outside "
+		      "the rectangle", i, c.op, c.rot, fmt_name(src.p.fmt),
+		      w, h, fmt_name(dst.p.fmt));
+
+		image_free(&src);
+		image_free(&dst);
+		image_free(&vdst);
+		image_free(&orig);
+	}
+
+	printf("%lu random requests\n", n);
+}
+
+static int hw_bitblt(int fd, struct fimg2d_user_context *c,
+		     struct fimg2d_rect *src, struct fimg2d_rect *dst)
+{
+	struct fimg2d_user_region r = { src, dst };
+
+	if (ioctl(fd, FIMG2D_DMA_CACHE_FLUSH_ALL) < 0 ||
+	    ioctl(fd, FIMG2D_BITBLT_CONFIG, c) < 0 ||
+	    ioctl(fd, FIMG2D_BITBLT_UPDATE, &r) < 0 ||
+	    ioctl(fd, FIMG2D_BITBLT_CLOSE) < 0)
+		return -errno;
+
+	return 0;
+}
+
+/* us per blit, path -1 for the engine, a negative errno if it failed */
+static double bench_one(int fd, int path, struct fimg2d_user_context *c,
+			struct fimg2d_rect *sr, struct fimg2d_rect *dr)
+{
+	struct timespec t0, t1;
+	double us;
+	long n = 0;
+	int ret;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	do {
+		if (path < 0)
+			ret = hw_bitblt(fd, c, sr, dr);
+		else
+			ret = fimg2d_sw_bitblt(c, sr, dr, path);
+		if (ret)
+			return ret;
+		n++;
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		us = (t1.tv_sec - t0.tv_sec) * 1e6 +
+		     (t1.tv_nsec - t0.tv_nsec) / 1e3;
+	} while (us < 20000);
+
+	return us / n;
+}
+
+static const struct {
+	const char *name;
+	FIMG2D_BITBLT_T op;
+	FIMG2D_ROTATION_T rot;
+	FIMG2D_RGB_FORMAT_T src;
+	FIMG2D_RGB_FORMAT_T dst;
+} benches[] = {
+	{ "fill 565",		OP_SOLID_FILL,	ORIGIN,	RGB565,	  RGB565 },
+	{ "fill 8888",		OP_SOLID_FILL,	ORIGIN,	ARGB8888, ARGB8888 },
+	{ "copy 8888",		OP_SRC_COPY,	ORIGIN,	ARGB8888, ARGB8888 },
+	{ "copy 565 to 8888",	OP_SRC_COPY,	ORIGIN,	RGB565,	  ARGB8888 },
+	{ "copy 8888 to 565",	OP_SRC_COPY,	ORIGIN,	ARGB8888, RGB565 },
+	{ "blend 8888",		OP_OVER,	ORIGIN,	ARGB8888, ARGB8888 },
+	{ "blend 8888 on 565",	OP_OVER,	ORIGIN,	ARGB8888, RGB565 },
+	{ "rotate 90 565",	OP_SRC_COPY,	ROT90,	RGB565,	  RGB565 },
+	{ "rotate 90 8888",	OP_SRC_COPY,	ROT90,	ARGB8888, ARGB8888 },
+	{ "rotate 180 8888",	OP_SRC_COPY,	ROT180,	ARGB8888, ARGB8888 },
+	{ "rotate 270 8888",	OP_SRC_COPY,	ROT270,	ARGB8888, ARGB8888 },
+};
+
+static const int sizes[][2] = {
+	{ 16, 16 }, { 64, 64 }, { 128, 128 }, { 256, 256 }, { 480, 800 },
+};
+
+#define NR_BENCHES	(sizeof(benches) / sizeof(benches[0]))
+#define NR_SIZES	(sizeof(sizes) / sizeof(sizes[0]))
+
+static void bench(void)
+{
+	struct fimg2d_user_context c;
+	struct fimg2d_rect sr, dr;
+	struct image src, dst;
+	unsigned int i, k, threshold = 0;
+	double scalar, vector, hw;
+	int fd, w, h;
+
+	fd = open("/dev/fimg2d", O_RDWR);
+	if (fd < 0)
+		printf("/dev/fimg2d: %s, no hardware times\n", strerror(errno));
+
+	printf("%-18s %9s %10s %10s %10s %8s\n", "", "size", "scalar us",
+	       "vector us", "engine us", "speedup");
+
+	for (i = 0; i < NR_BENCHES; i++) {
+		for (k = 0; k < NR_SIZES; k++) {
+			w = sizes[k][0];
+			h = sizes[k][1];
+
+			memset(&c, 0, sizeof(c));
+			c.op = benches[i].op;
+			c.rot = benches[i].rot;
+			c.color = 0x12345678;
+			c.alpha.enabled = 1;
+			c.alpha.value = 0xff;
+
+			image_alloc(&src, benches[i].src, w, h, 0);
+			if (c.rot == ROT90 || c.rot == ROT270)
+				image_alloc(&dst, benches[i].dst, h, w, 0);
+			else
+				image_alloc(&dst, benches[i].dst, w, h, 0);
+			image_random(&src);
+			image_random(&dst);
+			c.src = &src.p;
+			c.dst = &dst.p;
+			sr = (struct fimg2d_rect){ 0, 0, w, h };
+			dr = (struct fimg2d_rect){ 0, 0, dst.p.width,
+						   dst.p.height };
+
+			scalar = bench_one(fd, FIMG2D_SW_SCALAR, &c, &sr, &dr);
+			vector = bench_one(fd, FIMG2D_SW_VECTOR, &c, &sr, &dr);
+			hw = -ENODEV;
+			if (fd >= 0) {
+				hw = bench_one(fd, -1, &c, &sr, &dr);
+				if (hw < 0) {
+					printf("engine: %s, no hardware times\n",
+					       strerror(-hw));
+					close(fd);
+					fd = -1;
+				}
+			}
+
+			printf("%-18s %4dx%-4d %10.1f %10.1f ", k ? "" :
+			       benches[i].name, w, h, scalar, vector);
+			if (hw >= 0)
+				printf("%10.1f", hw);
+			else
+				printf("%10s", "-");
+			printf(" %7.1fx\n", scalar / vector);
+
+			/* the largest size the CPU is still faster at */
+			if (hw >= 0 && vector < hw &&
+			    (unsigned int)(w * h) > threshold)
+				threshold = w * h;
+
+			image_free(&src);
+			image_free(&dst);
+		}
+	}
+
+	if (fd >= 0) {
+		printf("fimg2d_sw_threshold %u\n", threshold);
+		close(fd);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long n = 20000;
+	int checks_only = 0;
+
+	test_start(argc, argv, "requests", &n, &checks_only);
+
+	test_fixed();
+	test_random(n);
+
+	if (test_done())
+		return 1;
+
+	if (!checks_only)
+		bench();
+
+	return 0;
+}
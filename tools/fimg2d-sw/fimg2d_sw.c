@@ -0,0 +1,820 @@
+/*
+ * fimg2d_sw.c -- FIMG2D software fallback
+ *
+ * Copyright (C) 2011 Samsung Electronics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Renders the requests the FIMG2D driver takes, described by the same
+ * fimg2d_user_context, on the CPU: for when the engine is busy or powered
+ * down, the buffers are not mappable by its SYSMMU, or the blit is too
+ * small to be worth an ioctl and an interrupt. Solid fill, copy with
+ * RGB565 / (A|X)RGB8888 conversion, rotation by 90, 180 and 270 degrees
+ * (clockwise, as ROT90 on the engine) and alpha blending over (OP_OVER)
+ * are handled, both with plain pixel loops and with 16 byte vectors.
+ *
+ * The vectors are gcc's generic ones, built with -mfpu=neon they become
+ * NEON, on a PC SSE2, so fimg2d-sw-bench checks the very same code on
+ * either. Both paths give the same pixels, bit for bit.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fimg2d_sw.h"
+
+/* 90 and 270 degree rotations walk the source in tiles of this many pixels */
+#define FIMG2D_SW_TILE		32
+
+typedef uint32_t v4u32 __attribute__((vector_size(16)));
+typedef uint16_t v8u16 __attribute__((vector_size(16)));
+typedef uint8_t v16u8 __attribute__((vector_size(16)));
+
+unsigned int fimg2d_sw_threshold = FIMG2D_SW_THRESHOLD;
+
+/* how a pixel changes on the way from source to destination */
+enum sw_conv {
+	CONV_RAW,		/* same size, as it is */
+	CONV_SET_ALPHA,		/* XRGB8888 to ARGB8888 */
+	CONV_TO_8888,		/* RGB565 to (A|X)RGB8888 */
+	CONV_TO_565,		/* (A|X)RGB8888 to RGB565 */
+};
+
+/* the rectangle of an image to read or write */
+struct sw_image {
+	unsigned char *addr;	/* first pixel of the rectangle */
+	int stride;
+	int width;
+	int height;
+	FIMG2D_RGB_FORMAT_T fmt;
+	int bpp;
+};
+
+static inline int sw_bpp(FIMG2D_RGB_FORMAT_T fmt)
+{
+	return fmt == RGB565 ? 2 : 4;
+}
+
+static inline unsigned char *sw_px(const struct sw_image *im, int x, int y)
+{
+	return im->addr + y * im->stride + x * im->bpp;
+}
+
+static enum sw_conv sw_conv(FIMG2D_RGB_FORMAT_T sfmt, FIMG2D_RGB_FORMAT_T dfmt)
+{
+	if (sfmt == RGB565)
+		return dfmt == RGB565 ? CONV_RAW : CONV_TO_8888;
+	if (dfmt == RGB565)
+		return CONV_TO_565;
+	if (sfmt == XRGB8888 && dfmt == ARGB8888)
+		return CONV_SET_ALPHA;
+
+	return CONV_RAW;
+}
+
+/*
+ * Scalar pixels
+ */
+
+/* x / 255 rounded, for x up to 255 * 255 */
+static inline unsigned int div255(unsigned int x)
+{
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+static inline uint32_t rgb565_to_8888(uint32_t p)
+{
+	uint32_t r = (p >> 11) & 0x1f;
+	uint32_t g = (p >> 5) & 0x3f;
+	uint32_t b = p & 0x1f;
+
+	return 0xff000000 | (r << 3 | r >> 2) << 16 | (g << 2 | g >> 4) << 8 |
+		(b << 3 | b >> 2);
+}
+
+static inline uint32_t rgb8888_to_565(uint32_t p)
+{
+	return ((p >> 8) & 0xf800) | ((p >> 5) & 0x07e0) | ((p >> 3) & 0x001f);
+}
+
+static inline uint32_t read_px(FIMG2D_RGB_FORMAT_T fmt, const unsigned char *p)
+{
+	if (fmt == RGB565)
+		return rgb565_to_8888(*(const uint16_t *)p);
+	if (fmt == XRGB8888)
+		return *(const uint32_t *)p | 0xff000000;
+
+	return *(const uint32_t *)p;
+}
+
+static inline void write_px(FIMG2D_RGB_FORMAT_T fmt, unsigned char *p,
+			    uint32_t v)
+{
+	if (fmt == RGB565)
+		*(uint16_t *)p = rgb8888_to_565(v);
+	else
+		*(uint32_t *)p = v;
+}
+
+static inline void copy_px(enum sw_conv conv, int bpp, unsigned char *d,
+			   const unsigned char *s)
+{
+	switch (conv) {
+	case CONV_RAW:
+		if (bpp == 2)
+			*(uint16_t *)d = *(const uint16_t *)s;
+		else
+			*(uint32_t *)d = *(const uint32_t *)s;
+		break;
+	case CONV_SET_ALPHA:
+		*(uint32_t *)d = *(const uint32_t *)s | 0xff000000;
+		break;
+	case CONV_TO_8888:
+		*(uint32_t *)d = rgb565_to_8888(*(const uint16_t *)s);
+		break;
+	case CONV_TO_565:
+		*(uint16_t *)d = rgb8888_to_565(*(const uint32_t *)s);
+		break;
+	}
+}
+
+/* every channel times f / 255 */
+static inline uint32_t mul_px(uint32_t p, unsigned int f)
+{
+	uint32_t out = 0;
+	int i;
+
+	for (i = 0; i < 32; i += 8)
+		out |= div255(((p >> i) & 0xff) * f) << i;
+
+	return out;
+}
+
+/*
+ * s over d, d and the result non-premultiplied opaque or premultiplied.
+ * A premultiplied source with a colour above its alpha wraps around in
+ * that channel.
+ */
+static inline uint32_t over_px(uint32_t s, uint32_t d, int mode,
+			       unsigned int g)
+{
+	unsigned int a = s >> 24, ia;
+	uint32_t out = 0;
+	int i;
+
+	if (mode == PERPIXEL)
+		s = (mul_px(s, a) & 0x00ffffff) | a << 24;
+	else if (mode == CONSTANT)
+		s |= 0xff000000;
+	if (g < 255)
+		s = mul_px(s, g);
+
+	ia = 255 - (s >> 24);
+	for (i = 0; i < 32; i += 8) {
+		unsigned int c = ((s >> i) & 0xff) +
+				 div255(((d >> i) & 0xff) * ia);
+
+		out |= (c & 0xff) << i;
+	}
+
+	return out;
+}
+
+/*
+ * Vectors, 4 pixels of 32 or 8 of 16 bits
+ */
+
+static inline v4u32 ld32(const void *p)
+{
+	v4u32 v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline void st32(void *p, v4u32 v)
+{
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline v8u16 ld16(const void *p)
+{
+	v8u16 v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline void st16(void *p, v8u16 v)
+{
+	memcpy(p, &v, sizeof(v));
+}
+
+/* RGB565 in the low half of each lane */
+static inline v4u32 rgb565_to_8888_v(v4u32 p)
+{
+	v4u32 r = (p >> 11) & 0x1f;
+	v4u32 g = (p >> 5) & 0x3f;
+	v4u32 b = p & 0x1f;
+
+	return 0xff000000 | (r << 3 | r >> 2) << 16 | (g << 2 | g >> 4) << 8 |
+		(b << 3 | b >> 2);
+}
+
+static inline v4u32 rgb8888_to_565_v(v4u32 p)
+{
+	return ((p >> 8) & 0xf800) | ((p >> 5) & 0x07e0) | ((p >> 3) & 0x001f);
+}
+
+/*
+ * Every channel times f / 255, f per lane. Red and blue, then alpha and
+ * green, are done two at a time in the halves of each lane, which is the
+ * same rounding as div255().
+ */
+static inline v4u32 mul_v(v4u32 p, v4u32 f)
+{
+	v4u32 rb = (p & 0x00ff00ff) * f + 0x00800080;
+	v4u32 ag = ((p >> 8) & 0x00ff00ff) * f + 0x00800080;
+
+	rb = ((rb + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+	ag = (ag + ((ag >> 8) & 0x00ff00ff)) & 0xff00ff00;
+
+	return rb | ag;
+}
+
+static inline v4u32 over_v(v4u32 s, v4u32 d, int mode, unsigned int g)
+{
+	v4u32 a = s >> 24;
+
+	if (mode == PERPIXEL)
+		s = (mul_v(s, a) & 0x00ffffff) | a << 24;
+	else if (mode == CONSTANT)
+		s |= 0xff000000;
+	if (g < 255)
+		s = mul_v(s, (v4u32){ g, g, g, g });
+
+	/* adding bytes keeps a wrapping channel out of the next one */
+	return (v4u32)((v16u8)s + (v16u8)mul_v(d, (s >> 24) ^ 255));
+}
+
+static const v4u32 even32 = { 0, 2, 4, 6 }, odd32 = { 1, 3, 5, 7 };
+static const v4u32 zip_lo32 = { 0, 4, 1, 5 }, zip_hi32 = { 2, 6, 3, 7 };
+
+/* r[k] becomes column k */
+static inline void transpose4(v4u32 r[4])
+{
+	v4u32 t0 = __builtin_shuffle(r[0], r[1], zip_lo32);
+	v4u32 t1 = __builtin_shuffle(r[0], r[1], zip_hi32);
+	v4u32 t2 = __builtin_shuffle(r[2], r[3], zip_lo32);
+	v4u32 t3 = __builtin_shuffle(r[2], r[3], zip_hi32);
+	const v4u32 lo = { 0, 1, 4, 5 }, hi = { 2, 3, 6, 7 };
+
+	r[0] = __builtin_shuffle(t0, t2, lo);
+	r[1] = __builtin_shuffle(t0, t2, hi);
+	r[2] = __builtin_shuffle(t1, t3, lo);
+	r[3] = __builtin_shuffle(t1, t3, hi);
+}
+
+static inline void transpose8(v8u16 r[8])
+{
+	const v8u16 lo16 = { 0, 8, 1, 9, 2, 10, 3, 11 };
+	const v8u16 hi16 = { 4, 12, 5, 13, 6, 14, 7, 15 };
+	const v8u16 lo32 = { 0, 1, 8, 9, 2, 3, 10, 11 };
+	const v8u16 hi32 = { 4, 5, 12, 13, 6, 7, 14, 15 };
+	const v8u16 lo64 = { 0, 1, 2, 3, 8, 9, 10, 11 };
+	const v8u16 hi64 = { 4, 5, 6, 7, 12, 13, 14, 15 };
+	v8u16 a[8], b[8];
+	int k;
+
+	for (k = 0; k < 8; k += 2) {
+		a[k] = __builtin_shuffle(r[k], r[k + 1], lo16);
+		a[k + 1] = __builtin_shuffle(r[k], r[k + 1], hi16);
+	}
+	for (k = 0; k < 8; k += 4) {
+		b[k] = __builtin_shuffle(a[k], a[k + 2], lo32);
+		b[k + 1] = __builtin_shuffle(a[k], a[k + 2], hi32);
+		b[k + 2] = __builtin_shuffle(a[k + 1], a[k + 3], lo32);
+		b[k + 3] = __builtin_shuffle(a[k + 1], a[k + 3], hi32);
+	}
+	for (k = 0; k < 4; k++) {
+		r[2 * k] = __builtin_shuffle(b[k], b[k + 4], lo64);
+		r[2 * k + 1] = __builtin_shuffle(b[k], b[k + 4], hi64);
+	}
+}
+
+/*
+ * Solid fill
+ */
+
+static void fill_row_scalar(unsigned char *d, int bpp, int n, uint32_t color)
+{
+	int i;
+
+	if (bpp == 2) {
+		for (i = 0; i < n; i++)
+			((uint16_t *)d)[i] = color;
+	} else {
+		for (i = 0; i < n; i++)
+			((uint32_t *)d)[i] = color;
+	}
+}
+
+static void fill_row_vector(unsigned char *d, int bpp, int n, uint32_t color)
+{
+	int bytes = n * bpp, i;
+	v4u32 c;
+
+	if (bpp == 2)
+		color = (color & 0xffff) * 0x10001;
+	c = (v4u32){ color, color, color, color };
+
+	for (i = 0; i + 32 <= bytes; i += 32) {
+		st32(d + i, c);
+		st32(d + i + 16, c);
+	}
+	if (i + 16 <= bytes) {
+		st32(d + i, c);
+		i += 16;
+	}
+	fill_row_scalar(d + i, bpp, (bytes - i) / bpp, color);
+}
+
+static void sw_fill(const struct sw_image *d, uint32_t color, int vec)
+{
+	int y;
+
+	for (y = 0; y < d->height; y++) {
+		if (vec)
+			fill_row_vector(sw_px(d, 0, y), d->bpp, d->width, color);
+		else
+			fill_row_scalar(sw_px(d, 0, y), d->bpp, d->width, color);
+	}
+}
+
+/*
+ * Copy
+ */
+
+static void copy_row_scalar(enum sw_conv conv, unsigned char *d, int dbpp,
+			    const unsigned char *s, int sbpp, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		copy_px(conv, sbpp, d + i * dbpp, s + i * sbpp);
+}
+
+static void copy_row_vector(enum sw_conv conv, unsigned char *d, int dbpp,
+			    const unsigned char *s, int sbpp, int n)
+{
+	int i = 0;
+
+	switch (conv) {
+	case CONV_RAW:
+		for (; (i + 32 / sbpp) <= n; i += 32 / sbpp) {
+			v4u32 v0 = ld32(s + i * sbpp);
+			v4u32 v1 = ld32(s + i * sbpp + 16);
+
+			st32(d + i * dbpp, v0);
+			st32(d + i * dbpp + 16, v1);
+		}
+		break;
+
+	case CONV_SET_ALPHA:
+		for (; i + 4 <= n; i += 4)
+			st32(d + i * 4, ld32(s + i * 4) | 0xff000000);
+		break;
+
+	case CONV_TO_8888:
+		for (; i + 8 <= n; i += 8) {
+			v4u32 w = ld32(s + i * 2);
+			v4u32 e = rgb565_to_8888_v(w & 0xffff);
+			v4u32 o = rgb565_to_8888_v(w >> 16);
+
+			st32(d + i * 4, __builtin_shuffle(e, o, zip_lo32));
+			st32(d + i * 4 + 16, __builtin_shuffle(e, o, zip_hi32));
+		}
+		break;
+
+	case CONV_TO_565:
+		for (; i + 8 <= n; i += 8) {
+			v4u32 v0 = ld32(s + i * 4);
+			v4u32 v1 = ld32(s + i * 4 + 16);
+			v4u32 e = __builtin_shuffle(v0, v1, even32);
+			v4u32 o = __builtin_shuffle(v0, v1, odd32);
+
+			st32(d + i * 2, rgb8888_to_565_v(e) |
+					rgb8888_to_565_v(o) << 16);
+		}
+		break;
+	}
+
+	copy_row_scalar(conv, d + i * dbpp, dbpp, s + i * sbpp, sbpp, n - i);
+}
+
+static void sw_copy(const struct sw_image *s, const struct sw_image *d,
+		    int vec)
+{
+	enum sw_conv conv = sw_conv(s->fmt, d->fmt);
+	unsigned char *s_end = sw_px(s, s->width, s->height - 1);
+	unsigned char *d_end = sw_px(d, d->width, d->height - 1);
+	int y, back;
+
+	/* the same image moved down or right, copied from the far end */
+	back = d->addr > s->addr && d->addr < s_end && s->addr < d_end;
+
+	for (y = 0; y < d->height; y++) {
+		int row = back ? d->height - 1 - y : y;
+		unsigned char *dp = sw_px(d, 0, row);
+		const unsigned char *sp = sw_px(s, 0, row);
+
+		if (back && conv == CONV_RAW)
+			memmove(dp, sp, d->width * d->bpp);
+		else if (vec)
+			copy_row_vector(conv, dp, d->bpp, sp, s->bpp, d->width);
+		else
+			copy_row_scalar(conv, dp, d->bpp, sp, s->bpp, d->width);
+	}
+}
+
+/*
+ * Rotation
+ */
+
+/* where the source pixel x, y goes */
+static inline void rot_map(FIMG2D_ROTATION_T rot, int w, int h, int x, int y,
+			   int *dx, int *dy)
+{
+	switch (rot) {
+	case ROT90:
+		*dx = h - 1 - y;
+		*dy = x;
+		break;
+	case ROT180:
+		*dx = w - 1 - x;
+		*dy = h - 1 - y;
+		break;
+	case ROT270:
+		*dx = y;
+		*dy = w - 1 - x;
+		break;
+	default:
+		*dx = x;
+		*dy = y;
+		break;
+	}
+}
+
+/* the source pixels x0 <= x < x1, y0 <= y < y1 */
+static void rotate_scalar(const struct sw_image *s, const struct sw_image *d,
+			  FIMG2D_ROTATION_T rot, int x0, int y0, int x1, int y1)
+{
+	enum sw_conv conv = sw_conv(s->fmt, d->fmt);
+	int x, y, dx, dy;
+
+	for (y = y0; y < y1; y++) {
+		for (x = x0; x < x1; x++) {
+			rot_map(rot, s->width, s->height, x, y, &dx, &dy);
+			copy_px(conv, s->bpp, sw_px(d, dx, dy), sw_px(s, x, y));
+		}
+	}
+}
+
+static void rotate180_vector(const struct sw_image *s,
+			     const struct sw_image *d)
+{
+	const v4u32 rev32 = { 3, 2, 1, 0 };
+	const v8u16 rev16 = { 7, 6, 5, 4, 3, 2, 1, 0 };
+	int w = s->width, n = 16 / s->bpp;
+	int x, y;
+
+	for (y = 0; y < s->height; y++) {
+		const unsigned char *sp = sw_px(s, 0, y);
+		unsigned char *dp = sw_px(d, 0, s->height - 1 - y);
+
+		for (x = 0; x + n <= w; x += n) {
+			if (n == 4)
+				st32(dp + (w - 4 - x) * 4,
+				     __builtin_shuffle(ld32(sp + x * 4), rev32));
+			else
+				st16(dp + (w - 8 - x) * 2,
+				     __builtin_shuffle(ld16(sp + x * 2), rev16));
+		}
+		rotate_scalar(s, d, ROT180, x, y, w, y + 1);
+	}
+}
+
+/* the n x n block at x, y of the source, n = 16 / bpp */
+static inline void rotate_block(const struct sw_image *s,
+				const struct sw_image *d,
+				FIMG2D_ROTATION_T rot, int x, int y)
+{
+	int n = 16 / s->bpp, k, dx, dy;
+	v4u32 r4[4];
+	v8u16 r8[8];
+
+	/*
+	 * Turned clockwise the columns are read bottom up, so the rows go
+	 * into the transpose the other way round.
+	 */
+	for (k = 0; k < n; k++) {
+		int row = rot == ROT90 ? n - 1 - k : k;
+
+		if (n == 4)
+			r4[k] = ld32(sw_px(s, x, y + row));
+		else
+			r8[k] = ld16(sw_px(s, x, y + row));
+	}
+
+	if (n == 4)
+		transpose4(r4);
+	else
+		transpose8(r8);
+
+	/* column k of the block is one row of the destination */
+	for (k = 0; k < n; k++) {
+		if (rot == ROT90)
+			rot_map(rot, s->width, s->height, x + k, y + n - 1,
+				&dx, &dy);
+		else
+			rot_map(rot, s->width, s->height, x + k, y, &dx, &dy);
+
+		if (n == 4)
+			st32(sw_px(d, dx, dy), r4[k]);
+		else
+			st16(sw_px(d, dx, dy), r8[k]);
+	}
+}
+
+static void rotate90_vector(const struct sw_image *s, const struct sw_image *d,
+			    FIMG2D_ROTATION_T rot)
+{
+	int n = 16 / s->bpp;
+	int w = s->width & ~(n - 1), h = s->height & ~(n - 1);
+	int tx, ty, x, y;
+
+	for (ty = 0; ty < h; ty += FIMG2D_SW_TILE) {
+		for (tx = 0; tx < w; tx += FIMG2D_SW_TILE) {
+			for (y = ty; y < ty + FIMG2D_SW_TILE && y < h; y += n)
+				for (x = tx; x < tx + FIMG2D_SW_TILE && x < w;
+				     x += n)
+					rotate_block(s, d, rot, x, y);
+		}
+	}
+
+	/* what is left of the edges */
+	rotate_scalar(s, d, rot, w, 0, s->width, s->height);
+	rotate_scalar(s, d, rot, 0, h, w, s->height);
+}
+
+static void sw_rotate(const struct sw_image *s, const struct sw_image *d,
+		      FIMG2D_ROTATION_T rot, int vec)
+{
+	/* the vectors only move pixels, a conversion goes pixel by pixel */
+	if (!vec || sw_conv(s->fmt, d->fmt) != CONV_RAW)
+		rotate_scalar(s, d, rot, 0, 0, s->width, s->height);
+	else if (rot == ROT180)
+		rotate180_vector(s, d);
+	else
+		rotate90_vector(s, d, rot);
+}
+
+/*
+ * Alpha blending
+ */
+
+static void blend_row_scalar(unsigned char *d, FIMG2D_RGB_FORMAT_T dfmt,
+			     const unsigned char *s, FIMG2D_RGB_FORMAT_T sfmt,
+			     int n, int mode, unsigned int g)
+{
+	int dbpp = sw_bpp(dfmt), sbpp = sw_bpp(sfmt), i;
+
+	for (i = 0; i < n; i++) {
+		unsigned char *dp = d + i * dbpp;
+
+		write_px(dfmt, dp, over_px(read_px(sfmt, s + i * sbpp),
+					   read_px(dfmt, dp), mode, g));
+	}
+}
+
+static void blend_row_vector(unsigned char *d, FIMG2D_RGB_FORMAT_T dfmt,
+			     const unsigned char *s, FIMG2D_RGB_FORMAT_T sfmt,
+			     int n, int mode, unsigned int g)
+{
+	uint32_t sx = sfmt == XRGB8888 ? 0xff000000 : 0;
+	uint32_t dx = dfmt == XRGB8888 ? 0xff000000 : 0;
+	int i = 0;
+
+	if (dfmt == RGB565) {
+		for (; i + 8 <= n; i += 8) {
+			v4u32 v0 = ld32(s + i * 4) | sx;
+			v4u32 v1 = ld32(s + i * 4 + 16) | sx;
+			v4u32 w = ld32(d + i * 2);
+			v4u32 e, o;
+
+			e = over_v(__builtin_shuffle(v0, v1, even32),
+				   rgb565_to_8888_v(w & 0xffff), mode, g);
+			o = over_v(__builtin_shuffle(v0, v1, odd32),
+				   rgb565_to_8888_v(w >> 16), mode, g);
+			st32(d + i * 2, rgb8888_to_565_v(e) |
+					rgb8888_to_565_v(o) << 16);
+		}
+	} else {
+		for (; i + 4 <= n; i += 4)
+			st32(d + i * 4, over_v(ld32(s + i * 4) | sx,
+					       ld32(d + i * 4) | dx, mode, g));
+	}
+
+	blend_row_scalar(d + i * sw_bpp(dfmt), dfmt, s + i * sw_bpp(sfmt),
+			 sfmt, n - i, mode, g);
+}
+
+static void sw_blend(const struct sw_image *s, const struct sw_image *d,
+		     const struct fimg2d_alpha *alpha, int vec)
+{
+	unsigned int g = alpha->enabled ? alpha->value & 0xff : 255;
+	int y;
+
+	/* an RGB565 source is rare enough to go pixel by pixel */
+	if (s->fmt == RGB565)
+		vec = 0;
+
+	for (y = 0; y < d->height; y++) {
+		if (vec)
+			blend_row_vector(sw_px(d, 0, y), d->fmt, sw_px(s, 0, y),
+					 s->fmt, d->width, alpha->nonpre_type, g);
+		else
+			blend_row_scalar(sw_px(d, 0, y), d->fmt, sw_px(s, 0, y),
+					 s->fmt, d->width, alpha->nonpre_type, g);
+	}
+}
+
+/*
+ * Requests
+ */
+
+static int sw_check_param(const struct fimg2d_param *p,
+			  const struct fimg2d_rect *r)
+{
+	if (!p || !r || !p->addr || p->addr_type != FIMG2D_ADDR_USER)
+		return -EINVAL;
+
+	if (p->fmt != XRGB8888 && p->fmt != ARGB8888 && p->fmt != RGB565)
+		return -EINVAL;
+	if (p->order != AX_RGB)
+		return -EINVAL;
+	if (p->stride < p->width * sw_bpp(p->fmt))
+		return -EINVAL;
+
+	if (r->x1 < 0 || r->y1 < 0 || r->x1 >= r->x2 || r->y1 >= r->y2 ||
+	    r->x2 > p->width || r->y2 > p->height)
+		return -EINVAL;
+
+	return 0;
+}
+
+static int sw_check(const struct fimg2d_user_context *c,
+		    const struct fimg2d_rect *src,
+		    const struct fimg2d_rect *dst)
+{
+	int sw, sh, dw, dh;
+
+	if (!c || sw_check_param(c->dst, dst))
+		return -EINVAL;
+
+	switch (c->op) {
+	case OP_SOLID_FILL:
+		return 0;
+
+	case OP_SRC_COPY:
+	case OP_SRC:
+		if (c->rot != ORIGIN && c->rot != ROT90 &&
+		    c->rot != ROT180 && c->rot != ROT270)
+			return -EINVAL;
+		break;
+
+	case OP_OVER:
+		if (c->rot != ORIGIN)
+			return -EINVAL;
+		break;
+
+	default:
+		return -EINVAL;
+	}
+
+	if (c->scale || sw_check_param(c->src, src))
+		return -EINVAL;
+
+	sw = src->x2 - src->x1;
+	sh = src->y2 - src->y1;
+	dw = dst->x2 - dst->x1;
+	dh = dst->y2 - dst->y1;
+
+	if (c->rot == ROT90 || c->rot == ROT270) {
+		if (sw != dh || sh != dw)
+			return -EINVAL;
+	} else if (sw != dw || sh != dh) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void sw_image(struct sw_image *im, const struct fimg2d_param *p,
+		     const struct fimg2d_rect *r)
+{
+	im->fmt = p->fmt;
+	im->bpp = sw_bpp(p->fmt);
+	im->stride = p->stride;
+	im->width = r->x2 - r->x1;
+	im->height = r->y2 - r->y1;
+	im->addr = (unsigned char *)p->addr + r->y1 * p->stride +
+		   r->x1 * im->bpp;
+}
+
+/**
+ * fimg2d_sw_supported - whether the CPU can render a request
+ * @c: the request, with the addresses as FIMG2D_ADDR_USER
+ * @src: source rectangle, unused for a solid fill
+ * @dst: destination rectangle
+ */
+int fimg2d_sw_supported(const struct fimg2d_user_context *c,
+			const struct fimg2d_rect *src,
+			const struct fimg2d_rect *dst)
+{
+	return sw_check(c, src, dst) == 0;
+}
+
+/**
+ * fimg2d_sw_preferred - whether the CPU should render a request
+ * @c: the request
+ * @src: source rectangle
+ * @dst: destination rectangle
+ *
+ * True for what the CPU can do up to fimg2d_sw_threshold pixels, below
+ * that the ioctl and the interrupt cost more than the pixels.
+ */
+int fimg2d_sw_preferred(const struct fimg2d_user_context *c,
+			const struct fimg2d_rect *src,
+			const struct fimg2d_rect *dst)
+{
+	if (!fimg2d_sw_supported(c, src, dst))
+		return 0;
+
+	return (unsigned int)(dst->x2 - dst->x1) * (dst->y2 - dst->y1) <=
+		fimg2d_sw_threshold;
+}
+
+/**
+ * fimg2d_sw_bitblt - render a request on the CPU
+ * @c: the request, with the addresses as FIMG2D_ADDR_USER
+ * @src: source rectangle, unused for a solid fill
+ * @dst: destination rectangle
+ * @path: FIMG2D_SW_AUTO, FIMG2D_SW_SCALAR or FIMG2D_SW_VECTOR
+ *
+ * Returns -EINVAL for what fimg2d_sw_supported() turns down. Source and
+ * destination may only overlap for a copy without rotation or conversion.
+ */
+int fimg2d_sw_bitblt(const struct fimg2d_user_context *c,
+		     const struct fimg2d_rect *src,
+		     const struct fimg2d_rect *dst, int path)
+{
+	struct sw_image s, d;
+	int ret, vec;
+
+	ret = sw_check(c, src, dst);
+	if (ret)
+		return ret;
+
+	sw_image(&d, c->dst, dst);
+	if (c->op != OP_SOLID_FILL)
+		sw_image(&s, c->src, src);
+
+	if (path == FIMG2D_SW_AUTO)
+		vec = d.width >= FIMG2D_SW_VEC_MIN;
+	else
+		vec = path == FIMG2D_SW_VECTOR;
+
+	switch (c->op) {
+	case OP_SOLID_FILL:
+		sw_fill(&d, c->color, vec);
+		break;
+
+	case OP_OVER:
+		sw_blend(&s, &d, &c->alpha, vec);
+		break;
+
+	default:
+		if (c->rot == ORIGIN)
+			sw_copy(&s, &d, vec);
+		else
+			sw_rotate(&s, &d, c->rot, vec);
+		break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,43 @@
+/*
+ * fimg2d_sw.h -- FIMG2D software fallback
+ *
+ * Copyright (C) 2011 Samsung Electronics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _FIMG2D_SW_H_
+#define _FIMG2D_SW_H_
+
+#include "fimg2d.h"
+
+/* how fimg2d_sw_bitblt() renders */
+#define FIMG2D_SW_AUTO		0	/* vector from FIMG2D_SW_VEC_MIN pixels */
+#define FIMG2D_SW_SCALAR	1	/* one pixel at a time */
+#define FIMG2D_SW_VECTOR	2	/* NEON on the target, SSE2 on a PC */
+
+/* rows narrower than this are not worth the vector setup */
+#define FIMG2D_SW_VEC_MIN	8
+
+/*
+ * Largest destination, in pixels, fimg2d_sw_preferred() leaves to the
+ * CPU. The default is a guess until measured with fimg2d-sw-bench on the
+ * device, which prints where the hardware starts to win.
+ */
+#define FIMG2D_SW_THRESHOLD	(64 * 64)
+
+extern unsigned int fimg2d_sw_threshold;
+
+int fimg2d_sw_supported(const struct fimg2d_user_context *c,
+			const struct fimg2d_rect *src,
+			const struct fimg2d_rect *dst);
+int fimg2d_sw_preferred(const struct fimg2d_user_context *c,
+			const struct fimg2d_rect *src,
+			const struct fimg2d_rect *dst);
+int fimg2d_sw_bitblt(const struct fimg2d_user_context *c,
+		     const struct fimg2d_rect *src,
+		     const struct fimg2d_rect *dst, int path);
+
+#endif /* _FIMG2D_SW_H_ */
@@ -0,0 +1,13 @@
+#ifndef _TOOLS_ASM_ATOMIC_H
+#define _TOOLS_ASM_ATOMIC_H
+
+typedef struct {
+	int counter;
+} atomic_t;
+
+#define atomic_read(v)		((v)->counter)
+#define atomic_set(v, i)	((v)->counter = (i))
+#define atomic_inc(v)		((v)->counter++)
+#define atomic_dec_and_test(v)	(--(v)->counter == 0)
+
+#endif
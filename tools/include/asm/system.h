@@ -0,0 +1,6 @@
+#ifndef _TOOLS_ASM_SYSTEM_H
+#define _TOOLS_ASM_SYSTEM_H
+
+/* nothing the list helpers need */
+
+#endif
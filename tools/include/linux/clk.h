@@ -0,0 +1,6 @@
+#ifndef _TOOLS_LINUX_CLK_H
+#define _TOOLS_LINUX_CLK_H
+
+/* only pointers to these are used */
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef _TOOLS_LINUX_DEVICE_H
+#define _TOOLS_LINUX_DEVICE_H
+
+/* only pointers to these are used */
+
+#endif
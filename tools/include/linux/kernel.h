@@ -0,0 +1,28 @@
+/*
+ * Minimal userspace stand-ins for the kernel interfaces used by the driver
+ * code the tests under tools/ run, so that it can be compiled unmodified
+ * into them. Only what that code takes from the kernel is here.
+ */
+
+#ifndef _TOOLS_LINUX_KERNEL_H
+#define _TOOLS_LINUX_KERNEL_H
+
+#include <errno.h>
+#include <stdio.h>
+
+#include <linux/stddef.h>
+
+#define likely(x)		(x)
+#define unlikely(x)		(x)
+
+#define ALIGN(x, a)		(((x) + (a) - 1) & ~((typeof(x))(a) - 1))
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define KERN_ERR		""
+#define KERN_DEBUG		""
+
+/* the driver's error messages are expected, the tests check the result */
+#define printk(fmt, ...)	do { } while (0)
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef _TOOLS_LINUX_MODULE_H
+#define _TOOLS_LINUX_MODULE_H
+
+#include <linux/kernel.h>
+
+#define EXPORT_SYMBOL(sym)
+#define EXPORT_SYMBOL_GPL(sym)
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef _TOOLS_LINUX_PREFETCH_H
+#define _TOOLS_LINUX_PREFETCH_H
+
+#define prefetch(x)		((void)(x))
+
+#endif
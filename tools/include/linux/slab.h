@@ -0,0 +1,38 @@
+#ifndef _TOOLS_LINUX_SLAB_H
+#define _TOOLS_LINUX_SLAB_H
+
+#include <stdlib.h>
+
+#define GFP_KERNEL		0
+
+/*
+ * fails the kmalloc_fail'th allocation from now, counts the live ones;
+ * both are defined by the test
+ */
+extern int kmalloc_fail;
+extern int kmalloc_live;
+
+static inline void *kmalloc(size_t size, int flags)
+{
+	if (kmalloc_fail && --kmalloc_fail == 0)
+		return NULL;
+	kmalloc_live++;
+	return malloc(size);
+}
+
+static inline void *kzalloc(size_t size, int flags)
+{
+	if (kmalloc_fail && --kmalloc_fail == 0)
+		return NULL;
+	kmalloc_live++;
+	return calloc(1, size);
+}
+
+static inline void kfree(const void *p)
+{
+	if (p)
+		kmalloc_live--;
+	free((void *)p);
+}
+
+#endif
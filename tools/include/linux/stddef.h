@@ -0,0 +1,10 @@
+#ifndef _TOOLS_LINUX_STDDEF_H
+#define _TOOLS_LINUX_STDDEF_H
+
+#include <stddef.h>
+
+/* linux/compiler.h */
+#define __user
+#define __iomem
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef _TOOLS_LINUX_STRING_H
+#define _TOOLS_LINUX_STRING_H
+
+#include <string.h>
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef _TOOLS_LINUX_WAIT_H
+#define _TOOLS_LINUX_WAIT_H
+
+/* nothing sleeps, the tests count the wakeups */
+typedef struct {
+	int wakeups;
+} wait_queue_head_t;
+
+#define init_waitqueue_head(q)	((q)->wakeups = 0)
+#define wake_up(q)		((q)->wakeups++)
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef _TOOLS_LINUX_WORKQUEUE_H
+#define _TOOLS_LINUX_WORKQUEUE_H
+
+/* the lock and wait queue types come in through here in the kernel */
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+
+#endif
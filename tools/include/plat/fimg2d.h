@@ -0,0 +1,6 @@
+#ifndef _TOOLS_PLAT_FIMG2D_H
+#define _TOOLS_PLAT_FIMG2D_H
+
+/* platform data is not used by the region queue */
+
+#endif
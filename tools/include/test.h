@@ -0,0 +1,79 @@
+/*
+ * Harness shared by the userspace tests of driver code under tools/: a
+ * check() that counts failures instead of stopping, the common command
+ * line and the result every test ends with.
+ *
+ *     test [-c] [-n count] [-s seed]
+ *
+ * -n sets how much random work is done, -s repeats a run with the seed it
+ * printed. -c is only taken by tests that also benchmark, to skip that.
+ */
+
+#ifndef _TOOLS_TEST_H
+#define _TOOLS_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static int failures;
+
+#define check(cond, ...)						\
+	do {								\
+		if (!(cond)) {						\
+			fprintf(stderr, "%s:%d: ", __func__, __LINE__);	\
+			fprintf(stderr, __VA_ARGS__);			\
+			fprintf(stderr, "\n");				\
+			failures++;					\
+		}							\
+	} while (0)
+
+/*
+ * Parses the command line into n and, if checks_only is not NULL, -c.
+ * what names n in the usage message. Prints the seed, seeds rand() with it
+ * and returns it, for tests that need to start over from it.
+ */
+static inline unsigned int test_start(int argc, char **argv, const char *what,
+				      unsigned long *n, int *checks_only)
+{
+	unsigned int seed = time(NULL);
+	int opt;
+
+	while ((opt = getopt(argc, argv, checks_only ? "cn:s:" : "n:s:")) != -1) {
+		switch (opt) {
+		case 'c':
+			*checks_only = 1;
+			break;
+		case 'n':
+			*n = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "usage: %s%s [-n %s] [-s seed]\n",
+				argv[0], checks_only ? " [-c]" : "", what);
+			exit(2);
+		}
+	}
+
+	printf("seed %u\n", seed);
+	srand(seed);
+
+	return seed;
+}
+
+/* prints the result, returns the exit status */
+static inline int test_done(void)
+{
+	if (failures) {
+		printf("%d checks failed\n", failures);
+		return 1;
+	}
+	printf("ok\n");
+
+	return 0;
+}
+
+#endif
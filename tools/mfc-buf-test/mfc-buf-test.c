@@ -0,0 +1,211 @@
+/*
+ * mfc-buf-test.c -- MFC buffer allocator test
+ *
+ * Copyright (C) 2011 Samsung Electronics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Runs mfc_region.c against a simulated memory port. A few fixed cases
+ * check placement, alignment and merging, then random allocations and
+ * frees of the sizes the decoders ask for are checked against a list of
+ * the live buffers: no two overlap, every one is aligned, the free byte
+ * count adds up and everything merges back into one block at the end.
+ *
+ *     mfc-buf-test [-n operations] [-s seed]
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "test.h"
+
+#include "mfc_region.h"
+
+#define PORT_BASE	0x60000000UL
+#define PORT_SIZE	(36UL << 20)	/* CONFIG_VIDEO_SAMSUNG_MEMSIZE_MFC0 */
+#define MAX_LIVE	512
+
+int kmalloc_fail;
+int kmalloc_live;
+
+struct live {
+	unsigned long start;
+	unsigned long size;
+};
+
+/* sizes and alignments from mfc_buf.h and a 720p decode */
+static const struct {
+	unsigned long size;
+	unsigned long align;
+} requests[] = {
+	{ 0x2800,	1 << 11 },	/* MFC_CTX_SIZE */
+	{ 0x96000,	1 << 11 },	/* MFC_CTX_SIZE_L */
+	{ 0x400,	1 << 2 },	/* MFC_SHM_SIZE */
+	{ 0x20000,	1 << 11 },	/* MFC_DESC_SIZE */
+	{ 0x4000,	1 << 11 },	/* MFC_DEC_NBMV_SIZE */
+	{ 0x11000,	1 << 11 },	/* MFC_DEC_UPNBMV_SIZE */
+	{ 0x22000,	1 << 11 },	/* MFC_DEC_SAMV_SIZE */
+	{ 0x800,	1 << 11 },	/* MFC_DEC_BITPLANE_SIZE */
+	{ 0x400000,	1 << 11 },	/* MFC_CPB_SIZE */
+	{ 0xe1000,	1 << 13 },	/* 720p luma */
+	{ 0x71000,	1 << 13 },	/* 720p chroma */
+	{ 0x30000,	1 << 13 },	/* 720p H.264 MV */
+	{ 0x1000,	1 << 16 },
+};
+
+static void test_fixed(void)
+{
+	struct mfc_region r;
+	unsigned long a, b, c;
+
+	check(mfc_region_init(&r, PORT_BASE, 0x10000) == 0, "init");
+
+	a = mfc_region_alloc(&r, 0x100, 1);
+	check(a == PORT_BASE, "first fit at the base, got %#lx", a);
+
+	/* the padding in front of an aligned buffer stays free */
+	b = mfc_region_alloc(&r, 0x1000, 0x1000);
+	check(b == PORT_BASE + 0x1000, "aligned, got %#lx", b);
+	check(r.blocks == 2, "padding kept, %u blocks", r.blocks);
+
+	/* the padding is the best fit for a small buffer */
+	c = mfc_region_alloc(&r, 0x800, 0x100);
+	check(c == PORT_BASE + 0x100, "best fit, got %#lx", c);
+
+	check(mfc_region_free(&r, b, 0x1000) == 0, "free b");
+	check(mfc_region_free(&r, b, 0x1000) == -EINVAL, "double free");
+	check(mfc_region_free(&r, b + 0x800, 0x1000) == -EINVAL,
+	      "overlapping free");
+	check(mfc_region_free(&r, PORT_BASE - 0x100, 0x100) == -EINVAL,
+	      "free below the region");
+	check(mfc_region_free(&r, PORT_BASE + 0x10000, 0x100) == -EINVAL,
+	      "free past the region");
+
+	/* merges with the free blocks on both sides */
+	check(mfc_region_free(&r, c, 0x800) == 0, "free c");
+	check(mfc_region_free(&r, a, 0x100) == 0, "free a");
+	check(r.blocks == 1 && r.free == 0x10000 &&
+	      mfc_region_largest(&r) == 0x10000,
+	      "merged back, %u blocks, %#lx free", r.blocks, r.free);
+
+	check(mfc_region_alloc(&r, 0x10001, 1) == 0, "too large");
+	check(mfc_region_alloc(&r, 0x100, 3) == 0, "alignment not a power of 2");
+	check(mfc_region_alloc(&r, 0, 1) == 0, "empty");
+
+	/* a failed split leaves the region alone */
+	a = mfc_region_alloc(&r, 0x100, 1);
+	kmalloc_fail = 1;
+	b = mfc_region_alloc(&r, 0x100, 0x1000);
+	check(b == 0 && r.blocks == 1 && r.free == 0x10000 - 0x100,
+	      "failed split, %u blocks", r.blocks);
+	check(mfc_region_free(&r, a, 0x100) == 0, "free a");
+
+	mfc_region_final(&r);
+	check(r.blocks == 0, "final, %u blocks", r.blocks);
+}
+
+static int live_cmp(const void *x, const void *y)
+{
+	const struct live *a = x, *b = y;
+
+	return a->start < b->start ? -1 : a->start > b->start;
+}
+
+static void check_live(struct mfc_region *r, struct live *live, int n)
+{
+	struct live sorted[MAX_LIVE];
+	unsigned long used = 0;
+	int i;
+
+	memcpy(sorted, live, n * sizeof(*live));
+	qsort(sorted, n, sizeof(*sorted), live_cmp);
+	for (i = 0; i < n; i++) {
+		used += sorted[i].size;
+		if (i && sorted[i - 1].start + sorted[i - 1].size >
+			 sorted[i].start)
+			check(0, "%#lx+%#lx overlaps %#lx",
+			      sorted[i - 1].start, sorted[i - 1].size,
+			      sorted[i].start);
+	}
+	check(r->free == PORT_SIZE - used, "%#lx free, %#lx used",
+	      r->free, used);
+}
+
+static void test_random(unsigned long ops)
+{
+	struct live live[MAX_LIVE];
+	struct mfc_region r;
+	struct timespec t0, t1;
+	unsigned long i, start, size, align, fails = 0;
+	double ns = 0;
+	int n = 0, k;
+
+	check(mfc_region_init(&r, PORT_BASE, PORT_SIZE) == 0, "init");
+
+	for (i = 0; i < ops; i++) {
+		if (n && (n == MAX_LIVE || rand() % 2)) {
+			k = rand() % n;
+			clock_gettime(CLOCK_MONOTONIC, &t0);
+			check(mfc_region_free(&r, live[k].start,
+					      live[k].size) == 0,
+			      "free %#lx+%#lx", live[k].start, live[k].size);
+			clock_gettime(CLOCK_MONOTONIC, &t1);
+			live[k] = live[--n];
+		} else {
+			k = rand() % (sizeof(requests) / sizeof(requests[0]));
+			size = requests[k].size;
+			align = requests[k].align;
+			clock_gettime(CLOCK_MONOTONIC, &t0);
+			start = mfc_region_alloc(&r, size, align);
+			clock_gettime(CLOCK_MONOTONIC, &t1);
+			if (!start) {
+				fails++;
+				continue;
+			}
+			check(start % align == 0, "%#lx not aligned to %#lx",
+			      start, align);
+			check(start >= PORT_BASE &&
+			      start + size <= PORT_BASE + PORT_SIZE,
+			      "%#lx+%#lx out of the region", start, size);
+			live[n].start = start;
+			live[n].size = size;
+			n++;
+		}
+		ns += (t1.tv_sec - t0.tv_sec) * 1e9 +
+		      (t1.tv_nsec - t0.tv_nsec);
+
+		if (i % 64 == 0)
+			check_live(&r, live, n);
+	}
+
+	printf("%lu operations, %lu allocations did not fit, "
+	       "%u free blocks, %.0f ns per operation, "
+	       "%.2f blocks probed per allocation\n",
+	       ops, fails, r.blocks, ns / ops,
+	       (double)r.probes / (r.allocs + r.fails));
+
+	while (n--)
+		check(mfc_region_free(&r, live[n].start, live[n].size) == 0,
+		      "free %#lx+%#lx", live[n].start, live[n].size);
+	check(r.blocks == 1 && r.free == PORT_SIZE, "merged back, "
+	      "%u blocks, %#lx free", r.blocks, r.free);
+
+	mfc_region_final(&r);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long ops = 1000000;
+
+	test_start(argc, argv, "operations", &ops, NULL);
+
+	test_fixed();
+	test_random(ops);
+
+	return test_done();
+}
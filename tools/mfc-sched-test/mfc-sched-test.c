@@ -0,0 +1,322 @@
+/*
+ * mfc-sched-test.c -- MFC job scheduler test
+ *
+ * Copyright (C) 2011 Samsung Electronics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Runs mfc_sched.c against a simulated codec. A few fixed cases check
+ * the queue depth, the turn order, collection and cancelling, then a
+ * decode, an encode and a thumbnail session share the codec in simulated
+ * time: each prepares its next frame while there is room in its queue,
+ * the codec takes the jobs as the scheduler hands them out. The results
+ * must come back in order and no instance with a pending job may wait for
+ * more than one job of every other instance. The codec utilization with
+ * one job per instance, like the exec ioctls, is printed next to the one
+ * with MFC_JOB_DEPTH jobs.
+ *
+ *     mfc-sched-test [-n jobs] [-s seed]
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <linux/kernel.h>
+
+#include "test.h"
+
+#include "mfc_sched.h"
+
+#define MFC_JOB_DEPTH	4	/* mfc_inst.h */
+
+struct sim_job {
+	struct mfc_job job;
+	int client;
+};
+
+static struct sim_job *sim_job(struct mfc_job *job)
+{
+	return job ? container_of(job, struct sim_job, job) : NULL;
+}
+
+static int submit(struct mfc_sched *s, struct mfc_sched_queue *q,
+		  struct sim_job *jobs, int client)
+{
+	jobs->client = client;
+	return mfc_sched_submit(s, q, &jobs->job);
+}
+
+/* runs the next job to completion, returns its client or -1 */
+static int run_one(struct mfc_sched *s)
+{
+	struct sim_job *job = sim_job(mfc_sched_next(s));
+
+	if (job == NULL)
+		return -1;
+	check(mfc_sched_next(s) == NULL, "second job while one runs");
+	mfc_sched_complete(s, &job->job, job->client);
+
+	return job->client;
+}
+
+static void test_fixed(void)
+{
+	struct mfc_sched s;
+	struct mfc_sched_queue q[3];
+	struct sim_job jobs[16];
+	struct sim_job *job;
+	struct mfc_job *j;
+	LIST_HEAD(cancelled);
+	static const int order[] = { 0, 1, 2, 0, 2, 0 };
+	int i, n;
+
+	mfc_sched_init(&s);
+	for (i = 0; i < 3; i++)
+		mfc_sched_queue_init(&q[i], 3);
+
+	check(mfc_sched_next(&s) == NULL, "job from an empty scheduler");
+
+	/* 0 0 0 1 2 2 run as 0 1 2 0 2 0 */
+	n = 0;
+	for (i = 0; i < 3; i++)
+		check(submit(&s, &q[0], &jobs[n++], 0) == 0, "submit 0");
+	check(submit(&s, &q[0], &jobs[n], 0) == -EBUSY, "depth");
+	check(s.rejects == 1, "%lu rejects", s.rejects);
+	check(submit(&s, &q[1], &jobs[n++], 1) == 0, "submit 1");
+	check(submit(&s, &q[2], &jobs[n++], 2) == 0, "submit 2");
+	check(submit(&s, &q[2], &jobs[n++], 2) == 0, "submit 2");
+
+	for (i = 0; i < 6; i++) {
+		int c = run_one(&s);
+
+		check(c == order[i], "run %d went to %d, not %d",
+		      i, c, order[i]);
+	}
+	check(run_one(&s) == -1, "all jobs ran");
+
+	/* done jobs count against the depth until collected, in order */
+	check(mfc_sched_full(&q[0]), "done jobs not counted");
+	for (i = 0; i < 3; i++) {
+		j = mfc_sched_collect(&q[0]);
+		check(j != NULL && j->seq == (unsigned long)i,
+		      "collected %lu, not %d", j ? j->seq : -1UL, i);
+	}
+	check(mfc_sched_collect(&q[0]) == NULL && q[0].queued == 0,
+	      "queue 0 empty");
+	check(mfc_sched_collect(&q[1]) != NULL, "collect 1");
+	while (mfc_sched_collect(&q[2]) != NULL)
+		;
+
+	/* a queue taking its first job again waits behind the others */
+	n = 0;
+	check(submit(&s, &q[1], &jobs[n++], 1) == 0, "submit 1");
+	check(submit(&s, &q[1], &jobs[n++], 1) == 0, "submit 1");
+	check(run_one(&s) == 1, "1 first");
+	check(submit(&s, &q[0], &jobs[n++], 0) == 0, "submit 0");
+	check(run_one(&s) == 1, "1 became ready before 0");
+	check(run_one(&s) == 0, "then 0");
+
+	/* cancelling leaves the running job to be collected */
+	while (mfc_sched_collect(&q[0]) != NULL)
+		;
+	while (mfc_sched_collect(&q[1]) != NULL)
+		;
+	n = 0;
+	for (i = 0; i < 3; i++)
+		check(submit(&s, &q[0], &jobs[n++], 0) == 0, "submit 0");
+	check(submit(&s, &q[1], &jobs[n++], 1) == 0, "submit 1");
+	job = sim_job(mfc_sched_next(&s));
+	check(job != NULL && job->client == 0, "0 runs");
+	check(mfc_sched_cancel(&s, &q[0], &cancelled) == 1, "0 still running");
+	n = 0;
+	list_for_each_entry(j, &cancelled, list)
+		n++;
+	check(n == 2 && q[0].queued == 1 && s.cancels == 2,
+	      "%d cancelled, %u queued", n, q[0].queued);
+	check(mfc_sched_next(&s) == NULL, "next while 0 runs");
+	mfc_sched_complete(&s, &job->job, 0);
+	check(run_one(&s) == 1, "1 after the cancel");
+	check(run_one(&s) == -1, "nothing of 0 left");
+	check(mfc_sched_collect(&q[0]) == &job->job && q[0].queued == 0,
+	      "running job collected");
+	INIT_LIST_HEAD(&cancelled);
+	check(mfc_sched_cancel(&s, &q[1], &cancelled) == 0 &&
+	      !list_empty(&cancelled) && q[1].queued == 0,
+	      "done job taken by the cancel");
+}
+
+static const struct {
+	const char *name;
+	unsigned long cost;	/* codec time per frame, us */
+	unsigned long think;	/* time to prepare the next frame, us */
+} clients[] = {
+	{ "1080p decode",	14000,	12000 },
+	{ "720p encode",	9000,	15000 },
+	{ "thumbnail",		1500,	6000 },
+};
+
+#define NR_CLIENTS	(sizeof(clients) / sizeof(clients[0]))
+#define IDLE		ULONG_MAX
+
+struct client {
+	struct mfc_sched_queue queue;
+	unsigned long ready_at;	/* next frame prepared, IDLE if no room */
+	unsigned long collected;
+	unsigned int waited;	/* runs of others since it became ready */
+};
+
+static double ns_since(struct timespec *t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return (t1.tv_sec - t0->tv_sec) * 1e9 + (t1.tv_nsec - t0->tv_nsec);
+}
+
+static double test_sim(unsigned int depth, unsigned long nr_jobs)
+{
+	struct client c[NR_CLIENTS];
+	struct mfc_sched s;
+	struct sim_job *job, *running = NULL;
+	struct mfc_job *j;
+	struct timespec t0;
+	unsigned long now = 0, done_at = 0, busy = 0, next;
+	unsigned long ops = 0;
+	double ns = 0;
+	unsigned int i, k;
+
+	mfc_sched_init(&s);
+	for (i = 0; i < NR_CLIENTS; i++) {
+		mfc_sched_queue_init(&c[i].queue, depth);
+		c[i].ready_at = clients[i].think;
+		c[i].collected = 0;
+		c[i].waited = 0;
+	}
+
+	while (s.runs < nr_jobs) {
+		next = running ? done_at : IDLE;
+		for (i = 0; i < NR_CLIENTS; i++)
+			if (c[i].ready_at < next)
+				next = c[i].ready_at;
+		now = next;
+
+		if (running && done_at == now) {
+			i = running->client;
+			clock_gettime(CLOCK_MONOTONIC, &t0);
+			mfc_sched_complete(&s, &running->job, 0);
+			ns += ns_since(&t0);
+			ops++;
+			running = NULL;
+
+			for (;;) {
+				clock_gettime(CLOCK_MONOTONIC, &t0);
+				j = mfc_sched_collect(&c[i].queue);
+				ns += ns_since(&t0);
+				ops++;
+				if (j == NULL)
+					break;
+				check(j->seq == c[i].collected,
+				      "%s: job %lu back as %lu",
+				      clients[i].name, j->seq, c[i].collected);
+				c[i].collected++;
+				free(sim_job(j));
+			}
+			if (c[i].ready_at == IDLE)
+				c[i].ready_at = now + clients[i].think;
+		}
+
+		for (i = 0; i < NR_CLIENTS; i++) {
+			if (c[i].ready_at > now)
+				continue;
+			job = malloc(sizeof(*job));
+			if (job == NULL) {
+				perror("malloc");
+				exit(1);
+			}
+			job->client = i;
+			if (list_empty(&c[i].queue.pending))
+				c[i].waited = 0;
+			clock_gettime(CLOCK_MONOTONIC, &t0);
+			check(mfc_sched_submit(&s, &c[i].queue,
+					       &job->job) == 0,
+			      "%s: submit", clients[i].name);
+			ns += ns_since(&t0);
+			ops++;
+			c[i].ready_at = mfc_sched_full(&c[i].queue) ?
+					IDLE : now + clients[i].think;
+		}
+
+		if (running)
+			continue;
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		running = sim_job(mfc_sched_next(&s));
+		ns += ns_since(&t0);
+		ops++;
+		if (running == NULL)
+			continue;
+
+		k = running->client;
+		c[k].waited = 0;
+		for (i = 0; i < NR_CLIENTS; i++) {
+			if (i == k || list_empty(&c[i].queue.pending))
+				continue;
+			c[i].waited++;
+			check(c[i].waited < NR_CLIENTS, "%s waited for %u jobs",
+			      clients[i].name, c[i].waited);
+		}
+		next = clients[k].cost * (75 + rand() % 51) / 100;
+		done_at = now + next;
+		busy += next;
+	}
+
+	printf("depth %u: codec busy %.1f%% of %.1f s, %.0f ns per "
+	       "scheduler call\n", depth, 100.0 * busy / now, now / 1e6,
+	       ns / ops);
+	for (i = 0; i < NR_CLIENTS; i++)
+		printf("  %-14s %6.1f frames/s\n", clients[i].name,
+		       c[i].collected * 1e6 / now);
+
+	/* what is left goes as on release */
+	if (running)
+		mfc_sched_complete(&s, &running->job, 0);
+	for (i = 0; i < NR_CLIENTS; i++) {
+		LIST_HEAD(jobs);
+		struct sim_job *tmp;
+
+		check(mfc_sched_cancel(&s, &c[i].queue, &jobs) == 0,
+		      "%s: running after the end", clients[i].name);
+		check(c[i].queue.queued == 0, "%s: %u queued after cancel",
+		      clients[i].name, c[i].queue.queued);
+		list_for_each_entry_safe(job, tmp, &jobs, job.list)
+			free(job);
+	}
+	check(list_empty(&s.ready), "queues ready after cancelling all");
+
+	return (double)busy / now;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long nr_jobs = 100000;
+	unsigned int seed;
+	double single, queued;
+
+	seed = test_start(argc, argv, "jobs", &nr_jobs, NULL);
+
+	test_fixed();
+
+	srand(seed);
+	single = test_sim(1, nr_jobs);
+	srand(seed);
+	queued = test_sim(MFC_JOB_DEPTH, nr_jobs);
+	check(queued > single - 0.005,
+	      "deeper queues left the codec idle longer");
+
+	return test_done();
+}